@@ -36,6 +36,9 @@ option(BUILD_EXTRAS "" OFF)
 option(BUILD_UNIT_TESTS "" OFF)
 option(INSTALL_LIBS "" OFF)
 option(INSTALL_CMAKE_FILES "" OFF)
+# Thread safe Bullet for btDiscreteDynamicsWorldMt, see the
+# physics_threads gamevar.
+option(BULLET2_MULTITHREADING "" ON)
 add_subdirectory(bullet3)
 configure_target_folders("bullet3" FALSE)
 
@@ -50,3 +53,11 @@ target_include_directories(BulletDynamics INTERFACE
 target_include_directories(LinearMath INTERFACE
   ${CMAKE_CURRENT_SOURCE_DIR}/bullet3/src
   )
+
+# Bullet only defines this for its own targets, users of its headers
+# need to agree.
+if (BULLET2_MULTITHREADING)
+  target_compile_definitions(LinearMath INTERFACE
+    BT_THREADSAFE=1
+    )
+endif()
@@ -106,33 +106,20 @@ class ScriptInfo:
 
 
     def _compile(self, paths):
-        rel_scr_inc = paths.script_includes_h.relative_to(paths.binary_gaen_dir/'src').as_posix()
-        args = [paths.cmpc, '-i', rel_scr_inc, self.cmp_full_path]
-
-        # LORRNOTE: Printing these always isn't useful, but keeping
-        # these lines commented out for future debugging purposes.
-        #for arg in args:
-        #    print(arg),
-        #print()
-
-        p = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-        sout, serr = p.communicate()
-        if p.returncode == 0:
-            output = sout.replace(b'\r\n', b'\n')
-            mh = H_SECTION_RE.match(output)
-            if (mh):
-                self.h_source = mh.group(1).decode('utf-8')
-                self.h_source_hash = hashlib.md5(mh.group(1)).hexdigest();
-            else:
-                self.h_source = None
-
-            mcpp = CPP_SECTION_RE.match(output)
-            self.cpp_source = mcpp.group(1).decode('utf-8')
-            self.cpp_source_hash = hashlib.md5(mcpp.group(1)).hexdigest();
-            return True
+        # Output was produced by compile_scripts, cmpc names each
+        # file after the script's dotted namespace.
+        cmpout_name = '.'.join(self.cmp_full_path.relative_to(paths.scripts_cmp_dir).with_suffix('').parts) + '.cmpout'
+        output = (cmpout_dir(paths)/cmpout_name).read_bytes().replace(b'\r\n', b'\n')
+        mh = H_SECTION_RE.match(output)
+        if (mh):
+            self.h_source = mh.group(1).decode('utf-8')
+            self.h_source_hash = hashlib.md5(mh.group(1)).hexdigest();
         else:
-            print(serr.decode('utf-8')),
-            return False
+            self.h_source = None
+
+        mcpp = CPP_SECTION_RE.match(output)
+        self.cpp_source = mcpp.group(1).decode('utf-8')
+        self.cpp_source_hash = hashlib.md5(mcpp.group(1)).hexdigest();
 
     def _should_write_cpp(self):
         if not self.cpp_exists:
@@ -168,6 +155,30 @@ class ScriptInfo:
                 print(self.h_filename)
                 write_file(self.h_full_path, self.h_output)
 
+def cmpout_dir(paths):
+    return paths.scripts_output_dir/'cmpout'
+
+def compile_scripts(cmp_inputs, paths):
+    # One cmpc process compiles every script across worker threads,
+    # skipping those whose source and usings haven't changed since
+    # the previous run.
+    cmpout_dir(paths).mkdir(parents=True, exist_ok=True)
+    rel_scr_inc = paths.script_includes_h.relative_to(paths.binary_gaen_dir/'src').as_posix()
+    args = [paths.cmpc, '-i', rel_scr_inc, '-o', cmpout_dir(paths)] + cmp_inputs
+
+    # LORRNOTE: Printing these always isn't useful, but keeping
+    # these lines commented out for future debugging purposes.
+    #for arg in args:
+    #    print(arg),
+    #print()
+
+    p = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    sout, serr = p.communicate()
+    if p.returncode != 0:
+        print(serr.decode('utf-8')),
+        return False
+    return True
+
 LICENSE_TEXTS = {} # memoize
 def license_text(comment_chars, license_path):
     k = (comment_chars, license_path)
@@ -275,6 +286,10 @@ def main(binary_dir):
 
     cmp_inputs = find_cmp_files(paths)
 
+    if not compile_scripts(cmp_inputs, paths):
+        print("ERROR: scripts failed to compile")
+        exit(1)
+
     for fcmp in cmp_inputs:
         try:
             si = ScriptInfo(fcmp, paths)
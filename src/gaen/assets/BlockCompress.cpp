@@ -0,0 +1,465 @@
+//------------------------------------------------------------------------------
+// BlockCompress.cpp - BC1 and BC3 texture block compression
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/core/parallel_for.h"
+
+#include "gaen/assets/BlockCompress.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BC_SSE HAS_X
+#include <emmintrin.h>
+#else
+#define BC_SSE HAS__
+#endif
+
+namespace gaen
+{
+
+static const u32 kBlockTexels = 16;
+
+u32 block_compressed_bytes(PixelFormat pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case kPXL_RGB_DXT1:
+    case kPXL_RGBA_DXT1:
+        return 8;
+    case kPXL_RGBA_DXT3:
+    case kPXL_RGBA_DXT5:
+        return 16;
+    default:
+        PANIC("Not a block compressed PixelFormat: %d", pixelFormat);
+        return 0;
+    }
+}
+
+static inline u16 pack_565(const i32 * pRgb)
+{
+    return static_cast<u16>(((pRgb[0] >> 3) << 11) | ((pRgb[1] >> 2) << 5) | (pRgb[2] >> 3));
+}
+
+// Same bit replication the gpu uses to widen 565 endpoints
+static inline void unpack_565(i32 * pRgb, u16 color)
+{
+    i32 r = (color >> 11) & 31;
+    i32 g = (color >> 5) & 63;
+    i32 b = color & 31;
+    pRgb[0] = (r << 3) | (r >> 2);
+    pRgb[1] = (g << 2) | (g >> 4);
+    pRgb[2] = (b << 3) | (b >> 2);
+}
+
+static inline void gather_block(u8 * pTexels, const u8 * pRgba, u32 rowPitch)
+{
+    for (u32 row = 0; row < 4; ++row)
+        memcpy(pTexels + row * 16, pRgba + row * rowPitch, 16);
+}
+
+static void block_min_max(u8 * pMin, u8 * pMax, const u8 * pTexels)
+{
+#if HAS(BC_SSE)
+    const __m128i * pRows = reinterpret_cast<const __m128i*>(pTexels);
+    __m128i r0 = _mm_loadu_si128(pRows + 0);
+    __m128i r1 = _mm_loadu_si128(pRows + 1);
+    __m128i r2 = _mm_loadu_si128(pRows + 2);
+    __m128i r3 = _mm_loadu_si128(pRows + 3);
+
+    __m128i mn = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+    __m128i mx = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+    mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(1, 0, 3, 2)));
+    mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(1, 0, 3, 2)));
+    mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(2, 3, 0, 1)));
+    mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    u32 mnBits = static_cast<u32>(_mm_cvtsi128_si32(mn));
+    u32 mxBits = static_cast<u32>(_mm_cvtsi128_si32(mx));
+    memcpy(pMin, &mnBits, 4);
+    memcpy(pMax, &mxBits, 4);
+#else
+    for (u32 c = 0; c < 4; ++c)
+    {
+        pMin[c] = 255;
+        pMax[c] = 0;
+    }
+    for (u32 i = 0; i < kBlockTexels; ++i)
+    {
+        for (u32 c = 0; c < 4; ++c)
+        {
+            u8 val = pTexels[i * 4 + c];
+            pMin[c] = val < pMin[c] ? val : pMin[c];
+            pMax[c] = val > pMax[c] ? val : pMax[c];
+        }
+    }
+#endif
+}
+
+// Endpoints span the block's bounding box, inset by 1/16th so a few
+// outliers don't stretch the palette for every other texel. The box
+// has four diagonals, pick the one that follows how red and blue vary
+// with green across the block.
+static void color_endpoints(u16 * pC0, u16 * pC1, const u8 * pTexels, const u8 * pMin, const u8 * pMax)
+{
+    i32 lo[3];
+    i32 hi[3];
+    for (u32 c = 0; c < 3; ++c)
+    {
+        i32 inset = (pMax[c] - pMin[c]) >> 4;
+        lo[c] = pMin[c] + inset;
+        hi[c] = pMax[c] - inset;
+    }
+
+    i32 covRG = 0;
+    i32 covBG = 0;
+    for (u32 i = 0; i < kBlockTexels; ++i)
+    {
+        const u8 * pTex = pTexels + i * 4;
+        i32 dr = 2 * pTex[0] - (pMin[0] + pMax[0]);
+        i32 dg = 2 * pTex[1] - (pMin[1] + pMax[1]);
+        i32 db = 2 * pTex[2] - (pMin[2] + pMax[2]);
+        covRG += dr * dg;
+        covBG += db * dg;
+    }
+    if (covRG < 0)
+    {
+        i32 t = lo[0]; lo[0] = hi[0]; hi[0] = t;
+    }
+    if (covBG < 0)
+    {
+        i32 t = lo[2]; lo[2] = hi[2]; hi[2] = t;
+    }
+
+    u16 c0 = pack_565(hi);
+    u16 c1 = pack_565(lo);
+
+    // c0 > c1 selects 4 color mode in BC1
+    if (c0 < c1)
+    {
+        u16 t = c0; c0 = c1; c1 = t;
+    }
+    *pC0 = c0;
+    *pC1 = c1;
+}
+
+// Palette position of each texel between e1 (0) and e0 (3), rounded.
+// Compares 6 * dot against multiples of the axis length rather than
+// dividing, so both paths give exactly the same answer.
+static void color_positions_scalar(i32 * pPos, const u8 * pTexels, const i32 * pE0, const i32 * pE1)
+{
+    i32 d[3] = { pE0[0] - pE1[0], pE0[1] - pE1[1], pE0[2] - pE1[2] };
+    i32 total = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+
+    for (u32 i = 0; i < kBlockTexels; ++i)
+    {
+        const u8 * pTex = pTexels + i * 4;
+        i32 dot = (pTex[0] - pE1[0]) * d[0] + (pTex[1] - pE1[1]) * d[1] + (pTex[2] - pE1[2]) * d[2];
+        i32 six = dot * 6;
+        pPos[i] = (six >= total) + (six >= 3 * total) + (six >= 5 * total);
+    }
+}
+
+#if HAS(BC_SSE)
+static void color_positions_sse(i32 * pPos, const u8 * pTexels, const i32 * pE0, const i32 * pE1)
+{
+    i32 d[3] = { pE0[0] - pE1[0], pE0[1] - pE1[1], pE0[2] - pE1[2] };
+    i32 total = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+
+    // Two texels per register as 16 bit rgba
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i e1 = _mm_setr_epi16((i16)pE1[0], (i16)pE1[1], (i16)pE1[2], 0, (i16)pE1[0], (i16)pE1[1], (i16)pE1[2], 0);
+    const __m128i axis = _mm_setr_epi16((i16)d[0], (i16)d[1], (i16)d[2], 0, (i16)d[0], (i16)d[1], (i16)d[2], 0);
+    const __m128i t1 = _mm_set1_epi32(total - 1);
+    const __m128i t3 = _mm_set1_epi32(3 * total - 1);
+    const __m128i t5 = _mm_set1_epi32(5 * total - 1);
+
+    const __m128i * pRows = reinterpret_cast<const __m128i*>(pTexels);
+    __m128i * pOut = reinterpret_cast<__m128i*>(pPos);
+
+    for (u32 row = 0; row < 4; ++row)
+    {
+        __m128i texels = _mm_loadu_si128(pRows + row);
+        __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(texels, zero), e1);
+        __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(texels, zero), e1);
+
+        // (r*dr + g*dg, b*db + 0) pairs, summed into one dot per texel
+        __m128i madLo = _mm_madd_epi16(lo, axis);
+        __m128i madHi = _mm_madd_epi16(hi, axis);
+        __m128i evens = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(madLo), _mm_castsi128_ps(madHi), _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odds = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(madLo), _mm_castsi128_ps(madHi), _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i dot = _mm_add_epi32(evens, odds);
+
+        __m128i six = _mm_add_epi32(_mm_slli_epi32(dot, 2), _mm_slli_epi32(dot, 1));
+
+        // Compares are all ones when true, so subtracting counts them
+        __m128i pos = _mm_sub_epi32(zero, _mm_cmpgt_epi32(six, t1));
+        pos = _mm_sub_epi32(pos, _mm_cmpgt_epi32(six, t3));
+        pos = _mm_sub_epi32(pos, _mm_cmpgt_epi32(six, t5));
+        _mm_storeu_si128(pOut + row, pos);
+    }
+}
+#endif // #if HAS(BC_SSE)
+
+static void encode_color_block(u8 * pBlock, const u8 * pTexels, const u8 * pMin, const u8 * pMax, bool useSimd)
+{
+    u16 c0, c1;
+    color_endpoints(&c0, &c1, pTexels, pMin, pMax);
+
+    i32 e0[3];
+    i32 e1[3];
+    unpack_565(e0, c0);
+    unpack_565(e1, c1);
+
+    i32 pos[kBlockTexels];
+#if HAS(BC_SSE)
+    if (useSimd)
+        color_positions_sse(pos, pTexels, e0, e1);
+    else
+        color_positions_scalar(pos, pTexels, e0, e1);
+#else
+    color_positions_scalar(pos, pTexels, e0, e1);
+#endif
+
+    // Position from e1 to e0 in thirds to BC1 index
+    static const u32 kPosToIndex[4] = { 1, 3, 2, 0 };
+    u32 indices = 0;
+    for (u32 i = 0; i < kBlockTexels; ++i)
+        indices |= kPosToIndex[pos[i]] << (i * 2);
+
+    pBlock[0] = static_cast<u8>(c0);
+    pBlock[1] = static_cast<u8>(c0 >> 8);
+    pBlock[2] = static_cast<u8>(c1);
+    pBlock[3] = static_cast<u8>(c1 >> 8);
+    pBlock[4] = static_cast<u8>(indices);
+    pBlock[5] = static_cast<u8>(indices >> 8);
+    pBlock[6] = static_cast<u8>(indices >> 16);
+    pBlock[7] = static_cast<u8>(indices >> 24);
+}
+
+// 8 alpha mode, exact min and max so fully opaque and fully clear
+// texels stay that way.
+static void encode_alpha_block(u8 * pBlock, const u8 * pTexels, u8 minA, u8 maxA)
+{
+    pBlock[0] = maxA;
+    pBlock[1] = minA;
+
+    i32 range = maxA - minA;
+    u64 indices = 0;
+    if (range > 0)
+    {
+        for (u32 i = 0; i < kBlockTexels; ++i)
+        {
+            i32 da = pTexels[i * 4 + 3] - minA;
+            i32 t = (14 * da + range) / (2 * range); // sevenths from min
+            u64 idx = t == 7 ? 0 : (t == 0 ? 1 : 8 - t);
+            indices |= idx << (i * 3);
+        }
+    }
+
+    for (u32 i = 0; i < 6; ++i)
+        pBlock[2 + i] = static_cast<u8>(indices >> (i * 8));
+}
+
+void encode_bc1_block(u8 * pBlock, const u8 * pRgba, u32 rowPitch)
+{
+    u8 texels[kBlockTexels * 4];
+    gather_block(texels, pRgba, rowPitch);
+    u8 mn[4], mx[4];
+    block_min_max(mn, mx, texels);
+    encode_color_block(pBlock, texels, mn, mx, true);
+}
+
+void encode_bc3_block(u8 * pBlock, const u8 * pRgba, u32 rowPitch)
+{
+    u8 texels[kBlockTexels * 4];
+    gather_block(texels, pRgba, rowPitch);
+    u8 mn[4], mx[4];
+    block_min_max(mn, mx, texels);
+    encode_alpha_block(pBlock, texels, mn[3], mx[3]);
+    encode_color_block(pBlock + 8, texels, mn, mx, true);
+}
+
+void encode_bc1_block_scalar(u8 * pBlock, const u8 * pRgba, u32 rowPitch)
+{
+    u8 texels[kBlockTexels * 4];
+    gather_block(texels, pRgba, rowPitch);
+    u8 mn[4] = { 255, 255, 255, 255 };
+    u8 mx[4] = { 0, 0, 0, 0 };
+    for (u32 i = 0; i < kBlockTexels * 4; ++i)
+    {
+        mn[i % 4] = texels[i] < mn[i % 4] ? texels[i] : mn[i % 4];
+        mx[i % 4] = texels[i] > mx[i % 4] ? texels[i] : mx[i % 4];
+    }
+    encode_color_block(pBlock, texels, mn, mx, false);
+}
+
+void encode_bc3_block_scalar(u8 * pBlock, const u8 * pRgba, u32 rowPitch)
+{
+    u8 texels[kBlockTexels * 4];
+    gather_block(texels, pRgba, rowPitch);
+    u8 mn[4] = { 255, 255, 255, 255 };
+    u8 mx[4] = { 0, 0, 0, 0 };
+    for (u32 i = 0; i < kBlockTexels * 4; ++i)
+    {
+        mn[i % 4] = texels[i] < mn[i % 4] ? texels[i] : mn[i % 4];
+        mx[i % 4] = texels[i] > mx[i % 4] ? texels[i] : mx[i % 4];
+    }
+    encode_alpha_block(pBlock, texels, mn[3], mx[3]);
+    encode_color_block(pBlock + 8, texels, mn, mx, false);
+}
+
+static void decode_color_block(u8 * pRgba, u32 rowPitch, const u8 * pBlock, bool isBc1)
+{
+    u16 c0 = static_cast<u16>(pBlock[0] | (pBlock[1] << 8));
+    u16 c1 = static_cast<u16>(pBlock[2] | (pBlock[3] << 8));
+    u32 indices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | ((u32)pBlock[7] << 24);
+
+    i32 palette[4][4];
+    unpack_565(palette[0], c0);
+    unpack_565(palette[1], c1);
+    palette[0][3] = palette[1][3] = 255;
+    for (u32 c = 0; c < 3; ++c)
+    {
+        if (!isBc1 || c0 > c1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = (!isBc1 || c0 > c1) ? 255 : 0;
+
+    for (u32 i = 0; i < kBlockTexels; ++i)
+    {
+        const i32 * pColor = palette[(indices >> (i * 2)) & 3];
+        u8 * pTex = pRgba + (i / 4) * rowPitch + (i % 4) * 4;
+        for (u32 c = 0; c < 4; ++c)
+            pTex[c] = static_cast<u8>(pColor[c]);
+    }
+}
+
+void decode_bc1_block(u8 * pRgba, u32 rowPitch, const u8 * pBlock)
+{
+    decode_color_block(pRgba, rowPitch, pBlock, true);
+}
+
+void decode_bc3_block(u8 * pRgba, u32 rowPitch, const u8 * pBlock)
+{
+    decode_color_block(pRgba, rowPitch, pBlock + 8, false);
+
+    i32 a0 = pBlock[0];
+    i32 a1 = pBlock[1];
+    i32 palette[8] = { a0, a1 };
+    if (a0 > a1)
+    {
+        for (i32 i = 2; i < 8; ++i)
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+    }
+    else
+    {
+        for (i32 i = 2; i < 6; ++i)
+            palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    u64 indices = 0;
+    for (u32 i = 0; i < 6; ++i)
+        indices |= (u64)pBlock[2 + i] << (i * 8);
+
+    for (u32 i = 0; i < kBlockTexels; ++i)
+        pRgba[(i / 4) * rowPitch + (i % 4) * 4 + 3] = static_cast<u8>(palette[(indices >> (i * 3)) & 7]);
+}
+
+struct BlockCompressJob
+{
+    u8 * pDst;
+    PixelFormat pixelFormat;
+    const u8 * pRgba;
+    u32 width;
+    u32 height;
+    u32 blocksX;
+};
+
+static void compress_block_row(const BlockCompressJob & job, u32 by)
+{
+    u32 blockBytes = block_compressed_bytes(job.pixelFormat);
+    u32 rowPitch = job.width * 4;
+    u8 * pOut = job.pDst + (u64)by * job.blocksX * blockBytes;
+
+    for (u32 bx = 0; bx < job.blocksX; ++bx)
+    {
+        const u8 * pSrc = job.pRgba + (u64)by * 4 * rowPitch + bx * 16;
+        u32 srcPitch = rowPitch;
+
+        // Partial blocks repeat their edge texels
+        u8 padded[kBlockTexels * 4];
+        if (bx * 4 + 4 > job.width || by * 4 + 4 > job.height)
+        {
+            for (u32 y = 0; y < 4; ++y)
+            {
+                u32 sy = by * 4 + y < job.height ? by * 4 + y : job.height - 1;
+                for (u32 x = 0; x < 4; ++x)
+                {
+                    u32 sx = bx * 4 + x < job.width ? bx * 4 + x : job.width - 1;
+                    memcpy(padded + (y * 4 + x) * 4, job.pRgba + (u64)sy * rowPitch + sx * 4, 4);
+                }
+            }
+            pSrc = padded;
+            srcPitch = 16;
+        }
+
+        if (job.pixelFormat == kPXL_RGBA_DXT5)
+            encode_bc3_block(pOut, pSrc, srcPitch);
+        else
+            encode_bc1_block(pOut, pSrc, srcPitch);
+        pOut += blockBytes;
+    }
+}
+
+void block_compress(u8 * pDst,
+                    PixelFormat pixelFormat,
+                    const u8 * pRgba,
+                    u32 width,
+                    u32 height,
+                    u32 threadCount)
+{
+    PANIC_IF(pixelFormat != kPXL_RGB_DXT1 && pixelFormat != kPXL_RGBA_DXT5,
+             "Block compression only encodes RGB_DXT1 and RGBA_DXT5, not: %s", pixel_format_to_str(pixelFormat));
+
+    BlockCompressJob job{pDst, pixelFormat, pRgba, width, height, (width + 3) / 4};
+    u32 blocksY = (height + 3) / 4;
+
+    parallel_for(blocksY, threadCount, [&](u32 by)
+    {
+        compress_block_row(job, by);
+    });
+}
+
+} // namespace gaen
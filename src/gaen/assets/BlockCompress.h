@@ -0,0 +1,64 @@
+//------------------------------------------------------------------------------
+// BlockCompress.h - BC1 and BC3 texture block compression
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_ASSETS_BLOCKCOMPRESS_H
+#define GAEN_ASSETS_BLOCKCOMPRESS_H
+
+#include "gaen/core/base_defines.h"
+#include "gaen/assets/Gimg.h"
+
+namespace gaen
+{
+
+// Bytes per 4x4 block, 8 for DXT1 and 16 for DXT3/DXT5
+u32 block_compressed_bytes(PixelFormat pixelFormat);
+
+// Compresses an RGBA8 image to kPXL_RGB_DXT1 (BC1) or kPXL_RGBA_DXT5
+// (BC3). Rows of blocks run as parallel_for jobs on up to threadCount
+// threads, 0 means one per core. Images smaller than a block, like the
+// last mip levels, are padded by repeating their edge texels.
+void block_compress(u8 * pDst,
+                    PixelFormat pixelFormat,
+                    const u8 * pRgba,
+                    u32 width,
+                    u32 height,
+                    u32 threadCount);
+
+// Single 4x4 blocks of RGBA8 texels, rowPitch bytes between rows.
+// Endpoints come from the block's inset bounding box, and texel
+// indices are picked with SSE2 where available. The _scalar versions
+// produce identical blocks without SIMD.
+void encode_bc1_block(u8 * pBlock, const u8 * pRgba, u32 rowPitch);
+void encode_bc3_block(u8 * pBlock, const u8 * pRgba, u32 rowPitch);
+void encode_bc1_block_scalar(u8 * pBlock, const u8 * pRgba, u32 rowPitch);
+void encode_bc3_block_scalar(u8 * pBlock, const u8 * pRgba, u32 rowPitch);
+
+void decode_bc1_block(u8 * pRgba, u32 rowPitch, const u8 * pBlock);
+void decode_bc3_block(u8 * pRgba, u32 rowPitch, const u8 * pBlock);
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_ASSETS_BLOCKCOMPRESS_H
@@ -164,6 +164,18 @@ void Config<memType>::writeKeyVal(std::ostream & output,
     output.put('\n');
 }
 
+template <MemType memType>
+void Config<memType>::overlay(const Config & other)
+{
+    for (auto secIt = other.sectionsBegin(); secIt != other.sectionsEnd(); ++secIt)
+    {
+        for (auto keyIt = other.keysBegin(*secIt); keyIt != other.keysEnd(*secIt); ++keyIt)
+        {
+            set(*secIt, *keyIt, other.get(*secIt, *keyIt));
+        }
+    }
+}
+
 template <MemType memType>
 bool Config<memType>::write(std::ostream & output)
 {
@@ -60,6 +60,10 @@ public:
     bool read(std::istream & input);
     bool read(const char * path);
 
+    // Copy every key of other into this config, replacing any
+    // values already present.
+    void overlay(const Config & other);
+
     bool write(std::ostream & output);
     bool write(const char * path);
 
@@ -30,6 +30,7 @@
 #include "gaen/math/common.h"
 
 #include "gaen/assets/file_utils.h"
+#include "gaen/assets/BlockCompress.h"
 #include "gaen/assets/Gimg.h"
 
 namespace gaen
@@ -91,6 +92,20 @@ u32 bytes_per_pixel(PixelFormat pixelFormat)
     return it->second;
 }
 
+bool is_block_compressed(PixelFormat pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case kPXL_RGB_DXT1:
+    case kPXL_RGBA_DXT1:
+    case kPXL_RGBA_DXT3:
+    case kPXL_RGBA_DXT5:
+        return true;
+    default:
+        return false;
+    }
+}
+
 bool Gimg::is_valid(const void * pBuffer, u64 size)
 {
     if (size < sizeof(Gimg))
@@ -114,6 +129,10 @@ bool Gimg::is_valid(const void * pBuffer, u64 size)
             return false;
     }
 
+    if (pAssetData->mMipCount == 0 ||
+        pAssetData->mMipCount > full_mip_count(pAssetData->mWidth, pAssetData->mHeight))
+        return false;
+
     return true;
 }
 
@@ -139,53 +158,75 @@ const Gimg * Gimg::instance(const void * pBuffer, u64 size)
     return reinterpret_cast<const Gimg*>(pBuffer);
 }
 
-u64 Gimg::required_size(PixelFormat pixelFormat, u32 width, u32 height)
+u64 Gimg::level_size(PixelFormat pixelFormat, u32 width, u32 height)
 {
-    u64 size = sizeof(Gimg);
-
     switch (pixelFormat)
     {
     case kPXL_Reference:
-        // just the header
-        break;
+        return 0;
     case kPXL_RGB_DXT1:
     case kPXL_RGBA_DXT1:
-        PANIC_IF(width % 4 != 0 || height % 4 != 0, "DXT1 texture with width or height not a multiple of 4");
-        size += (u64)width * height / 2; // every block of 16 pixels becomes 8 bytes
-        break;
     case kPXL_RGBA_DXT3:
     case kPXL_RGBA_DXT5:
-        PANIC_IF(width % 4 != 0 || height % 4 != 0, "DXT texture with width or height not a multiple of 4");
-        size += (u64)width * height; // every block of 16 pixels becomes 16 bytes
-        break;
+        // every block of 16 pixels becomes 8 or 16 bytes, small mip
+        // levels still take a whole block
+        return (u64)((width + 3) / 4) * ((height + 3) / 4) * block_compressed_bytes(pixelFormat);
     default:
-        size += (u64)width * height * bytes_per_pixel(pixelFormat);
-        break;
+        return (u64)width * height * bytes_per_pixel(pixelFormat);
+    }
+}
+
+u32 Gimg::full_mip_count(u32 width, u32 height)
+{
+    u32 count = 1;
+    u32 size = width > height ? width : height;
+    while (size > 1)
+    {
+        size >>= 1;
+        count++;
+    }
+    return count;
+}
+
+u64 Gimg::required_size(PixelFormat pixelFormat, u32 width, u32 height, u32 mipCount)
+{
+    u64 size = sizeof(Gimg);
+
+    if (is_block_compressed(pixelFormat))
+    {
+        PANIC_IF(width % 4 != 0 || height % 4 != 0, "DXT texture with width or height not a multiple of 4");
+    }
+
+    for (u32 level = 0; level < mipCount; ++level)
+    {
+        size += level_size(pixelFormat, max(width >> level, 1u), max(height >> level, 1u));
     }
 
     return size;
 }
 
-void Gimg::init(Gimg * pGimg, PixelFormat pixelFormat, u32 width, u32 height, u32 referencePathHash)
+void Gimg::init(Gimg * pGimg, PixelFormat pixelFormat, u32 width, u32 height, u32 referencePathHash, u32 mipCount)
 {
     pGimg->mPixelFormat = pixelFormat;
     pGimg->mWidth = width;
     pGimg->mHeight = height;
     pGimg->mReferencePathHash = referencePathHash;
+    pGimg->mMipCount = mipCount;
 }
 
-Gimg * Gimg::create(PixelFormat pixelFormat, u32 width, u32 height, u32 referencePathHash)
+Gimg * Gimg::create(PixelFormat pixelFormat, u32 width, u32 height, u32 referencePathHash, u32 mipCount)
 {
     // adjust width and height to ensure power of 2 and equal size
     PANIC_IF(width != next_power_of_two(width), "Width not a power of 2");
     PANIC_IF(height != next_power_of_two(height), "Height not a power of 2");
+    PANIC_IF(mipCount == 0 || mipCount > full_mip_count(width, height), "Invalid mip count %u for %ux%u", mipCount, width, height);
 
-    u64 size = Gimg::required_size(pixelFormat, width, height);
+    u64 size = Gimg::required_size(pixelFormat, width, height, mipCount);
     Gimg * pGimg = alloc_asset<Gimg>(kMEM_Texture, size);
 
-    init(pGimg, pixelFormat, width, height, referencePathHash);
+    init(pGimg, pixelFormat, width, height, referencePathHash, mipCount);
 
-    ASSERT(is_valid(pGimg, required_size(pixelFormat, width, height)));
+    ASSERT(is_valid(pGimg, size));
 
     return pGimg;
 }
@@ -205,6 +246,43 @@ const u8 * Gimg::pixels() const
     return (const u8*)this + sizeof(Gimg);
 }
 
+u64 Gimg::pixelsSize() const
+{
+    return required_size(mPixelFormat, mWidth, mHeight, mMipCount) - sizeof(Gimg);
+}
+
+u32 Gimg::mipWidth(u32 level) const
+{
+    ASSERT(level < mMipCount);
+    return max(mWidth >> level, 1u);
+}
+
+u32 Gimg::mipHeight(u32 level) const
+{
+    ASSERT(level < mMipCount);
+    return max(mHeight >> level, 1u);
+}
+
+u64 Gimg::mipSize(u32 level) const
+{
+    return level_size(mPixelFormat, mipWidth(level), mipHeight(level));
+}
+
+u8 * Gimg::mipPixels(u32 level)
+{
+    ASSERT(level < mMipCount);
+    u8 * pLevel = pixels();
+    for (u32 i = 0; i < level; ++i)
+        pLevel += mipSize(i);
+    return pLevel;
+}
+
+const u8 * Gimg::mipPixels(u32 level) const
+{
+    Gimg * pGimg = const_cast<Gimg*>(this);
+    return pGimg->mipPixels(level);
+}
+
 u8 * Gimg::scanline(u32 idx)
 {
     PANIC_IF(idx + 1 > mHeight, "Invalid scanline %d, for image with height %d", idx, mHeight);
@@ -224,12 +302,30 @@ const u8 * Gimg::scanline(u32 idx) const
 
 void Gimg::convertFormat(Gimg ** pGimgOut, MemType memType, PixelFormat newPixelFormat) const
 {
-    Gimg *pGimg = Gimg::create(newPixelFormat, mWidth, mHeight, mReferencePathHash);
+    if (mPixelFormat == kPXL_RGBA8 && is_block_compressed(newPixelFormat))
+    {
+        Gimg * pGimg = Gimg::create(newPixelFormat, mWidth, mHeight, mReferencePathHash, mMipCount);
+        *pGimgOut = pGimg;
+        for (u32 level = 0; level < mMipCount; ++level)
+        {
+            block_compress(pGimg->mipPixels(level),
+                           newPixelFormat,
+                           mipPixels(level),
+                           mipWidth(level),
+                           mipHeight(level),
+                           0);
+        }
+        return;
+    }
+
+    PANIC_IF(mMipCount > 1 && mPixelFormat != newPixelFormat, "Only block compression conversions keep mip levels");
+
+    Gimg *pGimg = Gimg::create(newPixelFormat, mWidth, mHeight, mReferencePathHash, mMipCount);
     *pGimgOut = pGimg;
 
     if (mPixelFormat == newPixelFormat)
     {
-        memcpy(pGimg, this, size());
+        memcpy(pGimg->pixels(), pixels(), pixelsSize());
         return;
     }
 
@@ -418,5 +514,120 @@ void Gimg::clear(Color col)
     PANIC("Unsupported PixelFormat to clear: %d", mPixelFormat);
 }
 
+struct SrgbToLinearTable
+{
+    f32 vals[256];
+
+    SrgbToLinearTable()
+    {
+        for (u32 i = 0; i < 256; ++i)
+        {
+            f32 c = i / 255.0f;
+            vals[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+    }
+};
+
+static f32 srgb_to_linear(u8 val)
+{
+    static const SrgbToLinearTable sTable;
+    return sTable.vals[val];
+}
+
+static u8 linear_to_srgb(f32 val)
+{
+    val = val < 0.0f ? 0.0f : (val > 1.0f ? 1.0f : val);
+    f32 c = val <= 0.0031308f ? val * 12.92f : 1.055f * powf(val, 1.0f / 2.4f) - 0.055f;
+    return static_cast<u8>(c * 255.0f + 0.5f);
+}
+
+// Taps of a 2:1 reduction along one axis. Halving axes use a [1 3 3 1]
+// tent centered between the two source texels, clamped at the edges.
+static u32 mip_taps(u32 * pIdx, f32 * pWeight, u32 dst, u32 srcSize)
+{
+    if (srcSize == 1)
+    {
+        pIdx[0] = 0;
+        pWeight[0] = 1.0f;
+        return 1;
+    }
+
+    static const f32 kWeights[4] = { 1.0f / 8.0f, 3.0f / 8.0f, 3.0f / 8.0f, 1.0f / 8.0f };
+    i32 first = (i32)dst * 2 - 1;
+    for (u32 i = 0; i < 4; ++i)
+    {
+        i32 idx = first + (i32)i;
+        idx = idx < 0 ? 0 : (idx >= (i32)srcSize ? (i32)srcSize - 1 : idx);
+        pIdx[i] = (u32)idx;
+        pWeight[i] = kWeights[i];
+    }
+    return 4;
+}
+
+void Gimg::buildMipChain(Gimg ** pGimgOut, MemType memType) const
+{
+    PANIC_IF(mPixelFormat != kPXL_RGBA8, "Mip chains are built from RGBA8 images");
+
+    u32 mipCount = full_mip_count(mWidth, mHeight);
+    Gimg * pGimg = Gimg::create(mPixelFormat, mWidth, mHeight, mReferencePathHash, mipCount);
+    *pGimgOut = pGimg;
+
+    memcpy(pGimg->mipPixels(0), mipPixels(0), mipSize(0));
+
+    for (u32 level = 1; level < mipCount; ++level)
+    {
+        u32 srcW = pGimg->mipWidth(level - 1);
+        u32 srcH = pGimg->mipHeight(level - 1);
+        const u8 * pSrc = pGimg->mipPixels(level - 1);
+
+        u32 dstW = pGimg->mipWidth(level);
+        u32 dstH = pGimg->mipHeight(level);
+        u8 * pDst = pGimg->mipPixels(level);
+
+        for (u32 y = 0; y < dstH; ++y)
+        {
+            u32 rows[4];
+            f32 rowWeights[4];
+            u32 rowCount = mip_taps(rows, rowWeights, y, srcH);
+
+            for (u32 x = 0; x < dstW; ++x)
+            {
+                u32 cols[4];
+                f32 colWeights[4];
+                u32 colCount = mip_taps(cols, colWeights, x, srcW);
+
+                // Premultiplied, so color is weighted by coverage
+                f32 r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+                for (u32 j = 0; j < rowCount; ++j)
+                {
+                    const u8 * pRow = pSrc + (u64)rows[j] * srcW * 4;
+                    for (u32 i = 0; i < colCount; ++i)
+                    {
+                        const u8 * pPix = pRow + cols[i] * 4;
+                        f32 wa = rowWeights[j] * colWeights[i] * (pPix[3] / 255.0f);
+                        r += wa * srgb_to_linear(pPix[0]);
+                        g += wa * srgb_to_linear(pPix[1]);
+                        b += wa * srgb_to_linear(pPix[2]);
+                        a += wa;
+                    }
+                }
+
+                u8 * pOut = pDst + ((u64)y * dstW + x) * 4;
+                if (a > 0.0f)
+                {
+                    pOut[0] = linear_to_srgb(r / a);
+                    pOut[1] = linear_to_srgb(g / a);
+                    pOut[2] = linear_to_srgb(b / a);
+                }
+                else
+                {
+                    pOut[0] = pOut[1] = pOut[2] = 0;
+                }
+                pOut[3] = static_cast<u8>(a * 255.0f + 0.5f);
+            }
+        }
+    }
+}
+
 } // namespace gaen
 
@@ -54,6 +54,7 @@ enum PixelFormat
 const char * pixel_format_to_str(PixelFormat pixelFormat);
 const PixelFormat pixel_format_from_str(const char * str);
 u32 bytes_per_pixel(PixelFormat pixelFormat);
+bool is_block_compressed(PixelFormat pixelFormat);
 
 #pragma pack(push, 1)
 class Gimg : public AssetHeader4CC<FOURCC("gimg")>
@@ -63,19 +64,39 @@ public:
     static Gimg * instance(void * pBuffer, u64 size);
     static const Gimg * instance(const void * pBuffer, u64 size);
 
-    static u64 required_size(PixelFormat pixelFormat, u32 width, u32 height);
+    static u64 required_size(PixelFormat pixelFormat, u32 width, u32 height, u32 mipCount = 1);
+    // Bytes of a single mip level
+    static u64 level_size(PixelFormat pixelFormat, u32 width, u32 height);
+    // Number of levels in a chain down to 1x1
+    static u32 full_mip_count(u32 width, u32 height);
 
-    static void init(Gimg * pGimg, PixelFormat pixelFormat, u32 width, u32 height, u32 referencePathHash);
-    static Gimg * create(PixelFormat pixelFormat, u32 width, u32 height, u32 referencePathHash);
+    static void init(Gimg * pGimg, PixelFormat pixelFormat, u32 width, u32 height, u32 referencePathHash, u32 mipCount = 1);
+    static Gimg * create(PixelFormat pixelFormat, u32 width, u32 height, u32 referencePathHash, u32 mipCount = 1);
     static Gimg * create(u32 referencePathHash);
 
     u8 * pixels();
     const u8 * pixels() const;
+    // Size of every level's pixels, which follow each other from pixels()
+    u64 pixelsSize() const;
+
+    u32 mipCount() const { return mMipCount; }
+    u32 mipWidth(u32 level) const;
+    u32 mipHeight(u32 level) const;
+    u64 mipSize(u32 level) const;
+    u8 * mipPixels(u32 level);
+    const u8 * mipPixels(u32 level) const;
     u8 * scanline(u32 idx);
     const u8 * scanline(u32 idx) const;
 
+    // Converting to RGB_DXT1 or RGBA_DXT5 block compresses every mip
+    // level, see BlockCompress.h
     void convertFormat(Gimg ** pGimg, MemType memType, PixelFormat newPixelFormat) const;
 
+    // Copy of an RGBA8 image with a full mip chain. Each level is
+    // filtered from the one above in linear light with alpha weighting,
+    // so transparent texels don't bleed their color into the mips.
+    void buildMipChain(Gimg ** pGimg, MemType memType) const;
+
     void clear(Color col);
 
     u32 referencePathHash() const { return mReferencePathHash; }
@@ -96,10 +117,13 @@ private:
     u32 mHeight;
 
     u32 mReferencePathHash;
+
+    u32 mMipCount;
+    char PADDING__[12];
 };
 #pragma pack(pop)
 
-static_assert(sizeof(Gimg) == 32, "Gimg unexpected size");
+static_assert(sizeof(Gimg) == 48, "Gimg unexpected size");
 static_assert(sizeof(Gimg) % 16 == 0, "Gimg size not 16 byte aligned");
 
 } // namespace gaen
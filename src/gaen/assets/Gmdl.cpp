@@ -30,6 +30,7 @@
 
 #include "gaen/assets/file_utils.h"
 #include "gaen/assets/Gmdl.h"
+#include "gaen/assets/mesh_quantize.h"
 
 namespace gaen
 {
@@ -52,13 +53,17 @@ bool Gmdl::is_valid(const void * pBuffer, u64 size)
     if (!is_valid_prim_type(pAssetData->mPrimType))
         return false;
 
+    if (pAssetData->has32BitIndices() != uses_32bit_indices(pAssetData->mVertCount))
+        return false;
+
     u64 reqSize = required_size(pAssetData->vertType(),
                                 pAssetData->mVertCount,
                                 pAssetData->primType(),
                                 pAssetData->mPrimCount,
                                 pAssetData->mBoneCount,
                                 pAssetData->mHardpointCount,
-                                pAssetData->mat());
+                                pAssetData->mat(),
+                                pAssetData->mMeshletCount);
     if (reqSize != size)
         return false;
 
@@ -102,10 +107,11 @@ u64 Gmdl::required_size(VertType vertType,
                         u32 primCount,
                         u32 boneCount,
                         u32 hardpointCount,
-                        const Gmat * pMat)
+                        const Gmat * pMat,
+                        u32 meshletCount)
 {
     u32 vertStride = vert_stride(vertType);
-    u32 primStride = prim_stride(primType);
+    u32 primStride = prim_stride(primType) << uses_32bit_indices(vertCount);
 
     u32 matSize = pMat ? (u32)pMat->size() : 0;
     return (sizeof(Gmdl) +
@@ -113,6 +119,7 @@ u64 Gmdl::required_size(VertType vertType,
             size_aligned(primStride, primCount) +
             size_aligned(sizeof(Bone), boneCount) +
             size_aligned(sizeof(Hardpoint), hardpointCount) +
+            size_aligned(sizeof(Meshlet), meshletCount) +
             matSize);
 }
 
@@ -123,7 +130,8 @@ Gmdl * Gmdl::create(VertType vertType,
                     u32 shaderHash,
                     u32 boneCount,
                     u32 hardpointCount,
-                    const Gmat * pMat)
+                    const Gmat * pMat,
+                    u32 meshletCount)
 {
     u64 size = Gmdl::required_size(vertType,
                                    vertCount,
@@ -131,7 +139,8 @@ Gmdl * Gmdl::create(VertType vertType,
                                    primCount,
                                    boneCount,
                                    hardpointCount,
-                                   pMat);
+                                   pMat,
+                                   meshletCount);
 
     Gmdl * pGmdl = alloc_asset<Gmdl>(kMEM_Model, size);
 
@@ -139,7 +148,7 @@ Gmdl * Gmdl::create(VertType vertType,
     PANIC_IF(!is_valid_prim_type(primType), "Invalid primTYpe, %d", primType);
 
     u32 vertStride = vert_stride(vertType);
-    u32 primStride = prim_stride(primType);
+    u32 primStride = prim_stride(primType) << uses_32bit_indices(vertCount);
 
     pGmdl->mVertType = vertType;
     pGmdl->mPrimType = primType;
@@ -151,10 +160,17 @@ Gmdl * Gmdl::create(VertType vertType,
     pGmdl->mBoneOffset = pGmdl->primOffset() + size_aligned(primStride, primCount);
     pGmdl->mHardpointCount = hardpointCount;
     pGmdl->mHardpointOffset = pGmdl->boneOffset() + size_aligned(sizeof(Bone), boneCount);
-    pGmdl->mMatOffset = pMat ? pGmdl->hardpointOffset() + size_aligned(sizeof(Hardpoint), hardpointCount) : 0;
+    pGmdl->mMeshletCount = meshletCount;
+    pGmdl->mMeshletOffset = pGmdl->hardpointOffset() + size_aligned(sizeof(Hardpoint), hardpointCount);
+    pGmdl->mMatOffset = pMat ? pGmdl->meshletOffset() + size_aligned(sizeof(Meshlet), meshletCount) : 0;
 
-    pGmdl->mHas32BitIndices = 0;
+    pGmdl->mHas32BitIndices = uses_32bit_indices(vertCount);
     pGmdl->mMorphTargetCount = 0; // no targets, just one set of verts
+    pGmdl->mHasHalfUvs = 0;
+    pGmdl->RESERVED_0 = 0;
+
+    pGmdl->mPosBias = vec3(0.0f);
+    pGmdl->mPosScale = vec3(1.0f);
 
     if (pMat)
     {
@@ -169,16 +185,14 @@ Gmdl * Gmdl::convert_to_points(const Gmdl * pGmdl)
     Set<kMEM_Model, vec3> pointsSet; // use to de-dupe
     List<kMEM_Model, vec3> points;   // used to preserve original order
 
-    const u8 * pVerts = (const u8*)pGmdl->verts();
     for (u32 i = 0; i < pGmdl->vertCount(); ++i)
     {
-        const VertPos * pVert = (const VertPos*)pVerts;
-        if (pointsSet.find(pVert->position) == pointsSet.end())
+        vec3 position = pGmdl->vertPosition(i);
+        if (pointsSet.find(position) == pointsSet.end())
         {
-            pointsSet.insert(pVert->position);
-            points.push_back(pVert->position);
+            pointsSet.insert(position);
+            points.push_back(position);
         }
-        pVerts += pGmdl->vertStride();
     }
     Gmdl * pGmdlPoints = Gmdl::create(kVERT_Pos, (u32)points.size(), kPRIM_Point, 0, 0);
     VertPos * pVertNew = (VertPos*)pGmdlPoints->verts();
@@ -242,8 +256,9 @@ const Hardpoint * Gmdl::hardpointByName(u32 nameHash) const
 
 void Gmdl::compact(u32 newVertCount, u32 newPrimCount)
 {
-    ASSERT(mBoneCount == 0 && mHardpointCount == 0); // shouldn't ever need to support these in compact, but sanity checking here
+    ASSERT(mBoneCount == 0 && mHardpointCount == 0 && mMeshletCount == 0); // shouldn't ever need to support these in compact, but sanity checking here
     ASSERT(newVertCount < mVertCount);
+    ASSERT(uses_32bit_indices(newVertCount) == has32BitIndices()); // prims are moved, not rewritten
     ASSERT(newPrimCount < mPrimCount);
 
     // Get current start of prims before we muck up our counts, etc.
@@ -251,7 +266,7 @@ void Gmdl::compact(u32 newVertCount, u32 newPrimCount)
     Gmat * oldMat = mat();
 
     u32 vertStride = vert_stride((VertType)mVertType);
-    u32 primStride = prim_stride((PrimType)mPrimType);
+    u32 primStride = prim_stride((PrimType)mPrimType) << mHas32BitIndices;
 
     mSize = required_size((VertType)mVertType, newVertCount, (PrimType)mPrimType, newPrimCount, 0, 0, oldMat);;
     mVertCount = newVertCount;
@@ -279,20 +294,26 @@ void Gmdl::updateHalfExtents()
     vec3 maxPos = vec3(std::numeric_limits<f32>::lowest());
     vec3 minPos = vec3(std::numeric_limits<f32>::max());
 
-    const u8 * pVert = reinterpret_cast<const u8*>(verts());
     for (u32 i = 0; i < vertCount(); ++i)
     {
-        const vec3 * pPos = reinterpret_cast<const vec3*>(pVert);
-
-        maxPos = max(maxPos, *pPos);
-        minPos = min(minPos, *pPos);
+        vec3 pos = vertPosition(i);
 
-        pVert += vertStride();
+        maxPos = max(maxPos, pos);
+        minPos = min(minPos, pos);
     }
 
     mHalfExtents = max(abs(minPos), abs(maxPos));
 }
 
+vec3 Gmdl::vertPosition(u32 idx) const
+{
+    ASSERT(idx < mVertCount);
+    const u8 * pVert = reinterpret_cast<const u8*>(verts()) + (u64)idx * vertStride();
+    if (isQuantized())
+        return dequantize_position(reinterpret_cast<const i16*>(pVert), mPosBias, mPosScale);
+    return *reinterpret_cast<const vec3*>(pVert);
+}
+
 const Bone * Gmdl::findBone(u32 nameHash) const
 {
     const Bone * pBone = bones();
@@ -27,6 +27,8 @@
 #ifndef GAEN_ASSETS_GMDL_H
 #define GAEN_ASSETS_GMDL_H
 
+#include <cstddef>
+
 #include "gaen/core/base_defines.h"
 #include "gaen/core/mem.h"
 
@@ -55,6 +57,11 @@ enum VertType
     kVERT_PosNormUvTan      = 6,
     kVERT_PosNormUvTanBones = 7,
 
+    // Quantized for the gpu, see mesh_quantize.h
+    kVERT_PosNormColQ       = 8,
+    kVERT_PosNormUvQ        = 9,
+    kVERT_PosNormUvBoneQ    = 10,
+
     kVERT_END
 };
 
@@ -129,6 +136,37 @@ struct VertPosNormUvTanBones
     uvec4 boneIds;
     vec4 boneWeights;
 };
+
+// Quantized verts. Positions are snorm16 within the Gmdl's position
+// bounds, normals are octahedral snorm16 pairs and uvs are unorm16,
+// or half floats when Gmdl::hasHalfUvs.
+struct VertPosNormColQ
+{
+    static const VertType kVertType = kVERT_PosNormColQ;
+    i16 position[3];
+    char PADDING__[2];
+    i16 normal[2];
+    Color color;
+};
+
+struct VertPosNormUvQ
+{
+    static const VertType kVertType = kVERT_PosNormUvQ;
+    i16 position[3];
+    char PADDING__[2];
+    i16 normal[2];
+    u16 uv[2];
+};
+
+struct VertPosNormUvBoneQ
+{
+    static const VertType kVertType = kVERT_PosNormUvBoneQ;
+    i16 position[3];
+    char PADDING__[2];
+    i16 normal[2];
+    u16 uv[2];
+    u32 boneId;
+};
 #pragma pack(pop)
 
 const u32 kOffsetPosition = 0;
@@ -142,6 +180,11 @@ inline bool is_valid_vert_type(u32 vertType)
     return vertType >= kVERT_Pos && vertType < kVERT_END;
 }
 
+inline bool is_quantized_vert_type(u32 vertType)
+{
+    return vertType >= kVERT_PosNormColQ && vertType <= kVERT_PosNormUvBoneQ;
+}
+
 inline bool is_valid_prim_type(u32 primType)
 {
     return primType >= kPRIM_Point && primType < kPRIM_END;
@@ -230,6 +273,12 @@ inline u32 vert_stride(VertType vertType)
         return sizeof(VertPosNormUvTan);
     case kVERT_PosNormUvTanBones:
         return sizeof(VertPosNormUvTanBones);
+    case kVERT_PosNormColQ:
+        return sizeof(VertPosNormColQ);
+    case kVERT_PosNormUvQ:
+        return sizeof(VertPosNormUvQ);
+    case kVERT_PosNormUvBoneQ:
+        return sizeof(VertPosNormUvBoneQ);
     default:
         PANIC("Invalid VertexType: %d", vertType);
         return 0;
@@ -283,8 +332,23 @@ struct Bone
     mat43 transform;
 };
 typedef Bone Hardpoint; // exact same structure
+
+// A run of triangles in the prim array touching few enough verts to
+// stay in the post-transform cache, bounded by a sphere for culling.
+struct Meshlet
+{
+    u32 primOffset; // first triangle
+    u32 primCount;
+    u32 vertCount;  // distinct verts referenced
+    char PADDING__[4];
+    vec3 center;
+    f32 radius;
+};
 #pragma pack(pop)
 
+const u32 kMeshletMaxVerts = 64;
+const u32 kMeshletMaxTris  = 124;
+
 //-------------------------------------------
 // Comparison operators for Polygon and Line
 //-------------------------------------------
@@ -385,6 +449,10 @@ class Gmdl : public AssetHeader4CC<FOURCC("gmdl")>
 public:
     static const u32 kRendererReservedCount = 4;
 
+    // 16 bit indices reach this many verts, larger meshes use 32 bit
+    static const u32 kMax16BitVertCount = 65536;
+    static bool uses_32bit_indices(u32 vertCount) { return vertCount > kMax16BitVertCount; }
+
     static bool is_valid(const void * pBuffer, u64 size);
     static Gmdl * instance(void * pBuffer, u64 size);
     static const Gmdl * instance(const void * pBuffer, u64 size);
@@ -395,7 +463,8 @@ public:
                              u32 primCount,
                              u32 boneCount,
                              u32 hardpointCount,
-                             const Gmat * pMat);
+                             const Gmat * pMat,
+                             u32 meshletCount = 0);
 
     static Gmdl * create(VertType vertType,
                          u32 vertCount,
@@ -404,7 +473,8 @@ public:
                          u32 shaderHash,
                          u32 boneCount = 0,
                          u32 hardpointCount = 0,
-                         const Gmat * pMat = nullptr);
+                         const Gmat * pMat = nullptr,
+                         u32 meshletCount = 0);
 
     static Gmdl * convert_to_points(const Gmdl * pGmdl);
 
@@ -424,6 +494,11 @@ public:
     u32 indexCount() const { return mPrimCount * index_count(primType()); }
     u32 boneCount() const { return mBoneCount; }
     u32 hardpointCount() const { return mHardpointCount; }
+    u32 meshletCount() const { return mMeshletCount; }
+    bool has32BitIndices() const { return mHas32BitIndices != 0; }
+    bool isQuantized() const { return is_quantized_vert_type(mVertType); }
+    bool hasHalfUvs() const { return mHasHalfUvs != 0; }
+    void setHasHalfUvs(bool hasHalfUvs) { mHasHalfUvs = hasHalfUvs ? 1 : 0; }
 
     vec3 & halfExtents() { return mHalfExtents; }
     const vec3 & halfExtents() const { return mHalfExtents; }
@@ -431,6 +506,16 @@ public:
     const vec3 & center() const { return mCenter; }
     void updateHalfExtents();
 
+    // Quantized positions decode to posBias + posScale * snorm, other
+    // vert types keep a bias of 0 and scale of 1.
+    vec3 & posBias() { return mPosBias; }
+    const vec3 & posBias() const { return mPosBias; }
+    vec3 & posScale() { return mPosScale; }
+    const vec3 & posScale() const { return mPosScale; }
+
+    // Position of vert idx in mesh space, decoded if quantized
+    vec3 vertPosition(u32 idx) const;
+
     const Bone * findBone(u32 nameHash) const;
     const Hardpoint * findHardpoint(u32 nameHash) const;
 
@@ -454,6 +539,33 @@ public:
         return const_cast<Gmdl*>(this)->prims();
     }
 
+    u32 * prims32()
+    {
+        ASSERT(mHas32BitIndices);
+        return reinterpret_cast<u32*>(reinterpret_cast<u8*>(this) + primOffset());
+    }
+
+    const u32 * prims32() const
+    {
+        return const_cast<Gmdl*>(this)->prims32();
+    }
+
+    // Index idx of the prim array, whichever width it is stored at
+    u32 primIndex(u32 idx) const
+    {
+        ASSERT(idx < indexCount());
+        return mHas32BitIndices ? prims32()[idx] : prims()[idx];
+    }
+
+    void setPrimIndex(u32 idx, u32 vertIdx)
+    {
+        ASSERT(idx < indexCount() && vertIdx < mVertCount);
+        if (mHas32BitIndices)
+            prims32()[idx] = vertIdx;
+        else
+            prims()[idx] = static_cast<index>(vertIdx);
+    }
+
     Bone * bones()
     {
         if (mBoneCount > 0)
@@ -478,6 +590,18 @@ public:
         return const_cast<Gmdl*>(this)->hardpoints();
     }
 
+    Meshlet * meshlets()
+    {
+        if (mMeshletCount > 0)
+            return reinterpret_cast<Meshlet*>(reinterpret_cast<u8*>(this) + meshletOffset());
+        return nullptr;
+    }
+
+    const Meshlet * meshlets() const
+    {
+        return const_cast<Gmdl*>(this)->meshlets();
+    }
+
     Gmat * mat()
     {
         if (matOffset())
@@ -515,6 +639,11 @@ public:
         return mHardpointOffset;
     }
 
+    u32 meshletOffset() const
+    {
+        return mMeshletOffset;
+    }
+
     u32 matOffset() const
     {
         return mMatOffset;
@@ -562,6 +691,11 @@ public:
         return size_aligned(hardpointStride(), hardpointCount());
     }
 
+    u32 meshletsSize() const
+    {
+        return size_aligned(sizeof(Meshlet), meshletCount());
+    }
+
     u32 matSize() const
     {
         if (mat())
@@ -571,7 +705,7 @@ public:
 
     u32 totalSize() const
     {
-        return sizeof(Gmdl) + vertsSize() + primsSize() + bonesSize() + hardpointsSize() + matSize();
+        return sizeof(Gmdl) + vertsSize() + primsSize() + bonesSize() + hardpointsSize() + meshletsSize() + matSize();
     }
 
     bool hasVertPosition() const
@@ -591,42 +725,44 @@ public:
 
     u32 vertNormalOffset() const
     {
-        return sizeof(VertPos);
+        return isQuantized() ? offsetof(VertPosNormUvQ, normal) : sizeof(VertPos);
     }
 
     bool hasVertColor() const
     {
-        return (mVertType == kVERT_PosNormCol);
+        return (mVertType == kVERT_PosNormCol || mVertType == kVERT_PosNormColQ);
     }
 
     u32 vertColorOffset() const
     {
-        return sizeof(VertPosNorm);
+        return isQuantized() ? offsetof(VertPosNormColQ, color) : sizeof(VertPosNorm);
     }
 
     bool hasVertUv() const
     {
-        return (mVertType >= kVERT_PosNormUv);
+        return ((mVertType >= kVERT_PosNormUv && mVertType <= kVERT_PosNormUvTanBones) ||
+                mVertType == kVERT_PosNormUvQ ||
+                mVertType == kVERT_PosNormUvBoneQ);
     }
 
     u32 vertUvOffset() const
     {
-        return sizeof(VertPosNorm);
+        return isQuantized() ? offsetof(VertPosNormUvQ, uv) : sizeof(VertPosNorm);
     }
 
     bool hasVertBone() const
     {
-        return (mVertType == kVERT_PosNormUvBone);
+        return (mVertType == kVERT_PosNormUvBone || mVertType == kVERT_PosNormUvBoneQ);
     }
 
     u32 vertBoneOffset() const
     {
-        return sizeof(VertPosNormUv);
+        return isQuantized() ? offsetof(VertPosNormUvBoneQ, boneId) : sizeof(VertPosNormUv);
     }
 
     bool hasVertTan() const
     {
-        return (mVertType >= kVERT_PosNormUvTan);
+        return (mVertType == kVERT_PosNormUvTan || mVertType == kVERT_PosNormUvTanBones);
     }
 
     u32 vertTanOffset() const
@@ -725,35 +861,65 @@ public:
         ASSERT(mVertType == kVERT_PosNormUvTanBones);
         return reinterpret_cast<const VertPosNormUvTanBones*>(verts());
     }
+    operator VertPosNormColQ*()
+    {
+        ASSERT(mVertType == kVERT_PosNormColQ);
+        return reinterpret_cast<VertPosNormColQ*>(verts());
+    }
+    operator const VertPosNormColQ*() const
+    {
+        ASSERT(mVertType == kVERT_PosNormColQ);
+        return reinterpret_cast<const VertPosNormColQ*>(verts());
+    }
+    operator VertPosNormUvQ*()
+    {
+        ASSERT(mVertType == kVERT_PosNormUvQ);
+        return reinterpret_cast<VertPosNormUvQ*>(verts());
+    }
+    operator const VertPosNormUvQ*() const
+    {
+        ASSERT(mVertType == kVERT_PosNormUvQ);
+        return reinterpret_cast<const VertPosNormUvQ*>(verts());
+    }
+    operator VertPosNormUvBoneQ*()
+    {
+        ASSERT(mVertType == kVERT_PosNormUvBoneQ);
+        return reinterpret_cast<VertPosNormUvBoneQ*>(verts());
+    }
+    operator const VertPosNormUvBoneQ*() const
+    {
+        ASSERT(mVertType == kVERT_PosNormUvBoneQ);
+        return reinterpret_cast<const VertPosNormUvBoneQ*>(verts());
+    }
 
     operator PrimPoint*()
     {
-        ASSERT(mPrimType == kPRIM_Point);
+        ASSERT(mPrimType == kPRIM_Point && !mHas32BitIndices);
         return reinterpret_cast<PrimPoint*>(prims());
     }
     operator const PrimPoint*() const
     {
-        ASSERT(mPrimType == kPRIM_Point);
+        ASSERT(mPrimType == kPRIM_Point && !mHas32BitIndices);
         return reinterpret_cast<const PrimPoint*>(prims());
     }
     operator PrimLine*()
     {
-        ASSERT(mPrimType == kPRIM_Line);
+        ASSERT(mPrimType == kPRIM_Line && !mHas32BitIndices);
         return reinterpret_cast<PrimLine*>(prims());
     }
     operator const PrimLine*() const
     {
-        ASSERT(mPrimType == kPRIM_Line);
+        ASSERT(mPrimType == kPRIM_Line && !mHas32BitIndices);
         return reinterpret_cast<const PrimLine*>(prims());
     }
     operator PrimTriangle*()
     {
-        ASSERT(mPrimType == kPRIM_Triangle);
+        ASSERT(mPrimType == kPRIM_Triangle && !mHas32BitIndices);
         return reinterpret_cast<PrimTriangle*>(prims());
     }
     operator const PrimTriangle*() const
     {
-        ASSERT(mPrimType == kPRIM_Triangle);
+        ASSERT(mPrimType == kPRIM_Triangle && !mHas32BitIndices);
         return reinterpret_cast<const PrimTriangle*>(prims());
     }
     //--------------------------------------------------------------------------
@@ -775,17 +941,20 @@ private:
     u32 mPrimType:8;
     u32 mHas32BitIndices:1;
     u32 mMorphTargetCount:7;
-    u32 RESERVED_0:8;
+    u32 mHasHalfUvs:1;
+    u32 RESERVED_0:7;
 
     u32 mVertCount;
     u32 mPrimCount;
     u32 mBoneCount;
     u32 mHardpointCount;
+    u32 mMeshletCount;
 
     // VertOffset is sizeof(Gmdl), they start immediately after the header
     u32 mPrimOffset;  // offset from start of struct
     u32 mBoneOffset;
     u32 mHardpointOffset;
+    u32 mMeshletOffset;
     u32 mMatOffset;
 
     u32 mShaderHash;
@@ -793,6 +962,8 @@ private:
     vec3 mHalfExtents;
     vec3 mCenter;
 
+    vec3 mPosBias;
+    vec3 mPosScale;
 };
 #pragma pack(pop)
 
@@ -802,10 +973,14 @@ static_assert(sizeof(VertPosNorm) == 24,      "VertPosNorm geometry struct has u
 static_assert(sizeof(VertPosNormCol) == 28,   "VertPosNormCol geometry struct has unexpected size");
 static_assert(sizeof(VertPosNormUv) == 32,    "VertPosNormUv geometry struct has unexpected size");
 static_assert(sizeof(VertPosNormUvTan) == 48, "VertPosNormUvTan geometry struct has unexpected size");
+static_assert(sizeof(VertPosNormColQ) == 16,  "VertPosNormColQ geometry struct has unexpected size");
+static_assert(sizeof(VertPosNormUvQ) == 16,   "VertPosNormUvQ geometry struct has unexpected size");
+static_assert(sizeof(VertPosNormUvBoneQ) == 20, "VertPosNormUvBoneQ geometry struct has unexpected size");
 static_assert(sizeof(PrimPoint) == 2,         "PrimLine geometry struct has unexpected size");
 static_assert(sizeof(PrimLine) == 4,          "PrimLine geometry struct has unexpected size");
 static_assert(sizeof(PrimTriangle) == 6,      "PrimTriangle geometry struct has unexpected size");
-static_assert(sizeof(Gmdl) == 80,             "Gmdl has unexpected size");
+static_assert(sizeof(Meshlet) == 32,          "Meshlet struct has unexpected size");
+static_assert(sizeof(Gmdl) == 112,            "Gmdl has unexpected size");
 static_assert(sizeof(Gmdl) % 16 == 0,         "Gmdl size not 16 byte aligned");
 
 } // namespace gaen
@@ -0,0 +1,394 @@
+//------------------------------------------------------------------------------
+// mesh_optimize.cpp - Vertex cache ordering and meshlets for triangle meshes
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <cmath>
+#include <limits>
+
+#include "gaen/math/common.h"
+
+#include "gaen/assets/mesh_optimize.h"
+
+namespace gaen
+{
+
+static const u32 kNoTri = 0xffffffff;
+
+// Forsyth's scoring, the 3 verts of the last triangle get a fixed
+// score so the next triangle doesn't just pick one of them.
+static const f32 kLastTriScore = 0.75f;
+static const f32 kCacheDecayPower = 1.5f;
+static const f32 kValenceBoostScale = 2.0f;
+static const f32 kValenceBoostPower = 0.5f;
+static const u32 kValenceTableSize = 64;
+
+namespace
+{
+
+struct ForsythTables
+{
+    f32 cache[kVertexCacheSize];
+    f32 valence[kValenceTableSize];
+
+    ForsythTables()
+    {
+        for (u32 i = 0; i < kVertexCacheSize; ++i)
+        {
+            if (i < 3)
+                cache[i] = kLastTriScore;
+            else
+                cache[i] = powf(1.0f - (f32)(i - 3) / (kVertexCacheSize - 3), kCacheDecayPower);
+        }
+        valence[0] = 0.0f;
+        for (u32 i = 1; i < kValenceTableSize; ++i)
+            valence[i] = kValenceBoostScale * powf((f32)i, -kValenceBoostPower);
+    }
+};
+
+} // namespace
+
+static f32 vert_score(const ForsythTables & tables, i32 cachePos, u32 liveTris)
+{
+    // Verts with nothing left to draw don't attract anything
+    if (liveTris == 0)
+        return -1.0f;
+
+    f32 score = cachePos >= 0 ? tables.cache[cachePos] : 0.0f;
+    if (liveTris < kValenceTableSize)
+        score += tables.valence[liveTris];
+    else
+        score += kValenceBoostScale * powf((f32)liveTris, -kValenceBoostPower);
+    return score;
+}
+
+void optimize_vertex_cache(u32 * pIndices, u32 triCount, u32 vertCount)
+{
+    static const ForsythTables kTables;
+
+    if (triCount == 0)
+        return;
+
+    // Triangles using each vert, the first liveTris[v] of each list
+    // are the ones not yet emitted.
+    Vector<kMEM_Model, u32> liveTris(vertCount, 0);
+    for (u32 i = 0; i < triCount * 3; ++i)
+        liveTris[pIndices[i]]++;
+
+    Vector<kMEM_Model, u32> adjStart(vertCount + 1, 0);
+    for (u32 v = 0; v < vertCount; ++v)
+        adjStart[v + 1] = adjStart[v] + liveTris[v];
+
+    Vector<kMEM_Model, u32> adj(triCount * 3);
+    {
+        Vector<kMEM_Model, u32> cursor(adjStart.begin(), adjStart.end() - 1);
+        for (u32 i = 0; i < triCount * 3; ++i)
+            adj[cursor[pIndices[i]]++] = i / 3;
+    }
+
+    Vector<kMEM_Model, i32> cachePos(vertCount, -1);
+    Vector<kMEM_Model, f32> vertScores(vertCount);
+    for (u32 v = 0; v < vertCount; ++v)
+        vertScores[v] = vert_score(kTables, -1, liveTris[v]);
+
+    Vector<kMEM_Model, f32> triScores(triCount);
+    Vector<kMEM_Model, u8> isEmitted(triCount, 0);
+    u32 bestTri = 0;
+    for (u32 t = 0; t < triCount; ++t)
+    {
+        const u32 * pTri = pIndices + t * 3;
+        triScores[t] = vertScores[pTri[0]] + vertScores[pTri[1]] + vertScores[pTri[2]];
+        if (triScores[t] > triScores[bestTri])
+            bestTri = t;
+    }
+
+    Vector<kMEM_Model, u32> out(triCount * 3);
+    u32 cache[kVertexCacheSize + 3];
+    u32 cacheCount = 0;
+    u32 scanCursor = 0;
+
+    for (u32 emitted = 0; emitted < triCount; ++emitted)
+    {
+        // Nothing in the cache touches a live triangle, restart from
+        // the next one in the original order
+        if (bestTri == kNoTri)
+        {
+            while (isEmitted[scanCursor])
+                ++scanCursor;
+            bestTri = scanCursor;
+        }
+
+        const u32 * pTri = pIndices + bestTri * 3;
+        memcpy(&out[emitted * 3], pTri, sizeof(u32) * 3);
+        isEmitted[bestTri] = 1;
+
+        // Drop the triangle from its verts' live lists
+        for (u32 k = 0; k < 3; ++k)
+        {
+            u32 v = pTri[k];
+            u32 * pList = &adj[adjStart[v]];
+            for (u32 i = 0; i < liveTris[v]; ++i)
+            {
+                if (pList[i] == bestTri)
+                {
+                    pList[i] = pList[liveTris[v] - 1];
+                    pList[liveTris[v] - 1] = bestTri;
+                    liveTris[v]--;
+                    break;
+                }
+            }
+        }
+
+        // Triangle's verts move to the front of the LRU cache
+        u32 newCache[kVertexCacheSize + 3];
+        u32 newCount = 0;
+        for (u32 k = 0; k < 3; ++k)
+        {
+            if ((k < 1 || pTri[k] != pTri[0]) && (k < 2 || pTri[k] != pTri[1]))
+                newCache[newCount++] = pTri[k];
+        }
+        for (u32 i = 0; i < cacheCount; ++i)
+        {
+            u32 v = cache[i];
+            if (v != pTri[0] && v != pTri[1] && v != pTri[2])
+                newCache[newCount++] = v;
+        }
+
+        for (u32 i = 0; i < newCount; ++i)
+        {
+            u32 v = newCache[i];
+            cachePos[v] = i < kVertexCacheSize ? (i32)i : -1;
+            vertScores[v] = vert_score(kTables, cachePos[v], liveTris[v]);
+        }
+
+        // Rescore the triangles around everything that moved, the
+        // best of them goes next
+        bestTri = kNoTri;
+        f32 bestScore = -1.0f;
+        for (u32 i = 0; i < newCount; ++i)
+        {
+            u32 v = newCache[i];
+            const u32 * pList = &adj[adjStart[v]];
+            for (u32 j = 0; j < liveTris[v]; ++j)
+            {
+                u32 t = pList[j];
+                const u32 * pT = pIndices + t * 3;
+                triScores[t] = vertScores[pT[0]] + vertScores[pT[1]] + vertScores[pT[2]];
+                if (triScores[t] > bestScore)
+                {
+                    bestScore = triScores[t];
+                    bestTri = t;
+                }
+            }
+        }
+
+        cacheCount = newCount < kVertexCacheSize ? newCount : kVertexCacheSize;
+        memcpy(cache, newCache, sizeof(u32) * cacheCount);
+    }
+
+    memcpy(pIndices, out.data(), sizeof(u32) * triCount * 3);
+}
+
+u32 optimize_vertex_fetch(u32 * pRemap, u32 * pIndices, u32 triCount, u32 vertCount)
+{
+    for (u32 v = 0; v < vertCount; ++v)
+        pRemap[v] = kUnusedVert;
+
+    u32 nextVert = 0;
+    for (u32 i = 0; i < triCount * 3; ++i)
+    {
+        u32 & remapped = pRemap[pIndices[i]];
+        if (remapped == kUnusedVert)
+            remapped = nextVert++;
+        pIndices[i] = remapped;
+    }
+    return nextVert;
+}
+
+f32 average_cache_miss_ratio(const u32 * pIndices, u32 triCount, u32 vertCount, u32 cacheSize)
+{
+    if (triCount == 0)
+        return 0.0f;
+
+    // A vert is still cached while fewer than cacheSize misses have
+    // happened since it went in
+    Vector<kMEM_Model, u32> insertedAt(vertCount, 0);
+    u32 clock = cacheSize + 1;
+    u32 misses = 0;
+    for (u32 i = 0; i < triCount * 3; ++i)
+    {
+        u32 v = pIndices[i];
+        if (clock - insertedAt[v] > cacheSize)
+        {
+            insertedAt[v] = clock++;
+            misses++;
+        }
+    }
+    return (f32)misses / triCount;
+}
+
+static void meshlet_bounds(Meshlet & meshlet, const u32 * pIndices, const u8 * pVerts, u32 vertStride)
+{
+    vec3 mins(std::numeric_limits<f32>::max());
+    vec3 maxes(std::numeric_limits<f32>::lowest());
+    const u32 * pTris = pIndices + meshlet.primOffset * 3;
+    for (u32 i = 0; i < meshlet.primCount * 3; ++i)
+    {
+        const vec3 & pos = *reinterpret_cast<const vec3*>(pVerts + (u64)pTris[i] * vertStride);
+        mins = min(mins, pos);
+        maxes = max(maxes, pos);
+    }
+
+    meshlet.center = (mins + maxes) * 0.5f;
+    f32 radiusSq = 0.0f;
+    for (u32 i = 0; i < meshlet.primCount * 3; ++i)
+    {
+        vec3 d = *reinterpret_cast<const vec3*>(pVerts + (u64)pTris[i] * vertStride) - meshlet.center;
+        radiusSq = max(radiusSq, dot(d, d));
+    }
+    meshlet.radius = sqrtf(radiusSq);
+}
+
+void build_meshlets(Vector<kMEM_Model, Meshlet> & meshlets,
+                    const u32 * pIndices,
+                    u32 triCount,
+                    const u8 * pVerts,
+                    u32 vertStride,
+                    u32 vertCount)
+{
+    meshlets.clear();
+    if (triCount == 0)
+        return;
+
+    // Meshlet index + 1 each vert was last counted in
+    Vector<kMEM_Model, u32> seenIn(vertCount, 0);
+
+    Meshlet meshlet;
+    memset(&meshlet, 0, sizeof(meshlet));
+    for (u32 t = 0; t < triCount; ++t)
+    {
+        const u32 * pTri = pIndices + t * 3;
+        u32 stamp = static_cast<u32>(meshlets.size()) + 1;
+        u32 newVerts = 0;
+        for (u32 k = 0; k < 3; ++k)
+        {
+            bool repeat = (k > 0 && pTri[k] == pTri[0]) || (k > 1 && pTri[k] == pTri[1]);
+            if (!repeat && seenIn[pTri[k]] != stamp)
+                newVerts++;
+        }
+
+        if (meshlet.primCount == kMeshletMaxTris || meshlet.vertCount + newVerts > kMeshletMaxVerts)
+        {
+            meshlet_bounds(meshlet, pIndices, pVerts, vertStride);
+            meshlets.push_back(meshlet);
+            memset(&meshlet, 0, sizeof(meshlet));
+            meshlet.primOffset = t;
+
+            stamp++;
+            newVerts = 0;
+            for (u32 k = 0; k < 3; ++k)
+            {
+                bool repeat = (k > 0 && pTri[k] == pTri[0]) || (k > 1 && pTri[k] == pTri[1]);
+                if (!repeat)
+                    newVerts++;
+            }
+        }
+
+        for (u32 k = 0; k < 3; ++k)
+            seenIn[pTri[k]] = stamp;
+        meshlet.vertCount += newVerts;
+        meshlet.primCount++;
+    }
+
+    meshlet_bounds(meshlet, pIndices, pVerts, vertStride);
+    meshlets.push_back(meshlet);
+}
+
+Gmdl * optimize_gmdl(const Gmdl * pGmdl, bool buildMeshlets)
+{
+    PANIC_IF(pGmdl->primType() != kPRIM_Triangle, "Only triangle meshes can be optimized");
+    PANIC_IF(pGmdl->vertStride() != vert_stride(pGmdl->vertType()), "Morph targets aren't supported by mesh optimization");
+    PANIC_IF(pGmdl->isQuantized(), "Meshes must be optimized before they are quantized");
+
+    Vector<kMEM_Model, u32> indices;
+    indices.reserve(pGmdl->indexCount());
+    for (u32 t = 0; t < pGmdl->primCount(); ++t)
+    {
+        u32 p0 = pGmdl->primIndex(t * 3 + 0);
+        u32 p1 = pGmdl->primIndex(t * 3 + 1);
+        u32 p2 = pGmdl->primIndex(t * 3 + 2);
+        if (p0 == p1 || p1 == p2 || p2 == p0)
+            continue;
+        indices.push_back(p0);
+        indices.push_back(p1);
+        indices.push_back(p2);
+    }
+    u32 triCount = static_cast<u32>(indices.size() / 3);
+
+    optimize_vertex_cache(indices.data(), triCount, pGmdl->vertCount());
+
+    Vector<kMEM_Model, u32> remap(pGmdl->vertCount());
+    u32 vertCount = optimize_vertex_fetch(remap.data(), indices.data(), triCount, pGmdl->vertCount());
+
+    Vector<kMEM_Model, u8> verts((u64)vertCount * pGmdl->vertStride());
+    const u8 * pOldVerts = reinterpret_cast<const u8*>(pGmdl->verts());
+    for (u32 v = 0; v < pGmdl->vertCount(); ++v)
+    {
+        if (remap[v] != kUnusedVert)
+            memcpy(&verts[(u64)remap[v] * pGmdl->vertStride()], pOldVerts + (u64)v * pGmdl->vertStride(), pGmdl->vertStride());
+    }
+
+    Vector<kMEM_Model, Meshlet> meshlets;
+    if (buildMeshlets)
+        build_meshlets(meshlets, indices.data(), triCount, verts.data(), pGmdl->vertStride(), vertCount);
+
+    Gmdl * pOpt = Gmdl::create(pGmdl->vertType(),
+                               vertCount,
+                               kPRIM_Triangle,
+                               triCount,
+                               pGmdl->shaderHash(),
+                               pGmdl->boneCount(),
+                               pGmdl->hardpointCount(),
+                               pGmdl->mat(),
+                               static_cast<u32>(meshlets.size()));
+
+    memcpy(pOpt->verts(), verts.data(), verts.size());
+    for (u32 i = 0; i < indices.size(); ++i)
+        pOpt->setPrimIndex(i, indices[i]);
+    if (pGmdl->boneCount() > 0)
+        memcpy(pOpt->bones(), pGmdl->bones(), pGmdl->bonesSize());
+    if (pGmdl->hardpointCount() > 0)
+        memcpy(pOpt->hardpoints(), pGmdl->hardpoints(), pGmdl->hardpointsSize());
+    if (meshlets.size() > 0)
+        memcpy(pOpt->meshlets(), meshlets.data(), sizeof(Meshlet) * meshlets.size());
+
+    pOpt->center() = pGmdl->center();
+    pOpt->halfExtents() = pGmdl->halfExtents();
+    pOpt->posBias() = pGmdl->posBias();
+    pOpt->posScale() = pGmdl->posScale();
+    pOpt->setHasHalfUvs(pGmdl->hasHalfUvs());
+    return pOpt;
+}
+
+} // namespace gaen
@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------------
+// mesh_optimize.h - Vertex cache ordering and meshlets for triangle meshes
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_ASSETS_MESH_OPTIMIZE_H
+#define GAEN_ASSETS_MESH_OPTIMIZE_H
+
+#include "gaen/core/base_defines.h"
+#include "gaen/core/Vector.h"
+
+#include "gaen/assets/Gmdl.h"
+
+namespace gaen
+{
+
+// Post-transform cache size the triangle ordering is tuned for
+const u32 kVertexCacheSize = 32;
+
+// Reorders triangles so their verts are reused while still in the
+// post-transform cache, using Tom Forsyth's linear speed algorithm.
+void optimize_vertex_cache(u32 * pIndices, u32 triCount, u32 vertCount);
+
+// Renumbers verts in order of first use so vertex fetch streams
+// through memory. pRemap gets each old vert's new index, or
+// kUnusedVert for verts no triangle references. Returns the number
+// of verts still in use.
+const u32 kUnusedVert = 0xffffffff;
+u32 optimize_vertex_fetch(u32 * pRemap, u32 * pIndices, u32 triCount, u32 vertCount);
+
+// Average transformed verts per triangle through a FIFO cache of
+// cacheSize entries, 0.5 is ideal on a regular grid and 3.0 is no
+// reuse at all.
+f32 average_cache_miss_ratio(const u32 * pIndices, u32 triCount, u32 vertCount, u32 cacheSize);
+
+// Splits the triangles, in their current order, into runs that touch
+// at most kMeshletMaxVerts verts and kMeshletMaxTris triangles.
+// Positions are read from the start of each vert.
+void build_meshlets(Vector<kMEM_Model, Meshlet> & meshlets,
+                    const u32 * pIndices,
+                    u32 triCount,
+                    const u8 * pVerts,
+                    u32 vertStride,
+                    u32 vertCount);
+
+// Copy of a triangle Gmdl with degenerate triangles dropped,
+// triangles in vertex cache order and verts in first use order.
+// With buildMeshlets the copy also carries its meshlets.
+Gmdl * optimize_gmdl(const Gmdl * pGmdl, bool buildMeshlets);
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_ASSETS_MESH_OPTIMIZE_H
@@ -0,0 +1,335 @@
+//------------------------------------------------------------------------------
+// mesh_quantize.cpp - Compact gpu vertex formats for Gmdl meshes
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <cmath>
+#include <limits>
+
+#include "gaen/math/common.h"
+
+#include "gaen/assets/mesh_quantize.h"
+
+namespace gaen
+{
+
+static const f32 kSnorm16Max = 32767.0f;
+static const f32 kUnorm16Max = 65535.0f;
+
+i16 quantize_snorm16(f32 val)
+{
+    val = clamp(val, -1.0f, 1.0f);
+    return static_cast<i16>(lroundf(val * kSnorm16Max));
+}
+
+f32 dequantize_snorm16(i16 val)
+{
+    // -32768 and -32767 both decode to -1
+    f32 f = val / kSnorm16Max;
+    return f < -1.0f ? -1.0f : f;
+}
+
+u16 quantize_unorm16(f32 val)
+{
+    val = clamp(val, 0.0f, 1.0f);
+    return static_cast<u16>(lroundf(val * kUnorm16Max));
+}
+
+f32 dequantize_unorm16(u16 val)
+{
+    return val / kUnorm16Max;
+}
+
+u16 f32_to_f16(f32 val)
+{
+    u32 bits;
+    memcpy(&bits, &val, sizeof(bits));
+
+    u32 sign = (bits >> 16) & 0x8000;
+    u32 mant = bits & 0x7fffff;
+    u32 rawExp = (bits >> 23) & 0xff;
+    i32 exp = (i32)rawExp - 127 + 15;
+
+    if (rawExp == 0xff)
+        return static_cast<u16>(sign | 0x7c00 | (mant ? 0x200 : 0)); // inf or nan
+    if (exp >= 31)
+        return static_cast<u16>(sign | 0x7c00); // too large, inf
+    if (exp <= 0)
+    {
+        // half denormal, or zero if too small
+        if (exp < -10)
+            return static_cast<u16>(sign);
+        mant |= 0x800000;
+        u32 shift = 14 - exp;
+        u32 half = mant >> shift;
+        u32 rem = mant & ((1u << shift) - 1);
+        u32 halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (half & 1)))
+            half++;
+        return static_cast<u16>(sign | half);
+    }
+
+    u32 half = sign | ((u32)exp << 10) | (mant >> 13);
+    u32 rem = mant & 0x1fff;
+    // a carry out of the mantissa correctly bumps the exponent
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+        half++;
+    return static_cast<u16>(half);
+}
+
+f32 f16_to_f32(u16 val)
+{
+    u32 sign = (u32)(val & 0x8000) << 16;
+    u32 exp = (val >> 10) & 0x1f;
+    u32 mant = val & 0x3ff;
+
+    if (exp == 0)
+    {
+        f32 f = ldexpf((f32)mant, -24);
+        return sign ? -f : f;
+    }
+
+    u32 bits;
+    if (exp == 31)
+        bits = sign | 0x7f800000 | (mant << 13);
+    else
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+
+    f32 f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+void quantize_position(i16 * pDst, const vec3 & pos, const vec3 & bias, const vec3 & scale)
+{
+    for (u32 i = 0; i < 3; ++i)
+        pDst[i] = scale[i] > 0.0f ? quantize_snorm16((pos[i] - bias[i]) / scale[i]) : 0;
+}
+
+vec3 dequantize_position(const i16 * pSrc, const vec3 & bias, const vec3 & scale)
+{
+    return vec3(bias.x + scale.x * dequantize_snorm16(pSrc[0]),
+                bias.y + scale.y * dequantize_snorm16(pSrc[1]),
+                bias.z + scale.z * dequantize_snorm16(pSrc[2]));
+}
+
+static f32 sign_not_zero(f32 val)
+{
+    return val >= 0.0f ? 1.0f : -1.0f;
+}
+
+void encode_oct_normal(i16 * pDst, const vec3 & normal)
+{
+    f32 l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if (l1 == 0.0f)
+    {
+        pDst[0] = pDst[1] = 0;
+        return;
+    }
+
+    f32 u = normal.x / l1;
+    f32 v = normal.y / l1;
+    if (normal.z < 0.0f)
+    {
+        f32 fu = (1.0f - fabsf(v)) * sign_not_zero(u);
+        f32 fv = (1.0f - fabsf(u)) * sign_not_zero(v);
+        u = fu;
+        v = fv;
+    }
+
+    // Rounding each coordinate independently isn't always closest on
+    // the sphere, so check all 4 neighbours.
+    vec3 unit = normal / length(normal);
+    f32 fu = floorf(u * kSnorm16Max);
+    f32 fv = floorf(v * kSnorm16Max);
+    f32 bestDot = -2.0f;
+    for (u32 i = 0; i < 4; ++i)
+    {
+        i16 cand[2];
+        cand[0] = static_cast<i16>(clamp(fu + (i & 1), -kSnorm16Max, kSnorm16Max));
+        cand[1] = static_cast<i16>(clamp(fv + (i >> 1), -kSnorm16Max, kSnorm16Max));
+        f32 d = dot(decode_oct_normal(cand), unit);
+        if (d > bestDot)
+        {
+            bestDot = d;
+            pDst[0] = cand[0];
+            pDst[1] = cand[1];
+        }
+    }
+}
+
+vec3 decode_oct_normal(const i16 * pSrc)
+{
+    vec3 n(dequantize_snorm16(pSrc[0]), dequantize_snorm16(pSrc[1]), 0.0f);
+    n.z = 1.0f - fabsf(n.x) - fabsf(n.y);
+    f32 t = n.z < 0.0f ? -n.z : 0.0f;
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+VertType quantized_vert_type(VertType vertType)
+{
+    switch (vertType)
+    {
+    case kVERT_PosNormCol:
+        return kVERT_PosNormColQ;
+    case kVERT_PosNormUv:
+        return kVERT_PosNormUvQ;
+    case kVERT_PosNormUvBone:
+        return kVERT_PosNormUvBoneQ;
+    default:
+        return kVERT_Unknown;
+    }
+}
+
+static f32 angle_degrees(const vec3 & lhs, const vec3 & rhs)
+{
+    // acos loses the small angles we care about to f32 rounding
+    return degrees(atan2f(length(cross(lhs, rhs)), dot(lhs, rhs)));
+}
+
+Gmdl * quantize_gmdl(const Gmdl * pGmdl, QuantizeReport * pReport)
+{
+    VertType vertType = quantized_vert_type(pGmdl->vertType());
+    PANIC_IF(vertType == kVERT_Unknown, "No quantized vert type for VertType: %d", pGmdl->vertType());
+    PANIC_IF(pGmdl->vertStride() != vert_stride(pGmdl->vertType()), "Morph targets aren't supported by mesh quantization");
+
+    vec3 mins(std::numeric_limits<f32>::max());
+    vec3 maxes(std::numeric_limits<f32>::lowest());
+    bool halfUvs = false;
+    for (u32 v = 0; v < pGmdl->vertCount(); ++v)
+    {
+        vec3 pos = pGmdl->vertPosition(v);
+        mins = min(mins, pos);
+        maxes = max(maxes, pos);
+
+        if (pGmdl->hasVertUv())
+        {
+            const u8 * pVert = reinterpret_cast<const u8*>(pGmdl->verts()) + (u64)v * pGmdl->vertStride();
+            const vec2 & uv = reinterpret_cast<const VertPosNormUv*>(pVert)->uv;
+            if (uv.x < 0.0f || uv.x > 1.0f || uv.y < 0.0f || uv.y > 1.0f)
+                halfUvs = true;
+        }
+    }
+    if (pGmdl->vertCount() == 0)
+        mins = maxes = vec3(0.0f);
+
+    Gmdl * pQuant = Gmdl::create(vertType,
+                                 pGmdl->vertCount(),
+                                 pGmdl->primType(),
+                                 pGmdl->primCount(),
+                                 pGmdl->shaderHash(),
+                                 pGmdl->boneCount(),
+                                 pGmdl->hardpointCount(),
+                                 pGmdl->mat(),
+                                 pGmdl->meshletCount());
+
+    pQuant->posBias() = (mins + maxes) * 0.5f;
+    pQuant->posScale() = (maxes - mins) * 0.5f;
+    pQuant->setHasHalfUvs(halfUvs);
+
+    QuantizeReport report;
+    memset(&report, 0, sizeof(report));
+    report.srcVertsSize = pGmdl->vertsSize();
+    report.dstVertsSize = pQuant->vertsSize();
+    report.halfUvs = halfUvs;
+
+    f64 posErrorSum = 0.0;
+    const u8 * pSrc = reinterpret_cast<const u8*>(pGmdl->verts());
+    u8 * pDst = reinterpret_cast<u8*>(pQuant->verts());
+    for (u32 v = 0; v < pGmdl->vertCount(); ++v)
+    {
+        // Position, normal and uv or color sit at the same offsets in
+        // the 3 float layouts, as do the quantized ones
+        const VertPosNormUv * pSrcVert = reinterpret_cast<const VertPosNormUv*>(pSrc);
+        VertPosNormUvQ * pDstVert = reinterpret_cast<VertPosNormUvQ*>(pDst);
+
+        quantize_position(pDstVert->position, pSrcVert->position, pQuant->posBias(), pQuant->posScale());
+        pDstVert->PADDING__[0] = pDstVert->PADDING__[1] = 0;
+        f32 posError = length(dequantize_position(pDstVert->position, pQuant->posBias(), pQuant->posScale()) - pSrcVert->position);
+        report.maxPositionError = max(report.maxPositionError, posError);
+        posErrorSum += (f64)posError * posError;
+
+        encode_oct_normal(pDstVert->normal, pSrcVert->normal);
+        if (length(pSrcVert->normal) > 0.0f)
+        {
+            f32 normError = angle_degrees(decode_oct_normal(pDstVert->normal), normalize(pSrcVert->normal));
+            report.maxNormalError = max(report.maxNormalError, normError);
+        }
+
+        if (pGmdl->hasVertUv())
+        {
+            for (u32 i = 0; i < 2; ++i)
+            {
+                f32 uv = pSrcVert->uv[i];
+                f32 decoded;
+                if (halfUvs)
+                {
+                    pDstVert->uv[i] = f32_to_f16(uv);
+                    decoded = f16_to_f32(pDstVert->uv[i]);
+                }
+                else
+                {
+                    pDstVert->uv[i] = quantize_unorm16(uv);
+                    decoded = dequantize_unorm16(pDstVert->uv[i]);
+                }
+                report.maxUvError = max(report.maxUvError, fabsf(decoded - uv));
+            }
+        }
+
+        if (pGmdl->hasVertColor())
+        {
+            reinterpret_cast<VertPosNormColQ*>(pDst)->color = reinterpret_cast<const VertPosNormCol*>(pSrc)->color;
+        }
+
+        if (pGmdl->hasVertBone())
+        {
+            reinterpret_cast<VertPosNormUvBoneQ*>(pDst)->boneId = reinterpret_cast<const VertPosNormUvBone*>(pSrc)->boneId;
+        }
+
+        pSrc += pGmdl->vertStride();
+        pDst += pQuant->vertStride();
+    }
+    if (pGmdl->vertCount() > 0)
+        report.rmsPositionError = (f32)sqrt(posErrorSum / pGmdl->vertCount());
+
+    // Same vert count, so prims are stored at the same index width
+    memcpy(pQuant->prims(), pGmdl->prims(), pGmdl->primsSize());
+    if (pGmdl->boneCount() > 0)
+        memcpy(pQuant->bones(), pGmdl->bones(), pGmdl->bonesSize());
+    if (pGmdl->hardpointCount() > 0)
+        memcpy(pQuant->hardpoints(), pGmdl->hardpoints(), pGmdl->hardpointsSize());
+    if (pGmdl->meshletCount() > 0)
+        memcpy(pQuant->meshlets(), pGmdl->meshlets(), pGmdl->meshletsSize());
+
+    pQuant->center() = pGmdl->center();
+    pQuant->halfExtents() = pGmdl->halfExtents();
+
+    if (pReport)
+        *pReport = report;
+    return pQuant;
+}
+
+} // namespace gaen
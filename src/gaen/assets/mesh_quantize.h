@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+// mesh_quantize.h - Compact gpu vertex formats for Gmdl meshes
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_ASSETS_MESH_QUANTIZE_H
+#define GAEN_ASSETS_MESH_QUANTIZE_H
+
+#include "gaen/core/base_defines.h"
+#include "gaen/math/vec3.h"
+
+#include "gaen/assets/Gmdl.h"
+
+namespace gaen
+{
+
+// Normalized integers, decoded the way GL decodes normalized vertex
+// attributes. Values outside [-1,1] or [0,1] are clamped.
+i16 quantize_snorm16(f32 val);
+f32 dequantize_snorm16(i16 val);
+u16 quantize_unorm16(f32 val);
+f32 dequantize_unorm16(u16 val);
+
+// IEEE half floats, rounded to nearest even
+u16 f32_to_f16(f32 val);
+f32 f16_to_f32(u16 val);
+
+// Positions are snorm16 within the box bias +/- scale
+void quantize_position(i16 * pDst, const vec3 & pos, const vec3 & bias, const vec3 & scale);
+vec3 dequantize_position(const i16 * pSrc, const vec3 & bias, const vec3 & scale);
+
+// Unit normals folded onto an octahedron and stored as 2 snorm16s.
+// Encoding tries the 4 nearest grid points and keeps the one that
+// decodes closest to the normal. Decoding matches the vertex shaders.
+void encode_oct_normal(i16 * pDst, const vec3 & normal);
+vec3 decode_oct_normal(const i16 * pSrc);
+
+// Quantized counterpart of vertType, or kVERT_Unknown if it has none
+VertType quantized_vert_type(VertType vertType);
+
+// What quantizing a mesh cost, in mesh units for positions, degrees
+// for normals and uv units for uvs.
+struct QuantizeReport
+{
+    u32 srcVertsSize;
+    u32 dstVertsSize;
+    f32 maxPositionError;
+    f32 rmsPositionError;
+    f32 maxNormalError;
+    f32 maxUvError;
+    bool halfUvs;
+};
+
+// Copy of pGmdl with its verts quantized. Position bounds come from
+// the verts, uvs are unorm16 if they all lie in [0,1] and half floats
+// otherwise. pReport, if given, is filled with the errors introduced.
+Gmdl * quantize_gmdl(const Gmdl * pGmdl, QuantizeReport * pReport = nullptr);
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_ASSETS_MESH_QUANTIZE_H
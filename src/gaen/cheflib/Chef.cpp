@@ -35,7 +35,8 @@
 
 namespace gaen
 {
-static const u16 kChefVersion = 1;
+// 2: Gimg carries mip levels, recooks assets that embed a Gimg (Gmat, Gaim)
+static const u16 kChefVersion = 2;
 
 Chef::Chef(u32 id, const char * platform, const char * assetsDir)
   : mId(id)
@@ -65,9 +66,9 @@ UniquePtr<CookInfo> Chef::cook(const char * rawPath, bool force) const
     return pCi;
 }
 
-UniquePtr<CookInfo> Chef::forceCook(const ChefString & rawPath) const
+UniquePtr<CookInfo> Chef::forceCook(const ChefString & rawPath, const Recipe * pParentRecipe) const
 {
-    UniquePtr<CookInfo> pCi = prepCookInfo(rawPath.c_str(), true);
+    UniquePtr<CookInfo> pCi = prepCookInfo(rawPath.c_str(), true, nullptr, pParentRecipe);
     forceCook(pCi.get());
     return pCi;
 }
@@ -122,7 +123,7 @@ void Chef::forceCookAndWrite(CookInfo * pCi) const
     }
 }
 
-UniquePtr<CookInfo> Chef::prepCookInfo(const char * rawPath, bool force, Cooker * pCookerOverride) const
+UniquePtr<CookInfo> Chef::prepCookInfo(const char * rawPath, bool force, Cooker * pCookerOverride, const Recipe * pParentRecipe) const
 {
     ChefString rawPathStr(rawPath);
     ASSERT(isRawPath(rawPathStr));
@@ -147,7 +148,7 @@ UniquePtr<CookInfo> Chef::prepCookInfo(const char * rawPath, bool force, Cooker
     PANIC_IF(!file_exists(rawPathStr.c_str()), "Raw file does not exist: %s", rawPathStr.c_str());
 
     RecipeListUP pRecipes = findRecipes(rawPathStr);
-    RecipeUP pFullRecipe = overlayRecipes(*pRecipes);
+    RecipeUP pFullRecipe = overlayRecipes(*pRecipes, pParentRecipe);
 
     UniquePtr<CookInfo> pCi(GNEW(kMEM_Chef, CookInfo, this, pCooker, force, rawPathStr, pRecipes, pFullRecipe));
 
@@ -432,9 +433,16 @@ RecipeListUP Chef::findRecipes(const ChefString & rawPath) const
     return pRecipes;
 }
 
-RecipeUP Chef::overlayRecipes(const RecipeList & recipes) const
+RecipeUP Chef::overlayRecipes(const RecipeList & recipes, const Recipe * pParentRecipe) const
 {
     RecipeUP pRecipe(GNEW(kMEM_Chef, Recipe));
+
+    // Files generated by another cook (e.g. the .obj files a .qbt
+    // exports into raw_trans) have no recipes of their own next to
+    // them, so start from the parent's and let any found here win.
+    if (pParentRecipe)
+        pRecipe->overlay(*pParentRecipe);
+
     for (ChefString rcp : recipes)
     {
         if (!pRecipe->read(rcp.c_str()))
@@ -48,11 +48,11 @@ public:
     const ChefString & platform() const { return mPlatform; }
 
     UniquePtr<CookInfo> cook(const char * rawPath, bool force) const;
-    UniquePtr<CookInfo> forceCook(const ChefString & rawPath) const;
+    UniquePtr<CookInfo> forceCook(const ChefString & rawPath, const Recipe * pParentRecipe = nullptr) const;
     void forceCook(CookInfo * pCi) const;
     void forceCookAndWrite(CookInfo * pCi) const;
 
-    UniquePtr<CookInfo> prepCookInfo(const char * rawPath, bool force, Cooker * pCookerOverride = nullptr) const;
+    UniquePtr<CookInfo> prepCookInfo(const char * rawPath, bool force, Cooker * pCookerOverride = nullptr, const Recipe * pParentRecipe = nullptr) const;
     bool shouldCook(const CookInfo & ci) const;
 
     ChefString getRawPath(const ChefString & path) const;
@@ -72,7 +72,7 @@ private:
     bool isGamePath(const ChefString & path) const;
 
     RecipeListUP findRecipes(const ChefString & rawPath) const;
-    RecipeUP overlayRecipes(const RecipeList & recipes) const;
+    RecipeUP overlayRecipes(const RecipeList & recipes, const Recipe * pParentRecipe) const;
 
     void writeDependencyFile(const CookInfo & ci) const;
     List<kMEM_Chef, ChefString> readDependencyFile(const ChefString & rawPath) const;
@@ -42,9 +42,43 @@ namespace gaen
 namespace cookers
 {
 
+// Mip chains and block compression both start from RGBA8, so the mip
+// filter and the BCn encoder only ever see one layout.
+static Gimg * finish_gimg(const Gimg * pSource, PixelFormat pixFmt, bool mipmaps)
+{
+    Gimg * pGimg;
+    if (!mipmaps && !is_block_compressed(pixFmt))
+    {
+        pSource->convertFormat(&pGimg, kMEM_Chef, pixFmt);
+        return pGimg;
+    }
+
+    PANIC_IF(is_block_compressed(pixFmt) && pixFmt != kPXL_RGB_DXT1 && pixFmt != kPXL_RGBA_DXT5,
+             "Only RGB_DXT1 and RGBA_DXT5 compression is supported, not: %s", pixel_format_to_str(pixFmt));
+    PANIC_IF(mipmaps && !is_block_compressed(pixFmt) && pixFmt != kPXL_RGBA8,
+             "Mipmaps require RGBA8, RGB_DXT1 or RGBA_DXT5, not: %s", pixel_format_to_str(pixFmt));
+
+    Gimg * pRgba;
+    pSource->convertFormat(&pRgba, kMEM_Chef, kPXL_RGBA8);
+    Scoped_GFREE<Gimg> pRgba_sp(pRgba);
+
+    if (!mipmaps)
+    {
+        pRgba->convertFormat(&pGimg, kMEM_Chef, pixFmt);
+        return pGimg;
+    }
+
+    Gimg * pLevels;
+    pRgba->buildMipChain(&pLevels, kMEM_Chef);
+    Scoped_GFREE<Gimg> pLevels_sp(pLevels);
+
+    pLevels->convertFormat(&pGimg, kMEM_Chef, pixFmt);
+    return pGimg;
+}
+
 Image::Image()
 {
-    setVersion(1);
+    setVersion(2);
     addRawExt(kExtPng);
     addRawExt(kExtTga);
     addCookedExtExclusive(kExtGimg);
@@ -89,7 +123,19 @@ Gimg * Image::load_png(const char * path, u32 referencePathHash, PixelFormat pix
 void Image::cookPng(CookInfo * pCookInfo) const
 {
     PixelFormat pixFmt = pixel_format_from_str(pCookInfo->fullRecipe().getWithDefault("pixel_format", "RGBA8"));
-    Gimg * pGimg = Image::load_png(pCookInfo->rawPath().c_str(), Image::reference_path_hash(pCookInfo), pixFmt);
+    bool mipmaps = pCookInfo->fullRecipe().getBool("mipmaps");
+
+    Gimg * pGimg;
+    if (!mipmaps && !is_block_compressed(pixFmt))
+    {
+        pGimg = Image::load_png(pCookInfo->rawPath().c_str(), Image::reference_path_hash(pCookInfo), pixFmt);
+    }
+    else
+    {
+        Gimg * pGimgPng = Image::load_png(pCookInfo->rawPath().c_str(), Image::reference_path_hash(pCookInfo), kPXL_RGBA8);
+        Scoped_GFREE<Gimg> pGimg_sp(pGimgPng);
+        pGimg = finish_gimg(pGimgPng, pixFmt, mipmaps);
+    }
 
     ASSERT(pGimg);
     pCookInfo->setCookedBuffer(pGimg);
@@ -123,10 +169,10 @@ void Image::cookTga(CookInfo * pCookInfo) const
     Scoped_GFREE<Gimg> pGimg_sp(pGimgTga);
 
     PixelFormat pixFmt = pixel_format_from_str(pCookInfo->fullRecipe().getWithDefault("pixel_format", "RGBA8"));
+    bool mipmaps = pCookInfo->fullRecipe().getBool("mipmaps");
 
     // Convert the pixel format if necessary
-    Gimg * pGimg;
-    pGimgTga->convertFormat(&pGimg, kMEM_Chef, pixFmt);
+    Gimg * pGimg = finish_gimg(pGimgTga, pixFmt, mipmaps);
 
     ASSERT(pGimg);
     pCookInfo->setCookedBuffer(pGimg);
@@ -24,6 +24,7 @@
 //   distribution.
 //------------------------------------------------------------------------------
 
+#include <cstdio>
 #include <regex>
 
 #include <assimp/cimport.h>
@@ -42,6 +43,8 @@
 #include "gaen/assets/file_utils.h"
 #include "gaen/assets/Gmdl.h"
 #include "gaen/assets/Gmat.h"
+#include "gaen/assets/mesh_optimize.h"
+#include "gaen/assets/mesh_quantize.h"
 
 #include "gaen/cheflib/CookInfo.h"
 #include "gaen/cheflib/Chef.h"
@@ -55,7 +58,7 @@ namespace cookers
 
 Model::Model()
 {
-    setVersion(8);
+    setVersion(10);
     addRawExt(kExtObj);
     addRawExt(kExtPly);
     addRawExt(kExtOgex);
@@ -186,6 +189,14 @@ u32 Model::bone_id(const Vector<kMEM_Chef, Bone> & bones, const char * name)
     return 0;
 }
 
+// Only these vertex shaders decode quantized positions, normals and uvs
+static bool shader_decodes_quantized(u32 shaderHash)
+{
+    return (shaderHash == HASH::voxchar ||
+            shaderHash == HASH::voxprop ||
+            shaderHash == HASH::voxvertcol);
+}
+
 void Model::cook(CookInfo * pCookInfo) const
 {
     u32 aiFlags = aiProcess_Triangulate |
@@ -302,7 +313,7 @@ void Model::cook(CookInfo * pCookInfo) const
 
     f32 * pVert = pGmdl->verts();
     u32 vertIdxOffset = 0;
-    PrimTriangle * pTri = *pGmdl;
+    u32 primIdx = 0;
     vec3 mins(std::numeric_limits<f32>::max()), maxes(std::numeric_limits<f32>::lowest());
 
     for (u32 i = 0; i < pScene->mNumMeshes; ++i)
@@ -387,13 +398,13 @@ void Model::cook(CookInfo * pCookInfo) const
         for (u32 t = 0; t < pAiMesh->mNumFaces; ++t)
         {
             PANIC_IF(pAiMesh->mFaces->mNumIndices != 3, "Non triangularized mesh, %s", pCookInfo->rawPath().c_str());
-            pTri[t].p0 = pAiMesh->mFaces[t].mIndices[0] + vertIdxOffset;
-            pTri[t].p1 = pAiMesh->mFaces[t].mIndices[1] + vertIdxOffset;
-            pTri[t].p2 = pAiMesh->mFaces[t].mIndices[2] + vertIdxOffset;
+            pGmdl->setPrimIndex(primIdx * 3 + 0, pAiMesh->mFaces[t].mIndices[0] + vertIdxOffset);
+            pGmdl->setPrimIndex(primIdx * 3 + 1, pAiMesh->mFaces[t].mIndices[1] + vertIdxOffset);
+            pGmdl->setPrimIndex(primIdx * 3 + 2, pAiMesh->mFaces[t].mIndices[2] + vertIdxOffset);
+            primIdx++;
         }
 
         vertIdxOffset += pAiMesh->mNumVertices;
-        pTri += pAiMesh->mNumFaces;
     }
 
     if (skel.hasCenter)
@@ -421,6 +432,45 @@ void Model::cook(CookInfo * pCookInfo) const
         }
     }
 
+    // Meshlets are cut from the cache optimized triangle order
+    bool meshlets = pCookInfo->fullRecipe().getBool("meshlets");
+    if (meshlets || pCookInfo->fullRecipe().getBool("optimize_mesh"))
+    {
+        Gmdl * pOptimized = optimize_gmdl(pGmdl, meshlets);
+        GFREE(pGmdl);
+        pGmdl = pOptimized;
+    }
+
+    // Quantized last, everything above works on float verts
+    if (pCookInfo->fullRecipe().getBool("quantize"))
+    {
+        PANIC_IF(!shader_decodes_quantized(pGmdl->shaderHash()),
+                 "Quantized verts require the voxchar, voxprop or voxvertcol shader, %s",
+                 pCookInfo->rawPath().c_str());
+
+        if (quantized_vert_type(pGmdl->vertType()) != kVERT_Unknown)
+        {
+            QuantizeReport report;
+            Gmdl * pQuantized = quantize_gmdl(pGmdl, &report);
+            GFREE(pGmdl);
+            pGmdl = pQuantized;
+
+            printf("Quantized: %s, verts %u -> %u bytes, position error max %g rms %g, normal error max %g degrees, uv error max %g%s\n",
+                   pCookInfo->rawPath().c_str(),
+                   report.srcVertsSize,
+                   report.dstVertsSize,
+                   report.maxPositionError,
+                   report.rmsPositionError,
+                   report.maxNormalError,
+                   report.maxUvError,
+                   report.halfUvs ? " (half float uvs)" : "");
+        }
+        else
+        {
+            printf("Not quantized: %s, no quantized format for its verts\n", pCookInfo->rawPath().c_str());
+        }
+    }
+
     pCookInfo->setCookedBuffer(pGmdl);
 }
 
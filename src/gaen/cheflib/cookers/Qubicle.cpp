@@ -46,7 +46,7 @@ namespace cookers
 
 Qubicle::Qubicle()
 {
-    setVersion(1);
+    setVersion(3);
     addRawExt(kExtQbt);
     addCookedExt(kExtGmdl);
     addCookedExt(kExtGimg);
@@ -77,7 +77,7 @@ void Qubicle::cook(CookInfo * pCookInfo) const
             else
                 PANIC("Invalid outputFile extension: %s", ext.c_str());
 
-            UniquePtr<CookInfo> pCi = pCookInfo->chef().forceCook(outputFile);
+            UniquePtr<CookInfo> pCi = pCookInfo->chef().forceCook(outputFile, &pCookInfo->fullRecipe());
             pCookInfo->transferCookResult(*pCi, cookedExt);
         }
     }
@@ -25,13 +25,19 @@
 //------------------------------------------------------------------------------
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include "gaen/core/base_defines.h"
 #include "gaen/core/mem.h"
+#include "gaen/core/platutils.h"
 
 #include "gaen/compose/compiler.h"
 #include "gaen/compose/compiler_structs.h"
 #include "gaen/compose/CodegenCpp.h"
+#include "gaen/compose/CodegenBytecode.h"
+#include "gaen/compose/optimize.h"
+#include "gaen/compose/compile_batch.h"
 #include "gaen/compose/comp_mem.h"
 
 namespace gaen
@@ -62,7 +68,15 @@ void messageHandler(MessageType messageType,
 
 void usage_and_exit()
 {
-    printf("Usage: cmpc [-i api_header] input_cmp_file\n");
+    printf("Usage: cmpc [-i api_header] [-b bytecode_output_dir] [-n] [-s] [-r] input_cmp_file\n");
+    printf("       cmpc [-i api_header] [-n] [-s] -o output_dir [-j thread_count] input_cmp_file...\n");
+    printf("  -n  disable optimization passes\n");
+    printf("  -s  call small handlers directly on sends to self, they run\n");
+    printf("      immediately rather than after the sending handler\n");
+    printf("  -r  report Block footprint of each entity and component\n");
+    printf("  -o  batch mode, compile all inputs into output_dir, skipping\n");
+    printf("      scripts unchanged since the last batch\n");
+    printf("  -j  worker threads used in batch mode, defaults to core count\n");
     exit(1);
 }
 
@@ -78,26 +92,85 @@ int main(int argc, char ** argv)
     parse_init();
 
     CompList<CompString> systemIncludes;
+    const char * bytecodeDir = nullptr;
+    const char * batchDir = nullptr;
+    u32 threadCount = platform_core_count();
+    bool optimize = true;
+    bool inlineSelfSends = false;
+    bool reportFootprint = false;
+
+    // parse command line args, inputs follow all options
+    i32 i = 1;
+    for (; i < argc - 1; ++i)
+    {
+        // '/x' style options are two characters, anything longer is a path
+        if (argv[i][0] != '-' && (argv[i][0] != '/' || strlen(argv[i]) != 2))
+            break;
+
+        switch (argv[i][1])
+        {
+        case 'i':
+            systemIncludes.emplace_back(argv[i+1]);
+            i++;
+            break;
+        case 'b':
+            bytecodeDir = argv[i+1];
+            i++;
+            break;
+        case 'o':
+            batchDir = argv[i+1];
+            i++;
+            break;
+        case 'j':
+            threadCount = (u32)atoi(argv[i+1]);
+            i++;
+            break;
+        case 'n':
+            optimize = false;
+            break;
+        case 's':
+            inlineSelfSends = true;
+            break;
+        case 'r':
+            reportFootprint = true;
+            break;
+        default:
+            usage_and_exit();
+            break;
+        }
+    }
+
+    if (i >= argc)
+    {
+        usage_and_exit();
+    }
 
-    // parse command line args
-    for (i32 i = 1; i < argc - 2; ++i)
+    if (batchDir)
     {
-        if (argv[i][0] == '-' || argv[i][0] == '/')
+        BatchOptions opts;
+        opts.pSystemIncludes = &systemIncludes;
+        opts.messageHandler = &messageHandler;
+        opts.outputDir = batchDir;
+        opts.compilerPath = argv[0];
+        opts.threadCount = threadCount;
+        opts.optimize = optimize;
+        opts.inlineSelfSends = inlineSelfSends;
+
+        u32 failCount = compile_batch(argv + i, (u32)(argc - i), opts);
+        if (failCount > 0)
         {
-            switch (argv[i][1])
-            {
-            case 'i':
-                systemIncludes.emplace_back(argv[i+1]);
-                i++;
-                break;
-            default:
-                usage_and_exit();
-                break;
-            }
+            fprintf(stderr, "Compilation failed for %u script(s)\n", failCount);
+            exit(1);
         }
+        return 0;
+    }
+
+    if (i != argc - 1)
+    {
+        usage_and_exit();
     }
 
-    const char * inFile = argv[argc-1];
+    const char * inFile = argv[i];
 
     ParseData * pParseData = parse_file(inFile,
                                         &systemIncludes,
@@ -109,6 +182,43 @@ int main(int argc, char ** argv)
         exit(1);
     }
 
+    if (optimize)
+        optimize_ast(pParseData, inlineSelfSends);
+
+    if (reportFootprint)
+        report_block_footprint(pParseData);
+
+    // Bytecode components are written one .gvm file per component
+    // instead of generating C++.
+    if (bytecodeDir)
+    {
+        CodegenBytecode codegen;
+        CodegenBytecode::CodeBytecodeList programs = codegen.codegen(pParseData);
+
+        // Codegen errors (unsupported constructs, register or branch
+        // limits) leave partial programs, don't write any of them.
+        if (pParseData->hasErrors)
+        {
+            fprintf(stderr, "Compilation failed due to errors\n");
+            exit(1);
+        }
+
+        for (const CodeBytecode & program : programs)
+        {
+            S outPath = S(bytecodeDir) + S("/") + program.name + S(".gvm");
+            FILE * pFile = fopen(outPath.c_str(), "wb");
+            if (!pFile ||
+                fwrite(program.cells.data(), sizeof(u32), program.cells.size(), pFile) != program.cells.size())
+            {
+                fprintf(stderr, "Unable to write %s\n", outPath.c_str());
+                exit(1);
+            }
+            fclose(pFile);
+            puts(outPath.c_str());
+        }
+        return 0;
+    }
+
     CodeCpp codeCpp;
     if (pParseData)
     {
@@ -0,0 +1,899 @@
+//------------------------------------------------------------------------------
+// CodegenBytecode.cpp - Bytecode generation for the Compose script VM
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cstring>
+
+#include "gaen/engine/Block.h"
+#include "gaen/hashes/hashes.h"
+#include "gaen/compose/CodegenBytecode.h"
+
+namespace gaen
+{
+
+static const u32 kMaxCodeCount = 0xffff;
+
+CodegenBytecode::CodeBytecodeList CodegenBytecode::codegen(ParseData * pParseData)
+{
+    ASSERT(pParseData);
+    mpParseData = pParseData;
+
+    CodeBytecodeList programs;
+    for (const Ast * pAst : pParseData->pRootAst->pChildren->nodes)
+    {
+        if (pAst->type == kAST_ComponentDef)
+        {
+            programs.push_back(codegenComponent(pAst));
+        }
+        else if (pAst->type == kAST_EntityDef)
+        {
+            // Entities always need CodegenCpp, report them rather
+            // than leave them out of the programs.
+            COMP_ERROR(mpParseData,
+                       "Entity %s not supported by bytecode backend, only components can be compiled with -b",
+                       pAst->pSymRec ? pAst->pSymRec->fullName : "");
+        }
+    }
+    return programs;
+}
+
+CodeBytecode CodegenBytecode::codegenComponent(const Ast * pCompAst)
+{
+    ASSERT(pCompAst->pBlockInfos);
+
+    mpCompAst = pCompAst;
+    mCode.clear();
+    mImports.clear();
+    mHandlers.clear();
+
+    if (find_input(pCompAst, 0))
+        error(pCompAst, "Input blocks");
+
+    // Validate data up front so everything below can assume cell sized values
+    for (const Ast * pChild : pCompAst->pChildren->nodes)
+    {
+        if (is_prop_or_field(pChild->pSymRec) && !isCellType(pChild->pSymRec->pSymDataType))
+            error(pChild, "Non cell sized properties and fields");
+        else if (pChild->type == kAST_FunctionDef)
+            error(pChild, "Functions");
+    }
+
+    ScriptProgramHeader header;
+    header.magic = kScriptProgramMagic;
+    header.version = kScriptProgramVersion;
+    header.nameHash = HASH::hash_func(pCompAst->pSymRec->fullName);
+    header.blockCount = pCompAst->pBlockInfos->blockCount;
+    header.updateEntry = kScriptProgramNoEntry;
+
+    // Properties and independent fields are initialized with
+    // init_independent_data__, fields that depend on properties wait
+    // until properties have been set by our creator.
+    header.initEntry = codegenInitData(pCompAst, kSDC_Independent);
+    bool hasDependent = false;
+    for (const Ast * pChild : pCompAst->pChildren->nodes)
+        hasDependent = hasDependent || data_category(pChild) == kSDC_Dependent;
+    if (hasDependent)
+        mHandlers.push_back({ HASH::init_dependent_data__, codegenInitData(pCompAst, kSDC_Dependent), 0 });
+
+    const Ast * pUpdateDef = find_update(pCompAst);
+    if (pUpdateDef)
+    {
+        header.updateEntry = here();
+        beginEntry();
+        for (const Ast * pChild : pUpdateDef->pChildren->nodes)
+            stmt(pChild);
+        endEntry();
+    }
+
+    for (const Ast * pChild : pCompAst->pChildren->nodes)
+    {
+        if (is_prop(pChild->pSymRec))
+        {
+            mHandlers.push_back({ HASH::hash_func(pChild->pSymRec->name), codegenPropertySetter(pChild), 1 });
+        }
+        else if (is_eliminated_prop(pChild->pSymRec))
+        {
+            // Property was optimized out, accept and drop its value
+            u32 entry = here();
+            beginEntry();
+            endEntry();
+            mHandlers.push_back({ HASH::hash_func(pChild->pSymRec->name), entry, 1 });
+        }
+        else if (pChild->type == kAST_MessageDef && pChild->pSymRec)
+        {
+            if (pChild->pBlockInfos->blockMemoryItemCount > 0)
+                error(pChild, "BlockMemory message parameters");
+            for (const BlockInfo & bi : pChild->pBlockInfos->items)
+            {
+                if (!isCellType(bi.pSymDataType))
+                    error(bi.pAst, "Non cell sized message parameters");
+            }
+
+            Handler handler;
+            handler.msgId = HASH::hash_func(pChild->str);
+            handler.entry = here();
+            handler.blockCount = pChild->pBlockInfos->blockCount;
+            beginEntry();
+            for (const Ast * pStmt : pChild->pChildren->nodes)
+                stmt(pStmt);
+            endEntry();
+            mHandlers.push_back(handler);
+        }
+    }
+
+    // Handlers are binary searched at run time
+    std::sort(mHandlers.begin(),
+              mHandlers.end(),
+              [](const Handler & lhs, const Handler & rhs) { return lhs.msgId < rhs.msgId; });
+    for (size_t i = 1; i < mHandlers.size(); ++i)
+    {
+        if (mHandlers[i-1].msgId == mHandlers[i].msgId)
+            COMP_ERROR(mpParseData, "Message handler and property share a name in %s", pCompAst->pSymRec->fullName);
+    }
+
+    if (here() > kMaxCodeCount)
+        COMP_ERROR(mpParseData, "Component too large for bytecode: %s", pCompAst->pSymRec->fullName);
+
+    header.handlerCount = (u32)mHandlers.size();
+    header.importCount = (u32)mImports.size();
+    header.codeCount = here();
+
+    CodeBytecode code;
+    code.name = pCompAst->pSymRec->fullName;
+
+    const u32 * pHeaderCells = reinterpret_cast<const u32*>(&header);
+    code.cells.insert(code.cells.end(), pHeaderCells, pHeaderCells + sizeof(header) / sizeof(u32));
+    for (const Handler & handler : mHandlers)
+    {
+        code.cells.push_back(handler.msgId);
+        code.cells.push_back(handler.entry);
+        code.cells.push_back(handler.blockCount);
+    }
+    code.cells.insert(code.cells.end(), mImports.begin(), mImports.end());
+    code.cells.insert(code.cells.end(), mCode.begin(), mCode.end());
+
+    return code;
+}
+
+u32 CodegenBytecode::codegenInitData(const Ast * pCompAst, ScriptDataCategory dataCategory)
+{
+    u32 entry = here();
+    beginEntry();
+    u32 reg = pushReg();
+    for (const Ast * pChild : pCompAst->pChildren->nodes)
+    {
+        if (data_category(pChild) == dataCategory)
+        {
+            const SymRec * pSymRec = pChild->pSymRec;
+            ValType valType = symType(pSymRec);
+            if (pSymRec->pInitVal)
+                valType = expr(pSymRec->pInitVal, reg);
+            else
+                loadInt(reg, 0); // 0 and 0.0f share a bit pattern
+            store(pSymRec, reg, valType);
+        }
+        else if (data_category(pChild) == kSDC_Asset)
+        {
+            error(pChild, "Assets");
+        }
+    }
+    popReg(reg);
+    endEntry();
+    return entry;
+}
+
+u32 CodegenBytecode::codegenPropertySetter(const Ast * pPropAst)
+{
+    // Value was sent in the first cell of the set_property message
+    u32 entry = here();
+    beginEntry();
+    u32 reg = pushReg();
+    emit(eOpcode_LOADM, reg, 0, 0);
+    emit(eOpcode_STOREB, reg, 0, blockCellAddress(pPropAst->pSymRec));
+    popReg(reg);
+    endEntry();
+    return entry;
+}
+
+void CodegenBytecode::beginEntry()
+{
+    mLocalRegs.clear();
+    mNextReg = kVmFirstLocalReg;
+}
+
+void CodegenBytecode::endEntry()
+{
+    emit(eOpcode_RET, 0, 0, 0);
+}
+
+//------------------------------------------------------------------------------
+// Statements
+//------------------------------------------------------------------------------
+void CodegenBytecode::stmt(const Ast * pAst)
+{
+    if (!pAst)
+        return;
+
+    switch (pAst->type)
+    {
+    case kAST_Block:
+    {
+        // Locals are released at the end of their block
+        u32 savedNextReg = mNextReg;
+        for (const Ast * pChild : pAst->pChildren->nodes)
+            stmt(pChild);
+        mNextReg = savedNextReg;
+        return;
+    }
+    case kAST_SimpleStmt:
+    {
+        stmt(pAst->pLhs);
+        return;
+    }
+    case kAST_SymbolDecl:
+    {
+        declare(pAst);
+        return;
+    }
+    case kAST_If:
+    {
+        u32 cond = pushReg();
+        toBool(cond, expr(pAst->pLhs, cond));
+        u32 brElse = emitBranch(eOpcode_BRZ, cond);
+        popReg(cond);
+
+        stmt(pAst->pMid);
+        if (pAst->pRhs)
+        {
+            u32 jmpEnd = emitBranch(eOpcode_JUMP, 0);
+            patchBranch(brElse, here());
+            stmt(pAst->pRhs);
+            patchBranch(jmpEnd, here());
+        }
+        else
+        {
+            patchBranch(brElse, here());
+        }
+        return;
+    }
+    case kAST_While:
+    {
+        u32 top = here();
+        u32 cond = pushReg();
+        toBool(cond, expr(pAst->pLhs, cond));
+        u32 brEnd = emitBranch(eOpcode_BRZ, cond);
+        popReg(cond);
+
+        stmt(pAst->pChildren->nodes.front());
+        emit(eOpcode_JUMP, 0, 0, top);
+        patchBranch(brEnd, here());
+        return;
+    }
+    case kAST_DoWhile:
+    {
+        u32 top = here();
+        stmt(pAst->pChildren->nodes.front());
+
+        u32 cond = pushReg();
+        toBool(cond, expr(pAst->pLhs, cond));
+        emit(eOpcode_BRNZ, cond, 0, top);
+        popReg(cond);
+        return;
+    }
+    case kAST_For:
+    {
+        // Locals declared in the for init are scoped to the loop
+        u32 savedNextReg = mNextReg;
+        stmt(pAst->pLhs);
+
+        u32 top = here();
+        u32 brEnd = 0;
+        if (pAst->pMid)
+        {
+            u32 cond = pushReg();
+            toBool(cond, expr(pAst->pMid, cond));
+            brEnd = emitBranch(eOpcode_BRZ, cond);
+            popReg(cond);
+        }
+
+        stmt(pAst->pChildren->nodes.front());
+        stmt(pAst->pRhs);
+        emit(eOpcode_JUMP, 0, 0, top);
+
+        if (pAst->pMid)
+            patchBranch(brEnd, here());
+        mNextReg = savedNextReg;
+        return;
+    }
+    case kAST_Return:
+    {
+        error(pAst, "Return statements");
+        return;
+    }
+    case kAST_MessageSend:
+    case kAST_PropertySet:
+    {
+        error(pAst, "Message sends");
+        return;
+    }
+    default:
+    {
+        // Expression statement, evaluate for side effects only
+        u32 reg = pushReg();
+        expr(pAst, reg);
+        popReg(reg);
+        return;
+    }
+    }
+}
+
+void CodegenBytecode::declare(const Ast * pAst)
+{
+    const SymRec * pSymRec = pAst->pSymRec;
+    if (!isCellType(pSymRec->pSymDataType))
+    {
+        error(pAst, "Non cell sized locals");
+        return;
+    }
+
+    // Evaluate initializer before the local is in scope
+    u32 reg = pushReg();
+    if (pSymRec->pInitVal)
+        coerce(reg, expr(pSymRec->pInitVal, reg), symType(pSymRec));
+    else
+        loadInt(reg, 0); // 0 and 0.0f share a bit pattern
+
+    mLocalRegs[pSymRec] = reg;
+}
+
+//------------------------------------------------------------------------------
+// Expressions
+//------------------------------------------------------------------------------
+CodegenBytecode::ValType CodegenBytecode::expr(const Ast * pAst, u32 reg)
+{
+    switch (pAst->type)
+    {
+    case kAST_IntLiteral:
+    case kAST_BoolLiteral:
+        loadInt(reg, pAst->numi);
+        return kVT_Int;
+    case kAST_FloatLiteral:
+        loadFloat(reg, pAst->numf);
+        return kVT_Float;
+    case kAST_Hash:
+        emit(eOpcode_LOADC, reg, 0, 0);
+        mCode.push_back(HASH::hash_func(pAst->str));
+        return kVT_Int;
+
+    case kAST_SymbolRef:
+        if (!pAst->pSymRecRef)
+        {
+            COMP_ERROR(pAst->pParseData, "Unknown symbol: %s", pAst->str);
+            return kVT_Int;
+        }
+        return load(pAst->pSymRecRef, reg);
+
+    case kAST_ScalarInit:
+    {
+        ValType to = pAst->pSymDataType->typeDesc.dataType == kDT_float ? kVT_Float : kVT_Int;
+        coerce(reg, expr(pAst->pRhs->pChildren->nodes.front(), reg), to);
+        return to;
+    }
+
+    case kAST_Add:
+    case kAST_Sub:
+    case kAST_Mul:
+    case kAST_Div:
+    case kAST_Mod:
+    case kAST_LShift:
+    case kAST_RShift:
+    case kAST_BitAnd:
+    case kAST_BitOr:
+    case kAST_BitXor:
+    case kAST_Eq:
+    case kAST_NEq:
+    case kAST_LT:
+    case kAST_LTE:
+    case kAST_GT:
+    case kAST_GTE:
+        return binaryOp(pAst, reg);
+
+    case kAST_And:
+    case kAST_Or:
+        return logicalOp(pAst, reg);
+
+    case kAST_Not:
+        toBool(reg, expr(pAst->pRhs, reg));
+        emit(eOpcode_NOT, reg, reg, 0);
+        return kVT_Int;
+    case kAST_Complement:
+        if (expr(pAst->pRhs, reg) != kVT_Int)
+            error(pAst, "Complement of float");
+        emit(eOpcode_COMP, reg, reg, 0);
+        return kVT_Int;
+    case kAST_Negate:
+    {
+        ValType valType = expr(pAst->pRhs, reg);
+        emit(valType == kVT_Float ? eOpcode_FNEG : eOpcode_NEG, reg, reg, 0);
+        return valType;
+    }
+
+    case kAST_PreInc:
+        return incDec(pAst->pRhs, reg, true, false);
+    case kAST_PreDec:
+        return incDec(pAst->pRhs, reg, false, false);
+    case kAST_PostInc:
+        return incDec(pAst->pRhs->pRhs, reg, true, true);
+    case kAST_PostDec:
+        return incDec(pAst->pRhs->pRhs, reg, false, true);
+
+    case kAST_Assign:
+    case kAST_AddAssign:
+    case kAST_SubAssign:
+    case kAST_MulAssign:
+    case kAST_DivAssign:
+    case kAST_ModAssign:
+    case kAST_LShiftAssign:
+    case kAST_RShiftAssign:
+    case kAST_AndAssign:
+    case kAST_XorAssign:
+    case kAST_OrAssign:
+        return assign(pAst, reg);
+
+    case kAST_FunctionCall:
+        if (!(pAst->pSymRecRef->flags & kSRFL_BuiltInFunction))
+        {
+            error(pAst, "Script function calls");
+            return kVT_Int;
+        }
+        return call(pAst->pSymRecRef->pAst->str, pAst->pRhs->pChildren, reg);
+    case kAST_SystemCall:
+        return call(pAst->str, pAst->pRhs->pChildren, reg);
+
+    case kAST_SymbolDecl:
+        error(pAst, "Declarations within expressions");
+        return kVT_Int;
+
+    default:
+        error(pAst, "This expression type");
+        return kVT_Int;
+    }
+}
+
+CodegenBytecode::ValType CodegenBytecode::binaryOp(const Ast * pAst, u32 reg)
+{
+    ValType lhsType = expr(pAst->pLhs, reg);
+    u32 rhs = pushReg();
+    ValType rhsType = expr(pAst->pRhs, rhs);
+    ValType valType = arith(pAst->type, reg, reg, lhsType, rhs, rhsType);
+    popReg(rhs);
+    return valType;
+}
+
+CodegenBytecode::ValType CodegenBytecode::arith(AstType astType, u32 dst, u32 lhs, ValType lhsType, u32 rhs, ValType rhsType)
+{
+    // Mixed operands promote to float, like C
+    bool isFloat = lhsType == kVT_Float || rhsType == kVT_Float;
+    if (isFloat)
+    {
+        coerce(lhs, lhsType, kVT_Float);
+        coerce(rhs, rhsType, kVT_Float);
+    }
+
+    u32 op = eOpcode_COUNT;
+    ValType valType = isFloat ? kVT_Float : kVT_Int;
+
+    switch (astType)
+    {
+    case kAST_Add:
+    case kAST_AddAssign:
+        op = isFloat ? eOpcode_FADD : eOpcode_ADD;
+        break;
+    case kAST_Sub:
+    case kAST_SubAssign:
+        op = isFloat ? eOpcode_FSUB : eOpcode_SUB;
+        break;
+    case kAST_Mul:
+    case kAST_MulAssign:
+        op = isFloat ? eOpcode_FMUL : eOpcode_MUL;
+        break;
+    case kAST_Div:
+    case kAST_DivAssign:
+        op = isFloat ? eOpcode_FDIV : eOpcode_DIV;
+        break;
+    case kAST_Mod:
+    case kAST_ModAssign:
+        op = eOpcode_MOD;
+        break;
+    case kAST_LShift:
+    case kAST_LShiftAssign:
+        op = eOpcode_LSHIFT;
+        break;
+    case kAST_RShift:
+    case kAST_RShiftAssign:
+        op = eOpcode_RSHIFT;
+        break;
+    case kAST_BitAnd:
+    case kAST_AndAssign:
+        op = eOpcode_AND;
+        break;
+    case kAST_BitOr:
+    case kAST_OrAssign:
+        op = eOpcode_OR;
+        break;
+    case kAST_BitXor:
+    case kAST_XorAssign:
+        op = eOpcode_XOR;
+        break;
+    case kAST_Eq:
+        op = isFloat ? eOpcode_FEQ : eOpcode_EQ;
+        valType = kVT_Int;
+        break;
+    case kAST_NEq:
+        op = isFloat ? eOpcode_FNEQ : eOpcode_NEQ;
+        valType = kVT_Int;
+        break;
+    case kAST_LT:
+        op = isFloat ? eOpcode_FLT : eOpcode_LT;
+        valType = kVT_Int;
+        break;
+    case kAST_LTE:
+        op = isFloat ? eOpcode_FLTE : eOpcode_LTE;
+        valType = kVT_Int;
+        break;
+    case kAST_GT:
+        op = isFloat ? eOpcode_FGT : eOpcode_GT;
+        valType = kVT_Int;
+        break;
+    case kAST_GTE:
+        op = isFloat ? eOpcode_FGTE : eOpcode_GTE;
+        valType = kVT_Int;
+        break;
+    default:
+        PANIC("Invalid arithmetic AstType: %d", astType);
+        return kVT_Int;
+    }
+
+    if (isFloat && (op == eOpcode_MOD ||
+                    op == eOpcode_LSHIFT ||
+                    op == eOpcode_RSHIFT ||
+                    op == eOpcode_AND ||
+                    op == eOpcode_OR ||
+                    op == eOpcode_XOR))
+    {
+        COMP_ERROR(mpParseData, "Integer operator applied to float in bytecode component");
+        return kVT_Int;
+    }
+
+    emit(op, dst, lhs, rhs);
+    return valType;
+}
+
+CodegenBytecode::ValType CodegenBytecode::logicalOp(const Ast * pAst, u32 reg)
+{
+    // Short circuit, leaving 0 or 1 in reg
+    toBool(reg, expr(pAst->pLhs, reg));
+    u32 brEnd = emitBranch(pAst->type == kAST_And ? eOpcode_BRZ : eOpcode_BRNZ, reg);
+    toBool(reg, expr(pAst->pRhs, reg));
+    patchBranch(brEnd, here());
+    return kVT_Int;
+}
+
+CodegenBytecode::ValType CodegenBytecode::incDec(const Ast * pTarget, u32 reg, bool isInc, bool isPost)
+{
+    if (pTarget->type != kAST_SymbolRef || !pTarget->pSymRecRef)
+    {
+        error(pTarget, "Increment of non symbol");
+        return kVT_Int;
+    }
+
+    const SymRec * pSymRec = pTarget->pSymRecRef;
+    ValType valType = load(pSymRec, reg);
+
+    u32 tmp = pushReg();
+    if (valType == kVT_Float)
+    {
+        loadFloat(tmp, 1.0f);
+        emit(isInc ? eOpcode_FADD : eOpcode_FSUB, tmp, reg, tmp);
+    }
+    else
+    {
+        emit(isInc ? eOpcode_ADDI : eOpcode_SUBI, tmp, reg, 1);
+    }
+    store(pSymRec, tmp, valType);
+    if (!isPost)
+        emit(eOpcode_MOV, reg, tmp, 0);
+    popReg(tmp);
+
+    return valType;
+}
+
+CodegenBytecode::ValType CodegenBytecode::assign(const Ast * pAst, u32 reg)
+{
+    const SymRec * pSymRec = pAst->pSymRecRef;
+    if (!pSymRec)
+    {
+        COMP_ERROR(pAst->pParseData, "Unknown symbol: %s", pAst->str);
+        return kVT_Int;
+    }
+
+    ValType valType;
+    if (pAst->type == kAST_Assign)
+    {
+        valType = expr(pAst->pRhs, reg);
+    }
+    else
+    {
+        ValType lhsType = load(pSymRec, reg);
+        u32 rhs = pushReg();
+        ValType rhsType = expr(pAst->pRhs, rhs);
+        valType = arith(pAst->type, reg, reg, lhsType, rhs, rhsType);
+        popReg(rhs);
+    }
+
+    coerce(reg, valType, symType(pSymRec));
+    store(pSymRec, reg, symType(pSymRec));
+    return symType(pSymRec);
+}
+
+CodegenBytecode::ValType CodegenBytecode::call(const char * name, const AstList * pParams, u32 reg)
+{
+    // Only calls the VM is guaranteed to provide, anything else would
+    // compile here and then fail to load.
+    const ScriptSyscallDesc * pDesc = find_script_syscall(name);
+    if (!pDesc)
+    {
+        COMP_ERROR(mpParseData, "System call %s not supported by bytecode backend", name);
+        return kVT_Int;
+    }
+
+    const char * argTypes = pDesc->signature + 1;
+    if (pParams->nodes.size() != strlen(argTypes))
+    {
+        COMP_ERROR(mpParseData, "Wrong number of arguments to %s for bytecode component", name);
+        return kVT_Int;
+    }
+    ASSERT(pParams->nodes.size() <= kVmArgRegCount);
+
+    // Evaluate into temporaries first since evaluating one argument
+    // could make a nested call and clobber the argument registers.
+    u32 firstArg = mNextReg;
+    u32 argIdx = 0;
+    for (const Ast * pParam : pParams->nodes)
+    {
+        u32 argReg = pushReg();
+        ValType argType = expr(pParam, argReg);
+        if (argTypes[argIdx] == 'b')
+            toBool(argReg, argType);
+        else
+            coerce(argReg, argType, argTypes[argIdx] == 'f' ? kVT_Float : kVT_Int);
+        argIdx++;
+    }
+    for (u32 i = 0; i < pParams->nodes.size(); ++i)
+        emit(eOpcode_MOV, kVmFirstArgReg + i, firstArg + i, 0);
+    for (u32 i = (u32)pParams->nodes.size(); i > 0; --i)
+        popReg(firstArg + i - 1);
+
+    emit(eOpcode_SYSCALL, 0, 0, importIndex(HASH::hash_func(name)));
+    emit(eOpcode_MOV, reg, kVmFirstArgReg, 0);
+
+    return pDesc->signature[0] == 'f' ? kVT_Float : kVT_Int;
+}
+
+CodegenBytecode::ValType CodegenBytecode::load(const SymRec * pSymRec, u32 reg)
+{
+    switch (pSymRec->type)
+    {
+    case kSYMT_Property:
+    case kSYMT_Field:
+        emit(eOpcode_LOADB, reg, 0, blockCellAddress(pSymRec));
+        break;
+    case kSYMT_Local:
+    {
+        auto it = mLocalRegs.find(pSymRec);
+        PANIC_IF(it == mLocalRegs.end(), "Local not allocated a register: %s", pSymRec->name);
+        emit(eOpcode_MOV, reg, it->second, 0);
+        break;
+    }
+    case kSYMT_Param:
+        // Only param in scope of a component's code is update's delta
+        ASSERT(strcmp(pSymRec->name, "delta") == 0);
+        emit(eOpcode_MOV, reg, kVmDeltaReg, 0);
+        break;
+    case kSYMT_MessageParam:
+    {
+        const BlockInfo * pBlockInfo = pSymRec->pAst->pBlockInfos->find(pSymRec->pAst);
+        if (!pBlockInfo || (pSymRec->flags & kSRFL_Member))
+        {
+            error(pSymRec->pAst, "Message param members");
+            break;
+        }
+        if (pBlockInfo->isPayload)
+            emit(eOpcode_LOADP, reg, 0, 0);
+        else
+            emit(eOpcode_LOADM, reg, 0, pBlockInfo->blockIndex * kCellsPerBlock + pBlockInfo->cellIndex);
+        break;
+    }
+    default:
+        error(pSymRec->pAst, "References to this symbol type");
+        break;
+    }
+    return symType(pSymRec);
+}
+
+void CodegenBytecode::store(const SymRec * pSymRec, u32 reg, ValType valType)
+{
+    coerce(reg, valType, symType(pSymRec));
+
+    switch (pSymRec->type)
+    {
+    case kSYMT_Property:
+    case kSYMT_Field:
+        emit(eOpcode_STOREB, reg, 0, blockCellAddress(pSymRec));
+        break;
+    case kSYMT_Local:
+    {
+        auto it = mLocalRegs.find(pSymRec);
+        PANIC_IF(it == mLocalRegs.end(), "Local not allocated a register: %s", pSymRec->name);
+        emit(eOpcode_MOV, it->second, reg, 0);
+        break;
+    }
+    case kSYMT_Param:
+        emit(eOpcode_MOV, kVmDeltaReg, reg, 0);
+        break;
+    default:
+        error(pSymRec->pAst, "Assignment to this symbol type");
+        break;
+    }
+}
+
+void CodegenBytecode::coerce(u32 reg, ValType from, ValType to)
+{
+    if (from == kVT_Int && to == kVT_Float)
+        emit(eOpcode_ITOF, reg, reg, 0);
+    else if (from == kVT_Float && to == kVT_Int)
+        emit(eOpcode_FTOI, reg, reg, 0);
+}
+
+void CodegenBytecode::toBool(u32 reg, ValType valType)
+{
+    if (valType == kVT_Float)
+    {
+        u32 zero = pushReg();
+        loadInt(zero, 0);
+        emit(eOpcode_ITOF, zero, zero, 0);
+        emit(eOpcode_FNEQ, reg, reg, zero);
+        popReg(zero);
+    }
+    else
+    {
+        // !!reg
+        emit(eOpcode_NOT, reg, reg, 0);
+        emit(eOpcode_NOT, reg, reg, 0);
+    }
+}
+
+void CodegenBytecode::loadInt(u32 reg, i32 val)
+{
+    if (val >= -32768 && val <= 32767)
+    {
+        emit(eOpcode_LOADI, reg, 0, static_cast<u32>(val) & 0xffff);
+    }
+    else
+    {
+        emit(eOpcode_LOADC, reg, 0, 0);
+        mCode.push_back(static_cast<u32>(val));
+    }
+}
+
+void CodegenBytecode::loadFloat(u32 reg, f32 val)
+{
+    cell c;
+    c.f = val;
+    emit(eOpcode_LOADC, reg, 0, 0);
+    mCode.push_back(c.u);
+}
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+u32 CodegenBytecode::pushReg()
+{
+    if (mNextReg >= kVmRegisterCount)
+    {
+        COMP_ERROR(mpParseData, "Expression too complex for bytecode component, out of registers");
+        return kVmRegisterCount - 1;
+    }
+    return mNextReg++;
+}
+
+void CodegenBytecode::popReg(u32 reg)
+{
+    // Registers are allocated as a stack
+    ASSERT(reg == mNextReg - 1);
+    mNextReg--;
+}
+
+u32 CodegenBytecode::emit(u32 opcode, u32 arg0, u32 arg1, u32 arg2)
+{
+    u32 loc = here();
+    mCode.push_back(inst(opcode, arg0, arg1, arg2));
+    return loc;
+}
+
+u32 CodegenBytecode::emitBranch(u32 opcode, u32 arg0)
+{
+    // Target patched later with patchBranch
+    return emit(opcode, arg0, 0, 0);
+}
+
+void CodegenBytecode::patchBranch(u32 branchLoc, u32 target)
+{
+    ASSERT(branchLoc < mCode.size());
+    if (target > kMaxCodeCount)
+    {
+        COMP_ERROR(mpParseData, "Branch target out of range in bytecode component");
+        return;
+    }
+    mCode[branchLoc] = (mCode[branchLoc] & 0xffff) | (target << 16);
+}
+
+u32 CodegenBytecode::importIndex(u32 nameHash)
+{
+    auto it = std::find(mImports.begin(), mImports.end(), nameHash);
+    if (it != mImports.end())
+        return (u32)(it - mImports.begin());
+    mImports.push_back(nameHash);
+    return (u32)mImports.size() - 1;
+}
+
+u32 CodegenBytecode::blockCellAddress(const SymRec * pSymRec)
+{
+    const BlockInfo * pBlockInfo = mpCompAst->pBlockInfos->find(pSymRec->pAst);
+    if (!pBlockInfo || (pSymRec->flags & kSRFL_Member))
+    {
+        error(pSymRec->pAst, "Property and field members");
+        return 0;
+    }
+    return pBlockInfo->blockIndex * kCellsPerBlock + pBlockInfo->cellIndex;
+}
+
+CodegenBytecode::ValType CodegenBytecode::symType(const SymRec * pSymRec)
+{
+    return pSymRec->pSymDataType->typeDesc.dataType == kDT_float ? kVT_Float : kVT_Int;
+}
+
+bool CodegenBytecode::isCellType(const SymDataType * pSdt)
+{
+    DataType dt = pSdt->typeDesc.dataType;
+    return dt == kDT_bool || dt == kDT_int || dt == kDT_float;
+}
+
+void CodegenBytecode::error(const Ast * pAst, const char * what)
+{
+    COMP_ERROR(pAst ? pAst->pParseData : mpParseData, "%s not supported by bytecode backend", what);
+}
+
+} // namespace gaen
@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+// CodegenBytecode.h - Bytecode generation for the Compose script VM
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+#ifndef GAEN_COMPOSE_CODEGEN_BYTECODE_H
+#define GAEN_COMPOSE_CODEGEN_BYTECODE_H
+
+#include "gaen/core/Vector.h"
+#include "gaen/core/HashMap.h"
+#include "gaen/core/String.h"
+
+#include "gaen/compose/compiler.h"
+#include "gaen/compose/compiler_structs.h"
+#include "gaen/compose/codegen_utils.h"
+#include "gaen/compose/opcode.h"
+
+namespace gaen
+{
+
+struct CodeBytecode
+{
+    String<kMEM_Compose> name; // full component name, e.g. "gaen.shapes.Box"
+    Vector<kMEM_Compose, u32> cells; // Program, as loaded by ScriptProgram
+};
+
+// Compiles components to bytecode for engine/ScriptVm.
+//
+// Only a subset of Compose is supported, components whose properties,
+// fields, locals, and message parameters are cell sized (int, float,
+// bool), with no input blocks, functions, entity creation, or message
+// sending, and only the system calls in kScriptSyscalls. Anything else,
+// entities included, is reported as a compile error, use CodegenCpp
+// for those.
+class CodegenBytecode
+{
+public:
+    typedef Vector<kMEM_Compose, CodeBytecode> CodeBytecodeList;
+    CodeBytecodeList codegen(ParseData * pParseData);
+
+private:
+    enum ValType
+    {
+        kVT_Int,  // bool and int share integer ops
+        kVT_Float
+    };
+
+    struct Handler
+    {
+        u32 msgId;
+        u32 entry;
+        u32 blockCount;
+    };
+
+    CodeBytecode codegenComponent(const Ast * pCompAst);
+
+    u32 codegenInitData(const Ast * pCompAst, ScriptDataCategory dataCategory);
+    u32 codegenPropertySetter(const Ast * pPropAst);
+
+    void beginEntry();
+    void endEntry();
+
+    void stmt(const Ast * pAst);
+    void declare(const Ast * pAst);
+    ValType expr(const Ast * pAst, u32 reg);
+    ValType binaryOp(const Ast * pAst, u32 reg);
+    ValType logicalOp(const Ast * pAst, u32 reg);
+    ValType incDec(const Ast * pTarget, u32 reg, bool isInc, bool isPost);
+    ValType assign(const Ast * pAst, u32 reg);
+    ValType call(const char * name, const AstList * pParams, u32 reg);
+    ValType load(const SymRec * pSymRec, u32 reg);
+    void store(const SymRec * pSymRec, u32 reg, ValType valType);
+    ValType arith(AstType astType, u32 dst, u32 lhs, ValType lhsType, u32 rhs, ValType rhsType);
+
+    void coerce(u32 reg, ValType from, ValType to);
+    void toBool(u32 reg, ValType valType);
+    void loadInt(u32 reg, i32 val);
+    void loadFloat(u32 reg, f32 val);
+
+    u32 pushReg();
+    void popReg(u32 reg);
+
+    u32 emit(u32 opcode, u32 arg0, u32 arg1, u32 arg2);
+    u32 emitBranch(u32 opcode, u32 arg0);
+    void patchBranch(u32 branchLoc, u32 target);
+    u32 here() const { return (u32)mCode.size(); }
+
+    u32 importIndex(u32 nameHash);
+    u32 blockCellAddress(const SymRec * pSymRec);
+    ValType symType(const SymRec * pSymRec);
+    bool isCellType(const SymDataType * pSdt);
+    void error(const Ast * pAst, const char * what);
+
+    const Ast * mpCompAst = nullptr;
+    ParseData * mpParseData = nullptr;
+
+    Vector<kMEM_Compose, u32> mCode;
+    Vector<kMEM_Compose, u32> mImports;
+    Vector<kMEM_Compose, Handler> mHandlers;
+
+    HashMap<kMEM_Compose, const SymRec*, u32> mLocalRegs;
+    u32 mNextReg = kVmFirstLocalReg;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_COMPOSE_CODEGEN_BYTECODE_H
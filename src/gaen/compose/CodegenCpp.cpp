@@ -32,6 +32,7 @@
 #include "gaen/engine/BlockMemory.h"
 #include "gaen/hashes/hashes.h"
 #include "gaen/compose/utils.h"
+#include "gaen/compose/optimize.h"
 #include "gaen/compose/CodegenCpp.h"
 
 namespace gaen
@@ -387,6 +388,79 @@ S CodegenCpp::floatLiteral(f32 val)
     return S(scratch);
 }
 
+S CodegenCpp::dispatchCase(const char * msgName, bool isHashConstant)
+{
+    static const u32 kScratchSize = 255;
+    char scratch[kScratchSize+1];
+    snprintf(scratch,
+             kScratchSize,
+             "case %u: // %s%s\n",
+             (u32)mDispatchIds.size(),
+             isHashConstant ? "HASH::" : "#",
+             msgName);
+    scratch[kScratchSize] = '\0';
+
+    mDispatchIds.push_back(DispatchId{S(msgName), isHashConstant});
+
+    return S(scratch);
+}
+
+S CodegenCpp::messageTable(int indentLevel)
+{
+    static const u32 kScratchSize = 255;
+    char scratch[kScratchSize+1];
+
+    CompVector<u32> msgIds;
+    for (const DispatchId & id : mDispatchIds)
+        msgIds.push_back(HASH::hash_func(id.name.c_str()));
+
+    CompVector<i32> displacements;
+    CompVector<MessageTable::Slot> slots;
+    if (!build_message_table(msgIds, displacements, slots))
+        PANIC("Unable to build message table");
+
+    S code;
+    code += I + S("static const MessageTable & message_table()\n");
+    code += I + S("{\n");
+
+    snprintf(scratch, kScratchSize, "static const i32 kDisplacements[%u] = { ", (u32)displacements.size());
+    code += I1 + S(scratch);
+    for (u32 i = 0; i < displacements.size(); ++i)
+    {
+        snprintf(scratch, kScratchSize, "%s%d", i > 0 ? ", " : "", displacements[i]);
+        code += S(scratch);
+    }
+    code += S(" };\n");
+
+    snprintf(scratch, kScratchSize, "static const MessageTable::Slot kSlots[%u] =\n", (u32)slots.size());
+    code += I1 + S(scratch);
+    code += I1 + S("{\n");
+    for (const MessageTable::Slot & slot : slots)
+    {
+        if (slot.handler == MessageTable::kNoHandler)
+        {
+            code += I2 + S("{ 0, MessageTable::kNoHandler },\n");
+        }
+        else
+        {
+            const DispatchId & id = mDispatchIds[slot.handler];
+            S msgId = id.isHashConstant ? S("HASH::") + id.name : hashLiteral(id.name.c_str());
+            snprintf(scratch, kScratchSize, ", %u },\n", slot.handler);
+            code += I2 + S("{ ") + msgId + S(scratch);
+        }
+    }
+    code += I1 + S("};\n");
+
+    snprintf(scratch, kScratchSize, "static const MessageTable kTable = { %u, kDisplacements, kSlots };\n", (u32)slots.size() - 1);
+    code += I1 + S(scratch);
+    code += I1 + S("return kTable;\n");
+    code += I + S("}\n");
+
+    mDispatchIds.clear();
+
+    return code;
+}
+
 S CodegenCpp::setPropertyHandlers(const Ast * pAst, int indentLevel)
 {
     ASSERT(pAst->type == kAST_EntityDef || pAst->type == kAST_ComponentDef);
@@ -396,7 +470,7 @@ S CodegenCpp::setPropertyHandlers(const Ast * pAst, int indentLevel)
     for (const auto & kv : pAst->pScope->pSymTab->dict)
     {
         SymRec * pSymRec = kv.second;
-        if (is_prop(pSymRec))
+        if (is_prop(pSymRec) || is_eliminated_prop(pSymRec))
         {
             hasProperty = true;
             break;
@@ -407,7 +481,7 @@ S CodegenCpp::setPropertyHandlers(const Ast * pAst, int indentLevel)
 
     if (hasProperty)
     {
-        code += I + S("case HASH::set_property:\n");
+        code += I + dispatchCase("set_property", true);
         code += I1 + S("switch (_msg.payload.u)\n");
         code += I1 + S("{\n");
         for (const Ast * pPropAst : pAst->pChildren->nodes)
@@ -501,6 +575,13 @@ S CodegenCpp::setPropertyHandlers(const Ast * pAst, int indentLevel)
                     code += I1 + S("}\n");
                 }
             }
+            else if (is_eliminated_prop(pSymRec))
+            {
+                // Never read, so there's nothing to store, but we still
+                // own the property name.
+                code += I1 + S("case ") + hashLiteral(pSymRec->name) + S(": // eliminated, never read\n");
+                code += I2 + S("return MessageResult::Consumed;\n");
+            }
         }
         code += I1 + S("}\n");
         code += I1 + S("return MessageResult::Propagate; // Invalid property\n");
@@ -687,7 +768,7 @@ S CodegenCpp::initializationMessageHandlers(const Ast * pAst, const S& postInit,
     S code;
 
     // init__
-    code += I + S("        case HASH::init__:\n");
+    code += I + S("        ") + dispatchCase("init__", true);
     code += I + S("        {\n");
     code += I + S("            // Initialize asset properties and fields to default values\n");
     code += initData(pAst, indentLevel + 2, kSDC_Asset);
@@ -696,7 +777,7 @@ S CodegenCpp::initializationMessageHandlers(const Ast * pAst, const S& postInit,
     code += I + S("        } // HASH::init__\n");
 
     // request_assets__
-    code += I + S("        case HASH::request_assets__:\n");
+    code += I + S("        ") + dispatchCase("request_assets__", true);
     code += I + S("        {\n");
     code += I + S("            // Request any assets we require\n");
     code += initAssets(pAst, indentLevel + 3);
@@ -704,7 +785,7 @@ S CodegenCpp::initializationMessageHandlers(const Ast * pAst, const S& postInit,
     code += I + S("        } // HASH::request_assets__\n");
 
     // asset_ready__
-    code += I + S("        case HASH::asset_ready__:\n");
+    code += I + S("        ") + dispatchCase("asset_ready__", true);
     code += I + S("        {\n");
     code += I + S("            // Asset is loaded and a handle to it has been sent to us\n");
     code += assetReady(pAst, indentLevel + 3);
@@ -712,7 +793,7 @@ S CodegenCpp::initializationMessageHandlers(const Ast * pAst, const S& postInit,
     code += I + S("        } // HASH::assets_ready__\n");
 
     // init_independent_data__
-    code += I + S("        case HASH::init_independent_data__:\n");
+    code += I + S("        ") + dispatchCase("init_independent_data__", true);
     code += I + S("        {\n");
     code += I + S("            // Initialize non-asset properties to default values\n");
     code += initData(pAst, indentLevel + 2, kSDC_Independent);
@@ -721,7 +802,7 @@ S CodegenCpp::initializationMessageHandlers(const Ast * pAst, const S& postInit,
     code += I + S("        } // HASH::init_independent_data__\n");
 
     // init_dependent_data__
-    code += I + S("        case HASH::init_dependent_data__:\n");
+    code += I + S("        ") + dispatchCase("init_dependent_data__", true);
     code += I + S("        {\n");
     code += I + S("            // Initialize non-asset fields to default values\n");
     code += initData(pAst, indentLevel + 2, kSDC_Dependent);
@@ -730,7 +811,7 @@ S CodegenCpp::initializationMessageHandlers(const Ast * pAst, const S& postInit,
     code += I + S("        } // HASH::init_dependent_data__\n");
 
     // fin__
-    code += I + S("        case HASH::fin__:\n");
+    code += I + S("        ") + dispatchCase("fin__", true);
     code += I + S("        {\n");
     code += I + S("            // Release any block data or handle fields and properties\n");
     code += fin(pAst, indentLevel + 3);
@@ -739,7 +820,7 @@ S CodegenCpp::initializationMessageHandlers(const Ast * pAst, const S& postInit,
 
     // transform
     code += I + S("        // LORRNOTE: Handle transform here as well (already handled in Entity) for convenience\n");
-    code += I + S("        case HASH::transform:\n");
+    code += I + S("        ") + dispatchCase("transform", true);
     code += I + S("        {\n");
     code += I + S("            messages::TransformR<T> msgr(msgAcc);\n");
     code += I + S("            pThis->self().applyTransform(msgAcc.message().source, msgr.isLocal(), msgr.transform());\n");
@@ -759,7 +840,7 @@ S CodegenCpp::messageDef(const Ast * pAst, int indentLevel)
     if (pAst->type == kAST_MessageDef &&
         pAst->pSymRec)
     {
-        code += I + S("case ") + hashLiteral(pAst->str) + S(":\n");
+        code += I + dispatchCase(pAst->str, false);
         code += I + S("{\n");
 
         bool isInit = 0 == strcmp(pAst->str, "init");
@@ -821,10 +902,26 @@ S CodegenCpp::messageDef(const Ast * pAst, int indentLevel)
         }
 
 
-        code += I1 + S("// Message body follows\n");
-        for (Ast * pChild : pAst->pChildren->nodes)
+        if (pAst->pSymRec->flags & kSRFL_Inlined)
         {
-            code += codegenRecurse(pChild, indentLevel + 1);
+            code += I1 + S("// Message body is shared with sends to self\n");
+            code += I1 + S("pThis->") + S(pAst->str) + S("__message(");
+            CompVector<const BlockInfo*> params = message_def_params(pAst);
+            for (const BlockInfo * pParam : params)
+            {
+                code += S(pParam->pAst->str);
+                if (pParam != params.back())
+                    code += S(", ");
+            }
+            code += S(");\n");
+        }
+        else
+        {
+            code += I1 + S("// Message body follows\n");
+            for (Ast * pChild : pAst->pChildren->nodes)
+            {
+                code += codegenRecurse(pChild, indentLevel + 1);
+            }
         }
 
         code += I + S("    return MessageResult::Consumed;\n");
@@ -834,6 +931,29 @@ S CodegenCpp::messageDef(const Ast * pAst, int indentLevel)
     return code;
 }
 
+S CodegenCpp::inlinedMessageDef(const Ast * pAst, int indentLevel)
+{
+    ASSERT(pAst->type == kAST_MessageDef && pAst->pSymRec && (pAst->pSymRec->flags & kSRFL_Inlined));
+
+    S code = I + S("void ") + S(pAst->str) + S("__message(");
+    CompVector<const BlockInfo*> params = message_def_params(pAst);
+    for (const BlockInfo * pParam : params)
+    {
+        code += S(pParam->pSymDataType->cppTypeStr) + S(" ") + S(pParam->pAst->str);
+        if (pParam != params.back())
+            code += S(", ");
+    }
+    code += S(")\n");
+    code += I + S("{\n");
+    code += I + S("    auto pThis = this; // maintain consistency in this pointer name so we can refer to pThis in static funcs") + LF;
+    for (Ast * pChild : pAst->pChildren->nodes)
+    {
+        code += codegenRecurse(pChild, indentLevel + 1);
+    }
+    code += I + S("} // #") + S(pAst->str) + S("\n");
+    return code;
+}
+
 S CodegenCpp::codegenInitProperties(Ast * pAst, SymTab * pPropsSymTab, const char * taskName, const char * scriptTaskName, ScriptDataCategory dataCategory, int indentLevel)
 {
     static const u32 kScratchSize = 256;
@@ -1679,6 +1799,7 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
         const Ast * pInput = find_input(pAst, 0);
         S entName = S(pAst->pSymRec->fullName);
         S entNameScript = entName + "__script";
+        mDispatchIds.clear();
 
         S code;
         code += I + S("class ") + entName + S(" : public Entity\n{\n");
@@ -1710,6 +1831,13 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
                 code += codegenRecurse(pFnc, indentLevel + 1);
         }
 
+        // Message handlers called directly by sends to self
+        for (Ast * pMsg : pAst->pChildren->nodes)
+        {
+            if (pMsg->type == kAST_MessageDef && pMsg->pSymRec && (pMsg->pSymRec->flags & kSRFL_Inlined))
+                code += inlinedMessageDef(pMsg, indentLevel + 1);
+        }
+
         // Message handlers
         S msgCode = S("");
         for (Ast * pMsg : pAst->pChildren->nodes)
@@ -1726,7 +1854,7 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
         const Ast * pCompMembers = find_component_members(pAst);
 
         code += I + S("        const Message & _msg = msgAcc.message();\n");
-        code += I + S("        switch(_msg.msgId)\n");
+        code += I + S("        switch(message_table().find(_msg.msgId))\n");
         code += I + S("        {\n");
 
         // Add initial component members
@@ -1785,11 +1913,25 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
         code += I + S("    }\n");
         code += I + S("\n");
 
+        code += messageTable(indentLevel + 1);
+        code += I + S("\n");
+
         code += I + S("private:\n");
 
         // Constructor
         code += I + S("    ") + entName + S("(u32 childCount, task_id initParentTask, task_id creatorTask, bool isVisible, u32 readyMessage)\n");
-        code += I + S("      : Entity(") + hashLiteral(entName.c_str()) + S(", childCount, 36, 36, initParentTask, creatorTask, isVisible, readyMessage) // LORRTODO use more intelligent defaults for componentsMax and blocksMax\n");
+        {
+            // Size storage for exactly what we declare, Entity grows
+            // both if components are inserted at run time.
+            const Ast * pCompMembers = find_component_members(pAst);
+            u32 componentsMax = pCompMembers ? (u32)pCompMembers->pChildren->nodes.size() : 0;
+            snprintf(scratch,
+                     kScratchSize,
+                     ", childCount, %u, %u, initParentTask, creatorTask, isVisible, readyMessage)\n",
+                     componentsMax,
+                     def_block_footprint(pAst));
+            code += I + S("      : Entity(") + hashLiteral(entName.c_str()) + S(scratch);
+        }
         code += I + S("    {\n");
 
         // Initialize mBlockSize
@@ -1850,6 +1992,10 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
                  hashLiteral(entName.c_str()) + S(", ent::") + entName + S("::construct))\n"));
         code += (I + S("        PANIC(\"Unable to register entity: ") +
                  entName + S("\");\n"));
+        code += (I + S("    if (!registry.registerMessageTable(") +
+                 hashLiteral(entNameScript.c_str()) + S(", &ent::") + entName + S("::message_table()))\n"));
+        code += (I + S("        PANIC(\"Unable to register message table: ") +
+                 entName + S("\");\n"));
         code += I + "}\n";
 
         return S("namespace ent\n{\n\n") + hashRegistration(entName) + code;
@@ -1860,6 +2006,7 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
         const Ast * pInput = find_input(pAst, 0);
         S compName = S(pAst->pSymRec->fullName);
         S compNameScript = compName + "__script";
+        mDispatchIds.clear();
 
         S code("namespace comp\n{\n\n");
         code += I + S("class ") + compName + S(" : public Component\n{\n");
@@ -1894,7 +2041,7 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
         code += I + S("    {\n");
         code += I + S("        auto pThis = this; // maintain consistency in this pointer name so we can refer to pThis in static funcs") + LF;
         code += I + S("        const Message & _msg = msgAcc.message();\n");
-        code += I + S("        switch(_msg.msgId)\n");
+        code += I + S("        switch(message_table().find(_msg.msgId))\n");
         code += I + S("        {\n");
 
         // init__, request_assets__, etc.
@@ -1914,6 +2061,9 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
         code += I + S("    }\n");
         code += I + S("\n");
 
+        code += messageTable(indentLevel + 1);
+        code += I + S("\n");
+
         code += I + S("private:\n");
 
         // Constructor
@@ -1987,6 +2137,10 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
                  hashLiteral(compName.c_str()) + S(", comp::") + compName + S("::construct))\n"));
         code += (I + S("        PANIC(\"Unable to register component: ") +
                  compName + S("\");\n"));
+        code += (I + S("    if (!registry.registerMessageTable(") +
+                 hashLiteral(compNameScript.c_str()) + S(", &comp::") + compName + S("::message_table()))\n"));
+        code += (I + S("        PANIC(\"Unable to register message table: ") +
+                 compName + S("\");\n"));
         code += I + "}\n";
 
         return code;
@@ -2629,6 +2783,29 @@ S CodegenCpp::codegenRecurse(const Ast * pAst,
     case kAST_MessageSend:
     {
         S code;
+
+        // Our own handler, call it directly once we're active.
+        // Before then, the message has to go through Entity's
+        // initialization state machine like any other.
+        if (pAst->pSymRecRef && (pAst->pSymRecRef->flags & kSRFL_Inlined))
+        {
+            code += I + S("if (pThis->self().isActivated())\n");
+            code += I + S("{\n");
+            code += I1 + S("pThis->") + S(pAst->pMid->str) + S("__message(");
+            if (pAst->pRhs && pAst->pRhs->pChildren)
+            {
+                for (const Ast * pArg : pAst->pRhs->pChildren->nodes)
+                {
+                    code += codegenRecurse(pArg, 0);
+                    if (pArg != pAst->pRhs->pChildren->nodes.back())
+                        code += S(", ");
+                }
+            }
+            code += S(");\n");
+            code += I + S("}\n");
+            code += I + S("else\n");
+        }
+
         code += I + S("{ // Send Message Block\n");
 
         ASSERT(pAst->pBlockInfos);
@@ -2878,6 +3055,7 @@ CodeCpp CodegenCpp::codegen(ParseData * pParseData)
 #ifndef IS_HEADLESS
     codeCpp.code += S("#include \"gaen/engine/InputMgr.h\"\n");
 #endif
+    codeCpp.code += S("#include \"gaen/engine/MessageTable.h\"\n");
     codeCpp.code += S("#include \"gaen/engine/Task.h\"\n");
     codeCpp.code += S("#include \"gaen/engine/Handle.h\"\n");
     codeCpp.code += S("#include \"gaen/engine/Registry.h\"\n");
@@ -29,6 +29,7 @@
 
 #include "gaen/core/String.h"
 #include "gaen/core/Set.h"
+#include "gaen/core/Vector.h"
 
 #include "gaen/compose/compiler.h"
 #include "gaen/compose/compiler_structs.h"
@@ -59,6 +60,15 @@ public:
 private:
     Set<kMEM_Compose, S> mHashes;
 
+    // Handlers of the message routine being generated, indexed by
+    // the dense handler index their case label switches on.
+    struct DispatchId
+    {
+        S name;
+        bool isHashConstant; // HASH::name rather than a hash literal
+    };
+    Vector<kMEM_Compose, DispatchId> mDispatchIds;
+
     S indent(u32 level);
     const char * cellFieldStr(const SymDataType * pSdt, ParseData * pParseData);
     void encodeString(char * enc, size_t encSize, const char * str);
@@ -72,6 +82,8 @@ private:
     S symref(const Ast * pAst, SymRec * pSymRec, ParseData * pParseData);
     S hashLiteral(const char * str);
     S floatLiteral(f32 val);
+    S dispatchCase(const char * msgName, bool isHashConstant);
+    S messageTable(int indentLevel);
     S setPropertyHandlers(const Ast * pAst, int indentLevel);
     S dataTypeInitValue(const SymDataType * pSdt, ParseData * pParseData);
     S initData(const Ast * pAst, int indentLevel, ScriptDataCategory dataCategory);
@@ -80,6 +92,7 @@ private:
     S fin(const Ast * pAst, int indentLevel);
     S initializationMessageHandlers(const Ast * pAst, const S & postInit, const S & postInitIndependent, const S & postInitDependent, int indentLevel);
     S messageDef(const Ast * pAst, int indentLevel);
+    S inlinedMessageDef(const Ast * pAst, int indentLevel);
     S codegenInitProperties(Ast * pAst, SymTab * pPropsSymTab, const char * taskName, const char * scriptTaskName, ScriptDataCategory dataCategory, int indentLevel);
     S codegenInitParentTask(const Ast * pAst);
     S codegenInitVisible(const Ast* pAst);
@@ -391,6 +391,83 @@ BlockInfos * block_pack_message_def_params(SymTab * pSymTab, ParseData * pParseD
     return pBlockInfos;
 }
 
+bool build_message_table(const CompVector<u32> & msgIds,
+                         CompVector<i32> & displacements,
+                         CompVector<MessageTable::Slot> & slots)
+{
+    // Plenty for the few dozen messages a type typically handles,
+    // buckets rarely need more than a handful of seeds.
+    static const u32 kSeedMax = 1 << 20;
+
+    u32 count = (u32)msgIds.size();
+    u32 slotCount = 1;
+    while (slotCount < count)
+        slotCount <<= 1;
+    u32 slotMask = slotCount - 1;
+
+    displacements.assign(slotCount, 0);
+    slots.assign(slotCount, MessageTable::Slot{0, MessageTable::kNoHandler});
+
+    // First level, bucket each handler by its unseeded hash
+    CompVector<CompVector<u32>> buckets(slotCount);
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (std::find(msgIds.begin(), msgIds.begin() + i, msgIds[i]) != msgIds.begin() + i)
+            return false;
+        buckets[MessageTable::mix(msgIds[i], 0) & slotMask].push_back(i);
+    }
+
+    // Place the largest buckets first while most slots are free
+    CompVector<u32> order(slotCount);
+    for (u32 b = 0; b < slotCount; ++b)
+        order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&](u32 lhs, u32 rhs) { return buckets[lhs].size() > buckets[rhs].size(); });
+
+    CompVector<u32> trial;
+    for (u32 b : order)
+    {
+        const CompVector<u32> & bucket = buckets[b];
+        if (bucket.size() == 0)
+            break;
+
+        if (bucket.size() == 1)
+        {
+            // Lone ids go straight into any free slot
+            u32 s = 0;
+            while (slots[s].handler != MessageTable::kNoHandler)
+                s++;
+            displacements[b] = -(i32)s - 1;
+            slots[s] = MessageTable::Slot{msgIds[bucket[0]], bucket[0]};
+            continue;
+        }
+
+        // Find a seed that scatters the whole bucket into free slots
+        u32 seed = 1;
+        for (; seed < kSeedMax; ++seed)
+        {
+            trial.clear();
+            for (u32 h : bucket)
+            {
+                u32 s = MessageTable::mix(msgIds[h], seed) & slotMask;
+                if (slots[s].handler != MessageTable::kNoHandler ||
+                    std::find(trial.begin(), trial.end(), s) != trial.end())
+                    break;
+                trial.push_back(s);
+            }
+            if (trial.size() == bucket.size())
+                break;
+        }
+        if (seed == kSeedMax)
+            return false;
+
+        displacements[b] = (i32)seed;
+        for (u32 i = 0; i < bucket.size(); ++i)
+            slots[trial[i]] = MessageTable::Slot{msgIds[bucket[i]], bucket[i]};
+    }
+
+    return true;
+}
+
 
 } // namespace gaen
 
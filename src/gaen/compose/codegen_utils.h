@@ -27,6 +27,7 @@
 #ifndef GAEN_COMPOSE_CODEGEN_UTILS_H
 #define GAEN_COMPOSE_CODEGEN_UTILS_H
 
+#include "gaen/engine/MessageTable.h"
 #include "gaen/compose/compiler.h"
 #include "gaen/compose/compiler_structs.h"
 
@@ -49,14 +50,14 @@ u32 calc_cell_count(const Ast * pAst);
 
 inline bool is_prop_or_field(const SymRec * pSymRec)
 {
-    return (pSymRec && (pSymRec->type == kSYMT_Property || pSymRec->type == kSYMT_Field) && !(pSymRec->flags & kSRFL_Member));
+    return (pSymRec && (pSymRec->type == kSYMT_Property || pSymRec->type == kSYMT_Field) && !(pSymRec->flags & (kSRFL_Member | kSRFL_Eliminated)));
 }
 
 ScriptDataCategory data_category(const Ast * pAst);
 
 inline bool is_prop(const SymRec * pSymRec)
 {
-    return (pSymRec && pSymRec->type == kSYMT_Property && !(pSymRec->flags & kSRFL_Member));
+    return (pSymRec && pSymRec->type == kSYMT_Property && !(pSymRec->flags & (kSRFL_Member | kSRFL_Eliminated)));
 }
 
 inline bool is_prop(const Ast * pAst)
@@ -66,7 +67,14 @@ inline bool is_prop(const Ast * pAst)
 
 inline bool is_field(const SymRec * pSymRec)
 {
-    return (pSymRec && pSymRec->type == kSYMT_Field && !(pSymRec->flags & kSRFL_Member));
+    return (pSymRec && pSymRec->type == kSYMT_Field && !(pSymRec->flags & (kSRFL_Member | kSRFL_Eliminated)));
+}
+
+// Properties removed from the Block layout still accept set_property
+// so the message doesn't fall through to other components.
+inline bool is_eliminated_prop(const SymRec * pSymRec)
+{
+    return (pSymRec && pSymRec->type == kSYMT_Property && (pSymRec->flags & kSRFL_Eliminated) && !(pSymRec->flags & kSRFL_Member));
 }
 
 inline bool is_asset_prop_or_field(const SymRec * pSymRec)
@@ -78,6 +86,13 @@ BlockInfos * block_pack_props_and_fields(Ast *pAst);
 BlockInfos * block_pack_message_params(Ast * pAst);
 BlockInfos * block_pack_message_def_params(SymTab * pSymTab, ParseData * pParseData);
 
+// Build a minimal perfect hash for msgIds where msgIds[i] maps to
+// handler i. Both output vectors are sized to the table's slot count.
+// Returns false if msgIds contains duplicates or no seed is found.
+bool build_message_table(const CompVector<u32> & msgIds,
+                         CompVector<i32> & displacements,
+                         CompVector<MessageTable::Slot> & slots);
+
 } // namespace gaen
 
 #endif // #ifndef GAEN_COMPOSE_CODEGEN_UTILS_H
@@ -0,0 +1,417 @@
+//------------------------------------------------------------------------------
+// compile_batch.cpp - Multithreaded, incremental compilation of many .cmp files
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <thread>
+
+#include "gaen/core/mem.h"
+#include "gaen/core/hashing.h"
+#include "gaen/core/String.h"
+#include "gaen/core/Vector.h"
+#include "gaen/core/Map.h"
+
+#include "gaen/compose/compiler_structs.h"
+#include "gaen/compose/comp_mem.h"
+#include "gaen/compose/CodegenCpp.h"
+#include "gaen/compose/optimize.h"
+#include "gaen/compose/compile_batch.h"
+
+namespace gaen
+{
+
+typedef String<kMEM_Compose> BatchString;
+
+static const char * kManifestFilename = "cmpc.cache";
+static const size_t kManifestLineMax = 1024;
+
+// When a worker's arena drops below this many free bytes it is reset,
+// along with its cached usings, before the next script is compiled.
+static const size_t kArenaReserve = 4 * 1024 * 1024;
+
+// Job results are kept in kMEM_Compose heap memory rather than in the
+// worker's arena since the arena may be reset between scripts.
+struct BatchDep
+{
+    BatchString path;
+    u32 hash = 0;
+};
+
+struct BatchEntry
+{
+    BatchString input;
+    BatchString output;
+    u32 hash = 0;
+    Vector<kMEM_Compose, BatchDep> deps;
+};
+
+typedef Map<kMEM_Compose, BatchString, BatchEntry> BatchManifest;
+typedef Map<kMEM_Compose, BatchString, u32> HashCache;
+
+struct BatchJob
+{
+    BatchEntry entry;
+    bool failed = false;
+};
+
+struct BatchState
+{
+    const BatchOptions * pOpts = nullptr;
+    Vector<kMEM_Compose, BatchJob*> pending;
+    std::atomic<u32> nextJob{0};
+};
+
+static bool content_hash(u32 * pHash, const BatchString & path, HashCache & hashCache)
+{
+    auto it = hashCache.find(path);
+    if (it != hashCache.end())
+    {
+        *pHash = it->second;
+        return true;
+    }
+
+    // Check existence first, a missing using just means the script is stale
+    FILE * pFile = fopen(path.c_str(), "rb");
+    if (!pFile)
+        return false;
+    fclose(pFile);
+
+    char * source = nullptr;
+    i32 length = read_file(path.c_str(), &source);
+    if (length <= 0)
+        return false;
+
+    *pHash = fnv1a_32(reinterpret_cast<const u8*>(source), length);
+    GFREE(source);
+
+    hashCache[path] = *pHash;
+    return true;
+}
+
+// Hash of everything besides the scripts themselves that affects
+// generated output: the compiler build, the system include list and
+// its contents, and options.
+static u32 build_identity(const BatchOptions & opts, HashCache & hashCache)
+{
+    BatchString ident;
+    char hashStr[16];
+
+    // Fall back to this file's build time when the compiler can't be
+    // read, which still changes whenever cmpc is rebuilt.
+    u32 compilerHash;
+    if (opts.compilerPath && content_hash(&compilerHash, BatchString(opts.compilerPath), hashCache))
+    {
+        snprintf(hashStr, sizeof(hashStr), "%08x", compilerHash);
+        ident += hashStr;
+    }
+    else
+    {
+        ident += __DATE__ " " __TIME__;
+    }
+
+    if (opts.pSystemIncludes)
+    {
+        for (const CompString & inc : *opts.pSystemIncludes)
+        {
+            u32 incHash = 0;
+            content_hash(&incHash, BatchString(inc.c_str()), hashCache);
+            snprintf(hashStr, sizeof(hashStr), "%08x", incHash);
+            ident += "\t";
+            ident += inc.c_str();
+            ident += "\t";
+            ident += hashStr;
+        }
+    }
+
+    ident += opts.optimize ? "\tO" : "\tn";
+    ident += opts.inlineSelfSends ? "s" : "";
+
+    return fnv1a_32(ident.c_str());
+}
+
+static void read_manifest(BatchManifest & manifest, u32 identity, const BatchString & path)
+{
+    FILE * pFile = fopen(path.c_str(), "r");
+    if (!pFile)
+        return;
+
+    // Format, a 'V' line with the build identity then one script per
+    // 'S' line followed by its usings:
+    //   V <tab> identity
+    //   S <tab> hash <tab> input path <tab> output path
+    //   D <tab> hash <tab> using path
+    char line[kManifestLineMax];
+
+    // A manifest from a different compiler, include set or options
+    // says nothing about current outputs, ignore all of it.
+    if (!fgets(line, kManifestLineMax, pFile) ||
+        line[0] != 'V' || line[1] != '\t' ||
+        static_cast<u32>(strtoul(line + 2, nullptr, 16)) != identity)
+    {
+        fclose(pFile);
+        return;
+    }
+
+    BatchEntry * pEntry = nullptr;
+    while (fgets(line, kManifestLineMax, pFile))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ((line[0] != 'S' && line[0] != 'D') || line[1] != '\t')
+            continue;
+
+        char * pHashEnd = nullptr;
+        u32 hash = static_cast<u32>(strtoul(line + 2, &pHashEnd, 16));
+        if (!pHashEnd || *pHashEnd != '\t')
+            continue;
+        char * pPath = pHashEnd + 1;
+
+        if (line[0] == 'S')
+        {
+            char * pOutput = strchr(pPath, '\t');
+            if (!pOutput)
+            {
+                pEntry = nullptr;
+                continue;
+            }
+            *pOutput++ = '\0';
+
+            pEntry = &manifest[BatchString(pPath)];
+            pEntry->input = pPath;
+            pEntry->output = pOutput;
+            pEntry->hash = hash;
+            pEntry->deps.clear();
+        }
+        else if (pEntry)
+        {
+            pEntry->deps.emplace_back();
+            pEntry->deps.back().path = pPath;
+            pEntry->deps.back().hash = hash;
+        }
+    }
+
+    fclose(pFile);
+}
+
+static bool write_manifest(const BatchManifest & manifest, u32 identity, const BatchString & path)
+{
+    FILE * pFile = fopen(path.c_str(), "w");
+    if (!pFile)
+        return false;
+
+    fprintf(pFile, "V\t%08x\n", identity);
+
+    for (const auto & kv : manifest)
+    {
+        const BatchEntry & entry = kv.second;
+        fprintf(pFile, "S\t%08x\t%s\t%s\n", entry.hash, entry.input.c_str(), entry.output.c_str());
+        for (const BatchDep & dep : entry.deps)
+            fprintf(pFile, "D\t%08x\t%s\n", dep.hash, dep.path.c_str());
+    }
+
+    fclose(pFile);
+    return true;
+}
+
+static bool is_up_to_date(const BatchEntry & cached, u32 hash, HashCache & hashCache)
+{
+    if (cached.hash != hash)
+        return false;
+
+    FILE * pFile = fopen(cached.output.c_str(), "rb");
+    if (!pFile)
+        return false;
+    fclose(pFile);
+
+    for (const BatchDep & dep : cached.deps)
+    {
+        u32 depHash;
+        if (!content_hash(&depHash, dep.path, hashCache) || depHash != dep.hash)
+            return false;
+    }
+    return true;
+}
+
+static void collect_usings(CompSet<const ParseData*> & usings, const ParseData * pParseData)
+{
+    for (const Using & using_ : pParseData->usings)
+    {
+        if (usings.insert(using_.pParseData).second)
+            collect_usings(usings, using_.pParseData);
+    }
+}
+
+static bool compile_job(BatchJob & job, const BatchOptions & opts)
+{
+    ParseData * pParseData = parse_file(job.entry.input.c_str(),
+                                        opts.pSystemIncludes,
+                                        opts.messageHandler);
+
+    if (!pParseData || pParseData->hasErrors)
+        return false;
+
+    if (opts.optimize)
+        optimize_ast(pParseData, opts.inlineSelfSends);
+
+    CodegenCpp codegen;
+    CodeCpp codeCpp = codegen.codegen(pParseData);
+
+    // namespace_ already has a trailing '.'
+    job.entry.output = opts.outputDir;
+    job.entry.output += "/";
+    job.entry.output += pParseData->namespace_;
+    job.entry.output += "cmpout";
+
+    FILE * pFile = fopen(job.entry.output.c_str(), "wb");
+    if (!pFile)
+    {
+        ERR("Unable to write %s", job.entry.output.c_str());
+        return false;
+    }
+    if (codeCpp.header != "")
+    {
+        fputs("/// .H SECTION\n", pFile);
+        fputs(codeCpp.header.c_str(), pFile);
+        fputs("\n", pFile);
+    }
+    fputs("/// .CPP SECTION\n", pFile);
+    fputs(codeCpp.code.c_str(), pFile);
+    fputs("\n", pFile);
+    fclose(pFile);
+
+    CompSet<const ParseData*> usings;
+    collect_usings(usings, pParseData);
+    job.entry.deps.clear();
+    for (const ParseData * pUsing : usings)
+    {
+        job.entry.deps.emplace_back();
+        job.entry.deps.back().path = pUsing->fullPath;
+    }
+
+    return true;
+}
+
+static void compile_worker(BatchState * pState)
+{
+    // Each worker gets a fresh arena of its own
+    parse_init();
+
+    for (;;)
+    {
+        u32 jobIdx = pState->nextJob.fetch_add(1);
+        if (jobIdx >= pState->pending.size())
+            break;
+
+        if (comp_avail_mem() < kArenaReserve)
+            parse_init();
+
+        BatchJob * pJob = pState->pending[jobIdx];
+        pJob->failed = !compile_job(*pJob, *pState->pOpts);
+    }
+}
+
+u32 compile_batch(const char * const * inputs,
+                  u32 inputCount,
+                  const BatchOptions & opts)
+{
+    ASSERT(opts.outputDir);
+
+    BatchString manifestPath = opts.outputDir;
+    manifestPath += "/";
+    manifestPath += kManifestFilename;
+
+    HashCache hashCache;
+    u32 identity = build_identity(opts, hashCache);
+
+    BatchManifest cached;
+    read_manifest(cached, identity, manifestPath);
+
+    Vector<kMEM_Compose, BatchJob> jobs(inputCount);
+    BatchState state;
+    state.pOpts = &opts;
+
+    for (u32 i = 0; i < inputCount; ++i)
+    {
+        BatchJob & job = jobs[i];
+        job.entry.input = inputs[i];
+
+        if (!content_hash(&job.entry.hash, job.entry.input, hashCache))
+        {
+            ERR("Unable to read %s", inputs[i]);
+            job.failed = true;
+            continue;
+        }
+
+        auto it = cached.find(job.entry.input);
+        if (it != cached.end() && is_up_to_date(it->second, job.entry.hash, hashCache))
+            job.entry = it->second;
+        else
+            state.pending.push_back(&job);
+    }
+
+    u32 threadCount = opts.threadCount > 0 ? opts.threadCount : 1;
+    if (threadCount > state.pending.size())
+        threadCount = static_cast<u32>(state.pending.size());
+
+    Vector<kMEM_Compose, std::thread> workers;
+    for (u32 i = 0; i < threadCount; ++i)
+        workers.emplace_back(compile_worker, &state);
+    for (std::thread & worker : workers)
+        worker.join();
+
+    // Record what was built against, failed scripts are left out of
+    // the manifest so they are retried next run.
+    BatchManifest manifest;
+    u32 failCount = 0;
+    for (BatchJob & job : jobs)
+    {
+        if (job.failed)
+        {
+            failCount++;
+            continue;
+        }
+        for (BatchDep & dep : job.entry.deps)
+        {
+            if (!content_hash(&dep.hash, dep.path, hashCache))
+                dep.hash = 0;
+        }
+        manifest[job.entry.input] = job.entry;
+    }
+
+    for (const BatchJob * pJob : state.pending)
+    {
+        if (!pJob->failed)
+            puts(pJob->entry.output.c_str());
+    }
+
+    if (!write_manifest(manifest, identity, manifestPath))
+        ERR("Unable to write %s", manifestPath.c_str());
+
+    return failCount;
+}
+
+} // namespace gaen
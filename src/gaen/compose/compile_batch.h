@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// compile_batch.h - Multithreaded, incremental compilation of many .cmp files
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_COMPOSE_COMPILE_BATCH_H
+#define GAEN_COMPOSE_COMPILE_BATCH_H
+
+#include "gaen/compose/compiler.h"
+
+namespace gaen
+{
+
+struct BatchOptions
+{
+    CompList<CompString> * pSystemIncludes = nullptr;
+    MessageHandler messageHandler = nullptr;
+
+    // Each script's output is written here as <dotted.script.name>.cmpout
+    // in the same "/// .H SECTION" / "/// .CPP SECTION" format cmpc
+    // prints to stdout when compiling a single file.
+    const char * outputDir = nullptr;
+
+    // Path to the running compiler, its contents identify the build
+    // that produced the cached outputs.
+    const char * compilerPath = nullptr;
+
+    u32 threadCount = 1;
+    bool optimize = true;
+    bool inlineSelfSends = false; // see optimize_ast
+};
+
+// Compile all inputs across opts.threadCount worker threads, each
+// with its own compose arena. Usings are parsed once per worker and
+// shared by every script that worker compiles.
+//
+// A manifest of content hashes for each script and the usings it
+// depends on is kept in outputDir/cmpc.cache. Scripts whose source
+// and usings are unchanged since the last run are not recompiled.
+// The manifest also records the compiler build, the system includes
+// and the options used, if any of these differ every script is
+// recompiled.
+//
+// Returns the number of scripts that failed to compile.
+u32 compile_batch(const char * const * inputs,
+                  u32 inputCount,
+                  const BatchOptions & opts);
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_COMPOSE_COMPILE_BATCH_H
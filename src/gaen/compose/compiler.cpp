@@ -56,6 +56,12 @@ static const char * kScriptsPath = "/src/scripts/cmp/";
 
 static char sEmptyStr[] = { '\0' };
 
+// Usings already parsed on this thread, keyed by full path. They live in
+// this thread's compose arena, so parse_init drops the cache along with
+// the arena that backs it.
+typedef CompMap<CompString, ParseData*> UsingCache;
+TL(UsingCache*, tpUsingCache) = nullptr;
+
 int parse_int(const char * pStr, int base)
 {
     i64 val = strtol(pStr, nullptr, base);
@@ -2968,7 +2974,9 @@ void parsedata_formatted_message(ParseData * pParseData,
     static const size_t kMessageMax = 1024;
     TLARRAY(char, tMessage, kMessageMax);
 
-    pParseData->hasErrors = true;
+    // Informational messages (e.g. optimizer reports) don't fail the compile
+    if (messageType != kMSGT_Info)
+        pParseData->hasErrors = true;
 
     va_list argptr;
     va_start(argptr, format);
@@ -3008,12 +3016,25 @@ const Using * parsedata_parse_using(ParseData * pParseData,
                                     const char * namespace_,
                                     const char * fullPath)
 {
-    ParseData * pUsingParseData = parse_file(fullPath, pParseData->pSystemIncludes, pParseData->messageHandler);
+    if (!tpUsingCache)
+        tpUsingCache = COMP_NEW(UsingCache);
 
-    if (!pUsingParseData)
+    ParseData * pUsingParseData = nullptr;
+    auto cacheIt = tpUsingCache->find(fullPath);
+    if (cacheIt != tpUsingCache->end())
     {
-        COMP_ERROR(pParseData, "Failed to parse using: %s", fullPath);
-        return nullptr;
+        pUsingParseData = cacheIt->second;
+    }
+    else
+    {
+        pUsingParseData = parse_file(fullPath, pParseData->pSystemIncludes, pParseData->messageHandler);
+
+        if (!pUsingParseData)
+        {
+            COMP_ERROR(pParseData, "Failed to parse using: %s", fullPath);
+            return nullptr;
+        }
+        (*tpUsingCache)[fullPath] = pUsingParseData;
     }
 
     Using imp;
@@ -3041,11 +3062,15 @@ const Using * parsedata_parse_using(ParseData * pParseData,
 void parse_init()
 {
     comp_reset_mem();
+    tpUsingCache = nullptr;
 
     // LORRNOTE: Uncomment below to enable stderr based debug messages from parser
     //yydebug = 1;
 }
 
+namespace gaen
+{
+
 i32 read_file(const char * path, char ** output)
 {
     *output = nullptr;
@@ -3092,7 +3117,7 @@ i32 read_file(const char * path, char ** output)
         }
         else
         {
-            source[length+1] = '\0';
+            source[length] = '\0';
         }
     }
     fclose(fp);
@@ -3101,6 +3126,8 @@ i32 read_file(const char * path, char ** output)
     return length;
 }
 
+} // namespace gaen
+
 ParseData * parse(const char * source,
                   size_t length,
                   const char * fullPath,
@@ -3111,9 +3138,9 @@ ParseData * parse(const char * source,
 
     ParseData * pParseData = parsedata_create(fullPath, pSystemIncludes, messageHandler);
 
+    char * newSource = nullptr;
     if (!source)
     {
-        char * newSource = nullptr;
         i32 len = read_file(pParseData->fullPath, &newSource);
         if (len <= 0)
         {
@@ -3135,6 +3162,10 @@ ParseData * parse(const char * source,
 
     yy_scan_bytes(source, (int)length, pParseData->pScanner);
 
+    // scanner has its own copy of the bytes now
+    if (newSource)
+        GFREE(newSource);
+
     ret = yyparse(pParseData);
 
     yylex_destroy(pParseData->pScanner);
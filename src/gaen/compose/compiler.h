@@ -502,6 +502,10 @@ void yyerror(YYLTYPE * pLoc, ParseData * pParseData, const char * format, ...);
 namespace gaen
 {
 
+// Read an entire file into a GALLOC'd, null terminated buffer.
+// Returns length read, or -1 on failure.
+i32 read_file(const char * path, char ** output);
+
 void register_basic_types(ParseData * pParseData);
 void register_builtin_functions(ParseData * pParseData);
 void register_system_apis(ParseData * pParseData);
@@ -96,7 +96,9 @@ enum SymRecFlag
     kSRFL_NeedsCppParens  = 0x0002,
     kSRFL_AssetRelated    = 0x0004,
     kSRFL_BuiltInFunction = 0x0008,
-    kSRFL_BuiltInConst    = 0x0010
+    kSRFL_BuiltInConst    = 0x0010,
+    kSRFL_Eliminated      = 0x0020, // property/field removed by optimize_ast
+    kSRFL_Inlined         = 0x0040  // message handler called directly on self sends
 };
 
 struct SymRec
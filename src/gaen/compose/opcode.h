@@ -24,44 +24,58 @@
 //   distribution.
 //------------------------------------------------------------------------------
 
-#ifndef GA_OPCODE_H
-#define GA_OPCODE_H
+#ifndef GAEN_COMPOSE_OPCODE_H
+#define GAEN_COMPOSE_OPCODE_H
 
-#include "corelib/base_types.h"
+#include <cstring>
 
-namespace ga
+#include "gaen/core/base_defines.h"
+
+namespace gaen
 {
 
 //------------------------------------------------------------------------------
 // Instructions are 32 bit and broken down as follows:
 //
-//  Bits 31 .. 16  | 15 .. 11       | 10 .. 6        | 5 .. 0  
+//  Bits 31 .. 16  | 15 .. 11       | 10 .. 6        | 5 .. 0
 //-----------------------------------------------------------------------
 //  ARG2 (16 bit)  | ARG1 (5 bits)  | ARG0 (5 bits)  | Opcode (6 bits)
 //
-// 
-// VM has 32 general puprose registers, as well as a 16 bit IP and a 16 bit SP.
+// VM has 32 general purpose registers, and a 16 bit IP.
+//
+// Code is a separate, read only, array of cells. Immediates are
+// sign extended 16 bit values, larger constants follow a LOADC in
+// the instruction stream.
+//
+// Data memory is the Block storage of the running entity or
+// component, addressed by cell (4 bytes). Message parameters are
+// read only and addressed by cell within the message blocks.
 //
-// Memory is cell addressable.  A cell is 4 bytes.
-// With 16 bit address space, max memory for a VM instances is therefore:
-//   2 ** 16 * 4 == 263144 (256k)
+// Comparisons produce 1 or 0, matching how Compose bools are stored
+// in Blocks.
 //
-// Memory is layed out with code section first, followed by global
-// data section.  Stack starts at max address and grows down.  There's
-// no heap or dynamic memory.
+// Register conventions used by the bytecode backend:
+//   r0 .. r7   - syscall arguments, r0 holds syscall return value
+//   r8         - delta during update
+//   r9 .. r31  - locals and temporaries
 //------------------------------------------------------------------------------
 
 enum eOpcode
 {
                        //    ARG0(5)    |    ARG1(5)   |    ARG2(16)    | Description
                        //-----------------------------------------------------------------------------------------------
-    eOpcode_SYSCALL,   //               |              |   Sys Func ID  | Call the system function identified in ARG2
+    eOpcode_SYSCALL,   //               |              |   Import Idx   | Call the system function at import table index ARG2
 
     // Load/Store
-    eOpcode_LOADI,     //    Reg Dest   |              |    Immediate   | Reg[ARG0] = Immediate       (Load immediate 16 bit value into dest register)
-    eOpcode_LOADC,     //    Reg Dest   |              |                | Reg[ARG0] = Cells[IP], IP++ (Load next cell in instruction stream into dest register, increment IP)
-    eOpcode_LOAD,      //    Reg Dest   | Reg Src Addr |                | Reg[ARG0] = Cells[Reg[ARG1] & 0xff]  (Load cell at cell address into dest register)
-    eOpcode_STORE,     // Reg Dest Addr |   Reg Src    |                | Cells[Reg[ARG0] & 0xff] = Reg[ARG1]   (Store cell in source register into cell address)
+    eOpcode_MOV,       //    Reg Dest   |   Reg Src    |                | Reg[ARG0] = Reg[ARG1]
+    eOpcode_LOADI,     //    Reg Dest   |              |    Immediate   | Reg[ARG0] = Immediate       (Load sign extended 16 bit value into dest register)
+    eOpcode_LOADC,     //    Reg Dest   |              |                | Reg[ARG0] = Code[IP], IP++  (Load next cell in instruction stream into dest register, increment IP)
+    eOpcode_LOAD,      //    Reg Dest   | Reg Src Addr |                | Reg[ARG0] = Cells[Reg[ARG1]]  (Load cell at cell address into dest register)
+    eOpcode_STORE,     // Reg Dest Addr |   Reg Src    |                | Cells[Reg[ARG0]] = Reg[ARG1]  (Store cell in source register into cell address)
+    eOpcode_LOADB,     //    Reg Dest   |              |    Cell Addr   | Reg[ARG0] = Cells[ARG2]
+    eOpcode_STOREB,    //    Reg Src    |              |    Cell Addr   | Cells[ARG2] = Reg[ARG0]
+    eOpcode_LOADP,     //    Reg Dest   |              |                | Reg[ARG0] = Message payload
+    eOpcode_LOADM,     //    Reg Dest   |              |    Cell Addr   | Reg[ARG0] = MessageCells[ARG2]
 
     // Bitwise
     eOpcode_COMP,      //    Reg Dest   |   Reg Src    |                | Reg[ARG0] = ~Reg[ARG1]
@@ -72,8 +86,9 @@ enum eOpcode
     eOpcode_LSHIFTI,   //    Reg Dest   |   Reg Src    |    Immediate   | Reg[ARG0] = Reg[ARG1] << Immediate
     eOpcode_RSHIFT,    //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = Reg[ARG1] >> Reg[ARG2 & 0x1f]
     eOpcode_RSHIFTI,   //    Reg Dest   |   Reg Src    |    Immediate   | Reg[ARG0] = Reg[ARG1] >> Immediate
+    eOpcode_NOT,       //    Reg Dest   |   Reg Src    |                | Reg[ARG0] = Reg[ARG1] == 0 ? 1 : 0
 
-    // Integer 
+    // Integer
     eOpcode_NEG,       //    Reg Dest   |   Reg Src    |                | Reg[ARG0] = -Reg[ARG1]
     eOpcode_ADD,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = Reg[ARG1] + Reg[ARG2 & 0x1f]
     eOpcode_ADDI,      //    Reg Dest   |   Reg Src0   |    Immediate   | Reg[ARG0] = Reg[ARG1] + Immediate
@@ -87,35 +102,48 @@ enum eOpcode
     eOpcode_MODI,      //    Reg Dest   |   Reg Src0   |    Immediate   | Reg[ARG0] = Reg[ARG1] % Immediate
 
     // Comparison
-    eOpcode_EQ,        //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] == Reg[ARG2 & 0x1f]) ? 0xffffffff : 0
-    eOpcode_NEQ,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] != Reg[ARG2 & 0x1f]) ? 0xffffffff : 0
-    eOpcode_LT,        //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] <  Reg[ARG2 & 0x1f]) ? 0xffffffff : 0
-    eOpcode_LTE,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] <= Reg[ARG2 & 0x1f]) ? 0xffffffff : 0
-    eOpcode_GT,        //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] >  Reg[ARG2 & 0x1f]) ? 0xffffffff : 0
-    eOpcode_GTE,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] >= Reg[ARG2 & 0x1f]) ? 0xffffffff : 0
+    eOpcode_EQ,        //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] == Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_NEQ,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] != Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_LT,        //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] <  Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_LTE,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] <= Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_GT,        //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] >  Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_GTE,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (Reg[ARG1] >= Reg[ARG2 & 0x1f]) ? 1 : 0
 
     // Branch/Stack/Jump
     eOpcode_BRZ,       //    Reg Src    |              |    Address     | if Reg[ARG0] == 0 then IP = Address
     eOpcode_BRNZ,      //    Reg Src    |              |    Address     | if Reg[ARG0] != 0 then IP = Address
-    eOpcode_PUSH,      //    Reg Src    |              |                | Cells[SP] = Reg[ARG0], SP--
-    eOpcode_POP,       //    Reg Dest   |              |                | Reg[ARG0] = Cells[SP], SP++
+    eOpcode_PUSH,      //    Reg Src    |              |                | Stack[SP] = Reg[ARG0], SP++
+    eOpcode_POP,       //    Reg Dest   |              |                | SP--, Reg[ARG0] = Stack[SP]
     eOpcode_JUMP,      //               |              |    Address     | IP = Address
-    eOpcode_CALL,      //               |              |    Address     | Cells[SP] = IP, SP--, IP = Address
-    eOpcode_RET,       //               |              |                | IP = Cells[SP], SP++
+    eOpcode_CALL,      //               |              |    Address     | Stack[SP] = IP, SP++, IP = Address
+    eOpcode_RET,       //               |              |                | SP--, IP = Stack[SP], or stop execution if stack is empty
 
     // Floating point
+    eOpcode_ITOF,      //    Reg Dest   |   Reg Src    |                | Reg[ARG0] = (float)(int)Reg[ARG1]
+    eOpcode_FTOI,      //    Reg Dest   |   Reg Src    |                | Reg[ARG0] = (int)(float)Reg[ARG1]
     eOpcode_FNEG,      //    Reg Dest   |   Reg Src    |                | Reg[ARG0] = -(float)Reg[ARG1]
     eOpcode_FADD,      //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (float)Reg[ARG1] + (float)Reg[ARG2 & 0x1f]
     eOpcode_FSUB,      //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (float)Reg[ARG1] - (float)Reg[ARG2 & 0x1f]
     eOpcode_FMUL,      //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (float)Reg[ARG1] * (float)Reg[ARG2 & 0x1f]
     eOpcode_FDIV,      //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = (float)Reg[ARG1] / (float)Reg[ARG2 & 0x1f]
-
-
+    eOpcode_FEQ,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = ((float)Reg[ARG1] == (float)Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_FNEQ,      //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = ((float)Reg[ARG1] != (float)Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_FLT,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = ((float)Reg[ARG1] <  (float)Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_FLTE,      //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = ((float)Reg[ARG1] <= (float)Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_FGT,       //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = ((float)Reg[ARG1] >  (float)Reg[ARG2 & 0x1f]) ? 1 : 0
+    eOpcode_FGTE,      //    Reg Dest   |   Reg Src0   |    Reg Src1    | Reg[ARG0] = ((float)Reg[ARG1] >= (float)Reg[ARG2 & 0x1f]) ? 1 : 0
 
     // not an opcode, just the total count of opcodes
     eOpcode_COUNT
 };
 
+static_assert(eOpcode_COUNT <= 0x40, "Opcodes must fit in 6 bits");
+
+static const u32 kVmRegisterCount = 32;
+static const u32 kVmFirstArgReg   = 0;
+static const u32 kVmArgRegCount   = 8;
+static const u32 kVmDeltaReg      = 8;
+static const u32 kVmFirstLocalReg = 9;
 
 inline u32 opcode(u32 inst)
 {
@@ -137,20 +165,134 @@ inline u32 arg2(u32 inst)
     return inst >> 16;
 }
 
-inline u32 inst(u32 opcode, u32 arg0, u32 arg1, u32 arg3)
+// ARG2 interpreted as a sign extended immediate
+inline i32 arg2i(u32 inst)
+{
+    return static_cast<i32>(inst) >> 16;
+}
+
+inline u32 inst(u32 opcode, u32 arg0, u32 arg1, u32 arg2)
 {
-    GA_ASSERT(opcode < 0x3f);
-    GA_ASSERT(arg0   < 0x1f);
-    GA_ASSERT(arg1   < 0x1f);
-    GA_ASSERT(arg3   < 0x10000);
-
-    u32 instruction = ( (arg3 << 16) |
-                        ((arg2 & 0x1f) << 11) |
-                        ((arg1 & 0x1f) << 6) |
+    ASSERT(opcode < eOpcode_COUNT);
+    ASSERT(arg0   <= 0x1f);
+    ASSERT(arg1   <= 0x1f);
+    ASSERT(arg2   <= 0xffff);
+
+    u32 instruction = ( (arg2 << 16) |
+                        ((arg1 & 0x1f) << 11) |
+                        ((arg0 & 0x1f) << 6) |
                         (opcode & 0x3f) );
     return instruction;
 }
 
+//------------------------------------------------------------------------------
+// Compiled program layout, as written by cmpc -b and loaded by ScriptProgram.
+// All values are u32 cells:
+//
+//   ScriptProgramHeader
+//   ScriptProgramHandler[handlerCount] - sorted by msgId
+//   u32 imports[importCount]           - name hashes of system calls
+//   u32 code[codeCount]
+//------------------------------------------------------------------------------
+static const u32 kScriptProgramMagic = 0x424d5647; // 'GVMB'
+static const u32 kScriptProgramVersion = 1;
+static const u32 kScriptProgramNoEntry = 0xffffffff;
+
+struct ScriptProgramHeader
+{
+    u32 magic;
+    u32 version;
+    u32 nameHash;      // hash of component name, the same hash registered for generated C++ components
+    u32 blockCount;    // blocks of property/field storage
+    u32 initEntry;     // code address of property/field initialization, run on init__
+    u32 updateEntry;   // code address of update, or kScriptProgramNoEntry
+    u32 handlerCount;
+    u32 importCount;
+    u32 codeCount;
+};
+
+struct ScriptProgramHandler
+{
+    u32 msgId;
+    u32 entry;         // code address of handler
+    u32 blockCount;    // message blocks required by the handler
+};
+
+//------------------------------------------------------------------------------
+// System calls available to bytecode programs, the builtin functions
+// and system_api calls whose arguments and return are cell sized.
+//
+// CodegenBytecode rejects calls to anything not listed here, and
+// ScriptVm requires every entry to be registered before programs are
+// loaded, so any call that compiles will resolve at load time.
+//
+// Signatures are the return type followed by argument types:
+// 'v' void, 'i' int, 'f' float, 'b' bool. "fff" returns a float and
+// takes two floats.
+//------------------------------------------------------------------------------
+struct ScriptSyscallDesc
+{
+    const char * name;
+    const char * signature;
+};
+
+static const ScriptSyscallDesc kScriptSyscalls[] =
+{
+    // Builtin functions, engine/ScriptVm.cpp
+    { "rand",                                "f"      },
+    { "degrees",                             "ff"     },
+    { "radians",                             "ff"     },
+    { "min",                                 "fff"    },
+    { "max",                                 "fff"    },
+    { "clamp",                               "ffff"   },
+    { "step",                                "fff"    },
+    { "smoothstep",                          "ffff"   },
+    { "lerp",                                "ffff"   },
+    { "acos",                                "ff"     },
+    { "atan",                                "ff"     },
+
+    // Engine system_api, engine/ScriptVm.cpp
+    { "exit",                                "v"      },
+    { "input_enable_mode",                   "vi"     },
+    { "input_disable_mode",                  "vi"     },
+    { "input_set_keyboard_mode",             "vi"     },
+    { "input_register_key_press_listener",   "vi"     },
+    { "input_deregister_key_press_listener", "vi"     },
+
+    // Render support system_api, render_support/script_syscalls.cpp
+    { "gen_uid",                             "i"      },
+    { "light_ambient",                       "vif"    },
+    { "light_remove",                        "vi"     },
+    { "shape_destroy",                       "vi"     },
+    { "sprite_play_anim",                    "viifbi" },
+    { "sprite_stage_show",                   "vi"     },
+    { "sprite_stage_hide",                   "vi"     },
+    { "sprite_stage_remove",                 "vi"     },
+    { "model_show",                          "vi"     },
+    { "model_hide",                          "vi"     },
+    { "model_remove_body",                   "vi"     },
+    { "model_stage_show",                    "vi"     },
+    { "model_stage_hide",                    "vi"     },
+    { "model_stage_hide_all",                "v"      },
+    { "model_stage_remove",                  "vi"     },
+    { "model_stage_remove_all",              "v"      },
+    { "model_stage_camera_scale",            "vif"    },
+    { "model_stage_camera_activate",         "vi"     },
+    { "model_stage_camera_remove",           "vi"     }
+};
+
+static const u32 kScriptSyscallCount = sizeof(kScriptSyscalls) / sizeof(kScriptSyscalls[0]);
+
+inline const ScriptSyscallDesc * find_script_syscall(const char * name)
+{
+    for (const ScriptSyscallDesc & desc : kScriptSyscalls)
+    {
+        if (0 == strcmp(desc.name, name))
+            return &desc;
+    }
+    return nullptr;
 }
 
-#endif
+} // namespace gaen
+
+#endif // #ifndef GAEN_COMPOSE_OPCODE_H
@@ -0,0 +1,798 @@
+//------------------------------------------------------------------------------
+// optimize.cpp - AST passes run between parsing and code generation
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <climits>
+#include <cstring>
+#include <algorithm>
+
+#include "gaen/engine/Block.h"
+#include "gaen/compose/compiler_structs.h"
+#include "gaen/compose/codegen_utils.h"
+#include "gaen/compose/optimize.h"
+
+namespace gaen
+{
+
+// Handler bodies larger than this many Ast nodes are always
+// dispatched through the message switch.
+static const u32 kInlineNodeMax = 48;
+
+// Deepest chain of inlined handlers sending to further inlined
+// handlers, longer chains go back through the message queue.
+static const u32 kInlineDepthMax = 4;
+
+// Messages Entity::message consumes before they reach the
+// generated message routine, these must never be short circuited.
+static const char * kEntityHandledMessages[] =
+{
+    "init",
+    "fin",
+    "set_property",
+    "transform",
+    "reparent",
+    "register_watcher",
+    "update_transform",
+    "constrain_position",
+    "ready_init",
+    "ready_notify",
+    "insert_child",
+    "insert_component",
+    "remove_child",
+    "move",
+    "rotate"
+};
+
+typedef CompSet<const SymRec*> SymRecSet;
+
+// Property defaults are only referenced from the SymRec, they aren't
+// a child of the PropertyDef Ast like field initializers are.
+static Ast * detached_init_val(const Ast * pAst)
+{
+    if (pAst->pSymRec &&
+        pAst->pSymRec->pAst == pAst &&
+        pAst->pSymRec->pInitVal != pAst->pRhs)
+    {
+        return pAst->pSymRec->pInitVal;
+    }
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Constant folding
+//------------------------------------------------------------------------------
+static void set_literal(Ast * pAst, AstType type, int numi, float numf)
+{
+    pAst->type = type;
+    pAst->numi = numi;
+    pAst->numf = numf;
+    pAst->pLhs = nullptr;
+    pAst->pRhs = nullptr;
+    pAst->pSymDataType = nullptr;
+}
+
+static bool fold_int_binary(Ast * pAst, int l, int r)
+{
+    // do wrapping arithmetic in unsigned to match what the generated
+    // C++ will do at run time without relying on signed overflow
+    u32 ul = static_cast<u32>(l);
+    u32 ur = static_cast<u32>(r);
+
+    switch (pAst->type)
+    {
+    case kAST_Add:
+        set_literal(pAst, kAST_IntLiteral, static_cast<int>(ul + ur), 0.0f);
+        return true;
+    case kAST_Sub:
+        set_literal(pAst, kAST_IntLiteral, static_cast<int>(ul - ur), 0.0f);
+        return true;
+    case kAST_Mul:
+        set_literal(pAst, kAST_IntLiteral, static_cast<int>(ul * ur), 0.0f);
+        return true;
+    case kAST_Div:
+        if (r == 0 || (l == INT_MIN && r == -1))
+            return false;
+        set_literal(pAst, kAST_IntLiteral, l / r, 0.0f);
+        return true;
+    case kAST_Mod:
+        if (r == 0 || (l == INT_MIN && r == -1))
+            return false;
+        set_literal(pAst, kAST_IntLiteral, l % r, 0.0f);
+        return true;
+    case kAST_LShift:
+        if (r < 0 || r > 31)
+            return false;
+        set_literal(pAst, kAST_IntLiteral, static_cast<int>(ul << r), 0.0f);
+        return true;
+    case kAST_RShift:
+        if (r < 0 || r > 31)
+            return false;
+        set_literal(pAst, kAST_IntLiteral, l >> r, 0.0f);
+        return true;
+    case kAST_BitAnd:
+        set_literal(pAst, kAST_IntLiteral, l & r, 0.0f);
+        return true;
+    case kAST_BitOr:
+        set_literal(pAst, kAST_IntLiteral, l | r, 0.0f);
+        return true;
+    case kAST_BitXor:
+        set_literal(pAst, kAST_IntLiteral, l ^ r, 0.0f);
+        return true;
+    case kAST_Eq:
+        set_literal(pAst, kAST_BoolLiteral, l == r, 0.0f);
+        return true;
+    case kAST_NEq:
+        set_literal(pAst, kAST_BoolLiteral, l != r, 0.0f);
+        return true;
+    case kAST_LT:
+        set_literal(pAst, kAST_BoolLiteral, l < r, 0.0f);
+        return true;
+    case kAST_LTE:
+        set_literal(pAst, kAST_BoolLiteral, l <= r, 0.0f);
+        return true;
+    case kAST_GT:
+        set_literal(pAst, kAST_BoolLiteral, l > r, 0.0f);
+        return true;
+    case kAST_GTE:
+        set_literal(pAst, kAST_BoolLiteral, l >= r, 0.0f);
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool fold_float_binary(Ast * pAst, f32 l, f32 r)
+{
+    switch (pAst->type)
+    {
+    case kAST_Add:
+        set_literal(pAst, kAST_FloatLiteral, 0, l + r);
+        return true;
+    case kAST_Sub:
+        set_literal(pAst, kAST_FloatLiteral, 0, l - r);
+        return true;
+    case kAST_Mul:
+        set_literal(pAst, kAST_FloatLiteral, 0, l * r);
+        return true;
+    case kAST_Div:
+        // leave inf/nan producing expressions for the C++ compiler
+        if (r == 0.0f)
+            return false;
+        set_literal(pAst, kAST_FloatLiteral, 0, l / r);
+        return true;
+    case kAST_Eq:
+        set_literal(pAst, kAST_BoolLiteral, l == r, 0.0f);
+        return true;
+    case kAST_NEq:
+        set_literal(pAst, kAST_BoolLiteral, l != r, 0.0f);
+        return true;
+    case kAST_LT:
+        set_literal(pAst, kAST_BoolLiteral, l < r, 0.0f);
+        return true;
+    case kAST_LTE:
+        set_literal(pAst, kAST_BoolLiteral, l <= r, 0.0f);
+        return true;
+    case kAST_GT:
+        set_literal(pAst, kAST_BoolLiteral, l > r, 0.0f);
+        return true;
+    case kAST_GTE:
+        set_literal(pAst, kAST_BoolLiteral, l >= r, 0.0f);
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool fold_bool_binary(Ast * pAst, bool l, bool r)
+{
+    switch (pAst->type)
+    {
+    case kAST_And:
+        set_literal(pAst, kAST_BoolLiteral, l && r, 0.0f);
+        return true;
+    case kAST_Or:
+        set_literal(pAst, kAST_BoolLiteral, l || r, 0.0f);
+        return true;
+    case kAST_Eq:
+        set_literal(pAst, kAST_BoolLiteral, l == r, 0.0f);
+        return true;
+    case kAST_NEq:
+        set_literal(pAst, kAST_BoolLiteral, l != r, 0.0f);
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void fold_unary(Ast * pAst)
+{
+    const Ast * pRhs = pAst->pRhs;
+
+    switch (pAst->type)
+    {
+    case kAST_Negate:
+        if (pRhs->type == kAST_IntLiteral && pRhs->numi != INT_MIN)
+            set_literal(pAst, kAST_IntLiteral, -pRhs->numi, 0.0f);
+        else if (pRhs->type == kAST_FloatLiteral)
+            set_literal(pAst, kAST_FloatLiteral, 0, -pRhs->numf);
+        break;
+    case kAST_Complement:
+        if (pRhs->type == kAST_IntLiteral)
+            set_literal(pAst, kAST_IntLiteral, ~pRhs->numi, 0.0f);
+        break;
+    case kAST_Not:
+        if (pRhs->type == kAST_BoolLiteral)
+            set_literal(pAst, kAST_BoolLiteral, !pRhs->numi, 0.0f);
+        break;
+    default:
+        break;
+    }
+}
+
+void fold_constants(Ast * pAst)
+{
+    if (!pAst)
+        return;
+
+    fold_constants(detached_init_val(pAst));
+    fold_constants(pAst->pLhs);
+    fold_constants(pAst->pMid);
+    fold_constants(pAst->pRhs);
+    if (pAst->pChildren)
+    {
+        for (Ast * pChild : pAst->pChildren->nodes)
+            fold_constants(pChild);
+    }
+
+    const Ast * pLhs = pAst->pLhs;
+    const Ast * pRhs = pAst->pRhs;
+
+    if (!pRhs || pAst->pMid || pAst->pChildren)
+        return;
+
+    if (!pLhs)
+    {
+        fold_unary(pAst);
+    }
+    // Only fold when both sides have the same literal type, mixed
+    // int/float expressions are left to the C++ compiler so that
+    // promotion rules stay exactly as they were.
+    else if (pLhs->type == pRhs->type)
+    {
+        switch (pLhs->type)
+        {
+        case kAST_IntLiteral:
+            fold_int_binary(pAst, pLhs->numi, pRhs->numi);
+            break;
+        case kAST_FloatLiteral:
+            fold_float_binary(pAst, pLhs->numf, pRhs->numf);
+            break;
+        case kAST_BoolLiteral:
+            fold_bool_binary(pAst, pLhs->numi != 0, pRhs->numi != 0);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Dead property and field elimination
+//------------------------------------------------------------------------------
+static bool has_side_effects(const Ast * pAst)
+{
+    if (!pAst)
+        return false;
+
+    switch (pAst->type)
+    {
+    case kAST_FunctionCall:
+    case kAST_SystemCall:
+    case kAST_MessageSend:
+    case kAST_EntityInit:
+    case kAST_Assign:
+    case kAST_AddAssign:
+    case kAST_SubAssign:
+    case kAST_MulAssign:
+    case kAST_DivAssign:
+    case kAST_ModAssign:
+    case kAST_LShiftAssign:
+    case kAST_RShiftAssign:
+    case kAST_AndAssign:
+    case kAST_XorAssign:
+    case kAST_OrAssign:
+    case kAST_PreInc:
+    case kAST_PreDec:
+    case kAST_PostInc:
+    case kAST_PostDec:
+        return true;
+    default:
+        break;
+    }
+
+    if (has_side_effects(pAst->pLhs) ||
+        has_side_effects(pAst->pMid) ||
+        has_side_effects(pAst->pRhs))
+    {
+        return true;
+    }
+
+    if (pAst->pChildren)
+    {
+        for (const Ast * pChild : pAst->pChildren->nodes)
+        {
+            if (has_side_effects(pChild))
+                return true;
+        }
+    }
+    return false;
+}
+
+static const SymRec * root_symrec(const SymRec * pSymRec)
+{
+    while (pSymRec->pStructSymRec)
+        pSymRec = pSymRec->pStructSymRec;
+    return pSymRec;
+}
+
+// A plain "x = expr;" statement, the only construct where a symbol
+// is written without being read.
+static bool is_store_stmt(const Ast * pAst)
+{
+    return (pAst->type == kAST_SimpleStmt &&
+            pAst->pLhs &&
+            pAst->pLhs->type == kAST_Assign &&
+            pAst->pLhs->pSymRecRef);
+}
+
+static void collect_reads(const Ast * pAst, bool isListItem, SymRecSet & reads)
+{
+    if (!pAst)
+        return;
+
+    // Stores are only recognized as statements within a block,
+    // anywhere else their target is conservatively considered read.
+    if (isListItem && is_store_stmt(pAst))
+    {
+        collect_reads(pAst->pLhs->pRhs, false, reads);
+        return;
+    }
+
+    if (pAst->pSymRecRef)
+        reads.insert(root_symrec(pAst->pSymRecRef));
+
+    collect_reads(detached_init_val(pAst), false, reads);
+    collect_reads(pAst->pLhs, false, reads);
+    collect_reads(pAst->pMid, false, reads);
+    collect_reads(pAst->pRhs, false, reads);
+    if (pAst->pChildren)
+    {
+        for (const Ast * pChild : pAst->pChildren->nodes)
+            collect_reads(pChild, true, reads);
+    }
+}
+
+static bool is_eliminable(const Ast * pDefChild)
+{
+    const SymRec * pSymRec = pDefChild->pSymRec;
+
+    if (!is_prop_or_field(pSymRec) || (pSymRec->flags & kSRFL_AssetRelated))
+        return false;
+
+    // Ref counted values and handles are released in fin__, keep
+    // them so ownership stays the same.
+    DataType dt = pSymRec->pSymDataType->typeDesc.dataType;
+    if (is_block_memory_type(pSymRec->pSymDataType) ||
+        dt == kDT_handle ||
+        dt == kDT_asset_handle)
+    {
+        return false;
+    }
+
+    // Compiler generated companions (e.g. __isAssigned) are only
+    // referenced from generated C++, never from the Ast.
+    if (strstr(pSymRec->name, "__"))
+        return false;
+
+    // pre/post run on every set_property, so the property is observed
+    if (pDefChild->type == kAST_PropertyDef && (pDefChild->pLhs || pDefChild->pMid))
+        return false;
+
+    return !has_side_effects(pSymRec->pInitVal);
+}
+
+static void remove_dead_stores(Ast * pAst)
+{
+    if (!pAst)
+        return;
+
+    remove_dead_stores(pAst->pLhs);
+    remove_dead_stores(pAst->pMid);
+    remove_dead_stores(pAst->pRhs);
+
+    if (pAst->pChildren)
+    {
+        CompList<Ast*> & nodes = pAst->pChildren->nodes;
+        for (auto it = nodes.begin(); it != nodes.end(); )
+        {
+            Ast * pStmt = *it;
+            if (is_store_stmt(pStmt) &&
+                (root_symrec(pStmt->pLhs->pSymRecRef)->flags & kSRFL_Eliminated))
+            {
+                Ast * pVal = pStmt->pLhs->pRhs;
+                if (has_side_effects(pVal))
+                {
+                    // keep the expression for its side effects
+                    ast_set_lhs(pStmt, pVal);
+                    ++it;
+                }
+                else
+                {
+                    it = nodes.erase(it);
+                }
+            }
+            else
+            {
+                remove_dead_stores(pStmt);
+                ++it;
+            }
+        }
+    }
+}
+
+void eliminate_dead_data(Ast * pDefAst)
+{
+    ASSERT(pDefAst->type == kAST_EntityDef || pDefAst->type == kAST_ComponentDef);
+
+    bool eliminated = false;
+
+    // Removing stores can leave the stored values unread, so repeat
+    // until nothing else falls out.
+    for (;;)
+    {
+        SymRecSet reads;
+        collect_reads(pDefAst, false, reads);
+
+        bool changed = false;
+        for (Ast * pChild : pDefAst->pChildren->nodes)
+        {
+            if (is_eliminable(pChild) && reads.find(pChild->pSymRec) == reads.end())
+            {
+                pChild->pSymRec->flags |= kSRFL_Eliminated;
+                changed = true;
+            }
+        }
+
+        if (!changed)
+            break;
+
+        remove_dead_stores(pDefAst);
+        eliminated = true;
+    }
+
+    if (eliminated)
+        pDefAst->pBlockInfos = block_pack_props_and_fields(pDefAst);
+}
+
+//------------------------------------------------------------------------------
+// Self message inlining
+//------------------------------------------------------------------------------
+static u32 inline_node_count(const Ast * pAst)
+{
+    if (!pAst)
+        return 0;
+
+    // Source refers to the message being handled, and a return
+    // would leave the caller rather than the handler.
+    if (pAst->type == kAST_Source || pAst->type == kAST_Return)
+        return kInlineNodeMax + 1;
+
+    u32 count = 1;
+    count += inline_node_count(pAst->pLhs);
+    count += inline_node_count(pAst->pMid);
+    count += inline_node_count(pAst->pRhs);
+    if (pAst->pChildren)
+    {
+        for (const Ast * pChild : pAst->pChildren->nodes)
+            count += inline_node_count(pChild);
+    }
+    return count;
+}
+
+CompVector<const BlockInfo*> message_def_params(const Ast * pMsgDef)
+{
+    ASSERT(pMsgDef->type == kAST_MessageDef);
+
+    // items are sorted for packing, symbol order is declaration order
+    CompVector<const BlockInfo*> params;
+    for (const BlockInfo & bi : pMsgDef->pBlockInfos->items)
+        params.push_back(&bi);
+    std::sort(params.begin(),
+              params.end(),
+              [](const BlockInfo * pLhs, const BlockInfo * pRhs) { return pLhs->pAst->pSymRec->order < pRhs->pAst->pSymRec->order; });
+    return params;
+}
+
+// Arguments must match the handler's params exactly, in declaration
+// order. Through a message the values are reinterpreted cell by
+// cell, through a direct call they'd be converted.
+static bool args_match_params(const Ast * pSend, const Ast * pMsgDef)
+{
+    CompVector<const BlockInfo*> params = message_def_params(pMsgDef);
+
+    const Ast * pArgs = pSend->pRhs;
+    size_t argCount = (pArgs && pArgs->pChildren) ? pArgs->pChildren->nodes.size() : 0;
+    if (argCount != params.size())
+        return false;
+
+    u32 i = 0;
+    for (const Ast * pArg : pArgs->pChildren->nodes)
+    {
+        const BlockInfo * pArgInfo = pSend->pBlockInfos->find(pArg);
+        if (!pArgInfo ||
+            pArgInfo->pSymDataType->typeDesc.dataType != params[i]->pSymDataType->typeDesc.dataType)
+        {
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+static bool is_self_send(const Ast * pAst)
+{
+    return (pAst->type == kAST_MessageSend &&
+            (!pAst->pLhs || pAst->pLhs->type == kAST_Self) &&
+            pAst->pMid && pAst->pMid->type == kAST_Hash);
+}
+
+static Ast * find_message_def(Ast * pEntityAst, const char * name)
+{
+    for (Ast * pChild : pEntityAst->pChildren->nodes)
+    {
+        if (pChild->type == kAST_MessageDef &&
+            pChild->pSymRec &&
+            0 == strcmp(pChild->str, name))
+        {
+            return pChild;
+        }
+    }
+    return nullptr;
+}
+
+typedef CompSet<const Ast*> InlineVisited;
+
+static bool is_inlinable_handler(Ast * pEntityAst, Ast * pMsgDef, InlineVisited & visited, u32 depth);
+
+// Sends from within an inlined body must not touch the message
+// queue, otherwise they'd be queued ahead of or behind traffic they
+// used to follow. Only sends to self that can themselves be inlined
+// are allowed, which keeps the whole chain synchronous.
+static bool sends_are_inlinable(Ast * pEntityAst, const Ast * pAst, InlineVisited & visited, u32 depth)
+{
+    if (!pAst)
+        return true;
+
+    if (pAst->type == kAST_MessageSend)
+    {
+        if (!is_self_send(pAst))
+            return false;
+        Ast * pTarget = find_message_def(pEntityAst, pAst->pMid->str);
+        if (!pTarget ||
+            !is_inlinable_handler(pEntityAst, pTarget, visited, depth + 1) ||
+            !args_match_params(pAst, pTarget))
+        {
+            return false;
+        }
+    }
+
+    if (!sends_are_inlinable(pEntityAst, pAst->pLhs, visited, depth) ||
+        !sends_are_inlinable(pEntityAst, pAst->pMid, visited, depth) ||
+        !sends_are_inlinable(pEntityAst, pAst->pRhs, visited, depth))
+    {
+        return false;
+    }
+    if (pAst->pChildren)
+    {
+        for (const Ast * pChild : pAst->pChildren->nodes)
+        {
+            if (!sends_are_inlinable(pEntityAst, pChild, visited, depth))
+                return false;
+        }
+    }
+    return true;
+}
+
+// visited holds the handlers on the current chain of sends, a
+// handler that reaches itself again would recurse on the stack
+// where the queue used to break the cycle.
+static bool is_inlinable_handler(Ast * pEntityAst, Ast * pMsgDef, InlineVisited & visited, u32 depth)
+{
+    if (pMsgDef->type != kAST_MessageDef || !pMsgDef->pSymRec)
+        return false;
+
+    if (depth >= kInlineDepthMax)
+        return false;
+
+    if (strstr(pMsgDef->str, "__"))
+        return false;
+    for (const char * name : kEntityHandledMessages)
+    {
+        if (0 == strcmp(pMsgDef->str, name))
+            return false;
+    }
+
+    if (pMsgDef->pBlockInfos->blockMemoryItemCount > 0)
+        return false;
+
+    u32 count = 0;
+    for (const Ast * pChild : pMsgDef->pChildren->nodes)
+    {
+        count += inline_node_count(pChild);
+        if (count > kInlineNodeMax)
+            return false;
+    }
+
+    if (!visited.insert(pMsgDef).second)
+        return false;
+    bool inlinable = true;
+    for (const Ast * pChild : pMsgDef->pChildren->nodes)
+    {
+        if (!sends_are_inlinable(pEntityAst, pChild, visited, depth))
+        {
+            inlinable = false;
+            break;
+        }
+    }
+    visited.erase(pMsgDef);
+    return inlinable;
+}
+
+static void inline_sends_recurse(Ast * pEntityAst, Ast * pAst)
+{
+    if (!pAst)
+        return;
+
+    if (is_self_send(pAst))
+    {
+        Ast * pMsgDef = find_message_def(pEntityAst, pAst->pMid->str);
+        if (pMsgDef)
+        {
+            InlineVisited visited;
+            if (is_inlinable_handler(pEntityAst, pMsgDef, visited, 0) && args_match_params(pAst, pMsgDef))
+            {
+                pAst->pSymRecRef = pMsgDef->pSymRec;
+                pMsgDef->pSymRec->flags |= kSRFL_Inlined;
+            }
+        }
+    }
+
+    inline_sends_recurse(pEntityAst, pAst->pLhs);
+    inline_sends_recurse(pEntityAst, pAst->pMid);
+    inline_sends_recurse(pEntityAst, pAst->pRhs);
+    if (pAst->pChildren)
+    {
+        for (Ast * pChild : pAst->pChildren->nodes)
+            inline_sends_recurse(pEntityAst, pChild);
+    }
+}
+
+void inline_self_messages(Ast * pEntityAst)
+{
+    // Only entities, a component's self sends go through the entity
+    // and any other component may consume them first.
+    ASSERT(pEntityAst->type == kAST_EntityDef);
+    inline_sends_recurse(pEntityAst, pEntityAst);
+}
+
+//------------------------------------------------------------------------------
+// Driver and reporting
+//------------------------------------------------------------------------------
+void optimize_ast(ParseData * pParseData, bool inlineSelfSends)
+{
+    ASSERT(pParseData && pParseData->pRootAst);
+
+    Ast * pRootAst = pParseData->pRootAst;
+
+    fold_constants(pRootAst);
+
+    for (Ast * pDef : pRootAst->pChildren->nodes)
+    {
+        if (pDef->type == kAST_EntityDef || pDef->type == kAST_ComponentDef)
+            eliminate_dead_data(pDef);
+    }
+
+    if (inlineSelfSends)
+    {
+        for (Ast * pDef : pRootAst->pChildren->nodes)
+        {
+            if (pDef->type == kAST_EntityDef)
+                inline_self_messages(pDef);
+        }
+    }
+}
+
+u32 def_block_footprint(const Ast * pDefAst)
+{
+    ASSERT(pDefAst->type == kAST_EntityDef || pDefAst->type == kAST_ComponentDef);
+    ASSERT(pDefAst->pBlockInfos);
+
+    u32 blockCount = pDefAst->pBlockInfos->blockCount;
+
+    if (pDefAst->type == kAST_EntityDef)
+    {
+        const Ast * pCompMembers = find_component_members(pDefAst);
+        if (pCompMembers)
+        {
+            for (const Ast * pCompMember : pCompMembers->pChildren->nodes)
+            {
+                const SymRec * pCompSymRec = pCompMember->pSymRecRef;
+                if (pCompSymRec && pCompSymRec->pAst && pCompSymRec->pAst->pBlockInfos)
+                    blockCount += pCompSymRec->pAst->pBlockInfos->blockCount;
+            }
+        }
+    }
+
+    return blockCount;
+}
+
+void report_block_footprint(ParseData * pParseData)
+{
+    ASSERT(pParseData && pParseData->pRootAst);
+
+    for (const Ast * pDef : pParseData->pRootAst->pChildren->nodes)
+    {
+        if (pDef->type != kAST_EntityDef && pDef->type != kAST_ComponentDef)
+            continue;
+
+        CompString eliminated;
+        for (const Ast * pChild : pDef->pChildren->nodes)
+        {
+            if (pChild->pSymRec &&
+                (pChild->pSymRec->flags & kSRFL_Eliminated) &&
+                !(pChild->pSymRec->flags & kSRFL_Member))
+            {
+                eliminated += eliminated.empty() ? " (eliminated: " : ", ";
+                eliminated += pChild->pSymRec->name;
+            }
+        }
+        if (!eliminated.empty())
+            eliminated += ")";
+
+        u32 ownBlocks = pDef->pBlockInfos->blockCount;
+        u32 totalBlocks = def_block_footprint(pDef);
+
+        COMP_INFO(pParseData,
+                  "%s %s: %u blocks, %u bytes, %u with components%s",
+                  pDef->type == kAST_EntityDef ? "entity" : "component",
+                  pDef->pSymRec->fullName,
+                  ownBlocks,
+                  ownBlocks * (u32)sizeof(Block),
+                  totalBlocks * (u32)sizeof(Block),
+                  eliminated.c_str());
+    }
+}
+
+} // namespace gaen
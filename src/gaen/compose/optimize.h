@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------------
+// optimize.h - AST passes run between parsing and code generation
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_COMPOSE_OPTIMIZE_H
+#define GAEN_COMPOSE_OPTIMIZE_H
+
+#include "gaen/compose/compiler.h"
+#include "gaen/compose/compiler_structs.h"
+
+namespace gaen
+{
+
+// Run all passes over a successfully parsed file:
+//  - fold constant int/float/bool expressions
+//  - remove properties and fields that are never read and repack
+//    the Block layout of each entity and component
+//  - if inlineSelfSends, mark small #message handlers so that sends
+//    to self from within the same entity call the handler directly
+//
+// Inlining changes when a handler runs: a queued send runs after the
+// sending handler returns and after anything already queued, an
+// inlined one runs immediately in the middle of the sender. Handlers
+// that send anything other than further inlinable self sends are
+// never inlined, but scripts that rely on the deferred order must be
+// compiled without inlineSelfSends.
+void optimize_ast(ParseData * pParseData, bool inlineSelfSends);
+
+void fold_constants(Ast * pAst);
+void eliminate_dead_data(Ast * pDefAst);
+void inline_self_messages(Ast * pEntityAst);
+
+// Params of a #message handler in the order they were declared
+CompVector<const BlockInfo*> message_def_params(const Ast * pMsgDef);
+
+// Total Block count of an entity or component, including the
+// blocks of any components an entity declares.
+u32 def_block_footprint(const Ast * pDefAst);
+
+// Report final Block usage of every entity and component through
+// the ParseData's message handler as kMSGT_Info.
+void report_block_footprint(ParseData * pParseData);
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_COMPOSE_OPTIMIZE_H
@@ -0,0 +1,205 @@
+//------------------------------------------------------------------------------
+// parallel_for.cpp - Data parallel loops on a persistent worker pool
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/core/stdafx.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "gaen/core/mem.h"
+#include "gaen/core/Vector.h"
+#include "gaen/core/platutils.h"
+#include "gaen/core/thread_local.h"
+
+#include "gaen/core/parallel_for.h"
+
+namespace gaen
+{
+
+// Set while a thread is running jobs, so nested loops run serially
+// rather than waiting on the pool they're running on.
+TL(bool, tIsRunningJobs) = false;
+
+class ParallelPool
+{
+public:
+    ~ParallelPool()
+    {
+        fin();
+    }
+
+    // Returns false without running anything if the pool is busy
+    bool run(u32 jobCount, u32 threadCount, ParallelJobProc jobProc, const void * pContext)
+    {
+        std::unique_lock<std::mutex> dispatchLock(mDispatchMutex, std::try_to_lock);
+        if (!dispatchLock.owns_lock())
+            return false;
+
+        if (!mIsStarted)
+            start();
+
+        mJobProc = jobProc;
+        mpContext = pContext;
+        mJobCount = jobCount;
+        mNextJob.store(0, std::memory_order_relaxed);
+
+        u32 activeWorkers = threadCount - 1;
+        if (activeWorkers > mWorkers.size())
+            activeWorkers = static_cast<u32>(mWorkers.size());
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mActiveWorkers = activeWorkers;
+            mBusyWorkers = activeWorkers;
+            mGeneration++;
+        }
+        if (activeWorkers > 0)
+            mStartCV.notify_all();
+
+        runJobs();
+
+        // Workers still reference this loop's context until they check in
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCV.wait(lock, [this] { return mBusyWorkers == 0; });
+        return true;
+    }
+
+    void fin()
+    {
+        std::lock_guard<std::mutex> dispatchLock(mDispatchMutex);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mIsStopping = true;
+        }
+        mStartCV.notify_all();
+
+        for (std::thread & worker : mWorkers)
+            worker.join();
+        mWorkers.clear();
+        mIsStopping = false;
+        mIsStarted = false;
+    }
+
+private:
+    void start()
+    {
+        u32 workerCount = platform_core_count() - 1;
+        mWorkers.reserve(workerCount);
+        for (u32 i = 0; i < workerCount; ++i)
+            mWorkers.emplace_back(&ParallelPool::workerProc, this, i, mGeneration);
+        mIsStarted = true;
+    }
+
+    void runJobs()
+    {
+        tIsRunningJobs = true;
+        u32 jobIdx;
+        while ((jobIdx = mNextJob.fetch_add(1, std::memory_order_relaxed)) < mJobCount)
+            mJobProc(mpContext, jobIdx);
+        tIsRunningJobs = false;
+    }
+
+    void workerProc(u32 workerIdx, u32 generation)
+    {
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mStartCV.wait(lock, [&] { return mIsStopping || mGeneration != generation; });
+                if (mIsStopping)
+                    return;
+                generation = mGeneration;
+
+                // Not needed for this loop
+                if (workerIdx >= mActiveWorkers)
+                    continue;
+            }
+
+            runJobs();
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mBusyWorkers--;
+            }
+            mDoneCV.notify_one();
+        }
+    }
+
+    Vector<kMEM_Engine, std::thread> mWorkers;
+    bool mIsStarted = false;
+
+    std::mutex mDispatchMutex;
+
+    std::mutex mMutex;
+    std::condition_variable mStartCV;
+    std::condition_variable mDoneCV;
+    u32 mGeneration = 0;
+    u32 mActiveWorkers = 0;
+    u32 mBusyWorkers = 0;
+    bool mIsStopping = false;
+
+    // current loop, stable while workers are busy
+    ParallelJobProc mJobProc = nullptr;
+    const void * mpContext = nullptr;
+    u32 mJobCount = 0;
+    std::atomic<u32> mNextJob{0};
+};
+
+static ParallelPool & parallel_pool()
+{
+    static ParallelPool sPool;
+    return sPool;
+}
+
+static void run_serial(u32 jobCount, ParallelJobProc jobProc, const void * pContext)
+{
+    for (u32 jobIdx = 0; jobIdx < jobCount; ++jobIdx)
+        jobProc(pContext, jobIdx);
+}
+
+void parallel_for(u32 jobCount, u32 threadCount, ParallelJobProc jobProc, const void * pContext)
+{
+    if (threadCount == 0)
+        threadCount = platform_core_count();
+    if (threadCount > jobCount)
+        threadCount = jobCount;
+
+    if (threadCount <= 1 ||
+        tIsRunningJobs ||
+        !parallel_pool().run(jobCount, threadCount, jobProc, pContext))
+    {
+        run_serial(jobCount, jobProc, pContext);
+    }
+}
+
+void fin_parallel_for()
+{
+    parallel_pool().fin();
+}
+
+} // namespace gaen
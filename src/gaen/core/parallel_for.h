@@ -0,0 +1,66 @@
+//------------------------------------------------------------------------------
+// parallel_for.h - Data parallel loops on a persistent worker pool
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_CORE_PARALLEL_FOR_H
+#define GAEN_CORE_PARALLEL_FOR_H
+
+#include "gaen/core/base_defines.h"
+
+namespace gaen
+{
+
+typedef void(*ParallelJobProc)(const void * pContext, u32 jobIdx);
+
+// Runs jobProc for every job index in [0, jobCount), across up to
+// threadCount threads including the calling thread, 0 means one per
+// core. Returns once every job is complete.
+//
+// Jobs run on a process wide pool of worker threads, started on first
+// use and kept until fin_parallel_for, so calling this every frame
+// doesn't create threads. The pool runs one loop at a time. Calls made
+// while it's busy, from another thread or from within a job, run
+// serially on the calling thread.
+//
+// Jobs are claimed one at a time from a shared counter and must only
+// write to memory owned by their index.
+void parallel_for(u32 jobCount, u32 threadCount, ParallelJobProc jobProc, const void * pContext);
+
+template <class JobFunc>
+void parallel_for(u32 jobCount, u32 threadCount, const JobFunc & jobFunc)
+{
+    parallel_for(jobCount,
+                 threadCount,
+                 [](const void * pContext, u32 jobIdx) { (*static_cast<const JobFunc*>(pContext))(jobIdx); },
+                 &jobFunc);
+}
+
+// Stop and join the pool's workers, it is restarted if parallel_for
+// is called again.
+void fin_parallel_for();
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_CORE_PARALLEL_FOR_H
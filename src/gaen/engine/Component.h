@@ -40,6 +40,7 @@ enum class PropertyGroup
 };
 
 struct ComponentDesc;
+struct ScriptProgramSlot;
 
 class Entity;
 
@@ -53,6 +54,7 @@ public:
       : mpEntity(pEntity) {}
 
     Task & scriptTask() { return mScriptTask; }
+    const Task & scriptTask() const { return mScriptTask; }
 
 protected:
     const Entity & self() const { return *mpEntity; }
@@ -63,7 +65,11 @@ protected:
     PAD_IF_32BIT_A
     Block *mpBlocks;
     PAD_IF_32BIT_B
-    void * mpLastInputHandler = nullptr;
+    union
+    {
+        void * mpLastInputHandler = nullptr;
+        const ScriptProgramSlot * mpProgramSlot; // VmComponent only, they don't have input handlers
+    };
     PAD_IF_32BIT_C;
     f32 mLastInputHandlerDelta = 0.0f;
     u32 mBlockCount;
@@ -38,6 +38,7 @@
 #include "gaen/engine/messages/KeyPress.h"
 #include "gaen/engine/input.h"
 #include "gaen/engine/InputMgr.h"
+#include "gaen/engine/ScriptVm.h"
 
 #include "gaen/engine/Editor.h"
 
@@ -49,6 +50,7 @@ GAMEVAR_DECL_BOOL(debug_camera, false);
 
 static const ivec4 kTogglePause = key_vec(kKEY_Space);
 static const ivec4 kToggleEditor = key_vec(kKEY_GraveAccent);
+static const ivec4 kReloadScripts = key_vec(kKEY_F5);
 
 Editor::Editor()
   : mIsActive(false)
@@ -66,6 +68,10 @@ void Editor::processKeyPress(const ivec4 & keys)
         mIsPaused = !mIsPaused;
         broadcast_message(HASH::toggle_pause__, kMessageFlag_None, kEditorTaskId);
     }
+    else if (mIsActive && keys == kReloadScripts)
+    {
+        reloadScripts();
+    }
     else if (keys == kToggleEditor)
     {
         mIsActive = !mIsActive;
@@ -74,6 +80,14 @@ void Editor::processKeyPress(const ivec4 & keys)
     }
 }
 
+void Editor::reloadScripts()
+{
+    // Live components pick up the new code through their program
+    // slots on their next message or update.
+    u32 reloadCount = reload_script_programs();
+    LOG_INFO("Reloaded %u script program(s)", reloadCount);
+}
+
 void Editor::unpause()
 {
     if (mIsPaused)
@@ -130,6 +144,8 @@ void Editor::update(const FrameTime & frameTime)
         ImGui::Text("Game State: %s", mIsPaused ? "PAUSED" : "RUNNING");
         ImGui::Checkbox("Show Collision", &mShowCollision);
         ImGui::Checkbox("Debug Camera", &mDebugCamera);
+        if (ImGui::Button("Reload Scripts (F5)"))
+            reloadScripts();
         ImGui::End();
     }
 
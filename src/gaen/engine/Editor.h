@@ -45,6 +45,7 @@ public:
 
 private:
     void processKeyPress(const ivec4 & keys);
+    void reloadScripts();
     void unpause();
 
     bool mIsActive;
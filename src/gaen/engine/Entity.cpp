@@ -89,6 +89,8 @@ Entity::Entity(u32 nameHash,
 
     mComponentsMax = componentsMax;
     mComponentCount = 0;
+    mpMessageRouter = nullptr;
+    mIsRouterDirty = true;
     if (mComponentsMax > 0)
         mpComponents = (Component*)GALLOC(kMEM_Engine, sizeof(Component) * mComponentsMax);
     else
@@ -328,17 +330,17 @@ MessageResult Entity::message(const T & msgAcc)
             }
             else
             {
-                MessageResult res = mScriptTask.message(msgAcc);
+                if (mIsRouterDirty)
+                    rebuildMessageRouter();
 
-                if (res == MessageResult::Propagate)
+                // Only tasks with properties handle set_property
+                u32 routeCount;
+                const u16 * pRoute = mpMessageRouter->find(msgId, routeCount);
+                for (u32 i = 0; i < routeCount; ++i)
                 {
-                    // Property not consumed, send to components
-                    for (u32 i = 0; i < mComponentCount; ++i)
-                    {
-                        res = mpComponents[i].scriptTask().message(msgAcc);
-                        if (res == MessageResult::Consumed)
-                            break;
-                    }
+                    Task & target = pRoute[i] == MessageRouter::kScriptTask ? mScriptTask : mpComponents[pRoute[i]].scriptTask();
+                    if (target.message(msgAcc) == MessageResult::Consumed)
+                        break;
                 }
                 return MessageResult::Consumed;
             }
@@ -439,17 +441,17 @@ MessageResult Entity::message(const T & msgAcc)
             }
             }
 
-            MessageResult res;
-
-            // Call our sub-classed message routine
-            res = mScriptTask.message(msgAcc);
-            if (res == MessageResult::Consumed && !msgAcc.message().ForcePropagate())
-                return MessageResult::Consumed;
+            if (mIsRouterDirty)
+                rebuildMessageRouter();
 
-            // Send the message to all components
-            for (u32 i = 0; i < mComponentCount; ++i)
+            // Send to our sub-classed message routine and then
+            // components, skipping any that don't handle msgId.
+            u32 routeCount;
+            const u16 * pRoute = mpMessageRouter->find(msgId, routeCount);
+            for (u32 i = 0; i < routeCount; ++i)
             {
-                res = mpComponents[i].scriptTask().message(msgAcc);
+                Task & target = pRoute[i] == MessageRouter::kScriptTask ? mScriptTask : mpComponents[pRoute[i]].scriptTask();
+                MessageResult res = target.message(msgAcc);
                 if (res == MessageResult::Consumed && !msgAcc.message().ForcePropagate())
                     return MessageResult::Consumed;
             }
@@ -1016,6 +1018,7 @@ Task& Entity::insertComponent(u32 nameHash, u32 index)
     mBlockCount += pComp->mBlockCount;
 
     mComponentCount++;
+    mIsRouterDirty = true;
 
     // HASH::init__ will be sent to component in codegen'd .cpp for component/entity
 
@@ -1050,6 +1053,7 @@ void Entity::moveComponentUp(u32 nameHash)
         Component temp = mpComponents[i];
         mpComponents[i] = mpComponents[i-1];
         mpComponents[i-1] = temp;
+        mIsRouterDirty = true;
     }
 }
 
@@ -1061,6 +1065,7 @@ void Entity::moveComponentDown(u32 nameHash)
         Component temp = mpComponents[i];
         mpComponents[i] = mpComponents[i+1];
         mpComponents[i+1] = temp;
+        mIsRouterDirty = true;
     }
 }
 
@@ -1110,9 +1115,16 @@ void Entity::removeComponent(u32 nameHash)
             }
         }
         mComponentCount--;
+        mIsRouterDirty = true;
     }
 }
 
+void Entity::rebuildMessageRouter()
+{
+    mpMessageRouter = get_registry().findMessageRouter(mScriptTask, mpComponents, mComponentCount);
+    mIsRouterDirty = false;
+}
+
 void Entity::growChildren()
 {
     u32 newMax = mpChildren ? mChildrenMax * 2 : 4;
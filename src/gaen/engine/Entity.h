@@ -35,6 +35,7 @@
 #include "gaen/engine/Task.h"
 #include "gaen/engine/Component.h"
 #include "gaen/engine/MessageQueue.h"
+#include "gaen/engine/MessageTable.h"
 #include "gaen/engine/EntityInit.h"
 
 namespace gaen
@@ -96,6 +97,7 @@ public:
     void rotate(task_id source, const mat3 & rot);
 
     bool isVisible() const { return mIsVisible; }
+    bool isActivated() const { return mInitStatus == kIS_Activated; }
     void setVisibility(bool isVisible);
 
     void constrainPosition(const vec3 & min, const vec3 & max);
@@ -188,6 +190,8 @@ protected:
     void growBlocks(u32 minSizeIncrease);
     void growChildren();
 
+    void rebuildMessageRouter();
+
     bool areAllAssetsLoaded()
     {
         ASSERT(mAssetsLoaded <= mAssetsRequested);
@@ -232,6 +236,12 @@ protected:
     u32 mComponentsMax;
     u32 mComponentCount;
 
+    // Which of mScriptTask and mpComponents handle each message,
+    // looked up on first dispatch after components change. Shared
+    // with all entities of the same makeup, owned by the Registry.
+    const MessageRouter * mpMessageRouter;
+    bool mIsRouterDirty;
+
     Block * mpBlocks;
     u32 mBlocksMax;
     u32 mBlockCount;
@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+// MessageTable.cpp - Message id to handler lookup for entities and components
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/engine/stdafx.h"
+
+#include "gaen/engine/MessageTable.h"
+
+namespace gaen
+{
+
+const u32 MessageTable::kNoHandler;
+const u16 MessageRouter::kScriptTask;
+const u16 MessageRouter::kEmptyRoute;
+
+void MessageRouter::build(const MessageTable * pScriptTable,
+                          const MessageTable * const * ppComponentTables,
+                          u32 componentCount)
+{
+    ASSERT(componentCount < kScriptTask);
+
+    // Task 0 is the script task, components follow in order
+    u32 taskCount = componentCount + 1;
+    auto taskTable = [&](u32 t) { return t == 0 ? pScriptTable : ppComponentTables[t - 1]; };
+    auto taskTarget = [](u32 t) { return t == 0 ? kScriptTask : static_cast<u16>(t - 1); };
+
+    mRoutes.clear();
+    mTargets.clear();
+    mRouteMask = 0;
+
+    // Tasks we know nothing about receive every message
+    for (u32 t = 0; t < taskCount; ++t)
+    {
+        if (!taskTable(t))
+            mTargets.push_back(taskTarget(t));
+    }
+    mDefaultStart = 0;
+    mDefaultCount = static_cast<u16>(mTargets.size());
+
+    // Upper bound on distinct ids, duplicates across tasks are common
+    // (init__, fin__, etc.) but harmless for sizing.
+    u32 idCount = 0;
+    for (u32 t = 0; t < taskCount; ++t)
+    {
+        const MessageTable * pTable = taskTable(t);
+        if (!pTable)
+            continue;
+        for (u32 s = 0; s < pTable->slotCount(); ++s)
+        {
+            if (pTable->pSlots[s].handler != MessageTable::kNoHandler)
+                idCount++;
+        }
+    }
+    if (idCount == 0)
+        return;
+
+    u32 routeCount = 2;
+    while (routeCount < idCount * 2)
+        routeCount <<= 1;
+    mRoutes.assign(routeCount, Route{0, kEmptyRoute, 0});
+    mRouteMask = routeCount - 1;
+
+    for (u32 t = 0; t < taskCount; ++t)
+    {
+        const MessageTable * pTable = taskTable(t);
+        if (!pTable)
+            continue;
+        for (u32 s = 0; s < pTable->slotCount(); ++s)
+        {
+            const MessageTable::Slot & slot = pTable->pSlots[s];
+            if (slot.handler == MessageTable::kNoHandler)
+                continue;
+
+            u32 idx = MessageTable::mix(slot.msgId, 0) & mRouteMask;
+            while (mRoutes[idx].start != kEmptyRoute && mRoutes[idx].msgId != slot.msgId)
+                idx = (idx + 1) & mRouteMask;
+
+            Route & route = mRoutes[idx];
+            if (route.start != kEmptyRoute)
+                continue; // an earlier task already routed this id
+
+            route.msgId = slot.msgId;
+            route.start = static_cast<u16>(mTargets.size());
+            for (u32 u = 0; u < taskCount; ++u)
+            {
+                const MessageTable * pOther = taskTable(u);
+                if (!pOther || pOther->find(slot.msgId) != MessageTable::kNoHandler)
+                    mTargets.push_back(taskTarget(u));
+            }
+            route.count = static_cast<u16>(mTargets.size() - route.start);
+            ASSERT(mTargets.size() < kEmptyRoute);
+        }
+    }
+}
+
+} // namespace gaen
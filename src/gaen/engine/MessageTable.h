@@ -0,0 +1,150 @@
+//------------------------------------------------------------------------------
+// MessageTable.h - Message id to handler lookup for entities and components
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_ENGINE_MESSAGETABLE_H
+#define GAEN_ENGINE_MESSAGETABLE_H
+
+#include "gaen/core/base_defines.h"
+#include "gaen/core/Vector.h"
+
+namespace gaen
+{
+
+// Minimal perfect hash from msgId to a dense handler index.
+//
+// cmpc builds one of these for each entity and component type it
+// generates (hash and displace: keys are bucketed by mix(msgId, 0),
+// and each bucket stores the seed that scatters its keys into free
+// slots). The generated message routine switches over the dense
+// handler index, and Entity uses the tables to route messages only to
+// the tasks that handle them.
+struct MessageTable
+{
+    static const u32 kNoHandler = (u32)-1;
+
+    struct Slot
+    {
+        u32 msgId;
+        u32 handler;
+    };
+
+    u32 slotMask;                 // slot count - 1, slot count is a power of 2
+    const i32 * pDisplacements;   // per bucket: 0 empty, > 0 seed, < 0 -(slot+1)
+    const Slot * pSlots;
+
+    static u32 mix(u32 key, u32 seed)
+    {
+        u32 h = key + seed * 0x9e3779b9;
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        return h;
+    }
+
+    u32 slotIndex(u32 msgId) const
+    {
+        i32 d = pDisplacements[mix(msgId, 0) & slotMask];
+        if (d < 0)
+            return static_cast<u32>(-d - 1);
+        return mix(msgId, static_cast<u32>(d)) & slotMask;
+    }
+
+    // Dense handler index, or kNoHandler if msgId isn't handled
+    u32 find(u32 msgId) const
+    {
+        const Slot & slot = pSlots[slotIndex(msgId)];
+        return slot.msgId == msgId ? slot.handler : kNoHandler;
+    }
+
+    u32 slotCount() const { return slotMask + 1; }
+};
+
+// Routes built at runtime from the MessageTables of an Entity's script
+// task and components. Entities with the same makeup share one through
+// Registry::findMessageRouter. Each msgId maps to the ordered list of
+// tasks that handle it, so dispatch never probes tasks that would just
+// return MessageResult::Propagate.
+class MessageRouter
+{
+public:
+    static const u16 kScriptTask = 0xffff;
+
+    // Tables are given in dispatch order, script task first. A null
+    // table means that task's messages are unknown (e.g. bytecode
+    // components) and it is included in every route.
+    void build(const MessageTable * pScriptTable,
+               const MessageTable * const * ppComponentTables,
+               u32 componentCount);
+
+    // Returns the ordered targets for msgId, kScriptTask or a
+    // component index, and sets count.
+    const u16 * find(u32 msgId, u32 & count) const
+    {
+        if (mRoutes.size() > 0)
+        {
+            u32 idx = MessageTable::mix(msgId, 0) & mRouteMask;
+            for (;;)
+            {
+                const Route & route = mRoutes[idx];
+                if (route.start == kEmptyRoute)
+                    break;
+                if (route.msgId == msgId)
+                {
+                    count = route.count;
+                    return mTargets.data() + route.start;
+                }
+                idx = (idx + 1) & mRouteMask;
+            }
+        }
+        count = mDefaultCount;
+        return mTargets.data() + mDefaultStart;
+    }
+
+private:
+    static const u16 kEmptyRoute = 0xffff;
+
+    struct Route
+    {
+        u32 msgId;
+        u16 start;
+        u16 count;
+    };
+
+    // Open addressed, linear probing, kept at most half full
+    Vector<kMEM_Engine, Route> mRoutes;
+    Vector<kMEM_Engine, u16> mTargets;
+    u32 mRouteMask = 0;
+
+    // Route for ids in no table, only tasks without a table
+    u16 mDefaultStart = 0;
+    u16 mDefaultCount = 0;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_ENGINE_MESSAGETABLE_H
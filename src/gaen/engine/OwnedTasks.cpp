@@ -0,0 +1,229 @@
+//------------------------------------------------------------------------------
+// OwnedTasks.cpp - A TaskMaster's tasks, grouped by type for update
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/engine/stdafx.h"
+
+#include "gaen/engine/OwnedTasks.h"
+
+namespace gaen
+{
+
+void OwnedTasks::reserve(u32 taskCount, u32 typeCount)
+{
+    mTasks.reserve(taskCount);
+    mTaskMap.reserve(taskCount);
+    mTaskGroups.reserve(typeCount);
+    mTaskGroupMap.reserve(typeCount);
+}
+
+void OwnedTasks::clear()
+{
+    ASSERT(!mIsUpdating);
+    mTaskMap.clear();
+    mTasks.clear();
+    mTaskGroupMap.clear();
+    mTaskGroups.clear();
+    mInactiveTasksStart = 0;
+    mUnscheduledTasksStart = 0;
+    mHasDeadTasks = false;
+}
+
+Task * OwnedTasks::find(task_id taskId)
+{
+    auto it = mTaskMap.find(taskId);
+    if (it == mTaskMap.end())
+        return nullptr;
+    ASSERT(it->second < mTasks.size());
+    return &mTasks[it->second];
+}
+
+void OwnedTasks::insert(const Task & task)
+{
+    ASSERT(mTaskMap.find(task.id()) == mTaskMap.end());
+    mTasks.push_back(task);
+    mTaskMap[task.id()] = mTasks.size() - 1;
+}
+
+bool OwnedTasks::remove(task_id taskId)
+{
+    auto it = mTaskMap.find(taskId);
+    if (it == mTaskMap.end())
+        return false;
+
+    ASSERT_MSG(!mIsUpdating, "Task removed during TaskMaster update: %u", taskId);
+
+    // Pull task to the back of mTasks and pop it off
+    unscheduleTask(it->second);
+    ASSERT(mTasks.back().id() == taskId);
+    mTasks.pop_back();
+    mTaskMap.erase(taskId);
+    return true;
+}
+
+void OwnedTasks::setStatus(task_id taskId, TaskStatus status)
+{
+    auto it = mTaskMap.find(taskId);
+    ASSERT(it != mTaskMap.end());
+    size_t taskIdx = it->second;
+    mTasks[taskIdx].setStatus(status);
+
+    if (status == TaskStatus::Dead && taskIdx < mInactiveTasksStart)
+        mHasDeadTasks = true;
+}
+
+void OwnedTasks::schedule()
+{
+    ASSERT(!mIsUpdating);
+
+    if (mHasDeadTasks)
+    {
+        for (size_t i = 0; i < mInactiveTasksStart; )
+        {
+            // unscheduleTask moves another task into position i,
+            // so only advance if we didn't remove.
+            if (mTasks[i].status() == TaskStatus::Dead)
+                unscheduleTask(i);
+            else
+                ++i;
+        }
+        mHasDeadTasks = false;
+    }
+
+    while (mUnscheduledTasksStart < mTasks.size())
+    {
+        scheduleTask();
+    }
+}
+
+void OwnedTasks::scheduleTask()
+{
+    ASSERT(mUnscheduledTasksStart < mTasks.size());
+
+    size_t hole = mUnscheduledTasksStart++;
+    Task task = mTasks[hole];
+
+    if (isScheduledForUpdate(task))
+    {
+        u32 groupIdx;
+        auto itTGM = mTaskGroupMap.find(task.nameHash());
+        if (itTGM != mTaskGroupMap.end())
+        {
+            groupIdx = itTGM->second;
+        }
+        else
+        {
+            // New task type, add an empty group just before the inactive tasks
+            groupIdx = (u32)mTaskGroups.size();
+            mTaskGroups.push_back(TaskGroup{task.nameHash(), (u32)mInactiveTasksStart, 0});
+            mTaskGroupMap[task.nameHash()] = groupIdx;
+        }
+
+        // Walk the hole back to the end of our group by moving the
+        // first task of each following range to that range's end.
+        moveTask(mInactiveTasksStart, hole);
+        hole = mInactiveTasksStart++;
+
+        for (size_t g = mTaskGroups.size() - 1; g > groupIdx; --g)
+        {
+            TaskGroup & next = mTaskGroups[g];
+            ASSERT(hole == next.start + next.count);
+            moveTask(next.start, hole);
+            hole = next.start++;
+        }
+
+        TaskGroup & group = mTaskGroups[groupIdx];
+        ASSERT(hole == group.start + group.count);
+        group.count++;
+    }
+
+    // else, hole is at the end of the inactive tasks, which is where we belong
+
+    mTasks[hole] = task;
+    mTaskMap[task.id()] = hole;
+}
+
+void OwnedTasks::unscheduleTask(size_t taskIdx)
+{
+    ASSERT(taskIdx < mTasks.size());
+
+    Task task = mTasks[taskIdx];
+    size_t hole = taskIdx;
+
+    if (taskIdx < mUnscheduledTasksStart)
+    {
+        if (taskIdx < mInactiveTasksStart)
+        {
+            auto itTGM = mTaskGroupMap.find(task.nameHash());
+            ASSERT(itTGM != mTaskGroupMap.end());
+            u32 groupIdx = itTGM->second;
+
+            // Close the hole with the last task in our group
+            TaskGroup & group = mTaskGroups[groupIdx];
+            ASSERT(taskIdx >= group.start && taskIdx < group.start + group.count);
+            group.count--;
+            moveTask(group.start + group.count, hole);
+            hole = group.start + group.count;
+
+            // Walk the hole forward by moving the last task of each
+            // following group to the slot just before that group.
+            for (size_t g = groupIdx + 1; g < mTaskGroups.size(); ++g)
+            {
+                TaskGroup & next = mTaskGroups[g];
+                ASSERT(hole + 1 == next.start);
+                next.start--;
+                moveTask(next.start + next.count, hole);
+                hole = next.start + next.count;
+            }
+
+            ASSERT(hole + 1 == mInactiveTasksStart);
+            mInactiveTasksStart--;
+        }
+
+        // Same for the inactive tasks
+        mUnscheduledTasksStart--;
+        moveTask(mUnscheduledTasksStart, hole);
+        hole = mUnscheduledTasksStart;
+    }
+
+    // Hole is within the unscheduled tasks, whose order doesn't
+    // matter, so swap with the back.
+    size_t backIdx = mTasks.size() - 1;
+    moveTask(backIdx, hole);
+
+    mTasks[backIdx] = task;
+    mTaskMap[task.id()] = backIdx;
+}
+
+void OwnedTasks::moveTask(size_t fromIdx, size_t toIdx)
+{
+    if (fromIdx != toIdx)
+    {
+        mTasks[toIdx] = mTasks[fromIdx];
+        mTaskMap[mTasks[toIdx].id()] = toIdx;
+    }
+}
+
+} // namespace gaen
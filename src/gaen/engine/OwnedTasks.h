@@ -0,0 +1,153 @@
+//------------------------------------------------------------------------------
+// OwnedTasks.h - A TaskMaster's tasks, grouped by type for update
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_ENGINE_OWNEDTASKS_H
+#define GAEN_ENGINE_OWNEDTASKS_H
+
+#include "gaen/core/base_defines.h"
+#include "gaen/core/HashMap.h"
+#include "gaen/core/Vector.h"
+#include "gaen/engine/Task.h"
+
+namespace gaen
+{
+
+// Tasks owned by a TaskMaster, laid out as:
+//   [ update groups | inactive tasks | unscheduled tasks ]
+//
+// Update groups are contiguous runs of updatable tasks that share
+// a nameHash, so each type's update runs back to back.  Inactive
+// tasks are non-updatable or dead, and are never touched during
+// update.  Unscheduled tasks have been inserted since the last
+// update.
+class OwnedTasks
+{
+public:
+    typedef Vector<kMEM_Engine, Task> TaskVec;
+
+    void reserve(u32 taskCount, u32 typeCount);
+    void clear();
+
+    size_t size() const { return mTasks.size(); }
+    size_t groupCount() const { return mTaskGroups.size(); }
+
+    TaskVec::iterator begin() { return mTasks.begin(); }
+    TaskVec::iterator end() { return mTasks.end(); }
+
+    // Returns nullptr if the task isn't owned. Pointers are only good
+    // until the next insert, remove or update.
+    Task * find(task_id taskId);
+
+    // Appended as unscheduled, task will get moved into its update
+    // group at the start of the next update. This keeps tasks stable
+    // if we're inserted during an update.
+    void insert(const Task & task);
+
+    // Returns false if the task isn't owned. Must not be called
+    // during update.
+    bool remove(task_id taskId);
+
+    // Dead tasks are swept out of their update group at the start of
+    // the next update, since we may be in the middle of one now.
+    void setStatus(task_id taskId, TaskStatus status);
+
+    // Call updateFunc(Task&) on each running task in the update
+    // groups, one group at a time. Initializing and Paused tasks stay
+    // in their group, they just don't get updated. Stops and returns
+    // false if updateFunc returns false. Inserting from updateFunc may
+    // move tasks, so the Task& isn't valid after an insert.
+    template <class UpdateFunc>
+    bool update(const UpdateFunc & updateFunc)
+    {
+        ASSERT(!mIsUpdating);
+
+        schedule();
+
+        mIsUpdating = true;
+
+        // Index based iteration since an update may insert
+        // (unscheduled) tasks.
+        for (size_t g = 0; g < mTaskGroups.size(); ++g)
+        {
+            size_t start = mTaskGroups[g].start;
+            size_t end = start + mTaskGroups[g].count;
+            for (size_t i = start; i < end; ++i)
+            {
+                if (mTasks[i].status() == TaskStatus::Running &&
+                    !updateFunc(mTasks[i]))
+                {
+                    mIsUpdating = false;
+                    return false;
+                }
+            }
+        }
+
+        mIsUpdating = false;
+        return true;
+    }
+
+private:
+    // Move newly inserted tasks into their update groups and
+    // sweep dead tasks out of the update groups.
+    void schedule();
+    // Move the first unscheduled task into its update group, or the inactive tasks
+    void scheduleTask();
+    // Pull a task out of its update group and leave it as the last unscheduled task
+    void unscheduleTask(size_t taskIdx);
+    void moveTask(size_t fromIdx, size_t toIdx);
+    bool isScheduledForUpdate(const Task & task) const
+    {
+        return task.isUpdatable() && task.status() != TaskStatus::Dead;
+    }
+
+    TaskVec mTasks;
+
+    struct TaskGroup
+    {
+        u32 nameHash;
+        u32 start;  // index of first task in mTasks
+        u32 count;  // number of tasks in group
+    };
+    typedef Vector<kMEM_Engine, TaskGroup> TaskGroupVec;
+    TaskGroupVec mTaskGroups;
+
+    // Maps nameHash to its index in mTaskGroups
+    typedef HashMap<kMEM_Engine, u32, u32> TaskGroupMap;
+    TaskGroupMap mTaskGroupMap;
+
+    // Maps task_id to its index in mTasks
+    typedef HashMap<kMEM_Engine, task_id, size_t> TaskMap;
+    TaskMap mTaskMap;
+
+    size_t mInactiveTasksStart = 0;    // start of inactive tasks in mTasks
+    size_t mUnscheduledTasksStart = 0; // start of unscheduled tasks in mTasks
+    bool mHasDeadTasks = false;
+    bool mIsUpdating = false;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_ENGINE_OWNEDTASKS_H
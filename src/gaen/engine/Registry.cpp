@@ -28,13 +28,36 @@
 
 #include "gaen/engine/Component.h"
 #include "gaen/engine/Entity.h"
+#include "gaen/engine/MessageTable.h"
 #include "gaen/engine/MessageWriter.h"
+#include "gaen/engine/VmComponent.h"
 
 #include "gaen/engine/Registry.h"
 
 namespace gaen
 {
 
+struct Registry::RouterEntry
+{
+    Vector<kMEM_Engine, u32> nameHashes; // script task, then components
+    MessageRouter router;
+    RouterEntry * pNext;
+};
+
+Registry::~Registry()
+{
+    for (auto & it : mMessageRouters)
+    {
+        RouterEntry * pEntry = it.second;
+        while (pEntry)
+        {
+            RouterEntry * pNext = pEntry->pNext;
+            GDELETE(pEntry);
+            pEntry = pNext;
+        }
+    }
+}
+
 bool Registry::registerComponentConstructor(u32 nameHash, ComponentConstructor constructor)
 {
     auto it = mComponentConstructors.find(nameHash);
@@ -55,6 +78,11 @@ Component * Registry::constructComponent(u32 nameHash, void * place, Entity * pE
 
     if (it == mComponentConstructors.end())
     {
+        // Fall back to bytecode programs
+        const ScriptProgramSlot * pSlot = find_script_program(nameHash);
+        if (pSlot)
+            return VmComponent::construct(place, pEntity, pSlot);
+
         PANIC("Unknown Component hash, cannot construct: 0x%08x", nameHash);
         return nullptr;
     }
@@ -94,6 +122,70 @@ Entity * Registry::constructEntity(u32 nameHash, u32 childCount, task_id initPar
     return pEntity;
 }
 
+bool Registry::registerMessageTable(u32 taskNameHash, const MessageTable * pTable)
+{
+    auto it = mMessageTables.find(taskNameHash);
+
+    if (it != mMessageTables.end())
+    {
+        PANIC("MessageTable hash already registered: 0x%08x", taskNameHash);
+        return false;
+    }
+
+    mMessageTables[taskNameHash] = pTable;
+    return true;
+}
+
+const MessageTable * Registry::findMessageTable(u32 taskNameHash)
+{
+    auto it = mMessageTables.find(taskNameHash);
+
+    if (it == mMessageTables.end())
+        return nullptr;
+
+    return it->second;
+}
+
+const MessageRouter * Registry::findMessageRouter(const Task & scriptTask, const Component * pComponents, u32 componentCount)
+{
+    u32 key = MessageTable::mix(scriptTask.nameHash(), componentCount);
+    for (u32 i = 0; i < componentCount; ++i)
+        key = MessageTable::mix(pComponents[i].scriptTask().nameHash(), key);
+
+    RouterEntry *& pHead = mMessageRouters[key];
+    for (RouterEntry * pEntry = pHead; pEntry; pEntry = pEntry->pNext)
+    {
+        if (pEntry->nameHashes.size() != componentCount + 1 ||
+            pEntry->nameHashes[0] != scriptTask.nameHash())
+            continue;
+
+        u32 i = 0;
+        while (i < componentCount && pEntry->nameHashes[i + 1] == pComponents[i].scriptTask().nameHash())
+            ++i;
+        if (i == componentCount)
+            return &pEntry->router;
+    }
+
+    RouterEntry * pEntry = GNEW(kMEM_Engine, RouterEntry);
+    pEntry->nameHashes.reserve(componentCount + 1);
+    pEntry->nameHashes.push_back(scriptTask.nameHash());
+
+    Vector<kMEM_Engine, const MessageTable*> componentTables(componentCount);
+    for (u32 i = 0; i < componentCount; ++i)
+    {
+        u32 nameHash = pComponents[i].scriptTask().nameHash();
+        pEntry->nameHashes.push_back(nameHash);
+        componentTables[i] = findMessageTable(nameHash);
+    }
+
+    pEntry->router.build(findMessageTable(scriptTask.nameHash()),
+                         componentTables.data(),
+                         componentCount);
+
+    pEntry->pNext = pHead;
+    pHead = pEntry;
+    return &pEntry->router;
+}
 
 } // namespace gaen
 
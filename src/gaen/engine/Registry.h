@@ -37,10 +37,15 @@ namespace gaen
 
 class Component;
 class Entity;
+struct Task;
+struct MessageTable;
+class MessageRouter;
 
 class Registry
 {
 public:
+    ~Registry();
+
     typedef Component * (*ComponentConstructor)(void * place, Entity * pEntity);
     typedef Entity * (*EntityConstructor)(u32 childCount, task_id initParentTask, task_id creatorTask, bool isVisible, u32 readyMessage);
 
@@ -50,9 +55,26 @@ public:
     bool registerEntityConstructor(u32 nameHash, EntityConstructor constructor);
     Entity * constructEntity(u32 nameHash, u32 childCount, task_id initParentTask, task_id creatorTask, bool isVisible, u32 readyMessage);
 
+    // Message tables are keyed by the script Task's nameHash
+    // (e.g. "foo__Bar__script"), which is all Entity has on hand
+    // when routing messages to its components.
+    bool registerMessageTable(u32 taskNameHash, const MessageTable * pTable);
+    const MessageTable * findMessageTable(u32 taskNameHash);
+
+    // Routers are shared by every Entity with the same script task and
+    // component types in the same order, and are built the first time
+    // that combination is seen. They live as long as the Registry.
+    const MessageRouter * findMessageRouter(const Task & scriptTask, const Component * pComponents, u32 componentCount);
+
 private:
+    struct RouterEntry;
     HashMap<kMEM_Engine, u32, ComponentConstructor> mComponentConstructors;
     HashMap<kMEM_Engine, u32, EntityConstructor> mEntityConstructors;
+    HashMap<kMEM_Engine, u32, const MessageTable*> mMessageTables;
+
+    // Keyed by a hash of the task nameHashes, entries with the same
+    // key are chained through RouterEntry::pNext.
+    HashMap<kMEM_Engine, u32, RouterEntry*> mMessageRouters;
     
 };
 
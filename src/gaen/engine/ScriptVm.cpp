@@ -0,0 +1,663 @@
+//------------------------------------------------------------------------------
+// ScriptVm.cpp - Virtual machine for bytecode compiled Compose scripts
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/engine/stdafx.h"
+
+#include "gaen/core/HashMap.h"
+#include "gaen/core/Vector.h"
+#include "gaen/assets/file_utils.h"
+#include "gaen/hashes/hashes.h"
+#include "gaen/math/common.h"
+#include "gaen/engine/TaskMaster.h"
+#include "gaen/engine/InputMgr.h"
+
+#include "gaen/engine/ScriptVm.h"
+
+// Computed goto (labels as values) dispatch is supported by gcc and
+// clang, other compilers fall back to a switch.
+#if IS_COMPILER_GNU || IS_COMPILER_Clang || IS_COMPILER_AppleClang
+#define VM_COMPUTED_GOTO HAS_X
+#else
+#define VM_COMPUTED_GOTO HAS__
+#endif
+
+namespace gaen
+{
+
+static const u32 kVmStackSize = 64;
+
+//------------------------------------------------------------------------------
+// System calls
+//------------------------------------------------------------------------------
+typedef HashMap<kMEM_Engine, u32, ScriptSyscall> SyscallMap;
+
+// Builtin functions
+
+static void syscall_rand(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = TaskMaster::task_master_for_active_thread().rand();
+}
+
+static void syscall_degrees(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = degrees(pRegs[0].f);
+}
+
+static void syscall_radians(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = radians(pRegs[0].f);
+}
+
+static void syscall_min(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = min(pRegs[0].f, pRegs[1].f);
+}
+
+static void syscall_max(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = max(pRegs[0].f, pRegs[1].f);
+}
+
+static void syscall_clamp(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = clamp(pRegs[0].f, pRegs[1].f, pRegs[2].f);
+}
+
+static void syscall_step(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = step(pRegs[0].f, pRegs[1].f);
+}
+
+static void syscall_smoothstep(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = smoothstep(pRegs[0].f, pRegs[1].f, pRegs[2].f);
+}
+
+static void syscall_lerp(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = pRegs[0].f + (pRegs[1].f - pRegs[0].f) * pRegs[2].f;
+}
+
+static void syscall_acos(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = acos(pRegs[0].f);
+}
+
+static void syscall_atan(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].f = atan(pRegs[0].f);
+}
+
+// Engine system_api
+
+static void syscall_exit(cell * pRegs, Entity * pCaller)
+{
+    system_api::exit(pCaller);
+}
+
+static void syscall_input_enable_mode(cell * pRegs, Entity * pCaller)
+{
+    system_api::input_enable_mode(pRegs[0].i, pCaller);
+}
+
+static void syscall_input_disable_mode(cell * pRegs, Entity * pCaller)
+{
+    system_api::input_disable_mode(pRegs[0].i, pCaller);
+}
+
+static void syscall_input_set_keyboard_mode(cell * pRegs, Entity * pCaller)
+{
+    system_api::input_set_keyboard_mode(pRegs[0].i, pCaller);
+}
+
+static void syscall_input_register_key_press_listener(cell * pRegs, Entity * pCaller)
+{
+    system_api::input_register_key_press_listener(pRegs[0].i, pCaller);
+}
+
+static void syscall_input_deregister_key_press_listener(cell * pRegs, Entity * pCaller)
+{
+    system_api::input_deregister_key_press_listener(pRegs[0].i, pCaller);
+}
+
+static SyscallMap & syscall_map()
+{
+    static SyscallMap sSyscalls = {
+        { HASH::rand,                                &syscall_rand },
+        { HASH::degrees,                             &syscall_degrees },
+        { HASH::radians,                             &syscall_radians },
+        { HASH::min,                                 &syscall_min },
+        { HASH::max,                                 &syscall_max },
+        { HASH::clamp,                               &syscall_clamp },
+        { HASH::step,                                &syscall_step },
+        { HASH::smoothstep,                          &syscall_smoothstep },
+        { HASH::lerp,                                &syscall_lerp },
+        { HASH::acos,                                &syscall_acos },
+        { HASH::atan,                                &syscall_atan },
+        { HASH::exit,                                &syscall_exit },
+        { HASH::input_enable_mode,                   &syscall_input_enable_mode },
+        { HASH::input_disable_mode,                  &syscall_input_disable_mode },
+        { HASH::input_set_keyboard_mode,             &syscall_input_set_keyboard_mode },
+        { HASH::input_register_key_press_listener,   &syscall_input_register_key_press_listener },
+        { HASH::input_deregister_key_press_listener, &syscall_input_deregister_key_press_listener }
+    };
+    return sSyscalls;
+}
+
+static bool is_script_syscall_desc(u32 nameHash)
+{
+    for (const ScriptSyscallDesc & desc : kScriptSyscalls)
+    {
+        if (HASH::hash_func(desc.name) == nameHash)
+            return true;
+    }
+    return false;
+}
+
+void register_script_syscall(u32 nameHash, ScriptSyscall syscall)
+{
+    SyscallMap & syscalls = syscall_map();
+    PANIC_IF(!is_script_syscall_desc(nameHash), "Script syscall not in kScriptSyscalls, cmpc will never call it: %s", HASH::reverse_hash(nameHash));
+    PANIC_IF(syscalls.find(nameHash) != syscalls.end(), "Script syscall already registered: %s", HASH::reverse_hash(nameHash));
+    syscalls[nameHash] = syscall;
+}
+
+bool verify_script_syscalls()
+{
+    const SyscallMap & syscalls = syscall_map();
+    bool isComplete = true;
+    for (const ScriptSyscallDesc & desc : kScriptSyscalls)
+    {
+        if (syscalls.find(HASH::hash_func(desc.name)) == syscalls.end())
+        {
+            LOG_ERROR("Script syscall not registered: %s", desc.name);
+            isComplete = false;
+        }
+    }
+    return isComplete;
+}
+
+//------------------------------------------------------------------------------
+// ScriptProgram
+//------------------------------------------------------------------------------
+ScriptProgram * ScriptProgram::load(const char * path)
+{
+    FileReader rdr(path);
+    if (!rdr.isOk())
+        return nullptr;
+
+    if (rdr.size() % sizeof(u32) != 0 || rdr.size() < sizeof(ScriptProgramHeader))
+    {
+        LOG_ERROR("Invalid script program size: %s", path);
+        return nullptr;
+    }
+
+    u32 cellCount = (u32)(rdr.size() / sizeof(u32));
+    u32 * pCells = (u32*)GALLOC(kMEM_Engine, cellCount * sizeof(u32));
+    rdr.read(pCells, cellCount * sizeof(u32));
+
+    ScriptProgram * pProgram = GNEW(kMEM_Engine, ScriptProgram);
+    if (!pProgram->init(pCells, cellCount))
+    {
+        LOG_ERROR("Invalid script program: %s", path);
+        GDELETE(pProgram);
+        return nullptr;
+    }
+    return pProgram;
+}
+
+ScriptProgram * ScriptProgram::create(const u32 * pCells, u32 cellCount)
+{
+    u32 * pCellsCopy = (u32*)GALLOC(kMEM_Engine, cellCount * sizeof(u32));
+    memcpy(pCellsCopy, pCells, cellCount * sizeof(u32));
+
+    ScriptProgram * pProgram = GNEW(kMEM_Engine, ScriptProgram);
+    if (!pProgram->init(pCellsCopy, cellCount))
+    {
+        GDELETE(pProgram);
+        return nullptr;
+    }
+    return pProgram;
+}
+
+ScriptProgram::~ScriptProgram()
+{
+    if (mpInsStarts)
+        GFREE(mpInsStarts);
+    if (mpSyscalls)
+        GFREE(mpSyscalls);
+    if (mpCells)
+        GFREE(mpCells);
+}
+
+const ScriptProgramHandler * ScriptProgram::findHandler(u32 msgId) const
+{
+    const ScriptProgramHandler * pBegin = mpHandlers;
+    const ScriptProgramHandler * pEnd = mpHandlers + mpHeader->handlerCount;
+
+    const ScriptProgramHandler * pHandler = std::lower_bound(pBegin,
+                                                             pEnd,
+                                                             msgId,
+                                                             [](const ScriptProgramHandler & lhs, u32 rhs) { return lhs.msgId < rhs; });
+    if (pHandler != pEnd && pHandler->msgId == msgId)
+        return pHandler;
+    return nullptr;
+}
+
+// Verify everything the VM trusts at run time, so the dispatch loop
+// doesn't need to check opcodes, branch targets, or block addresses.
+bool ScriptProgram::init(u32 * pCells, u32 cellCount)
+{
+    mpCells = pCells;
+    mCellCount = cellCount;
+
+    static const u32 kHeaderCells = sizeof(ScriptProgramHeader) / sizeof(u32);
+    static const u32 kHandlerCells = sizeof(ScriptProgramHandler) / sizeof(u32);
+
+    if (cellCount < kHeaderCells)
+        return false;
+
+    mpHeader = reinterpret_cast<const ScriptProgramHeader*>(pCells);
+    if (mpHeader->magic != kScriptProgramMagic ||
+        mpHeader->version != kScriptProgramVersion)
+    {
+        ERR("Script program has bad magic or version");
+        return false;
+    }
+
+    u64 expectedCells = (u64)kHeaderCells +
+                        (u64)mpHeader->handlerCount * kHandlerCells +
+                        (u64)mpHeader->importCount +
+                        (u64)mpHeader->codeCount;
+    if (expectedCells != cellCount || mpHeader->codeCount == 0 || mpHeader->codeCount > 0xffff)
+    {
+        ERR("Script program has bad section sizes");
+        return false;
+    }
+
+    mpHandlers = reinterpret_cast<const ScriptProgramHandler*>(pCells + kHeaderCells);
+    const u32 * pImports = pCells + kHeaderCells + mpHeader->handlerCount * kHandlerCells;
+    mpCode = pImports + mpHeader->importCount;
+
+    u32 codeCount = mpHeader->codeCount;
+    u32 blockCellCount = mpHeader->blockCount * kCellsPerBlock;
+
+    // Find where instructions start, LOADC constants are data and
+    // control must never transfer into them.
+    mpInsStarts = (u8*)GALLOC(kMEM_Engine, codeCount);
+    for (u32 ip = 0; ip < codeCount; ++ip)
+    {
+        mpInsStarts[ip] = 1;
+        if (opcode(mpCode[ip]) == eOpcode_LOADC && ip + 1 < codeCount)
+            mpInsStarts[++ip] = 0;
+    }
+
+    // Entries
+    if (!isInstructionStart(mpHeader->initEntry) ||
+        (mpHeader->updateEntry != kScriptProgramNoEntry && !isInstructionStart(mpHeader->updateEntry)))
+    {
+        ERR("Script program has bad entry point");
+        return false;
+    }
+    for (u32 i = 0; i < mpHeader->handlerCount; ++i)
+    {
+        if (!isInstructionStart(mpHandlers[i].entry) ||
+            mpHandlers[i].blockCount >= kMaxBlockCount ||
+            (i > 0 && mpHandlers[i-1].msgId >= mpHandlers[i].msgId))
+        {
+            ERR("Script program has bad handler table");
+            return false;
+        }
+    }
+
+    // Imports
+    if (mpHeader->importCount > 0)
+    {
+        mpSyscalls = (ScriptSyscall*)GALLOC(kMEM_Engine, sizeof(ScriptSyscall) * mpHeader->importCount);
+        const SyscallMap & syscalls = syscall_map();
+        for (u32 i = 0; i < mpHeader->importCount; ++i)
+        {
+            auto it = syscalls.find(pImports[i]);
+            if (it == syscalls.end())
+            {
+                ERR("Script program imports unknown syscall: %s", HASH::reverse_hash(pImports[i]));
+                return false;
+            }
+            mpSyscalls[i] = it->second;
+        }
+    }
+
+    // Code
+    u32 lastOp = eOpcode_COUNT;
+    for (u32 ip = 0; ip < codeCount; ++ip)
+    {
+        u32 ins = mpCode[ip];
+        u32 op = opcode(ins);
+        bool isValid = op < eOpcode_COUNT;
+
+        switch (op)
+        {
+        case eOpcode_SYSCALL:
+            isValid = arg2(ins) < mpHeader->importCount;
+            break;
+        case eOpcode_LOADC:
+            ip++; // skip constant
+            isValid = ip < codeCount;
+            break;
+        case eOpcode_LOADB:
+        case eOpcode_STOREB:
+            isValid = arg2(ins) < blockCellCount;
+            break;
+        case eOpcode_LOADM:
+            isValid = arg2(ins) < kMaxBlockCount * kCellsPerBlock;
+            break;
+        case eOpcode_BRZ:
+        case eOpcode_BRNZ:
+        case eOpcode_JUMP:
+        case eOpcode_CALL:
+            isValid = isInstructionStart(arg2(ins));
+            break;
+        }
+
+        if (!isValid)
+        {
+            ERR("Script program has invalid instruction at 0x%04x: 0x%08x", ip, ins);
+            return false;
+        }
+        lastOp = op;
+    }
+
+    // Make sure execution can't run off the end of the code
+    if (lastOp != eOpcode_RET && lastOp != eOpcode_JUMP)
+    {
+        ERR("Script program code must end in RET or JUMP");
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Interpreter
+//------------------------------------------------------------------------------
+void script_vm_run(const ScriptProgram & program, u32 entry, ScriptVmFrame & frame)
+{
+    const u32 * pCode = program.code();
+    cell * r = frame.regs;
+    cell * pCells = frame.pCells;
+
+    u32 stack[kVmStackSize];
+    u32 sp = 0;
+    u32 ip = entry;
+    u32 ins;
+
+#define A0 r[arg0(ins)]
+#define A1 r[arg1(ins)]
+#define A2 r[arg2(ins) & 0x1f]
+#define IMM arg2i(ins)
+
+#if HAS(VM_COMPUTED_GOTO)
+    // Must match order of eOpcode enum
+    static const void * const skDispatch[] = {
+        &&L_SYSCALL,
+        &&L_MOV, &&L_LOADI, &&L_LOADC, &&L_LOAD, &&L_STORE, &&L_LOADB, &&L_STOREB, &&L_LOADP, &&L_LOADM,
+        &&L_COMP, &&L_AND, &&L_OR, &&L_XOR, &&L_LSHIFT, &&L_LSHIFTI, &&L_RSHIFT, &&L_RSHIFTI, &&L_NOT,
+        &&L_NEG, &&L_ADD, &&L_ADDI, &&L_SUB, &&L_SUBI, &&L_MUL, &&L_MULI, &&L_DIV, &&L_DIVI, &&L_MOD, &&L_MODI,
+        &&L_EQ, &&L_NEQ, &&L_LT, &&L_LTE, &&L_GT, &&L_GTE,
+        &&L_BRZ, &&L_BRNZ, &&L_PUSH, &&L_POP, &&L_JUMP, &&L_CALL, &&L_RET,
+        &&L_ITOF, &&L_FTOI, &&L_FNEG, &&L_FADD, &&L_FSUB, &&L_FMUL, &&L_FDIV,
+        &&L_FEQ, &&L_FNEQ, &&L_FLT, &&L_FLTE, &&L_FGT, &&L_FGTE
+    };
+    static_assert(sizeof(skDispatch) / sizeof(skDispatch[0]) == eOpcode_COUNT, "VM dispatch table doesn't match opcodes");
+
+#define VM_OP(op) L_##op:
+#define VM_NEXT() ins = pCode[ip++]; goto *skDispatch[opcode(ins)]
+
+    VM_NEXT();
+#else
+#define VM_OP(op) case eOpcode_##op:
+#define VM_NEXT() continue
+
+    for (;;)
+    {
+    ins = pCode[ip++];
+    switch (opcode(ins))
+    {
+#endif
+
+    VM_OP(SYSCALL) program.syscall(arg2(ins))(r, frame.pCaller); VM_NEXT();
+
+    VM_OP(MOV)    A0 = A1; VM_NEXT();
+    VM_OP(LOADI)  A0.i = IMM; VM_NEXT();
+    VM_OP(LOADC)  A0.u = pCode[ip++]; VM_NEXT();
+    VM_OP(LOAD)
+        PANIC_IF(A1.u >= frame.cellCount, "Script LOAD out of bounds: %u", A1.u);
+        A0 = pCells[A1.u];
+        VM_NEXT();
+    VM_OP(STORE)
+        PANIC_IF(A0.u >= frame.cellCount, "Script STORE out of bounds: %u", A0.u);
+        pCells[A0.u] = A1;
+        VM_NEXT();
+    VM_OP(LOADB)  A0 = pCells[arg2(ins)]; VM_NEXT();
+    VM_OP(STOREB) pCells[arg2(ins)] = A0; VM_NEXT();
+    VM_OP(LOADP)  A0 = frame.payload; VM_NEXT();
+    VM_OP(LOADM)
+        PANIC_IF(arg2(ins) >= frame.msgCellCount, "Script LOADM out of bounds: %u", arg2(ins));
+        A0 = frame.pMsgCells[arg2(ins)];
+        VM_NEXT();
+
+    VM_OP(COMP)    A0.u = ~A1.u; VM_NEXT();
+    VM_OP(AND)     A0.u = A1.u & A2.u; VM_NEXT();
+    VM_OP(OR)      A0.u = A1.u | A2.u; VM_NEXT();
+    VM_OP(XOR)     A0.u = A1.u ^ A2.u; VM_NEXT();
+    VM_OP(LSHIFT)  A0.i = A1.i << (A2.u & 0x1f); VM_NEXT();
+    VM_OP(LSHIFTI) A0.i = A1.i << (arg2(ins) & 0x1f); VM_NEXT();
+    VM_OP(RSHIFT)  A0.i = A1.i >> (A2.u & 0x1f); VM_NEXT();
+    VM_OP(RSHIFTI) A0.i = A1.i >> (arg2(ins) & 0x1f); VM_NEXT();
+    VM_OP(NOT)     A0.i = A1.i == 0 ? 1 : 0; VM_NEXT();
+
+    VM_OP(NEG)  A0.i = -A1.i; VM_NEXT();
+    VM_OP(ADD)  A0.i = A1.i + A2.i; VM_NEXT();
+    VM_OP(ADDI) A0.i = A1.i + IMM; VM_NEXT();
+    VM_OP(SUB)  A0.i = A1.i - A2.i; VM_NEXT();
+    VM_OP(SUBI) A0.i = A1.i - IMM; VM_NEXT();
+    VM_OP(MUL)  A0.i = A1.i * A2.i; VM_NEXT();
+    VM_OP(MULI) A0.i = A1.i * IMM; VM_NEXT();
+    VM_OP(DIV)
+        PANIC_IF(A2.i == 0, "Script divide by zero, ip: 0x%04x", ip - 1);
+        A0.i = A1.i / A2.i;
+        VM_NEXT();
+    VM_OP(DIVI)
+        PANIC_IF(IMM == 0, "Script divide by zero, ip: 0x%04x", ip - 1);
+        A0.i = A1.i / IMM;
+        VM_NEXT();
+    VM_OP(MOD)
+        PANIC_IF(A2.i == 0, "Script divide by zero, ip: 0x%04x", ip - 1);
+        A0.i = A1.i % A2.i;
+        VM_NEXT();
+    VM_OP(MODI)
+        PANIC_IF(IMM == 0, "Script divide by zero, ip: 0x%04x", ip - 1);
+        A0.i = A1.i % IMM;
+        VM_NEXT();
+
+    VM_OP(EQ)  A0.i = A1.i == A2.i; VM_NEXT();
+    VM_OP(NEQ) A0.i = A1.i != A2.i; VM_NEXT();
+    VM_OP(LT)  A0.i = A1.i <  A2.i; VM_NEXT();
+    VM_OP(LTE) A0.i = A1.i <= A2.i; VM_NEXT();
+    VM_OP(GT)  A0.i = A1.i >  A2.i; VM_NEXT();
+    VM_OP(GTE) A0.i = A1.i >= A2.i; VM_NEXT();
+
+    VM_OP(BRZ)
+        if (A0.i == 0)
+            ip = arg2(ins);
+        VM_NEXT();
+    VM_OP(BRNZ)
+        if (A0.i != 0)
+            ip = arg2(ins);
+        VM_NEXT();
+    VM_OP(PUSH)
+        PANIC_IF(sp >= kVmStackSize, "Script stack overflow");
+        stack[sp++] = A0.u;
+        VM_NEXT();
+    VM_OP(POP)
+        PANIC_IF(sp == 0, "Script stack underflow");
+        A0.u = stack[--sp];
+        VM_NEXT();
+    VM_OP(JUMP)
+        ip = arg2(ins);
+        VM_NEXT();
+    VM_OP(CALL)
+        PANIC_IF(sp >= kVmStackSize, "Script stack overflow");
+        stack[sp++] = ip;
+        ip = arg2(ins);
+        VM_NEXT();
+    VM_OP(RET)
+        if (sp == 0)
+            return;
+        ip = stack[--sp];
+        // PUSH and POP share the stack, so the return address may
+        // be anything
+        PANIC_IF(!program.isInstructionStart(ip), "Script RET to invalid address: 0x%04x", ip);
+        VM_NEXT();
+
+    VM_OP(ITOF) A0.f = (f32)A1.i; VM_NEXT();
+    VM_OP(FTOI) A0.i = (i32)A1.f; VM_NEXT();
+    VM_OP(FNEG) A0.f = -A1.f; VM_NEXT();
+    VM_OP(FADD) A0.f = A1.f + A2.f; VM_NEXT();
+    VM_OP(FSUB) A0.f = A1.f - A2.f; VM_NEXT();
+    VM_OP(FMUL) A0.f = A1.f * A2.f; VM_NEXT();
+    VM_OP(FDIV) A0.f = A1.f / A2.f; VM_NEXT();
+    VM_OP(FEQ)  A0.i = A1.f == A2.f; VM_NEXT();
+    VM_OP(FNEQ) A0.i = A1.f != A2.f; VM_NEXT();
+    VM_OP(FLT)  A0.i = A1.f <  A2.f; VM_NEXT();
+    VM_OP(FLTE) A0.i = A1.f <= A2.f; VM_NEXT();
+    VM_OP(FGT)  A0.i = A1.f >  A2.f; VM_NEXT();
+    VM_OP(FGTE) A0.i = A1.f >= A2.f; VM_NEXT();
+
+#if !HAS(VM_COMPUTED_GOTO)
+    default:
+        PANIC("Invalid script opcode: 0x%08x", ins);
+        return;
+    } // switch
+    } // for
+#endif
+
+#undef VM_OP
+#undef VM_NEXT
+#undef IMM
+#undef A2
+#undef A1
+#undef A0
+}
+
+//------------------------------------------------------------------------------
+// Loaded programs
+//------------------------------------------------------------------------------
+struct LoadedScriptProgram
+{
+    ScriptProgramSlot slot;
+    char path[kMaxPath+1];
+};
+
+typedef HashMap<kMEM_Engine, u32, LoadedScriptProgram*> LoadedProgramMap;
+static LoadedProgramMap sLoadedPrograms;
+static Vector<kMEM_Engine, ScriptProgram*> sRetiredPrograms;
+
+bool load_script_program(const char * path)
+{
+    ASSERT(strlen(path) <= kMaxPath);
+
+    ScriptProgram * pProgram = ScriptProgram::load(path);
+    if (!pProgram)
+        return false;
+
+    if (sLoadedPrograms.find(pProgram->nameHash()) != sLoadedPrograms.end())
+    {
+        LOG_ERROR("Script program already loaded: %s", path);
+        GDELETE(pProgram);
+        return false;
+    }
+
+    LoadedScriptProgram * pLoaded = GNEW(kMEM_Engine, LoadedScriptProgram);
+    pLoaded->slot.pProgram = pProgram;
+    strncpy(pLoaded->path, path, kMaxPath);
+    pLoaded->path[kMaxPath] = '\0';
+
+    sLoadedPrograms[pProgram->nameHash()] = pLoaded;
+    LOG_INFO("Loaded script program: %s", path);
+    return true;
+}
+
+const ScriptProgramSlot * find_script_program(u32 nameHash)
+{
+    auto it = sLoadedPrograms.find(nameHash);
+    if (it != sLoadedPrograms.end())
+        return &it->second->slot;
+    return nullptr;
+}
+
+u32 reload_script_programs()
+{
+    u32 reloadCount = 0;
+    for (auto & kv : sLoadedPrograms)
+    {
+        LoadedScriptProgram * pLoaded = kv.second;
+        ScriptProgram * pOld = pLoaded->slot.pProgram;
+        ScriptProgram * pNew = ScriptProgram::load(pLoaded->path);
+        if (!pNew)
+            continue;
+
+        if (pNew->nameHash() != pOld->nameHash() ||
+            pNew->blockCount() != pOld->blockCount() ||
+            pNew->isUpdatable() != pOld->isUpdatable())
+        {
+            LOG_ERROR("Script program layout changed, restart required to reload: %s", pLoaded->path);
+            GDELETE(pNew);
+            continue;
+        }
+
+        pLoaded->slot.pProgram = pNew;
+        sRetiredPrograms.push_back(pOld);
+        reloadCount++;
+    }
+    return reloadCount;
+}
+
+void fin_script_programs()
+{
+    for (auto & kv : sLoadedPrograms)
+    {
+        GDELETE(kv.second->slot.pProgram.load());
+        GDELETE(kv.second);
+    }
+    sLoadedPrograms.clear();
+
+    for (ScriptProgram * pProgram : sRetiredPrograms)
+        GDELETE(pProgram);
+    sRetiredPrograms.clear();
+}
+
+} // namespace gaen
@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+// ScriptVm.h - Virtual machine for bytecode compiled Compose scripts
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_ENGINE_SCRIPTVM_H
+#define GAEN_ENGINE_SCRIPTVM_H
+
+#include <atomic>
+
+#include "gaen/core/base_defines.h"
+#include "gaen/compose/opcode.h"
+#include "gaen/engine/Message.h"
+
+namespace gaen
+{
+
+class Entity;
+
+// System calls take their arguments in registers r0..r7 and return
+// their result in r0.
+typedef void (*ScriptSyscall)(cell * pRegs, Entity * pCaller);
+
+// Register a system call available to bytecode programs. Must be
+// called before any programs that import it are loaded. nameHash
+// must be one of kScriptSyscalls, the builtins and engine calls are
+// registered here and other modules register the rest.
+void register_script_syscall(u32 nameHash, ScriptSyscall syscall);
+
+// Logs each of kScriptSyscalls without a registered implementation,
+// returns false if there were any.
+bool verify_script_syscalls();
+
+//------------------------------------------------------------------------------
+// A validated, ready to run, bytecode program as produced by cmpc -b.
+//------------------------------------------------------------------------------
+class ScriptProgram
+{
+public:
+    // Returns nullptr if file can't be read or isn't a valid program
+    static ScriptProgram * load(const char * path);
+
+    // Copies cells, returns nullptr if cells aren't a valid program
+    static ScriptProgram * create(const u32 * pCells, u32 cellCount);
+
+    ~ScriptProgram();
+
+    u32 nameHash() const { return mpHeader->nameHash; }
+    u32 blockCount() const { return mpHeader->blockCount; }
+    u32 initEntry() const { return mpHeader->initEntry; }
+    u32 updateEntry() const { return mpHeader->updateEntry; }
+    bool isUpdatable() const { return mpHeader->updateEntry != kScriptProgramNoEntry; }
+
+    const ScriptProgramHandler * findHandler(u32 msgId) const;
+
+    const u32 * code() const { return mpCode; }
+    u32 codeCount() const { return mpHeader->codeCount; }
+    ScriptSyscall syscall(u32 importIdx) const { return mpSyscalls[importIdx]; }
+
+    // False for addresses out of range or within a LOADC constant
+    bool isInstructionStart(u32 addr) const { return addr < mpHeader->codeCount && mpInsStarts[addr]; }
+
+private:
+    ScriptProgram() = default;
+    bool init(u32 * pCells, u32 cellCount);
+
+    u32 * mpCells = nullptr;
+    u32 mCellCount = 0;
+
+    const ScriptProgramHeader * mpHeader = nullptr;
+    const ScriptProgramHandler * mpHandlers = nullptr;
+    const u32 * mpCode = nullptr;
+    u8 * mpInsStarts = nullptr;
+    ScriptSyscall * mpSyscalls = nullptr;
+};
+
+// Memory a program runs against
+struct ScriptVmFrame
+{
+    cell regs[kVmRegisterCount];
+
+    cell * pCells;       // Block storage of the entity or component
+    u32 cellCount;
+
+    const cell * pMsgCells; // Message blocks, if running a message handler
+    u32 msgCellCount;
+    cell payload;
+
+    Entity * pCaller;
+};
+
+// Run program starting at entry until its outermost RET
+void script_vm_run(const ScriptProgram & program, u32 entry, ScriptVmFrame & frame);
+
+//------------------------------------------------------------------------------
+// Loaded programs, shared by all TaskMasters.
+//
+// Components hold a pointer to their slot rather than the program
+// itself so reload_script_programs can swap in new code without
+// touching live components. Replaced programs are retired, not freed,
+// since other threads may still be running them.
+//------------------------------------------------------------------------------
+struct ScriptProgramSlot
+{
+    std::atomic<ScriptProgram*> pProgram;
+};
+
+// Load a program and make its component constructable by name hash.
+// Must be called before TaskMasters are started.
+bool load_script_program(const char * path);
+
+// Returns nullptr if no program is registered with nameHash
+const ScriptProgramSlot * find_script_program(u32 nameHash);
+
+// Reload all programs from disk, returns number reloaded. Run from
+// the primary TaskMaster, the Editor calls it on F5. Programs
+// whose block count or updatability changed are rejected, since
+// existing components have already been allocated their block memory
+// and tasks.
+u32 reload_script_programs();
+
+void fin_script_programs();
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_ENGINE_SCRIPTVM_H
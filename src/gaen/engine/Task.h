@@ -188,6 +188,9 @@ public:
 
     task_id id() const { return mTaskId; }
 
+    // Tasks created with create_updatable have a non zero update stub offset
+    bool isUpdatable() const { return mUpdateStubOffset != 0; }
+
     u32 nameHash() const { return mNameHash; }
 
     TaskStatus status() const { return static_cast<TaskStatus>(mStatus); }
@@ -52,6 +52,10 @@
 
 GAMEVAR_DECL_FLOAT(min_render_interval, 0.0f);
 
+// Keep ModelMgr/SpriteMgr, and so physics, on the primary TaskMaster
+// rather than the last auxiliary one.
+GAMEVAR_DECL_BOOL(physics_on_primary, false);
+
 namespace gaen
 {
 extern void register_all_entities_and_components(Registry & registry);
@@ -63,10 +67,20 @@ static u32 sStartEntityHash = HASH::init__Start;
 
 static bool sIsInit = false;
 
+// TaskMaster that owns ModelMgr and SpriteMgr. Physics there overlaps
+// with rendering on the primary thread, and transforms still reach
+// the renderer and entities through messages.
+static thread_id sPhysicsThreadId = kPrimaryThreadId;
+
 void init_task_masters()
 {
     ASSERT(!sIsInit);
 
+    if (num_threads() > 1 && !physics_on_primary)
+        sPhysicsThreadId = num_threads() - 1;
+    else
+        sPhysicsThreadId = kPrimaryThreadId;
+
     for (thread_id tid = 0; tid < num_threads(); ++tid)
     {
         TaskMaster & tm = TaskMaster::task_master_for_thread(tid);
@@ -361,6 +375,11 @@ void broadcast_message(const MessageBlockAccessor & msgAcc)
     }
 }
 
+thread_id physics_thread_id()
+{
+    return sPhysicsThreadId;
+}
+
 bool is_target_on_same_taskmaster(task_id source, task_id target)
 {
     return TaskMaster::task_master_for_active_thread().messageQueueForTarget(source) == TaskMaster::task_master_for_active_thread().messageQueueForTarget(target);
@@ -397,9 +416,9 @@ void TaskMaster::init(thread_id tid)
     // Pre-allocate reasonable sizes for hash tables
     // LORRTODO - these should be command line options
     const u32 kEstimatedTaskCount = 65536;
+    const u32 kEstimatedTaskTypeCount = 512;
     const u32 kEstimatedMutableDataCount = 128;
-    mOwnedTasks.reserve(kEstimatedTaskCount);
-    mOwnedTaskMap.reserve(kEstimatedTaskCount);
+    mOwnedTasks.reserve(kEstimatedTaskCount, kEstimatedTaskTypeCount);
     mTaskOwnerMap.reserve(kEstimatedTaskCount);
     mMutableDataUsers.reserve(kEstimatedMutableDataCount);
     mMutableData.reserve(kEstimatedTaskCount);
@@ -435,7 +454,6 @@ void TaskMaster::fin(const T& msgAcc)
     }
 
     // Entities should have deleted themselves and all dependent memory
-    mOwnedTaskMap.clear();
     mOwnedTasks.clear();
 
     mStatus = kTMS_Finalizing;
@@ -498,7 +516,11 @@ MessageQueue * TaskMaster::messageQueueForTarget(task_id target)
 
     // Special case the Renderer and InputManager since they
     // are so common.
-    if (is_primary_task(target))
+    if (target == kModelMgrTaskId || target == kSpriteMgrTaskId)
+    {
+        targetThreadId = sPhysicsThreadId;
+    }
+    else if (is_primary_task(target))
     {
         targetThreadId = kPrimaryThreadId;
     }
@@ -559,8 +581,11 @@ void TaskMaster::runPrimaryGameLoop()
     // LORRNOTE: SpriteMgr should be started on all TaskMasters and
     // the broadcast HASH::sprite_insert messages can be handled by
     // the appropriate TaskMaster
-    mpModelMgr.reset(GNEW(kMEM_Engine, ModelMgr));
-    mpSpriteMgr.reset(GNEW(kMEM_Engine, SpriteMgr));
+    if (physics_thread_id() == mThreadId)
+    {
+        mpModelMgr.reset(GNEW(kMEM_Engine, ModelMgr));
+        mpSpriteMgr.reset(GNEW(kMEM_Engine, SpriteMgr));
+    }
 
 #if HAS(ENABLE_EDITOR)
     mpEditor.reset(GNEW(kMEM_Engine, Editor));
@@ -595,7 +620,8 @@ void TaskMaster::runPrimaryGameLoop()
 		}
 
 #ifndef IS_HEADLESS
-        // Render through the render adapter
+        // Capture a frame for the renderer, which draws it on its
+        // own thread while we simulate the next one.
         if (timeSinceRender > min_render_interval)
         {
             renderer_render(mRendererTask);
@@ -641,15 +667,8 @@ void TaskMaster::runPrimaryGameLoop()
             if (!mIsPaused)
             {
                 // call update on each task owned by this TaskMaster
-                for (Task & task : mOwnedTasks)
-                {
-                    // LORRTODO: remove dead tasks from the list
-
-                    if (mStatus != kTMS_Initialized)
-                        return;
-
-                    task.update(delta);
-                }
+                if (!updateTasks((f32)delta))
+                    return;
             }
 
             // Give AssetMgr an opportunity to process messages
@@ -668,8 +687,10 @@ void TaskMaster::runPrimaryGameLoop()
 #ifndef IS_HEADLESS
             if (!mIsPaused)
             {
-                mpModelMgr->update(delta);
-                mpSpriteMgr->update(delta);
+                if (mpModelMgr)
+                    mpModelMgr->update(delta);
+                if (mpSpriteMgr)
+                    mpSpriteMgr->update(delta);
                 mpAudioMgr->update(delta);
             }
 #if HAS(ENABLE_EDITOR)
@@ -689,6 +710,7 @@ void TaskMaster::runPrimaryGameLoop()
         notify_next_frame();
 
 #ifndef IS_HEADLESS
+        // Presents inline frames, the render thread presents its own
         if (didRender)
         {
             renderer_end_frame(mRendererTask);
@@ -708,6 +730,12 @@ void TaskMaster::runAuxiliaryGameLoop()
 #ifndef IS_HEADLESS
     ASSERT(mRendererTask.id() == 0);
     mpInputMgr.reset(GNEW(kMEM_Engine, InputMgr, isPrimary()));
+
+    if (physics_thread_id() == mThreadId)
+    {
+        mpModelMgr.reset(GNEW(kMEM_Engine, ModelMgr));
+        mpSpriteMgr.reset(GNEW(kMEM_Engine, SpriteMgr));
+    }
 #endif
 
     mIsRunning = true;
@@ -744,13 +772,8 @@ void TaskMaster::runAuxiliaryGameLoop()
             if (!mIsPaused)
             {
                 // call update on each task owned by this TaskMaster
-                for(Task & task : mOwnedTasks)
-                {
-                    if (mStatus != kTMS_Initialized)
-                        return;
-
-                    task.update(delta);
-                }
+                if (!updateTasks(delta))
+                    return;
             }
         }
 
@@ -760,6 +783,20 @@ void TaskMaster::runAuxiliaryGameLoop()
             processMessages(*pMessageQueue);
         }
 
+#ifndef IS_HEADLESS
+        // Update physics if we're the physics TaskMaster
+        if (mStatus == kTMS_Initialized && !mIsPaused && mpModelMgr)
+        {
+            mpModelMgr->update(delta);
+            mpSpriteMgr->update(delta);
+
+            for (MessageQueue * pMessageQueue : mTaskMasterMessageQueues)
+            {
+                processMessages(*pMessageQueue);
+            }
+        }
+#endif // IS_HEADLESS
+
         // Wait until primary game loop completes next frame
         if (mStatus == kTMS_Initialized)
             waitForNextFrame();
@@ -818,7 +855,7 @@ void TaskMaster::deregisterMutableDependency(task_id taskId, u32 path)
 
 bool TaskMaster::isOwnedTask(task_id taskId)
 {
-    return mOwnedTaskMap.find(taskId) != mOwnedTaskMap.end();
+    return mOwnedTasks.find(taskId) != nullptr;
 }
 
 void TaskMaster::processMessages(MessageQueue & msgQueue)
@@ -865,16 +902,18 @@ MessageResult TaskMaster::message(const T& msgAcc)
                 messages::OwnerTaskR<T> msgr(msgAcc);
 
                 // If we own it, remove it and send the confirm_set_task_owner
-                auto ownedIt = mOwnedTaskMap.find(msgr.task().id());
-                if (ownedIt != mOwnedTaskMap.end())
+                Task * pOwned = mOwnedTasks.find(msgr.task().id());
+                if (pOwned)
                 {
-                    removeTask(msgr.task().id());
+                    // Copy task before removal, removeTask reorders mOwnedTasks
+                    Task task = *pOwned;
+                    removeTask(task.id());
                     messages::OwnerTaskBW msgw(HASH::confirm_set_task_owner__,
                                                kMessageFlag_None,
                                                threadId(),
                                                threadId(),
                                                msgr.owner());
-                    msgw.setTask(mOwnedTasks[ownedIt->second]);
+                    msgw.setTask(task);
                     broadcast_message(msgw.accessor());
                 }
                 return MessageResult::Consumed;
@@ -889,12 +928,12 @@ MessageResult TaskMaster::message(const T& msgAcc)
             {
                 task_id taskIdToRemove = msg.payload.u;
 
-                auto ownedIt = mOwnedTaskMap.find(taskIdToRemove);
-                if (ownedIt != mOwnedTaskMap.end())
+                Task * pOwned = mOwnedTasks.find(taskIdToRemove);
+                if (pOwned)
                 {
                     // Send an immediate fin__ to the task so it can delete itself
                     StackMessageBlockWriter<0> finw(HASH::fin__, kMessageFlag_Editor, threadId(), taskIdToRemove, to_cell(0));
-                    mOwnedTasks[ownedIt->second].message(finw.accessor());
+                    pOwned->message(finw.accessor());
                 }
 
 #ifndef IS_HEADLESS
@@ -944,8 +983,9 @@ MessageResult TaskMaster::message(const T& msgAcc)
                                                     parentTaskId);
                         msgw.setEntity(pChild);
 
-                        auto ownedParentIt = mOwnedTaskMap.find(parentTaskId);
-                        mOwnedTasks[ownedParentIt->second].message(msgw.accessor());
+                        Task * pParent = mOwnedTasks.find(parentTaskId);
+                        ASSERT(pParent);
+                        pParent->message(msgw.accessor());
                     }
 
                     // We don't own the parent, so we must send the
@@ -980,9 +1020,9 @@ MessageResult TaskMaster::message(const T& msgAcc)
                                                 parentTaskId);
                     msgw.setEntity(pChild);
 
-                    auto ownedParentIt = mOwnedTaskMap.find(parentTaskId);
-                    ASSERT(ownedParentIt != mOwnedTaskMap.end());
-                    mOwnedTasks[ownedParentIt->second].message(msgw.accessor());
+                    Task * pParent = mOwnedTasks.find(parentTaskId);
+                    ASSERT(pParent);
+                    pParent->message(msgw.accessor());
                 }
                 return MessageResult::Consumed;
             }
@@ -1045,13 +1085,10 @@ MessageResult TaskMaster::message(const T& msgAcc)
         {
             // Message is for a specific task
             // Verify we own this task
-            auto it = mOwnedTaskMap.find(msg.target);
+            Task * pTask = mOwnedTasks.find(msg.target);
 
-            if (it != mOwnedTaskMap.end())
+            if (pTask)
             {
-                size_t taskIdx = it->second;
-                ASSERT(taskIdx < mOwnedTasks.size());
-
                 // If it is an activate_task message, hand it specially here
                 if (msg.msgId == HASH::set_task_status)
                 {
@@ -1060,22 +1097,23 @@ MessageResult TaskMaster::message(const T& msgAcc)
                     // Make sure task status is a valid 2 bit value (only has 2 bits in definition of Task struct)
                     PANIC_IF((u32)msgRdr.status() >= 4,"Invalid task status %u", msg.payload.u);
                     TaskStatus stat = msgRdr.status();
-                    mOwnedTasks[taskIdx].setStatus(stat);
+                    mOwnedTasks.setStatus(msg.target, stat);
                     return MessageResult::Consumed;
                 }
 
-                // send message to task
-                MessageResult mr = mOwnedTasks[taskIdx].message(msgAcc);
+                // send message to task, pTask may move if it inserts tasks
+                u32 nameHash = pTask->nameHash();
+                MessageResult mr = pTask->message(msgAcc);
 
 #if HAS(TRACK_HASHES)
                 EXPECT_MSG(mr == MessageResult::Consumed,
                            "Task did not consume a message intended for it, task name: %s, message: %s",
-                           HASH::reverse_hash(mOwnedTasks[taskIdx].nameHash()),
+                           HASH::reverse_hash(nameHash),
                            HASH::reverse_hash(msg.msgId));
 #else
                 EXPECT_MSG(mr == MessageResult::Consumed,
                            "Task did not consume a message intended for it, task nameHash: 0x%08x, message: 0x%08x",
-                           mOwnedTasks[taskIdx].nameHash(),
+                           nameHash,
                            msg.msgId);
 #endif
                 return MessageResult::Consumed;
@@ -1142,12 +1180,10 @@ void TaskMaster::insertTask(thread_id threadOwner, const Task & task)
 
     if (threadOwner == threadId())
     {
-        ASSERT(mOwnedTaskMap.find(task.id()) == mOwnedTaskMap.end());
-        mOwnedTasks.push_back(task);
-        mOwnedTaskMap[task.id()] = mOwnedTasks.size() - 1;
+        mOwnedTasks.insert(task);
     }
 
-    //LOG_INFO("Task Count(%u): %u", threadId(), (u32)mOwnedTaskMap.size());
+    //LOG_INFO("Task Count(%u): %u", threadId(), (u32)mOwnedTasks.size());
 }
 
 void TaskMaster::setTaskOwner(thread_id newOwner, const Task & task)
@@ -1168,39 +1204,8 @@ void TaskMaster::setTaskOwner(thread_id newOwner, const Task & task)
 
 void TaskMaster::removeTask(task_id taskId)
 {
-    // Are we the owner?
-    auto itOTM = mOwnedTaskMap.find(taskId);
-    if (itOTM != mOwnedTaskMap.end())
-    {
-        size_t idx = itOTM->second;
-        // If there is more than one item in mOwnedTaskMap,
-        // we swap with the last item, then pop off the last item.
-        if (mOwnedTaskMap.size() > 1)
-        {
-            // replace item with the last one in vector
-            task_id backTaskId = mOwnedTasks.back().id();
-            mOwnedTasks[idx] = mOwnedTasks.back();
-
-            // remove last task in vector (now it is in position of the task we are removing)
-            mOwnedTasks.pop_back();
-
-            // remove from mOwnedTaskMap
-            mOwnedTaskMap.erase(itOTM);
-
-            // adjust mOwnedTaskMap so it can find what was the last task that has moved indexes
-            if (idx < mOwnedTasks.size()) // if idx == mOwnedTasks.size(), it was the last task so no need to reorder
-            {
-                mOwnedTaskMap[backTaskId] = idx;
-            }
-        }
-        else
-        {
-            ASSERT(mOwnedTasks.size() == 1); // verify our two containers have the same size
-            // just remove it
-            mOwnedTasks.pop_back();
-            mOwnedTaskMap.erase(itOTM);
-        }
-    }
+    // Remove if we're the owner
+    mOwnedTasks.remove(taskId);
 
     // In either case (we own or don't own), we remove from mTaskOwnerMap
     auto itTOM = mTaskOwnerMap.find(taskId);
@@ -1208,6 +1213,15 @@ void TaskMaster::removeTask(task_id taskId)
         mTaskOwnerMap.erase(itTOM);
 }
 
+bool TaskMaster::updateTasks(f32 delta)
+{
+    return mOwnedTasks.update([this, delta](Task & task)
+    {
+        task.update(delta);
+        return mStatus == kTMS_Initialized;
+    });
+}
+
 // Template decls so we can define message func here in the .cpp
 template MessageResult TaskMaster::message<MessageQueueAccessor>(const MessageQueueAccessor & msgAcc);
 template MessageResult TaskMaster::message<MessageBlockAccessor>(const MessageBlockAccessor & msgAcc);
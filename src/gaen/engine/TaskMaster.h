@@ -41,6 +41,7 @@
 #include "gaen/hashes/hashes.h"
 #include "gaen/engine/Message.h"
 #include "gaen/engine/Task.h"
+#include "gaen/engine/OwnedTasks.h"
 #include "gaen/engine/Registry.h"
 
 namespace gaen
@@ -106,6 +107,9 @@ void broadcast_confirm_set_parent(task_id source,
                                   task_id parentTaskId,
                                   Entity * pChild);
 
+// TaskMaster that runs ModelMgr, SpriteMgr and their physics
+thread_id physics_thread_id();
+
 bool is_target_on_same_taskmaster(task_id source, task_id target);
 
 void notify_next_frame();
@@ -203,19 +207,18 @@ private:
     void removeTask(task_id taskId);
     void setTaskOwner(thread_id newOwner, const Task & task);
 
+    // Call update on all running updatable tasks, one task type at a time.
+    // Returns false if the TaskMaster was finalized during the update.
+    bool updateTasks(f32 delta);
+
     Vector<kMEM_Engine, MessageQueue*> mTaskMasterMessageQueues; // message from other task masters queue here
 
     void waitForNextFrame();
     std::condition_variable mNextFrameCV;
     std::mutex mNextFrameMtx;
 
-    // List of tasks owned by this TaskMaster
-    typedef Vector<kMEM_Engine, Task> TaskVec;
-    TaskVec mOwnedTasks;
-
-    // Maps task_id to its index in mOwnedTasks
-    typedef HashMap<kMEM_Engine, task_id, size_t> TaskMap;
-    TaskMap mOwnedTaskMap;
+    // Tasks owned by this TaskMaster
+    OwnedTasks mOwnedTasks;
 
     // Maps task_id to the TaskMaster's thread_id that owns it
     typedef HashMap<kMEM_Engine, task_id, thread_id> TaskOwnerMap;
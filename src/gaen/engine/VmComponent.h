@@ -0,0 +1,161 @@
+//------------------------------------------------------------------------------
+// VmComponent.h - Component whose behavior is a bytecode ScriptProgram
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+#ifndef GAEN_ENGINE_VMCOMPONENT_H
+#define GAEN_ENGINE_VMCOMPONENT_H
+
+#include "gaen/hashes/hashes.h"
+#include "gaen/engine/Component.h"
+#include "gaen/engine/Entity.h"
+#include "gaen/engine/ScriptVm.h"
+#include "gaen/engine/messages/Transform.h"
+
+namespace gaen
+{
+
+// Runs components compiled with cmpc -b. All state lives in the
+// component's block memory, the same as a C++ generated component, so
+// entities can't tell the two apart.
+class VmComponent : public Component
+{
+public:
+    static Component * construct(void * place, Entity * pEntity, const ScriptProgramSlot * pSlot)
+    {
+        return new (place) VmComponent(pEntity, pSlot);
+    }
+
+    void update(f32 delta)
+    {
+        const ScriptProgram & program = *mpProgramSlot->pProgram.load(std::memory_order_acquire);
+        ScriptVmFrame frame;
+        prepareFrame(frame, nullptr, 0);
+        frame.regs[kVmDeltaReg].f = delta;
+        script_vm_run(program, program.updateEntry(), frame);
+    }
+
+    template <typename T>
+    MessageResult message(const T & msgAcc)
+    {
+        const Message & _msg = msgAcc.message();
+        switch (_msg.msgId)
+        {
+        case HASH::init_independent_data__:
+        {
+            // Property and field default values
+            const ScriptProgram & program = *mpProgramSlot->pProgram.load(std::memory_order_acquire);
+            ScriptVmFrame frame;
+            prepareFrame(frame, nullptr, 0);
+            script_vm_run(program, program.initEntry(), frame);
+            return MessageResult::Consumed;
+        }
+        case HASH::init_dependent_data__:
+            // Fields dependent on properties, compiled as a handler
+            // since most programs don't have any
+            runHandler(msgAcc, HASH::init_dependent_data__);
+            return MessageResult::Consumed;
+        case HASH::init__:
+        case HASH::request_assets__:
+        case HASH::asset_ready__:
+        case HASH::fin__:
+            // Programs are limited to cell sized data, so there are
+            // no assets or block memory to manage
+            return MessageResult::Consumed;
+        case HASH::transform:
+        {
+            messages::TransformR<T> msgr(msgAcc);
+            self().applyTransform(msgAcc.message().source, msgr.isLocal(), msgr.transform());
+            return MessageResult::Consumed;
+        }
+        case HASH::set_property:
+            // Property setters are compiled as handlers keyed by
+            // property name.
+            return runHandler(msgAcc, _msg.payload.u);
+        default:
+            return runHandler(msgAcc, _msg.msgId);
+        }
+    }
+
+private:
+    VmComponent(Entity * pEntity, const ScriptProgramSlot * pSlot)
+      : Component(pEntity)
+    {
+        const ScriptProgram * pProgram = pSlot->pProgram.load(std::memory_order_acquire);
+        if (pProgram->isUpdatable())
+            mScriptTask = Task::create_updatable(this, pProgram->nameHash());
+        else
+            mScriptTask = Task::create(this, pProgram->nameHash());
+        mBlockCount = pProgram->blockCount();
+        mpProgramSlot = pSlot;
+    }
+    VmComponent(const VmComponent&)              = delete;
+    VmComponent(VmComponent&&)                   = delete;
+    VmComponent & operator=(const VmComponent&)  = delete;
+    VmComponent & operator=(VmComponent&&)       = delete;
+
+    void prepareFrame(ScriptVmFrame & frame, const cell * pMsgCells, u32 msgCellCount)
+    {
+        frame.pCells = reinterpret_cast<cell*>(mpBlocks);
+        frame.cellCount = mBlockCount * kCellsPerBlock;
+        frame.pMsgCells = pMsgCells;
+        frame.msgCellCount = msgCellCount;
+        frame.payload.u = 0;
+        frame.pCaller = mpEntity;
+    }
+
+    template <typename T>
+    MessageResult runHandler(const T & msgAcc, u32 handlerId)
+    {
+        const ScriptProgram & program = *mpProgramSlot->pProgram.load(std::memory_order_acquire);
+        const ScriptProgramHandler * pHandler = program.findHandler(handlerId);
+        if (!pHandler)
+            return MessageResult::Propagate;
+
+        const Message & msg = msgAcc.message();
+        if (msg.blockCount < pHandler->blockCount)
+        {
+            ERR("Message %s has too few blocks for script handler, expected %u, received %u",
+                HASH::reverse_hash(msg.msgId),
+                pHandler->blockCount,
+                msg.blockCount);
+            return MessageResult::Consumed;
+        }
+
+        // Message blocks may wrap in the queue, so copy them out
+        Block msgBlocks[kMaxBlockCount];
+        for (u32 i = 0; i < pHandler->blockCount; ++i)
+            msgBlocks[i] = msgAcc[i];
+
+        ScriptVmFrame frame;
+        prepareFrame(frame, reinterpret_cast<const cell*>(msgBlocks), pHandler->blockCount * kCellsPerBlock);
+        frame.payload = msg.payload;
+        script_vm_run(program, pHandler->entry, frame);
+        return MessageResult::Consumed;
+    }
+};
+static_assert(sizeof(Component) == sizeof(VmComponent), "Component subclass has data members!");
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_ENGINE_VMCOMPONENT_H
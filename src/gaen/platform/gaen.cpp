@@ -33,12 +33,16 @@
 #include "gaen/core/platutils.h"
 #include "gaen/core/logging.h"
 #include "gaen/core/threading.h"
+#include "gaen/core/parallel_for.h"
 #include "gaen/core/mem.h"
 #include "gaen/core/sockets.h"
 
 #include "gaen/engine/TaskMaster.h"
 #include "gaen/engine/Entity.h"
 #include "gaen/engine/Registry.h"
+#include "gaen/engine/ScriptVm.h"
+
+#include "gaen/render_support/script_syscalls.h"
 
 #include "gaen/platform/gaen.h"
 
@@ -77,6 +81,10 @@ static thread_id sNumThreads = 1;
 static const u32 kMaxEntityName = 64;
 static char sStartEntity[kMaxEntityName+1] = "init.Start";
 
+static const u32 kMaxScriptPrograms = 256;
+static const char * sScriptPrograms[kMaxScriptPrograms];
+static u32 sScriptProgramCount = 0;
+
 static const size_t kMaxIpLen = 16;
 static char sLoggingServerIp[kMaxIpLen] = {0};
 #ifndef IS_HEADLESS
@@ -118,6 +126,8 @@ static const char * sHelpMsg =
     "             When pool memory is freed, it is load balanced across threads,\n"
     "             applying the freed pool block to hungry threads first.\n"
     "  -s entity  Entity to start. Defaults to \"init.start\".\n"
+    "  -b path    Load a bytecode component compiled with cmpc -b.\n"
+    "             May be specified multiple times.\n"
 #if HAS(DEV_BUILD)
     "  -e         Start in editor mode. Toggle with `\n"
 #endif
@@ -200,6 +210,14 @@ static void parse_args(int argc,
                 ++i;
                 break;
             }
+            case 'b':
+            {
+                if (sScriptProgramCount >= kMaxScriptPrograms)
+                    printHelpAndExit();
+                sScriptPrograms[sScriptProgramCount++] = argv[i+1];
+                ++i;
+                break;
+            }
 #if HAS(DEV_BUILD)
             case 'e':
             {
@@ -263,6 +281,16 @@ void start_gaen()
     if (sIsEditorActive)
         LOG_INFO("Editor Activated");
 
+    // Every syscall cmpc -b can emit must resolve before programs load
+    register_render_support_syscalls();
+    PANIC_IF(!verify_script_syscalls(), "Script syscalls missing, see log");
+
+    // Programs must be loaded before TaskMasters can construct them
+    for (u32 i = 0; i < sScriptProgramCount; ++i)
+    {
+        PANIC_IF(!load_script_program(sScriptPrograms[i]), "Unable to load script program: %s", sScriptPrograms[i]);
+    }
+
     set_start_entity(sStartEntity);
     init_task_masters();
 }
@@ -278,6 +306,8 @@ void set_renderer(const Task & rendererTask)
 void fin_gaen()
 {
     fin_task_masters();
+    fin_script_programs();
+    fin_parallel_for();
 }
 
 void initiate_fin_gaen()
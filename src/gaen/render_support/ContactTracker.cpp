@@ -0,0 +1,100 @@
+//------------------------------------------------------------------------------
+// ContactTracker.cpp - Contact begin/persist/end tracking for physics bodies
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include <algorithm>
+
+#include "gaen/engine/messages/Collision.h"
+
+#include "gaen/render_support/ContactTracker.h"
+
+namespace gaen
+{
+
+void CollisionMessageBatch::queue(u32 msgId,
+                                  task_id target,
+                                  u32 group,
+                                  task_id subject,
+                                  const ContactInfo & info,
+                                  bool isSelfA)
+{
+    Event & event = mEvents.emplace_back();
+    event.msgId = msgId;
+    event.target = target;
+    event.group = group;
+    event.subject = subject;
+    event.distance = info.distance;
+    event.locSelf = isSelfA ? info.locA : info.locB;
+    event.locOther = isSelfA ? info.locB : info.locA;
+}
+
+u32 CollisionMessageBatch::flush(task_id source)
+{
+    if (mEvents.empty())
+        return 0;
+
+    // Stable so events between the same two tasks in the same group
+    // stay in the order they happened, e.g. a begin and end within one
+    // frame.
+    std::stable_sort(mEvents.begin(), mEvents.end(), [](const Event & lhs, const Event & rhs)
+    {
+        if (lhs.target != rhs.target)
+            return lhs.target < rhs.target;
+        if (lhs.subject != rhs.subject)
+            return lhs.subject < rhs.subject;
+        return lhs.group < rhs.group;
+    });
+
+    u32 sent = 0;
+    for (size_t i = 0; i < mEvents.size(); ++i)
+    {
+        const Event & event = mEvents[i];
+        if (i + 1 < mEvents.size())
+        {
+            const Event & next = mEvents[i + 1];
+            if (next.target == event.target &&
+                next.subject == event.subject &&
+                next.group == event.group &&
+                next.msgId == event.msgId)
+                continue;
+        }
+
+        messages::CollisionBW msgw(event.msgId, kMessageFlag_None, source, event.target, event.group);
+        msgw.setSubject(event.subject);
+        msgw.setDistance(event.distance);
+        msgw.setLocationSelf(event.locSelf);
+        msgw.setLocationOther(event.locOther);
+        send_message(msgw);
+        sent++;
+    }
+
+    mEvents.clear();
+    mSentCount += sent;
+    return sent;
+}
+
+} // namespace gaen
@@ -0,0 +1,199 @@
+//------------------------------------------------------------------------------
+// ContactTracker.h - Contact begin/persist/end tracking for physics bodies
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_CONTACT_TRACKER_H
+#define GAEN_RENDER_SUPPORT_CONTACT_TRACKER_H
+
+#include "gaen/core/HashMap.h"
+#include "gaen/core/Vector.h"
+#include "gaen/math/vec3.h"
+#include "gaen/engine/Message.h"
+
+namespace gaen
+{
+
+enum class ContactPhase : u8
+{
+    Begin,
+    Persist
+};
+
+struct ContactInfo
+{
+    f32 distance = 0.0f;
+    vec3 locA{0.0f};
+    vec3 locB{0.0f};
+};
+
+// Remembers which body pairs were touching last tick so collision
+// messages only go out when a contact begins or ends, instead of every
+// tick for as long as two bodies rest on each other.
+//
+// Pairs are unordered, (a, b) and (b, a) are the same contact.
+template <class BodyT>
+class ContactTracker
+{
+public:
+    // Record that two bodies touch this tick
+    ContactPhase touch(const BodyT * pBodyA, const BodyT * pBodyB, const ContactInfo & info)
+    {
+        auto res = mContacts.emplace(std::piecewise_construct,
+                                     std::forward_as_tuple(pBodyA, pBodyB),
+                                     std::forward_as_tuple(pBodyA, pBodyB, info, mTick));
+        if (res.second)
+            return ContactPhase::Begin;
+
+        Contact & contact = res.first->second;
+        contact.pBodyA = pBodyA;
+        contact.pBodyB = pBodyB;
+        contact.info = info;
+        contact.tick = mTick;
+        return ContactPhase::Persist;
+    }
+
+    // Ends every contact not touched since the previous endTick.
+    // endFunc(pBodyA, pBodyB, lastInfo) is called for each.
+    template <class EndFunc>
+    void endTick(EndFunc endFunc)
+    {
+        for (auto it = mContacts.begin(); it != mContacts.end();)
+        {
+            const Contact & contact = it->second;
+            if (contact.tick != mTick)
+            {
+                endFunc(contact.pBodyA, contact.pBodyB, contact.info);
+                it = mContacts.erase(it);
+            }
+            else
+                ++it;
+        }
+        mTick++;
+    }
+
+    // Ends every contact involving pBody, call before the body is
+    // destroyed so a new body at the same address doesn't inherit them.
+    template <class EndFunc>
+    void removeBody(const BodyT * pBody, EndFunc endFunc)
+    {
+        for (auto it = mContacts.begin(); it != mContacts.end();)
+        {
+            const Contact & contact = it->second;
+            if (contact.pBodyA == pBody || contact.pBodyB == pBody)
+            {
+                endFunc(contact.pBodyA, contact.pBodyB, contact.info);
+                it = mContacts.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+
+    u32 contactCount() const { return static_cast<u32>(mContacts.size()); }
+
+private:
+    struct PairKey
+    {
+        const BodyT * pLo;
+        const BodyT * pHi;
+
+        PairKey(const BodyT * pBodyA, const BodyT * pBodyB)
+          : pLo(pBodyA < pBodyB ? pBodyA : pBodyB)
+          , pHi(pBodyA < pBodyB ? pBodyB : pBodyA)
+        {}
+
+        bool operator==(const PairKey & rhs) const
+        {
+            return pLo == rhs.pLo && pHi == rhs.pHi;
+        }
+    };
+
+    struct PairKeyHash
+    {
+        size_t operator()(const PairKey & key) const
+        {
+            size_t lo = reinterpret_cast<size_t>(key.pLo);
+            size_t hi = reinterpret_cast<size_t>(key.pHi);
+            return lo ^ (hi + 0x9e3779b9 + (lo << 6) + (lo >> 2));
+        }
+    };
+
+    struct Contact
+    {
+        const BodyT * pBodyA;
+        const BodyT * pBodyB;
+        ContactInfo info;
+        u32 tick;
+
+        Contact(const BodyT * pBodyA, const BodyT * pBodyB, const ContactInfo & info, u32 tick)
+          : pBodyA(pBodyA)
+          , pBodyB(pBodyB)
+          , info(info)
+          , tick(tick)
+        {}
+    };
+
+    HashMap<kMEM_Physics, PairKey, Contact, PairKeyHash> mContacts;
+    u32 mTick = 0;
+};
+
+// Collision messages queued during a physics tick and sent together
+// afterwards, grouped by target so each TaskMaster queue sees one run
+// of messages per entity. Back to back repeats of the same message for
+// the same target, subject and group collapse to the last one.
+class CollisionMessageBatch
+{
+public:
+    void queue(u32 msgId,
+               task_id target,
+               u32 group,
+               task_id subject,
+               const ContactInfo & info,
+               bool isSelfA);
+
+    // Returns the number of messages sent
+    u32 flush(task_id source);
+
+    u32 sentCount() const { return mSentCount; }
+
+private:
+    struct Event
+    {
+        u32 msgId;
+        task_id target;
+        u32 group;
+        task_id subject;
+        f32 distance;
+        vec3 locSelf;
+        vec3 locOther;
+    };
+
+    Vector<kMEM_Physics, Event> mEvents;
+    u32 mSentCount = 0;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_CONTACT_TRACKER_H
@@ -0,0 +1,103 @@
+//------------------------------------------------------------------------------
+// DrawList.cpp - Sort keyed list of a frame's draws
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include "gaen/render_support/DrawList.h"
+
+namespace gaen
+{
+
+// Below this, an insertion sort beats the radix passes' histogram setup
+static const u32 kRadixMinEntries = 64;
+
+void DrawList::sort()
+{
+    u32 count = size();
+    if (count < 2)
+        return;
+
+    if (count < kRadixMinEntries)
+    {
+        for (u32 i = 1; i < count; ++i)
+        {
+            DrawEntry entry = mEntries[i];
+            u32 j = i;
+            while (j > 0 && mEntries[j-1].key > entry.key)
+            {
+                mEntries[j] = mEntries[j-1];
+                --j;
+            }
+            mEntries[j] = entry;
+        }
+        return;
+    }
+
+    // Bytes that are the same in every key, e.g. the pass bits when
+    // a stage only has opaque items, don't need a pass.
+    u64 keyAnd = ~0ull;
+    u64 keyOr = 0;
+    for (const DrawEntry & entry : mEntries)
+    {
+        keyAnd &= entry.key;
+        keyOr |= entry.key;
+    }
+    u64 varying = keyAnd ^ keyOr;
+
+    mScratch.resize(count);
+    DrawEntry * pSrc = mEntries.data();
+    DrawEntry * pDst = mScratch.data();
+
+    for (u32 shift = 0; shift < 64; shift += 8)
+    {
+        if (((varying >> shift) & 0xff) == 0)
+            continue;
+
+        u32 offsets[256] = {};
+        for (u32 i = 0; i < count; ++i)
+            offsets[(pSrc[i].key >> shift) & 0xff]++;
+
+        u32 total = 0;
+        for (u32 b = 0; b < 256; ++b)
+        {
+            u32 c = offsets[b];
+            offsets[b] = total;
+            total += c;
+        }
+
+        for (u32 i = 0; i < count; ++i)
+            pDst[offsets[(pSrc[i].key >> shift) & 0xff]++] = pSrc[i];
+
+        DrawEntry * pTmp = pSrc;
+        pSrc = pDst;
+        pDst = pTmp;
+    }
+
+    if (pSrc != mEntries.data())
+        mEntries.swap(mScratch);
+}
+
+} // namespace gaen
@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------
+// DrawList.h - Sort keyed list of a frame's draws
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_DRAW_LIST_H
+#define GAEN_RENDER_SUPPORT_DRAW_LIST_H
+
+#include <cstring>
+
+#include "gaen/core/HashMap.h"
+#include "gaen/core/Vector.h"
+
+namespace gaen
+{
+
+// 64 bit draw keys, most significant bits first:
+//
+//   pass (4) | shader (12) | material (24) | depth (24)
+//
+// Sorting by key groups draws so shader and texture changes only
+// happen on transitions. Depth sorted items, e.g. alpha blended
+// sprites, put depth ahead of state so their back to front order is
+// kept and state only groups among draws at equal depth:
+//
+//   pass (4) | depth (24) | shader (12) | material (24)
+
+static const u32 kDrawKeyShaderBits = 12;
+static const u32 kDrawKeyMaterialBits = 24;
+static const u32 kDrawKeyDepthBits = 24;
+
+// Maps a float to 24 bits that sort in the same order as the float,
+// negatives included. Low mantissa bits are dropped, so very close
+// depths may compare equal.
+inline u64 draw_key_depth(f32 depth)
+{
+    u32 bits;
+    memcpy(&bits, &depth, sizeof(u32));
+    bits = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    return bits >> (32 - kDrawKeyDepthBits);
+}
+
+inline u64 draw_key(u32 pass, u32 shaderSlot, u32 material, f32 depth)
+{
+    ASSERT(pass < 16);
+    ASSERT(shaderSlot < (1 << kDrawKeyShaderBits));
+    return (u64)pass << 60 |
+           (u64)shaderSlot << 48 |
+           (u64)(material & ((1 << kDrawKeyMaterialBits) - 1)) << 24 |
+           draw_key_depth(depth);
+}
+
+inline u64 draw_key_depth_sorted(u32 pass, u32 shaderSlot, u32 material, f32 depth)
+{
+    ASSERT(pass < 16);
+    ASSERT(shaderSlot < (1 << kDrawKeyShaderBits));
+    return (u64)pass << 60 |
+           draw_key_depth(depth) << 36 |
+           (u64)shaderSlot << 24 |
+           (u64)(material & ((1 << kDrawKeyMaterialBits) - 1));
+}
+
+inline u32 draw_key_pass(u64 key)
+{
+    return static_cast<u32>(key >> 60);
+}
+
+// Assigns dense, small slots to 32 bit hashes (e.g. shader names) so
+// they fit in a draw key's shader field.
+class DrawKeySlots
+{
+public:
+    u32 slot(u32 hash)
+    {
+        auto it = mSlots.find(hash);
+        if (it != mSlots.end())
+            return it->second;
+        u32 slot = static_cast<u32>(mSlots.size());
+        PANIC_IF(slot >= (1 << kDrawKeyShaderBits), "Too many draw key slots");
+        mSlots.emplace(hash, slot);
+        return slot;
+    }
+
+private:
+    HashMap<kMEM_Renderer, u32, u32> mSlots;
+};
+
+struct DrawEntry
+{
+    u64 key;
+    u32 index; // caller's index of the item to draw
+};
+
+// Rebuilt every frame: push a key per visible item, sort, then draw
+// in order. Sorting is a stable LSD radix sort, so items with equal
+// keys draw in the order they were pushed.
+class DrawList
+{
+public:
+    void clear() { mEntries.clear(); }
+    void reserve(u32 count) { mEntries.reserve(count); }
+
+    void push(u64 key, u32 index)
+    {
+        mEntries.push_back(DrawEntry{key, index});
+    }
+
+    void sort();
+
+    u32 size() const { return static_cast<u32>(mEntries.size()); }
+    bool empty() const { return mEntries.empty(); }
+    const DrawEntry & operator[](u32 idx) const { return mEntries[idx]; }
+
+private:
+    Vector<kMEM_Renderer, DrawEntry> mEntries;
+    Vector<kMEM_Renderer, DrawEntry> mScratch;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_DRAW_LIST_H
@@ -0,0 +1,132 @@
+//------------------------------------------------------------------------------
+// FrameHandoff.h - Passes whole frames from one thread to another, in order
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_FRAME_HANDOFF_H
+#define GAEN_RENDER_SUPPORT_FRAME_HANDOFF_H
+
+#include <condition_variable>
+#include <mutex>
+
+#include "gaen/core/base_defines.h"
+
+namespace gaen
+{
+
+// Three frame buffers shared by one producer and one consumer thread.
+// While the consumer reads one frame the producer can have another
+// waiting and be writing a third, so producing frame N+1 overlaps
+// consuming frame N. The producer only waits when it gets a whole
+// handoff ahead.
+//
+// Frames are consumed in order and never dropped, so per frame work
+// lists (e.g. gpu loads and unloads) can travel inside them. A frame's
+// buffer comes back to the producer from beginWrite only after the
+// consumer is done with it, which is when anything it handed over can
+// be freed.
+template <class T>
+class FrameHandoff
+{
+public:
+    static const u32 kFrameCount = 3;
+
+    // Producer: blocks while every frame is waiting on the consumer
+    T & beginWrite()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCond.wait(lock, [this]() { return mInUse < kFrameCount; });
+        return mFrames[mWriteIdx];
+    }
+
+    void endWrite()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mWriteIdx = (mWriteIdx + 1) % kFrameCount;
+            mInUse++;
+            mReadyCount++;
+        }
+        mCond.notify_all();
+    }
+
+    // Producer: wakes the consumer, beginRead returns nullptr once the
+    // remaining frames are read.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mIsClosed = true;
+        }
+        mCond.notify_all();
+    }
+
+    // Consumer: blocks until a frame is ready
+    T * beginRead()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCond.wait(lock, [this]() { return mReadyCount > 0 || mIsClosed; });
+        if (mReadyCount == 0)
+            return nullptr;
+        mReadyCount--;
+        return &mFrames[mReadIdx];
+    }
+
+    // Consumer: nullptr if no frame is ready
+    T * tryBeginRead()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mReadyCount == 0)
+            return nullptr;
+        mReadyCount--;
+        return &mFrames[mReadIdx];
+    }
+
+    void endRead()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ASSERT(mInUse > 0);
+            mReadIdx = (mReadIdx + 1) % kFrameCount;
+            mInUse--;
+        }
+        mCond.notify_all();
+    }
+
+private:
+    T mFrames[kFrameCount];
+
+    std::mutex mMutex;
+    std::condition_variable mCond;
+
+    u32 mWriteIdx = 0;
+    u32 mReadIdx = 0;
+    u32 mInUse = 0;      // written and not yet done being read
+    u32 mReadyCount = 0; // written and not yet begun being read
+    bool mIsClosed = false;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_FRAME_HANDOFF_H
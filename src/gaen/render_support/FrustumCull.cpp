@@ -0,0 +1,207 @@
+//------------------------------------------------------------------------------
+// FrustumCull.cpp - Bounding sphere frustum and distance culling
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CULL_SSE HAS_X
+#include <xmmintrin.h>
+#else
+#define CULL_SSE HAS__
+#endif
+
+#include "gaen/core/parallel_for.h"
+
+#include "gaen/render_support/FrustumCull.h"
+
+namespace gaen
+{
+
+Frustum Frustum::from_view_projection(const mat4 & viewProj)
+{
+    // Gribb/Hartmann, planes are sums and differences of the
+    // matrix's fourth row with each of the others.
+    vec4 rows[4];
+    for (u32 r = 0; r < 4; ++r)
+        rows[r] = vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]);
+
+    Frustum frustum;
+    frustum.planes[kPLA_Left]   = rows[3] + rows[0];
+    frustum.planes[kPLA_Right]  = rows[3] - rows[0];
+    frustum.planes[kPLA_Bottom] = rows[3] + rows[1];
+    frustum.planes[kPLA_Top]    = rows[3] - rows[1];
+    frustum.planes[kPLA_Near]   = rows[3] + rows[2];
+    frustum.planes[kPLA_Far]    = rows[3] - rows[2];
+
+    for (u32 i = 0; i < kPLA_COUNT; ++i)
+    {
+        vec4 & p = frustum.planes[i];
+        f32 len = sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+        if (len > 0.0f)
+            p = vec4(p.x / len, p.y / len, p.z / len, p.w / len);
+    }
+    return frustum;
+}
+
+static inline bool sphere_visible(const Frustum & frustum, f32 x, f32 y, f32 z, f32 r)
+{
+    for (u32 p = 0; p < Frustum::kPLA_COUNT; ++p)
+    {
+        const vec4 & plane = frustum.planes[p];
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < -r)
+            return false;
+    }
+    if (frustum.maxDistance > 0.0f)
+    {
+        f32 dx = x - frustum.eye.x;
+        f32 dy = y - frustum.eye.y;
+        f32 dz = z - frustum.eye.z;
+        f32 lim = frustum.maxDistance + r;
+        if (dx * dx + dy * dy + dz * dz > lim * lim)
+            return false;
+    }
+    return true;
+}
+
+void frustum_cull_spheres(const Frustum & frustum,
+                          const f32 * pCentX,
+                          const f32 * pCentY,
+                          const f32 * pCentZ,
+                          const f32 * pRad,
+                          u32 count,
+                          u8 * pVisible)
+{
+    u32 i = 0;
+
+#if HAS(CULL_SSE)
+    __m128 pa[Frustum::kPLA_COUNT];
+    __m128 pb[Frustum::kPLA_COUNT];
+    __m128 pc[Frustum::kPLA_COUNT];
+    __m128 pd[Frustum::kPLA_COUNT];
+    for (u32 p = 0; p < Frustum::kPLA_COUNT; ++p)
+    {
+        pa[p] = _mm_set1_ps(frustum.planes[p].x);
+        pb[p] = _mm_set1_ps(frustum.planes[p].y);
+        pc[p] = _mm_set1_ps(frustum.planes[p].z);
+        pd[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+
+    bool distCull = frustum.maxDistance > 0.0f;
+    __m128 ex = _mm_set1_ps(frustum.eye.x);
+    __m128 ey = _mm_set1_ps(frustum.eye.y);
+    __m128 ez = _mm_set1_ps(frustum.eye.z);
+    __m128 maxDist = _mm_set1_ps(frustum.maxDistance);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(pCentX + i);
+        __m128 y = _mm_loadu_ps(pCentY + i);
+        __m128 z = _mm_loadu_ps(pCentZ + i);
+        __m128 r = _mm_loadu_ps(pRad + i);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+        __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(pa[0], x), _mm_mul_ps(pb[0], y)),
+                                                _mm_add_ps(_mm_mul_ps(pc[0], z), pd[0])),
+                                     negR);
+        for (u32 p = 1; p < Frustum::kPLA_COUNT; ++p)
+        {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pa[p], x), _mm_mul_ps(pb[p], y)),
+                                  _mm_add_ps(_mm_mul_ps(pc[p], z), pd[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+        }
+
+        if (distCull)
+        {
+            __m128 dx = _mm_sub_ps(x, ex);
+            __m128 dy = _mm_sub_ps(y, ey);
+            __m128 dz = _mm_sub_ps(z, ez);
+            __m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            __m128 lim = _mm_add_ps(maxDist, r);
+            inside = _mm_and_ps(inside, _mm_cmple_ps(distSq, _mm_mul_ps(lim, lim)));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        pVisible[i]   = (mask >> 0) & 1;
+        pVisible[i+1] = (mask >> 1) & 1;
+        pVisible[i+2] = (mask >> 2) & 1;
+        pVisible[i+3] = (mask >> 3) & 1;
+    }
+#endif // #if HAS(CULL_SSE)
+
+    for (; i < count; ++i)
+        pVisible[i] = sphere_visible(frustum, pCentX[i], pCentY[i], pCentZ[i], pRad[i]) ? 1 : 0;
+}
+
+// Small enough chunks to balance across threads, large enough to
+// amortize the job handoff
+static const u32 kCullChunkSize = 4096;
+
+struct CullJobContext
+{
+    const Frustum * pFrustum;
+    const f32 * pCentX;
+    const f32 * pCentY;
+    const f32 * pCentZ;
+    const f32 * pRad;
+    u32 count;
+    u8 * pVisible;
+};
+
+static void cull_chunk(const void * pContext, u32 jobIdx)
+{
+    const CullJobContext & ctx = *static_cast<const CullJobContext*>(pContext);
+    u32 begin = jobIdx * kCullChunkSize;
+    u32 count = min(kCullChunkSize, ctx.count - begin);
+    frustum_cull_spheres(*ctx.pFrustum,
+                         ctx.pCentX + begin,
+                         ctx.pCentY + begin,
+                         ctx.pCentZ + begin,
+                         ctx.pRad + begin,
+                         count,
+                         ctx.pVisible + begin);
+}
+
+void frustum_cull_spheres_parallel(const Frustum & frustum,
+                                   const f32 * pCentX,
+                                   const f32 * pCentY,
+                                   const f32 * pCentZ,
+                                   const f32 * pRad,
+                                   u32 count,
+                                   u8 * pVisible,
+                                   u32 threadCount)
+{
+    u32 jobCount = (count + kCullChunkSize - 1) / kCullChunkSize;
+    if (jobCount <= 1 || threadCount == 1)
+    {
+        frustum_cull_spheres(frustum, pCentX, pCentY, pCentZ, pRad, count, pVisible);
+        return;
+    }
+
+    CullJobContext ctx{&frustum, pCentX, pCentY, pCentZ, pRad, count, pVisible};
+    parallel_for(jobCount, threadCount, cull_chunk, &ctx);
+}
+
+} // namespace gaen
@@ -0,0 +1,180 @@
+//------------------------------------------------------------------------------
+// FrustumCull.h - Bounding sphere frustum and distance culling
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_FRUSTUM_CULL_H
+#define GAEN_RENDER_SUPPORT_FRUSTUM_CULL_H
+
+#include "gaen/core/HashMap.h"
+#include "gaen/core/Vector.h"
+#include "gaen/math/vec3.h"
+#include "gaen/math/vec4.h"
+#include "gaen/math/mat4.h"
+
+namespace gaen
+{
+
+struct Frustum
+{
+    enum PlaneType
+    {
+        kPLA_Left = 0,
+        kPLA_Right,
+        kPLA_Bottom,
+        kPLA_Top,
+        kPLA_Near,
+        kPLA_Far,
+
+        kPLA_COUNT
+    };
+
+    // Normalized planes, dot(plane.xyz, p) + plane.w >= 0 for points inside
+    vec4 planes[kPLA_COUNT];
+
+    // Optional distance cull, anything further than maxDistance from
+    // eye is culled. 0 disables.
+    vec3 eye{0.0f};
+    f32 maxDistance = 0.0f;
+
+    // Extracts the planes of a GL style (-1 to 1 clip z) view projection
+    static Frustum from_view_projection(const mat4 & viewProj);
+};
+
+// Writes 1 to pVisible[i] if sphere i is at least partly inside the
+// frustum, 0 otherwise. Spheres are passed as separate arrays so four
+// are tested per SSE instruction.
+void frustum_cull_spheres(const Frustum & frustum,
+                          const f32 * pCentX,
+                          const f32 * pCentY,
+                          const f32 * pCentZ,
+                          const f32 * pRad,
+                          u32 count,
+                          u8 * pVisible);
+
+// Same as frustum_cull_spheres, split into chunks run by parallel_for
+// on up to threadCount threads, including the calling thread. 0 means
+// one per core.
+void frustum_cull_spheres_parallel(const Frustum & frustum,
+                                   const f32 * pCentX,
+                                   const f32 * pCentY,
+                                   const f32 * pCentZ,
+                                   const f32 * pRad,
+                                   u32 count,
+                                   u8 * pVisible,
+                                   u32 threadCount);
+
+// World bounding spheres of a stage's items, stored as arrays for
+// frustum_cull_spheres. Slots are swap-removed so the arrays stay
+// packed, so indices are only stable between inserts and removes.
+template <class T>
+class CullSet
+{
+public:
+    void insert(u32 uid, const T & item, const vec3 & center, f32 radius)
+    {
+        ASSERT(mIndices.find(uid) == mIndices.end());
+        mIndices.emplace(uid, static_cast<u32>(mUids.size()));
+        mUids.push_back(uid);
+        mItems.push_back(item);
+        mCentX.push_back(center.x);
+        mCentY.push_back(center.y);
+        mCentZ.push_back(center.z);
+        mRad.push_back(radius);
+        mVisible.push_back(1);
+    }
+
+    void update(u32 uid, const vec3 & center, f32 radius)
+    {
+        auto it = mIndices.find(uid);
+        ASSERT(it != mIndices.end());
+        if (it != mIndices.end())
+        {
+            u32 idx = it->second;
+            mCentX[idx] = center.x;
+            mCentY[idx] = center.y;
+            mCentZ[idx] = center.z;
+            mRad[idx] = radius;
+        }
+    }
+
+    void remove(u32 uid)
+    {
+        auto it = mIndices.find(uid);
+        if (it == mIndices.end())
+            return;
+
+        u32 idx = it->second;
+        u32 last = size() - 1;
+        mIndices.erase(it);
+        if (idx != last)
+        {
+            mUids[idx] = mUids[last];
+            mItems[idx] = mItems[last];
+            mCentX[idx] = mCentX[last];
+            mCentY[idx] = mCentY[last];
+            mCentZ[idx] = mCentZ[last];
+            mRad[idx] = mRad[last];
+            mVisible[idx] = mVisible[last];
+            mIndices[mUids[idx]] = idx;
+        }
+        mUids.pop_back();
+        mItems.pop_back();
+        mCentX.pop_back();
+        mCentY.pop_back();
+        mCentZ.pop_back();
+        mRad.pop_back();
+        mVisible.pop_back();
+    }
+
+    // Refreshes visible() for every slot
+    void cull(const Frustum & frustum, u32 threadCount = 1)
+    {
+        if (threadCount == 1)
+            frustum_cull_spheres(frustum, mCentX.data(), mCentY.data(), mCentZ.data(), mRad.data(), size(), mVisible.data());
+        else
+            frustum_cull_spheres_parallel(frustum, mCentX.data(), mCentY.data(), mCentZ.data(), mRad.data(), size(), mVisible.data(), threadCount);
+    }
+
+    u32 size() const { return static_cast<u32>(mUids.size()); }
+    const T & item(u32 idx) const { return mItems[idx]; }
+    u32 uid(u32 idx) const { return mUids[idx]; }
+    bool visible(u32 idx) const { return mVisible[idx] != 0; }
+    vec3 center(u32 idx) const { return vec3(mCentX[idx], mCentY[idx], mCentZ[idx]); }
+
+private:
+    Vector<kMEM_Renderer, f32> mCentX;
+    Vector<kMEM_Renderer, f32> mCentY;
+    Vector<kMEM_Renderer, f32> mCentZ;
+    Vector<kMEM_Renderer, f32> mRad;
+    Vector<kMEM_Renderer, u8> mVisible;
+
+    Vector<kMEM_Renderer, u32> mUids;
+    Vector<kMEM_Renderer, T> mItems;
+    HashMap<kMEM_Renderer, u32, u32> mIndices; // uid to slot
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_FRUSTUM_CULL_H
@@ -39,6 +39,8 @@ struct RGB8
     u8 g;
     u8 b;
 
+    RGB8() = default;
+
     RGB8(u8 r, u8 g, u8 b)
         : r(r)
         , g(g)
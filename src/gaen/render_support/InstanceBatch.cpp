@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+// InstanceBatch.cpp - Groups draws that share gpu state into instanced draws
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include "gaen/core/hashing.h"
+
+#include "gaen/render_support/InstanceBatch.h"
+
+namespace gaen
+{
+
+bool InstanceBatchKey::operator==(const InstanceBatchKey & rhs) const
+{
+    return memcmp(this, &rhs, sizeof(InstanceBatchKey)) == 0;
+}
+
+size_t InstanceBatchKeyHash::operator()(const InstanceBatchKey & key) const
+{
+    return fnv1a_32(reinterpret_cast<const u8*>(&key), sizeof(InstanceBatchKey));
+}
+
+void InstanceBatcher::clear()
+{
+    mBatches.clear();
+    mBatchMap.clear();
+    mPushed.clear();
+    mPushedBatch.clear();
+    mInstances.clear();
+}
+
+void InstanceBatcher::reserve(u32 count)
+{
+    mPushed.reserve(count);
+    mPushedBatch.reserve(count);
+    mInstances.reserve(count);
+}
+
+void InstanceBatcher::push(const InstanceBatchKey & key,
+                           const mat43 & transform,
+                           u32 frameOffset,
+                           u32 itemIndex,
+                           bool keepOrder)
+{
+    u32 batchIdx = batchCount();
+
+    // Sorted draws mostly repeat the previous key, check it first
+    if (!mPushedBatch.empty() && mBatches[mPushedBatch.back()].key == key)
+    {
+        batchIdx = mPushedBatch.back();
+    }
+    else if (!keepOrder)
+    {
+        auto it = mBatchMap.find(key);
+        if (it != mBatchMap.end())
+            batchIdx = it->second;
+    }
+
+    if (batchIdx == batchCount())
+    {
+        mBatches.push_back(InstanceBatch{key, 0, 0, itemIndex});
+        if (!keepOrder)
+            mBatchMap.emplace(key, batchIdx);
+    }
+
+    mBatches[batchIdx].instanceCount++;
+    mPushed.push_back(InstanceData{transform, frameOffset});
+    mPushedBatch.push_back(batchIdx);
+}
+
+void InstanceBatcher::finish()
+{
+    u32 first = 0;
+    for (InstanceBatch & batch : mBatches)
+    {
+        batch.firstInstance = first;
+        first += batch.instanceCount;
+    }
+
+    mInstances.resize(mPushed.size());
+
+    // Scatter into batch order, reusing instanceCount as the fill cursor
+    for (InstanceBatch & batch : mBatches)
+        batch.instanceCount = 0;
+
+    for (u32 i = 0; i < mPushed.size(); ++i)
+    {
+        InstanceBatch & batch = mBatches[mPushedBatch[i]];
+        mInstances[batch.firstInstance + batch.instanceCount++] = mPushed[i];
+    }
+}
+
+} // namespace gaen
@@ -0,0 +1,119 @@
+//------------------------------------------------------------------------------
+// InstanceBatch.h - Groups draws that share gpu state into instanced draws
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_INSTANCE_BATCH_H
+#define GAEN_RENDER_SUPPORT_INSTANCE_BATCH_H
+
+#include "gaen/core/HashMap.h"
+#include "gaen/core/Vector.h"
+#include "gaen/math/mat43.h"
+
+namespace gaen
+{
+
+// Per instance data streamed to the gpu each frame. Layout matches the
+// inst_transform (mat4x3, 4 locations) and inst_frame_offset vertex
+// attributes of the instanced shaders.
+struct InstanceData
+{
+    mat43 transform;
+    u32 frameOffset;
+};
+static_assert(sizeof(InstanceData) == 52, "InstanceData must match instanced shader attributes");
+
+static const u32 kInstanceAttribLocation = 8;
+
+// Everything two draws must share to go out as one instanced draw.
+// Keys are compared and hashed as raw bytes, so zero unused fields.
+struct InstanceBatchKey
+{
+    u32 pass;
+    u32 shaderHash;
+    u32 vertArrayId;
+    u32 primBufferId;
+    u32 materialId;
+    u32 animationsId;
+    u32 indexOffset; // byte offset into the prim buffer
+    u32 indexCount;
+
+    bool operator==(const InstanceBatchKey & rhs) const;
+};
+
+struct InstanceBatchKeyHash
+{
+    size_t operator()(const InstanceBatchKey & key) const;
+};
+
+struct InstanceBatch
+{
+    InstanceBatchKey key;
+    u32 firstInstance;
+    u32 instanceCount;
+    u32 itemIndex; // caller's index of the batch's first item
+};
+
+// Rebuilt every frame from the sorted draw list. Push one instance per
+// draw, then finish() to lay out each batch's instances contiguously
+// for upload.
+//
+// Draws that must keep their sorted order, e.g. alpha blended sprites,
+// only join the batch of the draw just before them. Opaque draws join
+// any earlier batch with the same key.
+class InstanceBatcher
+{
+public:
+    void clear();
+    void reserve(u32 count);
+
+    void push(const InstanceBatchKey & key,
+              const mat43 & transform,
+              u32 frameOffset,
+              u32 itemIndex,
+              bool keepOrder);
+
+    void finish();
+
+    u32 batchCount() const { return static_cast<u32>(mBatches.size()); }
+    const InstanceBatch & batch(u32 idx) const { return mBatches[idx]; }
+
+    u32 instanceCount() const { return static_cast<u32>(mInstances.size()); }
+    const InstanceData * instances() const { return mInstances.data(); }
+    const InstanceData & instance(u32 idx) const { return mInstances[idx]; }
+
+private:
+    Vector<kMEM_Renderer, InstanceBatch> mBatches;
+    HashMap<kMEM_Renderer, InstanceBatchKey, u32, InstanceBatchKeyHash> mBatchMap;
+
+    // In push order, with the batch each instance belongs to
+    Vector<kMEM_Renderer, InstanceData> mPushed;
+    Vector<kMEM_Renderer, u32> mPushedBatch;
+
+    Vector<kMEM_Renderer, InstanceData> mInstances;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_INSTANCE_BATCH_H
@@ -44,6 +44,7 @@ Model::Model(task_id owner, const Asset * pGmdlAsset, const Asset * pGaimAsset)
   , mpGmdlAsset(pGmdlAsset)
   , mpGaimAsset(pGaimAsset)
   , mDoDelete(false)
+  , mIsCachedShape(false)
 {
     VALIDATE_ASSET(Gmdl, pGmdlAsset);
     AssetMgr::addref_asset(0, mpGmdlAsset);
@@ -67,6 +68,17 @@ Model::Model(task_id owner, const Gmdl* pGmdl, bool doDelete)
   , mpGmdl(pGmdl)
   , mpGaim(nullptr)
   , mDoDelete(doDelete)
+  , mIsCachedShape(false)
+{}
+
+Model::Model(task_id owner, const ShapeKey & shapeKey)
+  : UniqueObject(owner)
+  , mpGmdlAsset(nullptr)
+  , mpGaimAsset(nullptr)
+  , mpGmdl(shape_cache_acquire(shapeKey))
+  , mpGaim(nullptr)
+  , mDoDelete(false)
+  , mIsCachedShape(true)
 {}
 
 Model::Model(const Model& rhs)
@@ -75,7 +87,12 @@ Model::Model(const Model& rhs)
   , mpGaimAsset(rhs.mpGaimAsset)
   , mpGmdl(rhs.mpGmdl)
   , mpGaim(rhs.mpGaim)
-{}
+  , mDoDelete(false)
+  , mIsCachedShape(rhs.mIsCachedShape)
+{
+    if (mIsCachedShape)
+        shape_cache_addref(mpGmdl);
+}
 
 Model::~Model()
 {
@@ -85,6 +102,11 @@ Model::~Model()
        if (mpGaimAsset)
            AssetMgr::release_asset(0, mpGaimAsset);
     }
+    else if (mIsCachedShape)
+    {
+        shape_cache_release(mpGmdl);
+        mpGmdl = nullptr;
+    }
     else if (mDoDelete)
     {
         ASSERT(mpGmdl);
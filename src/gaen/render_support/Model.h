@@ -32,6 +32,7 @@
 #include "gaen/engine/UniqueObject.h"
 #include "gaen/engine/task.h"
 #include "gaen/render_support/render_objects.h"
+#include "gaen/render_support/ShapeCache.h"
 
 class Asset;
 class Gmdl;
@@ -45,6 +46,8 @@ class Model : public UniqueObject
 public:
     Model(task_id owner, const Asset* pGmdlAsset, const Asset* pGaimAsset);
     Model(task_id owner, const Gmdl* pGmdl, bool doDelete);
+    // Procedural shape shared through the shape cache
+    Model(task_id owner, const ShapeKey & shapeKey);
     Model(const Model& rhs);
     ~Model();
 
@@ -69,6 +72,7 @@ private:
     const Gaim * mpGaim;
 
     bool mDoDelete;
+    bool mIsCachedShape;
 };
 
 class ModelBody;
@@ -41,6 +41,7 @@
 #include "gaen/engine/messages/ModelBody.h"
 #include "gaen/engine/messages/ModelInstance.h"
 #include "gaen/engine/messages/NotifyWatcherMat43.h"
+#include "gaen/engine/messages/PhysicsQuery.h"
 #include "gaen/engine/messages/Transform.h"
 #include "gaen/engine/messages/UidScalar.h"
 #include "gaen/engine/messages/UidScalarTransform.h"
@@ -271,6 +272,24 @@ MessageResult ModelMgr::message(const T & msgAcc)
 
         return MessageResult::Consumed;
     }
+    case HASH::physics_raycast:
+    case HASH::physics_sweep_sphere:
+    case HASH::physics_overlap_sphere:
+    {
+        messages::PhysicsQueryR<T> msgr(msgAcc);
+        PhysicsQueryType type = msg.msgId == HASH::physics_raycast ? PhysicsQueryType::Raycast :
+                                msg.msgId == HASH::physics_sweep_sphere ? PhysicsQueryType::Sweep :
+                                PhysicsQueryType::Overlap;
+        mPhysics.queueQuery(type,
+                            msg.source,
+                            msgr.uid(),
+                            msgr.message(),
+                            msgr.radius(),
+                            msgr.start(),
+                            msgr.end(),
+                            msgr.mask03());
+        return MessageResult::Consumed;
+    }
     case HASH::remove_task__:
     {
         task_id taskIdToRemove = msg.payload.u;
@@ -461,6 +480,53 @@ void model_init_body(i32 modelUid,
     send_message(msgw);
 }
 
+static i32 physics_query(u32 msgId,
+                         const vec3 & start,
+                         const vec3 & end,
+                         f32 radius,
+                         i32 message,
+                         const ivec4 & mask03,
+                         Entity * pCaller)
+{
+    u32 uid = UniqueObject::next_uid();
+    messages::PhysicsQueryBW msgw(msgId, kMessageFlag_None, pCaller->task().id(), kModelMgrTaskId, uid);
+    msgw.setMessage(message);
+    msgw.setRadius(radius);
+    msgw.setStart(start);
+    msgw.setEnd(end);
+    msgw.setMask03(mask03);
+    send_message(msgw);
+    return uid;
+}
+
+i32 physics_raycast(const vec3 & start,
+                    const vec3 & end,
+                    i32 message,
+                    const ivec4 & mask03,
+                    Entity * pCaller)
+{
+    return physics_query(HASH::physics_raycast, start, end, 0.0f, message, mask03, pCaller);
+}
+
+i32 physics_sweep_sphere(const vec3 & start,
+                         const vec3 & end,
+                         f32 radius,
+                         i32 message,
+                         const ivec4 & mask03,
+                         Entity * pCaller)
+{
+    return physics_query(HASH::physics_sweep_sphere, start, end, radius, message, mask03, pCaller);
+}
+
+i32 physics_overlap_sphere(const vec3 & center,
+                           f32 radius,
+                           i32 message,
+                           const ivec4 & mask03,
+                           Entity * pCaller)
+{
+    return physics_query(HASH::physics_overlap_sphere, center, center, radius, message, mask03, pCaller);
+}
+
 void model_show(i32 modelUid, Entity * pCaller)
 {
     ImmediateMessageWriter<0> msgw(HASH::model_show, kMessageFlag_None, pCaller->task().id(), kRendererTaskId, to_cell(modelUid));
@@ -99,6 +99,31 @@ void model_remove_body(i32 modelUid, Entity * pCaller);
 void model_set_velocity(i32 modelUid, const vec3 & velocity, Entity * pCaller);
 void model_set_angular_velocity(i32 modelUid, const vec3 & velocity, Entity * pCaller);
 
+// Physics queries, queued and run together once per physics update.
+// Each returns a uid, results come back as PhysicsQueryResult messages
+// with the given message id, one per hit or a single one with a
+// hitCount of 0. Raycasts report voxel hits with a subject of 0.
+// Bodies owned by the caller are ignored, as are groups not in mask03
+// unless it's all 0.
+i32 physics_raycast(const vec3 & start,
+                    const vec3 & end,
+                    i32 message,
+                    const ivec4 & mask03,
+                    Entity * pCaller);
+
+i32 physics_sweep_sphere(const vec3 & start,
+                         const vec3 & end,
+                         f32 radius,
+                         i32 message,
+                         const ivec4 & mask03,
+                         Entity * pCaller);
+
+i32 physics_overlap_sphere(const vec3 & center,
+                           f32 radius,
+                           i32 message,
+                           const ivec4 & mask03,
+                           Entity * pCaller);
+
 void model_stage_show(i32 stageHash, Entity * pCaller);
 void model_stage_hide(i32 stageHash, Entity * pCaller);
 void model_stage_hide_all(Entity * pCaller);
@@ -32,7 +32,7 @@
 #include "gaen/core/gamevars.h"
 
 #include "gaen/engine/messages/PropertyMat43.h"
-#include "gaen/engine/messages/Collision.h"
+#include "gaen/render_support/PhysicsTaskScheduler.h"
 #include "gaen/render_support/ModelPhysics.h"
 
 #define LOG_TRANS_INFO HAS__
@@ -41,6 +41,8 @@ namespace gaen
 {
 
 GAMEVAR_DECL_BOOL(show_collision, false);
+GAMEVAR_REF_FLOAT(physics_rate);
+GAMEVAR_REF_INT(physics_max_steps);
 
 
 void gaen_to_bullet_transform(btTransform & bT, const mat43 & gT)
@@ -71,17 +73,37 @@ void bullet_to_gaen_transform(mat43 & gT, const btTransform & bT)
     gT[3][2] = bT.getOrigin()[2];
 }
 
+ModelMotionState::ModelMotionState(ModelInstance & modelInstance)
+  : mModelInstance(modelInstance)
+  , mIsMarkedForRemoval(false)
+{
+    mModelInstance.mHasBody = true;
+    gaen_to_bullet_transform(mTickTransform, mModelInstance.mTransform);
+    mPrevTickTransform = mTickTransform;
+}
+
 void ModelMotionState::getWorldTransform(btTransform& worldTrans) const
 {
-    gaen_to_bullet_transform(worldTrans, mModelInstance.mTransform);
+    worldTrans = mTickTransform;
 }
 
 void ModelMotionState::setWorldTransform(const btTransform& worldTrans)
 {
     if (!mIsMarkedForRemoval)
     {
+        mTickTransform = worldTrans;
+    }
+}
+
+void ModelMotionState::publish(f32 alpha)
+{
+    if (!mIsMarkedForRemoval)
+    {
+        btTransform interpTrans;
+        interpolate_transform(interpTrans, mPrevTickTransform, mTickTransform, alpha);
+
         mat43 newTrans;
-        bullet_to_gaen_transform(newTrans, worldTrans);
+        bullet_to_gaen_transform(newTrans, interpTrans);
 
         if (newTrans != mModelInstance.mTransform)
         {
@@ -144,11 +166,18 @@ void ModelBody::setVelocity(const vec3 & velocity)
     }
 }
 
+const mat43 ModelBody::transform() const
+{
+    mat43 trans;
+    bullet_to_gaen_transform(trans, mpMotionState->mTickTransform);
+    return trans;
+}
+
 void ModelBody::update(f32 delta)
 {
     if (isKinematic() && mVelocity != vec3(0.0f))
     {
-        mat43 trans = mpMotionState->mModelInstance.mTransform;
+        mat43 trans = transform();
         trans[3] += mVelocity * delta;
         setGaenTransform(trans);
     }
@@ -240,11 +269,11 @@ void PhysicsDebugDraw::render()
             pVerts->color = l.color;
             pVerts++;
         }
-        PrimLine * pPrims = (PrimLine*)pGmdl->prims();
+        // Past 32768 lines the gmdl has 32 bit indices
         for (u32 i = 0; i < mLines.size(); i++)
         {
-            pPrims[i].p0 = i * 2;
-            pPrims[i].p1 = i * 2 + 1;
+            pGmdl->setPrimIndex(i * 2, i * 2);
+            pGmdl->setPrimIndex(i * 2 + 1, i * 2 + 1);
         }
         mLines.clear();
 
@@ -292,16 +321,40 @@ ModelPhysics::ModelPhysics()
     mpBroadphase = GNEW(kMEM_Physics, btDbvtBroadphase);
     mpCollisionConfiguration = GNEW(kMEM_Physics, btDefaultCollisionConfiguration);
 
-    mpDispatcher = GNEW(kMEM_Physics, btCollisionDispatcher, mpCollisionConfiguration);
-    mpDispatcher->setNearCallback(near_callback);
-
-    mpSolver = GNEW(kMEM_Physics, btSequentialImpulseConstraintSolver);
-    mpDynamicsWorld = GNEW(kMEM_Physics,
-                           btDiscreteDynamicsWorld,
-                           mpDispatcher,
-                           mpBroadphase,
-                           mpSolver,
-                           mpCollisionConfiguration);
+    u32 threadCount = physics_thread_count();
+    if (threadCount > 1)
+    {
+        // Collision pairs, islands and integration spread across
+        // PhysicsTaskScheduler's threads.
+        physics_init_task_scheduler(threadCount);
+
+        mpDispatcher = GNEW(kMEM_Physics, btCollisionDispatcherMt, mpCollisionConfiguration);
+        mpDispatcher->setNearCallback(near_callback);
+
+        mpSolverPool = GNEW(kMEM_Physics, btConstraintSolverPoolMt, threadCount);
+        mpSolver = GNEW(kMEM_Physics, btSequentialImpulseConstraintSolverMt);
+        mpDynamicsWorld = GNEW(kMEM_Physics,
+                               btDiscreteDynamicsWorldMt,
+                               mpDispatcher,
+                               mpBroadphase,
+                               mpSolverPool,
+                               mpSolver,
+                               mpCollisionConfiguration);
+    }
+    else
+    {
+        mpDispatcher = GNEW(kMEM_Physics, btCollisionDispatcher, mpCollisionConfiguration);
+        mpDispatcher->setNearCallback(near_callback);
+
+        mpSolverPool = nullptr;
+        mpSolver = GNEW(kMEM_Physics, btSequentialImpulseConstraintSolver);
+        mpDynamicsWorld = GNEW(kMEM_Physics,
+                               btDiscreteDynamicsWorld,
+                               mpDispatcher,
+                               mpBroadphase,
+                               mpSolver,
+                               mpCollisionConfiguration);
+    }
 
     mpDebugDraw = GNEW(kMEM_Physics, PhysicsDebugDraw, mpDynamicsWorld);
 }
@@ -311,6 +364,8 @@ ModelPhysics::~ModelPhysics()
     GDELETE(mpDebugDraw);
     GDELETE(mpDynamicsWorld);
     GDELETE(mpSolver);
+    if (mpSolverPool)
+        GDELETE(mpSolverPool);
     GDELETE(mpDispatcher);
     GDELETE(mpCollisionConfiguration);
     GDELETE(mpBroadphase);
@@ -328,11 +383,55 @@ void ModelPhysics::update(f32 delta)
 {
     mIsUpdating = true;
 
-    updateKinematics(delta);
+    mClock.setRate(physics_rate, physics_max_steps);
+    u32 steps = mClock.advance(delta);
+    for (u32 i = 0; i < steps; ++i)
+    {
+        tick(mClock.step());
+    }
+
+    f32 alpha = mClock.alpha();
+    for (auto & bodyPair : mBodies)
+    {
+        if (bodyPair.second->motionState())
+            bodyPair.second->motionState()->publish(alpha);
+    }
+
+    mIsUpdating = false;
+
+    for (u32 uid : mBodiesToRemove)
+    {
+        removeRigidBody(uid);
+    }
+    mBodiesToRemove.clear();
+
+    mCollisionMessages.flush(kModelMgrTaskId);
 
-    mpDynamicsWorld->stepSimulation(delta, 0);
+    mQueries.run(mpDynamicsWorld);
+    mQueries.send(kModelMgrTaskId);
 
-    // Check for collisions
+    mpDebugDraw->update();
+}
+
+void ModelPhysics::tick(f32 step)
+{
+    for (auto & bodyPair : mBodies)
+    {
+        if (bodyPair.second->motionState())
+            bodyPair.second->motionState()->beginTick();
+    }
+
+    updateKinematics(step);
+
+    // Variable step mode with a constant step, the clock has already
+    // done the accumulating so Bullet should take exactly one step.
+    mpDynamicsWorld->stepSimulation(step, 0);
+
+    processCollisions();
+}
+
+void ModelPhysics::processCollisions()
+{
     int numManifolds = mpDynamicsWorld->getDispatcher()->getNumManifolds();
     for (int i = 0; i < numManifolds; ++i)
     {
@@ -374,37 +473,34 @@ void ModelPhysics::update(f32 delta)
                 obA->handleCollision(dist, norm, locA, locB);
                 obB->handleCollision(dist, norm, locB, locA);
 
-                // Send collision messages to both entities
-                if (obA->message() != 0)
-                {
-                    messages::CollisionBW msgw(HASH::collision, kMessageFlag_None, kModelMgrTaskId, obA->owner(), obB->groupHash());
-                    msgw.setSubject(obB->owner());
-                    msgw.setDistance(dist);
-                    msgw.setLocationSelf(locA);
-                    msgw.setLocationOther(locB);
-                    send_message(msgw);
-                }
-                if (obB->message() != 0)
-                {
-                    messages::CollisionBW msgw(HASH::collision, kMessageFlag_None, kModelMgrTaskId, obB->owner(), obA->groupHash());
-                    msgw.setSubject(obA->owner());
-                    msgw.setDistance(dist);
-                    msgw.setLocationSelf(locB);
-                    msgw.setLocationOther(locA);
-                    send_message(msgw);
-                }
+                // Send collision messages to both entities when the
+                // contact begins, and every tick after if they asked.
+                ContactInfo info;
+                info.distance = dist;
+                info.locA = locA;
+                info.locB = locB;
+                bool isBegin = mContacts.touch(obA, obB, info) == ContactPhase::Begin;
+
+                if (obA->message() != 0 && (isBegin || obA->persistContacts()))
+                    mCollisionMessages.queue(HASH::collision, obA->owner(), obB->groupHash(), obB->owner(), info, true);
+                if (obB->message() != 0 && (isBegin || obB->persistContacts()))
+                    mCollisionMessages.queue(HASH::collision, obB->owner(), obA->groupHash(), obA->owner(), info, false);
             }
         }
     }
-    mIsUpdating = false;
 
-    for (u32 uid : mBodiesToRemove)
+    mContacts.endTick([this](const ModelBody * obA, const ModelBody * obB, const ContactInfo & info)
     {
-        removeRigidBody(uid);
-    }
-    mBodiesToRemove.clear();
+        queueCollisionEnd(obA, obB, info);
+    });
+}
 
-    mpDebugDraw->update();
+void ModelPhysics::queueCollisionEnd(const ModelBody * obA, const ModelBody * obB, const ContactInfo & info)
+{
+    if (obA->message() != 0 && !obA->isMarkedForRemoval())
+        mCollisionMessages.queue(HASH::collision_end, obA->owner(), obB->groupHash(), obB->owner(), info, true);
+    if (obB->message() != 0 && !obB->isMarkedForRemoval())
+        mCollisionMessages.queue(HASH::collision_end, obB->owner(), obA->groupHash(), obA->owner(), info, false);
 }
 
 static btCompoundShape * newOffsetBox(const vec3 & halfExtents, const vec3 & center)
@@ -545,6 +641,12 @@ void ModelPhysics::removeRigidBody(u32 uid)
     {
         if (!mIsUpdating)
         {
+            it->second->markForRemoval();
+            mContacts.removeBody(it->second.get(), [this](const ModelBody * obA, const ModelBody * obB, const ContactInfo & info)
+            {
+                queueCollisionEnd(obA, obB, info);
+            });
+
             mpDynamicsWorld->removeRigidBody(it->second.get());
             mBodies.erase(it);
         }
@@ -627,6 +729,8 @@ void ModelPhysics::setTransform(u32 uid, const mat43 & transform)
     if (it != mBodies.end())
     {
         it->second->setGaenTransform(transform);
+        if (it->second->motionState())
+            it->second->motionState()->snap();
     }
     else
     {
@@ -661,6 +765,32 @@ void ModelPhysics::setAngularVelocity(u32 uid, const vec3 & velocity)
     }
 }
 
+void ModelPhysics::queueQuery(PhysicsQueryType type,
+                              task_id requester,
+                              u32 uid,
+                              u32 message,
+                              f32 radius,
+                              const vec3 & start,
+                              const vec3 & end,
+                              const ivec4 & mask03)
+{
+    PhysicsQuery query;
+    query.type = type;
+    query.requester = requester;
+    query.uid = uid;
+    query.message = message;
+    query.mask = buildMask(mask03, ivec4(0));
+    query.radius = radius;
+    query.start = start;
+    query.end = end;
+    mQueries.queue(query);
+}
+
+void ModelPhysics::setQueryVoxelWorld(const VoxelWorld * pVoxelWorld, u32 maxDepth)
+{
+    mQueries.setVoxelWorld(pVoxelWorld, maxDepth);
+}
+
 u16 ModelPhysics::buildMask(const ivec4 & mask03, const ivec4 & mask47)
 {
     u16 mask = 0;
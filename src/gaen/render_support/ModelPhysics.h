@@ -37,6 +37,9 @@
 #include "gaen/core/HashSet.h"
 #include "gaen/math/vec3.h"
 #include "gaen/render_support/physics.h"
+#include "gaen/render_support/ContactTracker.h"
+#include "gaen/render_support/PhysicsClock.h"
+#include "gaen/render_support/PhysicsQuery.h"
 #include "gaen/render_support/collision.h"
 #include "gaen/render_support/Model.h"
 
@@ -45,6 +48,7 @@ class btBroadphaseInterface;
 class btDefaultCollisionConfiguration;
 class btCollisionDispatcher;
 class btSequentialImpulseConstraintSolver;
+class btConstraintSolverPoolMt;
 class btDiscreteDynamicsWorld;
 struct btDispatcherInfo;
 
@@ -56,23 +60,32 @@ class ModelMotionState : public btMotionState
     friend class ModelPhysics;
     friend class ModelBody;
 public:
-    ModelMotionState(ModelInstance & modelInstance)
-      : mModelInstance(modelInstance)
-      , mIsMarkedForRemoval(false)
-    {
-        mModelInstance.mHasBody = true;
-    }
+    ModelMotionState(ModelInstance & modelInstance);
 
     void markForRemoval()
     {
         mIsMarkedForRemoval = true;
     }
 
+    // Bullet reads and writes the transform as of the latest fixed
+    // tick. Consumers only see it once publish blends it in.
     virtual void getWorldTransform(btTransform& worldTrans) const;
     virtual void setWorldTransform(const btTransform& worldTrans);
 
+    void beginTick() { mPrevTickTransform = mTickTransform; }
+
+    // Discard the previous tick so a teleport doesn't smear across
+    // the interpolation window.
+    void snap() { mPrevTickTransform = mTickTransform; }
+
+    // Push the transform interpolated between the last two ticks to
+    // the ModelInstance and the owning entity.
+    void publish(f32 alpha);
+
 private:
     ModelInstance & mModelInstance;
+    btTransform mPrevTickTransform;
+    btTransform mTickTransform;
     bool mIsMarkedForRemoval;
 };
 typedef UniquePtr<ModelMotionState> ModelMotionStateUP;
@@ -100,7 +113,10 @@ public:
       , mGroupHash(groupHash)
       , mpMotionState(pMotionState)
       , mIsMarkedForRemoval(false)
-    {}
+    {
+        // PhysicsQueryBatch reports hits by owner
+        setUserIndex(owner);
+    }
 
     task_id owner() const { return mOwner; }
     const vec3 & center() const { return mCenter; }
@@ -111,6 +127,7 @@ public:
     bool isKinematic() const { return (mFlags & system_api::PHY_FLAG_KINEMATIC); }
     bool stopOnCollide() const { return (mFlags & system_api::PHY_FLAG_KINEMATIC) && (mFlags & system_api::PHY_FLAG_STOP_ON_COLLIDE); }
     bool slideOnCollide() const { return (mFlags & system_api::PHY_FLAG_KINEMATIC) && !(mFlags & system_api::PHY_FLAG_STOP_ON_COLLIDE) ; }
+    bool persistContacts() const { return (mFlags & system_api::PHY_FLAG_CONTACT_PERSIST); }
     u32 message() const { return mMessage; }
     u32 groupHash() const { return mGroupHash; }
 
@@ -118,7 +135,8 @@ public:
     void update(f32 delta);
     void setGaenTransform(const mat43 & transform);
 
-    const mat43 transform() const { return mpMotionState->mModelInstance.mTransform; }
+    const mat43 transform() const;
+    ModelMotionState * motionState() { return mpMotionState.get(); }
 
     bool isMarkedForRemoval() const { return mIsMarkedForRemoval; }
 
@@ -192,9 +210,13 @@ public:
     ModelPhysics();
     ~ModelPhysics();
 
+    // Runs as many fixed steps as delta allows, then publishes
+    // transforms interpolated to the remaining fraction of a step.
     void update(f32 delta);
     void updateKinematics(f32 delta);
 
+    const PhysicsClock & clock() const { return mClock; }
+
     btCompoundShape * findBox(const vec3 & halfExtents, const vec3 & center);
     btCompoundShape * findCapsule(f32 radius, f32 height, const vec3 & center);
     btCollisionShape * findConvexHull(const Gmdl * pGmdlPoints);
@@ -246,7 +268,24 @@ public:
     void setTransform(u32 uid, const mat43 & transform);
     void setVelocity(u32 uid, const vec3 & velocity);
     void setAngularVelocity(u32 uid, const vec3 & velocity);
+
+    // Queued queries run together at the end of each update
+    void queueQuery(PhysicsQueryType type,
+                    task_id requester,
+                    u32 uid,
+                    u32 message,
+                    f32 radius,
+                    const vec3 & start,
+                    const vec3 & end,
+                    const ivec4 & mask03);
+
+    // Raycast queries also test this voxel world, if set
+    void setQueryVoxelWorld(const VoxelWorld * pVoxelWorld, u32 maxDepth);
 private:
+    void tick(f32 step);
+    void processCollisions();
+    void queueCollisionEnd(const ModelBody * obA, const ModelBody * obB, const ContactInfo & info);
+
     u16 buildMask(const ivec4 & mask03, const ivec4 & mask47);
     u16 maskFromHash(u32 hash);
 
@@ -255,11 +294,13 @@ private:
                               const btDispatcherInfo & dispatchInfo);
 
     bool mIsUpdating;
+    PhysicsClock mClock;
 
     btBroadphaseInterface * mpBroadphase;
     btDefaultCollisionConfiguration * mpCollisionConfiguration;
     btCollisionDispatcher * mpDispatcher;
     btSequentialImpulseConstraintSolver * mpSolver;
+    btConstraintSolverPoolMt * mpSolverPool; // only for multithreaded worlds
     btDiscreteDynamicsWorld * mpDynamicsWorld;
     PhysicsDebugDraw * mpDebugDraw;
 
@@ -269,6 +310,10 @@ private:
     HashMap<kMEM_Physics, const Gmdl *, btCollisionShapeUP> mConvexHulls;
     HashMap<kMEM_Physics, u32, u16> mMaskBits;
     HashSet<kMEM_Physics, u32> mBodiesToRemove;
+
+    ContactTracker<ModelBody> mContacts;
+    CollisionMessageBatch mCollisionMessages;
+    PhysicsQueryBatch mQueries;
 };
 
 } // namespace gaen
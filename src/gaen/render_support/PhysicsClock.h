@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------
+// PhysicsClock.h - Fixed rate physics ticks decoupled from the render frame
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_PHYSICS_CLOCK_H
+#define GAEN_RENDER_SUPPORT_PHYSICS_CLOCK_H
+
+#include <cmath>
+
+#include <LinearMath/btTransform.h>
+
+#include "gaen/core/base_defines.h"
+#include "gaen/core/logging.h"
+
+namespace gaen
+{
+
+// Accumulates frame time and hands out whole, fixed length physics
+// steps. Simulation results only depend on the number of steps taken,
+// never on frame time, so cost per second is constant and a replay of
+// the same inputs produces the same world.
+//
+// When a frame spike leaves more than maxSteps of backlog, the extra
+// whole steps are dropped rather than simulated. Physics runs slow for
+// that frame instead of spiraling into ever longer catch-up frames.
+class PhysicsClock
+{
+public:
+    static constexpr f32 kDefaultRate = 60.0f;
+    static constexpr f32 kMinRate = 1.0f;
+    static const i32 kDefaultMaxSteps = 4;
+
+    PhysicsClock(f32 rate = kDefaultRate, i32 maxSteps = kDefaultMaxSteps)
+    {
+        setRate(rate, maxSteps);
+    }
+
+    // Called every frame with the physics_rate and physics_max_steps
+    // gamevars, which can be set to anything. rate is clamped to at
+    // least kMinRate and maxSteps to at least 1, with a warning each
+    // time a new out of range value is seen.
+    void setRate(f32 rate, i32 maxSteps)
+    {
+        bool sameRate = rate == mRequestedRate || (std::isnan(rate) && std::isnan(mRequestedRate));
+        if (sameRate && maxSteps == mRequestedMaxSteps)
+            return;
+        mRequestedRate = rate;
+        mRequestedMaxSteps = maxSteps;
+
+        if (!(rate >= kMinRate)) // NaN too
+        {
+            LOG_WARNING("PhysicsClock rate %f out of range, clamped to %f", rate, kMinRate);
+            rate = kMinRate;
+        }
+        if (maxSteps < 1)
+        {
+            LOG_WARNING("PhysicsClock maxSteps %d out of range, clamped to 1", maxSteps);
+            maxSteps = 1;
+        }
+
+        mStep = 1.0 / rate;
+        mMaxSteps = static_cast<u32>(maxSteps);
+    }
+
+    // Returns how many fixed steps to run for this frame
+    u32 advance(f32 delta)
+    {
+        if (delta > 0.0f)
+            mAccumulator += delta;
+
+        u32 steps = 0;
+        while (mAccumulator >= mStep && steps < mMaxSteps)
+        {
+            mAccumulator -= mStep;
+            steps++;
+        }
+
+        if (mAccumulator >= mStep)
+        {
+            mDroppedSteps += static_cast<u64>(mAccumulator / mStep);
+            mAccumulator = fmod(mAccumulator, mStep);
+        }
+
+        mTickCount += steps;
+        return steps;
+    }
+
+    f32 step() const { return static_cast<f32>(mStep); }
+    u32 maxSteps() const { return mMaxSteps; }
+
+    // How far between the last two ticks the render frame sits, in
+    // [0, 1). Blend the previous tick's transforms toward the current
+    // tick's by this much.
+    f32 alpha() const { return static_cast<f32>(mAccumulator / mStep); }
+
+    u64 tickCount() const { return mTickCount; }
+    u64 droppedSteps() const { return mDroppedSteps; }
+
+private:
+    f64 mStep = 1.0 / kDefaultRate;
+    f64 mAccumulator = 0.0;
+    u32 mMaxSteps = kDefaultMaxSteps;
+    u64 mTickCount = 0;
+    u64 mDroppedSteps = 0;
+
+    // Last values passed to setRate, before clamping
+    f32 mRequestedRate = kDefaultRate;
+    i32 mRequestedMaxSteps = kDefaultMaxSteps;
+};
+
+inline void interpolate_transform(btTransform & result, const btTransform & from, const btTransform & to, f32 alpha)
+{
+    result.setOrigin(from.getOrigin().lerp(to.getOrigin(), alpha));
+    result.setRotation(from.getRotation().slerp(to.getRotation(), alpha));
+}
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_PHYSICS_CLOCK_H
@@ -0,0 +1,341 @@
+//------------------------------------------------------------------------------
+// PhysicsQuery.cpp - Batched raycast, sweep and overlap queries
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include <BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h>
+
+#include "gaen/core/parallel_for.h"
+
+#include "gaen/engine/messages/PhysicsQueryResult.h"
+
+#include "gaen/render_support/voxel.h"
+#include "gaen/render_support/PhysicsQuery.h"
+
+namespace gaen
+{
+
+static const u32 kQueryGrainSize = 32;
+
+// Only the query's mask is tested against each body's group, bodies
+// don't have to list queries in their own masks.
+static bool query_needs_collision(const PhysicsQuery & query, const btBroadphaseProxy * pProxy)
+{
+    if (!(pProxy->m_collisionFilterGroup & query.mask))
+        return false;
+    const btCollisionObject * pObj = static_cast<const btCollisionObject*>(pProxy->m_clientObject);
+    return pObj->getUserIndex() != query.requester;
+}
+
+inline vec3 to_vec3(const btVector3 & v)
+{
+    return vec3(v.x(), v.y(), v.z());
+}
+
+struct QueryRayCallback : public btCollisionWorld::ClosestRayResultCallback
+{
+    QueryRayCallback(const PhysicsQuery & query, const btVector3 & from, const btVector3 & to)
+      : btCollisionWorld::ClosestRayResultCallback(from, to)
+      , mQuery(query)
+    {}
+
+    bool needsCollision(btBroadphaseProxy * pProxy) const override
+    {
+        return query_needs_collision(mQuery, pProxy);
+    }
+
+    const PhysicsQuery & mQuery;
+};
+
+struct QuerySweepCallback : public btCollisionWorld::ClosestConvexResultCallback
+{
+    QuerySweepCallback(const PhysicsQuery & query, const btVector3 & from, const btVector3 & to)
+      : btCollisionWorld::ClosestConvexResultCallback(from, to)
+      , mQuery(query)
+    {}
+
+    bool needsCollision(btBroadphaseProxy * pProxy) const override
+    {
+        return query_needs_collision(mQuery, pProxy);
+    }
+
+    const PhysicsQuery & mQuery;
+};
+
+// Collects one hit per overlapping object
+struct QueryOverlapCallback : public btCollisionWorld::ContactResultCallback
+{
+    QueryOverlapCallback(const PhysicsQuery & query,
+                         const btCollisionObject * pSelf,
+                         Vector<kMEM_Physics, PhysicsQueryHit> & hits,
+                         Vector<kMEM_Physics, const btCollisionObject*> & objects)
+      : mQuery(query)
+      , mpSelf(pSelf)
+      , mHits(hits)
+      , mObjects(objects)
+    {
+        mObjects.clear();
+    }
+
+    bool needsCollision(btBroadphaseProxy * pProxy) const override
+    {
+        return query_needs_collision(mQuery, pProxy);
+    }
+
+    btScalar addSingleResult(btManifoldPoint & cp,
+                             const btCollisionObjectWrapper * pWrap0,
+                             int partId0,
+                             int index0,
+                             const btCollisionObjectWrapper * pWrap1,
+                             int partId1,
+                             int index1) override
+    {
+        bool otherIsA = pWrap0->getCollisionObject() != mpSelf;
+        const btCollisionObject * pOther = otherIsA ? pWrap0->getCollisionObject() : pWrap1->getCollisionObject();
+
+        if (std::find(mObjects.begin(), mObjects.end(), pOther) != mObjects.end())
+            return 0;
+        mObjects.push_back(pOther);
+
+        // normal on the other object, pointing toward the query sphere
+        PhysicsQueryHit & hit = mHits.emplace_back();
+        hit.subject = pOther->getUserIndex();
+        hit.fraction = 0.0f;
+        hit.location = to_vec3(otherIsA ? cp.getPositionWorldOnA() : cp.getPositionWorldOnB());
+        hit.normal = to_vec3(otherIsA ? -cp.m_normalWorldOnB : cp.m_normalWorldOnB);
+        return 0;
+    }
+
+    const PhysicsQuery & mQuery;
+    const btCollisionObject * mpSelf;
+    Vector<kMEM_Physics, PhysicsQueryHit> & mHits;
+    Vector<kMEM_Physics, const btCollisionObject*> & mObjects;
+};
+
+// Raycasts and sweeps, each writes only its own result and hit slot.
+// One job per kQueryGrainSize queries.
+struct QueryCastContext
+{
+    const btCollisionWorld * pWorld;
+    const PhysicsQuery * pQueries;
+    PhysicsQueryResult * pResults;
+    PhysicsQueryHit * pHits;
+    u32 count;
+
+    static void cast(const void * pContext, u32 jobIdx)
+    {
+        const QueryCastContext & ctx = *static_cast<const QueryCastContext*>(pContext);
+        u32 iBegin = jobIdx * kQueryGrainSize;
+        u32 iEnd = iBegin + kQueryGrainSize < ctx.count ? iBegin + kQueryGrainSize : ctx.count;
+        for (u32 i = iBegin; i < iEnd; ++i)
+        {
+            const PhysicsQuery & query = ctx.pQueries[i];
+            if (query.type == PhysicsQueryType::Overlap)
+                continue;
+
+            PhysicsQueryResult & result = ctx.pResults[i];
+            PhysicsQueryHit & hit = ctx.pHits[result.firstHit];
+
+            btVector3 from(query.start.x, query.start.y, query.start.z);
+            btVector3 to(query.end.x, query.end.y, query.end.z);
+
+            if (query.type == PhysicsQueryType::Sweep && query.radius > 0.0f)
+            {
+                QuerySweepCallback cb(query, from, to);
+                btSphereShape sphere(query.radius);
+                btTransform fromTrans(btQuaternion::getIdentity(), from);
+                btTransform toTrans(btQuaternion::getIdentity(), to);
+                ctx.pWorld->convexSweepTest(&sphere, fromTrans, toTrans, cb);
+                if (cb.hasHit())
+                {
+                    result.hitCount = 1;
+                    hit.subject = cb.m_hitCollisionObject->getUserIndex();
+                    hit.fraction = cb.m_closestHitFraction;
+                    hit.location = to_vec3(cb.m_hitPointWorld);
+                    hit.normal = to_vec3(cb.m_hitNormalWorld);
+                }
+            }
+            else
+            {
+                QueryRayCallback cb(query, from, to);
+                ctx.pWorld->rayTest(from, to, cb);
+                if (cb.hasHit())
+                {
+                    result.hitCount = 1;
+                    hit.subject = cb.m_collisionObject->getUserIndex();
+                    hit.fraction = cb.m_closestHitFraction;
+                    hit.location = to_vec3(cb.m_hitPointWorld);
+                    hit.normal = to_vec3(cb.m_hitNormalWorld);
+                }
+            }
+        }
+    }
+};
+
+void PhysicsQueryBatch::queue(const PhysicsQuery & query)
+{
+    mQueries.push_back(query);
+    if (mQueries.back().mask == 0)
+        mQueries.back().mask = 0xffff;
+}
+
+void PhysicsQueryBatch::run(btCollisionWorld * pWorld)
+{
+    u32 count = queryCount();
+    if (count == 0)
+        return;
+
+    // Raycasts and sweeps get one hit slot each, up front, so they can
+    // be filled in from any thread. Overlap hits are appended after.
+    mResults.assign(count, PhysicsQueryResult());
+    mHits.clear();
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (mQueries[i].type != PhysicsQueryType::Overlap)
+        {
+            mResults[i].firstHit = static_cast<u32>(mHits.size());
+            mHits.emplace_back();
+        }
+    }
+
+    if (mHits.size() > 0)
+    {
+        QueryCastContext ctx{pWorld, mQueries.data(), mResults.data(), mHits.data(), count};
+        u32 jobCount = (count + kQueryGrainSize - 1) / kQueryGrainSize;
+        parallel_for(jobCount, 0, &QueryCastContext::cast, &ctx);
+    }
+
+    if (mpVoxelWorld)
+        runVoxelRays();
+
+    Vector<kMEM_Physics, const btCollisionObject*> objects;
+    for (u32 i = 0; i < count; ++i)
+    {
+        const PhysicsQuery & query = mQueries[i];
+        if (query.type != PhysicsQueryType::Overlap)
+            continue;
+
+        btSphereShape sphere(query.radius);
+        btCollisionObject sphereObj;
+        sphereObj.setCollisionShape(&sphere);
+        sphereObj.setWorldTransform(btTransform(btQuaternion::getIdentity(), btVector3(query.start.x, query.start.y, query.start.z)));
+
+        mResults[i].firstHit = static_cast<u32>(mHits.size());
+        QueryOverlapCallback cb(query, &sphereObj, mHits, objects);
+        pWorld->contactTest(&sphereObj, cb);
+        mResults[i].hitCount = static_cast<u32>(mHits.size()) - mResults[i].firstHit;
+    }
+}
+
+void PhysicsQueryBatch::runVoxelRays()
+{
+    Vector<kMEM_Physics, u32> rayQueries;
+    Vector<kMEM_Physics, vec3> rayPos;
+    Vector<kMEM_Physics, vec3> rayDir;
+    Vector<kMEM_Physics, f32> rayLen;
+    for (u32 i = 0; i < queryCount(); ++i)
+    {
+        const PhysicsQuery & query = mQueries[i];
+        f32 len = length(query.end - query.start);
+        if (query.type == PhysicsQueryType::Raycast && len > 0.0f)
+        {
+            rayQueries.push_back(i);
+            rayPos.push_back(query.start);
+            rayDir.push_back((query.end - query.start) / len);
+            rayLen.push_back(len);
+        }
+    }
+
+    if (rayQueries.empty())
+        return;
+
+    Vector<kMEM_Physics, VoxelRayHit> voxelHits(rayQueries.size());
+    u32 rayCount = static_cast<u32>(rayQueries.size());
+    for (u32 r = 0; r < mpVoxelWorld->voxelRootCount(); ++r)
+    {
+        const VoxelRoot & root = mpVoxelWorld->voxelRoot(r);
+        if (test_rays_voxel(voxelHits.data(), *mpVoxelWorld, rayPos.data(), rayDir.data(), rayCount, root, mVoxelMaxDepth) == 0)
+            continue;
+
+        for (u32 i = 0; i < rayCount; ++i)
+        {
+            const VoxelRayHit & voxelHit = voxelHits[i];
+            if (!voxelHit.hit)
+                continue;
+
+            f32 fraction = max(voxelHit.zDepth, 0.0f) / rayLen[i];
+            PhysicsQueryResult & result = mResults[rayQueries[i]];
+            PhysicsQueryHit & hit = mHits[result.firstHit];
+            if (fraction > 1.0f || (result.hitCount > 0 && hit.fraction <= fraction))
+                continue;
+
+            result.hitCount = 1;
+            hit.subject = 0;
+            hit.fraction = fraction;
+            hit.location = rayPos[i] + rayDir[i] * (fraction * rayLen[i]);
+            hit.normal = root.rot * voxelHit.normal;
+        }
+    }
+}
+
+u32 PhysicsQueryBatch::send(task_id source)
+{
+    u32 sent = 0;
+    for (u32 i = 0; i < mResults.size(); ++i)
+    {
+        const PhysicsQuery & query = mQueries[i];
+        const PhysicsQueryResult & result = mResults[i];
+
+        PhysicsQueryHit miss;
+        miss.location = query.end;
+        u32 msgCount = result.hitCount > 0 ? result.hitCount : 1;
+        for (u32 h = 0; h < msgCount; ++h)
+        {
+            const PhysicsQueryHit & hit = result.hitCount > 0 ? mHits[result.firstHit + h] : miss;
+
+            messages::PhysicsQueryResultBW msgw(query.message, kMessageFlag_None, source, query.requester, query.uid);
+            msgw.setSubject(hit.subject);
+            msgw.setHitCount(result.hitCount);
+            msgw.setFraction(hit.fraction);
+            msgw.setLocation(hit.location);
+            msgw.setNormal(hit.normal);
+            send_message(msgw);
+            sent++;
+        }
+    }
+
+    clear();
+    return sent;
+}
+
+void PhysicsQueryBatch::clear()
+{
+    mQueries.clear();
+    mResults.clear();
+    mHits.clear();
+}
+
+} // namespace gaen
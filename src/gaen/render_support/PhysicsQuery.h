@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+// PhysicsQuery.h - Batched raycast, sweep and overlap queries
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_PHYSICS_QUERY_H
+#define GAEN_RENDER_SUPPORT_PHYSICS_QUERY_H
+
+#include "gaen/core/Vector.h"
+#include "gaen/math/vec3.h"
+#include "gaen/engine/Message.h"
+
+class btCollisionWorld;
+
+namespace gaen
+{
+
+class VoxelWorld;
+
+enum class PhysicsQueryType : u8
+{
+    Raycast,
+    Sweep,    // sphere of radius swept from start to end
+    Overlap   // sphere of radius at start
+};
+
+struct PhysicsQuery
+{
+    PhysicsQueryType type;
+    task_id requester; // bodies owned by the requester are ignored
+    u32 uid;
+    u32 message;       // results are sent back with this message id
+    u16 mask;          // collision groups to test against
+    f32 radius;
+    vec3 start;
+    vec3 end;
+};
+
+struct PhysicsQueryHit
+{
+    task_id subject = 0; // 0 for voxel hits
+    f32 fraction = 1.0f; // along start to end, 0 for overlaps
+    vec3 location{0.0f};
+    vec3 normal{0.0f};
+};
+
+struct PhysicsQueryResult
+{
+    u32 hitCount = 0;
+    u32 firstHit = 0;    // index into PhysicsQueryBatch::hits
+};
+
+// Queries queued from any TaskMaster and run together once per physics
+// update, so a few hundred line of sight checks cost one pass over the
+// world instead of a few hundred message round trips.
+//
+// Raycasts and sweeps only read the collision world and run through
+// parallel_for on the core worker pool. Overlaps go through the
+// dispatcher, which allocates collision algorithms, so they run
+// serially. Raycasts also test the voxel world if one is set, and
+// report whichever hit is nearer.
+//
+// Collision objects must carry their owning task_id as user index.
+class PhysicsQueryBatch
+{
+public:
+    void queue(const PhysicsQuery & query);
+
+    void setVoxelWorld(const VoxelWorld * pVoxelWorld, u32 maxDepth)
+    {
+        mpVoxelWorld = pVoxelWorld;
+        mVoxelMaxDepth = maxDepth;
+    }
+
+    void run(btCollisionWorld * pWorld);
+
+    // Sends one message per hit to each requester, or a single message
+    // with a hitCount of 0 for queries that hit nothing, then clears.
+    // Returns the number of messages sent.
+    u32 send(task_id source);
+
+    void clear();
+
+    u32 queryCount() const { return static_cast<u32>(mQueries.size()); }
+    const PhysicsQuery & query(u32 idx) const { return mQueries[idx]; }
+    const PhysicsQueryResult & result(u32 idx) const { return mResults[idx]; }
+    const PhysicsQueryHit & hit(u32 idx) const { return mHits[idx]; }
+
+private:
+    void runVoxelRays();
+
+    Vector<kMEM_Physics, PhysicsQuery> mQueries;
+    Vector<kMEM_Physics, PhysicsQueryResult> mResults;
+    Vector<kMEM_Physics, PhysicsQueryHit> mHits;
+
+    const VoxelWorld * mpVoxelWorld = nullptr;
+    u32 mVoxelMaxDepth = 0;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_PHYSICS_QUERY_H
@@ -0,0 +1,132 @@
+//------------------------------------------------------------------------------
+// PhysicsTaskScheduler.cpp - Bullet task scheduler running on Gaen worker threads
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include "gaen/core/gamevars.h"
+#include "gaen/core/Vector.h"
+
+#include "gaen/render_support/PhysicsTaskScheduler.h"
+
+namespace gaen
+{
+
+// Threads for Bullet's multithreaded world. These are in addition to
+// the TaskMaster threads, so leave it at 0 unless physics is on its
+// own TaskMaster and there are cores to spare.
+GAMEVAR_DECL_INT(physics_threads, 0);
+
+PhysicsTaskScheduler::PhysicsTaskScheduler(u32 threadCount)
+  : btITaskScheduler("Gaen")
+  , mThreadCount(0)
+{
+    setNumThreads(threadCount);
+}
+
+int PhysicsTaskScheduler::getMaxNumThreads() const
+{
+    return BT_MAX_THREAD_COUNT;
+}
+
+int PhysicsTaskScheduler::getNumThreads() const
+{
+    return static_cast<int>(mThreadCount);
+}
+
+void PhysicsTaskScheduler::setNumThreads(int numThreads)
+{
+    mThreadCount = static_cast<u32>(btMax(1, btMin(numThreads, getMaxNumThreads())));
+}
+
+void PhysicsTaskScheduler::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody & body)
+{
+    if (iEnd <= iBegin)
+        return;
+
+    grainSize = btMax(1, grainSize);
+    u32 jobCount = static_cast<u32>((iEnd - iBegin + grainSize - 1) / grainSize);
+
+    if (jobCount == 1 || mThreadCount == 1)
+    {
+        body.forLoop(iBegin, iEnd);
+        return;
+    }
+
+    parallel_for(jobCount, mThreadCount, [&](u32 jobIdx)
+    {
+        int begin = iBegin + static_cast<int>(jobIdx) * grainSize;
+        int end = btMin(begin + grainSize, iEnd);
+        body.forLoop(begin, end);
+    });
+}
+
+btScalar PhysicsTaskScheduler::parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody & body)
+{
+    if (iEnd <= iBegin)
+        return btScalar(0);
+
+    grainSize = btMax(1, grainSize);
+    u32 jobCount = static_cast<u32>((iEnd - iBegin + grainSize - 1) / grainSize);
+
+    if (jobCount == 1 || mThreadCount == 1)
+        return body.sumLoop(iBegin, iEnd);
+
+    // Sum per job then add serially so the result doesn't depend on
+    // which thread finished first.
+    Vector<kMEM_Physics, btScalar> sums(jobCount);
+    parallel_for(jobCount, mThreadCount, [&](u32 jobIdx)
+    {
+        int begin = iBegin + static_cast<int>(jobIdx) * grainSize;
+        int end = btMin(begin + grainSize, iEnd);
+        sums[jobIdx] = body.sumLoop(begin, end);
+    });
+
+    btScalar sum = btScalar(0);
+    for (btScalar jobSum : sums)
+        sum += jobSum;
+    return sum;
+}
+
+u32 physics_thread_count()
+{
+    return physics_threads > 1 ? static_cast<u32>(physics_threads) : 1;
+}
+
+void physics_init_task_scheduler(u32 threadCount)
+{
+    static PhysicsTaskScheduler * spScheduler = nullptr;
+    if (!spScheduler)
+    {
+        spScheduler = GNEW(kMEM_Physics, PhysicsTaskScheduler, threadCount);
+        btSetTaskScheduler(spScheduler);
+    }
+    else
+    {
+        spScheduler->setNumThreads(static_cast<int>(threadCount));
+    }
+}
+
+} // namespace gaen
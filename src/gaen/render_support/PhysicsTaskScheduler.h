@@ -0,0 +1,69 @@
+//------------------------------------------------------------------------------
+// PhysicsTaskScheduler.h - Bullet task scheduler running on Gaen worker threads
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_PHYSICS_TASK_SCHEDULER_H
+#define GAEN_RENDER_SUPPORT_PHYSICS_TASK_SCHEDULER_H
+
+#include <LinearMath/btThreads.h>
+
+#include "gaen/core/base_defines.h"
+#include "gaen/core/parallel_for.h"
+
+namespace gaen
+{
+
+// Runs Bullet's parallelFor/parallelSum with parallel_for, one job per
+// grain, so the multithreaded dynamics world uses our threads rather
+// than OpenMP, TBB or Bullet's own. Nested calls from inside a job run
+// serially on the calling thread.
+class PhysicsTaskScheduler : public btITaskScheduler
+{
+public:
+    PhysicsTaskScheduler(u32 threadCount);
+
+    int getMaxNumThreads() const override;
+    int getNumThreads() const override;
+    void setNumThreads(int numThreads) override;
+
+    void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody & body) override;
+    btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody & body) override;
+
+private:
+    u32 mThreadCount;
+};
+
+// Number of threads the dynamics worlds should use, from the
+// physics_threads gamevar. 1 or less means the classic single
+// threaded world.
+u32 physics_thread_count();
+
+// Installs a process wide PhysicsTaskScheduler the first time it's
+// called. Must be called before creating a btDiscreteDynamicsWorldMt.
+void physics_init_task_scheduler(u32 threadCount);
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_PHYSICS_TASK_SCHEDULER_H
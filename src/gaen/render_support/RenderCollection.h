@@ -0,0 +1,411 @@
+//------------------------------------------------------------------------------
+// RenderCollection.h - Collection of renderable objects (e.g. sprites)
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_RENDERCOLLECTION_H
+#define GAEN_RENDER_SUPPORT_RENDERCOLLECTION_H
+
+#include <algorithm>
+
+#include "gaen/core/mem.h"
+#include "gaen/core/Vector.h"
+
+#include "gaen/render_support/render_objects.h"
+
+namespace gaen
+{
+
+// RenderCollection maintains a collection of renderable objects and
+// supports both fast lookups based on a numeric uid, as well as an
+// ordered traversal based on a float order.
+
+// Items live in a flat array of slots, reused through a free list
+// with a generation count so stale Handles can be detected. A packed
+// array of (order, slot) entries gives the traversal order, and a
+// flat uid table maps uids to slots. Nothing is allocated per item
+// once the arrays have grown.
+
+// Removals leave a hole in the order array and changed orders just
+// mark it unsorted, both are fixed up by the next begin(). Inserts
+// only mark it unsorted when they land out of order.
+
+// class T must supply the following methods:
+//   ouid uid()
+//   f32 order()
+//
+
+// The order() method can be crafted to support arbitrarily complex
+// orders.  For example, it may encode a combination of zdepth,
+// rendering resources (images/shaders/etc), and transparency to
+// create a desirable rendering order.
+
+
+enum RenderItemStatus
+{
+    kRIS_Active,
+    kRIS_Destroyed
+};
+
+template <class T>
+class RenderCollection
+{
+private:
+    static const u32 kNoSlot = 0xffffffff;
+
+    struct Slot
+    {
+        UniquePtr<T> pItem;
+        u32 generation = 0;
+        u32 orderPos = kNoSlot;
+    };
+
+    struct OrderEntry
+    {
+        f32 order;
+        u32 slot; // kNoSlot for a removed item
+    };
+
+    // Open addressed uid to slot table. Linear probing with backward
+    // shift deletes, so there are no tombstones to clean up.
+    class UidIndex
+    {
+    public:
+        u32 find(ouid uid) const
+        {
+            if (mCount == 0)
+                return kNoSlot;
+            for (u32 i = home(uid); mEntries[i].slot != kNoSlot; i = (i + 1) & mMask)
+            {
+                if (mEntries[i].uid == uid)
+                    return mEntries[i].slot;
+            }
+            return kNoSlot;
+        }
+
+        void insert(ouid uid, u32 slot)
+        {
+            if ((mCount + 1) * 4 > mEntries.size() * 3)
+                grow();
+            u32 i = home(uid);
+            while (mEntries[i].slot != kNoSlot)
+                i = (i + 1) & mMask;
+            mEntries[i] = Entry{uid, slot};
+            mCount++;
+        }
+
+        void erase(ouid uid)
+        {
+            if (mCount == 0)
+                return;
+            u32 i = home(uid);
+            while (mEntries[i].slot != kNoSlot && mEntries[i].uid != uid)
+                i = (i + 1) & mMask;
+            if (mEntries[i].slot == kNoSlot)
+                return;
+
+            // Pull back later entries of the run that may no longer be
+            // reachable through the gap.
+            for (u32 j = (i + 1) & mMask; mEntries[j].slot != kNoSlot; j = (j + 1) & mMask)
+            {
+                u32 k = home(mEntries[j].uid);
+                bool movable = i <= j ? (k <= i || k > j) : (k <= i && k > j);
+                if (movable)
+                {
+                    mEntries[i] = mEntries[j];
+                    i = j;
+                }
+            }
+            mEntries[i].slot = kNoSlot;
+            mCount--;
+        }
+
+    private:
+        struct Entry
+        {
+            ouid uid;
+            u32 slot;
+        };
+
+        u32 home(ouid uid) const
+        {
+            u32 h = static_cast<u32>(uid) * 0x9e3779b1;
+            return (h ^ (h >> 16)) & mMask;
+        }
+
+        void grow()
+        {
+            Vector<kMEM_Renderer, Entry> old;
+            old.swap(mEntries);
+            u32 capacity = old.empty() ? 64 : static_cast<u32>(old.size()) * 2;
+            mEntries.assign(capacity, Entry{0, kNoSlot});
+            mMask = capacity - 1;
+            mCount = 0;
+            for (const Entry & entry : old)
+            {
+                if (entry.slot != kNoSlot)
+                    insert(entry.uid, entry.slot);
+            }
+        }
+
+        Vector<kMEM_Renderer, Entry> mEntries;
+        u32 mCount = 0;
+        u32 mMask = 0;
+    }; // class UidIndex
+
+public:
+    // Refers to an item without a lookup. get() returns null once the
+    // item has been removed, even if its slot has been reused.
+    struct Handle
+    {
+        u32 slot;
+        u32 generation;
+    };
+
+    class Iter
+    {
+        friend class RenderCollection;
+    public:
+        Iter& operator++()
+        {
+            ++mPos;
+            skipHoles();
+            return *this;
+        }
+
+        Iter operator++(int)
+        {
+            Iter tmp(*this);
+            operator++();
+            return tmp;
+        }
+
+        T * operator*()
+        {
+            return mpColl->itemAt(mPos);
+        }
+
+        const T * operator*() const
+        {
+            return mpColl->itemAt(mPos);
+        }
+
+        T * operator->()
+        {
+            return mpColl->itemAt(mPos);
+        }
+
+        const T * operator->() const
+        {
+            return mpColl->itemAt(mPos);
+        }
+
+        bool operator==(const Iter & rhs)
+        {
+            return mPos == rhs.mPos;
+        }
+
+        bool operator!=(const Iter & rhs)
+        {
+            return mPos != rhs.mPos;
+        }
+    private:
+        Iter(RenderCollection * pColl, u32 pos)
+          : mpColl(pColl)
+          , mPos(pos)
+        {
+            skipHoles();
+        }
+
+        void skipHoles()
+        {
+            while (mPos < mpColl->mOrder.size() && mpColl->mOrder[mPos].slot == kNoSlot)
+                ++mPos;
+        }
+
+        RenderCollection * mpColl;
+        u32 mPos;
+    }; // class Iter
+
+    // Sorts and compacts if needed, so traversal is a linear scan in
+    // order. insert, erase, release and reorder invalidate iterators.
+    Iter begin()
+    {
+        flush();
+        return Iter(this, 0);
+    }
+    Iter end()         { return Iter(this, static_cast<u32>(mOrder.size())); }
+    u32  size()        { return mSize; }
+    Iter find(ouid uid)
+    {
+        u32 slot = mUidIndex.find(uid);
+        if (slot != kNoSlot)
+            return Iter(this, mSlots[slot].orderPos);
+        else
+            return end();
+    }
+
+    Handle handle(const Iter & it) const
+    {
+        u32 slot = mOrder[it.mPos].slot;
+        return Handle{slot, mSlots[slot].generation};
+    }
+
+    T * get(Handle h)
+    {
+        if (h.slot < mSlots.size() && mSlots[h.slot].generation == h.generation)
+            return mSlots[h.slot].pItem.get();
+        return nullptr;
+    }
+
+    void insert(UniquePtr<T> pItem)
+    {
+        ASSERT(mUidIndex.find(pItem->uid()) == kNoSlot);
+
+        u32 slot;
+        if (!mFreeSlots.empty())
+        {
+            slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<u32>(mSlots.size());
+            mSlots.emplace_back();
+        }
+
+        f32 order = pItem->order();
+        if (!mOrder.empty() && order < mOrder.back().order)
+            mIsUnsorted = true;
+
+        mUidIndex.insert(pItem->uid(), slot);
+        Slot & s = mSlots[slot];
+        s.pItem = std::move(pItem);
+        s.orderPos = static_cast<u32>(mOrder.size());
+        mOrder.push_back(OrderEntry{order, slot});
+        mSize++;
+    }
+
+    void erase(Iter it)
+    {
+        T * pItem = release(it);
+        GDELETE(pItem);
+    }
+
+    // Removes without deleting, the caller takes ownership
+    T * release(Iter it)
+    {
+        OrderEntry & entry = mOrder[it.mPos];
+        ASSERT(entry.slot != kNoSlot);
+        Slot & s = mSlots[entry.slot];
+
+        T * pItem = s.pItem.release();
+        mUidIndex.erase(pItem->uid());
+        s.generation++;
+        s.orderPos = kNoSlot;
+        mFreeSlots.push_back(entry.slot);
+
+        entry.slot = kNoSlot;
+        mHoleCount++;
+        mSize--;
+
+        // Keep churn without traversals from growing the order array
+        if (mHoleCount > 64 && mHoleCount > mSize)
+            compact();
+        return pItem;
+    }
+
+    void reorder(ouid uid)
+    {
+        u32 slot = mUidIndex.find(uid);
+        ASSERT(slot != kNoSlot);
+
+        if (slot != kNoSlot)
+        {
+            OrderEntry & entry = mOrder[mSlots[slot].orderPos];
+            f32 order = mSlots[slot].pItem->order();
+            if (order != entry.order)
+            {
+                entry.order = order;
+                mIsUnsorted = true;
+            }
+        }
+    }
+
+private:
+    T * itemAt(u32 pos)
+    {
+        return mSlots[mOrder[pos].slot].pItem.get();
+    }
+
+    void flush()
+    {
+        if (mHoleCount > 0)
+            compact();
+        if (mIsUnsorted)
+        {
+            // Ties break on slot so the traversal is deterministic
+            std::sort(mOrder.begin(), mOrder.end(), [](const OrderEntry & lhs, const OrderEntry & rhs)
+            {
+                return lhs.order < rhs.order || (lhs.order == rhs.order && lhs.slot < rhs.slot);
+            });
+            mIsUnsorted = false;
+            updatePositions();
+        }
+    }
+
+    // Removes holes, keeping the remaining entries in order
+    void compact()
+    {
+        u32 count = 0;
+        for (const OrderEntry & entry : mOrder)
+        {
+            if (entry.slot != kNoSlot)
+                mOrder[count++] = entry;
+        }
+        mOrder.resize(count);
+        mHoleCount = 0;
+        updatePositions();
+    }
+
+    void updatePositions()
+    {
+        for (u32 i = 0; i < mOrder.size(); ++i)
+            mSlots[mOrder[i].slot].orderPos = i;
+    }
+
+    Vector<kMEM_Renderer, Slot> mSlots;
+    Vector<kMEM_Renderer, u32> mFreeSlots;
+    Vector<kMEM_Renderer, OrderEntry> mOrder;
+    UidIndex mUidIndex;
+
+    u32 mSize = 0;
+    u32 mHoleCount = 0;
+    bool mIsUnsorted = false;
+
+}; // class RenderCollection
+
+} // namespace gaen
+
+#endif //#ifndef GAEN_RENDER_SUPPORT_RENDERCOLLECTION_H
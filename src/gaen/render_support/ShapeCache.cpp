@@ -0,0 +1,220 @@
+//------------------------------------------------------------------------------
+// ShapeCache.cpp - Shared, refcounted procedural shape meshes
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include "gaen/core/hashing.h"
+#include "gaen/core/HashMap.h"
+#include "gaen/assets/Gmdl.h"
+
+#include "gaen/render_support/shapes.h"
+#include "gaen/render_support/ShapeCache.h"
+
+namespace gaen
+{
+
+static_assert(sizeof(ShapeKey) == 4 * 12, "ShapeKey has padding, byte compare won't work");
+
+ShapeKey::ShapeKey(ShapeType type)
+{
+    memset(this, 0, sizeof(ShapeKey));
+    this->type = type;
+}
+
+ShapeKey ShapeKey::box(const vec3 & size, Color color)
+{
+    ShapeKey key(ShapeType::Box);
+    key.params[0] = size.x;
+    key.params[1] = size.y;
+    key.params[2] = size.z;
+    key.colors[0] = color.value();
+    return key;
+}
+
+ShapeKey ShapeKey::cone(const vec3 & size, u32 slices, Color color)
+{
+    ShapeKey key = box(size, color);
+    key.type = ShapeType::Cone;
+    key.slices = slices;
+    return key;
+}
+
+ShapeKey ShapeKey::cylinder(const vec3 & size, u32 slices, Color color)
+{
+    ShapeKey key = box(size, color);
+    key.type = ShapeType::Cylinder;
+    key.slices = slices;
+    return key;
+}
+
+ShapeKey ShapeKey::hex(f32 height, f32 length, const Color * pColors, u32 colorsSize)
+{
+    ASSERT(colorsSize > 0 && colorsSize <= kMaxColors);
+    ShapeKey key(ShapeType::Hex);
+    key.params[0] = height;
+    key.params[1] = length;
+    key.sections = colorsSize;
+    for (u32 i = 0; i < colorsSize; ++i)
+        key.colors[i] = pColors[i].value();
+    return key;
+}
+
+ShapeKey ShapeKey::sphere(const vec3 & size, u32 slices, u32 sections, Color color)
+{
+    ShapeKey key = box(size, color);
+    key.type = ShapeType::Sphere;
+    key.slices = slices;
+    key.sections = sections;
+    return key;
+}
+
+ShapeKey ShapeKey::quad_sphere(const vec3 & size, u32 sections, Color color)
+{
+    ShapeKey key = box(size, color);
+    key.type = ShapeType::QuadSphere;
+    key.sections = sections;
+    return key;
+}
+
+bool ShapeKey::operator==(const ShapeKey & rhs) const
+{
+    return memcmp(this, &rhs, sizeof(ShapeKey)) == 0;
+}
+
+size_t ShapeKeyHash::operator()(const ShapeKey & key) const
+{
+    return fnv1a_32(reinterpret_cast<const u8*>(&key), sizeof(ShapeKey));
+}
+
+static Gmdl * build_shape(const ShapeKey & key)
+{
+    vec3 size(key.params[0], key.params[1], key.params[2]);
+    Color color(key.colors[0]);
+    mat43 transform(1.0f);
+
+    switch (key.type)
+    {
+    case ShapeType::Box:
+        return build_box(size, color, transform);
+    case ShapeType::Cone:
+        return build_cone(size, key.slices, color, transform);
+    case ShapeType::Cylinder:
+        return build_cylinder(size, key.slices, color, transform);
+    case ShapeType::Hex:
+    {
+        Color colors[ShapeKey::kMaxColors];
+        for (u32 i = 0; i < key.sections; ++i)
+            colors[i] = Color(key.colors[i]);
+        return build_hex(key.params[0], key.params[1], colors, key.sections, transform);
+    }
+    case ShapeType::Sphere:
+        return build_sphere(size, key.slices, key.sections, color, transform);
+    case ShapeType::QuadSphere:
+        return build_quad_sphere(size, key.sections, color, transform);
+    default:
+        PANIC("Unknown ShapeType: %u", (u32)key.type);
+        return nullptr;
+    }
+}
+
+struct ShapeCacheEntry
+{
+    Gmdl * pGmdl;
+    u32 refCount;
+};
+
+// Shape calls come from every TaskMaster and Models are destroyed on
+// whichever thread drops them, so the maps are behind one lock. Shapes
+// are small, building one under the lock is cheap next to the
+// allocations it saves.
+static std::mutex sShapeCacheMutex;
+static HashMap<kMEM_Model, ShapeKey, ShapeCacheEntry, ShapeKeyHash> sShapes;
+static HashMap<kMEM_Model, const Gmdl*, ShapeKey> sShapeKeys;
+
+const Gmdl * shape_cache_acquire(const ShapeKey & key)
+{
+    std::lock_guard<std::mutex> lock(sShapeCacheMutex);
+
+    auto it = sShapes.find(key);
+    if (it != sShapes.end())
+    {
+        it->second.refCount++;
+        return it->second.pGmdl;
+    }
+
+    Gmdl * pGmdl = build_shape(key);
+    sShapes.emplace(key, ShapeCacheEntry{pGmdl, 1});
+    sShapeKeys.emplace(pGmdl, key);
+    return pGmdl;
+}
+
+void shape_cache_addref(const Gmdl * pGmdl)
+{
+    std::lock_guard<std::mutex> lock(sShapeCacheMutex);
+
+    auto keyIt = sShapeKeys.find(pGmdl);
+    PANIC_IF(keyIt == sShapeKeys.end(), "shape_cache_addref on uncached Gmdl");
+    sShapes[keyIt->second].refCount++;
+}
+
+void shape_cache_release(const Gmdl * pGmdl)
+{
+    std::lock_guard<std::mutex> lock(sShapeCacheMutex);
+
+    auto keyIt = sShapeKeys.find(pGmdl);
+    if (keyIt == sShapeKeys.end())
+    {
+        LOG_ERROR("shape_cache_release on uncached Gmdl");
+        return;
+    }
+
+    auto it = sShapes.find(keyIt->second);
+    ASSERT(it != sShapes.end() && it->second.refCount > 0);
+    it->second.refCount--;
+    if (it->second.refCount == 0)
+    {
+        GDELETE(it->second.pGmdl);
+        sShapes.erase(it);
+        sShapeKeys.erase(keyIt);
+    }
+}
+
+u32 shape_cache_size()
+{
+    std::lock_guard<std::mutex> lock(sShapeCacheMutex);
+    return static_cast<u32>(sShapes.size());
+}
+
+u32 shape_cache_refcount(const Gmdl * pGmdl)
+{
+    std::lock_guard<std::mutex> lock(sShapeCacheMutex);
+    auto keyIt = sShapeKeys.find(pGmdl);
+    if (keyIt == sShapeKeys.end())
+        return 0;
+    return sShapes[keyIt->second].refCount;
+}
+
+} // namespace gaen
@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------------
+// ShapeCache.h - Shared, refcounted procedural shape meshes
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_SHAPE_CACHE_H
+#define GAEN_RENDER_SUPPORT_SHAPE_CACHE_H
+
+#include "gaen/math/vec3.h"
+#include "gaen/assets/Color.h"
+
+namespace gaen
+{
+
+class Gmdl;
+
+enum class ShapeType : u32
+{
+    Box,
+    Cone,
+    Cylinder,
+    Hex,
+    Sphere,
+    QuadSphere
+};
+
+// Everything that goes into building a procedural shape's Gmdl. Keys
+// are compared and hashed as raw bytes, so build them with the factory
+// functions which zero unused fields.
+struct ShapeKey
+{
+    static const u32 kMaxColors = 6;
+
+    ShapeType type;
+    f32 params[3];  // size, or height and length for hexes
+    u32 slices;
+    u32 sections;
+    u32 colors[kMaxColors];
+
+    static ShapeKey box(const vec3 & size, Color color);
+    static ShapeKey cone(const vec3 & size, u32 slices, Color color);
+    static ShapeKey cylinder(const vec3 & size, u32 slices, Color color);
+    static ShapeKey hex(f32 height, f32 length, const Color * pColors, u32 colorsSize);
+    static ShapeKey sphere(const vec3 & size, u32 slices, u32 sections, Color color);
+    static ShapeKey quad_sphere(const vec3 & size, u32 sections, Color color);
+
+    bool operator==(const ShapeKey & rhs) const;
+
+private:
+    ShapeKey(ShapeType type);
+};
+
+struct ShapeKeyHash
+{
+    size_t operator()(const ShapeKey & key) const;
+};
+
+// Procedural Gmdls shared by content, so identical shape calls from any
+// TaskMaster get the same Gmdl. Each acquire must be matched by a
+// release, the Gmdl is deleted with its last reference.
+//
+// Sharing the Gmdl also shares the GPU buffers, the renderer refcounts
+// those by vertex and primitive pointer, and the convex hulls
+// ModelPhysics keys by Gmdl.
+const Gmdl * shape_cache_acquire(const ShapeKey & key);
+void shape_cache_addref(const Gmdl * pGmdl);
+void shape_cache_release(const Gmdl * pGmdl);
+
+u32 shape_cache_size();
+u32 shape_cache_refcount(const Gmdl * pGmdl);
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_SHAPE_CACHE_H
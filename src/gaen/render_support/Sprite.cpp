@@ -94,14 +94,14 @@ const void * Sprite::triOffset(u32 idx) const
     return (void*)(sizeof(GlyphTri) * (&mpGatl->tris()[idx] - mpGatl->tris()));
 }
 
-vec3 Sprite::halfExtents() const
+void Sprite::extents(vec3 & rmin, vec3 & rmax) const
 {
     const AnimInfoSpr * pAnimInfo = mpGspr->getAnim(mpGspr->defaultAnimHash());
     uintptr_t frameElemsOffset = (uintptr_t)mpGspr->getFrameElemsOffset(pAnimInfo, 0);
     u16 triIdx = (u16)(frameElemsOffset / sizeof(GlyphTri));
     const GlyphTri & tri = mpGatl->tri(triIdx);
-    vec3 rmin(std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max(), 0.0f);
-    vec3 rmax(std::numeric_limits<f32>::lowest(), std::numeric_limits<f32>::lowest(), 0.0f);
+    rmin = vec3(std::numeric_limits<f32>::max(), std::numeric_limits<f32>::max(), 0.0f);
+    rmax = vec3(std::numeric_limits<f32>::lowest(), std::numeric_limits<f32>::lowest(), 0.0f);
 
     const GlyphVert & vert0 = mpGatl->vert(tri.p0);
     rmin.x = min(rmin.x, vert0.position.x);
@@ -120,10 +120,20 @@ vec3 Sprite::halfExtents() const
     rmin.y = min(rmin.y, vert2.position.y);
     rmax.x = max(rmax.x, vert2.position.x);
     rmax.y = max(rmax.y, vert2.position.y);
+}
 
-    vec3 ext = rmax - rmin;
+vec3 Sprite::halfExtents() const
+{
+    vec3 rmin, rmax;
+    extents(rmin, rmax);
+    return (rmax - rmin) / 2.0f;
+}
 
-    return ext / 2.0f;
+vec3 Sprite::center() const
+{
+    vec3 rmin, rmax;
+    extents(rmin, rmax);
+    return (rmin + rmax) / 2.0f;
 }
 
 const Gimg & Sprite::gimg() const
@@ -142,12 +152,7 @@ SpriteInstance::SpriteInstance(Sprite * pSprite, u32 stageHash, RenderPass pass,
   , mIsVisible(isVisible)
   , mHasBody(false)
   , mTransform(transform)
-  , mIsAnimating(false)
-  , mIsLooping(false)
-  , mDoneMessage(0)
 {
-    mDurationPerFrame = 0.0f;
-    mDurationSinceFrameChange = 0.0f;
     mAnimHash = 0;
     animate(mpSprite->mpGspr->defaultAnimHash(), 0);
 }
@@ -175,52 +180,6 @@ const AnimInfoSpr & SpriteInstance::currentAnim()
     return *mpAnimInfo;
 }
 
-void SpriteInstance::playAnim(u32 animHash, f32 duration, bool loop, u32 doneMessage)
-{
-    ASSERT(duration > 0.0f);
-    mIsAnimating = true;
-    mIsLooping = loop;
-    mDoneMessage = doneMessage;
-    animate(animHash, 0);
-    mDurationPerFrame = duration / mpAnimInfo->frameCount;
-    mDurationSinceFrameChange = 0.0f;
-
-    // Send the renderer the message immediately so there isn't a
-    // delay in frame switch until next frame times out
-    SpriteInstance::sprite_anim(kSpriteMgrTaskId,
-                                kRendererTaskId,
-                                mpSprite->uid(),
-                                mAnimHash,
-                                mAnimFrameIdx);
-}
-
-bool SpriteInstance::advanceAnim(f32 delta)
-{
-    mDurationSinceFrameChange += delta;
-
-    if (mDurationSinceFrameChange > mDurationPerFrame)
-    {
-        u32 framesToAdvance = (u32)(mDurationSinceFrameChange / mDurationPerFrame);
-        u32 newFrameIdx = (mAnimFrameIdx + framesToAdvance) % mpAnimInfo->frameCount;
-        mDurationSinceFrameChange = fmod(delta, mDurationPerFrame);
-
-        if (mAnimFrameIdx + framesToAdvance >= mpAnimInfo->frameCount)
-        {
-            if (!mIsLooping)
-            {
-                mIsAnimating = false;
-            }
-            if (mDoneMessage != 0)
-            {
-                MessageQueueWriter msgw(mDoneMessage, kMessageFlag_None, kSpriteMgrTaskId, mpSprite->owner(), to_cell(0), 0);
-            }
-        }
-
-        return animate(mAnimHash, newFrameIdx);
-    }
-    return false;
-}
-
 bool SpriteInstance::animate(u32 animHash, u32 animFrameIdx)
 {
     if (animHash != mAnimHash)
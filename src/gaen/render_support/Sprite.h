@@ -61,10 +61,14 @@ public:
     u64 trisSize() const;
 
     vec3 halfExtents() const;
+    vec3 center() const;
 
     const Gimg & gimg() const;
 
 private:
+    // Min and max of the default animation's first frame
+    void extents(vec3 & rmin, vec3 & rmax) const;
+
     // Delete these to make sure we construct through the asset->addref path
     Sprite(Sprite&&)                  = delete;
     Sprite & operator=(const Sprite&) = delete;
@@ -128,9 +132,6 @@ private:
     SpriteInstance & operator=(const SpriteInstance&) = delete;
     SpriteInstance & operator=(SpriteInstance&&)      = delete;
 
-    void playAnim(u32 animHash, f32 duration, bool loop, u32 doneMessage);
-    bool advanceAnim(f32 delta);
-
     Sprite * mpSprite;
     u32 mStageHash;
     RenderPass mPass;
@@ -144,12 +145,6 @@ private:
 
     u32 mAnimHash;
     u32 mAnimFrameIdx;
-    f32 mDurationPerFrame;
-    f32 mDurationSinceFrameChange;
-
-    bool mIsAnimating;
-    bool mIsLooping;
-    u32 mDoneMessage;
 };
 
 typedef UniquePtr<SpriteInstance> SpriteInstanceUP;
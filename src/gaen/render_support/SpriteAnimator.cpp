@@ -0,0 +1,151 @@
+//------------------------------------------------------------------------------
+// SpriteAnimator.cpp - Sprite animation state in contiguous arrays
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include "gaen/render_support/SpriteAnimator.h"
+
+namespace gaen
+{
+
+void SpriteAnimator::play(u32 uid,
+                          task_id owner,
+                          u32 animHash,
+                          u32 frameCount,
+                          f32 duration,
+                          bool loop,
+                          u32 doneMessage)
+{
+    ASSERT(duration > 0.0f);
+    ASSERT(frameCount > 0);
+
+    u32 idx;
+    auto it = mIndices.find(uid);
+    if (it != mIndices.end())
+    {
+        idx = it->second;
+    }
+    else
+    {
+        idx = static_cast<u32>(mUids.size());
+        mIndices.emplace(uid, idx);
+        mElapsed.push_back(0.0f);
+        mFrameDurations.push_back(0.0f);
+        mUids.push_back(uid);
+        mAnimHashes.push_back(0);
+        mFrameIdxs.push_back(0);
+        mFrameCounts.push_back(0);
+        mLoops.push_back(0);
+        mOwners.push_back(0);
+        mDoneMessages.push_back(0);
+    }
+
+    mElapsed[idx] = 0.0f;
+    mFrameDurations[idx] = duration / frameCount;
+    mAnimHashes[idx] = animHash;
+    mFrameIdxs[idx] = 0;
+    mFrameCounts[idx] = frameCount;
+    mLoops[idx] = loop ? 1 : 0;
+    mOwners[idx] = owner;
+    mDoneMessages[idx] = doneMessage;
+}
+
+void SpriteAnimator::stop(u32 uid)
+{
+    auto it = mIndices.find(uid);
+    if (it != mIndices.end())
+        removeAt(it->second);
+}
+
+void SpriteAnimator::advance(f32 delta, SpriteAnimBatch & batch, Vector<kMEM_Engine, SpriteAnimDone> & done)
+{
+    for (u32 i = 0; i < mElapsed.size(); /* increment below, removal swaps the next one into i */)
+    {
+        f32 elapsed = mElapsed[i] + delta;
+        f32 frameDuration = mFrameDurations[i];
+        if (elapsed < frameDuration)
+        {
+            mElapsed[i] = elapsed;
+            ++i;
+            continue;
+        }
+
+        u32 framesToAdvance = static_cast<u32>(elapsed / frameDuration);
+        mElapsed[i] = elapsed - framesToAdvance * frameDuration;
+
+        u32 frameIdx = mFrameIdxs[i] + framesToAdvance;
+        bool passedEnd = frameIdx >= mFrameCounts[i];
+        frameIdx %= mFrameCounts[i];
+
+        if (frameIdx != mFrameIdxs[i])
+        {
+            mFrameIdxs[i] = frameIdx;
+            batch.push(mUids[i], mAnimHashes[i], frameIdx);
+        }
+
+        if (passedEnd)
+        {
+            if (mDoneMessages[i] != 0)
+                done.push_back(SpriteAnimDone{mOwners[i], mDoneMessages[i]});
+            if (!mLoops[i])
+            {
+                removeAt(i);
+                continue;
+            }
+        }
+        ++i;
+    }
+}
+
+void SpriteAnimator::removeAt(u32 idx)
+{
+    u32 last = static_cast<u32>(mUids.size()) - 1;
+    mIndices.erase(mUids[idx]);
+    if (idx != last)
+    {
+        mElapsed[idx] = mElapsed[last];
+        mFrameDurations[idx] = mFrameDurations[last];
+        mUids[idx] = mUids[last];
+        mAnimHashes[idx] = mAnimHashes[last];
+        mFrameIdxs[idx] = mFrameIdxs[last];
+        mFrameCounts[idx] = mFrameCounts[last];
+        mLoops[idx] = mLoops[last];
+        mOwners[idx] = mOwners[last];
+        mDoneMessages[idx] = mDoneMessages[last];
+        mIndices[mUids[idx]] = idx;
+    }
+    mElapsed.pop_back();
+    mFrameDurations.pop_back();
+    mUids.pop_back();
+    mAnimHashes.pop_back();
+    mFrameIdxs.pop_back();
+    mFrameCounts.pop_back();
+    mLoops.pop_back();
+    mOwners.pop_back();
+    mDoneMessages.pop_back();
+}
+
+} // namespace gaen
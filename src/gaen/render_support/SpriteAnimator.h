@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+// SpriteAnimator.h - Sprite animation state in contiguous arrays
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_SPRITE_ANIMATOR_H
+#define GAEN_RENDER_SUPPORT_SPRITE_ANIMATOR_H
+
+#include "gaen/core/HashMap.h"
+#include "gaen/core/Vector.h"
+#include "gaen/engine/Message.h"
+
+namespace gaen
+{
+
+struct SpriteFrameChange
+{
+    u32 uid;
+    u32 animHash;
+    u32 animFrameIdx;
+};
+
+// All sprite frame changes from one SpriteMgr update. Sent to the
+// renderer in a single sprite_anim_batch message, the renderer owns
+// and deletes it after applying the changes.
+class SpriteAnimBatch
+{
+public:
+    void push(u32 uid, u32 animHash, u32 animFrameIdx)
+    {
+        mChanges.push_back(SpriteFrameChange{uid, animHash, animFrameIdx});
+    }
+
+    bool empty() const { return mChanges.empty(); }
+    u32 size() const { return static_cast<u32>(mChanges.size()); }
+    const SpriteFrameChange & operator[](u32 idx) const { return mChanges[idx]; }
+
+private:
+    Vector<kMEM_Renderer, SpriteFrameChange> mChanges;
+};
+
+struct SpriteAnimDone
+{
+    task_id owner;
+    u32 message;
+};
+
+// Frame timing for every playing sprite animation, kept in parallel
+// arrays holding only the active animations so a SpriteMgr update is
+// one linear pass rather than a walk over every sprite in the map.
+class SpriteAnimator
+{
+public:
+    // Starts, or restarts, uid's animation at frame 0
+    void play(u32 uid,
+              task_id owner,
+              u32 animHash,
+              u32 frameCount,
+              f32 duration,
+              bool loop,
+              u32 doneMessage);
+
+    void stop(u32 uid);
+
+    // Advances every active animation by delta. Frame changes are
+    // appended to batch, and done notifications to done. Non looping
+    // animations stop once they pass their last frame.
+    void advance(f32 delta, SpriteAnimBatch & batch, Vector<kMEM_Engine, SpriteAnimDone> & done);
+
+    bool isPlaying(u32 uid) const { return mIndices.find(uid) != mIndices.end(); }
+    u32 activeCount() const { return static_cast<u32>(mUids.size()); }
+
+private:
+    void removeAt(u32 idx);
+
+    // Hot, touched every advance
+    Vector<kMEM_Engine, f32> mElapsed;
+    Vector<kMEM_Engine, f32> mFrameDurations;
+
+    // Only touched on frame changes
+    Vector<kMEM_Engine, u32> mUids;
+    Vector<kMEM_Engine, u32> mAnimHashes;
+    Vector<kMEM_Engine, u32> mFrameIdxs;
+    Vector<kMEM_Engine, u32> mFrameCounts;
+    Vector<kMEM_Engine, u8> mLoops;
+    Vector<kMEM_Engine, task_id> mOwners;
+    Vector<kMEM_Engine, u32> mDoneMessages;
+
+    HashMap<kMEM_Engine, u32, u32> mIndices; // uid to array index
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_SPRITE_ANIMATOR_H
@@ -32,6 +32,7 @@
 #include "gaen/engine/Asset.h"
 #include "gaen/engine/Entity.h"
 
+#include "gaen/engine/messages/SpriteAnimBatch.h"
 #include "gaen/engine/messages/SpriteInstance.h"
 #include "gaen/engine/messages/SpritePlayAnim.h"
 #include "gaen/engine/messages/SpriteVelocity.h"
@@ -44,8 +45,15 @@ namespace gaen
 
 static const u32 kMaxMessages = 4096;
 
+SpriteMgr::SpriteMgr()
+{
+    mpAnimBatch = GNEW(kMEM_Renderer, SpriteAnimBatch);
+}
+
 SpriteMgr::~SpriteMgr()
 {
+    GDELETE(mpAnimBatch);
+
     // LORRTODO: Cleanup is causing crash on exit... need to redesign how we release assets
     //for (auto & spritePair : mSpriteMap)
     //{
@@ -57,31 +65,21 @@ void SpriteMgr::update(f32 delta)
 {
     mPhysics.update(delta);
 
-    for (auto & spritePair : mSpriteMap)
+    mAnimator.advance(delta, *mpAnimBatch, mAnimDone);
+
+    for (const SpriteAnimDone & done : mAnimDone)
     {
-        SpriteInstance * pSpriteInst = spritePair.second.get();
-        /*
-        if (pSpriteInst->mVelocity != vec2{0.0})
-        {
-            vec3 offset = vec3(pSpriteInst->mVelocity * delta, 0.0f);
-            pSpriteInst->mTransform = to_mat4x3(translate(mat4(1.0f), offset) * mat4(pSpriteInst->mTransform));
-            SpriteInstance::send_sprite_transform(kSpriteMgrTaskId, kRendererTaskId, pSpriteInst->sprite().uid(), pSpriteInst->mTransform);
-            {
-                messages::PropertyMat43BW msgw(HASH::transform, kMessageFlag_None, kSpriteMgrTaskId, pSpriteInst->sprite().mOwner, HASH::transform);
-                msgw.setValue(pSpriteInst->mTransform);
-                send_message(msgw);
-            }
-        }
-        */
-        if (pSpriteInst->mIsAnimating && pSpriteInst->advanceAnim(delta))
-        {
-            // update renderer with new frame
-            SpriteInstance::sprite_anim(kSpriteMgrTaskId,
-                                        kRendererTaskId,
-                                        pSpriteInst->sprite().uid(),
-                                        pSpriteInst->mAnimHash,
-                                        pSpriteInst->mAnimFrameIdx);
-        }
+        MessageQueueWriter msgw(done.message, kMessageFlag_None, kSpriteMgrTaskId, done.owner, to_cell(0), 0);
+    }
+    mAnimDone.clear();
+
+    if (!mpAnimBatch->empty())
+    {
+        // renderer takes ownership of the batch
+        messages::SpriteAnimBatchBW msgw(HASH::sprite_anim_batch, kMessageFlag_None, kSpriteMgrTaskId, kRendererTaskId);
+        msgw.setBatch(mpAnimBatch);
+        send_message(msgw);
+        mpAnimBatch = GNEW(kMEM_Renderer, SpriteAnimBatch);
     }
 }
 
@@ -116,7 +114,16 @@ MessageResult SpriteMgr::message(const T & msgAcc)
         auto spritePair = mSpriteMap.find(msgr.uid());
         if (spritePair != mSpriteMap.end())
         {
-            spritePair->second->playAnim(msgr.animHash(), msgr.duration(), msgr.loop(), msgr.doneMessage());
+            SpriteInstance * pSpriteInst = spritePair->second.get();
+            pSpriteInst->animate(msgr.animHash(), 0);
+            mAnimator.play(msgr.uid(),
+                           pSpriteInst->sprite().owner(),
+                           msgr.animHash(),
+                           pSpriteInst->currentAnim().frameCount,
+                           msgr.duration(),
+                           msgr.loop(),
+                           msgr.doneMessage());
+            mpAnimBatch->push(msgr.uid(), msgr.animHash(), 0);
         }
         else
         {
@@ -196,6 +203,7 @@ MessageResult SpriteMgr::message(const T & msgAcc)
         auto spritePair = mSpriteMap.find(uid);
         if (spritePair != mSpriteMap.end())
         {
+            mAnimator.stop(uid);
             spritePair->second->destroySprite();
             mSpriteMap.erase(spritePair);
         }
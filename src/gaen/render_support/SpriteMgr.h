@@ -33,6 +33,7 @@
 
 #include "gaen/engine/Handle.h"
 #include "gaen/render_support/Sprite.h"
+#include "gaen/render_support/SpriteAnimator.h"
 #include "gaen/render_support/SpritePhysics.h"
 
 namespace gaen
@@ -44,6 +45,7 @@ public:
     typedef HashMap<kMEM_Engine, u32, SpriteInstanceUP> SpriteMap;
     typedef HashMap<kMEM_Engine, task_id, List<kMEM_Engine, u32>> SpriteOwners;
 
+    SpriteMgr();
     ~SpriteMgr();
 
     void update(f32 delta);
@@ -56,6 +58,12 @@ private:
     SpriteOwners mSpriteOwners;
 
     SpritePhysics mPhysics;
+
+    SpriteAnimator mAnimator;
+    // Frame changes accumulated since the last update, handed off to
+    // the renderer in one message
+    SpriteAnimBatch * mpAnimBatch;
+    Vector<kMEM_Engine, SpriteAnimDone> mAnimDone;
 };
 
 // Compose API
@@ -26,53 +26,80 @@
 
 #include "gaen/render_support/stdafx.h"
 
+#include "gaen/core/gamevars.h"
+
 #include "gaen/engine/messages/PropertyMat43.h"
-#include "gaen/engine/messages/Collision.h"
+#include "gaen/render_support/PhysicsTaskScheduler.h"
 #include "gaen/render_support/SpritePhysics.h"
 
 
 namespace gaen
 {
 
+GAMEVAR_REF_FLOAT(physics_rate);
+GAMEVAR_REF_INT(physics_max_steps);
+
 static const u32 kMaxMessages = 4096;
 
-void SpriteMotionState::getWorldTransform(btTransform& worldTrans) const
+SpriteMotionState::SpriteMotionState(SpriteInstance & spriteInstance)
+  : mSpriteInstance(spriteInstance)
 {
+    mSpriteInstance.mHasBody = true;
+
     const mat43 & t = mSpriteInstance.mTransform;
-    worldTrans.setBasis(btMatrix3x3(t[0][0], t[0][1], t[0][2],
-                                    t[1][0], t[1][1], t[1][2],
-                                    t[2][0], t[2][1], t[2][2]));
+    mTickTransform.setBasis(btMatrix3x3(t[0][0], t[0][1], t[0][2],
+                                        t[1][0], t[1][1], t[1][2],
+                                        t[2][0], t[2][1], t[2][2]));
 
-    worldTrans.setOrigin(btVector3(t[3][0], t[3][1], 0.0f /* Don't use t[3][2] for z position since we use it for render order */));
+    mTickTransform.setOrigin(btVector3(t[3][0], t[3][1], 0.0f /* Don't use t[3][2] for z position since we use it for render order */));
+    mPrevTickTransform = mTickTransform;
+}
+
+void SpriteMotionState::getWorldTransform(btTransform& worldTrans) const
+{
+    worldTrans = mTickTransform;
 }
 
 void SpriteMotionState::setWorldTransform(const btTransform& worldTrans)
 {
-    mat43 & t = mSpriteInstance.mTransform;
+    // Don't set z position since we use it for render order
+    ASSERT(worldTrans.getOrigin()[2] == 0.0f);
 
-    t[0][0] = worldTrans.getBasis()[0][0];
-    t[0][1] = worldTrans.getBasis()[0][1];
-    t[0][2] = worldTrans.getBasis()[0][2];
+    mTickTransform = worldTrans;
+}
 
-    t[1][0] = worldTrans.getBasis()[1][0];
-    t[1][1] = worldTrans.getBasis()[1][1];
-    t[1][2] = worldTrans.getBasis()[1][2];
+void SpriteMotionState::publish(f32 alpha)
+{
+    btTransform interpTrans;
+    interpolate_transform(interpTrans, mPrevTickTransform, mTickTransform, alpha);
 
-    t[2][0] = worldTrans.getBasis()[2][0];
-    t[2][1] = worldTrans.getBasis()[2][1];
-    t[2][2] = worldTrans.getBasis()[2][2];
+    mat43 t = mSpriteInstance.mTransform;
 
-    t[3][0] = worldTrans.getOrigin()[0];
-    t[3][1] = worldTrans.getOrigin()[1];
+    t[0][0] = interpTrans.getBasis()[0][0];
+    t[0][1] = interpTrans.getBasis()[0][1];
+    t[0][2] = interpTrans.getBasis()[0][2];
 
-    // Don't set z position since we use it for render order
-    ASSERT(worldTrans.getOrigin()[2] == 0.0f);
+    t[1][0] = interpTrans.getBasis()[1][0];
+    t[1][1] = interpTrans.getBasis()[1][1];
+    t[1][2] = interpTrans.getBasis()[1][2];
+
+    t[2][0] = interpTrans.getBasis()[2][0];
+    t[2][1] = interpTrans.getBasis()[2][1];
+    t[2][2] = interpTrans.getBasis()[2][2];
 
-    SpriteInstance::sprite_transform(kSpriteMgrTaskId, kRendererTaskId, mSpriteInstance.sprite().uid(), mSpriteInstance.mTransform);
+    t[3][0] = interpTrans.getOrigin()[0];
+    t[3][1] = interpTrans.getOrigin()[1];
+
+    if (t != mSpriteInstance.mTransform)
     {
-        messages::PropertyMat43BW msgw(HASH::set_property, kMessageFlag_None, kSpriteMgrTaskId, mSpriteInstance.sprite().owner(), HASH::transform);
-        msgw.setValue(mSpriteInstance.mTransform);
-        send_message(msgw);
+        mSpriteInstance.mTransform = t;
+
+        SpriteInstance::sprite_transform(kSpriteMgrTaskId, kRendererTaskId, mSpriteInstance.sprite().uid(), mSpriteInstance.mTransform);
+        {
+            messages::PropertyMat43BW msgw(HASH::set_property, kMessageFlag_None, kSpriteMgrTaskId, mSpriteInstance.sprite().owner(), HASH::transform);
+            msgw.setValue(mSpriteInstance.mTransform);
+            send_message(msgw);
+        }
     }
 }
 
@@ -83,22 +110,48 @@ SpritePhysics::SpritePhysics()
     mpBroadphase = GNEW(kMEM_Physics, btDbvtBroadphase);
     mpCollisionConfiguration = GNEW(kMEM_Physics, btDefaultCollisionConfiguration);
 
-    mpDispatcher = GNEW(kMEM_Physics, btCollisionDispatcher, mpCollisionConfiguration);
-    mpDispatcher->setNearCallback(near_callback);
-
-    mpSolver = GNEW(kMEM_Physics, btSequentialImpulseConstraintSolver);
-    mpDynamicsWorld = GNEW(kMEM_Physics,
-                           btDiscreteDynamicsWorld,
-                           mpDispatcher,
-                           mpBroadphase,
-                           mpSolver,
-                           mpCollisionConfiguration);
+    u32 threadCount = physics_thread_count();
+    if (threadCount > 1)
+    {
+        // Collision pairs, islands and integration spread across
+        // PhysicsTaskScheduler's threads.
+        physics_init_task_scheduler(threadCount);
+
+        mpDispatcher = GNEW(kMEM_Physics, btCollisionDispatcherMt, mpCollisionConfiguration);
+        mpDispatcher->setNearCallback(near_callback);
+
+        mpSolverPool = GNEW(kMEM_Physics, btConstraintSolverPoolMt, threadCount);
+        mpSolver = GNEW(kMEM_Physics, btSequentialImpulseConstraintSolverMt);
+        mpDynamicsWorld = GNEW(kMEM_Physics,
+                               btDiscreteDynamicsWorldMt,
+                               mpDispatcher,
+                               mpBroadphase,
+                               mpSolverPool,
+                               mpSolver,
+                               mpCollisionConfiguration);
+    }
+    else
+    {
+        mpDispatcher = GNEW(kMEM_Physics, btCollisionDispatcher, mpCollisionConfiguration);
+        mpDispatcher->setNearCallback(near_callback);
+
+        mpSolverPool = nullptr;
+        mpSolver = GNEW(kMEM_Physics, btSequentialImpulseConstraintSolver);
+        mpDynamicsWorld = GNEW(kMEM_Physics,
+                               btDiscreteDynamicsWorld,
+                               mpDispatcher,
+                               mpBroadphase,
+                               mpSolver,
+                               mpCollisionConfiguration);
+    }
 }
 
 SpritePhysics::~SpritePhysics()
 {
     GDELETE(mpDynamicsWorld);
     GDELETE(mpSolver);
+    if (mpSolverPool)
+        GDELETE(mpSolverPool);
     GDELETE(mpDispatcher);
     GDELETE(mpCollisionConfiguration);
     GDELETE(mpBroadphase);
@@ -106,8 +159,36 @@ SpritePhysics::~SpritePhysics()
 
 void SpritePhysics::update(f32 delta)
 {
-    mpDynamicsWorld->stepSimulation(delta, 4);
+    mClock.setRate(physics_rate, physics_max_steps);
+    u32 steps = mClock.advance(delta);
+    for (u32 i = 0; i < steps; ++i)
+    {
+        tick(mClock.step());
+    }
+
+    f32 alpha = mClock.alpha();
+    for (auto & bodyPair : mBodies)
+    {
+        bodyPair.second->mpMotionState->publish(alpha);
+    }
+
+    mCollisionMessages.flush(kSpriteMgrTaskId);
+}
+
+void SpritePhysics::tick(f32 step)
+{
+    for (auto & bodyPair : mBodies)
+    {
+        bodyPair.second->mpMotionState->beginTick();
+    }
+
+    mpDynamicsWorld->stepSimulation(step, 0);
+
+    processCollisions();
+}
 
+void SpritePhysics::processCollisions()
+{
     // Check for collisions
     int numManifolds = mpDynamicsWorld->getDispatcher()->getNumManifolds();
     for (int i = 0; i < numManifolds; ++i)
@@ -116,6 +197,9 @@ void SpritePhysics::update(f32 delta)
         const SpriteBody* obA = static_cast<const SpriteBody*>(contactManifold->getBody0());
         const SpriteBody* obB = static_cast<const SpriteBody*>(contactManifold->getBody1());
 
+        // Average the penetrating points so each manifold is one contact
+        ContactInfo info;
+        u32 penetrating = 0;
         int numContacts = contactManifold->getNumContacts();
         for (int j=0;j<numContacts;j++)
         {
@@ -124,31 +208,37 @@ void SpritePhysics::update(f32 delta)
             {
                 const btVector3& ptA = pt.getPositionWorldOnA();
                 const btVector3& ptB = pt.getPositionWorldOnB();
-                const btVector3& normalOnB = pt.m_normalWorldOnB;
-
-                // Send collision messages to both entities
-                {
-                    messages::CollisionBW msgw(HASH::collision, kMessageFlag_None, kSpriteMgrTaskId, obA->mpMotionState->mSpriteInstance.sprite().owner(), obB->mGroupHash);
-                    msgw.setSubject(obB->mpMotionState->mSpriteInstance.sprite().owner());
-                    msgw.setDistance(pt.getDistance());
-                    msgw.setLocationSelf(vec3(ptA.x(), ptA.y(), ptA.z()));
-                    msgw.setLocationOther(vec3(ptB.x(), ptB.y(), ptB.z()));
-                    send_message(msgw);
-                }
-                {
-                    messages::CollisionBW msgw(HASH::collision, kMessageFlag_None, kSpriteMgrTaskId, obB->mpMotionState->mSpriteInstance.sprite().owner(), obA->mGroupHash);
-                    msgw.setSubject(obA->mpMotionState->mSpriteInstance.sprite().owner());
-                    msgw.setDistance(pt.getDistance());
-                    msgw.setLocationSelf(vec3(ptB.x(), ptB.y(), ptB.z()));
-                    msgw.setLocationOther(vec3(ptA.x(), ptA.y(), ptA.z()));
-                    send_message(msgw);
-                }
+                info.distance = penetrating == 0 ? pt.getDistance() : min(info.distance, pt.getDistance());
+                info.locA += vec3(ptA.x(), ptA.y(), ptA.z());
+                info.locB += vec3(ptB.x(), ptB.y(), ptB.z());
+                penetrating++;
+            }
+        }
 
+        if (penetrating == 0)
+            continue;
 
-            }
+        info.locA /= f32(penetrating);
+        info.locB /= f32(penetrating);
+
+        // Send collision messages to both entities when the contact begins
+        if (mContacts.touch(obA, obB, info) == ContactPhase::Begin)
+        {
+            mCollisionMessages.queue(HASH::collision, obA->mpMotionState->mSpriteInstance.sprite().owner(), obB->mGroupHash, obB->mpMotionState->mSpriteInstance.sprite().owner(), info, true);
+            mCollisionMessages.queue(HASH::collision, obB->mpMotionState->mSpriteInstance.sprite().owner(), obA->mGroupHash, obA->mpMotionState->mSpriteInstance.sprite().owner(), info, false);
         }
     }
 
+    mContacts.endTick([this](const SpriteBody * obA, const SpriteBody * obB, const ContactInfo & info)
+    {
+        queueCollisionEnd(obA, obB, info);
+    });
+}
+
+void SpritePhysics::queueCollisionEnd(const SpriteBody * obA, const SpriteBody * obB, const ContactInfo & info)
+{
+    mCollisionMessages.queue(HASH::collision_end, obA->mpMotionState->mSpriteInstance.sprite().owner(), obB->mGroupHash, obB->mpMotionState->mSpriteInstance.sprite().owner(), info, true);
+    mCollisionMessages.queue(HASH::collision_end, obB->mpMotionState->mSpriteInstance.sprite().owner(), obA->mGroupHash, obA->mpMotionState->mSpriteInstance.sprite().owner(), info, false);
 }
 
 void SpritePhysics::insert(SpriteInstance & spriteInst,
@@ -208,6 +298,19 @@ void SpritePhysics::remove(u32 uid)
     auto it = mBodies.find(uid);
     if (it != mBodies.end())
     {
+        // Only the bodies left behind hear about the contact ending
+        const SpriteBody * pRemoved = it->second.get();
+        mContacts.removeBody(pRemoved, [this, pRemoved](const SpriteBody * obA, const SpriteBody * obB, const ContactInfo & info)
+        {
+            const SpriteBody * pOther = obA == pRemoved ? obB : obA;
+            mCollisionMessages.queue(HASH::collision_end,
+                                     pOther->mpMotionState->mSpriteInstance.sprite().owner(),
+                                     pRemoved->mGroupHash,
+                                     pRemoved->mpMotionState->mSpriteInstance.sprite().owner(),
+                                     info,
+                                     pOther == obA);
+        });
+
         mpDynamicsWorld->removeRigidBody(it->second.get());
         mBodies.erase(it);
     }
@@ -35,6 +35,8 @@
 #include "gaen/math/vec3.h"
 
 #include "gaen/core/mem.h"
+#include "gaen/render_support/ContactTracker.h"
+#include "gaen/render_support/PhysicsClock.h"
 #include "gaen/render_support/Sprite.h"
 
 
@@ -42,6 +44,7 @@ class btBroadphaseInterface;
 class btDefaultCollisionConfiguration;
 class btCollisionDispatcher;
 class btSequentialImpulseConstraintSolver;
+class btConstraintSolverPoolMt;
 class btDiscreteDynamicsWorld;
 struct btDispatcherInfo;
 
@@ -53,17 +56,23 @@ class SpriteMotionState : public btMotionState
     friend class SpritePhysics;
     friend class SpriteBody;
 public:
-    SpriteMotionState(SpriteInstance & spriteInstance)
-      : mSpriteInstance(spriteInstance)
-    {
-        mSpriteInstance.mHasBody = true;
-    }
+    SpriteMotionState(SpriteInstance & spriteInstance);
 
+    // Bullet sees the transform as of the latest fixed tick, see
+    // ModelMotionState.
     void getWorldTransform(btTransform& worldTrans) const;
     void setWorldTransform(const btTransform& worldTrans);
 
+    void beginTick() { mPrevTickTransform = mTickTransform; }
+
+    // Push the transform interpolated between the last two ticks to
+    // the SpriteInstance, renderer and owning entity.
+    void publish(f32 alpha);
+
 private:
     SpriteInstance & mSpriteInstance;
+    btTransform mPrevTickTransform;
+    btTransform mTickTransform;
 };
 typedef UniquePtr<SpriteMotionState> SpriteMotionStateUP;
 
@@ -93,8 +102,11 @@ public:
     SpritePhysics();
     ~SpritePhysics();
 
+    // Fixed rate ticks with interpolated transforms, see ModelPhysics
     void update(f32 delta);
 
+    const PhysicsClock & clock() const { return mClock; }
+
     void insert(SpriteInstance & spriteInst,
                 f32 mass,
                 u32 group,
@@ -104,6 +116,10 @@ public:
 
     void setVelocity(u32 uid, const vec2 & velocity);
 private:
+    void tick(f32 step);
+    void processCollisions();
+    void queueCollisionEnd(const SpriteBody * obA, const SpriteBody * obB, const ContactInfo & info);
+
     u16 buildMask(const ivec4 & mask03, const ivec4 & mask47);
     u16 maskFromHash(u32 hash);
 
@@ -111,15 +127,21 @@ private:
                               btCollisionDispatcher & dispatcher,
                               const btDispatcherInfo & dispatchInfo);
 
+    PhysicsClock mClock;
+
     btBroadphaseInterface * mpBroadphase;
     btDefaultCollisionConfiguration * mpCollisionConfiguration;
     btCollisionDispatcher * mpDispatcher;
     btSequentialImpulseConstraintSolver * mpSolver;
+    btConstraintSolverPoolMt * mpSolverPool; // only for multithreaded worlds
     btDiscreteDynamicsWorld * mpDynamicsWorld;
 
     HashMap<kMEM_Physics, u32, SpriteBodyUP> mBodies;
     HashMap<kMEM_Physics, vec3, btCollisionShapeUP> mCollisionShapes;
     HashMap<kMEM_Physics, u32, u16> mMaskBits;
+
+    ContactTracker<SpriteBody> mContacts;
+    CollisionMessageBatch mCollisionMessages;
 };
 
 } // namespace gaen
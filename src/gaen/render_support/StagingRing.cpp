@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+// StagingRing.cpp - Sub-allocator for a persistently mapped upload buffer
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include "gaen/render_support/StagingRing.h"
+
+namespace gaen
+{
+
+void StagingRing::init(u64 capacity)
+{
+    ASSERT(capacity > 0);
+    mCapacity = capacity;
+    mHead = 0;
+    mTail = 0;
+    mFencedHead = 0;
+    mFences.clear();
+}
+
+bool StagingRing::alloc(u64 * pOffset, u64 size, u64 alignment)
+{
+    ASSERT(pOffset);
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    if (size == 0 || size > mCapacity)
+        return false;
+
+    // Nothing in flight, start again from the front
+    if (mHead == mTail && mFences.empty())
+    {
+        u64 pos = mHead % mCapacity;
+        if (pos != 0)
+            mHead = mTail = mFencedHead = mHead + mCapacity - pos;
+    }
+
+    u64 start = (mHead + alignment - 1) & ~(alignment - 1);
+
+    // Skip the tail end of the buffer if the range would wrap
+    u64 pos = start % mCapacity;
+    if (pos + size > mCapacity)
+        start += mCapacity - pos;
+
+    if (start + size - mTail > mCapacity)
+        return false;
+
+    *pOffset = start % mCapacity;
+    mHead = start + size;
+    return true;
+}
+
+void StagingRing::fence(u64 fenceId)
+{
+    ASSERT(mFences.empty() || mFences.back().fenceId < fenceId);
+    mFences.push_back(FenceMark{fenceId, mHead});
+    mFencedHead = mHead;
+}
+
+void StagingRing::retire(u64 fenceId)
+{
+    while (!mFences.empty() && mFences.front().fenceId <= fenceId)
+    {
+        mTail = mFences.front().head;
+        mFences.pop_front();
+    }
+}
+
+} // namespace gaen
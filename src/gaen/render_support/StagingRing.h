@@ -0,0 +1,78 @@
+//------------------------------------------------------------------------------
+// StagingRing.h - Sub-allocator for a persistently mapped upload buffer
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_STAGING_RING_H
+#define GAEN_RENDER_SUPPORT_STAGING_RING_H
+
+#include "gaen/core/List.h"
+
+namespace gaen
+{
+
+// Hands out ranges of a fixed size staging buffer in ring order. The
+// gpu reads a range some time after the cpu writes it, so allocations
+// are grouped under a fence and only reclaimed once the caller reports
+// that fence as signaled.
+class StagingRing
+{
+public:
+    void init(u64 capacity);
+
+    // Byte offset of size free bytes, or false if the ring is too full
+    // until more fences retire. Ranges never wrap past the end.
+    bool alloc(u64 * pOffset, u64 size, u64 alignment);
+
+    // Everything allocated since the previous fence belongs to fenceId.
+    // Ids must increase.
+    void fence(u64 fenceId);
+
+    // Reclaims ranges of every fence up to and including fenceId
+    void retire(u64 fenceId);
+
+    u64 capacity() const { return mCapacity; }
+    u64 used() const { return mHead - mTail; }
+    bool hasUnfenced() const { return mHead != mFencedHead; }
+
+private:
+    struct FenceMark
+    {
+        u64 fenceId;
+        u64 head;
+    };
+
+    u64 mCapacity = 0;
+
+    // Total bytes ever allocated and freed, offset is these mod capacity
+    u64 mHead = 0;
+    u64 mTail = 0;
+    u64 mFencedHead = 0;
+
+    List<kMEM_Renderer, FenceMark> mFences;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_STAGING_RING_H
@@ -0,0 +1,47 @@
+//------------------------------------------------------------------------------
+// TileRenderer.cpp - Spreads screen tiles of a CPU rendered frame across cores
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include "gaen/core/platutils.h"
+
+#include "gaen/render_support/TileRenderer.h"
+
+namespace gaen
+{
+
+void TileRenderer::init(u32 threadCount)
+{
+    mThreadCount = threadCount == 0 ? platform_core_count() : threadCount;
+}
+
+void TileRenderer::fin()
+{
+    // Threads belong to parallel_for's pool, fin_parallel_for stops them
+    mThreadCount = 1;
+}
+
+} // namespace gaen
@@ -0,0 +1,67 @@
+//------------------------------------------------------------------------------
+// TileRenderer.h - Spreads screen tiles of a CPU rendered frame across cores
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_TILE_RENDERER_H
+#define GAEN_RENDER_SUPPORT_TILE_RENDERER_H
+
+#include "gaen/core/base_defines.h"
+#include "gaen/core/parallel_for.h"
+
+namespace gaen
+{
+
+// Runs a per tile functor over a grid of tiles with parallel_for, one
+// job per tile. The calling thread renders tiles as well, and render
+// returns once every tile is complete. Tiles are claimed one at a time
+// so uneven tiles (e.g. sky vs. dense voxels) balance across threads
+// naturally.
+//
+// Tile functors must only write to memory owned by their tile.
+class TileRenderer
+{
+public:
+    // threadCount includes the calling thread, 0 means one per core.
+    void init(u32 threadCount = 0);
+    void fin();
+
+    u32 threadCount() const { return mThreadCount; }
+
+    template <class TileFunc>
+    void render(u32 tilesX, u32 tilesY, const TileFunc & tileFunc) const
+    {
+        parallel_for(tilesX * tilesY, mThreadCount, [&](u32 tileIdx)
+        {
+            tileFunc(tileIdx % tilesX, tileIdx / tilesX);
+        });
+    }
+
+private:
+    u32 mThreadCount = 1;
+};
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_TILE_RENDERER_H
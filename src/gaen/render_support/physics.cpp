@@ -28,6 +28,7 @@
 
 #include <LinearMath/btIDebugDraw.h>
 
+#include "gaen/core/gamevars.h"
 #include "gaen/engine/UniqueObject.h"
 #include "gaen/engine/messages/CollisionBox.h"
 #include "gaen/engine/messages/CollisionConvexHull.h"
@@ -37,6 +38,11 @@
 namespace gaen
 {
 
+// Fixed physics tick rate in Hz, and the most ticks a single frame may
+// run to catch up after a spike.
+GAMEVAR_DECL_FLOAT(physics_rate, 60.0f);
+GAMEVAR_DECL_INT(physics_max_steps, 4);
+
 u32 collision_box_create(task_id owner,
                          const vec3 & halfExtents,
                          const mat43 & transform,
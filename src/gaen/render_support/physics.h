@@ -56,6 +56,8 @@ namespace system_api
 static const i32 PHY_FLAG_NONE            = 0;
 static const i32 PHY_FLAG_KINEMATIC       = 1;
 static const i32 PHY_FLAG_STOP_ON_COLLIDE = 2;
+// Send #collision every tick while touching, not just when contact begins
+static const i32 PHY_FLAG_CONTACT_PERSIST = 4;
 
 // Collision shape type
 static const i32 PHY_SHAPE_BOX = 0;
@@ -0,0 +1,163 @@
+//------------------------------------------------------------------------------
+// script_syscalls.cpp - Bytecode system calls backed by render_support
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include "gaen/hashes/hashes.h"
+#include "gaen/engine/ScriptVm.h"
+
+#include "gaen/render_support/system_api.h"
+#include "gaen/render_support/shapes.h"
+#include "gaen/render_support/SpriteMgr.h"
+#include "gaen/render_support/ModelMgr.h"
+
+#include "gaen/render_support/script_syscalls.h"
+
+namespace gaen
+{
+
+// Arguments arrive in r0..r7 as laid out by kScriptSyscalls, return
+// values go in r0.
+
+static void syscall_gen_uid(cell * pRegs, Entity * pCaller)
+{
+    pRegs[0].i = system_api::gen_uid(pCaller);
+}
+
+static void syscall_light_ambient(cell * pRegs, Entity * pCaller)
+{
+    system_api::light_ambient(pRegs[0].i, pRegs[1].f, pCaller);
+}
+
+static void syscall_light_remove(cell * pRegs, Entity * pCaller)
+{
+    system_api::light_remove(pRegs[0].i, pCaller);
+}
+
+static void syscall_shape_destroy(cell * pRegs, Entity * pCaller)
+{
+    system_api::shape_destroy(pRegs[0].i, pCaller);
+}
+
+static void syscall_sprite_play_anim(cell * pRegs, Entity * pCaller)
+{
+    system_api::sprite_play_anim(pRegs[0].i, pRegs[1].i, pRegs[2].f, pRegs[3].i != 0, pRegs[4].i, pCaller);
+}
+
+static void syscall_sprite_stage_show(cell * pRegs, Entity * pCaller)
+{
+    system_api::sprite_stage_show(pRegs[0].i, pCaller);
+}
+
+static void syscall_sprite_stage_hide(cell * pRegs, Entity * pCaller)
+{
+    system_api::sprite_stage_hide(pRegs[0].i, pCaller);
+}
+
+static void syscall_sprite_stage_remove(cell * pRegs, Entity * pCaller)
+{
+    system_api::sprite_stage_remove(pRegs[0].i, pCaller);
+}
+
+static void syscall_model_show(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_show(pRegs[0].i, pCaller);
+}
+
+static void syscall_model_hide(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_hide(pRegs[0].i, pCaller);
+}
+
+static void syscall_model_remove_body(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_remove_body(pRegs[0].i, pCaller);
+}
+
+static void syscall_model_stage_show(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_stage_show(pRegs[0].i, pCaller);
+}
+
+static void syscall_model_stage_hide(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_stage_hide(pRegs[0].i, pCaller);
+}
+
+static void syscall_model_stage_hide_all(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_stage_hide_all(pCaller);
+}
+
+static void syscall_model_stage_remove(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_stage_remove(pRegs[0].i, pCaller);
+}
+
+static void syscall_model_stage_remove_all(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_stage_remove_all(pCaller);
+}
+
+static void syscall_model_stage_camera_scale(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_stage_camera_scale(pRegs[0].i, pRegs[1].f, pCaller);
+}
+
+static void syscall_model_stage_camera_activate(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_stage_camera_activate(pRegs[0].i, pCaller);
+}
+
+static void syscall_model_stage_camera_remove(cell * pRegs, Entity * pCaller)
+{
+    system_api::model_stage_camera_remove(pRegs[0].i, pCaller);
+}
+
+void register_render_support_syscalls()
+{
+    register_script_syscall(HASH::gen_uid,                     &syscall_gen_uid);
+    register_script_syscall(HASH::light_ambient,               &syscall_light_ambient);
+    register_script_syscall(HASH::light_remove,                &syscall_light_remove);
+    register_script_syscall(HASH::shape_destroy,               &syscall_shape_destroy);
+    register_script_syscall(HASH::sprite_play_anim,            &syscall_sprite_play_anim);
+    register_script_syscall(HASH::sprite_stage_show,           &syscall_sprite_stage_show);
+    register_script_syscall(HASH::sprite_stage_hide,           &syscall_sprite_stage_hide);
+    register_script_syscall(HASH::sprite_stage_remove,         &syscall_sprite_stage_remove);
+    register_script_syscall(HASH::model_show,                  &syscall_model_show);
+    register_script_syscall(HASH::model_hide,                  &syscall_model_hide);
+    register_script_syscall(HASH::model_remove_body,           &syscall_model_remove_body);
+    register_script_syscall(HASH::model_stage_show,            &syscall_model_stage_show);
+    register_script_syscall(HASH::model_stage_hide,            &syscall_model_stage_hide);
+    register_script_syscall(HASH::model_stage_hide_all,        &syscall_model_stage_hide_all);
+    register_script_syscall(HASH::model_stage_remove,          &syscall_model_stage_remove);
+    register_script_syscall(HASH::model_stage_remove_all,      &syscall_model_stage_remove_all);
+    register_script_syscall(HASH::model_stage_camera_scale,    &syscall_model_stage_camera_scale);
+    register_script_syscall(HASH::model_stage_camera_activate, &syscall_model_stage_camera_activate);
+    register_script_syscall(HASH::model_stage_camera_remove,   &syscall_model_stage_camera_remove);
+}
+
+} // namespace gaen
@@ -47,7 +47,7 @@ ShapeBuilder::ShapeBuilder(Gmdl * pGmdl)
         PANIC("ShapeBuilder only builds gmdls with indices of type kIND_Triangle");
 }
 
-u16 ShapeBuilder::setVert(u32 * pVertIdx,
+u32 ShapeBuilder::setVert(u32 * pVertIdx,
                           const vec3 & pos,
                           const vec3 & norm,
                           Color color)
@@ -59,23 +59,21 @@ u16 ShapeBuilder::setVert(u32 * pVertIdx,
     pVert->normal = norm;
     pVert->color = color;
 
-    u16 idx = *pVertIdx;
+    u32 idx = *pVertIdx;
     *pVertIdx += 1;
 
     return idx;
 }
 
 void ShapeBuilder::setTri(u32 * pPrimIdx,
-                          u16 idx0,
-                          u16 idx1,
-                          u16 idx2)
+                          u32 idx0,
+                          u32 idx1,
+                          u32 idx2)
 {
-    PrimTriangle * pTris = mGmdl;
-    PrimTriangle & tri = pTris[*pPrimIdx];
-
-    tri.p0 = idx0;
-    tri.p1 = idx1;
-    tri.p2 = idx2;
+    // setPrimIndex writes 16 or 32 bit indices to match the gmdl
+    mGmdl.setPrimIndex(*pPrimIdx * 3 + 0, idx0);
+    mGmdl.setPrimIndex(*pPrimIdx * 3 + 1, idx1);
+    mGmdl.setPrimIndex(*pPrimIdx * 3 + 2, idx2);
 
     *pPrimIdx += 1;
 }
@@ -90,9 +88,6 @@ void ShapeBuilder::setTri(u32 * pVertIdx,
     VertPosNormCol * pVert = mGmdl;
     pVert += *pVertIdx;
 
-    PrimTriangle * pTris = mGmdl;
-    PrimTriangle & tri = pTris[*pPrimIdx];
-
     vec3 vecNorm = tri_normal(p0, p1, p2);
 
     pVert[0].position = p0;
@@ -107,9 +102,9 @@ void ShapeBuilder::setTri(u32 * pVertIdx,
     pVert[2].normal = vecNorm;
     pVert[2].color = color;
 
-    tri.p0 = *pVertIdx + 0;
-    tri.p1 = *pVertIdx + 1;
-    tri.p2 = *pVertIdx + 2;
+    mGmdl.setPrimIndex(*pPrimIdx * 3 + 0, *pVertIdx + 0);
+    mGmdl.setPrimIndex(*pPrimIdx * 3 + 1, *pVertIdx + 1);
+    mGmdl.setPrimIndex(*pPrimIdx * 3 + 2, *pVertIdx + 2);
 
     *pVertIdx += 3;
     *pPrimIdx += 1;
@@ -159,10 +154,6 @@ void ShapeBuilder::setQuad(u32 * pVertIdx,
     VertPosNormCol * pVert = mGmdl;
     pVert += *pVertIdx;
 
-    PrimTriangle * pTris = mGmdl;
-    PrimTriangle & tri0 = pTris[*pPrimIdx];
-    PrimTriangle & tri1 = pTris[*pPrimIdx+1];
-
     pVert[0].position = p0;
     pVert[0].normal = norm;
     pVert[0].color = color;
@@ -179,13 +170,14 @@ void ShapeBuilder::setQuad(u32 * pVertIdx,
     pVert[3].normal = norm;
     pVert[3].color = color;
 
-    tri0.p0 = *pVertIdx + 0;
-    tri0.p1 = *pVertIdx + 1;
-    tri0.p2 = *pVertIdx + 2;
+    u32 idx = *pPrimIdx * 3;
+    mGmdl.setPrimIndex(idx + 0, *pVertIdx + 0);
+    mGmdl.setPrimIndex(idx + 1, *pVertIdx + 1);
+    mGmdl.setPrimIndex(idx + 2, *pVertIdx + 2);
 
-    tri1.p0 = *pVertIdx + 3;
-    tri1.p1 = *pVertIdx + 0;
-    tri1.p2 = *pVertIdx + 2;
+    mGmdl.setPrimIndex(idx + 3, *pVertIdx + 3);
+    mGmdl.setPrimIndex(idx + 4, *pVertIdx + 0);
+    mGmdl.setPrimIndex(idx + 5, *pVertIdx + 2);
 
     *pVertIdx += 4;
     *pPrimIdx += 2;
@@ -341,11 +333,11 @@ void ShapeBuilder::setHex(u32 * pVertIdx,
     // Add top triangles
     if (sides & kHXS_Top)
     {
-        u16 triTopL[3];
-        u16 triTopR[3];
+        u32 triTopL[3];
+        u32 triTopR[3];
 
-        u16 triBotL[3];
-        u16 triBotR[3];
+        u32 triBotL[3];
+        u32 triBotR[3];
 
         // Top Triangle
         if (colors[0] != colors[1])
@@ -408,8 +400,8 @@ void ShapeBuilder::setHex(u32 * pVertIdx,
             setTri(pPrimIdx, triBotL[0], triBotL[1], triBotL[2]);
         }
 
-        u16 rectL[4];
-        u16 rectR[4];
+        u32 rectL[4];
+        u32 rectR[4];
 
         // Rects (or Rect) between the two triangles
         if (colors[2] != colors[3])
@@ -623,17 +615,11 @@ void ShapeBuilder::addGmdl(const Gmdl & gmdl)
         *pVert++ = *pGmdlVert++;
     }
 
-    PrimTriangle * pInd = mGmdl;
-    pInd += mCurrPrimitive;
-
-    const PrimTriangle * pGmdlInd = gmdl;
-    for (u32 i = 0; i < gmdl.primCount(); ++i)
+    // Appended indices are offset by the verts already in the gmdl
+    u32 indexOffset = mCurrPrimitive * 3;
+    for (u32 i = 0; i < gmdl.indexCount(); ++i)
     {
-        pInd[0].p0 = pGmdlInd[0].p0 + mCurrPrimitive;
-        pInd[0].p1 = pGmdlInd[0].p1 + mCurrPrimitive;
-        pInd[0].p2 = pGmdlInd[0].p2 + mCurrPrimitive;
-        pInd++;
-        pGmdlInd++;
+        mGmdl.setPrimIndex(indexOffset + i, gmdl.primIndex(i) + mCurrVertex);
     }
 
     mCurrVertex += gmdl.vertCount();
@@ -941,36 +927,29 @@ void shape_destroy(i32 uid, Entity * pCaller)
     ModelInstance::model_remove(pCaller->task().id(), kRendererTaskId, uid);
 }
 
-i32 shape_box(i32 stageHash, i32 passHash, const vec3 & size, Color color, const mat43 & transform, Entity * pCaller)
+static i32 insert_shape(i32 stageHash, i32 passHash, const ShapeKey & shapeKey, const mat43 & transform, Entity * pCaller)
 {
-    Gmdl * pGmdl = build_box(size, color, mat43(1.0f));
-
-    Model * pModel = GNEW(kMEM_Engine, Model, pCaller->task().id(), pGmdl, true);
+    Model * pModel = GNEW(kMEM_Engine, Model, pCaller->task().id(), shapeKey);
     ModelInstance * pModelInst = GNEW(kMEM_Engine, ModelInstance, pModel, stageHash, pass_from_hash(passHash), kRF_Normal, pCaller->isVisible(), transform, true, false);
     ModelInstance::model_insert(pCaller->task().id(), kModelMgrTaskId, pModelInst);
     return pModel->uid();
 }
 
+i32 shape_box(i32 stageHash, i32 passHash, const vec3 & size, Color color, const mat43 & transform, Entity * pCaller)
+{
+    return insert_shape(stageHash, passHash, ShapeKey::box(size, color), transform, pCaller);
+}
+
 i32 shape_cone(i32 stageHash, i32 passHash, const vec3 & size, i32 slices, Color color, const mat43 & transform, Entity * pCaller)
 {
     slices = slices > 0 ? slices : 0;
-    Gmdl * pGmdl = build_cone(size, slices, color, mat43(1.0f));
-
-    Model * pModel = GNEW(kMEM_Engine, Model, pCaller->task().id(), pGmdl, true);
-    ModelInstance * pModelInst = GNEW(kMEM_Engine, ModelInstance, pModel, stageHash, pass_from_hash(passHash), kRF_Normal, pCaller->isVisible(), transform, true, false);
-    ModelInstance::model_insert(pCaller->task().id(), kModelMgrTaskId, pModelInst);
-    return pModel->uid();
+    return insert_shape(stageHash, passHash, ShapeKey::cone(size, slices, color), transform, pCaller);
 }
 
 i32 shape_cylinder(i32 stageHash, i32 passHash, const vec3 & size, i32 slices, Color color, const mat43 & transform, Entity * pCaller)
 {
     slices = slices > 0 ? slices : 0;
-    Gmdl * pGmdl = build_cylinder(size, slices, color, mat43(1.0f));
-
-    Model * pModel = GNEW(kMEM_Engine, Model, pCaller->task().id(), pGmdl, true);
-    ModelInstance * pModelInst = GNEW(kMEM_Engine, ModelInstance, pModel, stageHash, pass_from_hash(passHash), kRF_Normal, pCaller->isVisible(), transform, true, false);
-    ModelInstance::model_insert(pCaller->task().id(), kModelMgrTaskId, pModelInst);
-    return pModel->uid();
+    return insert_shape(stageHash, passHash, ShapeKey::cylinder(size, slices, color), transform, pCaller);
 }
 
 i32 shape_hex(i32 stageHash, i32 passHash, f32 height, f32 length, Color color0, Color color1, Color color2, Color color3, Color color4, Color color5, const mat43 & transform, Entity * pCaller)
@@ -983,12 +962,7 @@ i32 shape_hex(i32 stageHash, i32 passHash, f32 height, f32 length, Color color0,
     colors[4] = color4;
     colors[5] = color5;
 
-    Gmdl * pGmdl = build_hex(height, length, colors, 6, mat43(1.0f));
-
-    Model * pModel = GNEW(kMEM_Engine, Model, pCaller->task().id(), pGmdl, true);
-    ModelInstance * pModelInst = GNEW(kMEM_Engine, ModelInstance, pModel, stageHash, pass_from_hash(passHash), kRF_Normal, pCaller->isVisible(), transform, true, false);
-    ModelInstance::model_insert(pCaller->task().id(), kModelMgrTaskId, pModelInst);
-    return pModel->uid();
+    return insert_shape(stageHash, passHash, ShapeKey::hex(height, length, colors, 6), transform, pCaller);
 }
 
 i32 shape_hex(i32 stageHash, i32 passHash, f32 height, f32 length, Color color, const mat43 & transform, Entity * pCaller)
@@ -1010,23 +984,13 @@ i32 shape_sphere(i32 stageHash, i32 passHash, const vec3 & size, i32 slices, i32
 {
     slices = slices > 0 ? slices : 0;
     sections = sections > 0 ? sections : 0;
-    Gmdl * pGmdl = build_sphere(size, slices, sections, color, mat43(1.0f));
-
-    Model * pModel = GNEW(kMEM_Engine, Model, pCaller->task().id(), pGmdl, true);
-    ModelInstance * pModelInst = GNEW(kMEM_Engine, ModelInstance, pModel, stageHash, pass_from_hash(passHash), kRF_Normal, pCaller->isVisible(), transform, true, false);
-    ModelInstance::model_insert(pCaller->task().id(), kModelMgrTaskId, pModelInst);
-    return pModel->uid();
+    return insert_shape(stageHash, passHash, ShapeKey::sphere(size, slices, sections, color), transform, pCaller);
 }
 
 i32 shape_quad_sphere(i32 stageHash, i32 passHash, const vec3 & size, i32 sections, Color color, const mat43 & transform, Entity * pCaller)
 {
     sections = sections > 0 ? sections : 0;
-    Gmdl * pGmdl = build_quad_sphere(size, sections, color, mat43(1.0f));
-
-    Model * pModel = GNEW(kMEM_Engine, Model, pCaller->task().id(), pGmdl, true);
-    ModelInstance * pModelInst = GNEW(kMEM_Engine, ModelInstance, pModel, stageHash, pass_from_hash(passHash), kRF_Normal, pCaller->isVisible(), transform, true, false);
-    ModelInstance::model_insert(pCaller->task().id(), kModelMgrTaskId, pModelInst);
-    return pModel->uid();
+    return insert_shape(stageHash, passHash, ShapeKey::quad_sphere(size, sections, color), transform, pCaller);
 }
 } // namespace system_api
 
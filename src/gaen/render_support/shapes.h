@@ -61,15 +61,15 @@ class ShapeBuilder
 public:
     ShapeBuilder(Gmdl * pGmdl);
 
-    u16 setVert(u32 * pVertIdx,
+    u32 setVert(u32 * pVertIdx,
                 const vec3 & pos,
                 const vec3 & norm,
                 Color color);
 
     void setTri(u32 * pPrimIdx,
-                u16 idx0,
-                u16 idx1,
-                u16 idx2);
+                u32 idx0,
+                u32 idx1,
+                u32 idx2);
 
     void setTri(u32 * pVertIdx,
                 u32 * pPrimIdx,
@@ -31,6 +31,10 @@
 
 #include "gaen/render_support/voxel.h"
 
+#if HAS(VOXEL_PACKET_SSE)
+#include <immintrin.h>
+#endif
+
 namespace gaen
 {
 
@@ -621,8 +625,6 @@ struct VoxelRecurseInfo
     vec3 hitPosLoc;
 };
 
-static VoxelRecurseInfo sStack[kMaxDepth];
-
 inline VoxelRecurseInfo prep_stack_entry(const VoxelRef & voxelRef, const AABB_MinMax & aabb)
 {
     VoxelRecurseInfo stackEntry;
@@ -656,18 +658,22 @@ bool test_ray_voxel(VoxelRef * pVoxelRef, vec3 * pNormal, f32 * pZDepth, VoxelFa
 
 
 
+    // Recurse stack lives in this frame rather than in a static so
+    // rays can be traced concurrently from any number of threads.
+    VoxelRecurseInfo stack[kMaxDepth];
+
     // put voxel root on recurse stack before iteration begins
     u32 d = 0;
-    sStack[d] = prep_stack_entry(root.children, rootAabb);
+    stack[d] = prep_stack_entry(root.children, rootAabb);
 
-    sStack[d].hit = test_ray_box(&sStack[d].hitFace,
-                                 &sStack[d].entryDist,
-                                 &sStack[d].exitDist,
+    stack[d].hit = test_ray_box(&stack[d].hitFace,
+                                 &stack[d].entryDist,
+                                 &stack[d].exitDist,
                                  rayPosLoc,
                                  invRayDirLoc,
-                                 sStack[d].aabb);
+                                 stack[d].aabb);
 
-    if (!sStack[d].hit || sStack[d].voxelRef.isTerminalEmpty())
+    if (!stack[d].hit || stack[d].voxelRef.isTerminalEmpty())
     {
         return false;
     }
@@ -675,29 +681,29 @@ bool test_ray_voxel(VoxelRef * pVoxelRef, vec3 * pNormal, f32 * pZDepth, VoxelFa
     // else we hit, loop/recurse over children
     while (true)
     {
-        eval_voxel_hit(&sStack[d].searchOrder,
-                       &sStack[d].hitPosLoc,
-                       sStack[d].hitFace,
-                       sStack[d].entryDist,
-                       sStack[d].exitDist,
+        eval_voxel_hit(&stack[d].searchOrder,
+                       &stack[d].hitPosLoc,
+                       stack[d].hitFace,
+                       stack[d].entryDist,
+                       stack[d].exitDist,
                        rayPosLoc,
                        rayDirLoc,
-                       sStack[d].aabb);
+                       stack[d].aabb);
 
-        if (sStack[d].hit && sStack[d].voxelRef.isTerminalFull())
+        if (stack[d].hit && stack[d].voxelRef.isTerminalFull())
         {
-            *pVoxelRef = sStack[d].voxelRef;
-            *pNormal = kNormals[(u32)sStack[d].hitFace];
-            *pZDepth = sStack[d].entryDist;
-            *pFace = sStack[d].hitFace;
-            *pFaceUv = calc_face_uv(sStack[d].hitFace, sStack[d].hitPosLoc, sStack[d].aabb);
+            *pVoxelRef = stack[d].voxelRef;
+            *pNormal = kNormals[(u32)stack[d].hitFace];
+            *pZDepth = stack[d].entryDist;
+            *pFace = stack[d].hitFace;
+            *pFaceUv = calc_face_uv(stack[d].hitFace, stack[d].hitPosLoc, stack[d].aabb);
             return true;
         }
         else
         {
 //            for (;;)
 //            {
-                if (sStack[d].searchIndex >= 8)
+                if (stack[d].searchIndex >= 8)
                 {
                     if (d > 0)
                     {
@@ -711,10 +717,10 @@ bool test_ray_voxel(VoxelRef * pVoxelRef, vec3 * pNormal, f32 * pZDepth, VoxelFa
                 }
                 else
                 {
-                    VoxelRef childRef = voxelWorld.voxelRef(sStack[d].voxelRef.imageIdx, sStack[d].voxelRef.voxelIdx, sStack[d].searchOrder[sStack[d].searchIndex]);
-                    AABB_MinMax childAabb = voxel_subspace(sStack[d].aabb,
-                                                           sStack[d].searchOrder[sStack[d].searchIndex]);
-                    sStack[d].searchIndex++; // increment so if we recurse back here to this level we move past this one
+                    VoxelRef childRef = voxelWorld.voxelRef(stack[d].voxelRef.imageIdx, stack[d].voxelRef.voxelIdx, stack[d].searchOrder[stack[d].searchIndex]);
+                    AABB_MinMax childAabb = voxel_subspace(stack[d].aabb,
+                                                           stack[d].searchOrder[stack[d].searchIndex]);
+                    stack[d].searchIndex++; // increment so if we recurse back here to this level we move past this one
 
                     if (childRef.isTerminalEmpty())
                     {
@@ -733,7 +739,7 @@ bool test_ray_voxel(VoxelRef * pVoxelRef, vec3 * pNormal, f32 * pZDepth, VoxelFa
                         d++;
                         ASSERT(d < kMaxDepth);
 
-                        sStack[d] = recInf;
+                        stack[d] = recInf;
                     }
                 }
 //            }
@@ -864,4 +870,281 @@ bool test_ray_voxel_gpu(VoxelRef & voxelRef, // out
 }
 
 
+//------------------------------------------------------------------------------
+// Ray packets
+//------------------------------------------------------------------------------
+
+// Lane wide float ops, one lane per ray in the packet
+#if HAS(VOXEL_PACKET_AVX2)
+typedef __m256 lanef;
+inline lanef lane_set(f32 v) { return _mm256_set1_ps(v); }
+inline lanef lane_load(const f32 * p) { return _mm256_loadu_ps(p); }
+inline lanef lane_sub(lanef a, lanef b) { return _mm256_sub_ps(a, b); }
+inline lanef lane_mul(lanef a, lanef b) { return _mm256_mul_ps(a, b); }
+inline lanef lane_min(lanef a, lanef b) { return _mm256_min_ps(a, b); }
+inline lanef lane_max(lanef a, lanef b) { return _mm256_max_ps(a, b); }
+inline u32 lane_hit_mask(lanef t0, lanef t1)
+{
+    lanef hit = _mm256_and_ps(_mm256_cmp_ps(t1, _mm256_setzero_ps(), _CMP_GT_OQ),
+                              _mm256_cmp_ps(t0, t1, _CMP_LE_OQ));
+    return (u32)_mm256_movemask_ps(hit);
+}
+#elif HAS(VOXEL_PACKET_SSE)
+typedef __m128 lanef;
+inline lanef lane_set(f32 v) { return _mm_set1_ps(v); }
+inline lanef lane_load(const f32 * p) { return _mm_loadu_ps(p); }
+inline lanef lane_sub(lanef a, lanef b) { return _mm_sub_ps(a, b); }
+inline lanef lane_mul(lanef a, lanef b) { return _mm_mul_ps(a, b); }
+inline lanef lane_min(lanef a, lanef b) { return _mm_min_ps(a, b); }
+inline lanef lane_max(lanef a, lanef b) { return _mm_max_ps(a, b); }
+inline u32 lane_hit_mask(lanef t0, lanef t1)
+{
+    lanef hit = _mm_and_ps(_mm_cmpgt_ps(t1, _mm_setzero_ps()),
+                           _mm_cmple_ps(t0, t1));
+    return (u32)_mm_movemask_ps(hit);
+}
+#else
+struct lanef { f32 v[kRayPacketSize]; };
+inline lanef lane_set(f32 v) { lanef r; for (u32 i = 0; i < kRayPacketSize; ++i) r.v[i] = v; return r; }
+inline lanef lane_load(const f32 * p) { lanef r; for (u32 i = 0; i < kRayPacketSize; ++i) r.v[i] = p[i]; return r; }
+inline lanef lane_sub(lanef a, lanef b) { for (u32 i = 0; i < kRayPacketSize; ++i) a.v[i] -= b.v[i]; return a; }
+inline lanef lane_mul(lanef a, lanef b) { for (u32 i = 0; i < kRayPacketSize; ++i) a.v[i] *= b.v[i]; return a; }
+inline lanef lane_min(lanef a, lanef b) { for (u32 i = 0; i < kRayPacketSize; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+inline lanef lane_max(lanef a, lanef b) { for (u32 i = 0; i < kRayPacketSize; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+inline u32 lane_hit_mask(lanef t0, lanef t1)
+{
+    u32 mask = 0;
+    for (u32 i = 0; i < kRayPacketSize; ++i)
+        mask |= (u32)(t1.v[i] > 0.0f && t0.v[i] <= t1.v[i]) << i;
+    return mask;
+}
+#endif
+
+// Packet rays in voxel root local space, structure of arrays
+struct PacketRays
+{
+    lanef posX, posY, posZ;
+    lanef invDirX, invDirY, invDirZ;
+};
+
+struct PacketRecurseInfo
+{
+    VoxelRef voxelRef;
+    AABB_MinMax aabb;
+    u8 childMasks[8]; // lanes that hit each child, indexed by SubVoxel
+    u8 searchIndex;
+};
+
+// Same slab test as test_ray_box, across all lanes at once
+inline u32 packet_test_box(const PacketRays & rays, const AABB_MinMax & aabb)
+{
+    lanef tbotX = lane_mul(rays.invDirX, lane_sub(lane_set(aabb.min.x), rays.posX));
+    lanef tbotY = lane_mul(rays.invDirY, lane_sub(lane_set(aabb.min.y), rays.posY));
+    lanef tbotZ = lane_mul(rays.invDirZ, lane_sub(lane_set(aabb.min.z), rays.posZ));
+    lanef ttopX = lane_mul(rays.invDirX, lane_sub(lane_set(aabb.max.x), rays.posX));
+    lanef ttopY = lane_mul(rays.invDirY, lane_sub(lane_set(aabb.max.y), rays.posY));
+    lanef ttopZ = lane_mul(rays.invDirZ, lane_sub(lane_set(aabb.max.z), rays.posZ));
+
+    // Lane min/max return the second operand when either is NaN (a
+    // zero direction component against a box edge), scalar min(a, b)
+    // returns the first. Operands are swapped throughout so lanes
+    // agree with test_ray_box bit for bit.
+    lanef tminX = lane_min(tbotX, ttopX);
+    lanef tminY = lane_min(tbotY, ttopY);
+    lanef tminZ = lane_min(tbotZ, ttopZ);
+    lanef tmaxX = lane_max(tbotX, ttopX);
+    lanef tmaxY = lane_max(tbotY, ttopY);
+    lanef tmaxZ = lane_max(tbotZ, ttopZ);
+
+    lanef t0 = lane_max(lane_max(tminZ, tminX), lane_max(tminY, tminX));
+    lanef t1 = lane_min(lane_min(tmaxZ, tmaxX), lane_min(tmaxY, tmaxX));
+
+    return lane_hit_mask(t0, t1);
+}
+
+inline PacketRecurseInfo prep_packet_entry(const VoxelRef & voxelRef, const AABB_MinMax & aabb, u32 laneMask, const PacketRays & rays)
+{
+    PacketRecurseInfo entry;
+    entry.voxelRef = voxelRef;
+    entry.aabb = aabb;
+    entry.searchIndex = 0;
+
+    // slab test all 8 children once for the whole packet
+    for (u32 i = 0; i < 8; ++i)
+    {
+        entry.childMasks[i] = (u8)(packet_test_box(rays, voxel_subspace(aabb, (SubVoxel)i)) & laneMask);
+    }
+
+    return entry;
+}
+
+// Fill in hit details for one lane the same way test_ray_voxel does
+static void finish_lane_hit(VoxelRayHit * pHit,
+                            const VoxelRef & voxelRef,
+                            const AABB_MinMax & aabb,
+                            const vec3 & rayPosLoc,
+                            const vec3 & rayDirLoc)
+{
+    vec3 invRayDirLoc = 1.0f / rayDirLoc;
+    f32 exitDist;
+    test_ray_box(&pHit->face, &pHit->zDepth, &exitDist, rayPosLoc, invRayDirLoc, aabb);
+
+    vec3 hitPosLoc = rayPosLoc + rayDirLoc * pHit->zDepth;
+
+    pHit->voxelRef = voxelRef;
+    pHit->normal = kNormals[(u32)pHit->face];
+    pHit->faceUv = calc_face_uv(pHit->face, hitPosLoc, aabb);
+    pHit->hit = true;
+}
+
+inline u32 ray_octant(const vec3 & rayDir)
+{
+    // matches SubVoxel bits, x is most significant
+    return ((u32)(rayDir.x < 0.0f) << 2) | ((u32)(rayDir.y < 0.0f) << 1) | (u32)(rayDir.z < 0.0f);
+}
+
+static u32 test_ray_voxel_scalar(VoxelRayHit * pHits, const VoxelWorld & voxelWorld, const vec3 * pRayPos, const vec3 * pRayDir, u32 rayCount, const VoxelRoot & root, u32 maxDepth)
+{
+    u32 hitMask = 0;
+    for (u32 i = 0; i < rayCount; ++i)
+    {
+        VoxelRayHit & hit = pHits[i];
+        hit.hit = test_ray_voxel(&hit.voxelRef, &hit.normal, &hit.zDepth, &hit.face, &hit.faceUv, voxelWorld, pRayPos[i], pRayDir[i], root, maxDepth);
+        hitMask |= (u32)hit.hit << i;
+    }
+    return hitMask;
+}
+
+u32 test_ray_voxel_packet(VoxelRayHit * pHits, const VoxelWorld & voxelWorld, const vec3 * pRayPos, const vec3 * pRayDir, u32 rayCount, const VoxelRoot & root, u32 maxDepth)
+{
+    ASSERT(rayCount > 0 && rayCount <= kRayPacketSize);
+
+    // put rays into root's space, see test_ray_voxel
+    mat3 rotInv = transpose(root.rot);
+
+    vec3 rayPosLoc[kRayPacketSize];
+    vec3 rayDirLoc[kRayPacketSize];
+    f32 soa[6][kRayPacketSize];
+    for (u32 i = 0; i < kRayPacketSize; ++i)
+    {
+        // pad partial packets with the first ray, padding lanes are masked off
+        u32 r = i < rayCount ? i : 0;
+        rayPosLoc[i] = pRayPos[r] - root.pos;
+        rayDirLoc[i] = rotInv * pRayDir[r];
+        vec3 invRayDirLoc = 1.0f / rayDirLoc[i];
+
+        soa[0][i] = rayPosLoc[i].x;
+        soa[1][i] = rayPosLoc[i].y;
+        soa[2][i] = rayPosLoc[i].z;
+        soa[3][i] = invRayDirLoc.x;
+        soa[4][i] = invRayDirLoc.y;
+        soa[5][i] = invRayDirLoc.z;
+    }
+
+    for (u32 i = 0; i < rayCount; ++i)
+        pHits[i].hit = false;
+
+    u32 octant = ray_octant(rayDirLoc[0]);
+    for (u32 i = 1; i < rayCount; ++i)
+    {
+        // Incoherent packet, no single child order works for all rays
+        if (ray_octant(rayDirLoc[i]) != octant)
+            return test_ray_voxel_scalar(pHits, voxelWorld, pRayPos, pRayDir, rayCount, root, maxDepth);
+    }
+
+    PacketRays rays;
+    rays.posX = lane_load(soa[0]);
+    rays.posY = lane_load(soa[1]);
+    rays.posZ = lane_load(soa[2]);
+    rays.invDirX = lane_load(soa[3]);
+    rays.invDirY = lane_load(soa[4]);
+    rays.invDirZ = lane_load(soa[5]);
+
+    const u32 activeMask = (1u << rayCount) - 1;
+    AABB_MinMax rootAabb(root.rad);
+
+    u32 rootMask = packet_test_box(rays, rootAabb) & activeMask;
+    if (rootMask == 0 || root.children.isTerminalEmpty())
+        return 0;
+
+    u32 doneMask = 0;
+
+    if (root.children.isTerminalFull())
+    {
+        for (u32 i = 0; i < rayCount; ++i)
+        {
+            if (rootMask & (1 << i))
+                finish_lane_hit(&pHits[i], root.children, rootAabb, rayPosLoc[i], rayDirLoc[i]);
+        }
+        return rootMask;
+    }
+
+    PacketRecurseInfo stack[kMaxDepth];
+    u32 d = 0;
+    stack[d] = prep_packet_entry(root.children, rootAabb, rootMask, rays);
+
+    // Every ray in the packet shares the octant, so visiting children
+    // in index order flipped by the octant is front to back for all of
+    // them and the first full voxel a lane reaches is its nearest.
+    for (;;)
+    {
+        PacketRecurseInfo & entry = stack[d];
+
+        if (entry.searchIndex >= 8)
+        {
+            if (d == 0)
+                break;
+            d--;
+            continue;
+        }
+
+        u32 childIdx = entry.searchIndex++ ^ octant;
+        u32 laneMask = entry.childMasks[childIdx] & ~doneMask;
+        if (laneMask == 0)
+            continue;
+
+        const Voxel & voxel = voxelWorld.voxel(entry.voxelRef.imageIdx, entry.voxelRef.voxelIdx);
+        const VoxelRef & childRef = voxel.children[childIdx];
+
+        if (childRef.isTerminalEmpty())
+            continue;
+
+        AABB_MinMax childAabb = voxel_subspace(entry.aabb, (SubVoxel)childIdx);
+
+        if (childRef.isTerminalFull())
+        {
+            for (u32 i = 0; i < rayCount; ++i)
+            {
+                if (laneMask & (1 << i))
+                    finish_lane_hit(&pHits[i], childRef, childAabb, rayPosLoc[i], rayDirLoc[i]);
+            }
+            doneMask |= laneMask;
+            if (doneMask == rootMask)
+                break;
+        }
+        else
+        {
+            d++;
+            ASSERT(d < kMaxDepth);
+            stack[d] = prep_packet_entry(childRef, childAabb, laneMask, rays);
+        }
+    }
+
+    return doneMask;
+}
+
+u32 test_rays_voxel(VoxelRayHit * pHits, const VoxelWorld & voxelWorld, const vec3 * pRayPos, const vec3 * pRayDir, u32 rayCount, const VoxelRoot & root, u32 maxDepth)
+{
+    u32 hitCount = 0;
+    for (u32 i = 0; i < rayCount; i += kRayPacketSize)
+    {
+        u32 count = rayCount - i < kRayPacketSize ? rayCount - i : kRayPacketSize;
+        u32 hitMask = test_ray_voxel_packet(pHits + i, voxelWorld, pRayPos + i, pRayDir + i, count, root, maxDepth);
+        for (; hitMask; hitMask &= hitMask - 1)
+            hitCount++;
+    }
+    return hitCount;
+}
+
+
 } // namespace gaen
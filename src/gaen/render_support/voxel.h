@@ -29,6 +29,8 @@
 
 #include "gaen/core/base_defines.h"
 #include "gaen/core/mem.h"
+#include "gaen/core/platutils.h"
+#include "gaen/core/parallel_for.h"
 #include "gaen/core/Vector.h"
 
 #include "gaen/math/vec2.h"
@@ -236,11 +238,17 @@ public:
         return &mVoxelRoots;
     }
 
-    u32 voxelRootCount()
+    u32 voxelRootCount() const
     {
         return mVoxelRootCount;
     }
 
+    const VoxelRoot & voxelRoot(u32 rootIdx) const
+    {
+        ASSERT(rootIdx < mVoxelRootCount);
+        return reinterpret_cast<const VoxelRoot*>(mVoxelRoots.buffer())[rootIdx];
+    }
+
     void imageCoords(u16 * pX, u16 * pY, u32 voxelIdx, SubVoxel subVoxel) const
     {
         u32 pixOffset = voxelIdx * kPixelsPerVoxel;
@@ -266,6 +274,17 @@ public:
         return *ret;
     }
 
+    // All 8 children of a voxel in one read. Images are kImageSize
+    // wide so voxelIdx maps directly onto the pixel buffer, no need
+    // for imageCoords' divide and modulo.
+    const Voxel & voxel(u32 imageIdx, u32 voxelIdx) const
+    {
+        ASSERT(imageIdx < mImages.size());
+        ASSERT(voxelIdx < kMaxVoxelIndex);
+
+        return reinterpret_cast<const Voxel*>(mImages[imageIdx].buffer())[voxelIdx];
+    }
+
     void setVoxelRef(u32 imageIdx, u32 voxelIdx, SubVoxel subVoxel, const VoxelRef & voxel)
     {
         ASSERT(imageIdx < mImages.size());
@@ -278,6 +297,14 @@ public:
         mImages[imageIdx].imageStore2d(x, y, pix);
     }
 
+    void setVoxel(u32 imageIdx, u32 voxelIdx, const Voxel & voxel)
+    {
+        ASSERT(imageIdx < mImages.size());
+        ASSERT(voxelIdx < kMaxVoxelIndex);
+
+        reinterpret_cast<Voxel*>(mImages[imageIdx].buffer())[voxelIdx] = voxel;
+    }
+
     void addVoxelRoot(const VoxelRoot & voxelRoot);
 
 private:
@@ -381,6 +408,211 @@ vec3 voxel_neighbor_offset(VoxelNeighbor vn);
 
 #pragma pack(pop)
 
+// Parallel shape construction. The top levels of the octree are split
+// into independent subtrees which worker threads build into their own
+// node buffers. A prefix sum over subtree sizes then gives each one its
+// final offset in the image and the buffers are relocated into place in
+// parallel. Nodes land at exactly the indices set_shape_recursive would
+// give them, so the two are interchangeable.
+//
+// HitTestType::operator() is called concurrently and must not modify
+// shared state.
+typedef Vector<kMEM_Voxel, Voxel> VoxelNodeBuffer;
+
+struct VoxelSubtreeJob
+{
+    AABB_MinMax aabb;
+    VoxelNodeBuffer nodes;
+    VoxelRef ref;
+    u32 base = 0;
+};
+typedef Vector<kMEM_Voxel, VoxelSubtreeJob> VoxelSubtreeJobs;
+
+// Same post order as set_shape_recursive, but into a local buffer with
+// voxelIdx relative to its start.
+template <class HitTestType>
+static VoxelRef set_shape_local(VoxelNodeBuffer & nodes, u32 imageIdx, u32 depth, const AABB_MinMax & aabb, const HitTestType & hitTest)
+{
+    if (depth == 0)
+        return hitTest(aabb) ? VoxelRef::terminal_full(1) : VoxelRef::terminal_empty();
+
+    Voxel voxel;
+    for (u32 i = 0; i < 8; ++i)
+    {
+        AABB_MinMax subAabb = voxel_subspace(aabb, (SubVoxel)i);
+        voxel.children[i] = hitTest(subAabb) ? set_shape_local(nodes, imageIdx, depth-1, subAabb, hitTest) : VoxelRef::terminal_empty();
+    }
+
+    VoxelRef ret = VoxelRef(kVT_NonTerminal, 1, imageIdx, static_cast<u32>(nodes.size()));
+    nodes.push_back(voxel);
+    return ret;
+}
+
+template <class HitTestType>
+static void collect_shape_subtrees(VoxelSubtreeJobs & jobs, u32 level, const AABB_MinMax & aabb, const HitTestType & hitTest)
+{
+    for (u32 i = 0; i < 8; ++i)
+    {
+        AABB_MinMax subAabb = voxel_subspace(aabb, (SubVoxel)i);
+        if (hitTest(subAabb))
+        {
+            if (level == 1)
+            {
+                jobs.emplace_back();
+                jobs.back().aabb = subAabb;
+            }
+            else
+                collect_shape_subtrees(jobs, level-1, subAabb, hitTest);
+        }
+    }
+}
+
+// Serial pass over the top levels, assigning subtree bases and writing
+// the top nodes themselves in set_shape_recursive order.
+template <class HitTestType>
+static VoxelRef place_shape_subtrees(VoxelWorld & voxelWorld, u32 imageIdx, u32 & voxelIdx, VoxelSubtreeJob *& pJob, u32 level, const AABB_MinMax & aabb, const HitTestType & hitTest)
+{
+    Voxel voxel;
+    for (u32 i = 0; i < 8; ++i)
+    {
+        AABB_MinMax subAabb = voxel_subspace(aabb, (SubVoxel)i);
+        if (!hitTest(subAabb))
+            voxel.children[i] = VoxelRef::terminal_empty();
+        else if (level == 1)
+        {
+            VoxelSubtreeJob & job = *pJob++;
+            job.base = voxelIdx;
+            voxelIdx += static_cast<u32>(job.nodes.size());
+            voxel.children[i] = job.ref;
+            voxel.children[i].voxelIdx += job.base;
+        }
+        else
+            voxel.children[i] = place_shape_subtrees(voxelWorld, imageIdx, voxelIdx, pJob, level-1, subAabb, hitTest);
+    }
+
+    voxelWorld.setVoxel(imageIdx, voxelIdx, voxel);
+    VoxelRef ret = VoxelRef(kVT_NonTerminal, 1, imageIdx, voxelIdx);
+    voxelIdx++;
+    return ret;
+}
+
+template <class HitTestType>
+struct VoxelBuildContext
+{
+    VoxelWorld * pVoxelWorld;
+    u32 imageIdx;
+    u32 depth;
+    const HitTestType * pHitTest;
+    VoxelSubtreeJob * pJobs;
+
+    static void build(const void * pContext, u32 jobIdx)
+    {
+        const VoxelBuildContext & ctx = *static_cast<const VoxelBuildContext*>(pContext);
+        VoxelSubtreeJob & job = ctx.pJobs[jobIdx];
+        job.ref = set_shape_local(job.nodes, ctx.imageIdx, ctx.depth, job.aabb, *ctx.pHitTest);
+    }
+
+    static void relocate(const void * pContext, u32 jobIdx)
+    {
+        const VoxelBuildContext & ctx = *static_cast<const VoxelBuildContext*>(pContext);
+        VoxelSubtreeJob & job = ctx.pJobs[jobIdx];
+        for (u32 n = 0; n < job.nodes.size(); ++n)
+        {
+            Voxel & voxel = job.nodes[n];
+            for (VoxelRef & child : voxel.children)
+            {
+                if (child.type == kVT_NonTerminal)
+                    child.voxelIdx += job.base;
+            }
+            ctx.pVoxelWorld->setVoxel(ctx.imageIdx, job.base + n, voxel);
+        }
+        VoxelNodeBuffer().swap(job.nodes);
+    }
+};
+
+template <class HitTestType>
+static VoxelRef set_shape_parallel(VoxelWorld & voxelWorld, u32 imageIdx, u32 & voxelIdx, u32 depth, const AABB_MinMax & aabb, const HitTestType & hitTest, u32 threadCount = 0)
+{
+    if (threadCount == 0)
+        threadCount = platform_core_count();
+
+    // nothing to gain from the extra copy on a single thread
+    if (depth < 2 || threadCount == 1)
+        return set_shape_recursive(voxelWorld, imageIdx, voxelIdx, depth, aabb, hitTest);
+
+    // Split deep enough that there are plenty of subtrees per thread
+    // for load balancing, but leave each subtree at least one level.
+    u32 splitLevel = 1;
+    while (splitLevel + 1 < depth && (1u << (3 * splitLevel)) < threadCount * 8)
+        splitLevel++;
+
+    VoxelSubtreeJobs jobs;
+    collect_shape_subtrees(jobs, splitLevel, aabb, hitTest);
+
+    VoxelBuildContext<HitTestType> ctx{&voxelWorld, imageIdx, depth - splitLevel, &hitTest, jobs.data()};
+    parallel_for(static_cast<u32>(jobs.size()), threadCount, &VoxelBuildContext<HitTestType>::build, &ctx);
+
+    VoxelSubtreeJob * pJob = jobs.data();
+    VoxelRef ret = place_shape_subtrees(voxelWorld, imageIdx, voxelIdx, pJob, splitLevel, aabb, hitTest);
+    ASSERT(pJob == jobs.data() + jobs.size());
+
+    parallel_for(static_cast<u32>(jobs.size()), threadCount, &VoxelBuildContext<HitTestType>::relocate, &ctx);
+
+    return ret;
+}
+
+template <class HitTestType>
+static VoxelRoot set_shape_generic_parallel(VoxelWorld & voxelWorld, u32 imageIdx, u32 voxelIdx, u32 depth, const vec3 & pos, f32 rad, const mat3 & rot, HitTestType hitTest, u32 threadCount = 0)
+{
+    VoxelRoot voxelRoot;
+    voxelRoot.pos = pos;
+    voxelRoot.rad = rad;
+    voxelRoot.rot = rot;
+    voxelRoot.children = set_shape_parallel(voxelWorld, imageIdx, voxelIdx, depth, AABB_MinMax(rad), hitTest, threadCount);
+
+    voxelWorld.addVoxelRoot(voxelRoot);
+
+    return voxelRoot;
+}
+
+// Ray packets, SIMD traversal of several coherent rays at once. The
+// build doesn't enable AVX2, so unless a toolchain targets it packets
+// are 4 wide SSE2.
+#if defined(__AVX2__)
+#define VOXEL_PACKET_AVX2 HAS_X
+#define VOXEL_PACKET_SSE  HAS_X
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define VOXEL_PACKET_AVX2 HAS__
+#define VOXEL_PACKET_SSE  HAS_X
+#else
+#define VOXEL_PACKET_AVX2 HAS__
+#define VOXEL_PACKET_SSE  HAS__
+#endif
+
+#if HAS(VOXEL_PACKET_AVX2)
+static const u32 kRayPacketSize = 8;
+#else
+static const u32 kRayPacketSize = 4;
+#endif
+
+struct VoxelRayHit
+{
+    VoxelRef voxelRef;
+    vec3 normal;
+    f32 zDepth;
+    VoxelFace face;
+    vec2 faceUv;
+    bool hit;
+};
+
+// Trace up to kRayPacketSize rays together, returns a bit mask of rays
+// that hit. Rays whose directions share a sign octant are traversed as
+// one packet front to back, others fall back to test_ray_voxel.
+u32 test_ray_voxel_packet(VoxelRayHit * pHits, const VoxelWorld & voxelWorld, const vec3 * pRayPos, const vec3 * pRayDir, u32 rayCount, const VoxelRoot & root, u32 maxDepth);
+
+// Trace any number of rays, e.g. batched line of sight queries,
+// kRayPacketSize at a time. Returns number of hits.
+u32 test_rays_voxel(VoxelRayHit * pHits, const VoxelWorld & voxelWorld, const vec3 * pRayPos, const vec3 * pRayDir, u32 rayCount, const VoxelRoot & root, u32 maxDepth);
 
 } // namespace gaen
 
@@ -0,0 +1,136 @@
+//------------------------------------------------------------------------------
+// voxel_dag.cpp - Sparse voxel DAG, shares storage between identical subtrees
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include "gaen/render_support/stdafx.h"
+
+#include "gaen/core/HashSet.h"
+
+#include "gaen/render_support/voxel_dag.h"
+
+namespace gaen
+{
+
+size_t VoxelHash::operator()(const Voxel & voxel) const
+{
+    return fnv1a_32(reinterpret_cast<const u8*>(&voxel), sizeof(Voxel));
+}
+
+VoxelDag::VoxelDag(VoxelWorld & voxelWorld, u32 imageIdx, u32 voxelIdx)
+  : mVoxelWorld(voxelWorld)
+  , mImageIdx(imageIdx)
+  , mVoxelIdx(voxelIdx)
+{}
+
+VoxelRef VoxelDag::intern(const Voxel & voxel, u16 material)
+{
+    mInternCount++;
+
+    auto it = mNodes.find(voxel);
+    if (it != mNodes.end())
+    {
+        VoxelRef ref = it->second;
+        ref.material = material;
+        return ref;
+    }
+
+    PANIC_IF(mVoxelIdx >= VoxelWorld::kMaxVoxelIndex, "Voxel image %u is full", mImageIdx);
+
+    mVoxelWorld.setVoxel(mImageIdx, mVoxelIdx, voxel);
+    VoxelRef ref(kVT_NonTerminal, material, mImageIdx, mVoxelIdx);
+    mVoxelIdx++;
+
+    mNodes.emplace(voxel, ref);
+    return ref;
+}
+
+static u32 voxel_node_key(const VoxelRef & voxelRef)
+{
+    return ((u32)voxelRef.imageIdx << 23) | (u32)voxelRef.voxelIdx;
+}
+
+typedef HashMap<kMEM_Voxel, u32, VoxelRef> VoxelRefMap;
+
+static VoxelRef compact_voxel_tree(VoxelDag & dag, const VoxelWorld & srcWorld, const VoxelRef & voxelRef, VoxelRefMap & compacted)
+{
+    if (voxelRef.type != kVT_NonTerminal)
+        return voxelRef;
+
+    u32 key = voxel_node_key(voxelRef);
+    auto it = compacted.find(key);
+    if (it != compacted.end())
+        return it->second;
+
+    const Voxel & src = srcWorld.voxel(voxelRef.imageIdx, voxelRef.voxelIdx);
+    Voxel voxel;
+    for (u32 i = 0; i < 8; ++i)
+    {
+        voxel.children[i] = compact_voxel_tree(dag, srcWorld, src.children[i], compacted);
+    }
+
+    VoxelRef ref = dag.intern(voxel, (u16)voxelRef.material);
+    ref.filledNeighbors = voxelRef.filledNeighbors;
+    compacted.emplace(key, ref);
+    return ref;
+}
+
+VoxelRef compact_voxel_tree(VoxelDag & dag, const VoxelWorld & srcWorld, const VoxelRef & voxelRef)
+{
+    VoxelRefMap compacted;
+    return compact_voxel_tree(dag, srcWorld, voxelRef, compacted);
+}
+
+void compact_voxel_world(VoxelDag & dag, const VoxelWorld & srcWorld)
+{
+    // one map across roots so nodes shared between roots stay shared
+    VoxelRefMap compacted;
+    for (u32 i = 0; i < srcWorld.voxelRootCount(); ++i)
+    {
+        VoxelRoot root = srcWorld.voxelRoot(i);
+        root.children = compact_voxel_tree(dag, srcWorld, root.children, compacted);
+        dag.voxelWorld().addVoxelRoot(root);
+    }
+}
+
+static void voxel_node_count(HashSet<kMEM_Voxel, u32> & visited, const VoxelWorld & voxelWorld, const VoxelRef & voxelRef)
+{
+    if (voxelRef.type != kVT_NonTerminal || !visited.insert(voxel_node_key(voxelRef)).second)
+        return;
+
+    const Voxel & voxel = voxelWorld.voxel(voxelRef.imageIdx, voxelRef.voxelIdx);
+    for (u32 i = 0; i < 8; ++i)
+    {
+        voxel_node_count(visited, voxelWorld, voxel.children[i]);
+    }
+}
+
+u32 voxel_node_count(const VoxelWorld & voxelWorld, const VoxelRef & voxelRef)
+{
+    HashSet<kMEM_Voxel, u32> visited;
+    voxel_node_count(visited, voxelWorld, voxelRef);
+    return (u32)visited.size();
+}
+
+} // namespace gaen
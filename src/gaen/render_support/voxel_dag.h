@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+// voxel_dag.h - Sparse voxel DAG, shares storage between identical subtrees
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#ifndef GAEN_RENDER_SUPPORT_VOXEL_DAG_H
+#define GAEN_RENDER_SUPPORT_VOXEL_DAG_H
+
+#include <cstring>
+
+#include "gaen/core/HashMap.h"
+#include "gaen/render_support/voxel.h"
+
+namespace gaen
+{
+
+struct VoxelHash
+{
+    size_t operator()(const Voxel & voxel) const;
+};
+
+struct VoxelEqual
+{
+    bool operator()(const Voxel & lhs, const Voxel & rhs) const
+    {
+        return memcmp(&lhs, &rhs, sizeof(Voxel)) == 0;
+    }
+};
+
+// Hash conses voxel nodes as they are written. Subtrees are built
+// bottom up, so identical subtrees produce identical child refs and
+// collapse to a single node, e.g. the solid interior of a sphere.
+//
+// The result is still just VoxelRefs into VoxelWorld images, so
+// test_ray_voxel and the shaders traverse it unchanged.
+class VoxelDag
+{
+public:
+    VoxelDag(VoxelWorld & voxelWorld, u32 imageIdx, u32 voxelIdx);
+
+    // Returns a ref to an existing node with identical children, or
+    // writes a new one. Material lives in the ref rather than the node,
+    // so the ref always carries the material passed here and nodes are
+    // shared across materials.
+    VoxelRef intern(const Voxel & voxel, u16 material);
+
+    VoxelWorld & voxelWorld() { return mVoxelWorld; }
+
+    // Next free voxel index in the image
+    u32 voxelIdx() const { return mVoxelIdx; }
+
+    // Nodes written vs. nodes requested
+    u32 nodeCount() const { return (u32)mNodes.size(); }
+    u32 internCount() const { return mInternCount; }
+
+private:
+    VoxelWorld & mVoxelWorld;
+    u32 mImageIdx;
+    u32 mVoxelIdx;
+    u32 mInternCount = 0;
+
+    HashMap<kMEM_Voxel, Voxel, VoxelRef, VoxelHash, VoxelEqual> mNodes;
+};
+
+// DAG equivalent of set_shape_recursive
+template <class HitTestType>
+static VoxelRef set_shape_dag_recursive(VoxelDag & dag, u32 depth, const AABB_MinMax & aabb, HitTestType hitTest)
+{
+    if (depth == 0)
+    {
+        if (hitTest(aabb))
+            return VoxelRef::terminal_full(1);
+        else
+            return VoxelRef::terminal_empty();
+    }
+
+    Voxel voxel;
+    for (u32 i = 0; i < 8; ++i)
+    {
+        AABB_MinMax subAabb = voxel_subspace(aabb, (SubVoxel)i);
+        voxel.children[i] = hitTest(subAabb) ? set_shape_dag_recursive(dag, depth-1, subAabb, hitTest) : VoxelRef::terminal_empty();
+    }
+
+    return dag.intern(voxel, 1);
+}
+
+// DAG equivalent of set_shape_generic
+template <class HitTestType>
+static VoxelRoot set_shape_dag(VoxelDag & dag, u32 depth, const vec3 & pos, f32 rad, const mat3 & rot, HitTestType hitTest)
+{
+    VoxelRoot voxelRoot;
+    voxelRoot.pos = pos;
+    voxelRoot.rad = rad;
+    voxelRoot.rot = rot;
+    voxelRoot.children = set_shape_dag_recursive(dag, depth, AABB_MinMax(rad), hitTest);
+
+    dag.voxelWorld().addVoxelRoot(voxelRoot);
+
+    return voxelRoot;
+}
+
+// Copy the subtree at voxelRef in srcWorld into dag, returns the
+// compacted ref. Shared source nodes are only visited once.
+VoxelRef compact_voxel_tree(VoxelDag & dag, const VoxelWorld & srcWorld, const VoxelRef & voxelRef);
+
+// Compacts every root of srcWorld into dag's world
+void compact_voxel_world(VoxelDag & dag, const VoxelWorld & srcWorld);
+
+// Distinct non terminal nodes reachable from voxelRef
+u32 voxel_node_count(const VoxelWorld & voxelWorld, const VoxelRef & voxelRef);
+
+} // namespace gaen
+
+#endif // #ifndef GAEN_RENDER_SUPPORT_VOXEL_DAG_H
@@ -120,7 +120,8 @@ ComputeShaderSimulator::~ComputeShaderSimulator()
 }
 
 void ComputeShaderSimulator::init(uvec3 workGroupSize,
-                                  uvec3 numWorkGroups)
+                                  uvec3 numWorkGroups,
+                                  u32 threadCount)
 {
     static const u32 kFrameBufferSize = 512;
     ASSERT(workGroupSize.x * numWorkGroups.x <= kFrameBufferSize);
@@ -137,6 +138,8 @@ void ComputeShaderSimulator::init(uvec3 workGroupSize,
 
     gl_WorkGroupSize = workGroupSize;
     gl_NumWorkGroups = numWorkGroups;
+
+    mTileRenderer.init(threadCount);
 }
 
 void ComputeShaderSimulator::render(const RaycastCamera & camera, const List<kMEM_Renderer, Light> & lights)
@@ -146,57 +149,56 @@ void ComputeShaderSimulator::render(const RaycastCamera & camera, const List<kME
     un_CameraDir = camera.direction();
     un_CameraProjectionInv = camera.projectionInv();
 
-    for (gl_WorkGroupID.z = 0; gl_WorkGroupID.z < gl_NumWorkGroups.z; ++gl_WorkGroupID.z)
+    mTileRenderer.render(gl_NumWorkGroups.x, gl_NumWorkGroups.y, [this](u32 tileX, u32 tileY)
+    {
+        for (u32 z = 0; z < gl_NumWorkGroups.z; ++z)
+        {
+            renderWorkGroup(uvec3(tileX, tileY, z));
+        }
+    });
+}
+
+void ComputeShaderSimulator::renderWorkGroup(const uvec3 & workGroupID) const
+{
+    Invocation inv;
+    inv.gl_WorkGroupID = workGroupID;
+
+    for (inv.gl_LocalInvocationID.z = 0; inv.gl_LocalInvocationID.z < gl_WorkGroupSize.z; ++inv.gl_LocalInvocationID.z)
     {
-        for (gl_WorkGroupID.y = 0; gl_WorkGroupID.y < gl_NumWorkGroups.y; ++gl_WorkGroupID.y)
+        for (inv.gl_LocalInvocationID.y = 0; inv.gl_LocalInvocationID.y < gl_WorkGroupSize.y; ++inv.gl_LocalInvocationID.y)
         {
-            for (gl_WorkGroupID.x = 0; gl_WorkGroupID.x < gl_NumWorkGroups.x; ++gl_WorkGroupID.x)
+            for (inv.gl_LocalInvocationID.x = 0; inv.gl_LocalInvocationID.x < gl_WorkGroupSize.x; ++inv.gl_LocalInvocationID.x)
             {
-                for (gl_LocalInvocationID.z = 0; gl_LocalInvocationID.z < gl_WorkGroupSize.z; ++gl_LocalInvocationID.z)
-                {
-                    for (gl_LocalInvocationID.y = 0; gl_LocalInvocationID.y < gl_WorkGroupSize.y; ++gl_LocalInvocationID.y)
-                    {
-                        for (gl_LocalInvocationID.x = 0; gl_LocalInvocationID.x < gl_WorkGroupSize.x; ++gl_LocalInvocationID.x)
-                        {
-                            gl_GlobalInvocationID = gl_WorkGroupID * gl_WorkGroupSize + gl_LocalInvocationID;
-                            gl_LocalInvocationIndex = (gl_LocalInvocationID.z * gl_WorkGroupSize.x * gl_WorkGroupSize.y +
-                                                       gl_LocalInvocationID.y * gl_WorkGroupSize.x + gl_LocalInvocationID.x);
-
-                            
-
-//                            LOG_INFO("%2u, %2u   %2u, %2u", gl_WorkGroupID.y, gl_WorkGroupID.x, gl_LocalInvocationID.y, gl_LocalInvocationID.x);
-//                            LOG_INFO("%u, %u     %u, %u", gl_GlobalInvocationID.y, gl_GlobalInvocationID.x, gl_LocalInvocationID.y, gl_LocalInvocationID.x);
-//                            LOG_INFO("%u, %u", gl_GlobalInvocationID.y, gl_GlobalInvocationID.x);
-
-                            compShader_Raycast_gpu();
-                        }
-                    }
-                }
+                inv.gl_GlobalInvocationID = inv.gl_WorkGroupID * gl_WorkGroupSize + inv.gl_LocalInvocationID;
+                inv.gl_LocalInvocationIndex = (inv.gl_LocalInvocationID.z * gl_WorkGroupSize.x * gl_WorkGroupSize.y +
+                                               inv.gl_LocalInvocationID.y * gl_WorkGroupSize.x + inv.gl_LocalInvocationID.x);
+
+                compShader_Raycast_gpu(inv);
             }
         }
     }
 }
 
-void ComputeShaderSimulator::compShader_Test()
+void ComputeShaderSimulator::compShader_Test(const Invocation & inv) const
 {
-    f32 rCol = (f32)gl_LocalInvocationID.x / (f32)gl_WorkGroupSize.x;
-    f32 gCol = (f32)gl_LocalInvocationID.y / (f32)gl_WorkGroupSize.y;
+    f32 rCol = (f32)inv.gl_LocalInvocationID.x / (f32)gl_WorkGroupSize.x;
+    f32 gCol = (f32)inv.gl_LocalInvocationID.y / (f32)gl_WorkGroupSize.y;
 
-    un_FrameBuffer->imageStore2d(gl_GlobalInvocationID.x,
-                                 gl_GlobalInvocationID.y,
-                                 RGB8((f32)gl_LocalInvocationID.x / (f32)gl_WorkGroupSize.x,
-                                      (f32)gl_LocalInvocationID.y / (f32)gl_WorkGroupSize.y,
+    un_FrameBuffer->imageStore2d(inv.gl_GlobalInvocationID.x,
+                                 inv.gl_GlobalInvocationID.y,
+                                 RGB8((f32)inv.gl_LocalInvocationID.x / (f32)gl_WorkGroupSize.x,
+                                      (f32)inv.gl_LocalInvocationID.y / (f32)gl_WorkGroupSize.y,
                                       0.0f));
 }
 
-void ComputeShaderSimulator::compShader_Raycast_gpu()
+void ComputeShaderSimulator::compShader_Raycast_gpu(const Invocation & inv) const
 {
     // LORRTODO: Consider moving to uniform
     vec2 windowSize((f32)(gl_WorkGroupSize.x * gl_NumWorkGroups.x),
                          (f32)(gl_WorkGroupSize.y * gl_NumWorkGroups.y));
 
-    vec4 rayScreenPos(2.0f * gl_GlobalInvocationID.x / windowSize.x - 1.0f,
-                           2.0f * gl_GlobalInvocationID.y / windowSize.y - 1.0f,
+    vec4 rayScreenPos(2.0f * inv.gl_GlobalInvocationID.x / windowSize.x - 1.0f,
+                           2.0f * inv.gl_GlobalInvocationID.y / windowSize.y - 1.0f,
                            0.0f,
                            1.0f);
 
@@ -207,8 +209,8 @@ void ComputeShaderSimulator::compShader_Raycast_gpu()
 
     vec3 rayDirCol = (vec3(rayScreenPos) + vec3(1.0f, 1.0f, 1.0f)) / vec3(2.0f, 2.0f, 2.0f);
 
-    un_FrameBuffer->imageStore2d(gl_GlobalInvocationID.x,
-                                 gl_GlobalInvocationID.y,
+    un_FrameBuffer->imageStore2d(inv.gl_GlobalInvocationID.x,
+                                 inv.gl_GlobalInvocationID.y,
                                  RGB8(rayDirCol.x, rayDirCol.y, rayDirCol.z));
 
     for (u32 rootId = 0; rootId < un_VoxelRootCount; ++rootId)
@@ -273,7 +275,6 @@ void ComputeShaderSimulator::compShader_Raycast_gpu()
 
 FragmentShaderSimulator::FragmentShaderSimulator()
   : mpRaycastCamera(nullptr)
-  , color((u8)0, (u8)0, (u8)0)
 {
     mIsInit = false;
     mFrameBuffer = nullptr;
@@ -367,7 +368,7 @@ static void set_shape_full(VoxelWorld & voxelWorld)
 
 
 
-void FragmentShaderSimulator::init(u32 outputImageSize, RaycastCamera * pRaycastCamera)
+void FragmentShaderSimulator::init(u32 outputImageSize, RaycastCamera * pRaycastCamera, u32 threadCount)
 {
     mFrameBuffer = GNEW(kMEM_Engine, ImageBuffer, outputImageSize, sizeof(RGB8));
     mDepthBuffer = GNEW(kMEM_Engine, ImageBuffer, outputImageSize, sizeof(R32F));
@@ -391,6 +392,9 @@ void FragmentShaderSimulator::init(u32 outputImageSize, RaycastCamera * pRaycast
 
     static const f32 kRad = 2.0f;
     voxelRoot = set_shape_generic(voxelWorld, 0, 0, 3, vec3(1.0f, 2.0f, -20.0f), kRad, mat3(1.0f), SphereHitTest(kRad));
+
+    mTileRenderer.init(threadCount);
+    mIsInit = true;
 }
 
 void FragmentShaderSimulator::render(const RaycastCamera & camera, const List<kMEM_Renderer, Light> & lights)
@@ -408,45 +412,71 @@ void FragmentShaderSimulator::render(const RaycastCamera & camera, const List<kM
 
     mDepthBuffer->copy(*mDepthBufferBlank);
 
-    RGB8 * pix = reinterpret_cast<RGB8*>(mFrameBuffer->buffer());
-    R32F * dpix = reinterpret_cast<R32F*>(mDepthBuffer->buffer());
+    u32 tileCount = (mFrameBuffer->size() + kTileSize - 1) / kTileSize;
+    mTileRenderer.render(tileCount, tileCount, [this](u32 tileX, u32 tileY)
+    {
+        renderTile(tileX, tileY);
+    });
+
+    uniform0++;
+}
+
+void FragmentShaderSimulator::renderTile(u32 tileX, u32 tileY)
+{
+    u32 size = mFrameBuffer->size();
+    u32 xStart = tileX * kTileSize;
+    u32 yStart = tileY * kTileSize;
+    u32 xEnd = xStart + kTileSize < size ? xStart + kTileSize : size;
+    u32 yEnd = yStart + kTileSize < size ? yStart + kTileSize : size;
 
+    RGB8 * pixels = reinterpret_cast<RGB8*>(mFrameBuffer->buffer());
+    R32F * depths = reinterpret_cast<R32F*>(mDepthBuffer->buffer());
+
+    ScreenCoords gl_FragCoord;
     gl_FragCoord.z = 0;
 
-    for (gl_FragCoord.y = 0; gl_FragCoord.y < mFrameBuffer->size(); ++gl_FragCoord.y)
+    for (gl_FragCoord.y = yStart; gl_FragCoord.y < yEnd; ++gl_FragCoord.y)
     {
-        for (gl_FragCoord.x = 0; gl_FragCoord.x < mFrameBuffer->size(); ++gl_FragCoord.x)
+        RGB8 * pix = pixels + gl_FragCoord.y * size + xStart;
+        R32F * dpix = depths + gl_FragCoord.y * size + xStart;
+
+        // Neighboring fragments in a row are coherent, trace them as
+        // one ray packet
+        for (gl_FragCoord.x = xStart; gl_FragCoord.x < xEnd; gl_FragCoord.x += kRayPacketSize)
         {
-            color.r = 0;
-            color.g = 0;
-            color.b = 0;
-            zDepth = -FLT_MAX;
+            u32 count = xEnd - gl_FragCoord.x < kRayPacketSize ? xEnd - gl_FragCoord.x : kRayPacketSize;
+
+            RGB8 colors[kRayPacketSize] = {};
+            f32 zDepths[kRayPacketSize];
+            for (u32 i = 0; i < count; ++i)
+                zDepths[i] = -FLT_MAX;
 
-            //fragShader_Blue();
-            fragShader_Raycast();
+            //fragShader_Blue(gl_FragCoord, colors[0], zDepths[0]);
+            //fragShader_Raycast(gl_FragCoord, colors[0], zDepths[0]);
+            fragShader_RaycastPacket(gl_FragCoord, count, colors, zDepths);
 
-            if (zDepth > dpix->r)
+            for (u32 i = 0; i < count; ++i)
             {
-                *pix = color;
-                dpix->r = zDepth;
+                if (zDepths[i] > dpix->r)
+                {
+                    *pix = colors[i];
+                    dpix->r = zDepths[i];
+                }
+                dpix++;
+                pix++;
             }
-            dpix++;
-            pix++;
         }
     }
-
-    uniform0++;
 }
 
-void FragmentShaderSimulator::fragShader_Blue()
+void FragmentShaderSimulator::fragShader_Blue(const ScreenCoords & gl_FragCoord, RGB8 & color, f32 & zDepth) const
 {
-    static u8 g = 0;
     color.r = 255;
     color.g = (u8)uniform0;
     color.b = 255;
 }
 
-void FragmentShaderSimulator::fragShader_Raycast()
+vec3 FragmentShaderSimulator::fragRayDir(const ScreenCoords & gl_FragCoord) const
 {
     vec4 rayScreenPos(2.0f * gl_FragCoord.x / windowSize.x - 1.0f,
                            2.0f * gl_FragCoord.y / windowSize.y - 1.0f,
@@ -455,21 +485,55 @@ void FragmentShaderSimulator::fragShader_Raycast()
 
     vec3 rayDirProj = vec3(normalize(projectionInv * rayScreenPos));
 
-    vec3 rayDir = mpRaycastCamera->direction() * rayDirProj;
+    return mpRaycastCamera->direction() * rayDirProj;
+}
+
+void FragmentShaderSimulator::fragShader_Raycast(const ScreenCoords & gl_FragCoord, RGB8 & color, f32 & zDepth) const
+{
+    vec3 rayDir = fragRayDir(gl_FragCoord);
     vec3 rayPos = cameraPos;
-    
-    VoxelRef voxelRef;
-    vec3 normal;
-    VoxelFace face;
-    vec2 faceUv;
-    u32 hit = (u32)test_ray_voxel(&voxelRef, &normal, &zDepth, &face, &faceUv, voxelWorld, rayPos, rayDir, voxelRoot, 16);
 
-    if (hit)
+    VoxelRayHit hit;
+    hit.hit = test_ray_voxel(&hit.voxelRef, &hit.normal, &hit.zDepth, &hit.face, &hit.faceUv, voxelWorld, rayPos, rayDir, voxelRoot, 16);
+
+    fragShader_ShadeHit(hit, color, zDepth);
+}
+
+void FragmentShaderSimulator::fragShader_RaycastPacket(const ScreenCoords & gl_FragCoord, u32 count, RGB8 * pColors, f32 * pZDepths) const
+{
+    // count fragments in a row starting at gl_FragCoord
+    vec3 rayPos[kRayPacketSize];
+    vec3 rayDir[kRayPacketSize];
+    ScreenCoords coords = gl_FragCoord;
+    for (u32 i = 0; i < count; ++i)
+    {
+        rayPos[i] = cameraPos;
+        rayDir[i] = fragRayDir(coords);
+        coords.x++;
+    }
+
+    VoxelRayHit hits[kRayPacketSize];
+    test_ray_voxel_packet(hits, voxelWorld, rayPos, rayDir, count, voxelRoot, 16);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        fragShader_ShadeHit(hits[i], pColors[i], pZDepths[i]);
+    }
+}
+
+void FragmentShaderSimulator::fragShader_ShadeHit(const VoxelRayHit & hit, RGB8 & color, f32 & zDepth) const
+{
+    const vec3 & normal = hit.normal;
+    VoxelFace face = hit.face;
+    const vec2 & faceUv = hit.faceUv;
+
+    if (hit.hit)
     {
         // LORRTEMP
         //LOG_INFO("HIT: pRi->searchOrder[pRi->searchIndex]: %d", pRi->searchOrder[pRi->searchIndex]);
         //LOG_INFO("normal: %f, %f, %f", normal.x, normal.y, normal.z);
 
+        zDepth = hit.zDepth;
         f32 intensity = max(dot(normal, lightDir), 0.0f);
 
         switch (face)
@@ -518,16 +582,6 @@ void FragmentShaderSimulator::fragShader_Raycast()
         zDepth = -(FLT_MAX * 0.90f);
     }
 
-/*
-    color.r = (u8)(abs(rayDir.x) * 512.0f);
-    color.g = (u8)(abs(rayDir.y) * 1024.0f);
-    color.b = (u8)(abs(rayDir.z) * 255.0f);
-    */
-//    color.r = (u8)((rayDir.x + 1.0f) * 127.5f);
-//    color.g = (u8)((rayDir.y + 1.0f) * 127.5f);
-
-//    color.r = (u8)(gl_FragCoord.x / windowSize.x * 255.0f);
-//    color.g = (u8)(gl_FragCoord.y / windowSize.y * 255.0f);
 }
 
 } // namespace gaen
@@ -37,6 +37,7 @@
 #include "gaen/core/List.h"
 #include "gaen/render_support/RaycastCamera.h"
 #include "gaen/render_support/render_objects.h"
+#include "gaen/render_support/TileRenderer.h"
 #include "gaen/render_support/voxel.h"
 
 namespace gaen
@@ -47,16 +48,34 @@ class ComputeShaderSimulator
 public:
     ~ComputeShaderSimulator();
 
+    // threadCount of 0 means one thread per core
     void init(uvec3 workGroupSize,
-              uvec3 numWorkGroups);
+              uvec3 numWorkGroups,
+              u32 threadCount = 0);
 
     const u8 * frameBuffer() { return un_FrameBuffer->buffer(); }
 
+    // Each work group column (all z for a given x,y) is a tile, tiles
+    // are spread across the TileRenderer's threads.
     void render(const RaycastCamera & camera, const List<kMEM_Renderer, Light> & lights);
 
 private:
-    void compShader_Test();
-    void compShader_Raycast_gpu();
+    // per invocation glsl variables
+    struct Invocation
+    {
+        uvec3 gl_LocalInvocationID;
+        uvec3 gl_WorkGroupID;
+
+        uvec3 gl_GlobalInvocationID;
+        u32 gl_LocalInvocationIndex;
+    };
+
+    void renderWorkGroup(const uvec3 & workGroupID) const;
+
+    void compShader_Test(const Invocation & inv) const;
+    void compShader_Raycast_gpu(const Invocation & inv) const;
+
+    TileRenderer mTileRenderer;
 
     VoxelWorld mVoxelWorld;
 
@@ -74,12 +93,6 @@ private:
     // glsl variables
     uvec3 gl_WorkGroupSize;
     uvec3 gl_NumWorkGroups;
-
-    uvec3 gl_LocalInvocationID;
-    uvec3 gl_WorkGroupID;
-
-    uvec3 gl_GlobalInvocationID;
-    u32 gl_LocalInvocationIndex;
 };
 
 
@@ -97,21 +110,15 @@ public:
     FragmentShaderSimulator();
     ~FragmentShaderSimulator();
 
-    void init(u32 outputImageSize, RaycastCamera * pRaycastCamera);
+    // Square tiles of kTileSize pixels are rendered in parallel
+    static const u32 kTileSize = 32;
+
+    // threadCount of 0 means one thread per core
+    void init(u32 outputImageSize, RaycastCamera * pRaycastCamera, u32 threadCount = 0);
     const u8 * frameBuffer() { return mFrameBuffer->buffer(); }
 
     void render(const RaycastCamera & camera, const List<kMEM_Renderer, Light> & lights);
 private:
-    void fragShader_Blue();
-    void fragShader_Raycast();
-
-    bool mIsInit = false;
-    ImageBuffer * mFrameBuffer;
-    ImageBuffer * mDepthBuffer;
-    ImageBuffer * mDepthBufferBlank;
-
-    RaycastCamera * mpRaycastCamera;
-
     // GLSL "globals"
     struct ScreenCoords
     {
@@ -120,9 +127,24 @@ private:
         u32 z;
     };
 
-    RGB8 color; // frag output shader
-    f32 zDepth;
-    ScreenCoords gl_FragCoord;
+    void renderTile(u32 tileX, u32 tileY);
+
+    vec3 fragRayDir(const ScreenCoords & gl_FragCoord) const;
+
+    // color and zDepth are the frag shader outputs
+    void fragShader_Blue(const ScreenCoords & gl_FragCoord, RGB8 & color, f32 & zDepth) const;
+    void fragShader_Raycast(const ScreenCoords & gl_FragCoord, RGB8 & color, f32 & zDepth) const;
+    void fragShader_RaycastPacket(const ScreenCoords & gl_FragCoord, u32 count, RGB8 * pColors, f32 * pZDepths) const;
+    void fragShader_ShadeHit(const VoxelRayHit & hit, RGB8 & color, f32 & zDepth) const;
+
+    TileRenderer mTileRenderer;
+
+    bool mIsInit = false;
+    ImageBuffer * mFrameBuffer;
+    ImageBuffer * mDepthBuffer;
+    ImageBuffer * mDepthBufferBlank;
+
+    RaycastCamera * mpRaycastCamera;
 
     u32 uniform0 = 0;
 
@@ -47,6 +47,8 @@ ModelGL::ModelGL(ModelInstance * pModelInstance, RendererMesh * pRenderer)
   , mTextureId_animations(0)
   , mFrameOffset(0)
   , mGlPrimType(0)
+  , mGlIndexType(pModelInstance->model().gmdl().has32BitIndices() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT)
+  , mUploadTicket(0)
 {
     switch (pModelInstance->model().gmdl().primType())
     {
@@ -71,7 +73,8 @@ void ModelGL::loadGpu()
     if (mpRenderer->loadVerts(&mVertArrayId,
                               &mVertBufferId,
                               mpModelInstance->model().gmdl().verts(),
-                              mpModelInstance->model().gmdl().vertsSize()))
+                              mpModelInstance->model().gmdl().vertsSize(),
+                              &mUploadTicket))
     {
 #if HAS(OPENGL3)
         prepareMeshAttributes();
@@ -80,15 +83,16 @@ void ModelGL::loadGpu()
 
     mpRenderer->loadPrims(&mPrimBufferId,
                           mpModelInstance->model().gmdl().prims(),
-                          mpModelInstance->model().gmdl().primsSize());
+                          mpModelInstance->model().gmdl().primsSize(),
+                          &mUploadTicket);
 
     if (mpModelInstance->model().gmdl().mat())
     {
-        mTextureId_diffuse = mpRenderer->loadTexture(mpModelInstance->model().gmdl().mat()->texture(kTXTY_Diffuse));
+        mTextureId_diffuse = mpRenderer->loadTexture(mpModelInstance->model().gmdl().mat()->texture(kTXTY_Diffuse), &mUploadTicket);
     }
     if (mpModelInstance->model().hasGaim())
     {
-        mTextureId_animations = mpRenderer->loadTexture(mpModelInstance->model().gaim().image());
+        mTextureId_animations = mpRenderer->loadTexture(mpModelInstance->model().gaim().image(), &mUploadTicket);
     }
 
     mpRenderer->unbindBuffers();
@@ -104,6 +108,11 @@ void ModelGL::unloadGpu()
     }
 }
 
+bool ModelGL::isGpuReady() const
+{
+    return mpRenderer->isUploadComplete(mUploadTicket);
+}
+
 void ModelGL::render()
 {
     if (mTextureId_diffuse > 0)
@@ -119,11 +128,63 @@ void ModelGL::render()
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mPrimBufferId);
 #endif
-    glDrawElements(mGlPrimType, mpModelInstance->model().gmdl().indexCount(), GL_UNSIGNED_SHORT, (void*)(uintptr_t)0);
+    glDrawElements(mGlPrimType, mpModelInstance->model().gmdl().indexCount(), mGlIndexType, (void*)(uintptr_t)0);
 
     mpRenderer->unbindBuffers();
 }
 
+void ModelGL::renderInstanced(const InstanceBatch & batch)
+{
+#if HAS(OPENGL3)
+    if (mTextureId_diffuse > 0)
+        mpRenderer->setTexture(HASH::diffuse, mTextureId_diffuse);
+    if (mTextureId_animations > 0)
+        mpRenderer->setTexture(HASH::animations, mTextureId_animations);
+
+    // Float verts pass through the decode with a bias of 0 and scale of 1
+    const Gmdl & gmdl = mpModelInstance->model().gmdl();
+    shaders::Shader & shader = mpRenderer->activeShader();
+    shader.setUniformVec3(shaders::kUS_pos_bias, gmdl.posBias());
+    shader.setUniformVec3(shaders::kUS_pos_scale, gmdl.posScale());
+    shader.setUniformUint(shaders::kUS_oct_normals, gmdl.isQuantized() ? 1 : 0);
+
+    glBindVertexArray(mVertArrayId);
+    glDrawElementsInstancedBaseInstance(mGlPrimType,
+                                        mpModelInstance->model().gmdl().indexCount(),
+                                        mGlIndexType,
+                                        (void*)(uintptr_t)batch.key.indexOffset,
+                                        batch.instanceCount,
+                                        batch.firstInstance);
+
+    mpRenderer->unbindBuffers();
+#else
+    PANIC("Instanced draws require OPENGL3");
+#endif
+}
+
+u32 ModelGL::materialId() const
+{
+    // Identifies the diffuse texture without its gl id, which is only
+    // known once the render thread has loaded it
+    const Gmdl & gmdl = mpModelInstance->model().gmdl();
+    if (gmdl.mat() && gmdl.mat()->texture(kTXTY_Diffuse))
+        return gmdl.mat()->texture(kTXTY_Diffuse)->referencePathHash();
+    return 0;
+}
+
+InstanceBatchKey ModelGL::batchKey() const
+{
+    InstanceBatchKey key;
+    memset(&key, 0, sizeof(key));
+    key.shaderHash = shaderHash();
+    key.vertArrayId = mVertArrayId;
+    key.primBufferId = mPrimBufferId;
+    key.materialId = mTextureId_diffuse;
+    key.animationsId = mTextureId_animations;
+    key.indexCount = mpModelInstance->model().gmdl().indexCount();
+    return key;
+}
+
 void ModelGL::prepareMeshAttributes()
 {
     const Gmdl & gmdl = mpModelInstance->model().gmdl();
@@ -131,17 +192,32 @@ void ModelGL::prepareMeshAttributes()
 
     ASSERT(gmdl.hasVertPosition());
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertStride, (void*)(uintptr_t)gmdl.vertPositionOffset());
+    // Quantized verts are normalized shorts the vertex shader decodes,
+    // see mesh_quantize.h
+    bool quantized = gmdl.isQuantized();
+
+    if (quantized)
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, vertStride, (void*)(uintptr_t)gmdl.vertPositionOffset());
+    else
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertStride, (void*)(uintptr_t)gmdl.vertPositionOffset());
     glEnableVertexAttribArray(0);
 
     if (gmdl.hasVertNormal())
     {
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertStride, (void*)(uintptr_t)gmdl.vertNormalOffset());
+        if (quantized)
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, vertStride, (void*)(uintptr_t)gmdl.vertNormalOffset());
+        else
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertStride, (void*)(uintptr_t)gmdl.vertNormalOffset());
         glEnableVertexAttribArray(1);
 
         if (gmdl.hasVertUv())
         {
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, vertStride, (void*)(uintptr_t)gmdl.vertUvOffset());
+            if (!quantized)
+                glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, vertStride, (void*)(uintptr_t)gmdl.vertUvOffset());
+            else if (gmdl.hasHalfUvs())
+                glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, vertStride, (void*)(uintptr_t)gmdl.vertUvOffset());
+            else
+                glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, vertStride, (void*)(uintptr_t)gmdl.vertUvOffset());
             glEnableVertexAttribArray(2);
 
             if (gmdl.hasVertBone())
@@ -162,6 +238,9 @@ void ModelGL::prepareMeshAttributes()
         }
     }
 
+#if HAS(OPENGL3)
+    mpRenderer->prepareInstanceAttributes();
+#endif
 }
 
 void ModelGL::reportDestruction(u32 uid)
@@ -31,9 +31,9 @@
 #include "gaen/math/mat43.h"
 #include "gaen/math/vec2.h"
 #include "gaen/assets/Gmdl.h"
+#include "gaen/render_support/InstanceBatch.h"
 #include "gaen/render_support/Model.h"
-
-#include "gaen/renderergl/RenderCollection.h"
+#include "gaen/render_support/RenderCollection.h"
 
 namespace gaen
 {
@@ -45,11 +45,16 @@ class ModelGL
 public:
     typedef ModelInstance InstanceType;
 
+    static const bool kDepthSorted = false;
+
     ModelGL(ModelInstance * pModelInstance, RendererMesh * pRenderer);
 
     void loadGpu();
     void unloadGpu();
+    // Render thread, false until the textures and buffers finish uploading
+    bool isGpuReady() const;
     void render();
+    void renderInstanced(const InstanceBatch & batch);
 
     void prepareMeshAttributes();
 
@@ -58,10 +63,19 @@ public:
     u32 renderFlags() const { return mpModelInstance->renderFlags(); }
 
     u32 shaderHash() const { return mpModelInstance->model().gmdl().shaderHash(); }
+    u32 materialId() const;
+    u32 indexOffset() const { return 0; }
+    InstanceBatchKey batchKey() const;
 
     static void reportDestruction(u32 uid);
 
     const mat43 & transform() const { return mpModelInstance->mTransform; }
+
+    void localBounds(vec3 & center, f32 & radius) const
+    {
+        center = mpModelInstance->model().gmdl().center();
+        radius = length(mpModelInstance->model().gmdl().halfExtents());
+    }
     void setTransform(const mat43 & transform) { mpModelInstance->mTransform = transform; }
 
     RenderItemStatus status() const { return mStatus; }
@@ -92,6 +106,9 @@ private:
     u32 mFrameOffset;
 
     u32 mGlPrimType;
+    u32 mGlIndexType;
+
+    u64 mUploadTicket;
 };
 
 typedef UniquePtr<ModelGL> ModelGLUP;
@@ -56,6 +56,7 @@
 #include "gaen/engine/messages/ModelInstance.h"
 #include "gaen/engine/messages/NotifyWatcherMat43.h"
 #include "gaen/engine/messages/SpriteAnim.h"
+#include "gaen/engine/messages/SpriteAnimBatch.h"
 #include "gaen/engine/messages/SpriteInstance.h"
 #include "gaen/engine/messages/UidTransform.h"
 #include "gaen/engine/messages/UidScalarTransform.h"
@@ -75,6 +76,12 @@ namespace gaen
 {
 
 GAMEVAR_DECL_BOOL(testui, false);
+GAMEVAR_DECL_BOOL(frustum_cull, true);
+GAMEVAR_DECL_FLOAT(max_draw_distance, 0.0f);
+GAMEVAR_DECL_INT(cull_threads, 1); // 0 for one per core, worth it for very large stages
+GAMEVAR_DECL_BOOL(render_thread, true);
+GAMEVAR_DECL_INT(upload_budget_kb, 4096); // per frame, a larger single upload still goes out alone
+GAMEVAR_DECL_INT(staging_buffer_mb, 16);
 
 RendererMesh::RendererMesh()
   : mModelStages(this)
@@ -115,6 +122,78 @@ void RendererMesh::init(void * pRenderDevice,
 void RendererMesh::fin()
 {
     ASSERT(mIsInit);
+
+    if (mIsRenderThreaded)
+    {
+        // Render thread draws what's queued, then releases the gpu
+        mFrames.close();
+        mRenderThread.join();
+        mIsRenderThreaded = false;
+    }
+    else
+    {
+        finGpu();
+    }
+}
+
+void RendererMesh::initRenderDevice()
+{
+    ASSERT(mIsInit);
+
+#if HAS(RENDER_THREAD)
+    if (render_thread)
+    {
+        // The gl context lives on the render thread from here on
+        mIsRenderThreaded = true;
+        mRenderThread = std::thread(&RendererMesh::renderThreadProc, this);
+        return;
+    }
+#endif
+
+    makeDeviceCurrent();
+}
+
+void RendererMesh::finGpu()
+{
+#if HAS(OPENGL3)
+    mUploads.clear();
+    for (UploadFence & fence : mUploadFences)
+        glDeleteSync(fence.sync);
+    mUploadFences.clear();
+
+    if (mStagingBufferId)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, mStagingBufferId);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &mStagingBufferId);
+    }
+    mStagingBufferId = 0;
+    mpStagingMem = nullptr;
+
+    if (mInstanceBufferId)
+        glDeleteBuffers(1, &mInstanceBufferId);
+    mInstanceBufferId = 0;
+    mInstanceBufferSize = 0;
+#endif
+}
+
+void RendererMesh::renderThreadProc()
+{
+    makeDeviceCurrent();
+    initGpu();
+
+    while (RenderFrame * pFrame = mFrames.beginRead())
+    {
+        drawFrame(*pFrame);
+        mFrames.endRead();
+
+        swapBuffers();
+        GL_VALIDATE();
+        mHasPresented = true;
+    }
+
+    finGpu();
 }
 
 static const char * gl_error_source_str(GLenum source)
@@ -202,6 +281,13 @@ void RendererMesh::initViewport()
 {
     ASSERT(mIsInit);
 
+    // Render thread does this itself once it owns the context
+    if (!mIsRenderThreaded)
+        initGpu();
+}
+
+void RendererMesh::initGpu()
+{
     int flags; glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
     if (flags & GL_CONTEXT_FLAG_DEBUG_BIT)
     {
@@ -242,6 +328,33 @@ void RendererMesh::initViewport()
     // reset viewport
     glViewport(0, 0, mScreenWidth, mScreenHeight);
 
+#if HAS(OPENGL3)
+    // Persistent mapping needs 4.4, without it uploads copy straight
+    // from asset memory.
+    if (GLAD_GL_VERSION_4_4 && staging_buffer_mb > 0)
+    {
+        u64 stagingSize = (u64)staging_buffer_mb * 1024 * 1024;
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glGenBuffers(1, &mStagingBufferId);
+        glBindBuffer(GL_COPY_READ_BUFFER, mStagingBufferId);
+        glBufferStorage(GL_COPY_READ_BUFFER, stagingSize, nullptr, flags);
+        mpStagingMem = (u8*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, stagingSize, flags);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        if (mpStagingMem)
+        {
+            mStaging.init(stagingSize);
+        }
+        else
+        {
+            ERR("Unable to map staging buffer, uploading directly");
+            glDeleteBuffers(1, &mStagingBufferId);
+            mStagingBufferId = 0;
+        }
+    }
+#endif
+
 #if HAS(ENABLE_EDITOR)
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -269,20 +382,37 @@ void RendererMesh::setTexture(u32 nameHash, u32 glId)
     int textureUnit = activeShader().textureUnit(nameHash);
     ASSERT(textureUnit >= 0);
 
+    // Draws are sorted by material, so consecutive items usually
+    // share their textures.
+    if (textureUnit < kMaxBoundTextures)
+    {
+        if (mBoundTextures[textureUnit] == glId)
+            return;
+        mBoundTextures[textureUnit] = glId;
+    }
+
+    // GL_TEXTURE_MAX_LEVEL is set at load, so mipmapped min filters
+    // leave single level textures complete.
     glActiveTexture(GL_TEXTURE0 + textureUnit);
     glBindTexture(GL_TEXTURE_2D, glId);
     if (nameHash == HASH::animations || nameHash == HASH::diffuse)
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     }
     else
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
 }
 
+void RendererMesh::resetTextureBindings()
+{
+    for (u32 i = 0; i < kMaxBoundTextures; ++i)
+        mBoundTextures[i] = 0;
+}
+
 static void image_format_and_type(u32 &pixelFormat, u32 &pixelType, PixelFormat format)
 {
     switch (format)
@@ -295,18 +425,48 @@ static void image_format_and_type(u32 &pixelFormat, u32 &pixelType, PixelFormat
         pixelFormat = GL_RGBA;
         pixelType = GL_UNSIGNED_BYTE;
         break;
+    case kPXL_RGB_DXT1:
+    case kPXL_RGBA_DXT5:
+        // Compressed uploads take neither
+        pixelFormat = 0;
+        pixelType = 0;
+        break;
     default:
         PANIC("Unsupported PixelFormat: %d", format);
     }
 }
 
-u32 RendererMesh::loadTexture(const Gimg * pGimg)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// The DXT PixelFormats are the sRGB enums, but RGBA8 textures are
+// sampled without sRGB decode so compressed ones use the linear
+// S3TC formats to match.
+static u32 texture_internal_format(PixelFormat format)
+{
+    switch (format)
+    {
+    case kPXL_RGB_DXT1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case kPXL_RGBA_DXT5:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default:
+        return format;
+    }
+}
+
+u32 RendererMesh::loadTexture(const Gimg * pGimg, u64 * pUploadTicket)
 {
     auto it = mLoadedTextures.find(pGimg->referencePathHash());
     if (it == mLoadedTextures.end())
     {
         PANIC_IF(pGimg->pixelFormat() == kPXL_Reference, "Gimg must be loaded before references");
         u32 glId = 0;
+        resetTextureBindings();
         glActiveTexture(GL_TEXTURE0);
         glGenTextures(1, &glId);
         glBindTexture(GL_TEXTURE_2D, glId);
@@ -316,29 +476,54 @@ u32 RendererMesh::loadTexture(const Gimg * pGimg)
         image_format_and_type(pixelFormat, pixelType, pGimg->pixelFormat());
 
 
-        glTexImage2D(GL_TEXTURE_2D,
-                     0,
-                     pGimg->pixelFormat(),
-                     pGimg->width(),
-                     pGimg->height(),
-                     0,
-                     pixelFormat,
-                     pixelType,
-                     pGimg->pixels());
+        // Allocate only, pixels go out with the upload queue
+        u32 internalFormat = texture_internal_format(pGimg->pixelFormat());
+        for (u32 level = 0; level < pGimg->mipCount(); ++level)
+        {
+            if (is_block_compressed(pGimg->pixelFormat()))
+            {
+                glCompressedTexImage2D(GL_TEXTURE_2D,
+                                       level,
+                                       internalFormat,
+                                       pGimg->mipWidth(level),
+                                       pGimg->mipHeight(level),
+                                       0,
+                                       (GLsizei)pGimg->mipSize(level),
+                                       nullptr);
+            }
+            else
+            {
+                glTexImage2D(GL_TEXTURE_2D,
+                             level,
+                             internalFormat,
+                             pGimg->mipWidth(level),
+                             pGimg->mipHeight(level),
+                             0,
+                             pixelFormat,
+                             pixelType,
+                             nullptr);
+            }
+        }
 
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pGimg->mipCount() - 1);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-        mLoadedTextures.emplace(std::piecewise_construct,
-                                std::forward_as_tuple(pGimg->referencePathHash()),
-                                std::forward_as_tuple(glId, 1));
-        return glId;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+
+        u64 size = pGimg->pixelsSize();
+        auto itNew = mLoadedTextures.emplace(std::piecewise_construct,
+                                             std::forward_as_tuple(pGimg->referencePathHash()),
+                                             std::forward_as_tuple(glId, 1));
+        itNew.first->second.uploadTicket = queueUpload(kUPLD_Texture, glId, pGimg->pixels(), size, pGimg);
+        it = itNew.first;
     }
     else
     {
         it->second.refCount++;
-        return it->second.glId0;
     }
+
+    if (pUploadTicket)
+        *pUploadTicket = std::max(*pUploadTicket, it->second.uploadTicket);
+    return it->second.glId0;
 }
 
 void RendererMesh::unloadTexture(const Gimg * pGimg)
@@ -351,6 +536,8 @@ void RendererMesh::unloadTexture(const Gimg * pGimg)
         if (it->second.refCount == 0)
         {
             ASSERT(it->second.glId0 > 0);
+            cancelUploads(kUPLD_Texture, it->second.glId0);
+            resetTextureBindings(); // gl may reuse the id
             glDeleteTextures(1, &it->second.glId0);
             mLoadedTextures.erase(it);
         }
@@ -363,7 +550,7 @@ void RendererMesh::unloadTexture(const Gimg * pGimg)
 
 
 
-bool RendererMesh::loadVerts(u32 * pVertArrayId, u32 * pVertBufferId, const void * pVerts, u64 vertsSize)
+bool RendererMesh::loadVerts(u32 * pVertArrayId, u32 * pVertBufferId, const void * pVerts, u64 vertsSize, u64 * pUploadTicket)
 {
     auto it = mLoadedVerts.find(pVerts);
     if (it == mLoadedVerts.end())
@@ -378,11 +565,13 @@ bool RendererMesh::loadVerts(u32 * pVertArrayId, u32 * pVertBufferId, const void
 
         glGenBuffers(1, pVertBufferId);
         glBindBuffer(GL_ARRAY_BUFFER, *pVertBufferId);
-        glBufferData(GL_ARRAY_BUFFER, vertsSize, pVerts, GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertsSize, nullptr, GL_STATIC_DRAW);
 
-        mLoadedVerts.emplace(std::piecewise_construct,
-                             std::forward_as_tuple(pVerts),
-                             std::forward_as_tuple(*pVertArrayId, *pVertBufferId, 1));
+        auto itNew = mLoadedVerts.emplace(std::piecewise_construct,
+                                          std::forward_as_tuple(pVerts),
+                                          std::forward_as_tuple(*pVertArrayId, *pVertBufferId, 1));
+        itNew.first->second.uploadTicket = queueUpload(kUPLD_Buffer, *pVertBufferId, pVerts, vertsSize, nullptr);
+        *pUploadTicket = std::max(*pUploadTicket, itNew.first->second.uploadTicket);
         return true;
     }
     else
@@ -390,6 +579,7 @@ bool RendererMesh::loadVerts(u32 * pVertArrayId, u32 * pVertBufferId, const void
         it->second.refCount++;
         *pVertArrayId = it->second.glId0;
         *pVertBufferId = it->second.glId1;
+        *pUploadTicket = std::max(*pUploadTicket, it->second.uploadTicket);
         return false;
     }
 }
@@ -405,6 +595,7 @@ void RendererMesh::unloadVerts(const void * pVerts)
         {
             ASSERT(it->second.glId0 > 0); // probably not if not OPENGL3
             ASSERT(it->second.glId1 > 0);
+            cancelUploads(kUPLD_Buffer, it->second.glId1);
             glDeleteVertexArrays(1, &it->second.glId0);
             glDeleteBuffers(1, &it->second.glId1);
             mLoadedVerts.erase(it);
@@ -416,24 +607,27 @@ void RendererMesh::unloadVerts(const void * pVerts)
     }
 }
 
-bool RendererMesh::loadPrims(u32 * pPrimBufferId, const void * pPrims, u64 primsSize)
+bool RendererMesh::loadPrims(u32 * pPrimBufferId, const void * pPrims, u64 primsSize, u64 * pUploadTicket)
 {
     auto it = mLoadedPrims.find(pPrims);
     if (it == mLoadedPrims.end())
     {
         glGenBuffers(1, pPrimBufferId);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *pPrimBufferId);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, primsSize, pPrims, GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, primsSize, nullptr, GL_STATIC_DRAW);
 
-        mLoadedPrims.emplace(std::piecewise_construct,
-                             std::forward_as_tuple(pPrims),
-                             std::forward_as_tuple(*pPrimBufferId, 1));
+        auto itNew = mLoadedPrims.emplace(std::piecewise_construct,
+                                          std::forward_as_tuple(pPrims),
+                                          std::forward_as_tuple(*pPrimBufferId, 1));
+        itNew.first->second.uploadTicket = queueUpload(kUPLD_Buffer, *pPrimBufferId, pPrims, primsSize, nullptr);
+        *pUploadTicket = std::max(*pUploadTicket, itNew.first->second.uploadTicket);
         return true;
     }
     else
     {
         it->second.refCount++;
         *pPrimBufferId = it->second.glId0;
+        *pUploadTicket = std::max(*pUploadTicket, it->second.uploadTicket);
         return false;
     }
 }
@@ -448,6 +642,7 @@ void RendererMesh::unloadPrims(const void * pPrims)
         if (it->second.refCount == 0)
         {
             ASSERT(it->second.glId0 > 0);
+            cancelUploads(kUPLD_Buffer, it->second.glId0);
             glDeleteBuffers(1, &it->second.glId0);
             mLoadedPrims.erase(it);
         }
@@ -460,6 +655,164 @@ void RendererMesh::unloadPrims(const void * pPrims)
 
 
 
+u64 RendererMesh::queueUpload(UploadType type, u32 glId, const void * pSrc, u64 size, const Gimg * pGimg)
+{
+#if HAS(OPENGL3)
+    u64 ticket = mNextUploadTicket++;
+    mUploads.push_back(Upload{type, glId, pSrc, size, pGimg, ticket});
+    return ticket;
+#else
+    // No fences to track staging with, copy now
+    copyUpload(Upload{type, glId, pSrc, size, pGimg, 0}, 0);
+    return 0;
+#endif
+}
+
+void RendererMesh::cancelUploads(UploadType type, u32 glId)
+{
+    mUploads.remove_if([type, glId](const Upload & upload) { return upload.type == type && upload.glId == glId; });
+}
+
+void RendererMesh::processUploads()
+{
+#if HAS(OPENGL3)
+    retireUploadFences();
+
+    u64 budget = (u64)std::max(upload_budget_kb, 0) * 1024;
+    bool isFirst = true;
+
+    while (!mUploads.empty())
+    {
+        const Upload & upload = mUploads.front();
+
+        // Always make progress, even on an upload bigger than the budget
+        if (!isFirst && upload.size > budget)
+            break;
+
+        if (mpStagingMem && upload.size <= mStaging.capacity())
+        {
+            u64 offset = 0;
+            if (!mStaging.alloc(&offset, upload.size, 16))
+                break; // wait for earlier copies to finish
+            memcpy(mpStagingMem + offset, upload.pSrc, upload.size);
+            copyUpload(upload, offset);
+        }
+        else
+        {
+            copyUpload(upload, 0);
+        }
+
+        budget -= std::min(budget, upload.size);
+        isFirst = false;
+        mUploads.pop_front();
+    }
+
+    // Every ticket before the next queued one has been issued or cancelled
+    u64 issuedTicket = mUploads.empty() ? mNextUploadTicket - 1 : mUploads.front().ticket - 1;
+    if (issuedTicket > mFencedUploadTicket)
+    {
+        u64 fenceId = mNextUploadFenceId++;
+        mStaging.fence(fenceId);
+        GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mUploadFences.push_back(UploadFence{sync, fenceId, issuedTicket});
+        mFencedUploadTicket = issuedTicket;
+    }
+#endif
+}
+
+void RendererMesh::copyUpload(const Upload & upload, u64 stagingOffset)
+{
+    // Sources from the staging buffer when mapped, otherwise straight
+    // from asset memory.
+    bool isStaged = mpStagingMem != nullptr && upload.size <= mStaging.capacity();
+
+    if (upload.type == kUPLD_Buffer)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, upload.glId);
+        if (isStaged)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, mStagingBufferId);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingOffset, 0, upload.size);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        else
+        {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, 0, upload.size, upload.pSrc);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    else
+    {
+        ASSERT(upload.pGimg);
+        u32 pixelFormat = 0;
+        u32 pixelType = 0;
+        image_format_and_type(pixelFormat, pixelType, upload.pGimg->pixelFormat());
+
+        resetTextureBindings();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, upload.glId);
+        if (isStaged)
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mStagingBufferId);
+
+        const Gimg * pGimg = upload.pGimg;
+        u32 internalFormat = texture_internal_format(pGimg->pixelFormat());
+        for (u32 level = 0; level < pGimg->mipCount(); ++level)
+        {
+            u64 levelOffset = pGimg->mipPixels(level) - pGimg->pixels();
+            const void * pLevelSrc = isStaged
+                ? (const void*)(uintptr_t)(stagingOffset + levelOffset)
+                : (const void*)((const u8*)upload.pSrc + levelOffset);
+
+            if (is_block_compressed(pGimg->pixelFormat()))
+            {
+                glCompressedTexSubImage2D(GL_TEXTURE_2D,
+                                          level,
+                                          0,
+                                          0,
+                                          pGimg->mipWidth(level),
+                                          pGimg->mipHeight(level),
+                                          internalFormat,
+                                          (GLsizei)pGimg->mipSize(level),
+                                          pLevelSrc);
+            }
+            else
+            {
+                glTexSubImage2D(GL_TEXTURE_2D,
+                                level,
+                                0,
+                                0,
+                                pGimg->mipWidth(level),
+                                pGimg->mipHeight(level),
+                                pixelFormat,
+                                pixelType,
+                                pLevelSrc);
+            }
+        }
+
+        if (isStaged)
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+}
+
+void RendererMesh::retireUploadFences()
+{
+#if HAS(OPENGL3)
+    // Fences signal in order, stop at the first still pending
+    while (!mUploadFences.empty())
+    {
+        UploadFence & fence = mUploadFences.front();
+        GLenum res = glClientWaitSync(fence.sync, 0, 0);
+        if (res != GL_ALREADY_SIGNALED && res != GL_CONDITION_SATISFIED)
+            break;
+
+        mStaging.retire(fence.fenceId);
+        mCompletedUploadTicket = fence.ticket;
+        glDeleteSync(fence.sync);
+        mUploadFences.pop_front();
+    }
+#endif
+}
+
 void RendererMesh::unbindBuffers()
 {
 #if HAS(OPENGL3)
@@ -469,6 +822,87 @@ void RendererMesh::unbindBuffers()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+u32 RendererMesh::loadUniformBuffer(u64 size)
+{
+    u32 bufferId = 0;
+#if HAS(OPENGL3)
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+#endif
+    return bufferId;
+}
+
+void RendererMesh::updateUniformBuffer(u32 bufferId, const void * pData, u64 size)
+{
+#if HAS(OPENGL3)
+    ASSERT(bufferId);
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, pData);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+#endif
+}
+
+void RendererMesh::bindUniformBuffer(u32 binding, u32 bufferId)
+{
+#if HAS(OPENGL3)
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, bufferId);
+#endif
+}
+
+void RendererMesh::unloadUniformBuffer(u32 bufferId)
+{
+#if HAS(OPENGL3)
+    if (bufferId)
+        glDeleteBuffers(1, &bufferId);
+#endif
+}
+
+void RendererMesh::prepareInstanceAttributes()
+{
+#if HAS(OPENGL3)
+    if (mInstanceBufferId == 0)
+        glGenBuffers(1, &mInstanceBufferId);
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceBufferId);
+
+    GLsizei stride = sizeof(InstanceData);
+
+    // mat4x3 transform takes a location per column
+    for (u32 i = 0; i < 4; ++i)
+    {
+        u32 loc = kInstanceAttribLocation + i;
+        glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(uintptr_t)(offsetof(InstanceData, transform) + i * sizeof(vec3)));
+        glEnableVertexAttribArray(loc);
+        glVertexAttribDivisor(loc, 1);
+    }
+
+    u32 loc = kInstanceAttribLocation + 4;
+    glVertexAttribIPointer(loc, 1, GL_UNSIGNED_INT, stride, (void*)(uintptr_t)offsetof(InstanceData, frameOffset));
+    glEnableVertexAttribArray(loc);
+    glVertexAttribDivisor(loc, 1);
+#endif
+}
+
+void RendererMesh::uploadInstances(const InstanceData * pInstances, u32 count)
+{
+#if HAS(OPENGL3)
+    if (count == 0)
+        return;
+
+    ASSERT(mInstanceBufferId);
+    u64 size = count * sizeof(InstanceData);
+    if (size > mInstanceBufferSize)
+        mInstanceBufferSize = std::max(size, mInstanceBufferSize * 2);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceBufferId);
+    // Orphan last upload so we don't wait on draws still reading it
+    glBufferData(GL_ARRAY_BUFFER, mInstanceBufferSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, pInstances);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+}
+
 u32 RendererMesh::load_texture(const Gimg * pGimg, void * pContext)
 {
     RendererMesh * pRenderer = (RendererMesh*)pContext;
@@ -600,18 +1034,70 @@ void RendererMesh::render()
 {
     ASSERT(mIsInit);
 
+    // Waits if the render thread is still behind by every frame
+    RenderFrame & frame = mFrames.beginWrite();
+    recycleFrame(frame);
+
+    frame.textureLoads.swap(mPendingTextureLoads);
+    frame.textureUnloads.swap(mPendingTextureUnloads);
+    mModelStages.captureFrame(frame.models);
+    mSpriteStages.captureFrame(frame.sprites);
+
+    mFrames.endWrite();
+
+    if (!mIsRenderThreaded)
+    {
+        RenderFrame * pFrame = mFrames.tryBeginRead();
+        ASSERT(pFrame == &frame);
+        drawFrame(*pFrame);
+        mFrames.endRead();
+    }
+}
+
+void RendererMesh::recycleFrame(RenderFrame & frame)
+{
+    // Render thread is done with this frame, so whatever it unloaded
+    // can be deleted now.
+    frame.textureLoads.clear();
+    for (const Asset * pAsset : frame.textureUnloads)
+    {
+        AssetMgr::release_asset(kRendererTaskId, pAsset);
+    }
+    frame.textureUnloads.clear();
+
+    StageMgr<Stage<ModelGL>>::recycle_frame(frame.models);
+    StageMgr<Stage<SpriteGL>>::recycle_frame(frame.sprites);
+}
+
+void RendererMesh::drawFrame(RenderFrame & frame)
+{
+    for (const Gimg * pGimg : frame.textureLoads)
+    {
+        loadTexture(pGimg);
+    }
+    for (const Asset * pAsset : frame.textureUnloads)
+    {
+        unloadTexture(pAsset->buffer<Gimg>());
+    }
+    StageMgr<Stage<ModelGL>>::load_frame(frame.models);
+    StageMgr<Stage<SpriteGL>>::load_frame(frame.sprites);
+
+    // Starts this frame's loads too, they draw once their fence signals
+    processUploads();
+
     // Undo nanovg stuff
     mpActiveShader = nullptr; // force us to re-load one of our shaders
+    resetTextureBindings();   // and re-bind our textures
     glEnable(GL_DEPTH_TEST);   // Enables Depth Testing
     glEnable(GL_CULL_FACE);
     glClear(GL_DEPTH_BUFFER_BIT);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    mModelStages.render();
+    StageMgr<Stage<ModelGL>>::draw_frame(frame.models);
 
     glClear(GL_STENCIL_BUFFER_BIT);
     glClear(GL_DEPTH_BUFFER_BIT);
-    mSpriteStages.render();
+    StageMgr<Stage<SpriteGL>>::draw_frame(frame.sprites);
 
     if (testui)
     {
@@ -620,6 +1106,21 @@ void RendererMesh::render()
     }
 }
 
+void RendererMesh::endFrame()
+{
+    ASSERT(mIsInit);
+
+    if (!mIsRenderThreaded)
+    {
+        swapBuffers();
+        GL_VALIDATE();
+        mHasPresented = true;
+    }
+
+    if (mHasPresented)
+        showDevice();
+}
+
 template <typename T>
 MessageResult RendererMesh::message(const T & msgAcc)
 {
@@ -809,6 +1310,19 @@ MessageResult RendererMesh::message(const T & msgAcc)
         mSpriteStages.itemAnimate(msgr.uid(), msgr.animHash(), msgr.animFrameIdx());
         break;
     }
+    case HASH::sprite_anim_batch:
+    {
+        messages::SpriteAnimBatchR<T> msgr(msgAcc);
+        SpriteAnimBatch * pBatch = msgr.batch();
+        ASSERT(pBatch);
+        for (u32 i = 0; i < pBatch->size(); ++i)
+        {
+            const SpriteFrameChange & change = (*pBatch)[i];
+            mSpriteStages.itemAnimate(change.uid, change.animHash, change.animFrameIdx);
+        }
+        GDELETE(pBatch);
+        break;
+    }
     case HASH::sprite_transform:
     {
         messages::NotifyWatcherMat43R<T> msgr(msgAcc);
@@ -850,7 +1364,7 @@ MessageResult RendererMesh::message(const T & msgAcc)
         const Gimg * pGimg = pAsset->buffer<Gimg>();
         AssetMgr::addref_asset(kRendererTaskId, pAsset);
         mImageOwners[msgr.taskId()].push_back(pAsset);
-        loadTexture(pGimg);
+        mPendingTextureLoads.push_back(pGimg);
         break;
     }
 	case HASH::remove_task__:
@@ -860,11 +1374,10 @@ MessageResult RendererMesh::message(const T & msgAcc)
         // It's ok if we don't find it, it just means this task had no models
         if (itL != mImageOwners.end())
         {
+            // Unloaded by the render thread, released once it's done
             for (const Asset * pAsset : itL->second)
             {
-                const Gimg * pGimg = pAsset->buffer<Gimg>();
-                unloadTexture(pGimg);
-                AssetMgr::release_asset(kRendererTaskId, pAsset);
+                mPendingTextureUnloads.push_back(pAsset);
             }
             mImageOwners.erase(itL);
         }
@@ -27,6 +27,9 @@
 #ifndef GAEN_RENDERERGL_RENDERERMESH_H
 #define GAEN_RENDERERGL_RENDERERMESH_H
 
+#include <atomic>
+#include <thread>
+
 #include "gaen/core/List.h"
 #include "gaen/core/HashMap.h"
 
@@ -37,6 +40,8 @@
 #include "gaen/engine/Message.h"
 #include "gaen/engine/MessageAccessor.h"
 #include "gaen/render_support/render_objects.h"
+#include "gaen/render_support/FrameHandoff.h"
+#include "gaen/render_support/StagingRing.h"
 
 #include "gaen/renderergl/gaen_opengl.h"
 #include "gaen/renderergl/ModelGL.h"
@@ -45,10 +50,27 @@
 #include "gaen/renderergl/StageMgr.h"
 #include "gaen/renderergl/ShaderRegistry.h"
 
+// Draw on a dedicated thread while the primary TaskMaster simulates the
+// next frame. Editor builds render inline since ImGui builds its frames
+// on the primary thread.
+#define RENDER_THREAD WHEN(HAS(OPENGL3) && !HAS(ENABLE_EDITOR))
+
 namespace gaen
 {
 class Gimg;
 
+// Everything the render thread needs to draw one frame, captured on
+// the primary thread in render().
+struct RenderFrame
+{
+    StageMgrFrame<Stage<ModelGL>> models;
+    StageMgrFrame<Stage<SpriteGL>> sprites;
+
+    Vector<kMEM_Renderer, const Gimg*> textureLoads;
+    // Released back to the AssetMgr when the frame is recycled
+    Vector<kMEM_Renderer, const Asset*> textureUnloads;
+};
+
 class RendererMesh
 {
 public:
@@ -73,24 +95,43 @@ public:
     u32 screenWidth() { return mScreenWidth; }
     u32 screenHeight() { return mScreenHeight; }
 
+    // Primary thread, captures a frame and hands it to the render thread
     void render();
     void endFrame();
 
     template <typename T>
     MessageResult message(const T& msgAcc);
 
-    u32 loadTexture(const Gimg * pGimg);
+    // Loads create the gl objects right away, their contents are queued
+    // for upload. pUploadTicket is raised to the ticket that must
+    // complete before the contents can be drawn, see isUploadComplete.
+    u32 loadTexture(const Gimg * pGimg, u64 * pUploadTicket = nullptr);
     void setTexture(u32 nameHash, u32 glId);
+    // Forget cached bindings, e.g. after something outside our stages binds textures
+    void resetTextureBindings();
     void unloadTexture(const Gimg* pGimg);
 
-    bool loadVerts(u32 * pVertArrayId, u32 * pVertBufferId, const void * pVerts, u64 vertsSize);
+    bool loadVerts(u32 * pVertArrayId, u32 * pVertBufferId, const void * pVerts, u64 vertsSize, u64 * pUploadTicket);
     void unloadVerts(const void * pVerts);
 
-    bool loadPrims(u32 * pPrimBufferId, const void * pPrims, u64 trisSize);
+    bool loadPrims(u32 * pPrimBufferId, const void * pPrims, u64 trisSize, u64 * pUploadTicket);
     void unloadPrims(const void * pPrims);
 
+    bool isUploadComplete(u64 uploadTicket) const { return uploadTicket <= mCompletedUploadTicket; }
+
     void unbindBuffers();
 
+    u32 loadUniformBuffer(u64 size);
+    void updateUniformBuffer(u32 bufferId, const void * pData, u64 size);
+    void bindUniformBuffer(u32 binding, u32 bufferId);
+    void unloadUniformBuffer(u32 bufferId);
+
+    // Points the bound vertex array's instance attributes at the shared
+    // instance buffer, call while setting up a new vertex array.
+    void prepareInstanceAttributes();
+    // Replaces the instance buffer's contents for the next instanced draws
+    void uploadInstances(const InstanceData * pInstances, u32 count);
+
     void setActiveShader(u32 nameHash);
     shaders::Shader & activeShader() { return *mpActiveShader; }
 
@@ -100,6 +141,41 @@ private:
 
     static u32 load_texture(const Gimg * pGimg, void * pContext);
 
+    // Platform specific
+    void makeDeviceCurrent();
+    void swapBuffers();
+    void showDevice();
+
+    void initGpu();
+    void finGpu();
+
+    void renderThreadProc();
+    void drawFrame(RenderFrame & frame);
+    void recycleFrame(RenderFrame & frame);
+
+    enum UploadType
+    {
+        kUPLD_Buffer,
+        kUPLD_Texture
+    };
+
+    struct Upload
+    {
+        UploadType type;
+        u32 glId;
+        const void * pSrc;
+        u64 size;
+        const Gimg * pGimg; // textures only
+        u64 ticket;
+    };
+
+    u64 queueUpload(UploadType type, u32 glId, const void * pSrc, u64 size, const Gimg * pGimg);
+    void cancelUploads(UploadType type, u32 glId);
+    // Copies queued contents to the gpu, up to upload_budget_kb a frame
+    void processUploads();
+    void copyUpload(const Upload & upload, u64 stagingOffset);
+    void retireUploadFences();
+
     shaders::Shader * getShader(u32 nameHash);
 
     bool mIsInit = false;
@@ -116,8 +192,41 @@ private:
     StageMgr<Stage<ModelGL>> mModelStages;
     StageMgr<Stage<SpriteGL>> mSpriteStages;
 
+    FrameHandoff<RenderFrame> mFrames;
+    Vector<kMEM_Renderer, const Gimg*> mPendingTextureLoads;
+    Vector<kMEM_Renderer, const Asset*> mPendingTextureUnloads;
+
+    std::thread mRenderThread;
+    bool mIsRenderThreaded = false;
+    std::atomic<bool> mHasPresented{false};
+
     shaders::Shader * mpActiveShader = nullptr;
 
+    u32 mInstanceBufferId = 0;
+    u64 mInstanceBufferSize = 0;
+
+    // Render thread upload queue. Contents are copied through a
+    // persistently mapped staging buffer, whose ranges are reclaimed
+    // as the fence placed after each frame's copies signals.
+    struct UploadFence
+    {
+        GLsync sync;
+        u64 fenceId;
+        u64 ticket; // every upload up to this one is complete
+    };
+    List<kMEM_Renderer, Upload> mUploads;
+    List<kMEM_Renderer, UploadFence> mUploadFences;
+    StagingRing mStaging;
+    u32 mStagingBufferId = 0;
+    u8 * mpStagingMem = nullptr;
+    u64 mNextUploadTicket = 1;
+    u64 mFencedUploadTicket = 0;
+    u64 mCompletedUploadTicket = 0;
+    u64 mNextUploadFenceId = 1;
+
+    static const i32 kMaxBoundTextures = 16;
+    u32 mBoundTextures[kMaxBoundTextures] = {};
+
     ShaderRegistry mShaderRegistry;
     HashMap<kMEM_Renderer, u32, shaders::Shader*> mShaders;
 
@@ -126,6 +235,7 @@ private:
         u32 glId0;
         u32 glId1;
         u32 refCount;
+        u64 uploadTicket = 0;
 
         LoadInfo(u32 glId0, u32 refCount)
           : glId0(glId0)
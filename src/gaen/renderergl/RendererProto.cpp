@@ -144,6 +144,18 @@ void RendererProto::fin()
 
 static mat4 sMVPMat(1.0f);
 
+void RendererProto::initRenderDevice()
+{
+    makeDeviceCurrent();
+}
+
+void RendererProto::endFrame()
+{
+    swapBuffers();
+    GL_VALIDATE();
+    showDevice();
+}
+
 void RendererProto::initViewport()
 {
     ASSERT(mIsInit);
@@ -347,6 +359,8 @@ static void set_shader_vec4_var(u32 nameHash, const vec4 & val, void * context)
 
 static void prepare_gmdl_attributes(const Gmdl & gmdl)
 {
+    ASSERT(!gmdl.isQuantized()); // only ModelGL decodes quantized verts
+
     // position
     if (gmdl.hasVertPosition())
     {
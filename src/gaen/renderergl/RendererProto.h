@@ -86,6 +86,11 @@ public:
     MessageResult message(const T& msgAcc);
 
 private:
+    // Platform specific
+    void makeDeviceCurrent();
+    void swapBuffers();
+    void showDevice();
+
     void setActiveShader(u32 nameHash);
     shaders::Shader * getShader(u32 nameHash);
 
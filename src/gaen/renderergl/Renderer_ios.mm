@@ -35,19 +35,23 @@
 namespace gaen
 {
 
-void RENDERER_TYPE::initRenderDevice()
+void RENDERER_TYPE::makeDeviceCurrent()
 {
     ASSERT(mIsInit);
 
     [EAGLContext setCurrentContext: (EAGLContext*)mRenderContext];
 }
 
-void RENDERER_TYPE::endFrame()
+void RENDERER_TYPE::swapBuffers()
 {
     ASSERT(mIsInit);
 
     [(id)mRenderContext presentRenderbuffer:GL_RENDERBUFFER];
 }
 
+void RENDERER_TYPE::showDevice()
+{
+}
+
 } // namespace gaen
 
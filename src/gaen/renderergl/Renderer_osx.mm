@@ -35,19 +35,23 @@
 namespace gaen
 {
 
-void RENDERER_TYPE::initRenderDevice()
+void RENDERER_TYPE::makeDeviceCurrent()
 {
     ASSERT(mIsInit);
 
     [(id)mRenderContext makeCurrentContext];
 }
 
-void RENDERER_TYPE::endFrame()
+void RENDERER_TYPE::swapBuffers()
 {
     ASSERT(mIsInit);
 
     [(id)mRenderContext flushBuffer];
 }
 
+void RENDERER_TYPE::showDevice()
+{
+}
+
 } // namespace gaen
 
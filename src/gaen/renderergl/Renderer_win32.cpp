@@ -42,7 +42,7 @@ namespace gaen
 
 GAMEVAR_DECL_BOOL(vsync, true);
 
-void RENDERER_TYPE::initRenderDevice()
+void RENDERER_TYPE::makeDeviceCurrent()
 {
     ASSERT(mIsInit);
 
@@ -58,17 +58,22 @@ void RENDERER_TYPE::initRenderDevice()
     glfwSwapBuffers((GLFWwindow*)mpRenderDevice);
 }
 
-void RENDERER_TYPE::endFrame()
+void RENDERER_TYPE::swapBuffers()
 {
     ASSERT(mIsInit);
 
-    static bool sIsVisible = false;
-
 #if HAS(ENABLE_EDITOR)
     if (ImGui::GetDrawData() != nullptr)
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 #endif
     glfwSwapBuffers((GLFWwindow*)mpRenderDevice);
+}
+
+void RENDERER_TYPE::showDevice()
+{
+    ASSERT(mIsInit);
+
+    static bool sIsVisible = false;
 
     // Show the window which starts as not visible.
     // Starting with a visible window gives a nasty white window on
@@ -37,13 +37,14 @@ namespace gaen
 void SpriteGL::loadGpu()
 {
     // Load images if they're not loaded yet
-    mTextureId = mpRenderer->loadTexture(&mpSpriteInstance->sprite().gimg());
+    mTextureId = mpRenderer->loadTexture(&mpSpriteInstance->sprite().gimg(), &mUploadTicket);
 
     // Load sprite's verts and prims
     if (mpRenderer->loadVerts(&mVertArrayId,
                               &mVertBufferId,
                               mpSpriteInstance->sprite().verts(),
-                              mpSpriteInstance->sprite().vertsSize()))
+                              mpSpriteInstance->sprite().vertsSize(),
+                              &mUploadTicket))
     {
 #if HAS(OPENGL3)
         prepareMeshAttributes();
@@ -52,7 +53,8 @@ void SpriteGL::loadGpu()
 
     mpRenderer->loadPrims(&mPrimBufferId,
                           mpSpriteInstance->sprite().tris(),
-                          mpSpriteInstance->sprite().trisSize());
+                          mpSpriteInstance->sprite().trisSize(),
+                          &mUploadTicket);
 
 
     mpRenderer->unbindBuffers();
@@ -65,6 +67,11 @@ void SpriteGL::unloadGpu()
     mpRenderer->unloadPrims(mpSpriteInstance->sprite().tris());
 }
 
+bool SpriteGL::isGpuReady() const
+{
+    return mpRenderer->isUploadComplete(mUploadTicket);
+}
+
 void SpriteGL::render()
 {
     mpRenderer->setTexture(HASH::diffuse, mTextureId);
@@ -83,6 +90,40 @@ void SpriteGL::render()
     mpRenderer->unbindBuffers();
 }
 
+void SpriteGL::renderInstanced(const InstanceBatch & batch)
+{
+#if HAS(OPENGL3)
+    mpRenderer->setTexture(HASH::diffuse, mTextureId);
+
+    glBindVertexArray(mVertArrayId);
+    glDrawElementsInstancedBaseInstance(GL_TRIANGLES,
+                                        6,
+                                        GL_UNSIGNED_SHORT,
+                                        (void*)(uintptr_t)batch.key.indexOffset,
+                                        batch.instanceCount,
+                                        batch.firstInstance);
+
+    mpRenderer->unbindBuffers();
+#else
+    PANIC("Instanced draws require OPENGL3");
+#endif
+}
+
+InstanceBatchKey SpriteGL::batchKey() const
+{
+    // The stage fills in indexOffset from its frame capture. Sprites
+    // sharing an atlas only batch when showing the same frame, since
+    // the frame picks the index range.
+    InstanceBatchKey key;
+    memset(&key, 0, sizeof(key));
+    key.shaderHash = shaderHash();
+    key.vertArrayId = mVertArrayId;
+    key.primBufferId = mPrimBufferId;
+    key.materialId = mTextureId;
+    key.indexCount = 6;
+    return key;
+}
+
 void SpriteGL::animate(u32 animHash, u32 animFrameIdx)
 {
     mpSpriteInstance->animate(animHash, animFrameIdx);
@@ -92,6 +133,10 @@ void SpriteGL::prepareMeshAttributes()
 {
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphVert), (void*)(uintptr_t)0);
     glEnableVertexAttribArray(0);
+
+#if HAS(OPENGL3)
+    mpRenderer->prepareInstanceAttributes();
+#endif
 }
 
 void SpriteGL::reportDestruction()
@@ -28,11 +28,12 @@
 #define GAEN_RENDERERGL_SPRITEGL_H
 
 #include "gaen/core/mem.h"
+#include "gaen/assets/Gimg.h"
 #include "gaen/math/mat43.h"
+#include "gaen/render_support/InstanceBatch.h"
+#include "gaen/render_support/RenderCollection.h"
 #include "gaen/render_support/Sprite.h"
 
-#include "gaen/renderergl/RenderCollection.h"
-
 namespace gaen
 {
 
@@ -43,6 +44,9 @@ class SpriteGL
 public:
     typedef SpriteInstance InstanceType;
 
+    // Sprites blend, so keep them in zdepth order when sorting draws
+    static const bool kDepthSorted = true;
+
     SpriteGL(SpriteInstance * pSpriteInstance, RendererMesh * pRenderer)
       : mpSpriteInstance(pSpriteInstance)
       , mpRenderer(pRenderer)
@@ -52,11 +56,17 @@ public:
       , mPrimBufferId(0)
       , mTextureId(0)
       , mTextureUnit(0)
+      , mUploadTicket(0)
+      , mBoundsCenter(pSpriteInstance->sprite().center())
+      , mBoundsRadius(length(pSpriteInstance->sprite().halfExtents()))
     {}
 
     void loadGpu();
     void unloadGpu();
+    // Render thread, false until the texture and buffers finish uploading
+    bool isGpuReady() const;
     void render();
+    void renderInstanced(const InstanceBatch & batch);
 
     void animate(u32 animHash, u32 animFrameIdx);
 
@@ -67,10 +77,21 @@ public:
     f32 order() const { return mpSpriteInstance->zdepth(); }
 
     u32 shaderHash() const { return HASH::sprite; }
+    // Known on the primary thread, unlike the texture's gl id
+    u32 materialId() const { return mpSpriteInstance->sprite().gimg().referencePathHash(); }
+    // Byte offset of the current frame's indices, changes as the sprite animates
+    u32 indexOffset() const { return static_cast<u32>(reinterpret_cast<uintptr_t>(mpSpriteInstance->currentFrameElemsOffset())); }
+    InstanceBatchKey batchKey() const;
 
     void reportDestruction();
 
-    const mat43 & transform() { return mpSpriteInstance->mTransform; }
+    const mat43 & transform() const { return mpSpriteInstance->mTransform; }
+
+    void localBounds(vec3 & center, f32 & radius) const
+    {
+        center = mBoundsCenter;
+        radius = mBoundsRadius;
+    }
     void setTransform(const mat43 & transform) { mpSpriteInstance->mTransform = transform; }
 
     RenderItemStatus status() { return mStatus; }
@@ -97,6 +118,11 @@ private:
 
     u32 mTextureId;
     u32 mTextureUnit;
+
+    u64 mUploadTicket;
+
+    vec3 mBoundsCenter;
+    f32 mBoundsRadius;
 };
 
 typedef UniquePtr<SpriteGL> SpriteGLUP;
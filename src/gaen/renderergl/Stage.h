@@ -27,12 +27,23 @@
 #ifndef GAEN_RENDERERGL_STAGE_H
 #define GAEN_RENDERERGL_STAGE_H
 
+#include <algorithm>
+
 #include "gaen/render_support/render_objects.h"
-#include "gaen/renderergl/RenderCollection.h"
+#include "gaen/core/gamevars.h"
+#include "gaen/render_support/DrawList.h"
+#include "gaen/render_support/FrustumCull.h"
+#include "gaen/render_support/InstanceBatch.h"
+#include "gaen/render_support/RenderCollection.h"
+#include "gaen/renderergl/shaders/Shader.h"
 
 namespace gaen
 {
 
+GAMEVAR_REF_BOOL(frustum_cull);
+GAMEVAR_REF_FLOAT(max_draw_distance);
+GAMEVAR_REF_INT(cull_threads);
+
 class RendererMesh;
 
 template <class ItemT>
@@ -59,76 +70,153 @@ public:
 
     const Camera * cameraActive() const { return mpCamera; }
 
-    void render()
+    struct FrameDraw
+    {
+        ItemT * pItem;
+        InstanceData instance;
+        u32 pass;
+        u32 indexOffset;
+    };
+
+    // This stage's part of a frame handed from the primary thread to
+    // the render thread.
+    struct Frame
+    {
+        Stage * pStage = nullptr;
+        bool isShown = false;
+        bool lightsDirty = false;
+        mat4 viewProj;
+        shaders::LightsBlock lights;
+
+        Vector<kMEM_Renderer, ItemT*> loads;     // inserted since the last capture
+        Vector<kMEM_Renderer, ItemT*> unloads;   // destroyed, deleted when recycled
+        Vector<kMEM_Renderer, FrameDraw> draws;  // sorted by draw key
+    };
+
+    // Primary thread: records everything the render thread needs to
+    // draw this stage. Items and cameras can change as soon as this
+    // returns.
+    void captureFrame(Frame & frame)
     {
-        if (isShown())
+        frame.pStage = this;
+        frame.isShown = isShown();
+        frame.loads.swap(mPendingLoads);
+
+        if (frame.isShown)
         {
-            const mat4 & viewProj = cameraActive()->viewProjection();
+            frame.viewProj = cameraActive()->viewProjection();
 
-            for (u32 i = 0; i < kRP_COUNT; ++i)
+            frame.lightsDirty = mLightsDirty;
+            if (mLightsDirty)
             {
-                for(auto it = mItems[i].begin();
-                    it != mItems[i].end();
-                    /* no increment so we can remove while iterating */)
-                {
-                    ItemT * pItem = *it;
-
-                    if (!pItem->isVisible())
-                    {
-                        ++it;
-                        continue;
-                    }
-
-                    if ((pItem->renderFlags() & mRenderFlags) == pItem->renderFlags())
-                    {
-                        mpRenderer->setActiveShader(pItem->shaderHash());
-                        mpRenderer->activeShader().setTextureUniforms();
-
-                        if (pItem->status() == kRIS_Active)
-                        {
-                            mat4 mvp = viewProj * mat4(pItem->transform());
-                            mpRenderer->activeShader().setUniformMat4(HASH::mvp, mvp);
-
-                            if (mpRenderer->activeShader().hasUniform(HASH::rot, GL_FLOAT_MAT3))
-                                mpRenderer->activeShader().setUniformMat3(HASH::rot, mat3(pItem->transform()));
-
-                            if (mLights.size() > 0 && mpRenderer->activeShader().hasUniform(HASH::light0_incidence, GL_FLOAT_VEC3))
-                            {
-                                mpRenderer->activeShader().setUniformVec3(HASH::light0_incidence, mLights[0].incidence());
-                                mpRenderer->activeShader().setUniformVec3(HASH::light0_color, mLights[0].color());
-                                mpRenderer->activeShader().setUniformFloat(HASH::light0_ambient, mLights[0].ambient());
-
-                                if (mLights.size() > 1 && mpRenderer->activeShader().hasUniform(HASH::light1_incidence, GL_FLOAT_VEC3))
-                                {
-                                    mpRenderer->activeShader().setUniformVec3(HASH::light1_incidence, mLights[1].incidence());
-                                    mpRenderer->activeShader().setUniformVec3(HASH::light1_color, mLights[1].color());
-                                    mpRenderer->activeShader().setUniformFloat(HASH::light1_ambient, mLights[1].ambient());
-                                }
-                            }
-
-                            if (mpRenderer->activeShader().hasUniform(HASH::frame_offset, GL_UNSIGNED_INT))
-                                mpRenderer->activeShader().setUniformUint(HASH::frame_offset, pItem->frameOffset());
-
-                            pItem->render();
-                            ++it;
-                        }
-                        else if (pItem->status() == kRIS_Destroyed)
-                        {
-                            pItem->unloadGpu();
-                            u32 uid = pItem->uid();
-                            mItems[i].erase(it++);
-                            ModelGL::reportDestruction(uid);
-                        }
-                    }
-                    else
-                    {
-                        ++it;
-                    }
-                }
+                frame.lights = lightsBlock();
+                mLightsDirty = false;
             }
+
+            buildDrawList(frame);
         }
     }
 
+    // Render thread: runs the frame's gpu loads and unloads
+    void loadFrame(const Frame & frame)
+    {
+        for (ItemT * pItem : frame.loads)
+            pItem->loadGpu();
+        for (ItemT * pItem : frame.unloads)
+            pItem->unloadGpu();
+    }
+
+    // Render thread: draws the frame's items whose uploads are complete
+    void drawFrame(const Frame & frame)
+    {
+        if (!frame.isShown)
+            return;
+
+        bindLights(frame);
+
+#if HAS(OPENGL3)
+        buildBatches(frame);
+        mpRenderer->uploadInstances(mBatcher.instances(), mBatcher.instanceCount());
+
+        u32 shaderHash = 0;
+        for (u32 i = 0; i < mBatcher.batchCount(); ++i)
+        {
+            const InstanceBatch & batch = mBatcher.batch(i);
+
+            // Per shader state, only set on shader transitions
+            if (batch.key.shaderHash != shaderHash)
+            {
+                shaderHash = batch.key.shaderHash;
+                mpRenderer->setActiveShader(shaderHash);
+                shaders::Shader & shader = mpRenderer->activeShader();
+                shader.setTextureUniforms();
+                shader.setUniformMat4(shaders::kUS_view_proj, frame.viewProj);
+            }
+
+            frame.draws[batch.itemIndex].pItem->renderInstanced(batch);
+        }
+#else // #if HAS(OPENGL3)
+        u32 shaderHash = 0;
+        for (const FrameDraw & draw : frame.draws)
+        {
+            ItemT * pItem = draw.pItem;
+            if (!pItem->isGpuReady())
+                continue;
+
+            // Per shader state, only set on shader transitions
+            if (pItem->shaderHash() != shaderHash)
+            {
+                shaderHash = pItem->shaderHash();
+                mpRenderer->setActiveShader(shaderHash);
+                mpRenderer->activeShader().setTextureUniforms();
+            }
+
+            shaders::Shader & shader = mpRenderer->activeShader();
+
+            mat4 mvp = frame.viewProj * mat4(draw.instance.transform);
+            shader.setUniformMat4(shaders::kUS_mvp, mvp);
+
+            if (shader.hasUniform(shaders::kUS_rot))
+                shader.setUniformMat3(shaders::kUS_rot, mat3(draw.instance.transform));
+
+            if (shader.hasUniform(shaders::kUS_frame_offset))
+                shader.setUniformUint(shaders::kUS_frame_offset, draw.instance.frameOffset);
+
+            pItem->render();
+        }
+#endif // #else // #if HAS(OPENGL3)
+    }
+
+    // Primary thread: the render thread is done with frame, so free
+    // what it was handed. Doesn't touch the stage, which may be gone.
+    static void recycle_frame(Frame & frame)
+    {
+        for (ItemT * pItem : frame.unloads)
+        {
+            ModelGL::reportDestruction(pItem->uid());
+            GDELETE(pItem);
+        }
+        frame.pStage = nullptr;
+        frame.loads.clear();
+        frame.unloads.clear();
+        frame.draws.clear();
+    }
+
+    // Render thread: releases gpu resources of a removed stage, the
+    // stage itself is deleted when its frame is recycled.
+    void unloadGpu()
+    {
+        for (u32 i = 0; i < mCullSet.size(); ++i)
+        {
+            ItemT * pItem = mCullSet.item(i).pItem;
+            // Skip items that were never handed to the render thread
+            if (std::find(mPendingLoads.begin(), mPendingLoads.end(), pItem) == mPendingLoads.end())
+                pItem->unloadGpu();
+        }
+        mpRenderer->unloadUniformBuffer(mLightsBufferId);
+        mLightsBufferId = 0;
+    }
+
     u32 camerasSize()
     {
         return mCameraMap.size();
@@ -184,6 +272,7 @@ public:
         if (mLights.size() < kMaxLightVecSize)
         {
             mLights.emplace_back(light);
+            mLightsDirty = true;
             return;
         }
     }
@@ -206,6 +295,7 @@ public:
         if (it != mLights.end())
         {
             it->setDirection(direction);
+            mLightsDirty = true;
             return true;
         }
         return false;
@@ -217,6 +307,7 @@ public:
         if (it != mLights.end())
         {
             it->setColor(color);
+            mLightsDirty = true;
             return true;
         }
         return false;
@@ -228,6 +319,7 @@ public:
         if (it != mLights.end())
         {
             it->setAmbient(ambient);
+            mLightsDirty = true;
             return true;
         }
         return false;
@@ -239,6 +331,7 @@ public:
         if (it != mLights.end())
         {
             mLights.erase(it);
+            mLightsDirty = true;
             return true;
         }
         return false;
@@ -255,7 +348,14 @@ public:
         ASSERT(mItems[pInst->pass()].find(pInst->uid()) == mItems[pInst->pass()].end());
 
         UniquePtr<ItemT> pItem(GNEW(kMEM_Renderer, ItemT, pInst, mpRenderer));
-        pItem->loadGpu();
+        // Loaded on the render thread, see captureFrame
+        mPendingLoads.push_back(pItem.get());
+
+        vec3 center;
+        f32 radius;
+        worldBounds(*pItem, center, radius);
+        mCullSet.insert(pItem->uid(), CullItem{pItem.get(), static_cast<u32>(pInst->pass())}, center, radius);
+
         mItems[pInst->pass()].insert(std::move(pItem));
     }
 
@@ -266,13 +366,13 @@ public:
             auto it = mItems[i].find(uid);
             if (it != mItems[i].end())
             {
-                f32 oldOrder = it->order();
-
+                // No reorder needed, draw order comes from draw keys
                 it->setTransform(transform);
-                if (oldOrder != it->order())
-                {
-                    mItems[i].reorder(uid);
-                }
+
+                vec3 center;
+                f32 radius;
+                worldBounds(**it, center, radius);
+                mCullSet.update(uid, center, radius);
 
                 return true;
             }
@@ -352,6 +452,155 @@ public:
     }
 
 private:
+    // Collects this frame's drawable items into frame.draws, sorted by
+    // draw key, and hands destroyed items to the render thread to unload.
+    void buildDrawList(Frame & frame)
+    {
+        mDrawList.clear();
+        mDrawItems.clear();
+
+        vec3 eye = cameraEye();
+
+        if (frustum_cull)
+        {
+            Frustum frustum = Frustum::from_view_projection(cameraActive()->viewProjection());
+            if (max_draw_distance > 0.0f)
+            {
+                frustum.eye = eye;
+                frustum.maxDistance = max_draw_distance;
+            }
+            i32 threads = cull_threads;
+            mCullSet.cull(frustum, threads > 0 ? static_cast<u32>(threads) : 0);
+        }
+
+        // Backwards so destroyed items can be swap-removed as we go
+        for (u32 i = mCullSet.size(); i-- > 0; )
+        {
+            ItemT * pItem = mCullSet.item(i).pItem;
+            u32 pass = mCullSet.item(i).pass;
+
+            if (pItem->status() == kRIS_Destroyed)
+            {
+                u32 uid = pItem->uid();
+                mCullSet.remove(uid);
+                frame.unloads.push_back(mItems[pass].release(mItems[pass].find(uid)));
+                continue;
+            }
+
+            if ((frustum_cull && !mCullSet.visible(i)) ||
+                !pItem->isVisible() ||
+                (pItem->renderFlags() & mRenderFlags) != pItem->renderFlags())
+            {
+                continue;
+            }
+
+            // Alpha pass draws blend whatever the item type, so depth
+            // comes ahead of shader and material for them too. Sprites
+            // carry their own zdepth, other items sort back to front by
+            // squared distance from the eye to their bounds center.
+            f32 depth = pItem->order();
+            if (!ItemT::kDepthSorted && pass == kRP_Alpha)
+            {
+                vec3 toItem = mCullSet.center(i) - eye;
+                depth = -dot(toItem, toItem);
+            }
+
+            u32 shaderSlot = mShaderSlots.slot(pItem->shaderHash());
+            u64 key = (ItemT::kDepthSorted || pass == kRP_Alpha) ?
+                draw_key_depth_sorted(pass, shaderSlot, pItem->materialId(), depth) :
+                draw_key(pass, shaderSlot, pItem->materialId(), depth);
+            mDrawList.push(key, static_cast<u32>(mDrawItems.size()));
+            mDrawItems.push_back(pItem);
+        }
+
+        mDrawList.sort();
+
+        frame.draws.reserve(mDrawList.size());
+        for (u32 i = 0; i < mDrawList.size(); ++i)
+        {
+            ItemT * pItem = mDrawItems[mDrawList[i].index];
+            frame.draws.push_back(FrameDraw{pItem,
+                                            InstanceData{pItem->transform(), pItem->frameOffset()},
+                                            draw_key_pass(mDrawList[i].key),
+                                            pItem->indexOffset()});
+        }
+    }
+
+    // Groups the frame's sorted draws into instanced draws. Depth
+    // sorted items and alpha pass draws only batch with their
+    // neighbours so blend order holds.
+    void buildBatches(const Frame & frame)
+    {
+        mBatcher.clear();
+        mBatcher.reserve(static_cast<u32>(frame.draws.size()));
+        for (u32 i = 0; i < frame.draws.size(); ++i)
+        {
+            const FrameDraw & draw = frame.draws[i];
+            if (!draw.pItem->isGpuReady())
+                continue;
+
+            InstanceBatchKey key = draw.pItem->batchKey();
+            key.pass = draw.pass;
+            key.indexOffset = draw.indexOffset;
+            mBatcher.push(key, draw.instance.transform, draw.instance.frameOffset, i,
+                          ItemT::kDepthSorted || draw.pass == kRP_Alpha);
+        }
+        mBatcher.finish();
+    }
+
+    // Bounding sphere of an item's local bounds under its transform
+    static void worldBounds(const ItemT & item, vec3 & center, f32 & radius)
+    {
+        vec3 localCenter;
+        f32 localRadius;
+        item.localBounds(localCenter, localRadius);
+
+        const mat43 & transform = item.transform();
+        f32 scale = max(length(transform[0]), max(length(transform[1]), length(transform[2])));
+        center = transform * localCenter;
+        radius = localRadius * scale;
+    }
+
+    vec3 cameraEye() const
+    {
+        // view is world to camera, so the eye is -transpose(rot) * translation
+        const mat43 & view = cameraActive()->view();
+        const vec3 & t = view[3];
+        return -vec3(dot(view[0], t), dot(view[1], t), dot(view[2], t));
+    }
+
+    shaders::LightsBlock lightsBlock() const
+    {
+        shaders::LightsBlock block;
+        memset(&block, 0, sizeof(block));
+        if (mLights.size() > 0)
+        {
+            block.light0_incidence = mLights[0].incidence();
+            block.light0_color = mLights[0].color();
+            block.light0_ambient = mLights[0].ambient();
+        }
+        if (mLights.size() > 1)
+        {
+            block.light1_incidence = mLights[1].incidence();
+            block.light1_color = mLights[1].color();
+            block.light1_ambient = mLights[1].ambient();
+        }
+        return block;
+    }
+
+    // Uploads the frame's lights to this stage's uniform buffer when
+    // they have changed and binds it for all of the stage's draws.
+    void bindLights(const Frame & frame)
+    {
+        if (mLightsBufferId == 0)
+            mLightsBufferId = mpRenderer->loadUniformBuffer(sizeof(shaders::LightsBlock));
+
+        if (frame.lightsDirty)
+            mpRenderer->updateUniformBuffer(mLightsBufferId, &frame.lights, sizeof(frame.lights));
+
+        mpRenderer->bindUniformBuffer(shaders::kUBB_Lights, mLightsBufferId);
+    }
+
     u32 mStageHash;
     RendererMesh * mpRenderer;
     bool mIsShown;
@@ -362,8 +611,29 @@ private:
     HashMap<kMEM_Renderer, u32, Camera> mCameraMap;
 
     Vector<kMEM_Renderer, Light> mLights;
+    bool mLightsDirty = true;
 
     RenderCollection<ItemT> mItems[kRP_COUNT];
+
+    // Owns nothing, items live in mItems
+    struct CullItem
+    {
+        ItemT * pItem;
+        u32 pass;
+    };
+    CullSet<CullItem> mCullSet;
+
+    // Inserted items waiting to be handed to the render thread
+    Vector<kMEM_Renderer, ItemT*> mPendingLoads;
+
+    // Primary thread, rebuilt each capture
+    DrawKeySlots mShaderSlots;
+    DrawList mDrawList;
+    Vector<kMEM_Renderer, ItemT*> mDrawItems;
+
+    // Render thread only
+    u32 mLightsBufferId = 0;
+    InstanceBatcher mBatcher;
 }; // class Stage
 
 } // namespace gaen
@@ -30,6 +30,21 @@
 namespace gaen
 {
 
+// Everything the render thread needs from a StageMgr for one frame.
+// Filled on the primary thread by captureFrame, drawn by drawFrame on
+// the render thread, and handed back to recycle_frame on the primary
+// once the render thread is done with it.
+template <class StageT>
+struct StageMgrFrame
+{
+    Vector<kMEM_Renderer, typename StageT::Frame> stages;
+    u32 stageCount = 0;
+
+    // Removed stages, gpu resources released in drawFrame and
+    // deleted in recycle_frame
+    Vector<kMEM_Renderer, StageT*> retired;
+};
+
 template <class StageT>
 class StageMgr
 {
@@ -48,13 +63,67 @@ public:
         mStages.reserve(16);
     }
 
+    ~StageMgr()
+    {
+        for (StageT * pStage : mRetired)
+        {
+            GDELETE(pStage);
+        }
+    }
+
 
-    void render()
+    // Primary thread
+    void captureFrame(StageMgrFrame<StageT> & frame)
     {
+        ASSERT(frame.stageCount == 0);
+        if (frame.stages.size() < mStages.size())
+            frame.stages.resize(mStages.size());
+
         for (auto & stage : mStages)
         {
-            stage->render();
+            stage->captureFrame(frame.stages[frame.stageCount++]);
+        }
+
+        ASSERT(frame.retired.empty());
+        frame.retired.swap(mRetired);
+    }
+
+    // Render thread
+    static void load_frame(StageMgrFrame<StageT> & frame)
+    {
+        for (u32 i = 0; i < frame.stageCount; ++i)
+        {
+            frame.stages[i].pStage->loadFrame(frame.stages[i]);
+        }
+    }
+
+    // Render thread, after load_frame
+    static void draw_frame(StageMgrFrame<StageT> & frame)
+    {
+        for (u32 i = 0; i < frame.stageCount; ++i)
+        {
+            frame.stages[i].pStage->drawFrame(frame.stages[i]);
+        }
+        for (StageT * pStage : frame.retired)
+        {
+            pStage->unloadGpu();
+        }
+    }
+
+    // Primary thread, once the render thread has released the frame
+    static void recycle_frame(StageMgrFrame<StageT> & frame)
+    {
+        for (u32 i = 0; i < frame.stageCount; ++i)
+        {
+            StageT::recycle_frame(frame.stages[i]);
+        }
+        frame.stageCount = 0;
+
+        for (StageT * pStage : frame.retired)
+        {
+            GDELETE(pStage);
         }
+        frame.retired.clear();
     }
 
 
@@ -133,6 +202,8 @@ public:
         auto it = std::find_if(mStages.begin(), mStages.end(), [stageHash](const UniquePtr<StageT> & s) { return s->stageHash() == stageHash; });
         if (it != mStages.end())
         {
+            // Render thread may still be drawing it, retire rather than delete
+            mRetired.push_back(it->release());
             mStages.erase(it);
         }
         else
@@ -141,6 +212,10 @@ public:
 
     void removeAll()
     {
+        for (auto & stage : mStages)
+        {
+            mRetired.push_back(stage.release());
+        }
         mStages.clear();
     }
 
@@ -417,6 +492,9 @@ private:
     Camera mDefaultCamera;
 
     Vector<kMEM_Renderer, UniquePtr<StageT>> mStages;
+
+    // Removed since the last captureFrame
+    Vector<kMEM_Renderer, StageT*> mRetired;
 };
 
 } // namespace gaen
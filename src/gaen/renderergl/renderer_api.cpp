@@ -59,9 +59,6 @@ void renderer_end_frame(Task & rendererTask)
 {
     RendererType * pRenderer = reinterpret_cast<RendererType*>(rendererTask.that());
     pRenderer->endFrame();
-
-    // Check for errors
-    GL_VALIDATE();
 }
 
 } // namespace gaen
@@ -25,6 +25,7 @@
 //------------------------------------------------------------------------------
 
 #include "gaen/math/common.h"
+#include "gaen/hashes/hashes.h"
 
 #include "gaen/renderergl/Renderer.h"
 
@@ -44,7 +45,27 @@ Shader::Shader(u32 nameHash)
   , mpCodes(nullptr)
   , mpUniforms(nullptr)
   , mpAttributes(nullptr)
-{}
+{
+    for (u32 i = 0; i < kUS_COUNT; ++i)
+        mSlotLocations[i] = -1;
+}
+
+struct UniformSlotInfo
+{
+    u32 nameHash;
+    u32 type;
+};
+
+static const UniformSlotInfo kUniformSlotInfos[kUS_COUNT] =
+{
+    { HASH::mvp,          GL_FLOAT_MAT4 },    // kUS_mvp
+    { HASH::rot,          GL_FLOAT_MAT3 },    // kUS_rot
+    { HASH::frame_offset, GL_UNSIGNED_INT },  // kUS_frame_offset
+    { HASH::view_proj,    GL_FLOAT_MAT4 },    // kUS_view_proj
+    { HASH::pos_bias,     GL_FLOAT_VEC3 },    // kUS_pos_bias
+    { HASH::pos_scale,    GL_FLOAT_VEC3 },    // kUS_pos_scale
+    { HASH::oct_normals,  GL_UNSIGNED_INT }   // kUS_oct_normals
+};
 
 void Shader::load()
 {
@@ -163,6 +184,12 @@ void Shader::processProgram()
             currTexture++;
         }
     }
+
+    for (u32 i = 0; i < kUS_COUNT; ++i)
+    {
+        VariableInfo * pUniform = findUniform(kUniformSlotInfos[i].nameHash, kUniformSlotInfos[i].type);
+        mSlotLocations[i] = pUniform ? pUniform->location : -1;
+    }
 }
 
 Shader::VariableInfo * Shader::findUniform(u32 nameHash, u32 type)
@@ -277,6 +304,36 @@ void Shader::setUniformMat4(u32 nameHash, const mat4 & value)
         ERR("UniformMat4 does not exist in shader");
 }
 
+void Shader::setUniformUint(UniformSlot slot, u32 value)
+{
+    ASSERT(mIsLoaded);
+    if (mSlotLocations[slot] >= 0)
+        glUniform1ui(mSlotLocations[slot], value);
+}
+
+void Shader::setUniformVec3(UniformSlot slot, const vec3 & value)
+{
+    ASSERT(mIsLoaded);
+    if (mSlotLocations[slot] >= 0)
+        glUniform3fv(mSlotLocations[slot], 1, value_ptr(value));
+}
+
+void Shader::setUniformMat3(UniformSlot slot, const mat3 & value)
+{
+    ASSERT(mIsLoaded);
+    if (mSlotLocations[slot] >= 0)
+        glUniformMatrix3fv(mSlotLocations[slot], 1, 0, value_ptr(value));
+}
+
+void Shader::setUniformMat4(UniformSlot slot, const mat4 & value)
+{
+    ASSERT(mIsLoaded);
+    if (mSlotLocations[slot] >= 0)
+        glUniformMatrix4fv(mSlotLocations[slot], 1, 0, value_ptr(value));
+    else
+        ERR("UniformMat4 slot %u does not exist in shader", slot);
+}
+
 void Shader::setTextureUniforms()
 {
     for (u32 i = 0; i < mTextureCount; ++i)
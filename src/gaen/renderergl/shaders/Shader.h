@@ -43,6 +43,43 @@ namespace gaen
 namespace shaders
 {
 
+// Uniforms the renderer sets on every draw or instanced batch. Their
+// locations are resolved once when the program links, so per draw sets
+// index an array rather than searching the uniform list.
+enum UniformSlot
+{
+    kUS_mvp = 0,
+    kUS_rot,
+    kUS_frame_offset,
+    kUS_view_proj,
+    kUS_pos_bias,
+    kUS_pos_scale,
+    kUS_oct_normals,
+
+    kUS_COUNT
+};
+
+// Uniform block binding points, must match layout(binding = N) in shader code
+enum UniformBlockBinding
+{
+    kUBB_Lights = 0
+};
+
+// std140 layout of the Lights uniform block
+struct LightsBlock
+{
+    vec3 light0_incidence;
+    f32 light0_ambient;
+    vec3 light0_color;
+    f32 pad0;
+
+    vec3 light1_incidence;
+    f32 light1_ambient;
+    vec3 light1_color;
+    f32 pad1;
+};
+static_assert(sizeof(LightsBlock) == 64, "LightsBlock must match std140 layout of Lights uniform block");
+
 class Shader
 {
 public:
@@ -64,10 +101,16 @@ public:
     void setUniformMat3(u32 nameHash, const mat3 & value);
     void setUniformMat4(u32 nameHash, const mat4 & value);
 
+    void setUniformUint(UniformSlot slot, u32 value);
+    void setUniformVec3(UniformSlot slot, const vec3 & value);
+    void setUniformMat3(UniformSlot slot, const mat3 & value);
+    void setUniformMat4(UniformSlot slot, const mat4 & value);
+
     void setTextureUniforms();
     i32 textureUnit(i32 nameHash);
 
     bool hasUniform(u32 nameHash, u32 type);
+    bool hasUniform(UniformSlot slot) const { return mSlotLocations[slot] >= 0; }
 
     static bool compile_shader(GLuint * pShader, GLenum type, const char * shaderCode, const char * headerCode = nullptr);
 
@@ -105,6 +148,8 @@ protected:
     VariableInfo * mpAttributes;
     VariableInfo * mpTextures;
 
+    i32 mSlotLocations[kUS_COUNT];
+
     bool mIsLoaded = false;
 
 }; // class Shader
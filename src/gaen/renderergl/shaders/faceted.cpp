@@ -39,21 +39,30 @@ static const char * kShaderCode_shv =
     "layout(location = 1) in vec3 normal;\n"
     "layout(location = 2) in vec4 color;\n"
     "\n"
-    "uniform mat4 mvp;\n"
-    "uniform mat3 rot;\n"
+    "uniform mat4 view_proj;\n"
     "\n"
-    "uniform vec3 light0_incidence;\n"
-    "uniform vec3 light0_color;\n"
-    "uniform float light0_ambient;\n"
+    "// Per instance, streamed from the renderer's instance buffer, see InstanceData\n"
+    "layout(location = 8) in mat4x3 inst_transform;\n"
     "\n"
-    "uniform vec3 light1_incidence;\n"
-    "uniform vec3 light1_color;\n"
-    "uniform float light1_ambient;\n"
+    "// Set once per stage, see shaders::LightsBlock\n"
+    "layout(std140, binding = 0) uniform Lights\n"
+    "{\n"
+    "    vec3 light0_incidence;\n"
+    "    float light0_ambient;\n"
+    "    vec3 light0_color;\n"
+    "\n"
+    "    vec3 light1_incidence;\n"
+    "    float light1_ambient;\n"
+    "    vec3 light1_color;\n"
+    "};\n"
     "\n"
     "out vec4 oicolor;\n"
     "\n"
     "void main()\n"
     "{\n"
+    "    mat4 model = mat4(inst_transform);\n"
+    "    mat3 rot = mat3(model);\n"
+    "\n"
     "    vec3 normalTrans = normalize(rot * normal);\n"
     "\n"
     "    float intensity = max(dot(normalTrans, light0_incidence), 0.0);\n"
@@ -71,7 +80,7 @@ static const char * kShaderCode_shv =
     "\n"
     "    oicolor = vec4(pow(linearcolor, gamma), color.a);\n"
     "\n"
-    "    gl_Position = mvp * position;\n"
+    "    gl_Position = view_proj * model * position;\n"
     "};\n"
     "\n"
     "\n"
@@ -35,13 +35,16 @@ namespace shaders
 static const char * kShaderCode_shv =
     "layout(location = 0) in vec4 pos;\n"
     "\n"
-    "layout(location = 1) uniform mat4 mvp;\n"
+    "layout(location = 1) uniform mat4 view_proj;\n"
+    "\n"
+    "// Per instance, streamed from the renderer's instance buffer, see InstanceData\n"
+    "layout(location = 8) in mat4x3 inst_transform;\n"
     "\n"
     "out vec2 oiuv;\n"
     "\n"
     "void main()\n"
     "{\n"
-    "    gl_Position = mvp * vec4(pos.xy, 0.0, 1.0);\n"
+    "    gl_Position = view_proj * mat4(inst_transform) * vec4(pos.xy, 0.0, 1.0);\n"
     "    oiuv = pos.zw;\n"
     "};\n"
     ; // kShaderCode_shv (END)
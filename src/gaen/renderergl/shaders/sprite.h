@@ -41,7 +41,7 @@ private:
 
     static const u32 kCodeCount = 2;
     static const u32 kUniformCount = 2;
-    static const u32 kAttributeCount = 1;
+    static const u32 kAttributeCount = 2;
     static const u32 kTextureCount = 1;
 
     Shader::ShaderCode mCodes[kCodeCount];
@@ -40,18 +40,29 @@ static const char * kShaderCode_shv =
     "layout(location = 2) in vec2 vert_uv;\n"
     "layout(location = 3) in uint bone_id;\n"
     "\n"
-    "uniform mat4 mvp;\n"
-    "uniform mat3 rot;\n"
+    "uniform mat4 view_proj;\n"
     "\n"
-    "uniform uint frame_offset;\n"
+    "// Vertex decode, set per model by ModelGL. Quantized positions are\n"
+    "// snorm16 within pos_bias +/- pos_scale and normals are octahedral.\n"
+    "uniform vec3 pos_bias;\n"
+    "uniform vec3 pos_scale;\n"
+    "uniform uint oct_normals;\n"
     "\n"
-    "uniform vec3 light0_incidence;\n"
-    "uniform vec3 light0_color;\n"
-    "uniform float light0_ambient;\n"
+    "// Per instance, streamed from the renderer's instance buffer, see InstanceData\n"
+    "layout(location = 8) in mat4x3 inst_transform;\n"
+    "layout(location = 12) in uint inst_frame_offset;\n"
     "\n"
-    "uniform vec3 light1_incidence;\n"
-    "uniform vec3 light1_color;\n"
-    "uniform float light1_ambient;\n"
+    "// Set once per stage, see shaders::LightsBlock\n"
+    "layout(std140, binding = 0) uniform Lights\n"
+    "{\n"
+    "    vec3 light0_incidence;\n"
+    "    float light0_ambient;\n"
+    "    vec3 light0_color;\n"
+    "\n"
+    "    vec3 light1_incidence;\n"
+    "    float light1_ambient;\n"
+    "    vec3 light1_color;\n"
+    "};\n"
     "\n"
     "uniform sampler2D animations;\n"
     "uniform sampler2D diffuse;\n"
@@ -66,19 +77,36 @@ static const char * kShaderCode_shv =
     "    return vec2((offset % sz.x) / float(sz.x), (offset / sz.x) / float(sz.y));\n"
     "}\n"
     "\n"
+    "vec3 decode_normal()\n"
+    "{\n"
+    "    if (oct_normals == 0u)\n"
+    "        return normal;\n"
+    "    vec3 n = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));\n"
+    "    float t = max(-n.z, 0.0);\n"
+    "    n.x += n.x >= 0.0 ? -t : t;\n"
+    "    n.y += n.y >= 0.0 ? -t : t;\n"
+    "    return normalize(n);\n"
+    "}\n"
+    "\n"
     "void main()\n"
     "{\n"
+    "    vec4 vert_pos = vec4(pos_bias + pos_scale * position.xyz, 1.0);\n"
+    "    vec3 vert_normal = decode_normal();\n"
+    "\n"
+    "    mat4 model = mat4(inst_transform);\n"
+    "    mat3 rot = mat3(model);\n"
+    "\n"
     "    frag_uv = vert_uv * textureSize(diffuse, 0);\n"
     "\n"
-    "    vec4 anim0 = texture(animations, trans_coords(frame_offset + bone_id * 3));\n"
-    "    vec4 anim1 = texture(animations, trans_coords(frame_offset + bone_id * 3 + 1));\n"
-    "    vec4 anim2 = texture(animations, trans_coords(frame_offset + bone_id * 3 + 2));\n"
+    "    vec4 anim0 = texture(animations, trans_coords(inst_frame_offset + bone_id * 3));\n"
+    "    vec4 anim1 = texture(animations, trans_coords(inst_frame_offset + bone_id * 3 + 1));\n"
+    "    vec4 anim2 = texture(animations, trans_coords(inst_frame_offset + bone_id * 3 + 2));\n"
     "\n"
     "    mat3 normal_trans = mat3(vec3(anim0.x, anim0.y, anim0.z),\n"
     "                             vec3(anim0.w, anim1.x, anim1.y),\n"
     "                             vec3(anim1.z, anim1.w, anim2.x));\n"
     "\n"
-    "    vec3 normal_corrected = normalize(rot * normal_trans * normal);\n"
+    "    vec3 normal_corrected = normalize(rot * normal_trans * vert_normal);\n"
     "    light0 = max(dot(normal_corrected, light0_incidence), 0.0) * light0_color + light0_ambient * light0_color;\n"
     "    light1 = max(dot(normal_corrected, light1_incidence), 0.0) * light1_color + light1_ambient * light1_color;\n"
     "\n"
@@ -88,7 +116,7 @@ static const char * kShaderCode_shv =
     "                         vec4(anim1.z, anim1.w, anim2.x, 0),\n"
     "                         vec4(anim2.y, anim2.z, anim2.w, 1));\n"
     "\n"
-    "    gl_Position = mvp * bone_trans * position;\n"
+    "    gl_Position = view_proj * model * bone_trans * vert_pos;\n"
     "};\n"
     "\n"
     "\n"
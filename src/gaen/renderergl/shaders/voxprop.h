@@ -40,8 +40,8 @@ private:
     voxprop() : Shader(0xb4797a4f /* HASH::voxprop */) {}
 
     static const u32 kCodeCount = 2;
-    static const u32 kUniformCount = 6;
-    static const u32 kAttributeCount = 3;
+    static const u32 kUniformCount = 8;
+    static const u32 kAttributeCount = 4;
     static const u32 kTextureCount = 1;
 
     Shader::ShaderCode mCodes[kCodeCount];
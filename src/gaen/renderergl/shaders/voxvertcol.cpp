@@ -39,24 +39,53 @@ static const char * kShaderCode_shv =
     "layout(location = 1) in vec3 normal;\n"
     "layout(location = 2) in vec4 vert_color;\n"
     "\n"
-    "uniform mat4 mvp;\n"
-    "uniform mat3 rot;\n"
+    "uniform mat4 view_proj;\n"
     "\n"
-    "uniform vec3 light0_incidence;\n"
-    "uniform vec3 light0_color;\n"
-    "uniform float light0_ambient;\n"
+    "// Vertex decode, set per model by ModelGL. Quantized positions are\n"
+    "// snorm16 within pos_bias +/- pos_scale and normals are octahedral.\n"
+    "uniform vec3 pos_bias;\n"
+    "uniform vec3 pos_scale;\n"
+    "uniform uint oct_normals;\n"
+    "\n"
+    "// Per instance, streamed from the renderer's instance buffer, see InstanceData\n"
+    "layout(location = 8) in mat4x3 inst_transform;\n"
     "\n"
-    "uniform vec3 light1_incidence;\n"
-    "uniform vec3 light1_color;\n"
-    "uniform float light1_ambient;\n"
+    "// Set once per stage, see shaders::LightsBlock\n"
+    "layout(std140, binding = 0) uniform Lights\n"
+    "{\n"
+    "    vec3 light0_incidence;\n"
+    "    float light0_ambient;\n"
+    "    vec3 light0_color;\n"
+    "\n"
+    "    vec3 light1_incidence;\n"
+    "    float light1_ambient;\n"
+    "    vec3 light1_color;\n"
+    "};\n"
     "\n"
     "out vec4 color;\n"
     "\n"
+    "vec3 decode_normal()\n"
+    "{\n"
+    "    if (oct_normals == 0u)\n"
+    "        return normal;\n"
+    "    vec3 n = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));\n"
+    "    float t = max(-n.z, 0.0);\n"
+    "    n.x += n.x >= 0.0 ? -t : t;\n"
+    "    n.y += n.y >= 0.0 ? -t : t;\n"
+    "    return normalize(n);\n"
+    "}\n"
+    "\n"
     "void main()\n"
     "{\n"
+    "    vec4 vert_pos = vec4(pos_bias + pos_scale * position.xyz, 1.0);\n"
+    "    vec3 vert_normal = decode_normal();\n"
+    "\n"
+    "    mat4 model = mat4(inst_transform);\n"
+    "    mat3 rot = mat3(model);\n"
+    "\n"
     "    const vec3 gamma = vec3(1.0/2.2);\n"
     "\n"
-    "    vec3 normal_corrected = normalize(rot * normal);\n"
+    "    vec3 normal_corrected = normalize(rot * vert_normal);\n"
     "\n"
     "    vec3 light = vec3(0.0);\n"
     "    light += max(dot(normal_corrected, light0_incidence), 0.0) * light0_color + light0_ambient * light0_color;\n"
@@ -65,7 +94,7 @@ static const char * kShaderCode_shv =
     "    vec3 linearcolor = light * vert_color.xyz;\n"
     "    color = vec4(pow(linearcolor, gamma), vert_color.a);\n"
     "\n"
-    "    gl_Position = mvp * position;\n"
+    "    gl_Position = view_proj * model * vert_pos;\n"
     "};\n"
     "\n"
     "\n"
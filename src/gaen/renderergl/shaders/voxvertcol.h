@@ -40,8 +40,8 @@ private:
     voxvertcol() : Shader(0x159d2745 /* HASH::voxvertcol */) {}
 
     static const u32 kCodeCount = 2;
-    static const u32 kUniformCount = 5;
-    static const u32 kAttributeCount = 3;
+    static const u32 kUniformCount = 7;
+    static const u32 kAttributeCount = 4;
     static const u32 kTextureCount = 0;
 
     Shader::ShaderCode mCodes[kCodeCount];
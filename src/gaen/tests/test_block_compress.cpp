@@ -0,0 +1,272 @@
+//------------------------------------------------------------------------------
+// test_block_compress.cpp - Tests for mip chains and BC1/BC3 compression
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/assets/BlockCompress.h"
+#include "gaen/assets/Gimg.h"
+
+using namespace gaen;
+
+namespace
+{
+
+// Smooth gradients with some noise, roughly what photo-like textures
+// give the encoder.
+std::vector<u8> test_image(u32 width, u32 height, bool varyAlpha)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> noise(-6, 6);
+    std::vector<u8> rgba(width * height * 4);
+    for (u32 y = 0; y < height; ++y)
+    {
+        for (u32 x = 0; x < width; ++x)
+        {
+            u8 * pTex = &rgba[(y * width + x) * 4];
+            int r = (int)(255.0f * x / width) + noise(rng);
+            int g = (int)(127.5f + 127.5f * std::sin(y * 0.05f)) + noise(rng);
+            int b = (int)(255.0f * (x + y) / (width + height)) + noise(rng);
+            int a = varyAlpha ? (int)(255.0f * y / height) : 255;
+            pTex[0] = (u8)std::min(std::max(r, 0), 255);
+            pTex[1] = (u8)std::min(std::max(g, 0), 255);
+            pTex[2] = (u8)std::min(std::max(b, 0), 255);
+            pTex[3] = (u8)a;
+        }
+    }
+    return rgba;
+}
+
+std::vector<u8> decode(const std::vector<u8> & blocks, PixelFormat pixelFormat, u32 width, u32 height)
+{
+    std::vector<u8> rgba(width * height * 4);
+    u32 blockBytes = block_compressed_bytes(pixelFormat);
+    u32 blocksX = width / 4;
+    for (u32 by = 0; by < height / 4; ++by)
+    {
+        for (u32 bx = 0; bx < blocksX; ++bx)
+        {
+            const u8 * pBlock = &blocks[(by * blocksX + bx) * blockBytes];
+            u8 * pOut = &rgba[(by * 4 * width + bx * 4) * 4];
+            if (pixelFormat == kPXL_RGBA_DXT5)
+                decode_bc3_block(pOut, width * 4, pBlock);
+            else
+                decode_bc1_block(pOut, width * 4, pBlock);
+        }
+    }
+    return rgba;
+}
+
+f64 psnr(const std::vector<u8> & a, const std::vector<u8> & b, u32 channels)
+{
+    f64 sum = 0.0;
+    u64 count = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (i % 4 >= channels)
+            continue;
+        f64 d = (f64)a[i] - (f64)b[i];
+        sum += d * d;
+        count++;
+    }
+    f64 mse = sum / count;
+    return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+} // namespace
+
+TEST(BlockCompressTest, Bc1RoundTrip)
+{
+    static const u32 kSize = 256;
+    std::vector<u8> src = test_image(kSize, kSize, false);
+    std::vector<u8> blocks(Gimg::level_size(kPXL_RGB_DXT1, kSize, kSize));
+    block_compress(blocks.data(), kPXL_RGB_DXT1, src.data(), kSize, kSize, 1);
+
+    std::vector<u8> out = decode(blocks, kPXL_RGB_DXT1, kSize, kSize);
+    EXPECT_GT(psnr(src, out, 3), 32.0);
+    EXPECT_EQ(blocks.size() * 8, src.size());
+}
+
+TEST(BlockCompressTest, Bc3RoundTrip)
+{
+    static const u32 kSize = 256;
+    std::vector<u8> src = test_image(kSize, kSize, true);
+    std::vector<u8> blocks(Gimg::level_size(kPXL_RGBA_DXT5, kSize, kSize));
+    block_compress(blocks.data(), kPXL_RGBA_DXT5, src.data(), kSize, kSize, 1);
+
+    std::vector<u8> out = decode(blocks, kPXL_RGBA_DXT5, kSize, kSize);
+    EXPECT_GT(psnr(src, out, 3), 32.0);
+    EXPECT_EQ(blocks.size() * 4, src.size());
+
+    // Alpha only, via the 4th channel of each texel
+    f64 sum = 0.0;
+    for (size_t i = 3; i < src.size(); i += 4)
+        sum += ((f64)src[i] - out[i]) * ((f64)src[i] - out[i]);
+    f64 alphaPsnr = 10.0 * std::log10(255.0 * 255.0 / (sum / (src.size() / 4)));
+    EXPECT_GT(alphaPsnr, 40.0);
+}
+
+TEST(BlockCompressTest, SolidBlocksAreExact)
+{
+    u8 texels[64];
+    for (u32 i = 0; i < 16; ++i)
+    {
+        texels[i * 4 + 0] = 255;
+        texels[i * 4 + 1] = 0;
+        texels[i * 4 + 2] = 255;
+        texels[i * 4 + 3] = i < 8 ? 0 : 255;
+    }
+
+    u8 block[16];
+    encode_bc3_block(block, texels, 16);
+    u8 out[64];
+    decode_bc3_block(out, 16, block);
+    EXPECT_EQ(0, memcmp(texels, out, sizeof(out)));
+}
+
+TEST(BlockCompressTest, SimdMatchesScalar)
+{
+    static const u32 kSize = 64;
+    std::vector<u8> src = test_image(kSize, kSize, true);
+    for (u32 by = 0; by < kSize / 4; ++by)
+    {
+        for (u32 bx = 0; bx < kSize / 4; ++bx)
+        {
+            const u8 * pSrc = &src[(by * 4 * kSize + bx * 4) * 4];
+            u8 simd[16], scalar[16];
+            encode_bc1_block(simd, pSrc, kSize * 4);
+            encode_bc1_block_scalar(scalar, pSrc, kSize * 4);
+            EXPECT_EQ(0, memcmp(simd, scalar, 8));
+            encode_bc3_block(simd, pSrc, kSize * 4);
+            encode_bc3_block_scalar(scalar, pSrc, kSize * 4);
+            EXPECT_EQ(0, memcmp(simd, scalar, 16));
+        }
+    }
+}
+
+TEST(BlockCompressTest, ThreadedMatchesSingle)
+{
+    static const u32 kSize = 200; // not a multiple of 4
+    std::vector<u8> src = test_image(kSize, kSize, true);
+    std::vector<u8> single(Gimg::level_size(kPXL_RGBA_DXT5, kSize, kSize));
+    std::vector<u8> threaded(single.size());
+    block_compress(single.data(), kPXL_RGBA_DXT5, src.data(), kSize, kSize, 1);
+    block_compress(threaded.data(), kPXL_RGBA_DXT5, src.data(), kSize, kSize, 0);
+    EXPECT_EQ(single, threaded);
+}
+
+TEST(BlockCompressTest, MipChainSizes)
+{
+    EXPECT_EQ(Gimg::full_mip_count(256, 64), 9u);
+    EXPECT_EQ(Gimg::full_mip_count(1, 1), 1u);
+
+    // 256x64 + 128x32 + ... + 1x1
+    u64 rgbaLevels = 0;
+    for (u32 w = 256, h = 64; ; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+    {
+        rgbaLevels += w * h * 4;
+        if (w == 1 && h == 1)
+            break;
+    }
+    EXPECT_EQ(Gimg::required_size(kPXL_RGBA8, 256, 64, 9) - Gimg::required_size(kPXL_RGBA8, 256, 64, 1),
+              rgbaLevels - 256 * 64 * 4);
+
+    // Levels smaller than a block still take a whole one
+    EXPECT_EQ(Gimg::level_size(kPXL_RGB_DXT1, 2, 1), 8u);
+    EXPECT_EQ(Gimg::level_size(kPXL_RGBA_DXT5, 8, 6), 64u);
+}
+
+TEST(BlockCompressTest, MipChainFilter)
+{
+    static const u32 kSize = 32;
+    Gimg * pGimg = Gimg::create(kPXL_RGBA8, kSize, kSize, 0);
+    Scoped_GFREE<Gimg> pGimg_sp(pGimg);
+
+    // Left half opaque red, right half fully clear green
+    for (u32 y = 0; y < kSize; ++y)
+    {
+        for (u32 x = 0; x < kSize; ++x)
+        {
+            u8 * pTex = pGimg->scanline(y) + x * 4;
+            bool left = x < kSize / 2;
+            pTex[0] = left ? 255 : 0;
+            pTex[1] = left ? 0 : 255;
+            pTex[2] = 0;
+            pTex[3] = left ? 255 : 0;
+        }
+    }
+
+    Gimg * pMips;
+    pGimg->buildMipChain(&pMips, kMEM_Texture);
+    Scoped_GFREE<Gimg> pMips_sp(pMips);
+
+    ASSERT_EQ(pMips->mipCount(), 6u);
+    EXPECT_EQ(0, memcmp(pMips->mipPixels(0), pGimg->pixels(), kSize * kSize * 4));
+
+    const u8 * pLast = pMips->mipPixels(5);
+    EXPECT_EQ(pMips->mipWidth(5), 1u);
+    EXPECT_NEAR(pLast[3], 128, 1);
+
+    // Clear green texels don't bleed into the visible red
+    EXPECT_EQ(pLast[1], 0u);
+    EXPECT_EQ(pLast[0], 255u);
+
+    // Compression keeps every level
+    Gimg * pBc;
+    pMips->convertFormat(&pBc, kMEM_Texture, kPXL_RGBA_DXT5);
+    Scoped_GFREE<Gimg> pBc_sp(pBc);
+    EXPECT_EQ(pBc->mipCount(), 6u);
+    EXPECT_EQ(pBc->pixelsSize(), (64u + 16u + 4u + 1u + 1u + 1u) * 16u); // 2x2 and 1x1 levels pad to a block
+}
+
+TEST(BlockCompressTest, DISABLED_EncoderBenchmark)
+{
+    static const u32 kSize = 1024;
+    std::vector<u8> src = test_image(kSize, kSize, true);
+    std::vector<u8> blocks(Gimg::level_size(kPXL_RGBA_DXT5, kSize, kSize));
+    f64 mpix = (f64)kSize * kSize / 1000000.0;
+
+    auto time = [&](PixelFormat pixelFormat, u32 threadCount)
+    {
+        auto start = std::chrono::steady_clock::now();
+        block_compress(blocks.data(), pixelFormat, src.data(), kSize, kSize, threadCount);
+        auto end = std::chrono::steady_clock::now();
+        return mpix / std::chrono::duration<f64>(end - start).count();
+    };
+
+    printf("%ux%u texture, %.2f MB as RGBA8\n", kSize, kSize, src.size() / (1024.0 * 1024.0));
+    printf("  BC1 %.2f MB, 1 thread: %7.1f MPix/s, all cores: %7.1f MPix/s\n",
+           Gimg::level_size(kPXL_RGB_DXT1, kSize, kSize) / (1024.0 * 1024.0),
+           time(kPXL_RGB_DXT1, 1), time(kPXL_RGB_DXT1, 0));
+    printf("  BC3 %.2f MB, 1 thread: %7.1f MPix/s, all cores: %7.1f MPix/s\n",
+           Gimg::level_size(kPXL_RGBA_DXT5, kSize, kSize) / (1024.0 * 1024.0),
+           time(kPXL_RGBA_DXT5, 1), time(kPXL_RGBA_DXT5, 0));
+}
@@ -0,0 +1,254 @@
+//------------------------------------------------------------------------------
+// test_codegen_bytecode.cpp - Tests for compiling Compose to ScriptVm bytecode
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/core/mem.h"
+#include "gaen/hashes/hashes.h"
+#include "gaen/assets/file_utils.h"
+#include "gaen/compose/compiler.h"
+#include "gaen/compose/compiler_structs.h"
+#include "gaen/compose/CodegenBytecode.h"
+#include "gaen/engine/ScriptVm.h"
+
+using namespace gaen;
+
+static std::vector<std::string> sErrors;
+
+static void message_handler(MessageType messageType,
+                            const char * message,
+                            const char * filename,
+                            int line,
+                            int column)
+{
+    if (messageType == kMSGT_Error)
+        sErrors.push_back(message);
+}
+
+static bool has_error(const char * substr)
+{
+    for (const std::string & err : sErrors)
+    {
+        if (err.find(substr) != std::string::npos)
+            return true;
+    }
+    return false;
+}
+
+// Scripts must live under a scripts/cmp directory
+static ParseData * parse_source(const char * name, const char * source)
+{
+    std::string dir = testing::TempDir() + "scripts/cmp/vmtest";
+    make_dirs(dir.c_str());
+    std::string path = dir + "/" + name + ".cmp";
+
+    FILE * pFile = fopen(path.c_str(), "wb");
+    if (!pFile)
+        return nullptr;
+    fputs(source, pFile);
+    fclose(pFile);
+
+    parse_init();
+    sErrors.clear();
+    static CompList<CompString> sIncludes;
+    return parse_file(path.c_str(), &sIncludes, &message_handler);
+}
+
+// Cell address codegen gave a component's property or field
+static u32 cell_address(const ParseData * pParseData, const char * name)
+{
+    for (const Ast * pDef : pParseData->pRootAst->pChildren->nodes)
+    {
+        if (pDef->type != kAST_ComponentDef)
+            continue;
+        for (const Ast * pChild : pDef->pChildren->nodes)
+        {
+            if (pChild->pSymRec && 0 == strcmp(pChild->pSymRec->name, name))
+            {
+                const BlockInfo * pBlockInfo = pDef->pBlockInfos->find(pChild);
+                if (pBlockInfo)
+                    return pBlockInfo->blockIndex * kCellsPerBlock + pBlockInfo->cellIndex;
+            }
+        }
+    }
+    ADD_FAILURE() << "No cell for " << name;
+    return 0;
+}
+
+struct RunFrame
+{
+    Block blocks[4];
+    Block msgBlocks[2];
+    ScriptVmFrame frame;
+
+    RunFrame()
+    {
+        memset(blocks, 0, sizeof(blocks));
+        memset(msgBlocks, 0, sizeof(msgBlocks));
+        memset(&frame, 0, sizeof(frame));
+        frame.pCells = reinterpret_cast<cell*>(blocks);
+        frame.cellCount = 4 * kCellsPerBlock;
+        frame.pMsgCells = reinterpret_cast<cell*>(msgBlocks);
+        frame.msgCellCount = 2 * kCellsPerBlock;
+    }
+
+    cell & operator[](u32 idx) { return frame.pCells[idx]; }
+};
+
+TEST(CodegenBytecodeTest, ComponentRuns)
+{
+    static const char * kSource =
+        "component Counter\n"
+        "{\n"
+        "    int #step = 2;\n"
+        "    int count = 0;\n"
+        "    float total = 0.0;\n"
+        "\n"
+        "    #add(int n)\n"
+        "    {\n"
+        "        for (int i = 0; i < n; ++i)\n"
+        "        {\n"
+        "            count += step;\n"
+        "        }\n"
+        "        total = clamp(total + 4.0, 0.0, 10.0);\n"
+        "    }\n"
+        "\n"
+        "    update\n"
+        "    {\n"
+        "        if (count > 5)\n"
+        "            total += delta;\n"
+        "    }\n"
+        "}\n";
+
+    ParseData * pParseData = parse_source("counter", kSource);
+    ASSERT_NE(pParseData, nullptr);
+    ASSERT_TRUE(sErrors.empty()) << sErrors.front();
+
+    CodegenBytecode codegen;
+    CodegenBytecode::CodeBytecodeList programs = codegen.codegen(pParseData);
+    ASSERT_TRUE(sErrors.empty()) << sErrors.front();
+    ASSERT_EQ(programs.size(), 1u);
+    EXPECT_STREQ(programs[0].name.c_str(), "vmtest.counter.Counter");
+
+    ScriptProgram * pProgram = ScriptProgram::create(programs[0].cells.data(), (u32)programs[0].cells.size());
+    ASSERT_NE(pProgram, nullptr);
+    EXPECT_TRUE(pProgram->isUpdatable());
+
+    u32 step = cell_address(pParseData, "step");
+    u32 count = cell_address(pParseData, "count");
+    u32 total = cell_address(pParseData, "total");
+
+    RunFrame rf;
+    script_vm_run(*pProgram, pProgram->initEntry(), rf.frame);
+    EXPECT_EQ(rf[step].i, 2);
+    EXPECT_EQ(rf[count].i, 0);
+
+    const ScriptProgramHandler * pAdd = pProgram->findHandler(HASH::hash_func("add"));
+    ASSERT_NE(pAdd, nullptr);
+
+    // n may be packed in the payload or the first message cell
+    rf.frame.payload.i = 3;
+    rf.msgBlocks[0].cells[0].i = 3;
+    script_vm_run(*pProgram, pAdd->entry, rf.frame);
+    EXPECT_EQ(rf[count].i, 6);
+    EXPECT_FLOAT_EQ(rf[total].f, 4.0f);
+
+    script_vm_run(*pProgram, pAdd->entry, rf.frame);
+    script_vm_run(*pProgram, pAdd->entry, rf.frame);
+    EXPECT_EQ(rf[count].i, 18);
+    EXPECT_FLOAT_EQ(rf[total].f, 10.0f);
+
+    rf.frame.regs[kVmDeltaReg].f = -0.5f;
+    script_vm_run(*pProgram, pProgram->updateEntry(), rf.frame);
+    EXPECT_FLOAT_EQ(rf[total].f, 9.5f);
+
+    // Property setters take the value from the message
+    const ScriptProgramHandler * pStep = pProgram->findHandler(HASH::hash_func("step"));
+    ASSERT_NE(pStep, nullptr);
+    rf.frame.payload.i = 5;
+    rf.msgBlocks[0].cells[0].i = 5;
+    script_vm_run(*pProgram, pStep->entry, rf.frame);
+    EXPECT_EQ(rf[step].i, 5);
+
+    GDELETE(pProgram);
+}
+
+TEST(CodegenBytecodeTest, EntitiesAreErrors)
+{
+    static const char * kSource =
+        "entity Thing\n"
+        "{\n"
+        "    int count = 0;\n"
+        "}\n";
+
+    ParseData * pParseData = parse_source("thing", kSource);
+    ASSERT_NE(pParseData, nullptr);
+    ASSERT_TRUE(sErrors.empty()) << sErrors.front();
+
+    CodegenBytecode codegen;
+    CodegenBytecode::CodeBytecodeList programs = codegen.codegen(pParseData);
+    EXPECT_TRUE(programs.empty());
+    EXPECT_TRUE(has_error("Entity vmtest.thing.Thing not supported"));
+}
+
+TEST(CodegenBytecodeTest, UnsupportedSyscallsAreErrors)
+{
+    static const char * kSource =
+        "component Printer\n"
+        "{\n"
+        "    #go()\n"
+        "    {\n"
+        "        print(\"hello\");\n"
+        "    }\n"
+        "}\n";
+
+    ParseData * pParseData = parse_source("printer", kSource);
+    ASSERT_NE(pParseData, nullptr);
+    ASSERT_TRUE(sErrors.empty()) << sErrors.front();
+
+    CodegenBytecode codegen;
+    codegen.codegen(pParseData);
+    EXPECT_TRUE(has_error("System call print not supported"));
+}
+
+TEST(CodegenBytecodeTest, SyscallTableSignatures)
+{
+    for (const ScriptSyscallDesc & desc : kScriptSyscalls)
+    {
+        size_t len = strlen(desc.signature);
+        ASSERT_GE(len, 1u) << desc.name;
+        EXPECT_LE(len - 1, kVmArgRegCount) << desc.name;
+        EXPECT_NE(strchr("vifb", desc.signature[0]), nullptr) << desc.name;
+        for (size_t i = 1; i < len; ++i)
+            EXPECT_NE(strchr("ifb", desc.signature[i]), nullptr) << desc.name;
+        EXPECT_EQ(find_script_syscall(desc.name), &desc);
+    }
+}
@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// test_config.cpp - Tests for Config
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "gaen/assets/Config.h"
+
+using namespace gaen;
+
+typedef Config<kMEM_Chef> TestConfig;
+
+static void read_config(TestConfig & conf, const char * text)
+{
+    std::istringstream input(text);
+    ASSERT_TRUE(conf.read(input));
+}
+
+// This is how a .qbt's recipe reaches the .obj files it exports:
+// the parent's keys come first, then the child's own recipes win.
+TEST(ConfigTest, OverlayKeepsParentKeys)
+{
+    TestConfig parent;
+    read_config(parent,
+                "quantize = true\n"
+                "scale = 2\n"
+                "[anim]\n"
+                "fps = 30\n");
+
+    TestConfig child;
+    child.overlay(parent);
+    read_config(child, "scale = 4\n");
+
+    EXPECT_TRUE(child.getBool("quantize"));
+    EXPECT_EQ(4, child.getInt("scale"));
+    EXPECT_EQ(30, child.getInt("anim", "fps"));
+    EXPECT_EQ(2, parent.getInt("scale"));
+}
+
+TEST(ConfigTest, OverlayEmpty)
+{
+    TestConfig parent;
+    TestConfig child;
+    child.overlay(parent);
+
+    EXPECT_EQ(0u, child.sectionCount());
+    EXPECT_FALSE(child.hasKey("quantize"));
+}
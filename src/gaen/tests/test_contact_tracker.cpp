@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+// test_contact_tracker.cpp - Tests for contact begin/persist/end tracking
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <cstdio>
+#include <functional>
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/ContactTracker.h"
+
+using namespace gaen;
+
+namespace
+{
+
+struct Body
+{
+    u32 id;
+};
+
+struct EndCounter
+{
+    u32 count = 0;
+    void operator()(const Body *, const Body *, const ContactInfo &) { count++; }
+};
+
+} // namespace
+
+TEST(ContactTrackerTest, BeginPersistEnd)
+{
+    Body a{0}, b{1}, c{2};
+    ContactTracker<Body> tracker;
+    ContactInfo info;
+
+    EXPECT_EQ(tracker.touch(&a, &b, info), ContactPhase::Begin);
+    // same pair, either order, is the same contact
+    EXPECT_EQ(tracker.touch(&b, &a, info), ContactPhase::Persist);
+    EXPECT_EQ(tracker.touch(&a, &c, info), ContactPhase::Begin);
+    EXPECT_EQ(tracker.contactCount(), 2u);
+
+    EndCounter ends;
+    tracker.endTick(std::ref(ends));
+    EXPECT_EQ(ends.count, 0u);
+
+    // only a and b still touch
+    EXPECT_EQ(tracker.touch(&a, &b, info), ContactPhase::Persist);
+    tracker.endTick([&](const Body * pA, const Body * pB, const ContactInfo &)
+    {
+        ends.count++;
+        EXPECT_TRUE((pA == &a && pB == &c) || (pA == &c && pB == &a));
+    });
+    EXPECT_EQ(ends.count, 1u);
+    EXPECT_EQ(tracker.contactCount(), 1u);
+
+    // nothing touches
+    tracker.endTick(std::ref(ends));
+    EXPECT_EQ(ends.count, 2u);
+    EXPECT_EQ(tracker.contactCount(), 0u);
+
+    // touching again is a new contact
+    EXPECT_EQ(tracker.touch(&a, &b, info), ContactPhase::Begin);
+}
+
+TEST(ContactTrackerTest, RemoveBody)
+{
+    Body a{0}, b{1}, c{2};
+    ContactTracker<Body> tracker;
+    ContactInfo info;
+
+    tracker.touch(&a, &b, info);
+    tracker.touch(&b, &c, info);
+    tracker.touch(&a, &c, info);
+
+    EndCounter ends;
+    tracker.removeBody(&b, std::ref(ends));
+    EXPECT_EQ(ends.count, 2u);
+    EXPECT_EQ(tracker.contactCount(), 1u);
+
+    // removed contacts don't end a second time
+    tracker.touch(&a, &c, info);
+    tracker.endTick(std::ref(ends));
+    EXPECT_EQ(ends.count, 2u);
+}
+
+// A stack of boxes settling then resting for a few seconds, the way
+// ModelPhysics sees it: each resting pair has a manifold with four
+// penetrating points every tick. Previously every point of every
+// manifold sent a message to both bodies each tick.
+TEST(ContactTrackerTest, RestingStackMessageCount)
+{
+    static const u32 kStacks = 64;
+    static const u32 kHeight = 8;
+    static const u32 kTicks = 60 * 5;
+    static const u32 kPointsPerManifold = 4;
+
+    Vector<kMEM_Physics, Body> bodies;
+    bodies.resize(kStacks * (kHeight + 1));
+    for (u32 i = 0; i < bodies.size(); ++i)
+        bodies[i].id = i;
+
+    ContactTracker<Body> tracker;
+    ContactInfo info;
+    u64 perPointMessages = 0;
+    u64 trackedMessages = 0;
+    EndCounter ends;
+
+    for (u32 tick = 0; tick < kTicks; ++tick)
+    {
+        for (u32 s = 0; s < kStacks; ++s)
+        {
+            // the top box bounces for the first second, touching the
+            // one below every other tick
+            for (u32 h = 0; h < kHeight; ++h)
+            {
+                bool topBouncing = h == kHeight - 1 && tick < 60 && (tick & 1);
+                if (topBouncing)
+                    continue;
+
+                const Body * pLower = &bodies[s * (kHeight + 1) + h];
+                const Body * pUpper = pLower + 1;
+                perPointMessages += kPointsPerManifold * 2;
+                if (tracker.touch(pLower, pUpper, info) == ContactPhase::Begin)
+                    trackedMessages += 2;
+            }
+        }
+        u32 endsBefore = ends.count;
+        tracker.endTick(std::ref(ends));
+        trackedMessages += (ends.count - endsBefore) * 2;
+    }
+
+    // Begins: every pair once plus the top pair on each bounce.
+    // Ends: one per bounce of the top pair.
+    u64 bounces = 30;
+    u64 expected = kStacks * (kHeight * 2 + bounces * 2 * 2);
+    EXPECT_EQ(trackedMessages, expected);
+    EXPECT_LT(trackedMessages * 100, perPointMessages);
+
+    printf("resting stack, %u ticks: %llu messages per point per tick, %llu begin/end messages\n",
+           kTicks,
+           (unsigned long long)perPointMessages,
+           (unsigned long long)trackedMessages);
+}
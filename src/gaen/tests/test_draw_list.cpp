@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------------
+// test_draw_list.cpp - Tests for draw key packing and sorting
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/DrawList.h"
+
+using namespace gaen;
+
+namespace
+{
+
+struct FakeItem
+{
+    u32 pass;
+    u32 shader;
+    u32 material;
+    f32 depth;
+};
+
+std::vector<FakeItem> random_items(u32 count, u32 shaders, u32 materials)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<u32> shaderDist(0, shaders - 1);
+    std::uniform_int_distribution<u32> materialDist(1, materials);
+    std::uniform_real_distribution<f32> depthDist(-100.0f, 100.0f);
+
+    std::vector<FakeItem> items;
+    items.reserve(count);
+    for (u32 i = 0; i < count; ++i)
+        items.push_back(FakeItem{i % 2, shaderDist(rng), materialDist(rng), depthDist(rng)});
+    return items;
+}
+
+// Shader and material changes a renderer would make drawing in order
+void count_transitions(const std::vector<const FakeItem*> & order, u32 & shaderChanges, u32 & materialChanges)
+{
+    shaderChanges = 0;
+    materialChanges = 0;
+    u32 shader = ~0u;
+    u32 material = ~0u;
+    for (const FakeItem * pItem : order)
+    {
+        if (pItem->shader != shader)
+        {
+            shader = pItem->shader;
+            shaderChanges++;
+        }
+        if (pItem->material != material)
+        {
+            material = pItem->material;
+            materialChanges++;
+        }
+    }
+}
+
+} // namespace
+
+TEST(DrawListTest, DepthBitsKeepFloatOrder)
+{
+    const f32 depths[] = { -1000.0f, -2.5f, -1.0f, -0.001f, 0.0f, 0.001f, 1.0f, 2.5f, 1000.0f };
+    for (u32 i = 1; i < sizeof(depths) / sizeof(depths[0]); ++i)
+        EXPECT_LT(draw_key_depth(depths[i-1]), draw_key_depth(depths[i]));
+    EXPECT_LT(draw_key_depth(depths[8]), 1ull << kDrawKeyDepthBits);
+}
+
+TEST(DrawListTest, KeyFieldPriority)
+{
+    // pass beats everything
+    EXPECT_LT(draw_key(0, 5, 99, 10.0f), draw_key(1, 0, 0, -10.0f));
+    // state sorted keys group by shader, then material, then depth
+    EXPECT_LT(draw_key(0, 1, 99, 10.0f), draw_key(0, 2, 0, -10.0f));
+    EXPECT_LT(draw_key(0, 1, 3, 10.0f), draw_key(0, 1, 4, -10.0f));
+    EXPECT_LT(draw_key(0, 1, 3, -10.0f), draw_key(0, 1, 3, 10.0f));
+    // depth sorted keys put depth first
+    EXPECT_LT(draw_key_depth_sorted(0, 5, 99, -10.0f), draw_key_depth_sorted(0, 0, 0, 10.0f));
+    EXPECT_LT(draw_key_depth_sorted(0, 0, 99, 1.0f), draw_key_depth_sorted(0, 1, 0, 1.0f));
+    EXPECT_LT(draw_key_depth_sorted(1, 0, 0, -10.0f), draw_key_depth_sorted(2, 0, 0, -20.0f));
+    EXPECT_EQ(draw_key_pass(draw_key(3, 5, 99, 10.0f)), 3u);
+    EXPECT_EQ(draw_key_pass(draw_key_depth_sorted(15, 5, 99, -10.0f)), 15u);
+}
+
+TEST(DrawListTest, SlotsAreDense)
+{
+    DrawKeySlots slots;
+    EXPECT_EQ(slots.slot(0xdeadbeef), 0u);
+    EXPECT_EQ(slots.slot(0x12345678), 1u);
+    EXPECT_EQ(slots.slot(0xdeadbeef), 0u);
+}
+
+TEST(DrawListTest, SortMatchesStableSort)
+{
+    for (u32 count : { 0u, 1u, 7u, 63u, 64u, 1000u, 5000u })
+    {
+        std::vector<FakeItem> items = random_items(count, 6, 40);
+        DrawList list;
+        std::vector<DrawEntry> expected;
+        for (u32 i = 0; i < count; ++i)
+        {
+            const FakeItem & item = items[i];
+            u64 key = draw_key(item.pass, item.shader, item.material, item.depth);
+            list.push(key, i);
+            expected.push_back(DrawEntry{key, i});
+        }
+        list.sort();
+        std::stable_sort(expected.begin(), expected.end(), [](const DrawEntry & lhs, const DrawEntry & rhs)
+        {
+            return lhs.key < rhs.key;
+        });
+
+        ASSERT_EQ(list.size(), count);
+        for (u32 i = 0; i < count; ++i)
+        {
+            EXPECT_EQ(list[i].key, expected[i].key);
+            EXPECT_EQ(list[i].index, expected[i].index); // stable
+        }
+    }
+}
+
+TEST(DrawListTest, DISABLED_SortBenchmark)
+{
+    static const u32 kItems = 20000;
+    static const u32 kFrames = 100;
+
+    std::vector<FakeItem> items = random_items(kItems, 8, 64);
+    DrawKeySlots slots;
+
+    // Unsorted, as Stage::render used to draw
+    std::vector<const FakeItem*> order;
+    for (const FakeItem & item : items)
+        order.push_back(&item);
+    u32 unsortedShaders, unsortedMaterials;
+    count_transitions(order, unsortedShaders, unsortedMaterials);
+
+    DrawList list;
+    list.reserve(kItems);
+    auto start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        list.clear();
+        for (u32 i = 0; i < kItems; ++i)
+        {
+            const FakeItem & item = items[i];
+            list.push(draw_key(item.pass, slots.slot(item.shader + 1000), item.material, item.depth), i);
+        }
+        list.sort();
+    }
+    auto end = std::chrono::steady_clock::now();
+    f64 radixMs = std::chrono::duration<f64, std::milli>(end - start).count() / kFrames;
+
+    std::vector<DrawEntry> entries;
+    start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        entries.clear();
+        for (u32 i = 0; i < kItems; ++i)
+        {
+            const FakeItem & item = items[i];
+            entries.push_back(DrawEntry{draw_key(item.pass, item.shader, item.material, item.depth), i});
+        }
+        std::stable_sort(entries.begin(), entries.end(), [](const DrawEntry & lhs, const DrawEntry & rhs)
+        {
+            return lhs.key < rhs.key;
+        });
+    }
+    end = std::chrono::steady_clock::now();
+    f64 stdMs = std::chrono::duration<f64, std::milli>(end - start).count() / kFrames;
+
+    order.clear();
+    for (u32 i = 0; i < list.size(); ++i)
+        order.push_back(&items[list[i].index]);
+    u32 sortedShaders, sortedMaterials;
+    count_transitions(order, sortedShaders, sortedMaterials);
+
+    // at most one run of each shader per pass
+    EXPECT_LE(sortedShaders, 2u * 8u);
+    EXPECT_LT(sortedMaterials, unsortedMaterials / 10);
+
+    printf("%u items, per frame:\n", kItems);
+    printf("  radix sort:       %6.3f ms\n", radixMs);
+    printf("  std::stable_sort: %6.3f ms\n", stdMs);
+    printf("  shader changes:   %u unsorted, %u sorted\n", unsortedShaders, sortedShaders);
+    printf("  material changes: %u unsorted, %u sorted\n", unsortedMaterials, sortedMaterials);
+}
@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------------
+// test_frame_handoff.cpp - Tests for FrameHandoff
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/FrameHandoff.h"
+
+using namespace gaen;
+
+namespace
+{
+
+struct FakeFrame
+{
+    u32 number = 0;
+    std::vector<u32> work;
+};
+
+void sleep_ms(u32 ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+} // namespace
+
+TEST(FrameHandoffTest, FramesArriveInOrder)
+{
+    static const u32 kFrames = 2000;
+    FrameHandoff<FakeFrame> handoff;
+
+    std::vector<u32> seen;
+    std::thread consumer([&]()
+    {
+        while (FakeFrame * pFrame = handoff.beginRead())
+        {
+            seen.push_back(pFrame->number);
+            EXPECT_EQ(pFrame->work.size(), pFrame->number % 5);
+            handoff.endRead();
+        }
+    });
+
+    for (u32 i = 0; i < kFrames; ++i)
+    {
+        FakeFrame & frame = handoff.beginWrite();
+        frame.number = i;
+        frame.work.assign(i % 5, i);
+        handoff.endWrite();
+    }
+    handoff.close();
+    consumer.join();
+
+    ASSERT_EQ(seen.size(), kFrames);
+    for (u32 i = 0; i < kFrames; ++i)
+        EXPECT_EQ(seen[i], i);
+}
+
+TEST(FrameHandoffTest, ProducerWaitsWhenAllFramesInUse)
+{
+    FrameHandoff<FakeFrame> handoff;
+
+    for (u32 i = 0; i < FrameHandoff<FakeFrame>::kFrameCount; ++i)
+    {
+        handoff.beginWrite().number = i;
+        handoff.endWrite();
+    }
+
+    std::atomic<bool> wrote{false};
+    std::thread producer([&]()
+    {
+        handoff.beginWrite().number = 100;
+        wrote = true;
+        handoff.endWrite();
+    });
+
+    sleep_ms(20);
+    EXPECT_FALSE(wrote);
+
+    FakeFrame * pFrame = handoff.tryBeginRead();
+    ASSERT_NE(pFrame, nullptr);
+    EXPECT_EQ(pFrame->number, 0u);
+    handoff.endRead();
+
+    producer.join();
+    EXPECT_TRUE(wrote);
+
+    for (u32 expected : { 1u, 2u, 100u })
+    {
+        pFrame = handoff.tryBeginRead();
+        ASSERT_NE(pFrame, nullptr);
+        EXPECT_EQ(pFrame->number, expected);
+        handoff.endRead();
+    }
+    EXPECT_EQ(handoff.tryBeginRead(), nullptr);
+
+    handoff.close();
+    EXPECT_EQ(handoff.beginRead(), nullptr);
+}
+
+TEST(FrameHandoffTest, DISABLED_OverlapBenchmark)
+{
+    static const u32 kFrames = 40;
+    static const u32 kSimMs = 3;
+    static const u32 kRenderMs = 3;
+
+    // Simulate then render on one thread, as the primary TaskMaster did
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < kFrames; ++i)
+    {
+        sleep_ms(kSimMs);
+        sleep_ms(kRenderMs);
+    }
+    auto end = std::chrono::steady_clock::now();
+    f64 serialMs = std::chrono::duration<f64, std::milli>(end - start).count();
+
+    FrameHandoff<FakeFrame> handoff;
+    u32 rendered = 0;
+    start = std::chrono::steady_clock::now();
+    std::thread renderer([&]()
+    {
+        while (handoff.beginRead())
+        {
+            sleep_ms(kRenderMs);
+            rendered++;
+            handoff.endRead();
+        }
+    });
+    for (u32 i = 0; i < kFrames; ++i)
+    {
+        sleep_ms(kSimMs);
+        handoff.beginWrite().number = i;
+        handoff.endWrite();
+    }
+    handoff.close();
+    renderer.join();
+    end = std::chrono::steady_clock::now();
+    f64 pipelinedMs = std::chrono::duration<f64, std::milli>(end - start).count();
+
+    EXPECT_EQ(rendered, kFrames);
+    EXPECT_LT(pipelinedMs, serialMs * 0.8);
+
+    printf("%u frames, %u ms simulate + %u ms render each:\n", kFrames, kSimMs, kRenderMs);
+    printf("  serial:    %7.2f ms\n", serialMs);
+    printf("  pipelined: %7.2f ms\n", pipelinedMs);
+}
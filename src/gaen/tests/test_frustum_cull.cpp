@@ -0,0 +1,219 @@
+//------------------------------------------------------------------------------
+// test_frustum_cull.cpp - Tests for bounding sphere frustum culling
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/FrustumCull.h"
+
+using namespace gaen;
+
+namespace
+{
+
+// GL perspective projection looking down -z from the origin
+mat4 perspective_matrix(f32 fovy, f32 aspect, f32 zNear, f32 zFar)
+{
+    f32 f = 1.0f / std::tan(fovy / 2.0f);
+    return mat4(vec4(f / aspect, 0.0f, 0.0f, 0.0f),
+                vec4(0.0f, f, 0.0f, 0.0f),
+                vec4(0.0f, 0.0f, (zFar + zNear) / (zNear - zFar), -1.0f),
+                vec4(0.0f, 0.0f, (2.0f * zFar * zNear) / (zNear - zFar), 0.0f));
+}
+
+struct Spheres
+{
+    std::vector<f32> x, y, z, r;
+
+    void push(f32 cx, f32 cy, f32 cz, f32 rad)
+    {
+        x.push_back(cx);
+        y.push_back(cy);
+        z.push_back(cz);
+        r.push_back(rad);
+    }
+    u32 size() const { return (u32)x.size(); }
+};
+
+// Spheres scattered around the camera, only a small share of which
+// fall inside a 60 degree frustum.
+Spheres random_spheres(u32 count, f32 extent)
+{
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<f32> pos(-extent, extent);
+    std::uniform_real_distribution<f32> rad(0.1f, 2.0f);
+    Spheres s;
+    for (u32 i = 0; i < count; ++i)
+        s.push(pos(rng), pos(rng), pos(rng), rad(rng));
+    return s;
+}
+
+bool reference_visible(const Frustum & frustum, f32 x, f32 y, f32 z, f32 r)
+{
+    for (u32 p = 0; p < Frustum::kPLA_COUNT; ++p)
+    {
+        const vec4 & pl = frustum.planes[p];
+        if (pl.x * x + pl.y * y + pl.z * z + pl.w < -r)
+            return false;
+    }
+    if (frustum.maxDistance > 0.0f)
+    {
+        f32 dx = x - frustum.eye.x, dy = y - frustum.eye.y, dz = z - frustum.eye.z;
+        if (std::sqrt(dx * dx + dy * dy + dz * dz) > frustum.maxDistance + r)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(FrustumCullTest, PerspectivePlanes)
+{
+    Frustum frustum = Frustum::from_view_projection(perspective_matrix(1.0472f, 1.0f, 0.1f, 100.0f));
+    Spheres s;
+    s.push(0.0f, 0.0f, -10.0f, 0.5f);    // straight ahead
+    s.push(0.0f, 0.0f, 10.0f, 0.5f);     // behind
+    s.push(100.0f, 0.0f, -10.0f, 0.5f);  // far right
+    s.push(6.0f, 0.0f, -10.0f, 1.0f);    // straddles the right plane
+    s.push(0.0f, 0.0f, -150.0f, 10.0f);  // beyond far
+    s.push(0.0f, -100.0f, -10.0f, 0.5f); // below
+
+    u8 visible[6];
+    frustum_cull_spheres(frustum, s.x.data(), s.y.data(), s.z.data(), s.r.data(), s.size(), visible);
+    EXPECT_EQ(visible[0], 1);
+    EXPECT_EQ(visible[1], 0);
+    EXPECT_EQ(visible[2], 0);
+    EXPECT_EQ(visible[3], 1);
+    EXPECT_EQ(visible[4], 0);
+    EXPECT_EQ(visible[5], 0);
+}
+
+TEST(FrustumCullTest, MatchesScalarWithDistance)
+{
+    Frustum frustum = Frustum::from_view_projection(perspective_matrix(1.0472f, 1.5f, 0.1f, 1000.0f));
+    frustum.eye = vec3(0.0f, 0.0f, 0.0f);
+
+    for (f32 maxDistance : { 0.0f, 40.0f })
+    {
+        frustum.maxDistance = maxDistance;
+        for (u32 count : { 1u, 3u, 4u, 17u, 1001u })
+        {
+            Spheres s = random_spheres(count, 100.0f);
+            std::vector<u8> visible(count, 0xff);
+            frustum_cull_spheres(frustum, s.x.data(), s.y.data(), s.z.data(), s.r.data(), count, visible.data());
+            for (u32 i = 0; i < count; ++i)
+                EXPECT_EQ(visible[i] != 0, reference_visible(frustum, s.x[i], s.y[i], s.z[i], s.r[i]));
+        }
+    }
+}
+
+TEST(FrustumCullTest, CullSetSwapRemove)
+{
+    Frustum frustum = Frustum::from_view_projection(perspective_matrix(1.0472f, 1.0f, 0.1f, 100.0f));
+    CullSet<u32> set;
+    set.insert(10, 100, vec3(0.0f, 0.0f, -10.0f), 1.0f);
+    set.insert(11, 110, vec3(0.0f, 0.0f, 10.0f), 1.0f);
+    set.insert(12, 120, vec3(0.0f, 0.0f, -20.0f), 1.0f);
+
+    set.remove(10);
+    ASSERT_EQ(set.size(), 2u);
+    // 12 moved into 10's slot
+    EXPECT_EQ(set.uid(0), 12u);
+    EXPECT_EQ(set.item(0), 120u);
+    EXPECT_EQ(set.center(0).z, -20.0f);
+
+    set.cull(frustum);
+    EXPECT_TRUE(set.visible(0));
+    EXPECT_FALSE(set.visible(1));
+
+    // moving 11 in front of the camera makes it visible
+    set.update(11, vec3(0.0f, 0.0f, -5.0f), 1.0f);
+    set.cull(frustum);
+    EXPECT_TRUE(set.visible(1));
+    EXPECT_EQ(set.center(1).z, -5.0f);
+
+    set.remove(42); // unknown is ignored
+    EXPECT_EQ(set.size(), 2u);
+}
+
+TEST(FrustumCullTest, DISABLED_MostlyOffscreenBenchmark)
+{
+    static const u32 kSpheres = 200000;
+    static const u32 kFrames = 50;
+
+    Frustum frustum = Frustum::from_view_projection(perspective_matrix(1.0472f, 16.0f / 9.0f, 0.1f, 1000.0f));
+    Spheres s = random_spheres(kSpheres, 500.0f);
+    std::vector<u8> visible(kSpheres);
+
+    u32 scalarVisible = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        scalarVisible = 0;
+        for (u32 i = 0; i < kSpheres; ++i)
+            scalarVisible += reference_visible(frustum, s.x[i], s.y[i], s.z[i], s.r[i]) ? 1 : 0;
+    }
+    auto end = std::chrono::steady_clock::now();
+    f64 scalarMs = std::chrono::duration<f64, std::milli>(end - start).count() / kFrames;
+
+    u32 simdVisible = 0;
+    start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        frustum_cull_spheres(frustum, s.x.data(), s.y.data(), s.z.data(), s.r.data(), kSpheres, visible.data());
+        simdVisible = 0;
+        for (u8 v : visible)
+            simdVisible += v;
+    }
+    end = std::chrono::steady_clock::now();
+    f64 simdMs = std::chrono::duration<f64, std::milli>(end - start).count() / kFrames;
+
+    u32 parallelVisible = 0;
+    start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        frustum_cull_spheres_parallel(frustum, s.x.data(), s.y.data(), s.z.data(), s.r.data(), kSpheres, visible.data(), 0);
+        parallelVisible = 0;
+        for (u8 v : visible)
+            parallelVisible += v;
+    }
+    end = std::chrono::steady_clock::now();
+    f64 parallelMs = std::chrono::duration<f64, std::milli>(end - start).count() / kFrames;
+
+    EXPECT_EQ(simdVisible, scalarVisible);
+    EXPECT_EQ(parallelVisible, scalarVisible);
+    EXPECT_LT(simdVisible, kSpheres / 5);
+
+    printf("%u spheres, %u visible, per frame:\n", kSpheres, simdVisible);
+    printf("  scalar:   %6.3f ms\n", scalarMs);
+    printf("  simd:     %6.3f ms\n", simdMs);
+    printf("  parallel: %6.3f ms\n", parallelMs);
+}
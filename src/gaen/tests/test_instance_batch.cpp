@@ -0,0 +1,281 @@
+//------------------------------------------------------------------------------
+// test_instance_batch.cpp - Tests for InstanceBatcher
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/InstanceBatch.h"
+
+using namespace gaen;
+
+namespace
+{
+
+InstanceBatchKey make_key(u32 vertArrayId, u32 materialId, u32 pass = 0, u32 indexOffset = 0)
+{
+    InstanceBatchKey key;
+    memset(&key, 0, sizeof(key));
+    key.pass = pass;
+    key.shaderHash = 0xfeedf00d;
+    key.vertArrayId = vertArrayId;
+    key.primBufferId = vertArrayId;
+    key.materialId = materialId;
+    key.indexOffset = indexOffset;
+    key.indexCount = 36;
+    return key;
+}
+
+mat43 translation(f32 x)
+{
+    mat43 transform(1.0f);
+    transform[3] = vec3(x, 0.0f, 0.0f);
+    return transform;
+}
+
+// Headless stand in for the GL backend, records the calls a stage
+// makes so the two draw paths can be compared without a context.
+struct RecordingBackend
+{
+    enum CmdType : u32
+    {
+        kCmd_Uniform,
+        kCmd_Bind,
+        kCmd_Draw,
+        kCmd_DrawInstanced,
+        kCmd_Upload
+    };
+
+    struct Cmd
+    {
+        CmdType type;
+        u32 a;
+        u32 b;
+    };
+
+    std::vector<Cmd> cmds;
+    u32 drawCalls = 0;
+    u32 uniformSets = 0;
+    u64 uploadBytes = 0;
+
+    void reset()
+    {
+        cmds.clear();
+        drawCalls = 0;
+        uniformSets = 0;
+        uploadBytes = 0;
+    }
+
+    void uniform(u32 slot, const void * pData, u32 size)
+    {
+        cmds.push_back(Cmd{kCmd_Uniform, slot, size});
+        uniformSets++;
+    }
+
+    void bind(u32 vertArrayId, u32 materialId)
+    {
+        cmds.push_back(Cmd{kCmd_Bind, vertArrayId, materialId});
+    }
+
+    void draw(u32 indexCount)
+    {
+        cmds.push_back(Cmd{kCmd_Draw, indexCount, 1});
+        drawCalls++;
+    }
+
+    void drawInstanced(u32 indexCount, u32 instanceCount)
+    {
+        cmds.push_back(Cmd{kCmd_DrawInstanced, indexCount, instanceCount});
+        drawCalls++;
+    }
+
+    void upload(const void * pData, u64 size)
+    {
+        cmds.push_back(Cmd{kCmd_Upload, static_cast<u32>(size), 0});
+        uploadBytes += size;
+    }
+};
+
+struct FakeItem
+{
+    InstanceBatchKey key;
+    mat43 transform;
+};
+
+std::vector<FakeItem> random_items(u32 count, u32 meshes, u32 materials)
+{
+    std::mt19937 rng(4321);
+    std::uniform_int_distribution<u32> meshDist(1, meshes);
+    std::uniform_int_distribution<u32> materialDist(1, materials);
+
+    std::vector<FakeItem> items;
+    items.reserve(count);
+    for (u32 i = 0; i < count; ++i)
+        items.push_back(FakeItem{make_key(meshDist(rng), materialDist(rng)), translation(static_cast<f32>(i))});
+    return items;
+}
+
+} // namespace
+
+TEST(InstanceBatchTest, UnorderedMergesMatchingKeys)
+{
+    InstanceBatcher batcher;
+    batcher.push(make_key(1, 1), translation(0.0f), 0, 0, false);
+    batcher.push(make_key(2, 1), translation(1.0f), 10, 1, false);
+    batcher.push(make_key(1, 1), translation(2.0f), 0, 2, false);
+    batcher.push(make_key(2, 1), translation(3.0f), 30, 3, false);
+    batcher.push(make_key(1, 1), translation(4.0f), 0, 4, false);
+    batcher.finish();
+
+    ASSERT_EQ(batcher.batchCount(), 2u);
+    ASSERT_EQ(batcher.instanceCount(), 5u);
+
+    EXPECT_EQ(batcher.batch(0).firstInstance, 0u);
+    EXPECT_EQ(batcher.batch(0).instanceCount, 3u);
+    EXPECT_EQ(batcher.batch(0).itemIndex, 0u);
+    EXPECT_EQ(batcher.batch(1).firstInstance, 3u);
+    EXPECT_EQ(batcher.batch(1).instanceCount, 2u);
+    EXPECT_EQ(batcher.batch(1).itemIndex, 1u);
+
+    // Instances keep push order within their batch
+    EXPECT_EQ(batcher.instance(0).transform[3].x, 0.0f);
+    EXPECT_EQ(batcher.instance(1).transform[3].x, 2.0f);
+    EXPECT_EQ(batcher.instance(2).transform[3].x, 4.0f);
+    EXPECT_EQ(batcher.instance(3).transform[3].x, 1.0f);
+    EXPECT_EQ(batcher.instance(3).frameOffset, 10u);
+    EXPECT_EQ(batcher.instance(4).transform[3].x, 3.0f);
+    EXPECT_EQ(batcher.instance(4).frameOffset, 30u);
+}
+
+TEST(InstanceBatchTest, OrderedOnlyMergesRuns)
+{
+    InstanceBatcher batcher;
+    batcher.push(make_key(1, 1), translation(0.0f), 0, 0, true);
+    batcher.push(make_key(1, 1), translation(1.0f), 0, 1, true);
+    batcher.push(make_key(1, 2), translation(2.0f), 0, 2, true);
+    batcher.push(make_key(1, 1), translation(3.0f), 0, 3, true);
+    batcher.finish();
+
+    ASSERT_EQ(batcher.batchCount(), 3u);
+    EXPECT_EQ(batcher.batch(0).instanceCount, 2u);
+    EXPECT_EQ(batcher.batch(1).instanceCount, 1u);
+    EXPECT_EQ(batcher.batch(2).instanceCount, 1u);
+    EXPECT_EQ(batcher.batch(2).itemIndex, 3u);
+    for (u32 i = 0; i < batcher.instanceCount(); ++i)
+        EXPECT_EQ(batcher.instance(i).transform[3].x, static_cast<f32>(i));
+}
+
+TEST(InstanceBatchTest, StateSplitsBatches)
+{
+    InstanceBatcher batcher;
+    batcher.push(make_key(1, 1, 0, 0), translation(0.0f), 0, 0, false);
+    batcher.push(make_key(1, 1, 1, 0), translation(1.0f), 0, 1, false); // pass
+    batcher.push(make_key(1, 1, 0, 12), translation(2.0f), 0, 2, false); // sprite frame
+    batcher.push(make_key(1, 2, 0, 0), translation(3.0f), 0, 3, false); // material
+    batcher.push(make_key(1, 1, 0, 0), translation(4.0f), 0, 4, false);
+    batcher.finish();
+
+    EXPECT_EQ(batcher.batchCount(), 4u);
+    EXPECT_EQ(batcher.batch(0).instanceCount, 2u);
+
+    batcher.clear();
+    EXPECT_EQ(batcher.batchCount(), 0u);
+    EXPECT_EQ(batcher.instanceCount(), 0u);
+}
+
+TEST(InstanceBatchTest, DISABLED_RecordingBackendBenchmark)
+{
+    static const u32 kItems = 20000;
+    static const u32 kMeshes = 50;
+    static const u32 kMaterials = 4;
+    static const u32 kFrames = 100;
+
+    std::vector<FakeItem> items = random_items(kItems, kMeshes, kMaterials);
+    RecordingBackend backend;
+    mat43 viewProj(1.0f);
+
+    // One draw per item, with its transform uniforms, as Stage::render
+    // used to draw
+    auto start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        backend.reset();
+        for (const FakeItem & item : items)
+        {
+            backend.uniform(0, &item.transform, sizeof(f32) * 16); // mvp
+            backend.uniform(1, &item.transform, sizeof(f32) * 9);  // rot
+            backend.bind(item.key.vertArrayId, item.key.materialId);
+            backend.draw(item.key.indexCount);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    f64 perItemMs = std::chrono::duration<f64, std::milli>(end - start).count() / kFrames;
+    u32 perItemDraws = backend.drawCalls;
+    u32 perItemUniforms = backend.uniformSets;
+
+    InstanceBatcher batcher;
+    batcher.reserve(kItems);
+    start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        backend.reset();
+        batcher.clear();
+        for (u32 i = 0; i < kItems; ++i)
+            batcher.push(items[i].key, items[i].transform, 0, i, false);
+        batcher.finish();
+
+        backend.upload(batcher.instances(), batcher.instanceCount() * sizeof(InstanceData));
+        backend.uniform(0, &viewProj, sizeof(viewProj));
+        for (u32 b = 0; b < batcher.batchCount(); ++b)
+        {
+            const InstanceBatch & batch = batcher.batch(b);
+            backend.bind(batch.key.vertArrayId, batch.key.materialId);
+            backend.drawInstanced(batch.key.indexCount, batch.instanceCount);
+        }
+    }
+    end = std::chrono::steady_clock::now();
+    f64 batchedMs = std::chrono::duration<f64, std::milli>(end - start).count() / kFrames;
+
+    EXPECT_EQ(perItemDraws, kItems);
+    EXPECT_LE(backend.drawCalls, kMeshes * kMaterials);
+    EXPECT_EQ(backend.uniformSets, 1u);
+    EXPECT_EQ(backend.uploadBytes, kItems * sizeof(InstanceData));
+
+    u32 instances = 0;
+    for (const RecordingBackend::Cmd & cmd : backend.cmds)
+    {
+        if (cmd.type == RecordingBackend::kCmd_DrawInstanced)
+            instances += cmd.b;
+    }
+    EXPECT_EQ(instances, kItems);
+
+    printf("%u items, %u meshes x %u materials, per frame:\n", kItems, kMeshes, kMaterials);
+    printf("  per item:  %5u draws, %5u uniform sets, %6.3f ms\n", perItemDraws, perItemUniforms, perItemMs);
+    printf("  instanced: %5u draws, %5u uniform sets, %6.3f ms (batching included)\n", backend.drawCalls, backend.uniformSets, batchedMs);
+}
@@ -0,0 +1,235 @@
+//------------------------------------------------------------------------------
+// test_mesh_optimize.cpp - Tests for vertex cache ordering, meshlets and 32 bit indices
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/assets/Gmdl.h"
+#include "gaen/assets/mesh_optimize.h"
+
+using namespace gaen;
+
+namespace
+{
+
+// size x size quads of two triangles each, with the triangles shuffled
+// the way an exporter that doesn't care about the cache might write them
+Gmdl * shuffled_grid(u32 size)
+{
+    u32 vertsPerRow = size + 1;
+    Gmdl * pGmdl = Gmdl::create(kVERT_PosNorm, vertsPerRow * vertsPerRow, kPRIM_Triangle, size * size * 2, 0);
+
+    VertPosNorm * pVerts = *pGmdl;
+    for (u32 y = 0; y < vertsPerRow; ++y)
+    {
+        for (u32 x = 0; x < vertsPerRow; ++x)
+        {
+            pVerts[y * vertsPerRow + x].position = vec3((f32)x, 0.0f, (f32)y);
+            pVerts[y * vertsPerRow + x].normal = vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    std::vector<u32> tris;
+    for (u32 y = 0; y < size; ++y)
+    {
+        for (u32 x = 0; x < size; ++x)
+        {
+            u32 v0 = y * vertsPerRow + x;
+            u32 v1 = v0 + 1;
+            u32 v2 = v0 + vertsPerRow;
+            u32 v3 = v2 + 1;
+            tris.insert(tris.end(), { v0, v2, v1, v1, v2, v3 });
+        }
+    }
+
+    std::vector<u32> order(size * size * 2);
+    for (u32 t = 0; t < order.size(); ++t)
+        order[t] = t;
+    std::mt19937 rng(1234);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    for (u32 t = 0; t < order.size(); ++t)
+    {
+        for (u32 k = 0; k < 3; ++k)
+            pGmdl->setPrimIndex(t * 3 + k, tris[order[t] * 3 + k]);
+    }
+    return pGmdl;
+}
+
+std::vector<u32> indices_of(const Gmdl & gmdl)
+{
+    std::vector<u32> indices(gmdl.indexCount());
+    for (u32 i = 0; i < indices.size(); ++i)
+        indices[i] = gmdl.primIndex(i);
+    return indices;
+}
+
+f32 acmr(const Gmdl & gmdl, u32 cacheSize)
+{
+    std::vector<u32> indices = indices_of(gmdl);
+    return average_cache_miss_ratio(indices.data(), gmdl.primCount(), gmdl.vertCount(), cacheSize);
+}
+
+const vec3 & position(const Gmdl & gmdl, u32 vert)
+{
+    return reinterpret_cast<const VertPos*>(reinterpret_cast<const u8*>(gmdl.verts()) + vert * gmdl.vertStride())->position;
+}
+
+// Same triangles, compared by position since verts get renumbered
+std::vector<std::vector<f32>> sorted_tris(const Gmdl & gmdl)
+{
+    std::vector<std::vector<f32>> tris;
+    for (u32 t = 0; t < gmdl.primCount(); ++t)
+    {
+        std::vector<f32> tri;
+        for (u32 k = 0; k < 3; ++k)
+        {
+            const vec3 & pos = position(gmdl, gmdl.primIndex(t * 3 + k));
+            tri.insert(tri.end(), { pos.x, pos.y, pos.z });
+        }
+        tris.push_back(tri);
+    }
+    std::sort(tris.begin(), tris.end());
+    return tris;
+}
+
+} // namespace
+
+TEST(MeshOptimizeTest, IndexWidth)
+{
+    EXPECT_FALSE(Gmdl::uses_32bit_indices(65536));
+    EXPECT_TRUE(Gmdl::uses_32bit_indices(65537));
+
+    u64 small = Gmdl::required_size(kVERT_Pos, 65536, kPRIM_Triangle, 1000, 0, 0, nullptr);
+    u64 large = Gmdl::required_size(kVERT_Pos, 65537, kPRIM_Triangle, 1000, 0, 0, nullptr);
+    EXPECT_EQ(large - small, 16u + 1000 * 6); // one more vert rounded up to 16 bytes, and wider indices
+
+    Gmdl * pGmdl = Gmdl::create(kVERT_Pos, 70000, kPRIM_Triangle, 1, 0);
+    Scoped_GFREE<Gmdl> pGmdl_sp(pGmdl);
+    EXPECT_TRUE(pGmdl->has32BitIndices());
+    EXPECT_EQ(pGmdl->primStride(), 12u);
+    pGmdl->setPrimIndex(2, 69999);
+    EXPECT_EQ(pGmdl->primIndex(2), 69999u);
+    EXPECT_TRUE(Gmdl::is_valid(pGmdl, pGmdl->size()));
+}
+
+TEST(MeshOptimizeTest, SmallMeshCacheOrder)
+{
+    Gmdl * pGmdl = shuffled_grid(32);
+    Scoped_GFREE<Gmdl> pGmdl_sp(pGmdl);
+    Gmdl * pOpt = optimize_gmdl(pGmdl, false);
+    Scoped_GFREE<Gmdl> pOpt_sp(pOpt);
+
+    EXPECT_FALSE(pOpt->has32BitIndices());
+    EXPECT_EQ(pOpt->primCount(), pGmdl->primCount());
+    EXPECT_EQ(pOpt->vertCount(), pGmdl->vertCount());
+    EXPECT_EQ(sorted_tris(*pOpt), sorted_tris(*pGmdl));
+
+    f32 before = acmr(*pGmdl, 16);
+    f32 after = acmr(*pOpt, 16);
+    printf("32x32 grid ACMR (16 entry FIFO): %.3f -> %.3f\n", before, after);
+    EXPECT_LT(after, 0.8f);
+    EXPECT_LT(after, before * 0.5f);
+
+    // Verts are numbered in order of first use
+    std::vector<u32> indices = indices_of(*pOpt);
+    u32 highest = 0;
+    for (u32 v : indices)
+    {
+        EXPECT_LE(v, highest + 1);
+        highest = std::max(highest, v);
+    }
+}
+
+TEST(MeshOptimizeTest, LargeMeshMeshlets)
+{
+    // 90601 verts, past the 16 bit limit
+    Gmdl * pGmdl = shuffled_grid(300);
+    Scoped_GFREE<Gmdl> pGmdl_sp(pGmdl);
+    ASSERT_TRUE(pGmdl->has32BitIndices());
+
+    Gmdl * pOpt = optimize_gmdl(pGmdl, true);
+    Scoped_GFREE<Gmdl> pOpt_sp(pOpt);
+    EXPECT_TRUE(Gmdl::is_valid(pOpt, pOpt->size()));
+    EXPECT_TRUE(pOpt->has32BitIndices());
+    EXPECT_EQ(pOpt->primCount(), pGmdl->primCount());
+
+    f32 before = acmr(*pGmdl, 16);
+    f32 after = acmr(*pOpt, 16);
+    printf("300x300 grid ACMR (16 entry FIFO): %.3f -> %.3f, %u meshlets\n", before, after, pOpt->meshletCount());
+    EXPECT_LT(after, 0.8f);
+
+    // Meshlets cover the prim array in order, within their limits,
+    // and bound their verts
+    ASSERT_GT(pOpt->meshletCount(), 0u);
+    u32 nextPrim = 0;
+    for (u32 m = 0; m < pOpt->meshletCount(); ++m)
+    {
+        const Meshlet & meshlet = pOpt->meshlets()[m];
+        EXPECT_EQ(meshlet.primOffset, nextPrim);
+        EXPECT_LE(meshlet.primCount, kMeshletMaxTris);
+        EXPECT_LE(meshlet.vertCount, kMeshletMaxVerts);
+        nextPrim += meshlet.primCount;
+
+        std::vector<u32> verts;
+        for (u32 i = meshlet.primOffset * 3; i < (meshlet.primOffset + meshlet.primCount) * 3; ++i)
+        {
+            u32 v = pOpt->primIndex(i);
+            verts.push_back(v);
+            vec3 d = position(*pOpt, v) - meshlet.center;
+            EXPECT_LE(sqrtf(dot(d, d)), meshlet.radius * 1.0001f);
+        }
+        std::sort(verts.begin(), verts.end());
+        EXPECT_EQ((u32)(std::unique(verts.begin(), verts.end()) - verts.begin()), meshlet.vertCount);
+    }
+    EXPECT_EQ(nextPrim, pOpt->primCount());
+}
+
+TEST(MeshOptimizeTest, DropsDegenerateAndUnused)
+{
+    Gmdl * pGmdl = Gmdl::create(kVERT_Pos, 6, kPRIM_Triangle, 3, 0);
+    Scoped_GFREE<Gmdl> pGmdl_sp(pGmdl);
+    VertPos * pVerts = *pGmdl;
+    for (u32 v = 0; v < 6; ++v)
+        pVerts[v].position = vec3((f32)v, (f32)(v % 2), 0.0f);
+
+    // Vert 4 is unused and the middle triangle is degenerate
+    u32 indices[] = { 5, 3, 1, 2, 2, 0, 0, 1, 3 };
+    for (u32 i = 0; i < 9; ++i)
+        pGmdl->setPrimIndex(i, indices[i]);
+
+    Gmdl * pOpt = optimize_gmdl(pGmdl, true);
+    Scoped_GFREE<Gmdl> pOpt_sp(pOpt);
+    EXPECT_EQ(pOpt->primCount(), 2u);
+    EXPECT_EQ(pOpt->vertCount(), 4u);
+    EXPECT_EQ(pOpt->meshletCount(), 1u);
+    for (u32 i = 0; i < pOpt->indexCount(); ++i)
+        EXPECT_NE(position(*pOpt, pOpt->primIndex(i)).x, 4.0f);
+}
@@ -0,0 +1,270 @@
+//------------------------------------------------------------------------------
+// test_mesh_quantize.cpp - Tests for quantized Gmdl vertex formats
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "gaen/math/common.h"
+#include "gaen/assets/Gmdl.h"
+#include "gaen/assets/mesh_quantize.h"
+
+using namespace gaen;
+
+namespace
+{
+
+vec3 random_unit(std::mt19937 & rng)
+{
+    std::normal_distribution<f32> dist;
+    vec3 v(dist(rng), dist(rng), dist(rng));
+    return normalize(v);
+}
+
+// Latitude/longitude sphere, offset from the origin so the position
+// bounds don't happen to be centered
+Gmdl * uv_sphere(u32 rings, u32 segments, f32 radius, const vec3 & offset, VertType vertType)
+{
+    u32 vertCount = (rings + 1) * (segments + 1);
+    Gmdl * pGmdl = Gmdl::create(vertType, vertCount, kPRIM_Triangle, rings * segments * 2, 0);
+
+    u8 * pVert = reinterpret_cast<u8*>(pGmdl->verts());
+    for (u32 r = 0; r <= rings; ++r)
+    {
+        f32 phi = kPi * r / rings;
+        for (u32 s = 0; s <= segments; ++s)
+        {
+            f32 theta = k2Pi * s / segments;
+            vec3 normal(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+            VertPosNormUv * pPosNormUv = reinterpret_cast<VertPosNormUv*>(pVert);
+            pPosNormUv->position = offset + normal * radius;
+            pPosNormUv->normal = normal;
+            if (pGmdl->hasVertUv())
+                pPosNormUv->uv = vec2((f32)s / segments, (f32)r / rings);
+            if (pGmdl->hasVertBone())
+                reinterpret_cast<VertPosNormUvBone*>(pVert)->boneId = r % 7;
+            if (pGmdl->hasVertColor())
+                reinterpret_cast<VertPosNormCol*>(pVert)->color = Color((u8)s, (u8)r, 7, 255);
+            pVert += pGmdl->vertStride();
+        }
+    }
+
+    u32 prim = 0;
+    for (u32 r = 0; r < rings; ++r)
+    {
+        for (u32 s = 0; s < segments; ++s)
+        {
+            u32 v0 = r * (segments + 1) + s;
+            u32 v1 = v0 + 1;
+            u32 v2 = v0 + segments + 1;
+            u32 v3 = v2 + 1;
+            u32 tri[6] = { v0, v2, v1, v1, v2, v3 };
+            for (u32 k = 0; k < 6; ++k)
+                pGmdl->setPrimIndex(prim++, tri[k]);
+        }
+    }
+
+    pGmdl->updateHalfExtents();
+    return pGmdl;
+}
+
+} // namespace
+
+TEST(MeshQuantizeTest, NormalizedIntegers)
+{
+    EXPECT_EQ(quantize_snorm16(1.0f), 32767);
+    EXPECT_EQ(quantize_snorm16(-1.0f), -32767);
+    EXPECT_EQ(quantize_snorm16(2.0f), 32767);
+    EXPECT_EQ(dequantize_snorm16(-32768), -1.0f);
+    EXPECT_EQ(quantize_unorm16(1.0f), 65535);
+    EXPECT_EQ(quantize_unorm16(-0.5f), 0);
+
+    for (u32 i = 0; i <= 1000; ++i)
+    {
+        f32 s = -1.0f + 2.0f * i / 1000.0f;
+        EXPECT_LE(fabsf(dequantize_snorm16(quantize_snorm16(s)) - s), 0.5f / 32767.0f + 1e-7f);
+        f32 u = i / 1000.0f;
+        EXPECT_LE(fabsf(dequantize_unorm16(quantize_unorm16(u)) - u), 0.5f / 65535.0f + 1e-7f);
+    }
+}
+
+TEST(MeshQuantizeTest, HalfFloats)
+{
+    // exactly representable
+    const f32 exact[] = { 0.0f, 1.0f, -2.0f, 0.5f, 0.099975586f, 65504.0f, 6.1035156e-05f, 5.9604645e-08f };
+    for (f32 f : exact)
+        EXPECT_EQ(f16_to_f32(f32_to_f16(f)), f);
+
+    EXPECT_EQ(f32_to_f16(1.0f), 0x3c00);
+    EXPECT_EQ(f32_to_f16(-2.0f), 0xc000);
+    EXPECT_EQ(f32_to_f16(1e6f), 0x7c00);  // overflow to inf
+    EXPECT_EQ(f32_to_f16(1e-9f), 0x0000); // underflow to zero
+    EXPECT_EQ(f32_to_f16(1.0f + 1.0f / 2048.0f), 0x3c00); // tie rounds to even
+    EXPECT_EQ(f32_to_f16(1.0f + 3.0f / 2048.0f), 0x3c02);
+    EXPECT_TRUE(std::isnan(f16_to_f32(f32_to_f16(NAN))));
+
+    // within half an ulp, 2^-11 relative, across the normal range
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<f32> dist(-8.0f, 8.0f);
+    for (u32 i = 0; i < 10000; ++i)
+    {
+        f32 f = ldexpf(1.0f, (i32)dist(rng)) * dist(rng);
+        if (fabsf(f) < 6.1035156e-05f)
+            continue;
+        EXPECT_LE(fabsf(f16_to_f32(f32_to_f16(f)) - f), fabsf(f) / 2048.0f);
+    }
+}
+
+TEST(MeshQuantizeTest, OctahedralNormals)
+{
+    const vec3 axes[] = { vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1) };
+    for (const vec3 & axis : axes)
+    {
+        i16 oct[2];
+        encode_oct_normal(oct, axis);
+        vec3 decoded = decode_oct_normal(oct);
+        EXPECT_NEAR(dot(decoded, axis), 1.0f, 1e-6f);
+    }
+
+    std::mt19937 rng(1234);
+    f32 maxError = 0.0f;
+    for (u32 i = 0; i < 100000; ++i)
+    {
+        vec3 n = random_unit(rng);
+        i16 oct[2];
+        encode_oct_normal(oct, n);
+        vec3 decoded = decode_oct_normal(oct);
+        maxError = max(maxError, degrees(atan2f(length(cross(decoded, n)), dot(decoded, n))));
+    }
+    printf("Octahedral snorm16 max normal error: %f degrees\n", maxError);
+    EXPECT_LT(maxError, 0.01f);
+}
+
+TEST(MeshQuantizeTest, QuantizeGmdl)
+{
+    vec3 offset(100.0f, -3.0f, 42.0f);
+    f32 radius = 5.0f;
+    Gmdl * pGmdl = uv_sphere(32, 64, radius, offset, kVERT_PosNormUv);
+    Scoped_GFREE<Gmdl> pGmdl_sp(pGmdl);
+
+    QuantizeReport report;
+    Gmdl * pQuant = quantize_gmdl(pGmdl, &report);
+    Scoped_GFREE<Gmdl> pQuant_sp(pQuant);
+
+    ASSERT_TRUE(Gmdl::is_valid(pQuant, pQuant->size()));
+    EXPECT_EQ(pQuant->vertType(), kVERT_PosNormUvQ);
+    EXPECT_TRUE(pQuant->isQuantized());
+    EXPECT_TRUE(pQuant->hasVertNormal());
+    EXPECT_TRUE(pQuant->hasVertUv());
+    EXPECT_FALSE(pQuant->hasVertColor());
+    EXPECT_FALSE(pQuant->hasVertTan());
+    EXPECT_FALSE(pQuant->hasHalfUvs());
+    EXPECT_EQ(pQuant->vertCount(), pGmdl->vertCount());
+
+    printf("Verts: %u -> %u bytes, position error max %g rms %g, normal error max %g degrees, uv error max %g\n",
+           report.srcVertsSize, report.dstVertsSize,
+           report.maxPositionError, report.rmsPositionError,
+           report.maxNormalError, report.maxUvError);
+
+    // 32 byte verts become 16 byte verts
+    EXPECT_EQ(report.srcVertsSize, pGmdl->vertsSize());
+    EXPECT_EQ(report.dstVertsSize, pQuant->vertsSize());
+    EXPECT_LE(report.dstVertsSize * 2, report.srcVertsSize + 16);
+
+    // Half a step of the bounds per axis
+    f32 posStep = radius / 32767.0f;
+    EXPECT_LE(report.maxPositionError, posStep * 0.5f * sqrtf(3.0f) + 1e-5f);
+    EXPECT_LE(report.rmsPositionError, report.maxPositionError);
+    EXPECT_LT(report.maxNormalError, 0.01f);
+    EXPECT_LE(report.maxUvError, 0.5f / 65535.0f + 1e-7f);
+
+    for (u32 v = 0; v < pGmdl->vertCount(); ++v)
+        EXPECT_LE(length(pQuant->vertPosition(v) - pGmdl->vertPosition(v)), report.maxPositionError + 1e-6f);
+
+    for (u32 i = 0; i < pGmdl->indexCount(); ++i)
+        ASSERT_EQ(pQuant->primIndex(i), pGmdl->primIndex(i));
+
+    EXPECT_EQ(pQuant->center(), pGmdl->center());
+    EXPECT_EQ(pQuant->halfExtents(), pGmdl->halfExtents());
+}
+
+TEST(MeshQuantizeTest, QuantizeGmdlLayouts)
+{
+    Gmdl * pBone = uv_sphere(8, 16, 1.0f, vec3(0.0f), kVERT_PosNormUvBone);
+    Scoped_GFREE<Gmdl> pBone_sp(pBone);
+    Gmdl * pBoneQ = quantize_gmdl(pBone);
+    Scoped_GFREE<Gmdl> pBoneQ_sp(pBoneQ);
+
+    EXPECT_EQ(pBoneQ->vertType(), kVERT_PosNormUvBoneQ);
+    EXPECT_TRUE(pBoneQ->hasVertBone());
+    EXPECT_EQ(pBoneQ->vertStride(), 20u);
+    const VertPosNormUvBone * pBoneVerts = *pBone;
+    const VertPosNormUvBoneQ * pBoneQVerts = *pBoneQ;
+    for (u32 v = 0; v < pBone->vertCount(); ++v)
+        EXPECT_EQ(pBoneQVerts[v].boneId, pBoneVerts[v].boneId);
+
+    Gmdl * pCol = uv_sphere(8, 16, 1.0f, vec3(0.0f), kVERT_PosNormCol);
+    Scoped_GFREE<Gmdl> pCol_sp(pCol);
+    Gmdl * pColQ = quantize_gmdl(pCol);
+    Scoped_GFREE<Gmdl> pColQ_sp(pColQ);
+
+    EXPECT_EQ(pColQ->vertType(), kVERT_PosNormColQ);
+    EXPECT_TRUE(pColQ->hasVertColor());
+    EXPECT_FALSE(pColQ->hasVertUv());
+    EXPECT_EQ(pColQ->vertColorOffset(), 12u);
+    const VertPosNormCol * pColVerts = *pCol;
+    const VertPosNormColQ * pColQVerts = *pColQ;
+    for (u32 v = 0; v < pCol->vertCount(); ++v)
+        EXPECT_EQ(pColQVerts[v].color, pColVerts[v].color);
+
+    EXPECT_EQ(quantized_vert_type(kVERT_PosNormUvTan), kVERT_Unknown);
+}
+
+TEST(MeshQuantizeTest, TiledUvsUseHalfFloats)
+{
+    Gmdl * pGmdl = uv_sphere(8, 16, 1.0f, vec3(0.0f), kVERT_PosNormUv);
+    Scoped_GFREE<Gmdl> pGmdl_sp(pGmdl);
+    VertPosNormUv * pVerts = *pGmdl;
+    for (u32 v = 0; v < pGmdl->vertCount(); ++v)
+        pVerts[v].uv = pVerts[v].uv * 4.0f;
+
+    QuantizeReport report;
+    Gmdl * pQuant = quantize_gmdl(pGmdl, &report);
+    Scoped_GFREE<Gmdl> pQuant_sp(pQuant);
+
+    EXPECT_TRUE(report.halfUvs);
+    EXPECT_TRUE(pQuant->hasHalfUvs());
+    EXPECT_LE(report.maxUvError, 4.0f / 2048.0f);
+
+    const VertPosNormUvQ * pQuantVerts = *pQuant;
+    for (u32 v = 0; v < pGmdl->vertCount(); ++v)
+    {
+        EXPECT_NEAR(f16_to_f32(pQuantVerts[v].uv[0]), pVerts[v].uv.x, report.maxUvError);
+        EXPECT_NEAR(f16_to_f32(pQuantVerts[v].uv[1]), pVerts[v].uv.y, report.maxUvError);
+    }
+}
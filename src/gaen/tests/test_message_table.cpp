@@ -0,0 +1,248 @@
+//------------------------------------------------------------------------------
+// test_message_table.cpp - Tests for generated message tables and Entity message routing
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/core/hashing.h"
+#include "gaen/engine/MessageTable.h"
+#include "gaen/engine/MessageWriter.h"
+#include "gaen/engine/Task.h"
+#include "gaen/compose/codegen_utils.h"
+
+using namespace gaen;
+
+static u32 test_msg_id(const char * prefix, u32 idx)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s_%u", prefix, idx);
+    return gaen_hash(name);
+}
+
+// Table storage as cmpc would emit it into a generated class
+struct TestTable
+{
+    CompVector<i32> displacements;
+    CompVector<MessageTable::Slot> slots;
+    MessageTable table;
+
+    bool build(const CompVector<u32> & msgIds)
+    {
+        if (!build_message_table(msgIds, displacements, slots))
+            return false;
+        table.slotMask = (u32)slots.size() - 1;
+        table.pDisplacements = displacements.data();
+        table.pSlots = slots.data();
+        return true;
+    }
+};
+
+// Stand in for a generated component, consumes whatever its table has
+class TestComponent
+{
+public:
+    const MessageTable * pTable = nullptr;
+    u32 handledCount = 0;
+
+    template <typename T>
+    MessageResult message(const T & msgAcc)
+    {
+        if (pTable->find(msgAcc.message().msgId) == MessageTable::kNoHandler)
+            return MessageResult::Propagate;
+        handledCount++;
+        return MessageResult::Consumed;
+    }
+};
+
+TEST(MessageTableTest, PerfectHash)
+{
+    for (u32 count = 0; count <= 96; ++count)
+    {
+        CompVector<u32> msgIds;
+        for (u32 i = 0; i < count; ++i)
+            msgIds.push_back(test_msg_id("msg", i));
+
+        TestTable t;
+        ASSERT_TRUE(t.build(msgIds));
+        EXPECT_GE(t.table.slotCount(), count);
+        EXPECT_LE(t.table.slotCount(), count > 1 ? count * 2 - 1 : 1u);
+
+        for (u32 i = 0; i < count; ++i)
+            EXPECT_EQ(t.table.find(msgIds[i]), i);
+
+        for (u32 i = 0; i < 256; ++i)
+            EXPECT_EQ(t.table.find(test_msg_id("other", i)), MessageTable::kNoHandler);
+    }
+}
+
+TEST(MessageTableTest, Duplicates)
+{
+    CompVector<u32> msgIds;
+    msgIds.push_back(test_msg_id("msg", 0));
+    msgIds.push_back(test_msg_id("msg", 1));
+    msgIds.push_back(test_msg_id("msg", 0));
+
+    TestTable t;
+    EXPECT_FALSE(t.build(msgIds));
+}
+
+TEST(MessageRouterTest, Routes)
+{
+    u32 a = test_msg_id("a", 0);
+    u32 b = test_msg_id("b", 0);
+    u32 c = test_msg_id("c", 0);
+
+    TestTable script, comp0, comp2;
+    ASSERT_TRUE(script.build(CompVector<u32>{a, b}));
+    ASSERT_TRUE(comp0.build(CompVector<u32>{b, c}));
+    ASSERT_TRUE(comp2.build(CompVector<u32>{c}));
+
+    // comp1 has no table and must see every message
+    const MessageTable * componentTables[] = { &comp0.table, nullptr, &comp2.table };
+
+    MessageRouter router;
+    router.build(&script.table, componentTables, 3);
+
+    u32 count;
+    const u16 * pRoute = router.find(a, count);
+    ASSERT_EQ(count, 2u);
+    EXPECT_EQ(pRoute[0], MessageRouter::kScriptTask);
+    EXPECT_EQ(pRoute[1], 1);
+
+    pRoute = router.find(b, count);
+    ASSERT_EQ(count, 3u);
+    EXPECT_EQ(pRoute[0], MessageRouter::kScriptTask);
+    EXPECT_EQ(pRoute[1], 0);
+    EXPECT_EQ(pRoute[2], 1);
+
+    pRoute = router.find(c, count);
+    ASSERT_EQ(count, 3u);
+    EXPECT_EQ(pRoute[0], 0);
+    EXPECT_EQ(pRoute[1], 1);
+    EXPECT_EQ(pRoute[2], 2);
+
+    pRoute = router.find(test_msg_id("unknown", 0), count);
+    ASSERT_EQ(count, 1u);
+    EXPECT_EQ(pRoute[0], 1);
+}
+
+TEST(MessageRouterTest, DISABLED_ManyComponentsBenchmark)
+{
+    static const u32 kComponentCount = 64;
+    static const u32 kCommonCount = 8;  // init__, fin__, transform, etc.
+    static const u32 kUniqueCount = 4;  // messages only one component handles
+    static const u32 kIterations = 2000;
+
+    std::vector<TestTable> tables(kComponentCount);
+    std::vector<TestComponent> components(kComponentCount);
+    std::vector<Task> tasks(kComponentCount);
+    std::vector<const MessageTable*> componentTables(kComponentCount);
+    std::vector<u32> sendIds;
+
+    for (u32 c = 0; c < kComponentCount; ++c)
+    {
+        CompVector<u32> msgIds;
+        for (u32 i = 0; i < kCommonCount; ++i)
+            msgIds.push_back(test_msg_id("common", i));
+        for (u32 i = 0; i < kUniqueCount; ++i)
+        {
+            msgIds.push_back(test_msg_id("unique", c * kUniqueCount + i));
+            sendIds.push_back(msgIds.back());
+        }
+        ASSERT_TRUE(tables[c].build(msgIds));
+
+        components[c].pTable = &tables[c].table;
+        tasks[c] = Task::create(&components[c], c);
+        componentTables[c] = &tables[c].table;
+    }
+
+    TestTable script;
+    ASSERT_TRUE(script.build(CompVector<u32>{test_msg_id("common", 0)}));
+
+    MessageRouter router;
+    router.build(&script.table, componentTables.data(), kComponentCount);
+
+    // Previous Entity behavior, offer the message to each component
+    // in turn until one consumes it
+    auto probeStart = std::chrono::steady_clock::now();
+    for (u32 iter = 0; iter < kIterations; ++iter)
+    {
+        for (u32 msgId : sendIds)
+        {
+            StackMessageBlockWriter<0> msgw(msgId, kMessageFlag_None, 0, 0, to_cell(0));
+            for (u32 c = 0; c < kComponentCount; ++c)
+            {
+                if (tasks[c].message(msgw.accessor()) == MessageResult::Consumed)
+                    break;
+            }
+        }
+    }
+    auto probeEnd = std::chrono::steady_clock::now();
+
+    u32 probeHandled = 0;
+    for (TestComponent & comp : components)
+    {
+        probeHandled += comp.handledCount;
+        comp.handledCount = 0;
+    }
+
+    auto routeStart = std::chrono::steady_clock::now();
+    for (u32 iter = 0; iter < kIterations; ++iter)
+    {
+        for (u32 msgId : sendIds)
+        {
+            StackMessageBlockWriter<0> msgw(msgId, kMessageFlag_None, 0, 0, to_cell(0));
+            u32 count;
+            const u16 * pRoute = router.find(msgId, count);
+            for (u32 i = 0; i < count; ++i)
+            {
+                if (tasks[pRoute[i]].message(msgw.accessor()) == MessageResult::Consumed)
+                    break;
+            }
+        }
+    }
+    auto routeEnd = std::chrono::steady_clock::now();
+
+    u32 routeHandled = 0;
+    for (TestComponent & comp : components)
+    {
+        EXPECT_EQ(comp.handledCount, kIterations * kUniqueCount);
+        routeHandled += comp.handledCount;
+    }
+    EXPECT_EQ(probeHandled, routeHandled);
+
+    f64 messageCount = (f64)kIterations * sendIds.size();
+    f64 probeNs = std::chrono::duration<f64, std::nano>(probeEnd - probeStart).count() / messageCount;
+    f64 routeNs = std::chrono::duration<f64, std::nano>(routeEnd - routeStart).count() / messageCount;
+    printf("%u components, probing: %.2f ns/message, routed: %.2f ns/message, speedup: %.1fx\n",
+           kComponentCount,
+           probeNs,
+           routeNs,
+           routeNs > 0.0 ? probeNs / routeNs : 0.0);
+}
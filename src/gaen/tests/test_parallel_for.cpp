@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// test_parallel_for.cpp - Tests for parallel_for
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <atomic>
+
+#include <gtest/gtest.h>
+
+#include "gaen/core/Vector.h"
+#include "gaen/core/parallel_for.h"
+
+using namespace gaen;
+
+TEST(ParallelForTest, RunsEveryJobOnce)
+{
+    Vector<kMEM_Engine, u32> counts(1000, 0);
+    for (u32 rep = 0; rep < 50; ++rep)
+    {
+        parallel_for(static_cast<u32>(counts.size()), 0, [&](u32 jobIdx) { counts[jobIdx]++; });
+    }
+    for (u32 count : counts)
+        EXPECT_EQ(50u, count);
+
+    // Fewer jobs than threads, and none at all
+    std::atomic<u32> ran{0};
+    parallel_for(3, 0, [&](u32) { ran++; });
+    parallel_for(0, 0, [&](u32) { ran++; });
+    EXPECT_EQ(3u, ran.load());
+}
+
+TEST(ParallelForTest, NestedLoopsRunSerially)
+{
+    std::atomic<u32> ran{0};
+    parallel_for(64, 4, [&](u32)
+    {
+        parallel_for(10, 0, [&](u32) { ran++; });
+    });
+    EXPECT_EQ(640u, ran.load());
+}
+
+TEST(ParallelForTest, RestartsAfterFin)
+{
+    std::atomic<u32> ran{0};
+    parallel_for(16, 0, [&](u32) { ran++; });
+    fin_parallel_for();
+    fin_parallel_for();
+    parallel_for(16, 0, [&](u32) { ran++; });
+    EXPECT_EQ(32u, ran.load());
+    fin_parallel_for();
+}
@@ -0,0 +1,105 @@
+//------------------------------------------------------------------------------
+// test_physics_clock.cpp - Tests for fixed rate physics stepping
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/PhysicsClock.h"
+
+using namespace gaen;
+
+TEST(PhysicsClockTest, StepsIndependentOfFrameRate)
+{
+    // One simulated second at three different frame rates
+    const f32 kFrameDeltas[] = { 1.0f / 30.0f, 1.0f / 60.0f, 1.0f / 144.0f };
+
+    for (f32 delta : kFrameDeltas)
+    {
+        PhysicsClock clock(60.0f, 8);
+        u32 frames = static_cast<u32>(1.0f / delta + 0.5f);
+        u32 steps = 0;
+        for (u32 i = 0; i < frames; ++i)
+        {
+            steps += clock.advance(delta);
+            EXPECT_GE(clock.alpha(), 0.0f);
+            EXPECT_LT(clock.alpha(), 1.0f);
+        }
+        EXPECT_NEAR(steps, 60u, 1u) << "delta " << delta;
+        EXPECT_EQ(clock.tickCount(), steps);
+        EXPECT_EQ(clock.droppedSteps(), 0u);
+    }
+}
+
+TEST(PhysicsClockTest, AccumulatesPartialSteps)
+{
+    PhysicsClock clock(10.0f, 4);
+
+    EXPECT_EQ(clock.advance(0.04f), 0u);
+    EXPECT_NEAR(clock.alpha(), 0.4f, 0.0001f);
+    EXPECT_EQ(clock.advance(0.04f), 0u);
+    EXPECT_NEAR(clock.alpha(), 0.8f, 0.0001f);
+    EXPECT_EQ(clock.advance(0.04f), 1u);
+    EXPECT_NEAR(clock.alpha(), 0.2f, 0.0001f);
+
+    // negative deltas are ignored
+    EXPECT_EQ(clock.advance(-1.0f), 0u);
+    EXPECT_NEAR(clock.alpha(), 0.2f, 0.0001f);
+}
+
+TEST(PhysicsClockTest, SpikeIsCappedAtMaxSteps)
+{
+    PhysicsClock clock(60.0f, 4);
+
+    // half second hitch
+    EXPECT_EQ(clock.advance(0.5f), 4u);
+    EXPECT_EQ(clock.droppedSteps(), 26u);
+    EXPECT_LT(clock.alpha(), 1.0f);
+
+    // back to normal, no lingering backlog
+    EXPECT_LE(clock.advance(1.0f / 60.0f), 2u);
+    EXPECT_EQ(clock.droppedSteps(), 26u);
+}
+
+TEST(PhysicsClockTest, RateAndMaxStepsAreClamped)
+{
+    PhysicsClock clock(0.0f, 0);
+    EXPECT_FLOAT_EQ(clock.step(), 1.0f / PhysicsClock::kMinRate);
+    EXPECT_EQ(clock.maxSteps(), 1u);
+
+    // Negative max steps must not wrap to a huge u32
+    clock.setRate(-30.0f, -1);
+    EXPECT_FLOAT_EQ(clock.step(), 1.0f / PhysicsClock::kMinRate);
+    EXPECT_EQ(clock.maxSteps(), 1u);
+    EXPECT_EQ(clock.advance(10.0f), 1u);
+
+    clock.setRate(std::nanf(""), 2);
+    EXPECT_FLOAT_EQ(clock.step(), 1.0f / PhysicsClock::kMinRate);
+    EXPECT_EQ(clock.maxSteps(), 2u);
+
+    // Valid values pass through
+    clock.setRate(120.0f, 6);
+    EXPECT_FLOAT_EQ(clock.step(), 1.0f / 120.0f);
+    EXPECT_EQ(clock.maxSteps(), 6u);
+}
@@ -0,0 +1,207 @@
+//------------------------------------------------------------------------------
+// test_physics_mt.cpp - Tests for the multithreaded Bullet world
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+
+#include "gaen/core/platutils.h"
+#include "gaen/render_support/PhysicsTaskScheduler.h"
+
+using namespace gaen;
+
+// Owns everything a dynamics world needs, single or multithreaded,
+// plus a pile of boxes dropped onto a ground plane.
+struct BoxPile
+{
+    std::unique_ptr<btDefaultCollisionConfiguration> collisionConfiguration;
+    std::unique_ptr<btCollisionDispatcher> dispatcher;
+    std::unique_ptr<btBroadphaseInterface> broadphase;
+    std::unique_ptr<btConstraintSolverPoolMt> solverPool;
+    std::unique_ptr<btSequentialImpulseConstraintSolver> solver;
+    std::unique_ptr<btDiscreteDynamicsWorld> world;
+
+    std::unique_ptr<btCollisionShape> groundShape;
+    std::unique_ptr<btCollisionShape> boxShape;
+    std::vector<std::unique_ptr<btDefaultMotionState>> motionStates;
+    std::vector<std::unique_ptr<btRigidBody>> bodies;
+
+    BoxPile(u32 threadCount, u32 boxesPerSide, u32 layers)
+    {
+        collisionConfiguration.reset(new btDefaultCollisionConfiguration);
+        broadphase.reset(new btDbvtBroadphase);
+
+        if (threadCount > 1)
+        {
+            physics_init_task_scheduler(threadCount);
+            dispatcher.reset(new btCollisionDispatcherMt(collisionConfiguration.get()));
+            solverPool.reset(new btConstraintSolverPoolMt(threadCount));
+            solver.reset(new btSequentialImpulseConstraintSolverMt);
+            world.reset(new btDiscreteDynamicsWorldMt(dispatcher.get(), broadphase.get(), solverPool.get(), solver.get(), collisionConfiguration.get()));
+        }
+        else
+        {
+            dispatcher.reset(new btCollisionDispatcher(collisionConfiguration.get()));
+            solver.reset(new btSequentialImpulseConstraintSolver);
+            world.reset(new btDiscreteDynamicsWorld(dispatcher.get(), broadphase.get(), solver.get(), collisionConfiguration.get()));
+        }
+
+        groundShape.reset(new btStaticPlaneShape(btVector3(0, 1, 0), 0));
+        addBody(groundShape.get(), 0.0f, btVector3(0, 0, 0));
+
+        boxShape.reset(new btBoxShape(btVector3(0.5f, 0.5f, 0.5f)));
+        for (u32 y = 0; y < layers; ++y)
+        {
+            for (u32 z = 0; z < boxesPerSide; ++z)
+            {
+                for (u32 x = 0; x < boxesPerSide; ++x)
+                {
+                    addBody(boxShape.get(), 1.0f, btVector3(x * 1.1f, 0.5f + y * 1.05f, z * 1.1f));
+                }
+            }
+        }
+    }
+
+    ~BoxPile()
+    {
+        for (auto & body : bodies)
+            world->removeRigidBody(body.get());
+    }
+
+    void addBody(btCollisionShape * pShape, f32 mass, const btVector3 & pos)
+    {
+        btTransform trans;
+        trans.setIdentity();
+        trans.setOrigin(pos);
+
+        btVector3 inertia(0, 0, 0);
+        if (mass > 0.0f)
+            pShape->calculateLocalInertia(mass, inertia);
+
+        motionStates.emplace_back(new btDefaultMotionState(trans));
+        bodies.emplace_back(new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(mass, motionStates.back().get(), pShape, inertia)));
+        world->addRigidBody(bodies.back().get());
+    }
+
+    f64 run(u32 steps)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < steps; ++i)
+            world->stepSimulation(1.0f / 60.0f, 0);
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<f64, std::milli>(end - start).count();
+    }
+
+    f32 highestBox() const
+    {
+        f32 highest = 0.0f;
+        for (const auto & body : bodies)
+            highest = btMax(highest, body->getWorldTransform().getOrigin().y());
+        return highest;
+    }
+};
+
+TEST(PhysicsMtTest, SchedulerCoversRange)
+{
+    PhysicsTaskScheduler scheduler(4);
+
+    struct CountBody : public btIParallelForBody
+    {
+        std::vector<std::atomic<u32>> * pCounts;
+        void forLoop(int iBegin, int iEnd) const override
+        {
+            for (int i = iBegin; i < iEnd; ++i)
+                (*pCounts)[i]++;
+        }
+    };
+
+    std::vector<std::atomic<u32>> counts(1000);
+    CountBody forBody;
+    forBody.pCounts = &counts;
+    scheduler.parallelFor(0, 1000, 7, forBody);
+    for (u32 i = 0; i < counts.size(); ++i)
+        EXPECT_EQ(counts[i].load(), 1u) << "index " << i;
+
+    struct SumBody : public btIParallelSumBody
+    {
+        btScalar sumLoop(int iBegin, int iEnd) const override
+        {
+            btScalar sum = 0;
+            for (int i = iBegin; i < iEnd; ++i)
+                sum += btScalar(i);
+            return sum;
+        }
+    };
+    EXPECT_EQ(scheduler.parallelSum(0, 1000, 13, SumBody()), btScalar(999 * 1000 / 2));
+}
+
+TEST(PhysicsMtTest, PileSettles)
+{
+    BoxPile pile(4, 8, 4);
+    pile.run(120);
+
+    // Nothing fell through the ground or exploded off the top
+    for (const auto & body : pile.bodies)
+        EXPECT_GT(body->getWorldTransform().getOrigin().y(), 0.0f);
+    EXPECT_LT(pile.highestBox(), 5.0f);
+}
+
+TEST(PhysicsMtTest, DISABLED_ThousandsOfBodiesBenchmark)
+{
+    static const u32 kBoxesPerSide = 24;
+    static const u32 kLayers = 8;
+    static const u32 kSteps = 120;
+
+    u32 threadCount = platform_core_count();
+
+    f64 serialMs;
+    {
+        BoxPile pile(1, kBoxesPerSide, kLayers);
+        serialMs = pile.run(kSteps);
+    }
+
+    f64 parallelMs;
+    {
+        BoxPile pile(threadCount, kBoxesPerSide, kLayers);
+        parallelMs = pile.run(kSteps);
+    }
+
+    printf("%u boxes, %u steps, btDiscreteDynamicsWorld: %.1f ms, btDiscreteDynamicsWorldMt (%u threads): %.1f ms, speedup: %.1fx\n",
+           kBoxesPerSide * kBoxesPerSide * kLayers,
+           kSteps,
+           serialMs,
+           threadCount,
+           parallelMs,
+           parallelMs > 0.0 ? serialMs / parallelMs : 0.0);
+}
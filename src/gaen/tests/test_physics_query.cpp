@@ -0,0 +1,261 @@
+//------------------------------------------------------------------------------
+// test_physics_query.cpp - Tests for batched physics queries
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <btBulletDynamicsCommon.h>
+
+#include "gaen/core/platutils.h"
+#include "gaen/render_support/PhysicsQuery.h"
+#include "gaen/render_support/PhysicsTaskScheduler.h"
+
+using namespace gaen;
+
+// A collision world with a grid of unit boxes at y == 0, each owned by
+// a different "entity", task ids starting at 1.
+struct BoxGrid
+{
+    std::unique_ptr<btDefaultCollisionConfiguration> collisionConfiguration;
+    std::unique_ptr<btCollisionDispatcher> dispatcher;
+    std::unique_ptr<btBroadphaseInterface> broadphase;
+    std::unique_ptr<btCollisionWorld> world;
+
+    std::unique_ptr<btCollisionShape> boxShape;
+    std::vector<std::unique_ptr<btCollisionObject>> objects;
+
+    BoxGrid(u32 boxesPerSide, f32 spacing)
+    {
+        collisionConfiguration.reset(new btDefaultCollisionConfiguration);
+        dispatcher.reset(new btCollisionDispatcher(collisionConfiguration.get()));
+        broadphase.reset(new btDbvtBroadphase);
+        world.reset(new btCollisionWorld(dispatcher.get(), broadphase.get(), collisionConfiguration.get()));
+
+        boxShape.reset(new btBoxShape(btVector3(0.5f, 0.5f, 0.5f)));
+        for (u32 z = 0; z < boxesPerSide; ++z)
+        {
+            for (u32 x = 0; x < boxesPerSide; ++x)
+            {
+                // alternate two groups so masks can be tested
+                addBox(btVector3(x * spacing, 0.0f, z * spacing), (x + z) % 2 ? 2 : 1);
+            }
+        }
+        world->updateAabbs();
+    }
+
+    ~BoxGrid()
+    {
+        for (auto & obj : objects)
+            world->removeCollisionObject(obj.get());
+    }
+
+    void addBox(const btVector3 & pos, u16 group)
+    {
+        btTransform trans;
+        trans.setIdentity();
+        trans.setOrigin(pos);
+
+        objects.emplace_back(new btCollisionObject);
+        btCollisionObject * pObj = objects.back().get();
+        pObj->setCollisionShape(boxShape.get());
+        pObj->setWorldTransform(trans);
+        pObj->setUserIndex(static_cast<int>(objects.size()));
+        world->addCollisionObject(pObj, group, 0xffff);
+    }
+};
+
+static PhysicsQuery make_query(PhysicsQueryType type, task_id requester, const vec3 & start, const vec3 & end, f32 radius = 0.0f, u16 mask = 0)
+{
+    PhysicsQuery query;
+    query.type = type;
+    query.requester = requester;
+    query.uid = 0;
+    query.message = 0;
+    query.mask = mask;
+    query.radius = radius;
+    query.start = start;
+    query.end = end;
+    return query;
+}
+
+// Line of sight rays between random points above and through the grid
+static std::vector<PhysicsQuery> random_rays(u32 count, f32 extent)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<f32> xz(-1.0f, extent + 1.0f);
+    std::uniform_real_distribution<f32> y(-1.0f, 2.0f);
+
+    std::vector<PhysicsQuery> rays;
+    for (u32 i = 0; i < count; ++i)
+    {
+        vec3 start(xz(rng), y(rng), xz(rng));
+        vec3 end(xz(rng), y(rng), xz(rng));
+        rays.push_back(make_query(PhysicsQueryType::Raycast, 0, start, end));
+    }
+    return rays;
+}
+
+TEST(PhysicsQueryTest, RaycastsMatchRayTest)
+{
+    BoxGrid grid(16, 2.0f);
+    std::vector<PhysicsQuery> rays = random_rays(500, 32.0f);
+
+    physics_init_task_scheduler(4);
+
+    PhysicsQueryBatch batch;
+    for (const PhysicsQuery & ray : rays)
+        batch.queue(ray);
+    batch.run(grid.world.get());
+
+    u32 hits = 0;
+    for (u32 i = 0; i < rays.size(); ++i)
+    {
+        btVector3 from(rays[i].start.x, rays[i].start.y, rays[i].start.z);
+        btVector3 to(rays[i].end.x, rays[i].end.y, rays[i].end.z);
+        btCollisionWorld::ClosestRayResultCallback cb(from, to);
+        grid.world->rayTest(from, to, cb);
+
+        const PhysicsQueryResult & result = batch.result(i);
+        ASSERT_EQ(result.hitCount, cb.hasHit() ? 1u : 0u) << "ray " << i;
+        if (cb.hasHit())
+        {
+            const PhysicsQueryHit & hit = batch.hit(result.firstHit);
+            EXPECT_EQ(hit.subject, cb.m_collisionObject->getUserIndex());
+            EXPECT_FLOAT_EQ(hit.fraction, cb.m_closestHitFraction);
+            hits++;
+        }
+    }
+    EXPECT_GT(hits, 0u);
+    EXPECT_LT(hits, rays.size());
+}
+
+TEST(PhysicsQueryTest, FiltersRequesterAndMask)
+{
+    // Row of boxes along x, 1 and 3 in group 1, 2 in group 2
+    BoxGrid grid(0, 0.0f);
+    grid.addBox(btVector3(0.0f, 0.0f, 0.0f), 1);
+    grid.addBox(btVector3(2.0f, 0.0f, 0.0f), 2);
+    grid.addBox(btVector3(4.0f, 0.0f, 0.0f), 1);
+    grid.world->updateAabbs();
+
+    vec3 start(-2.0f, 0.0f, 0.0f);
+    vec3 end(6.0f, 0.0f, 0.0f);
+
+    PhysicsQueryBatch batch;
+    batch.queue(make_query(PhysicsQueryType::Raycast, 0, start, end));
+    batch.queue(make_query(PhysicsQueryType::Raycast, 1, start, end));    // owns the first box
+    batch.queue(make_query(PhysicsQueryType::Raycast, 0, start, end, 0.0f, 2));
+    batch.queue(make_query(PhysicsQueryType::Sweep, 1, start, end, 0.25f));
+    batch.queue(make_query(PhysicsQueryType::Overlap, 0, vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f), 0.75f));
+    batch.queue(make_query(PhysicsQueryType::Overlap, 0, vec3(1.0f, 5.0f, 0.0f), vec3(1.0f, 5.0f, 0.0f), 0.75f));
+    batch.run(grid.world.get());
+
+    ASSERT_EQ(batch.result(0).hitCount, 1u);
+    EXPECT_EQ(batch.hit(batch.result(0).firstHit).subject, 1);
+    EXPECT_NEAR(batch.hit(batch.result(0).firstHit).location.x, -0.5f, 0.01f);
+
+    ASSERT_EQ(batch.result(1).hitCount, 1u);
+    EXPECT_EQ(batch.hit(batch.result(1).firstHit).subject, 2);
+
+    ASSERT_EQ(batch.result(2).hitCount, 1u);
+    EXPECT_EQ(batch.hit(batch.result(2).firstHit).subject, 2);
+
+    ASSERT_EQ(batch.result(3).hitCount, 1u);
+    EXPECT_EQ(batch.hit(batch.result(3).firstHit).subject, 2);
+    EXPECT_NEAR(batch.hit(batch.result(3).firstHit).location.x, 1.5f, 0.01f);
+
+    // sphere between the first two boxes touches both
+    ASSERT_EQ(batch.result(4).hitCount, 2u);
+    task_id a = batch.hit(batch.result(4).firstHit).subject;
+    task_id b = batch.hit(batch.result(4).firstHit + 1).subject;
+    EXPECT_EQ(std::min(a, b), 1);
+    EXPECT_EQ(std::max(a, b), 2);
+
+    EXPECT_EQ(batch.result(5).hitCount, 0u);
+
+    batch.clear();
+    EXPECT_EQ(batch.queryCount(), 0u);
+}
+
+// Hundreds of agents checking line of sight, one rayTest per query as
+// a message round trip would do, against one batched pass.
+TEST(PhysicsQueryTest, DISABLED_LineOfSightBenchmark)
+{
+    static const u32 kRays = 2000;
+    static const u32 kFrames = 20;
+
+    BoxGrid grid(64, 2.0f);
+    std::vector<PhysicsQuery> rays = random_rays(kRays, 128.0f);
+
+    u32 threadCount = platform_core_count();
+    physics_init_task_scheduler(threadCount);
+
+    u32 serialHits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        for (const PhysicsQuery & ray : rays)
+        {
+            btVector3 from(ray.start.x, ray.start.y, ray.start.z);
+            btVector3 to(ray.end.x, ray.end.y, ray.end.z);
+            btCollisionWorld::ClosestRayResultCallback cb(from, to);
+            grid.world->rayTest(from, to, cb);
+            serialHits += cb.hasHit() ? 1 : 0;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    f64 serialMs = std::chrono::duration<f64, std::milli>(end - start).count();
+
+    u32 batchHits = 0;
+    PhysicsQueryBatch batch;
+    start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        for (const PhysicsQuery & ray : rays)
+            batch.queue(ray);
+        batch.run(grid.world.get());
+        for (u32 i = 0; i < batch.queryCount(); ++i)
+            batchHits += batch.result(i).hitCount;
+        batch.clear();
+    }
+    end = std::chrono::steady_clock::now();
+    f64 batchMs = std::chrono::duration<f64, std::milli>(end - start).count();
+
+    EXPECT_EQ(batchHits, serialHits);
+
+    printf("%u rays x %u frames, one at a time: %.1f ms, batched (%u threads): %.1f ms, speedup: %.1fx\n",
+           kRays,
+           kFrames,
+           serialMs,
+           threadCount,
+           batchMs,
+           batchMs > 0.0 ? serialMs / batchMs : 0.0);
+}
@@ -0,0 +1,281 @@
+//------------------------------------------------------------------------------
+// test_render_collection.cpp - Tests for RenderCollection
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/RenderCollection.h"
+
+using namespace gaen;
+
+namespace
+{
+
+struct FakeItem
+{
+    FakeItem(ouid uid, f32 order)
+      : mUid(uid)
+      , mOrder(order)
+    {}
+
+    ouid uid() const { return mUid; }
+    f32 order() const { return mOrder; }
+    void setOrder(f32 order) { mOrder = order; }
+
+    ouid mUid;
+    f32 mOrder;
+};
+
+UniquePtr<FakeItem> make_item(ouid uid, f32 order)
+{
+    return UniquePtr<FakeItem>(GNEW(kMEM_Renderer, FakeItem, uid, order));
+}
+
+template <class CollT>
+std::vector<ouid> traversal(CollT & coll)
+{
+    std::vector<ouid> uids;
+    for (auto it = coll.begin(); it != coll.end(); ++it)
+        uids.push_back(it->uid());
+    return uids;
+}
+
+// The previous tree and hash map layout, kept to compare against
+struct MapCollection
+{
+    void insert(UniquePtr<FakeItem> pItem)
+    {
+        auto ordIt = ordered.emplace(pItem->order(), std::move(pItem));
+        index.emplace(ordIt->second->uid(), ordIt);
+    }
+
+    void erase(ouid uid)
+    {
+        auto it = index.find(uid);
+        ordered.erase(it->second);
+        index.erase(it);
+    }
+
+    std::multimap<f32, UniquePtr<FakeItem>> ordered;
+    std::unordered_map<ouid, std::multimap<f32, UniquePtr<FakeItem>>::iterator> index;
+};
+
+} // namespace
+
+TEST(RenderCollectionTest, TraversesInOrder)
+{
+    RenderCollection<FakeItem> coll;
+    coll.insert(make_item(1, 3.0f));
+    coll.insert(make_item(2, 1.0f));
+    coll.insert(make_item(3, 2.0f));
+
+    EXPECT_EQ(coll.size(), 3u);
+    EXPECT_EQ(traversal(coll), (std::vector<ouid>{2, 3, 1}));
+}
+
+TEST(RenderCollectionTest, FindEraseRelease)
+{
+    RenderCollection<FakeItem> coll;
+    for (ouid uid = 1; uid <= 10; ++uid)
+        coll.insert(make_item(uid, (f32)uid));
+
+    EXPECT_EQ(coll.find(42), coll.end());
+    ASSERT_NE(coll.find(4), coll.end());
+    EXPECT_EQ(coll.find(4)->order(), 4.0f);
+
+    coll.erase(coll.find(4));
+    EXPECT_EQ(coll.find(4), coll.end());
+
+    FakeItem * pItem = coll.release(coll.find(7));
+    EXPECT_EQ(pItem->uid(), 7);
+    GDELETE(pItem);
+
+    EXPECT_EQ(coll.size(), 8u);
+    EXPECT_EQ(traversal(coll), (std::vector<ouid>{1, 2, 3, 5, 6, 8, 9, 10}));
+
+    // Lookups still work after the holes are compacted
+    EXPECT_EQ(coll.find(9)->uid(), 9);
+}
+
+TEST(RenderCollectionTest, ReorderIsLazy)
+{
+    RenderCollection<FakeItem> coll;
+    for (ouid uid = 1; uid <= 5; ++uid)
+        coll.insert(make_item(uid, (f32)uid));
+
+    coll.find(1)->setOrder(10.0f);
+    coll.reorder(1);
+    coll.find(5)->setOrder(0.0f);
+    coll.reorder(5);
+
+    EXPECT_EQ(traversal(coll), (std::vector<ouid>{5, 2, 3, 4, 1}));
+}
+
+TEST(RenderCollectionTest, HandlesGoStale)
+{
+    RenderCollection<FakeItem> coll;
+    coll.insert(make_item(1, 1.0f));
+    auto handle = coll.handle(coll.find(1));
+    EXPECT_EQ(coll.get(handle)->uid(), 1);
+
+    coll.erase(coll.find(1));
+    EXPECT_EQ(coll.get(handle), nullptr);
+
+    // Reuses the slot, the old handle still misses
+    coll.insert(make_item(2, 1.0f));
+    EXPECT_EQ(coll.get(handle), nullptr);
+    EXPECT_EQ(coll.get(coll.handle(coll.find(2)))->uid(), 2);
+}
+
+TEST(RenderCollectionTest, ChurnMatchesReference)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<f32> orderDist(-100.0f, 100.0f);
+
+    RenderCollection<FakeItem> coll;
+    std::map<ouid, f32> reference;
+    ouid nextUid = 1;
+
+    for (u32 round = 0; round < 2000; ++round)
+    {
+        u32 op = rng() % 4;
+        if (op < 2 || reference.empty())
+        {
+            f32 order = orderDist(rng);
+            coll.insert(make_item(nextUid, order));
+            reference[nextUid++] = order;
+        }
+        else
+        {
+            auto refIt = reference.begin();
+            std::advance(refIt, rng() % reference.size());
+            if (op == 2)
+            {
+                coll.erase(coll.find(refIt->first));
+                reference.erase(refIt);
+            }
+            else
+            {
+                f32 order = orderDist(rng);
+                coll.find(refIt->first)->setOrder(order);
+                coll.reorder(refIt->first);
+                refIt->second = order;
+            }
+        }
+
+        if (round % 100 == 0)
+        {
+            ASSERT_EQ(coll.size(), reference.size());
+            f32 prev = -1000.0f;
+            u32 count = 0;
+            for (auto it = coll.begin(); it != coll.end(); ++it)
+            {
+                EXPECT_GE(it->order(), prev);
+                EXPECT_EQ(reference[it->uid()], it->order());
+                prev = it->order();
+                count++;
+            }
+            EXPECT_EQ(count, reference.size());
+        }
+    }
+}
+
+TEST(RenderCollectionTest, DISABLED_Benchmark)
+{
+    static const u32 kItems = 100000;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<f32> orderDist(-100.0f, 100.0f);
+    std::vector<f32> orders(kItems);
+    for (f32 & order : orders)
+        order = orderDist(rng);
+
+    // Remove in a different order than inserted
+    std::vector<ouid> removeOrder(kItems);
+    for (u32 i = 0; i < kItems; ++i)
+        removeOrder[i] = i + 1;
+    std::shuffle(removeOrder.begin(), removeOrder.end(), rng);
+
+    auto ms = [](std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    f64 mapInsert, mapIterate, mapRemove;
+    f64 flatInsert, flatIterate, flatRemove;
+    f64 mapSum = 0.0;
+    f64 flatSum = 0.0;
+    {
+        MapCollection coll;
+        auto start = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < kItems; ++i)
+            coll.insert(make_item(i + 1, orders[i]));
+        mapInsert = ms(start);
+
+        start = std::chrono::steady_clock::now();
+        for (u32 pass = 0; pass < 10; ++pass)
+            for (auto & entry : coll.ordered)
+                mapSum += entry.second->order();
+        mapIterate = ms(start) / 10;
+
+        start = std::chrono::steady_clock::now();
+        for (ouid uid : removeOrder)
+            coll.erase(uid);
+        mapRemove = ms(start);
+    }
+    {
+        RenderCollection<FakeItem> coll;
+        auto start = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < kItems; ++i)
+            coll.insert(make_item(i + 1, orders[i]));
+        flatInsert = ms(start);
+
+        // First pass pays for the lazy sort
+        start = std::chrono::steady_clock::now();
+        for (u32 pass = 0; pass < 10; ++pass)
+            for (auto it = coll.begin(); it != coll.end(); ++it)
+                flatSum += it->order();
+        flatIterate = ms(start) / 10;
+
+        start = std::chrono::steady_clock::now();
+        for (ouid uid : removeOrder)
+            coll.erase(coll.find(uid));
+        flatRemove = ms(start);
+        EXPECT_EQ(coll.size(), 0u);
+    }
+    EXPECT_DOUBLE_EQ(flatSum, mapSum);
+
+    printf("%u items:       insert     iterate     remove\n", kItems);
+    printf("  map+hash:  %7.2f ms  %7.2f ms  %7.2f ms\n", mapInsert, mapIterate, mapRemove);
+    printf("  flat:      %7.2f ms  %7.2f ms  %7.2f ms\n", flatInsert, flatIterate, flatRemove);
+}
@@ -0,0 +1,436 @@
+//------------------------------------------------------------------------------
+// test_script_vm.cpp - Tests for the Compose bytecode VM
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/core/mem.h"
+#include "gaen/hashes/hashes.h"
+#include "gaen/engine/ScriptVm.h"
+#include "gaen/render_support/script_syscalls.h"
+
+using namespace gaen;
+
+// Hand assembles programs in the same layout cmpc -b writes
+struct ProgramBuilder
+{
+    struct Handler
+    {
+        u32 msgId;
+        u32 entry;
+        u32 blockCount;
+    };
+
+    u32 blockCount = 1;
+    u32 initEntry = 0;
+    u32 updateEntry = kScriptProgramNoEntry;
+    std::vector<Handler> handlers;
+    std::vector<u32> imports;
+    std::vector<u32> code;
+
+    u32 here() const { return (u32)code.size(); }
+
+    void op(u32 opcode, u32 a0 = 0, u32 a1 = 0, u32 a2 = 0)
+    {
+        code.push_back(inst(opcode, a0, a1, a2 & 0xffff));
+    }
+
+    void loadc(u32 reg, u32 val)
+    {
+        op(eOpcode_LOADC, reg);
+        code.push_back(val);
+    }
+
+    void loadf(u32 reg, f32 val)
+    {
+        cell c;
+        c.f = val;
+        loadc(reg, c.u);
+    }
+
+    std::vector<u32> cells() const
+    {
+        ScriptProgramHeader header;
+        header.magic = kScriptProgramMagic;
+        header.version = kScriptProgramVersion;
+        header.nameHash = 0x12345678;
+        header.blockCount = blockCount;
+        header.initEntry = initEntry;
+        header.updateEntry = updateEntry;
+        header.handlerCount = (u32)handlers.size();
+        header.importCount = (u32)imports.size();
+        header.codeCount = (u32)code.size();
+
+        std::vector<u32> out(reinterpret_cast<const u32*>(&header),
+                             reinterpret_cast<const u32*>(&header) + sizeof(header) / sizeof(u32));
+        for (const Handler & h : handlers)
+        {
+            out.push_back(h.msgId);
+            out.push_back(h.entry);
+            out.push_back(h.blockCount);
+        }
+        out.insert(out.end(), imports.begin(), imports.end());
+        out.insert(out.end(), code.begin(), code.end());
+        return out;
+    }
+
+    ScriptProgram * create() const
+    {
+        std::vector<u32> c = cells();
+        return ScriptProgram::create(c.data(), (u32)c.size());
+    }
+};
+
+struct TestFrame
+{
+    Block blocks[4];
+    ScriptVmFrame frame;
+
+    TestFrame()
+    {
+        memset(blocks, 0, sizeof(blocks));
+        memset(&frame, 0, sizeof(frame));
+        frame.pCells = reinterpret_cast<cell*>(blocks);
+        frame.cellCount = 4 * kCellsPerBlock;
+    }
+
+    cell & operator[](u32 idx) { return frame.pCells[idx]; }
+};
+
+static const u32 r9 = 9;
+static const u32 r10 = 10;
+static const u32 r11 = 11;
+
+TEST(ScriptVmTest, Arithmetic)
+{
+    ProgramBuilder b;
+    b.op(eOpcode_LOADI, r9, 0, 7);
+    b.op(eOpcode_LOADI, r10, 0, (u32)-5);
+    b.op(eOpcode_MUL, r11, r9, r10);
+    b.op(eOpcode_STOREB, r11, 0, 0);      // -35
+    b.op(eOpcode_DIVI, r11, r11, 2);
+    b.op(eOpcode_STOREB, r11, 0, 1);      // -17
+    b.op(eOpcode_MODI, r11, r9, 4);
+    b.op(eOpcode_STOREB, r11, 0, 2);      // 3
+    b.op(eOpcode_LSHIFTI, r11, r9, 3);
+    b.op(eOpcode_STOREB, r11, 0, 3);      // 56
+    b.op(eOpcode_LT, r11, r10, r9);
+    b.op(eOpcode_STOREB, r11, 0, 4);      // 1
+    b.loadc(r11, 0x7fffffff);
+    b.op(eOpcode_STOREB, r11, 0, 5);
+    b.loadf(r9, 1.5f);
+    b.op(eOpcode_ITOF, r10, r10);
+    b.op(eOpcode_FMUL, r11, r9, r10);
+    b.op(eOpcode_STOREB, r11, 0, 6);      // -7.5
+    b.op(eOpcode_RET);
+    b.blockCount = 2;
+
+    ScriptProgram * pProgram = b.create();
+    ASSERT_NE(pProgram, nullptr);
+
+    TestFrame tf;
+    script_vm_run(*pProgram, pProgram->initEntry(), tf.frame);
+    EXPECT_EQ(tf[0].i, -35);
+    EXPECT_EQ(tf[1].i, -17);
+    EXPECT_EQ(tf[2].i, 3);
+    EXPECT_EQ(tf[3].i, 56);
+    EXPECT_EQ(tf[4].i, 1);
+    EXPECT_EQ(tf[5].i, 0x7fffffff);
+    EXPECT_FLOAT_EQ(tf[6].f, -7.5f);
+
+    GDELETE(pProgram);
+}
+
+TEST(ScriptVmTest, LoopAndCall)
+{
+    // sum = 0; for (i = 1; i <= 100; ++i) sum += double(i);
+    ProgramBuilder b;
+    b.op(eOpcode_LOADI, r9, 0, 0);
+    b.op(eOpcode_LOADI, r10, 0, 1);
+    u32 top = b.here();
+    b.op(eOpcode_LOADI, r11, 0, 100);
+    b.op(eOpcode_GT, r11, r10, r11);
+    u32 brEnd = b.here();
+    b.op(eOpcode_BRNZ, r11, 0, 0);
+    u32 call = b.here();
+    b.op(eOpcode_CALL, 0, 0, 0);
+    b.op(eOpcode_ADDI, r10, r10, 1);
+    b.op(eOpcode_JUMP, 0, 0, top);
+    u32 end = b.here();
+    b.op(eOpcode_STOREB, r9, 0, 0);
+    b.op(eOpcode_RET);
+    // double(i) subroutine
+    u32 sub = b.here();
+    b.op(eOpcode_PUSH, r10);
+    b.op(eOpcode_ADD, r10, r10, r10);
+    b.op(eOpcode_ADD, r9, r9, r10);
+    b.op(eOpcode_POP, r10);
+    b.op(eOpcode_RET);
+
+    b.code[brEnd] = inst(eOpcode_BRNZ, r11, 0, end);
+    b.code[call] = inst(eOpcode_CALL, 0, 0, sub);
+
+    ScriptProgram * pProgram = b.create();
+    ASSERT_NE(pProgram, nullptr);
+
+    TestFrame tf;
+    script_vm_run(*pProgram, pProgram->initEntry(), tf.frame);
+    EXPECT_EQ(tf[0].i, 10100);
+
+    GDELETE(pProgram);
+}
+
+TEST(ScriptVmTest, UpdateAndHandlers)
+{
+    ProgramBuilder b;
+    b.op(eOpcode_RET);
+
+    // update: cell0 += delta
+    b.updateEntry = b.here();
+    b.op(eOpcode_LOADB, r9, 0, 0);
+    b.op(eOpcode_FADD, r9, r9, kVmDeltaReg);
+    b.op(eOpcode_STOREB, r9, 0, 0);
+    b.op(eOpcode_RET);
+
+    // #add(int a, int b) with payload: cell1 = payload + a + b
+    b.handlers.push_back({ 20, b.here(), 1 });
+    b.op(eOpcode_LOADP, r9);
+    b.op(eOpcode_LOADM, r10, 0, 0);
+    b.op(eOpcode_ADD, r9, r9, r10);
+    b.op(eOpcode_LOADM, r10, 0, 1);
+    b.op(eOpcode_ADD, r9, r9, r10);
+    b.op(eOpcode_STOREB, r9, 0, 1);
+    b.op(eOpcode_RET);
+
+    b.handlers.push_back({ 30, b.here(), 0 });
+    b.op(eOpcode_RET);
+
+    ScriptProgram * pProgram = b.create();
+    ASSERT_NE(pProgram, nullptr);
+    EXPECT_TRUE(pProgram->isUpdatable());
+    EXPECT_EQ(pProgram->findHandler(10), nullptr);
+    EXPECT_EQ(pProgram->findHandler(40), nullptr);
+    ASSERT_NE(pProgram->findHandler(30), nullptr);
+
+    TestFrame tf;
+    tf.frame.regs[kVmDeltaReg].f = 0.25f;
+    script_vm_run(*pProgram, pProgram->updateEntry(), tf.frame);
+    script_vm_run(*pProgram, pProgram->updateEntry(), tf.frame);
+    EXPECT_FLOAT_EQ(tf[0].f, 0.5f);
+
+    const ScriptProgramHandler * pHandler = pProgram->findHandler(20);
+    ASSERT_NE(pHandler, nullptr);
+    Block msgBlock;
+    msgBlock.cells[0].i = 3;
+    msgBlock.cells[1].i = 4;
+    tf.frame.pMsgCells = msgBlock.cells;
+    tf.frame.msgCellCount = kCellsPerBlock;
+    tf.frame.payload.i = 100;
+    script_vm_run(*pProgram, pHandler->entry, tf.frame);
+    EXPECT_EQ(tf[1].i, 107);
+
+    GDELETE(pProgram);
+}
+
+TEST(ScriptVmTest, Syscall)
+{
+    ProgramBuilder b;
+    b.imports.push_back(HASH::radians);
+    b.loadf(0, 180.0f);
+    b.op(eOpcode_SYSCALL, 0, 0, 0);
+    b.op(eOpcode_STOREB, 0, 0, 0);
+    b.op(eOpcode_RET);
+
+    ScriptProgram * pProgram = b.create();
+    ASSERT_NE(pProgram, nullptr);
+
+    TestFrame tf;
+    script_vm_run(*pProgram, pProgram->initEntry(), tf.frame);
+    EXPECT_NEAR(tf[0].f, 3.14159265f, 0.00001f);
+
+    GDELETE(pProgram);
+}
+
+TEST(ScriptVmTest, Validation)
+{
+    {
+        // No terminating RET
+        ProgramBuilder b;
+        b.op(eOpcode_LOADI, r9, 0, 1);
+        EXPECT_EQ(b.create(), nullptr);
+    }
+    {
+        // Branch out of range
+        ProgramBuilder b;
+        b.op(eOpcode_JUMP, 0, 0, 100);
+        b.op(eOpcode_RET);
+        EXPECT_EQ(b.create(), nullptr);
+    }
+    {
+        // Block address out of range
+        ProgramBuilder b;
+        b.op(eOpcode_STOREB, r9, 0, 4);
+        b.op(eOpcode_RET);
+        EXPECT_EQ(b.create(), nullptr);
+    }
+    {
+        // Unknown syscall
+        ProgramBuilder b;
+        b.imports.push_back(0xdeadbeef);
+        b.op(eOpcode_SYSCALL, 0, 0, 0);
+        b.op(eOpcode_RET);
+        EXPECT_EQ(b.create(), nullptr);
+    }
+    {
+        // Bad opcode
+        ProgramBuilder b;
+        b.code.push_back(0x3f);
+        b.op(eOpcode_RET);
+        EXPECT_EQ(b.create(), nullptr);
+    }
+    {
+        // LOADC constant may look like anything, including an invalid opcode
+        ProgramBuilder b;
+        b.loadc(r9, 0x3f);
+        b.op(eOpcode_RET);
+        ScriptProgram * pProgram = b.create();
+        EXPECT_NE(pProgram, nullptr);
+        GDELETE(pProgram);
+    }
+    {
+        // Branch into a LOADC constant, which here decodes as a valid
+        // STOREB far out of the block
+        ProgramBuilder b;
+        b.op(eOpcode_JUMP, 0, 0, 2);
+        b.loadc(r9, inst(eOpcode_STOREB, r9, 0, 0xfff0));
+        b.op(eOpcode_RET);
+        EXPECT_EQ(b.create(), nullptr);
+    }
+    {
+        // Call into a LOADC constant
+        ProgramBuilder b;
+        b.loadc(r9, inst(eOpcode_RET, 0, 0, 0));
+        b.op(eOpcode_CALL, 0, 0, 1);
+        b.op(eOpcode_RET);
+        EXPECT_EQ(b.create(), nullptr);
+    }
+    {
+        // Handler entry into a LOADC constant
+        ProgramBuilder b;
+        b.loadc(r9, inst(eOpcode_RET, 0, 0, 0));
+        b.op(eOpcode_RET);
+        b.handlers.push_back({ 1, 1, 0 });
+        EXPECT_EQ(b.create(), nullptr);
+    }
+}
+
+TEST(ScriptVmTest, SyscallsComplete)
+{
+    // Every call cmpc -b can emit has to resolve when programs load
+    static bool sRegistered = false;
+    if (!sRegistered)
+    {
+        register_render_support_syscalls();
+        sRegistered = true;
+    }
+    EXPECT_TRUE(verify_script_syscalls());
+
+    for (const ScriptSyscallDesc & desc : kScriptSyscalls)
+    {
+        ProgramBuilder b;
+        b.imports.push_back(HASH::hash_func(desc.name));
+        b.op(eOpcode_RET);
+        ScriptProgram * pProgram = b.create();
+        EXPECT_NE(pProgram, nullptr) << desc.name;
+        GDELETE(pProgram);
+    }
+}
+
+// Compares the VM against what CodegenCpp would produce for:
+//   float total = 0.0;
+//   #accum(float v) { total = total + v * 2.0; count++; }
+static void native_accum(cell * pCells, const cell * pMsgCells)
+{
+    pCells[0].f = pCells[0].f + pMsgCells[0].f * 2.0f;
+    pCells[1].i++;
+}
+
+TEST(ScriptVmTest, DISABLED_Benchmark)
+{
+    ProgramBuilder b;
+    b.op(eOpcode_RET);
+    b.handlers.push_back({ 1, b.here(), 1 });
+    b.op(eOpcode_LOADB, r9, 0, 0);
+    b.op(eOpcode_LOADM, r10, 0, 0);
+    b.loadf(r11, 2.0f);
+    b.op(eOpcode_FMUL, r10, r10, r11);
+    b.op(eOpcode_FADD, r9, r9, r10);
+    b.op(eOpcode_STOREB, r9, 0, 0);
+    b.op(eOpcode_LOADB, r9, 0, 1);
+    b.op(eOpcode_ADDI, r9, r9, 1);
+    b.op(eOpcode_STOREB, r9, 0, 1);
+    b.op(eOpcode_RET);
+
+    ScriptProgram * pProgram = b.create();
+    ASSERT_NE(pProgram, nullptr);
+    const ScriptProgramHandler * pHandler = pProgram->findHandler(1);
+    ASSERT_NE(pHandler, nullptr);
+
+    static const u32 kIterations = 1000000;
+    Block msgBlock;
+    msgBlock.cells[0].f = 0.5f;
+
+    TestFrame vm;
+    vm.frame.pMsgCells = msgBlock.cells;
+    vm.frame.msgCellCount = kCellsPerBlock;
+    auto vmStart = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < kIterations; ++i)
+        script_vm_run(*pProgram, pHandler->entry, vm.frame);
+    auto vmEnd = std::chrono::steady_clock::now();
+
+    TestFrame native;
+    volatile cell * pVolatileCells = native.frame.pCells; // keep the loop from folding
+    auto nativeStart = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < kIterations; ++i)
+        native_accum((cell*)pVolatileCells, msgBlock.cells);
+    auto nativeEnd = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(vm[1].i, (i32)kIterations);
+    EXPECT_EQ(native[1].i, (i32)kIterations);
+    EXPECT_FLOAT_EQ(vm[0].f, native[0].f);
+
+    f64 vmNs = std::chrono::duration<f64, std::nano>(vmEnd - vmStart).count() / kIterations;
+    f64 nativeNs = std::chrono::duration<f64, std::nano>(nativeEnd - nativeStart).count() / kIterations;
+    printf("ScriptVm: %.2f ns/message, native: %.2f ns/message, ratio: %.1fx\n",
+           vmNs,
+           nativeNs,
+           nativeNs > 0.0 ? vmNs / nativeNs : 0.0);
+
+    GDELETE(pProgram);
+}
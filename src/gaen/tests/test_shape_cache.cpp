@@ -0,0 +1,182 @@
+//------------------------------------------------------------------------------
+// test_shape_cache.cpp - Tests for shared procedural shape meshes
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/assets/Gmdl.h"
+#include "gaen/render_support/shapes.h"
+#include "gaen/render_support/ShapeCache.h"
+
+using namespace gaen;
+
+TEST(ShapeCacheTest, IdenticalShapesShareGmdl)
+{
+    u32 startSize = shape_cache_size();
+
+    const Gmdl * pBoxA = shape_cache_acquire(ShapeKey::box(vec3(1.0f, 2.0f, 3.0f), Color(255, 0, 0)));
+    const Gmdl * pBoxB = shape_cache_acquire(ShapeKey::box(vec3(1.0f, 2.0f, 3.0f), Color(255, 0, 0)));
+    const Gmdl * pBoxC = shape_cache_acquire(ShapeKey::box(vec3(1.0f, 2.0f, 3.0f), Color(0, 255, 0)));
+    const Gmdl * pCone = shape_cache_acquire(ShapeKey::cone(vec3(1.0f, 2.0f, 3.0f), 8, Color(255, 0, 0)));
+    const Gmdl * pCone16 = shape_cache_acquire(ShapeKey::cone(vec3(1.0f, 2.0f, 3.0f), 16, Color(255, 0, 0)));
+
+    EXPECT_EQ(pBoxA, pBoxB);
+    EXPECT_NE(pBoxA, pBoxC);
+    EXPECT_NE(pBoxA, pCone);
+    EXPECT_NE(pCone, pCone16);
+    EXPECT_EQ(shape_cache_size(), startSize + 4);
+    EXPECT_EQ(shape_cache_refcount(pBoxA), 2u);
+
+    shape_cache_release(pBoxA);
+    EXPECT_EQ(shape_cache_refcount(pBoxB), 1u);
+    EXPECT_EQ(shape_cache_size(), startSize + 4);
+
+    shape_cache_release(pBoxB);
+    shape_cache_release(pBoxC);
+    shape_cache_release(pCone);
+    shape_cache_release(pCone16);
+    EXPECT_EQ(shape_cache_size(), startSize);
+}
+
+TEST(ShapeCacheTest, HexColorsAreKeyed)
+{
+    Color colorsA[6] = { Color(1, 2, 3), Color(4, 5, 6), Color(1, 2, 3), Color(4, 5, 6), Color(1, 2, 3), Color(4, 5, 6) };
+    Color colorsB[6] = { Color(1, 2, 3), Color(4, 5, 6), Color(1, 2, 3), Color(4, 5, 6), Color(1, 2, 3), Color(7, 8, 9) };
+
+    EXPECT_TRUE(ShapeKey::hex(1.0f, 2.0f, colorsA, 6) == ShapeKey::hex(1.0f, 2.0f, colorsA, 6));
+    EXPECT_FALSE(ShapeKey::hex(1.0f, 2.0f, colorsA, 6) == ShapeKey::hex(1.0f, 2.0f, colorsB, 6));
+    EXPECT_FALSE(ShapeKey::hex(1.0f, 2.0f, colorsA, 6) == ShapeKey::hex(1.0f, 3.0f, colorsA, 6));
+
+    const Gmdl * pHex = shape_cache_acquire(ShapeKey::hex(1.0f, 2.0f, colorsA, 6));
+    EXPECT_EQ(pHex->vertCount(), kHexVertCount);
+    shape_cache_release(pHex);
+}
+
+TEST(ShapeCacheTest, SharedAcrossThreads)
+{
+    static const u32 kThreads = 8;
+    static const u32 kPerThread = 1000;
+
+    ShapeKey key = ShapeKey::sphere(vec3(1.0f), 12, 12, Color(10, 20, 30));
+
+    std::vector<std::vector<const Gmdl*>> acquired(kThreads);
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (u32 i = 0; i < kPerThread; ++i)
+                acquired[t].push_back(shape_cache_acquire(key));
+        });
+    }
+    for (auto & thread : threads)
+        thread.join();
+
+    const Gmdl * pGmdl = acquired[0][0];
+    for (const auto & list : acquired)
+        for (const Gmdl * pOther : list)
+            ASSERT_EQ(pOther, pGmdl);
+    EXPECT_EQ(shape_cache_refcount(pGmdl), kThreads * kPerThread);
+
+    threads.clear();
+    for (u32 t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (const Gmdl * pOther : acquired[t])
+                shape_cache_release(pOther);
+        });
+    }
+    for (auto & thread : threads)
+        thread.join();
+
+    EXPECT_EQ(shape_cache_refcount(pGmdl), 0u);
+}
+
+// A scene of identical boxes, one Gmdl each as before against one
+// shared Gmdl.
+TEST(ShapeCacheTest, TenThousandBoxes)
+{
+    static const u32 kBoxes = 10000;
+
+    const Gmdl * pOne = build_box(vec3(1.0f), Color(200, 200, 200), mat43(1.0f));
+    u64 uncachedBytes = u64(pOne->totalSize()) * kBoxes;
+    GDELETE(const_cast<Gmdl*>(pOne));
+
+    u32 startSize = shape_cache_size();
+    std::vector<const Gmdl*> boxes;
+    for (u32 i = 0; i < kBoxes; ++i)
+        boxes.push_back(shape_cache_acquire(ShapeKey::box(vec3(1.0f), Color(200, 200, 200))));
+
+    EXPECT_EQ(shape_cache_size(), startSize + 1);
+    u64 cachedBytes = boxes[0]->totalSize();
+
+    for (const Gmdl * pGmdl : boxes)
+        shape_cache_release(pGmdl);
+    EXPECT_EQ(shape_cache_size(), startSize);
+
+    printf("%u boxes, one Gmdl each: %llu bytes, shared: %llu bytes\n",
+           kBoxes,
+           (unsigned long long)uncachedBytes,
+           (unsigned long long)cachedBytes);
+}
+
+TEST(ShapeBuilderTest, WideIndicesPastSixteenBits)
+{
+    static const u32 kTriCount = 23334; // 70002 verts
+    Gmdl * pGmdl = Gmdl::create(kVERT_PosNormCol, kTriCount * 3, kPRIM_Triangle, kTriCount, 0);
+    Scoped_GFREE<Gmdl> pGmdl_sp(pGmdl);
+    ASSERT_TRUE(pGmdl->has32BitIndices());
+
+    ShapeBuilder builder(pGmdl);
+    for (u32 t = 0; t < kTriCount; ++t)
+        builder.addTri(vec3(0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), Color(255, 255, 255));
+
+    for (u32 i = 0; i < pGmdl->indexCount(); ++i)
+        ASSERT_EQ(pGmdl->primIndex(i), i);
+}
+
+TEST(ShapeBuilderTest, AppendedGmdlIndicesFollowVerts)
+{
+    Gmdl * pTri = Gmdl::create(kVERT_PosNormCol, 3, kPRIM_Triangle, 1, 0);
+    Scoped_GFREE<Gmdl> pTri_sp(pTri);
+    ShapeBuilder triBuilder(pTri);
+    triBuilder.addTri(vec3(0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), Color(255, 0, 0));
+
+    Gmdl * pGmdl = Gmdl::create(kVERT_PosNormCol, 16, kPRIM_Triangle, 8, 0);
+    Scoped_GFREE<Gmdl> pGmdl_sp(pGmdl);
+    ShapeBuilder builder(pGmdl);
+    builder.addQuad(vec3(0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 1.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), Color(0, 255, 0));
+    builder.addGmdl(*pTri);
+
+    // 4 quad verts precede the appended triangle's
+    EXPECT_EQ(pGmdl->primIndex(6), 4u);
+    EXPECT_EQ(pGmdl->primIndex(7), 5u);
+    EXPECT_EQ(pGmdl->primIndex(8), 6u);
+}
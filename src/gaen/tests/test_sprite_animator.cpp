@@ -0,0 +1,209 @@
+//------------------------------------------------------------------------------
+// test_sprite_animator.cpp - Tests for batched sprite animation timing
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+#include "gaen/core/HashMap.h"
+#include "gaen/render_support/SpriteAnimator.h"
+
+using namespace gaen;
+
+TEST(SpriteAnimatorTest, AdvanceAndLoop)
+{
+    SpriteAnimator animator;
+    SpriteAnimBatch batch;
+    Vector<kMEM_Engine, SpriteAnimDone> done;
+
+    // 4 frames over 1 second
+    animator.play(7, 1, 100, 4, 1.0f, true, 0);
+
+    animator.advance(0.1f, batch, done);
+    EXPECT_TRUE(batch.empty());
+
+    animator.advance(0.2f, batch, done);
+    ASSERT_EQ(batch.size(), 1u);
+    EXPECT_EQ(batch[0].uid, 7u);
+    EXPECT_EQ(batch[0].animHash, 100u);
+    EXPECT_EQ(batch[0].animFrameIdx, 1u);
+
+    // remainder carries, 0.05 left over + 0.5 is two more frames
+    animator.advance(0.5f, batch, done);
+    ASSERT_EQ(batch.size(), 2u);
+    EXPECT_EQ(batch[1].animFrameIdx, 3u);
+
+    animator.advance(0.25f, batch, done);
+    ASSERT_EQ(batch.size(), 3u);
+    EXPECT_EQ(batch[2].animFrameIdx, 0u);
+    EXPECT_TRUE(done.empty());
+    EXPECT_TRUE(animator.isPlaying(7));
+}
+
+TEST(SpriteAnimatorTest, NonLoopDone)
+{
+    SpriteAnimator animator;
+    SpriteAnimBatch batch;
+    Vector<kMEM_Engine, SpriteAnimDone> done;
+
+    animator.play(1, 10, 100, 2, 1.0f, false, 555);
+    animator.play(2, 11, 200, 2, 1.0f, true, 666);
+    EXPECT_EQ(animator.activeCount(), 2u);
+
+    animator.advance(1.0f, batch, done);
+    ASSERT_EQ(done.size(), 2u);
+    EXPECT_EQ(done[0].owner, 10u);
+    EXPECT_EQ(done[0].message, 555u);
+    EXPECT_EQ(done[1].owner, 11u);
+    EXPECT_EQ(done[1].message, 666u);
+
+    // non looping stopped, looping keeps going
+    EXPECT_FALSE(animator.isPlaying(1));
+    EXPECT_TRUE(animator.isPlaying(2));
+    EXPECT_EQ(animator.activeCount(), 1u);
+
+    done.clear();
+    animator.advance(0.5f, batch, done);
+    EXPECT_TRUE(done.empty());
+    EXPECT_EQ(batch[batch.size() - 1].uid, 2u);
+}
+
+TEST(SpriteAnimatorTest, StopAndRestart)
+{
+    SpriteAnimator animator;
+    SpriteAnimBatch batch;
+    Vector<kMEM_Engine, SpriteAnimDone> done;
+
+    for (u32 uid = 0; uid < 8; ++uid)
+        animator.play(uid, 1, 100, 4, 1.0f, true, 0);
+
+    animator.stop(0);
+    animator.stop(3);
+    animator.stop(42); // unknown is ignored
+    EXPECT_EQ(animator.activeCount(), 6u);
+    EXPECT_FALSE(animator.isPlaying(0));
+    EXPECT_FALSE(animator.isPlaying(3));
+
+    // restarting a playing uid doesn't duplicate it
+    animator.play(5, 1, 200, 2, 1.0f, true, 0);
+    EXPECT_EQ(animator.activeCount(), 6u);
+
+    animator.advance(0.5f, batch, done);
+    u32 seen = 0;
+    for (u32 i = 0; i < batch.size(); ++i)
+    {
+        EXPECT_NE(batch[i].uid, 0u);
+        EXPECT_NE(batch[i].uid, 3u);
+        if (batch[i].uid == 5)
+        {
+            EXPECT_EQ(batch[i].animHash, 200u);
+            EXPECT_EQ(batch[i].animFrameIdx, 1u);
+        }
+        seen |= 1 << batch[i].uid;
+    }
+    EXPECT_EQ(seen, 0xf6u);
+}
+
+namespace
+{
+
+// Mirrors the per sprite state SpriteMgr used to walk every update
+struct MapSprite
+{
+    u32 animHash;
+    u32 frameIdx;
+    u32 frameCount;
+    f32 frameDuration;
+    f32 elapsed;
+    bool isAnimating;
+};
+
+} // namespace
+
+TEST(SpriteAnimatorTest, DISABLED_ManySpritesBenchmark)
+{
+    static const u32 kSprites = 20000;
+    static const u32 kAnimating = 5000;
+    static const u32 kFrames = 600;
+    static const f32 kDelta = 1.0f / 60.0f;
+
+    HashMap<kMEM_Engine, u32, MapSprite> sprites;
+    SpriteAnimator animator;
+    for (u32 uid = 0; uid < kSprites; ++uid)
+    {
+        bool animating = uid % (kSprites / kAnimating) == 0;
+        f32 duration = 0.25f + (uid % 7) * 0.1f;
+        sprites[uid] = MapSprite{100, 0, 8, duration / 8, 0.0f, animating};
+        if (animating)
+            animator.play(uid, 1, 100, 8, duration, true, 0);
+    }
+
+    u32 mapChanges = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        for (auto & pair : sprites)
+        {
+            MapSprite & s = pair.second;
+            if (!s.isAnimating)
+                continue;
+            s.elapsed += kDelta;
+            if (s.elapsed >= s.frameDuration)
+            {
+                u32 framesToAdvance = static_cast<u32>(s.elapsed / s.frameDuration);
+                s.elapsed -= framesToAdvance * s.frameDuration;
+                s.frameIdx = (s.frameIdx + framesToAdvance) % s.frameCount;
+                mapChanges++; // one sprite_anim message each
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    f64 mapMs = std::chrono::duration<f64, std::milli>(end - start).count();
+
+    u32 batchChanges = 0;
+    u32 batchMessages = 0;
+    Vector<kMEM_Engine, SpriteAnimDone> done;
+    start = std::chrono::steady_clock::now();
+    for (u32 f = 0; f < kFrames; ++f)
+    {
+        SpriteAnimBatch batch;
+        animator.advance(kDelta, batch, done);
+        batchChanges += batch.size();
+        batchMessages += batch.empty() ? 0 : 1;
+    }
+    end = std::chrono::steady_clock::now();
+    f64 batchMs = std::chrono::duration<f64, std::milli>(end - start).count();
+
+    EXPECT_EQ(animator.activeCount(), kAnimating);
+    EXPECT_LE(batchMessages, kFrames);
+    // fp accumulation may shift a boundary by a frame here or there
+    EXPECT_NEAR((f64)batchChanges, (f64)mapChanges, mapChanges * 0.01);
+
+    printf("%u sprites, %u animating, %u frames\n", kSprites, kAnimating, kFrames);
+    printf("  map walk:   %8.2f ms, %u renderer messages\n", mapMs, mapChanges);
+    printf("  animator:   %8.2f ms, %u renderer messages\n", batchMs, batchMessages);
+}
@@ -0,0 +1,164 @@
+//------------------------------------------------------------------------------
+// test_staging_ring.cpp - Tests for StagingRing
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/StagingRing.h"
+
+using namespace gaen;
+
+TEST(StagingRingTest, AllocatesInOrderAndAligns)
+{
+    StagingRing ring;
+    ring.init(1024);
+
+    u64 offset = ~0ull;
+    EXPECT_TRUE(ring.alloc(&offset, 10, 16));
+    EXPECT_EQ(0u, offset);
+    EXPECT_TRUE(ring.alloc(&offset, 10, 16));
+    EXPECT_EQ(16u, offset);
+    EXPECT_TRUE(ring.alloc(&offset, 4, 4));
+    EXPECT_EQ(28u, offset);
+    EXPECT_EQ(32u, ring.used());
+    EXPECT_TRUE(ring.hasUnfenced());
+
+    ring.fence(1);
+    EXPECT_FALSE(ring.hasUnfenced());
+
+    // Too big for any ring is refused rather than waited on
+    EXPECT_FALSE(ring.alloc(&offset, 2048, 16));
+}
+
+TEST(StagingRingTest, FullRingWaitsForFences)
+{
+    StagingRing ring;
+    ring.init(1024);
+
+    u64 offset = 0;
+    EXPECT_TRUE(ring.alloc(&offset, 512, 16));
+    ring.fence(1);
+    EXPECT_TRUE(ring.alloc(&offset, 512, 16));
+    ring.fence(2);
+
+    EXPECT_EQ(1024u, ring.used());
+    EXPECT_FALSE(ring.alloc(&offset, 16, 16));
+
+    // Retiring an unknown older id frees nothing
+    ring.retire(0);
+    EXPECT_FALSE(ring.alloc(&offset, 16, 16));
+
+    ring.retire(1);
+    EXPECT_EQ(512u, ring.used());
+    EXPECT_TRUE(ring.alloc(&offset, 512, 16));
+    EXPECT_EQ(0u, offset);
+    ring.fence(3);
+
+    ring.retire(3);
+    EXPECT_EQ(0u, ring.used());
+}
+
+TEST(StagingRingTest, RangesNeverWrap)
+{
+    StagingRing ring;
+    ring.init(1024);
+
+    u64 offset = 0;
+    EXPECT_TRUE(ring.alloc(&offset, 512, 16));
+    ring.fence(1);
+    EXPECT_TRUE(ring.alloc(&offset, 256, 16));
+    EXPECT_EQ(512u, offset);
+    ring.fence(2);
+    ring.retire(1);
+
+    // 256 bytes left before the end, so this skips to the start
+    EXPECT_TRUE(ring.alloc(&offset, 512, 16));
+    EXPECT_EQ(0u, offset);
+    ring.fence(3);
+
+    // Skipped bytes stay in use until the fence that skipped them retires
+    EXPECT_EQ(1024u, ring.used());
+    ring.retire(2);
+    EXPECT_EQ(768u, ring.used());
+    EXPECT_FALSE(ring.alloc(&offset, 512, 16));
+
+    // Empty ring starts over from the front
+    ring.retire(3);
+    EXPECT_TRUE(ring.alloc(&offset, 1024, 16));
+    EXPECT_EQ(0u, offset);
+}
+
+TEST(StagingRingTest, StreamsManyFramesWithinBudget)
+{
+    // Simulate a renderer streaming uploads through the ring with the
+    // gpu two frames behind, and check nothing in flight is overwritten.
+    const u64 kCapacity = 64 * 1024;
+    const u32 kFramesInFlight = 2;
+
+    StagingRing ring;
+    ring.init(kCapacity);
+
+    struct Range { u64 fenceId; u64 offset; u64 size; };
+    List<kMEM_Renderer, Range> inFlight;
+
+    u64 uploaded = 0;
+    u32 sizes[] = { 3000, 17000, 250, 9000, 30000, 64 };
+    u32 sizeIdx = 0;
+
+    for (u64 frame = 1; frame <= 200; ++frame)
+    {
+        if (frame > kFramesInFlight)
+        {
+            u64 signaled = frame - kFramesInFlight;
+            ring.retire(signaled);
+            while (!inFlight.empty() && inFlight.front().fenceId <= signaled)
+                inFlight.pop_front();
+        }
+
+        u64 budget = 32 * 1024;
+        u64 offset = 0;
+        while (budget > 0)
+        {
+            u64 size = sizes[sizeIdx % 6];
+            if (size > budget || !ring.alloc(&offset, size, 16))
+                break;
+            for (const Range & r : inFlight)
+            {
+                bool overlaps = offset < r.offset + r.size && r.offset < offset + size;
+                ASSERT_FALSE(overlaps);
+            }
+            inFlight.push_back(Range{frame, offset, size});
+            budget -= size;
+            uploaded += size;
+            sizeIdx++;
+        }
+
+        if (ring.hasUnfenced())
+            ring.fence(frame);
+        EXPECT_LE(ring.used(), kCapacity);
+    }
+
+    EXPECT_GT(uploaded, 100u * 16 * 1024);
+}
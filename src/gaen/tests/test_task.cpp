@@ -31,6 +31,7 @@
 
 #include "gaen/engine/Task.h"
 #include "gaen/engine/MessageQueue.h"
+#include "gaen/engine/OwnedTasks.h"
 
 class Entity1
 {
@@ -97,3 +98,212 @@ TEST(TaskTest, CreateTasks)
     }
 }
 
+static gaen::Task create_running(Entity1 * pEntity, gaen::u32 nameHash)
+{
+    gaen::Task task = gaen::Task::create_updatable(pEntity, nameHash);
+    task.setStatus(gaen::TaskStatus::Running);
+    return task;
+}
+
+// Update every task, recording the order, and verify each type's
+// tasks were updated back to back.
+static std::vector<gaen::task_id> update_tasks(gaen::OwnedTasks & tasks)
+{
+    std::vector<gaen::task_id> updated;
+    std::vector<gaen::u32> finishedTypes;
+    gaen::u32 lastType = 0;
+    tasks.update([&](gaen::Task & task)
+    {
+        if (!updated.empty() && task.nameHash() != lastType)
+        {
+            for (gaen::u32 type : finishedTypes)
+                EXPECT_NE(type, task.nameHash());
+            finishedTypes.push_back(lastType);
+        }
+        lastType = task.nameHash();
+        updated.push_back(task.id());
+        return true;
+    });
+    return updated;
+}
+
+static bool was_updated(const std::vector<gaen::task_id> & updated, gaen::task_id taskId)
+{
+    for (gaen::task_id id : updated)
+        if (id == taskId)
+            return true;
+    return false;
+}
+
+TEST(OwnedTasksTest, UpdatesGroupedByType)
+{
+    Entity1 e;
+    gaen::OwnedTasks tasks;
+
+    const gaen::u32 kTypes[] = { 1, 2, 1, 3, 2, 1, 3, 3, 2, 1 };
+    std::vector<gaen::Task> inserted;
+    for (gaen::u32 type : kTypes)
+    {
+        inserted.push_back(create_running(&e, type));
+        tasks.insert(inserted.back());
+    }
+
+    // Not updatable, owned but never updated
+    gaen::Task plain = gaen::Task::create(&e, 4);
+    plain.setStatus(gaen::TaskStatus::Running);
+    tasks.insert(plain);
+
+    std::vector<gaen::task_id> updated = update_tasks(tasks);
+    EXPECT_EQ(inserted.size(), updated.size());
+    EXPECT_EQ(3u, tasks.groupCount());
+    EXPECT_FALSE(was_updated(updated, plain.id()));
+
+    // Every task is still found after being moved into its group
+    EXPECT_EQ(inserted.size() + 1, tasks.size());
+    for (const gaen::Task & task : inserted)
+    {
+        gaen::Task * pTask = tasks.find(task.id());
+        ASSERT_NE(nullptr, pTask);
+        EXPECT_EQ(task.id(), pTask->id());
+        EXPECT_EQ(task.nameHash(), pTask->nameHash());
+    }
+    ASSERT_NE(nullptr, tasks.find(plain.id()));
+
+    // Order is stable frame to frame
+    EXPECT_EQ(updated, update_tasks(tasks));
+}
+
+TEST(OwnedTasksTest, InsertDuringUpdate)
+{
+    Entity1 e;
+    gaen::OwnedTasks tasks;
+    tasks.insert(create_running(&e, 1));
+    tasks.insert(create_running(&e, 2));
+
+    gaen::Task added1 = create_running(&e, 1);
+    gaen::Task added3 = create_running(&e, 3);
+    bool inserted = false;
+    tasks.update([&](gaen::Task & task)
+    {
+        EXPECT_NE(added1.id(), task.id());
+        EXPECT_NE(added3.id(), task.id());
+        if (!inserted)
+        {
+            tasks.insert(added1);
+            tasks.insert(added3);
+            inserted = true;
+        }
+        return true;
+    });
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(4u, tasks.size());
+
+    // Picked up on the next update, in their groups
+    std::vector<gaen::task_id> updated = update_tasks(tasks);
+    EXPECT_EQ(4u, updated.size());
+    EXPECT_TRUE(was_updated(updated, added1.id()));
+    EXPECT_TRUE(was_updated(updated, added3.id()));
+    EXPECT_EQ(3u, tasks.groupCount());
+}
+
+TEST(OwnedTasksTest, DeadTasksLeaveUpdate)
+{
+    Entity1 e;
+    gaen::OwnedTasks tasks;
+
+    std::vector<gaen::Task> inserted;
+    for (gaen::u32 i = 0; i < 12; ++i)
+    {
+        inserted.push_back(create_running(&e, 1 + i % 3));
+        tasks.insert(inserted.back());
+    }
+    EXPECT_EQ(12u, update_tasks(tasks).size());
+
+    gaen::task_id dead0 = inserted[0].id();
+    gaen::task_id dead4 = inserted[4].id();
+    gaen::task_id paused = inserted[7].id();
+    tasks.setStatus(dead0, gaen::TaskStatus::Dead);
+    tasks.setStatus(dead4, gaen::TaskStatus::Dead);
+    tasks.setStatus(paused, gaen::TaskStatus::Paused);
+
+    // Dead tasks stay owned until removed so they can still get fin__
+    std::vector<gaen::task_id> updated = update_tasks(tasks);
+    EXPECT_EQ(9u, updated.size());
+    EXPECT_FALSE(was_updated(updated, dead0));
+    EXPECT_FALSE(was_updated(updated, dead4));
+    EXPECT_FALSE(was_updated(updated, paused));
+    EXPECT_EQ(12u, tasks.size());
+    ASSERT_NE(nullptr, tasks.find(dead0));
+    EXPECT_EQ(gaen::TaskStatus::Dead, tasks.find(dead0)->status());
+
+    EXPECT_TRUE(tasks.remove(dead0));
+    EXPECT_TRUE(tasks.remove(dead4));
+    EXPECT_FALSE(tasks.remove(dead4));
+    EXPECT_EQ(10u, tasks.size());
+    EXPECT_EQ(nullptr, tasks.find(dead0));
+    EXPECT_EQ(nullptr, tasks.find(dead4));
+
+    // Paused tasks keep their place and resume
+    tasks.setStatus(paused, gaen::TaskStatus::Running);
+    updated = update_tasks(tasks);
+    EXPECT_EQ(10u, updated.size());
+    EXPECT_TRUE(was_updated(updated, paused));
+}
+
+TEST(OwnedTasksTest, RemoveFromGroups)
+{
+    Entity1 e;
+    gaen::OwnedTasks tasks;
+
+    std::vector<gaen::Task> inserted;
+    for (gaen::u32 i = 0; i < 20; ++i)
+    {
+        inserted.push_back(create_running(&e, 1 + i % 4));
+        tasks.insert(inserted.back());
+    }
+    gaen::Task plain = gaen::Task::create(&e, 5);
+    tasks.insert(plain);
+    update_tasks(tasks);
+
+    // Remove from the first, middle and last groups, plus one
+    // that's still unscheduled
+    gaen::Task unscheduled = create_running(&e, 2);
+    tasks.insert(unscheduled);
+    EXPECT_TRUE(tasks.remove(inserted[0].id()));
+    EXPECT_TRUE(tasks.remove(inserted[5].id()));
+    EXPECT_TRUE(tasks.remove(inserted[19].id()));
+    EXPECT_TRUE(tasks.remove(unscheduled.id()));
+    EXPECT_TRUE(tasks.remove(plain.id()));
+
+    std::vector<gaen::task_id> updated = update_tasks(tasks);
+    EXPECT_EQ(17u, updated.size());
+    EXPECT_EQ(17u, tasks.size());
+    for (gaen::u32 i = 0; i < inserted.size(); ++i)
+    {
+        bool removed = i == 0 || i == 5 || i == 19;
+        EXPECT_EQ(!removed, was_updated(updated, inserted[i].id()));
+        gaen::Task * pTask = tasks.find(inserted[i].id());
+        if (removed)
+            EXPECT_EQ(nullptr, pTask);
+        else
+        {
+            ASSERT_NE(nullptr, pTask);
+            EXPECT_EQ(inserted[i].id(), pTask->id());
+        }
+    }
+}
+
+TEST(OwnedTasksTest, UpdateStopsEarly)
+{
+    Entity1 e;
+    gaen::OwnedTasks tasks;
+    for (gaen::u32 i = 0; i < 4; ++i)
+        tasks.insert(create_running(&e, 1));
+
+    gaen::u32 count = 0;
+    EXPECT_FALSE(tasks.update([&](gaen::Task & task) { return ++count < 2; }));
+    EXPECT_EQ(2u, count);
+
+    // Usable again after stopping early
+    EXPECT_EQ(4u, update_tasks(tasks).size());
+}
@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------
+// test_voxel_build.cpp - Tests for parallel voxel shape construction
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/voxel.h"
+
+using namespace gaen;
+
+static const f32 kRad = 8.0f;
+static const vec3 kPos(1.0f, 2.0f, -20.0f);
+
+static void expect_same_voxels(const VoxelWorld & lhs, const VoxelWorld & rhs, u32 voxelCount)
+{
+    for (u32 i = 0; i < voxelCount; ++i)
+    {
+        ASSERT_EQ(0, memcmp(&lhs.voxel(0, i), &rhs.voxel(0, i), sizeof(Voxel))) << "voxel " << i;
+    }
+}
+
+TEST(VoxelBuildTest, ParallelMatchesSerial)
+{
+    static const u32 kDepth = 6;
+
+    VoxelWorld serialWorld;
+    u32 serialIdx = 100;
+    VoxelRef serialRef = set_shape_recursive(serialWorld, 0, serialIdx, kDepth, AABB_MinMax(kRad), SphereHitTest(kRad));
+
+    for (u32 threadCount : {1u, 3u, 8u})
+    {
+        VoxelWorld parallelWorld;
+        u32 parallelIdx = 100;
+        VoxelRef parallelRef = set_shape_parallel(parallelWorld, 0, parallelIdx, kDepth, AABB_MinMax(kRad), SphereHitTest(kRad), threadCount);
+
+        EXPECT_EQ(parallelIdx, serialIdx);
+        EXPECT_EQ(0, memcmp(&parallelRef, &serialRef, sizeof(VoxelRef)));
+        expect_same_voxels(serialWorld, parallelWorld, serialIdx);
+    }
+}
+
+TEST(VoxelBuildTest, ShallowShapes)
+{
+    for (u32 depth = 0; depth < 3; ++depth)
+    {
+        VoxelWorld serialWorld;
+        VoxelRoot serialRoot = set_shape_generic(serialWorld, 0, 0, depth, kPos, kRad, mat3(1.0f), SphereHitTest(kRad));
+
+        VoxelWorld parallelWorld;
+        VoxelRoot parallelRoot = set_shape_generic_parallel(parallelWorld, 0, 0, depth, kPos, kRad, mat3(1.0f), SphereHitTest(kRad), 4);
+
+        EXPECT_EQ(0, memcmp(&parallelRoot.children, &serialRoot.children, sizeof(VoxelRef)));
+        EXPECT_EQ(parallelWorld.voxelRootCount(), 1u);
+        expect_same_voxels(serialWorld, parallelWorld, serialRoot.children.type == kVT_NonTerminal ? serialRoot.children.voxelIdx + 1 : 0);
+    }
+}
+
+TEST(VoxelBuildTest, DISABLED_BuildBenchmark)
+{
+    static const u32 kDepth = 8;
+
+    VoxelWorld serialWorld;
+    u32 serialIdx = 0;
+    auto serialStart = std::chrono::steady_clock::now();
+    set_shape_recursive(serialWorld, 0, serialIdx, kDepth, AABB_MinMax(kRad), SphereHitTest(kRad));
+    auto serialEnd = std::chrono::steady_clock::now();
+
+    VoxelWorld parallelWorld;
+    u32 parallelIdx = 0;
+    auto parallelStart = std::chrono::steady_clock::now();
+    set_shape_parallel(parallelWorld, 0, parallelIdx, kDepth, AABB_MinMax(kRad), SphereHitTest(kRad));
+    auto parallelEnd = std::chrono::steady_clock::now();
+
+    f64 serialMs = std::chrono::duration<f64, std::milli>(serialEnd - serialStart).count();
+    f64 parallelMs = std::chrono::duration<f64, std::milli>(parallelEnd - parallelStart).count();
+    printf("depth %u sphere, %u nodes, serial: %.1f ms, parallel (%u threads): %.1f ms, speedup: %.1fx\n",
+           kDepth,
+           serialIdx,
+           serialMs,
+           platform_core_count(),
+           parallelMs,
+           parallelMs > 0.0 ? serialMs / parallelMs : 0.0);
+
+    EXPECT_EQ(parallelIdx, serialIdx);
+}
@@ -0,0 +1,202 @@
+//------------------------------------------------------------------------------
+// test_voxel_dag.cpp - Tests for sparse voxel DAG compression
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/voxel.h"
+#include "gaen/render_support/voxel_dag.h"
+
+using namespace gaen;
+
+static const f32 kRad = 8.0f;
+static const vec3 kPos(1.0f, 2.0f, -20.0f);
+
+// Square grid of rays from a camera at the origin looking down -z
+static void camera_rays(std::vector<vec3> & rayPos, std::vector<vec3> & rayDir, u32 size)
+{
+    rayPos.assign(size * size, vec3(0.0f, 0.0f, 10.0f));
+    rayDir.resize(size * size);
+    for (u32 y = 0; y < size; ++y)
+    {
+        for (u32 x = 0; x < size; ++x)
+        {
+            rayDir[y * size + x] = normalize(vec3(((f32)x / size - 0.5f) * 0.8f,
+                                                  ((f32)y / size - 0.5f) * 0.8f,
+                                                  -1.0f));
+        }
+    }
+}
+
+static void expect_same_hits(const VoxelWorld & lhsWorld, const VoxelRoot & lhsRoot, const VoxelWorld & rhsWorld, const VoxelRoot & rhsRoot)
+{
+    static const u32 kSize = 64;
+
+    std::vector<vec3> rayPos;
+    std::vector<vec3> rayDir;
+    camera_rays(rayPos, rayDir, kSize);
+
+    u32 hitCount = 0;
+    for (u32 i = 0; i < kSize * kSize; ++i)
+    {
+        VoxelRayHit lhs;
+        VoxelRayHit rhs;
+        lhs.hit = test_ray_voxel(&lhs.voxelRef, &lhs.normal, &lhs.zDepth, &lhs.face, &lhs.faceUv, lhsWorld, rayPos[i], rayDir[i], lhsRoot, 16);
+        rhs.hit = test_ray_voxel(&rhs.voxelRef, &rhs.normal, &rhs.zDepth, &rhs.face, &rhs.faceUv, rhsWorld, rayPos[i], rayDir[i], rhsRoot, 16);
+
+        ASSERT_EQ(lhs.hit, rhs.hit) << "ray " << i;
+        if (lhs.hit)
+        {
+            hitCount++;
+            EXPECT_EQ(lhs.zDepth, rhs.zDepth) << "ray " << i;
+            EXPECT_EQ(lhs.face, rhs.face) << "ray " << i;
+            EXPECT_EQ(lhs.faceUv.x, rhs.faceUv.x) << "ray " << i;
+            EXPECT_EQ(lhs.faceUv.y, rhs.faceUv.y) << "ray " << i;
+        }
+    }
+    EXPECT_GT(hitCount, 0u);
+}
+
+TEST(VoxelDagTest, MatchesTree)
+{
+    VoxelWorld treeWorld;
+    VoxelRoot treeRoot = set_shape_generic(treeWorld, 0, 0, 5, kPos, kRad, mat3(1.0f), SphereHitTest(kRad));
+
+    VoxelWorld dagWorld;
+    VoxelDag dag(dagWorld, 0, 0);
+    VoxelRoot dagRoot = set_shape_dag(dag, 5, kPos, kRad, mat3(1.0f), SphereHitTest(kRad));
+
+    u32 treeNodes = voxel_node_count(treeWorld, treeRoot.children);
+    EXPECT_EQ(voxel_node_count(dagWorld, dagRoot.children), dag.nodeCount());
+    EXPECT_EQ(dag.internCount(), treeNodes);
+    EXPECT_LT(dag.nodeCount(), treeNodes);
+
+    expect_same_hits(treeWorld, treeRoot, dagWorld, dagRoot);
+}
+
+TEST(VoxelDagTest, CompactExistingWorld)
+{
+    VoxelWorld treeWorld;
+    set_shape_generic(treeWorld, 0, 0, 5, kPos, kRad, mat3(1.0f), SphereHitTest(kRad));
+    set_shape_generic(treeWorld, 0, 10000, 4, vec3(-10.0f, 0.0f, -30.0f), 4.0f, mat3(1.0f), SphereHitTest(4.0f));
+
+    VoxelWorld dagWorld;
+    VoxelDag dag(dagWorld, 0, 0);
+    compact_voxel_world(dag, treeWorld);
+
+    ASSERT_EQ(dagWorld.voxelRootCount(), treeWorld.voxelRootCount());
+    for (u32 i = 0; i < treeWorld.voxelRootCount(); ++i)
+    {
+        EXPECT_LT(voxel_node_count(dagWorld, dagWorld.voxelRoot(i).children),
+                  voxel_node_count(treeWorld, treeWorld.voxelRoot(i).children));
+        expect_same_hits(treeWorld, treeWorld.voxelRoot(i), dagWorld, dagWorld.voxelRoot(i));
+    }
+
+    // Same shape built directly as a DAG compacts to the same size
+    VoxelWorld directWorld;
+    VoxelDag direct(directWorld, 0, 0);
+    set_shape_dag(direct, 5, kPos, kRad, mat3(1.0f), SphereHitTest(kRad));
+
+    VoxelWorld recompactWorld;
+    VoxelDag recompact(recompactWorld, 0, 0);
+    compact_voxel_tree(recompact, treeWorld, treeWorld.voxelRoot(0).children);
+    EXPECT_EQ(recompact.nodeCount(), direct.nodeCount());
+}
+
+TEST(VoxelDagTest, NodesAreSharedAcrossMaterials)
+{
+    VoxelWorld world;
+    VoxelDag dag(world, 0, 0);
+
+    Voxel voxel;
+    for (u32 i = 0; i < 8; ++i)
+        voxel.children[i] = (i % 2) ? VoxelRef::terminal_full(3) : VoxelRef::terminal_empty();
+
+    // One node, each ref keeps the material it was interned with
+    VoxelRef ref1 = dag.intern(voxel, 1);
+    VoxelRef ref2 = dag.intern(voxel, 2);
+    EXPECT_EQ(1u, (u32)ref1.material);
+    EXPECT_EQ(2u, (u32)ref2.material);
+    EXPECT_EQ(ref1.voxelIdx, ref2.voxelIdx);
+    EXPECT_EQ(1u, dag.nodeCount());
+
+    VoxelRef ref1Again = dag.intern(voxel, 1);
+    EXPECT_EQ(ref1.voxelIdx, ref1Again.voxelIdx);
+    EXPECT_EQ(1u, (u32)ref1Again.material);
+    EXPECT_EQ(1u, dag.nodeCount());
+    EXPECT_EQ(3u, dag.internCount());
+}
+
+TEST(VoxelDagTest, DISABLED_LargeSceneBenchmark)
+{
+    static const u32 kDepth = 7;
+    static const u32 kSize = 256;
+    static const u32 kIterations = 4;
+
+    VoxelWorld treeWorld;
+    VoxelRoot treeRoot = set_shape_generic(treeWorld, 0, 0, kDepth, kPos, kRad, mat3(1.0f), SphereHitTest(kRad));
+
+    VoxelWorld dagWorld;
+    VoxelDag dag(dagWorld, 0, 0);
+    compact_voxel_world(dag, treeWorld);
+    const VoxelRoot & dagRoot = dagWorld.voxelRoot(0);
+
+    u32 treeNodes = voxel_node_count(treeWorld, treeRoot.children);
+    u32 dagNodes = voxel_node_count(dagWorld, dagRoot.children);
+
+    std::vector<vec3> rayPos;
+    std::vector<vec3> rayDir;
+    camera_rays(rayPos, rayDir, kSize);
+    std::vector<VoxelRayHit> hits(kSize * kSize);
+
+    f64 rates[2];
+    const VoxelWorld * worlds[2] = { &treeWorld, &dagWorld };
+    const VoxelRoot * roots[2] = { &treeRoot, &dagRoot };
+    for (u32 w = 0; w < 2; ++w)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (u32 iter = 0; iter < kIterations; ++iter)
+            test_rays_voxel(hits.data(), *worlds[w], rayPos.data(), rayDir.data(), kSize * kSize, *roots[w], 16);
+        auto end = std::chrono::steady_clock::now();
+
+        rates[w] = (f64)kIterations * kSize * kSize / std::chrono::duration<f64>(end - start).count() / 1000000.0;
+    }
+
+    printf("depth %u sphere, tree: %u nodes (%.2f MB) %.2f Mrays/s, dag: %u nodes (%.2f MB) %.2f Mrays/s, saved %.1f%%\n",
+           kDepth,
+           treeNodes,
+           treeNodes * sizeof(Voxel) / (1024.0 * 1024.0),
+           rates[0],
+           dagNodes,
+           dagNodes * sizeof(Voxel) / (1024.0 * 1024.0),
+           rates[1],
+           100.0 * (1.0 - (f64)dagNodes / treeNodes));
+
+    EXPECT_LT(dagNodes, treeNodes);
+}
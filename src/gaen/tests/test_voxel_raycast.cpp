@@ -0,0 +1,290 @@
+//------------------------------------------------------------------------------
+// test_voxel_raycast.cpp - Tests for the tiled CPU voxel raycaster
+//
+// Gaen Concurrency Engine - http://gaen.org
+// Copyright (c) 2014-2022 Lachlan Orr
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//   claim that you wrote the original software. If you use this software
+//   in a product, an acknowledgment in the product documentation would be
+//   appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not be
+//   misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//   distribution.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gaen/render_support/RaycastCamera.h"
+#include "gaen/render_support/TileRenderer.h"
+#include "gaen/render_support/voxel.h"
+#include "gaen/render_support/voxel_proto.h"
+
+using namespace gaen;
+
+// Brute force nearest full voxel, same slab math as test_ray_box
+static void nearest_hit(f32 & nearest, const VoxelWorld & voxelWorld, const VoxelRef & voxelRef, const AABB_MinMax & aabb, const vec3 & rayPos, const vec3 & invRayDir)
+{
+    vec3 tbot = invRayDir * (aabb.min - rayPos);
+    vec3 ttop = invRayDir * (aabb.max - rayPos);
+    vec3 tmin = min(ttop, tbot);
+    vec3 tmax = max(ttop, tbot);
+    vec2 t = max(vec2(tmin.x, tmin.x), vec2(tmin.y, tmin.z));
+    f32 t0 = max(t.x, t.y);
+    t = min(vec2(tmax.x, tmax.x), vec2(tmax.y, tmax.z));
+    f32 t1 = min(t.x, t.y);
+
+    if (!(t1 > 0.0f && t0 <= t1) || voxelRef.isTerminalEmpty())
+        return;
+
+    if (voxelRef.isTerminalFull())
+    {
+        nearest = t0 < nearest ? t0 : nearest;
+        return;
+    }
+
+    for (u32 i = 0; i < 8; ++i)
+    {
+        nearest_hit(nearest,
+                    voxelWorld,
+                    voxelWorld.voxelRef(voxelRef.imageIdx, voxelRef.voxelIdx, (SubVoxel)i),
+                    voxel_subspace(aabb, (SubVoxel)i),
+                    rayPos,
+                    invRayDir);
+    }
+}
+
+// Square grid of rays from a camera at the origin looking down -z
+static void camera_rays(std::vector<vec3> & rayPos, std::vector<vec3> & rayDir, u32 size)
+{
+    rayPos.assign(size * size, vec3(0.0f, 0.0f, 10.0f));
+    rayDir.resize(size * size);
+    for (u32 y = 0; y < size; ++y)
+    {
+        for (u32 x = 0; x < size; ++x)
+        {
+            rayDir[y * size + x] = normalize(vec3(((f32)x / size - 0.5f) * 0.8f,
+                                                  ((f32)y / size - 0.5f) * 0.8f,
+                                                  -1.0f));
+        }
+    }
+}
+
+TEST(TileRendererTest, CoversEveryTileOnce)
+{
+    static const u32 kTilesX = 13;
+    static const u32 kTilesY = 7;
+
+    TileRenderer tileRenderer;
+    tileRenderer.init(4);
+    EXPECT_EQ(tileRenderer.threadCount(), 4u);
+
+    u32 visits[kTilesY][kTilesX];
+
+    // several frames to exercise worker wake up and hand back
+    for (u32 frame = 0; frame < 16; ++frame)
+    {
+        memset(visits, 0, sizeof(visits));
+        tileRenderer.render(kTilesX, kTilesY, [&](u32 tileX, u32 tileY)
+        {
+            visits[tileY][tileX]++;
+        });
+
+        for (u32 y = 0; y < kTilesY; ++y)
+            for (u32 x = 0; x < kTilesX; ++x)
+                EXPECT_EQ(visits[y][x], 1u);
+    }
+}
+
+TEST(VoxelRaycastTest, TiledMatchesSerial)
+{
+    static const u32 kSize = 200; // not a multiple of the tile size
+
+    RaycastCamera camera;
+    camera.init(kSize, kSize, 60.0f, 0.1f, 1000.0f);
+    List<kMEM_Renderer, Light> lights;
+
+    FragmentShaderSimulator serial;
+    serial.init(kSize, &camera, 1);
+    serial.render(camera, lights);
+
+    FragmentShaderSimulator tiled;
+    tiled.init(kSize, &camera, 4);
+    tiled.render(camera, lights);
+
+    const RGB8 * pSerial = reinterpret_cast<const RGB8*>(serial.frameBuffer());
+    const RGB8 * pTiled = reinterpret_cast<const RGB8*>(tiled.frameBuffer());
+    EXPECT_EQ(memcmp(pSerial, pTiled, kSize * kSize * sizeof(RGB8)), 0);
+
+    // make sure we're comparing more than sky
+    u32 hitCount = 0;
+    for (u32 i = 0; i < kSize * kSize; ++i)
+    {
+        if (pSerial[i].r != 100 || pSerial[i].g != 125 || pSerial[i].b != 255)
+            hitCount++;
+    }
+    EXPECT_GT(hitCount, 0u);
+}
+
+TEST(VoxelRaycastTest, DISABLED_FramesPerSecondBenchmark)
+{
+    static const u32 kSizes[] = { 128, 256, 512 };
+    static const u32 kFrames = 8;
+
+    List<kMEM_Renderer, Light> lights;
+
+    for (u32 size : kSizes)
+    {
+        RaycastCamera camera;
+        camera.init(size, size, 60.0f, 0.1f, 1000.0f);
+
+        f64 fps[2];
+        u32 threadCounts[2] = { 1, 0 };
+        for (u32 i = 0; i < 2; ++i)
+        {
+            FragmentShaderSimulator sim;
+            sim.init(size, &camera, threadCounts[i]);
+            sim.render(camera, lights); // warm up
+
+            auto start = std::chrono::steady_clock::now();
+            for (u32 f = 0; f < kFrames; ++f)
+                sim.render(camera, lights);
+            auto end = std::chrono::steady_clock::now();
+
+            fps[i] = kFrames / std::chrono::duration<f64>(end - start).count();
+        }
+
+        printf("%ux%u voxel raycast, serial: %.1f fps, tiled (%u threads): %.1f fps, speedup: %.1fx\n",
+               size,
+               size,
+               fps[0],
+               std::thread::hardware_concurrency(),
+               fps[1],
+               fps[0] > 0.0 ? fps[1] / fps[0] : 0.0);
+    }
+}
+
+TEST(VoxelPacketTest, MatchesNearestHit)
+{
+    static const u32 kSize = 96;
+    static const f32 kRad = 8.0f;
+
+    VoxelWorld voxelWorld;
+    VoxelRoot root = set_shape_generic(voxelWorld, 0, 0, 5, vec3(1.0f, 2.0f, -20.0f), kRad, mat3(1.0f), SphereHitTest(kRad));
+
+    std::vector<vec3> rayPos;
+    std::vector<vec3> rayDir;
+    camera_rays(rayPos, rayDir, kSize);
+
+    std::vector<VoxelRayHit> hits(kSize * kSize);
+    u32 hitCount = test_rays_voxel(hits.data(), voxelWorld, rayPos.data(), rayDir.data(), kSize * kSize, root, 16);
+    EXPECT_GT(hitCount, 0u);
+
+    for (u32 i = 0; i < kSize * kSize; ++i)
+    {
+        f32 nearest = FLT_MAX;
+        nearest_hit(nearest, voxelWorld, root.children, AABB_MinMax(root.rad), rayPos[i] - root.pos, 1.0f / rayDir[i]);
+
+        ASSERT_EQ(hits[i].hit, nearest != FLT_MAX) << "ray " << i;
+        if (hits[i].hit)
+        {
+            EXPECT_EQ(hits[i].zDepth, nearest) << "ray " << i;
+            EXPECT_NE(hits[i].face, VoxelFace::None) << "ray " << i;
+        }
+
+        // Scalar traversal agrees on what's hit, not always on which voxel
+        VoxelRayHit scalar;
+        bool scalarHit = test_ray_voxel(&scalar.voxelRef, &scalar.normal, &scalar.zDepth, &scalar.face, &scalar.faceUv, voxelWorld, rayPos[i], rayDir[i], root, 16);
+        EXPECT_EQ(hits[i].hit, scalarHit) << "ray " << i;
+    }
+}
+
+TEST(VoxelPacketTest, IncoherentFallsBack)
+{
+    static const f32 kRad = 4.0f;
+
+    VoxelWorld voxelWorld;
+    VoxelRoot root = set_shape_generic(voxelWorld, 0, 0, 3, vec3(0.0f, 0.0f, 0.0f), kRad, mat3(1.0f), SphereHitTest(kRad));
+
+    // rays converging on the shape from different octants
+    vec3 rayPos[kRayPacketSize];
+    vec3 rayDir[kRayPacketSize];
+    for (u32 i = 0; i < kRayPacketSize; ++i)
+    {
+        rayPos[i] = vec3(i & 1 ? 10.0f : -10.0f, i & 2 ? 10.5f : -9.5f, i & 4 ? 11.0f : -9.0f);
+        rayDir[i] = normalize(-rayPos[i]);
+    }
+
+    VoxelRayHit hits[kRayPacketSize];
+    u32 hitMask = test_ray_voxel_packet(hits, voxelWorld, rayPos, rayDir, kRayPacketSize, root, 16);
+
+    for (u32 i = 0; i < kRayPacketSize; ++i)
+    {
+        VoxelRayHit scalar;
+        scalar.hit = test_ray_voxel(&scalar.voxelRef, &scalar.normal, &scalar.zDepth, &scalar.face, &scalar.faceUv, voxelWorld, rayPos[i], rayDir[i], root, 16);
+
+        EXPECT_TRUE(scalar.hit);
+        EXPECT_EQ(hits[i].hit, scalar.hit);
+        EXPECT_EQ((hitMask >> i) & 1, (u32)scalar.hit);
+        EXPECT_EQ(hits[i].zDepth, scalar.zDepth);
+        EXPECT_EQ(hits[i].face, scalar.face);
+    }
+}
+
+TEST(VoxelPacketTest, DISABLED_RaysPerSecondBenchmark)
+{
+    static const u32 kSize = 256;
+    static const u32 kIterations = 4;
+    static const f32 kRad = 8.0f;
+
+    VoxelWorld voxelWorld;
+    VoxelRoot root = set_shape_generic(voxelWorld, 0, 0, 6, vec3(1.0f, 2.0f, -20.0f), kRad, mat3(1.0f), SphereHitTest(kRad));
+
+    std::vector<vec3> rayPos;
+    std::vector<vec3> rayDir;
+    camera_rays(rayPos, rayDir, kSize);
+    std::vector<VoxelRayHit> hits(kSize * kSize);
+
+    auto scalarStart = std::chrono::steady_clock::now();
+    for (u32 iter = 0; iter < kIterations; ++iter)
+    {
+        for (u32 i = 0; i < kSize * kSize; ++i)
+        {
+            VoxelRayHit & hit = hits[i];
+            hit.hit = test_ray_voxel(&hit.voxelRef, &hit.normal, &hit.zDepth, &hit.face, &hit.faceUv, voxelWorld, rayPos[i], rayDir[i], root, 16);
+        }
+    }
+    auto scalarEnd = std::chrono::steady_clock::now();
+
+    for (u32 iter = 0; iter < kIterations; ++iter)
+    {
+        test_rays_voxel(hits.data(), voxelWorld, rayPos.data(), rayDir.data(), kSize * kSize, root, 16);
+    }
+    auto packetEnd = std::chrono::steady_clock::now();
+
+    f64 rayCount = (f64)kIterations * kSize * kSize;
+    f64 scalarRate = rayCount / std::chrono::duration<f64>(scalarEnd - scalarStart).count() / 1000000.0;
+    f64 packetRate = rayCount / std::chrono::duration<f64>(packetEnd - scalarEnd).count() / 1000000.0;
+    printf("voxel rays, scalar: %.2f Mrays/s, %u wide packets: %.2f Mrays/s, speedup: %.1fx\n",
+           scalarRate,
+           kRayPacketSize,
+           packetRate,
+           scalarRate > 0.0 ? packetRate / scalarRate : 0.0);
+}